@@ -16,6 +16,7 @@
 #include <vector>
 #include <cassert>
 #include <utility>
+#include <algorithm>
 
 #include "hfstdll.h"
 #include "HfstDataTypes.h"
@@ -62,6 +63,81 @@ public:
     HFSTDLL static bool has_value(const std::string& diacritic);
 };
 
+/** \brief The operator, feature and value of a flag diacritic, or
+    nothing if a symbol is not one.
+
+    Tables keep one of these for each symbol number, so that applying
+    a flag takes no map lookups.
+*/
+struct FdCode
+{
+    FdOperator op;
+    FdFeature feature;
+    FdValue value;
+    // position of the FdOperation in the table or -1 for other symbols
+    int operation;
+
+    FdCode(): op(Pop), feature(0), value(0), operation(-1) {}
+};
+
+/** \brief The values of the features of a flag diacritic state.
+
+    Up to INLINE_SIZE values are stored in the object itself, so that
+    copying and comparing a state does not touch the heap.
+*/
+class FdValues
+{
+public:
+    static const size_t INLINE_SIZE = 16;
+private:
+    FdValue inline_values[INLINE_SIZE];
+    std::vector<FdValue> more_values; // used if there are more features
+    size_t count;
+public:
+    FdValues(): count(0) {}
+    explicit FdValues(size_t n): count(n)
+        {
+            if (n <= INLINE_SIZE)
+                std::fill(inline_values, inline_values + n, 0);
+            else
+                more_values.assign(n, 0);
+        }
+    explicit FdValues(const std::vector<FdValue> & values):
+    count(values.size())
+        {
+            if (count <= INLINE_SIZE)
+                std::copy(values.begin(), values.end(), inline_values);
+            else
+                more_values = values;
+        }
+
+    size_t size() const { return count; }
+    FdValue & operator[](size_t i)
+        { return count <= INLINE_SIZE ? inline_values[i] : more_values[i]; }
+    FdValue operator[](size_t i) const
+        { return count <= INLINE_SIZE ? inline_values[i] : more_values[i]; }
+    const FdValue * begin() const
+        { return count <= INLINE_SIZE ? inline_values : &more_values[0]; }
+    const FdValue * end() const { return begin() + count; }
+
+    bool operator==(const FdValues & another) const
+        {
+            return count == another.count &&
+                std::equal(begin(), end(), another.begin());
+        }
+    bool operator!=(const FdValues & another) const
+        { return !(*this == another); }
+    bool operator<(const FdValues & another) const
+        {
+            return std::lexicographical_compare(begin(), end(),
+                                                another.begin(),
+                                                another.end());
+        }
+
+    std::vector<FdValue> to_vector() const
+        { return std::vector<FdValue>(begin(), end()); }
+};
+
 template<class T> class FdState;
   
 /** \brief A collection of the flag diacritics from a symbol table indexed
@@ -71,12 +147,22 @@ template<class T>
 class FdTable
 {
 private:
+    // Symbols below this are looked up in the dense array codes
+    static const size_t MAX_DENSE_SYMBOL = 1 << 20;
+
     // Used for generating IDs that stand in for feature and value strings
     std::map<std::string, FdFeature> feature_map;
     std::map<std::string, FdValue> value_map;
     
-    std::map<T, FdOperation> operations;
+    std::vector<FdOperation> operation_list;
+    std::map<T, FdCode> operations;
+    std::vector<FdCode> codes;   // the same indexed by symbol
     std::map<std::string, T> symbol_map;
+
+    static bool is_dense(T symbol)
+        {
+            return !(symbol < T()) && (size_t)symbol < MAX_DENSE_SYMBOL;
+        }
 public:
     FdTable(): feature_map(), value_map()
         { value_map[std::string()] = 0; } // empty value = neutral
@@ -121,14 +207,49 @@ public:
             }
 
             FdOperation operation(op, feature_map[feat], value_map[val], str);
-            operations[symbol] = operation;
+            FdCode & code = operations[symbol];
+            if (code.operation < 0)
+            {
+                code.operation = (int)operation_list.size();
+                operation_list.push_back(operation);
+            }
+            else
+            {
+                operation_list[code.operation] = operation;
+            }
+            code.op = operation.Operator();
+            code.feature = operation.Feature();
+            code.value = operation.Value();
             symbol_map[str] = symbol;
+
+            if (is_dense(symbol))
+            {
+                if (codes.size() <= (size_t)symbol)
+                    codes.resize((size_t)symbol + 1);
+                codes[(size_t)symbol] = code;
+            }
         }
     
     FdFeature num_features() const { return (hfst::FdFeature)feature_map.size(); }
 
+    /** \brief The compiled operation of \a symbol or NULL if it is not
+        a flag diacritic. */
+    const FdCode* get_code(T symbol) const
+        {
+            if (is_dense(symbol))
+            {
+                if ((size_t)symbol >= codes.size() ||
+                    codes[(size_t)symbol].operation < 0)
+                    return NULL;
+                return &codes[(size_t)symbol];
+            }
+            typename std::map<T, FdCode>::const_iterator it
+              = operations.find(symbol);
+            return (it == operations.end()) ? NULL : &(it->second);
+        }
+
     bool is_diacritic(T symbol) const
-        { return operations.find(symbol) != operations.end(); }
+        { return get_code(symbol) != NULL; }
 
     std::vector<T> get_symbols_with_feature(const std::string& feature) const
         {
@@ -137,9 +258,9 @@ public:
                 return retval;
             }
             FdFeature feature_code = feature_map.at(feature);
-            for (typename std::map<T, FdOperation>::const_iterator it = operations.begin();
+            for (typename std::map<T, FdCode>::const_iterator it = operations.begin();
                  it != operations.end(); ++it) {
-                if ((it->second).Feature() == feature_code) {
+                if ((it->second).feature == feature_code) {
                     retval.push_back(it->first);
                 }
             }
@@ -148,13 +269,8 @@ public:
       
     const FdOperation* get_operation(T symbol) const
         {
-          // for some reason this fails to compile???
-          //std::map<T,FdOperation>::const_iterator i
-          //  = operations.find(symbol);
-          //return (i==operations.end()) ? NULL : &(i->second);
-        
-          return (operations.find(symbol)==operations.end()) ? NULL :
-            &(operations.find(symbol)->second);
+            const FdCode * code = get_code(symbol);
+            return (code == NULL) ? NULL : &operation_list[code->operation];
         }
     const FdOperation* get_operation(const std::string& symbol) const
         {
@@ -206,7 +322,7 @@ private:
     const FdTable<T>* table;
     
     // This is indexed with values of type FdFeature
-    typename std::vector<FdValue> values;
+    FdValues values;
     T num_features;
     
     bool error_flag;
@@ -222,10 +338,22 @@ public:
 
     const FdTable<T>& get_table() const {return *table;}
 
-    const std::vector<FdValue> & get_values(void) const
+    std::vector<FdValue> get_values(void) const
+    { return values.to_vector(); }
+
+    // The same without copying the values to a vector
+    const FdValues & get_value_array(void) const
     { return values; }
 
     void assign_values(std::vector<FdValue> const & vals)
+    {
+        values = FdValues(vals);
+        if (values.size() != num_features) {
+            error_flag = true;
+        }
+    }
+
+    void assign_values(FdValues const & vals)
     {
         values = vals;
         if (values.size() != num_features) {
@@ -233,53 +361,67 @@ public:
         }
     }
 
+    bool operator==(const FdState<T> & another) const
+    { return error_flag == another.error_flag && values == another.values; }
+
     bool apply_operation(T symbol)
         {
-            const FdOperation* op = table->get_operation(symbol);
-            if(op)
-                return apply_operation(*op);
+            const FdCode* code = table->get_code(symbol);
+            if(code)
+                return apply_operation(code->op, code->feature, code->value);
             return true; // if the symbol isn't a diacritic
         }
     bool apply_operation(const FdOperation& op)
         {
-            switch(op.Operator()) {
+            return apply_operation(op.Operator(), op.Feature(), op.Value());
+        }
+    bool apply_operation(FdOperator op, FdFeature feature, FdValue value)
+        { return apply_operation(op, feature, value, values); }
+
+    /** \brief Apply an operation to feature values stored elsewhere,
+        e.g. an array \a values owned by a lookup routine. */
+    template<class V>
+    static bool apply_operation(FdOperator op, FdFeature feature,
+                                FdValue value, V & values)
+        {
+            switch(op) {
             case Pop: // positive set
-                values[op.Feature()] = op.Value();
+                values[feature] = value;
                 return true;
           
             case Nop: // negative set (literally, in this implementation)
-                values[op.Feature()] = -1*op.Value();
+                values[feature] = -1*value;
                 return true;
           
             case Rop: // require
-                if (op.Value() == 0) // empty require
-                    return (values[op.Feature()] != 0);
+                if (value == 0) // empty require
+                    return (values[feature] != 0);
                 else // nonempty require
-                    return (values[op.Feature()] == op.Value());
+                    return (values[feature] == value);
             
             case Dop: // disallow
-                if (op.Value() == 0) // empty disallow
-                    return (values[op.Feature()] == 0);
+                if (value == 0) // empty disallow
+                    return (values[feature] == 0);
                 else // nonempty disallow
-                    return (values[op.Feature()] != op.Value());
+                    return (values[feature] != value);
             
             case Cop: // clear
-                values[op.Feature()] = 0;
+                values[feature] = 0;
                 return true;
           
             case Uop: // unification
-              if(values[op.Feature()] == 0 || /* if the feature is unset or */
-                 values[op.Feature()] == op.Value() || /* the feature is at
-                                                          this value already
-                                                          or */
-                 (values[op.Feature()] < 0 &&
-                  (values[op.Feature()]*(-1) != op.Value())) /* the feature is
-                                                              negatively set
-                                                              to something
-                                                              else */
+              if(values[feature] == 0 || /* if the feature is unset or */
+                 values[feature] == value || /* the feature is at
+                                                this value already
+                                                or */
+                 (values[feature] < 0 &&
+                  (values[feature]*(-1) != value)) /* the feature is
+                                                      negatively set
+                                                      to something
+                                                      else */
                  )
                 {
-                    values[op.Feature()] = op.Value();
+                    values[feature] = value;
                     return true;
                 }
                 return false;
@@ -298,8 +440,7 @@ public:
     void reset()
         {
             error_flag = false;
-            values.clear();
-            values.insert(values.begin(), table->num_features(), 0);
+            values = FdValues(table->num_features());
         }
 };
 
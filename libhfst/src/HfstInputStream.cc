@@ -529,6 +529,12 @@ namespace hfst
       case HFST_OLW_TYPE:
         t.implementation.hfst_ol =
           this->implementation.hfst_ol->read_transducer(false);
+        // the lookdown index, if any, follows the transducer
+        if (props.erase("lookdown-index") != 0)
+          {
+            t.implementation.hfst_ol->set_inverse
+              (this->implementation.hfst_ol->read_transducer(false));
+          }
         if(t.get_type() != type) // weights need to be added or removed
         { t.convert(type); }
         break;
@@ -1383,6 +1389,14 @@ namespace hfst
     return has_hfst_header;
   }
 
+  void HfstInputStream::set_memory_mapping(bool value)
+  {
+    if (type == HFST_OL_TYPE || type == HFST_OLW_TYPE)
+      {
+        implementation.hfst_ol->set_memory_mapping(value);
+      }
+  }
+
 }
 
 #else // MAIN_TEST was defined
@@ -281,6 +281,16 @@ For documentation on the HFST binary transducer format, see
 
     HFSTDLL bool is_hfst_header_included(void) const;
 
+    /** \brief Whether optimized-lookup transducers read from a file are
+        served directly from a memory map of the file.
+
+        Loading a memory-mapped transducer does not copy its transition
+        tables, and processes that map the same file share one copy of
+        them. The file must not be modified while the transducers are in
+        use. Has no effect on other types of transducers or on streams that
+        were not opened from a file. Memory mapping is off by default. */
+    HFSTDLL void set_memory_mapping(bool value);
+
     friend class HfstTransducer;
   };
 
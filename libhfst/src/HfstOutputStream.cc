@@ -310,29 +310,32 @@ namespace hfst
     append(header, type_value);
   }
 
-#if HAVE_SFST || HAVE_LEAN_SFST
 void
 HfstOutputStream::append_implementation_specific_header_data(std::vector<char>&
                                                              header,
                                                              HfstTransducer&
                                                              transducer)
-#else
-void
-HfstOutputStream::append_implementation_specific_header_data(std::vector<char>&,
-                                                             HfstTransducer&)
-#endif
   {
-#if HAVE_SFST || HAVE_LEAN_SFST
     switch(type)
       {
+#if HAVE_SFST || HAVE_LEAN_SFST
       case SFST_TYPE:
         implementation.sfst->append_implementation_specific_header_data
           (header, transducer.implementation.sfst);
         break;
+#endif
+      case HFST_OL_TYPE:
+      case HFST_OLW_TYPE:
+        // tells the reader that the lookdown index follows the transducer
+        if (transducer.implementation.hfst_ol->get_inverse() != NULL)
+          {
+            append(header, "lookdown-index");
+            append(header, "true");
+          }
+        break;
       default:
         break;
       }
-#endif
   }
 
   HfstOutputStream &HfstOutputStream::flush()
@@ -487,6 +490,13 @@ HfstOutputStream::append_implementation_specific_header_data(std::vector<char>&,
       case HFST_OLW_TYPE:
         implementation.hfst_ol->write_transducer
           (transducer.implementation.hfst_ol);
+        // only the header can tell that the lookdown index is there
+        if (hfst_format &&
+            transducer.implementation.hfst_ol->get_inverse() != NULL)
+          {
+            implementation.hfst_ol->write_transducer
+              (transducer.implementation.hfst_ol->get_inverse());
+          }
         return *this;
       default:
         assert(false);
@@ -693,32 +693,42 @@ HfstOneLevelPaths * HfstTransducer::lookup(const HfstTokenizer& tok,
     return lookup(sv, limit, time_cutoff);
 }
 
+// Lookdown is no more thread-safe than lookup: both use the lookup session
+// that the optimized-lookup transducer keeps. The index is added to the
+// transducer the first time it is needed, by one thread only.
+hfst_ol::Transducer * HfstTransducer::get_lookdown_transducer() const
+{
+    switch(this->type) {
+    case (HFST_OL_TYPE):
+    case (HFST_OLW_TYPE):
+      return this->implementation.hfst_ol->get_or_build_inverse
+        ([](hfst_ol::Transducer * t)
+         { return ConversionFunctions::hfst_ol_to_inverted_hfst_ol(t); });
+    case (ERROR_TYPE):
+      HFST_THROW(TransducerHasWrongTypeException);
+    default:
+      HFST_THROW(FunctionNotImplementedException);
+    }
+}
+
 HfstOneLevelPaths * HfstTransducer::lookdown(const StringVector& s,
                          ssize_t limit) const {
-    (void)s;
-    (void)limit;
-    HFST_THROW(FunctionNotImplementedException);
+    return get_lookdown_transducer()->lookup_fd(s, limit);
 }
 
 HfstOneLevelPaths * HfstTransducer::lookdown_fd(StringVector& s,
                         ssize_t limit) const {
-    (void)s;
-    (void)limit;
-    HFST_THROW(FunctionNotImplementedException);
+    return get_lookdown_transducer()->lookup_fd(s, limit);
 }
 
   HfstOneLevelPaths * HfstTransducer::lookdown(const std::string& s,
                          ssize_t limit) const {
-    (void)s;
-    (void)limit;
-    HFST_THROW(FunctionNotImplementedException);
+    return lookdown_fd(s, limit);
 }
 
   HfstOneLevelPaths * HfstTransducer::lookdown_fd(const std::string& s,
                         ssize_t limit) const {
-    (void)s;
-    (void)limit;
-    HFST_THROW(FunctionNotImplementedException);
+    return get_lookdown_transducer()->lookup_fd(s, limit);
 }
 
 
@@ -752,8 +762,7 @@ bool HfstTransducer::is_lookup_infinitely_ambiguous(const std::string & s)
 
 bool HfstTransducer::is_lookdown_infinitely_ambiguous
 (const StringVector& s) const {
-    (void)s;
-    HFST_THROW(FunctionNotImplementedException);
+    return get_lookdown_transducer()->is_lookup_infinitely_ambiguous(s);
 }
 
 bool HfstTransducer::is_infinitely_ambiguous()
@@ -771,6 +780,16 @@ bool HfstTransducer::is_infinitely_ambiguous()
     }
 }
 
+float HfstTransducer::get_index_fill_ratio() const {
+    switch(this->type) {
+    case (HFST_OL_TYPE):
+    case (HFST_OLW_TYPE):
+      return this->implementation.hfst_ol->get_index_fill_ratio();
+    default:
+      HFST_THROW(FunctionNotImplementedException);
+    }
+}
+
 
 
 // -----------------------------------------------------------------------
@@ -5101,6 +5120,16 @@ bool HfstTransducer::is_lean_implementation_type_available
     return true;
 }  
   
+// Build the lookdown index of \a t if \a options asks for it
+static void add_lookdown_index(hfst_ol::Transducer * t,
+                               const std::string & options)
+{
+  if (ConversionFunctions::has_option(options, "lookdown") &&
+      t->get_inverse() == NULL)
+    { t->set_inverse
+        (ConversionFunctions::hfst_ol_to_inverted_hfst_ol(t, options)); }
+}
+
 HfstTransducer &HfstTransducer::convert(ImplementationType type,
                     std::string options)
 {
@@ -5115,11 +5144,89 @@ HfstTransducer &HfstTransducer::convert(ImplementationType type,
         HFST_THROW_MESSAGE(SpecifiedTypeRequiredException,
                            "HfstTransducer::convert"); }
     if (type == this->type)
-    { return *this; }
+    {
+      if (type == HFST_OL_TYPE || type == HFST_OLW_TYPE)
+        { add_lookdown_index(implementation.hfst_ol, options); }
+      return *this;
+    }
+    // Converting between HFST_OL_TYPE and HFST_OLW_TYPE keeps the index
+    if ((this->type == HFST_OL_TYPE || this->type == HFST_OLW_TYPE) &&
+        (type == HFST_OL_TYPE || type == HFST_OLW_TYPE) &&
+        implementation.hfst_ol->get_inverse() != NULL)
+    { options += " lookdown"; }
     if (! is_lean_implementation_type_available(type)) {
       throw ImplementationTypeNotAvailableException("HfstTransducer::convert", __FILE__, __LINE__, type);
     }
 
+#if HAVE_OPENFST
+    // Conversions to and from OpenFst that can skip HfstBasicTransducer
+    if (this->type == TROPICAL_OPENFST_TYPE &&
+        (type == HFST_OL_TYPE || type == HFST_OLW_TYPE))
+      {
+        hfst_ol::Transducer * ol =
+          ConversionFunctions::tropical_ofst_to_hfst_ol
+          (implementation.tropical_ofst, type==HFST_OLW_TYPE, options);
+        tropical_ofst_interface.delete_transducer(implementation.tropical_ofst);
+        add_lookdown_index(ol, options);
+        implementation.hfst_ol = ol;
+        this->type = type;
+        return *this;
+      }
+    if ((this->type == HFST_OL_TYPE || this->type == HFST_OLW_TYPE) &&
+        type == TROPICAL_OPENFST_TYPE)
+      {
+        fst::StdVectorFst * ofst =
+          ConversionFunctions::hfst_ol_to_tropical_ofst
+          (implementation.hfst_ol);
+        delete implementation.hfst_ol;
+        implementation.tropical_ofst = ofst;
+        this->type = type;
+        return *this;
+      }
+#if HAVE_FOMA
+    if (this->type == FOMA_TYPE && type == TROPICAL_OPENFST_TYPE)
+      {
+        fst::StdVectorFst * ofst =
+          ConversionFunctions::foma_to_tropical_ofst(implementation.foma);
+        foma_interface.delete_foma(implementation.foma);
+        implementation.tropical_ofst = ofst;
+        this->type = type;
+        return *this;
+      }
+    if (this->type == TROPICAL_OPENFST_TYPE && type == FOMA_TYPE)
+      {
+        fsm * foma =
+          ConversionFunctions::tropical_ofst_to_foma
+          (implementation.tropical_ofst);
+        tropical_ofst_interface.delete_transducer(implementation.tropical_ofst);
+        implementation.foma = foma;
+        this->type = type;
+        return *this;
+      }
+#endif
+#if HAVE_SFST || HAVE_LEAN_SFST
+    if (this->type == SFST_TYPE && type == TROPICAL_OPENFST_TYPE)
+      {
+        fst::StdVectorFst * ofst =
+          ConversionFunctions::sfst_to_tropical_ofst(implementation.sfst);
+        sfst_interface.delete_transducer(implementation.sfst);
+        implementation.tropical_ofst = ofst;
+        this->type = type;
+        return *this;
+      }
+    if (this->type == TROPICAL_OPENFST_TYPE && type == SFST_TYPE)
+      {
+        SFST::Transducer * sfst =
+          ConversionFunctions::tropical_ofst_to_sfst
+          (implementation.tropical_ofst);
+        tropical_ofst_interface.delete_transducer(implementation.tropical_ofst);
+        implementation.sfst = sfst;
+        this->type = type;
+        return *this;
+      }
+#endif
+#endif // HAVE_OPENFST
+
     hfst::implementations::HfstBasicTransducer * internal=NULL;
     switch (this->type)
       {
@@ -5227,6 +5334,7 @@ HfstTransducer &HfstTransducer::convert(ImplementationType type,
         ConversionFunctions::hfst_basic_transducer_to_hfst_ol
         (internal, this->type==HFST_OLW_TYPE?true:false, options);
       delete internal;
+      add_lookdown_index(implementation.hfst_ol, options);
       break;
 #endif
 #if HAVE_FOMA
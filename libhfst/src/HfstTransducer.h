@@ -410,6 +410,11 @@ An example:
        Create an HfstBasicTransducer equivalent to \a t. */
     implementations::HfstBasicTransducer * get_basic_transducer() const;
 
+    /* For internal use, implemented only for HFST_OL_TYPE and HFST_OLW_TYPE:
+       Get the inverse of the optimized-lookup transducer that serves
+       lookdown, building it the first time it is needed. */
+    hfst_ol::Transducer * get_lookdown_transducer() const;
+
     /* For internal use:
        Create a backend implementation of the same type that this transducer
        has and that is equivalent to \a t and delete \a t. Assign the
@@ -798,6 +803,14 @@ in \a ifile.
         #HFST_OL_TYPE or #HFST_OLW_TYPE transducer, but an #HFST_OL_TYPE
         or #HFST_OLW_TYPE transducer cannot be converted to any other type.
 
+        When converting to #HFST_OL_TYPE or #HFST_OLW_TYPE, \a options may
+        include the word "lookdown" to also build the index that #lookdown
+        uses. The index is written and read with the transducer, and kept
+        when converting between #HFST_OL_TYPE and #HFST_OLW_TYPE.
+        The word "quick" packs the index table faster but leaves more
+        holes in it, and "compact" packs it slower but tighter; see
+        #get_index_fill_ratio.
+
         @note For conversion between implementations::HfstTransitionGraph and HfstTransducer,
         see HfstTransducer(const hfst::implementations::HfstBasicTransducer&, ImplementationType) and #hfst::implementations::HfstTransitionGraph::HfstTransitionGraph(const hfst::HfstTransducer&).
     */
@@ -1160,7 +1173,7 @@ ccc : ddd
         const std::string &s, ssize_t limit = -1,
         double time_cutoff = 0.0) const;
 
-    //! @brief (Not implemented) Lookdown a single string \a s and return
+    //! @brief Lookdown a single string \a s and return
     //! a maximum of \a limit results.
     //!
     //! Traverse all paths on logical second level of the transducer to produce
@@ -1168,26 +1181,32 @@ ccc : ddd
     //! This is in effect a fast composition of single
     //! path from left hand side.
     //!
+    //! Implemented only for HFST_OL_TYPE and HFST_OLW_TYPE. The lookup is
+    //! done in an optimized-lookup index of the output side, which is
+    //! built the first time it is needed unless the transducer was
+    //! converted with option "lookdown" or read from a stream that has it.
+    //!
+    //! @note Like #lookup, lookdown is not thread-safe: the same transducer
+    //! may not be looked down or up in by two threads at the same time.
+    //!
     //! @param s  string to look down
     //! <!-- @param tok  tokenizer to split string in arcs? -->
     //! @param limit  number of strings to extract. -1 tries to extract all and
     //!             may get stuck if infinitely ambiguous
     //! @return  output parameter to store unique results
-    //! @todo todo
     HFSTDLL HfstOneLevelPaths * lookdown(const StringVector& s,
                  ssize_t limit = -1) const;
 
     HFSTDLL HfstOneLevelPaths * lookdown(const std::string& s,
                  ssize_t limit = -1) const;
 
-    //! @brief (Not implemented) Lookdown a single string minding
+    //! @brief Lookdown a single string minding
     //! flag diacritics properly.
     //!
     //! This is a version of lookdown that handles flag diacritics as epsilons
     //! and validates the sequences prior to outputting.
     //!
     //! @sa lookdown
-    //! @todo todo
     HFSTDLL HfstOneLevelPaths * lookdown_fd(StringVector& s,
                     ssize_t limit = -1) const;
 
@@ -1204,13 +1223,22 @@ ccc : ddd
     HFSTDLL bool is_lookup_infinitely_ambiguous(const StringVector & s) const;
     HFSTDLL bool is_lookup_infinitely_ambiguous(const std::string & s) const;
 
-    //! @brief (Not implemented) Whether lookdown of path \a s will have
-    //! infinite results.
-    //! @todo todo
+    //! @brief Whether lookdown of path \a s will have infinite results.
+    //!
+    //! As with #is_lookup_infinitely_ambiguous, the argument \a s is
+    //! currently ignored. Implemented only for HFST_OL_TYPE and
+    //! HFST_OLW_TYPE.
     HFSTDLL bool is_lookdown_infinitely_ambiguous(const StringVector& s) const;
 
     HFSTDLL bool is_infinitely_ambiguous() const ;
 
+    //! @brief The share of the index table of an HFST_OL_TYPE or
+    //! HFST_OLW_TYPE transducer that holds transitions or final weights.
+    //!
+    //! The rest are holes left by packing, see the "quick" and "compact"
+    //! options of #convert.
+    HFSTDLL float get_index_fill_ratio() const;
+
 
     // -------------------------------------------
     // --------- Optimization operations ---------
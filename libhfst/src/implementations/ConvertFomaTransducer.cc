@@ -28,6 +28,19 @@
 #include "HfstBasicTransducer.h"
 #include "FomaTransducer.h"
 
+#if HAVE_OPENFST
+#include "TropicalWeightTransducer.h"
+#ifdef _MSC_VER
+#include "back-ends/openfstwin/src/include/fst/fstlib.h"
+#else
+#if HAVE_OPENFST_UPSTREAM
+#include <fst/fstlib.h>
+#else
+#include "back-ends/openfst/src/include/fst/fstlib.h"
+#endif
+#endif // _MSC_VER
+#endif // HAVE_OPENFST
+
 namespace hfst { namespace implementations
 {
 
@@ -333,6 +346,176 @@ namespace hfst { namespace implementations
     return net;
   }
 
+#if HAVE_OPENFST
+
+  /* ------------------------------------------------------------------------
+
+     Conversion functions between foma and OpenFst tropical transducers
+     that do not go through HfstBasicTransducer. Symbols are handled as
+     numbers and remapped with a single table indexed by symbol number.
+
+     ------------------------------------------------------------------------ */
+
+  /* Create an OpenFst tropical transducer equivalent to foma transducer
+     \a t. The start state gets number zero by swapping its number with
+     that of state zero. */
+  fst::StdVectorFst * ConversionFunctions::
+  foma_to_tropical_ofst(fsm * t) {
+
+    StringVector symbol_vector = FomaTransducer::get_symbol_vector(t);
+    std::vector<unsigned int> harmonization_vector
+      = HfstTropicalTransducerTransitionData::get_harmonization_vector(symbol_vector);
+
+    fst::StdVectorFst * net = new fst::StdVectorFst();
+
+    fst::SymbolTable st("");
+    st.AddSymbol(internal_epsilon, 0);
+    st.AddSymbol(internal_unknown, 1);
+    st.AddSymbol(internal_identity, 2);
+    for (unsigned int i = 0; i < symbol_vector.size(); i++) {
+      if (! symbol_vector[i].empty()) {
+        st.AddSymbol(symbol_vector[i], harmonization_vector[i]);
+      }
+    }
+
+    // Find the start state and the biggest state number
+    struct fsm_state *fsm = t->states;
+    int start_state_id = -1;
+    bool start_state_found=false;
+    int max_state = -1;
+    for (int i=0; (fsm+i)->state_no != -1; i++) {
+      if ((fsm+i)->start_state == 1) {
+        handle_start_state(fsm+i, start_state_id, start_state_found);
+      }
+      if ((fsm+i)->state_no > max_state) {
+        max_state = (fsm+i)->state_no;
+      }
+      if ((fsm+i)->target > max_state) {
+        max_state = (fsm+i)->target;
+      }
+    }
+
+    // An empty transducer
+    if (! start_state_found) {
+      net->SetStart(net->AddState());
+      net->SetInputSymbols(&st);
+      return net;
+    }
+
+    for (int s = 0; s <= max_state; s++) {
+      net->AddState();
+    }
+    net->SetStart(0);
+
+    for (int i=0; (fsm+i)->state_no != -1; i++) {
+      StateId origin = (fsm+i)->state_no;
+      if (origin == (StateId)start_state_id)
+        origin = 0;
+      else if (origin == 0)
+        origin = start_state_id;
+
+      if ((fsm+i)->target != -1) {
+        StateId target = (fsm+i)->target;
+        if (target == (StateId)start_state_id)
+          target = 0;
+        else if (target == 0)
+          target = start_state_id;
+        net->AddArc(origin,
+                    fst::StdArc(harmonization_vector.at((fsm+i)->in),
+                                harmonization_vector.at((fsm+i)->out),
+                                0, target));
+      }
+      if ((fsm+i)->final_state == 1) {
+        net->SetFinal(origin, 0);
+      }
+    }
+
+    net->SetInputSymbols(&st);
+    return net;
+  }
+
+  /* Create a foma transducer equivalent to OpenFst tropical transducer
+     \a t. Weights are ignored. */
+  fsm * ConversionFunctions::
+  tropical_ofst_to_foma(fst::StdVectorFst * t) {
+
+    struct fsm_construct_handle *h;
+    fsm *net;
+    const char * emptystr = "";
+    h = fsm_construct_init(const_cast<char*>(emptystr));
+
+    // Copy the alphabet and record the foma number of each label
+    StringVector symbol_vector = TropicalWeightTransducer::get_symbol_vector(t);
+    std::vector<int> foma_numbers(symbol_vector.size(), -1);
+    for (unsigned int i = 0; i < symbol_vector.size(); i++) {
+      if (symbol_vector[i].empty())
+        continue;
+      char * symbol = const_cast<char*>(symbol_vector[i].c_str());
+      int number = fsm_construct_check_symbol(h, symbol);
+      if (number == -1) {
+        number = fsm_construct_add_symbol(h, symbol);
+      }
+      foma_numbers[i] = number;
+    }
+    const char * reserved[] =
+      { internal_epsilon.c_str(), internal_unknown.c_str(),
+        internal_identity.c_str() };
+    for (unsigned int i = 0; i < 3; i++) {
+      char * symbol = const_cast<char*>(reserved[i]);
+      if (fsm_construct_check_symbol(h, symbol) == -1) {
+        fsm_construct_add_symbol(h, symbol);
+      }
+    }
+
+    StateId initial_state = t->Start();
+    if (initial_state != (StateId)fst::kNoStateId) {
+      for (fst::StateIterator<fst::StdVectorFst> siter(*t);
+           ! siter.Done(); siter.Next())
+        {
+          StateId s = siter.Value();
+          StateId origin = s;
+          if (origin == initial_state)
+            origin = 0;
+          else if (origin == 0)
+            origin = initial_state;
+
+          for (fst::ArcIterator<fst::StdVectorFst> aiter(*t,s);
+               !aiter.Done(); aiter.Next())
+            {
+              const fst::StdArc &arc = aiter.Value();
+              if (arc.ilabel >= foma_numbers.size() ||
+                  foma_numbers[arc.ilabel] == -1 ||
+                  arc.olabel >= foma_numbers.size() ||
+                  foma_numbers[arc.olabel] == -1)
+                {
+                  HFST_THROW_MESSAGE(HfstFatalException,
+                                     "arc label not in symbol table");
+                }
+              StateId target = arc.nextstate;
+              if (target == initial_state)
+                target = 0;
+              else if (target == 0)
+                target = initial_state;
+              fsm_construct_add_arc_nums(h, (int)origin, (int)target,
+                                         foma_numbers[arc.ilabel],
+                                         foma_numbers[arc.olabel]);
+            }
+
+          if (t->Final(s) != fst::TropicalWeight::Zero()) {
+            fsm_construct_set_final(h, (int)origin);
+          }
+        }
+    }
+
+    fsm_construct_set_initial(h, 0);
+    net = fsm_construct_done(h);
+    fsm_count(net);
+    net = fsm_topsort(net);
+    return net;
+  }
+
+#endif // HAVE_OPENFST
+
   }}
 #endif // HAVE_FOMA
 
@@ -18,6 +18,19 @@
 #include "HfstBasicTransducer.h"
 //#include "HfstTransducer.h"
 
+#if HAVE_OPENFST
+#include "TropicalWeightTransducer.h"
+#ifdef _MSC_VER
+#include "back-ends/openfstwin/src/include/fst/fstlib.h"
+#else
+#if HAVE_OPENFST_UPSTREAM
+#include <fst/fstlib.h>
+#else
+#include "back-ends/openfst/src/include/fst/fstlib.h"
+#endif
+#endif // _MSC_VER
+#endif // HAVE_OPENFST
+
 #ifndef MAIN_TEST
 namespace hfst { namespace implementations
 {
@@ -139,13 +152,31 @@ typedef std::set<std::string> StringSet;
 using hfst_ol::SymbolNumber;
 using hfst_ol::NO_SYMBOL_NUMBER;
 
-void get_states_and_symbols(
-    const HfstBasicTransducer * t,
-    std::vector<hfst_ol::StatePlaceholder> & state_placeholders,
+// Sort a symbol seen in a transition into input symbols, flag diacritics
+// and other (output) symbols
+static void note_symbols(const std::string & input,
+                         const std::string & output,
+                         StringSet & input_symbols,
+                         StringSet & flag_diacritics,
+                         StringSet & other_symbols)
+{
+    if (FdOperation::is_diacritic(input) ||
+        hfst_ol::PmatchAlphabet::is_insertion(input)) {
+        flag_diacritics.insert(input);
+    } else {
+        input_symbols.insert(input);
+    }
+    other_symbols.insert(output);
+}
+
+static void make_symbol_table(
+    const StringSet & input_symbols,
+    const StringSet & flag_diacritics,
+    const StringSet & other_symbols,
     hfst_ol::SymbolTable & symbol_table,
+    std::map<std::string, SymbolNumber> & string_symbol_map,
     SymbolNumber & seen_input_symbols,
-    std::set<SymbolNumber> & flag_symbols,
-    hfst_ol::Transducer * harmonizer)
+    std::set<SymbolNumber> & flag_symbols)
 {
     // Symbols must be in the following order in an optimized-lookup
     // transducer:
@@ -160,15 +191,80 @@ void get_states_and_symbols(
     // appear at the end of the alphabet. This allows us to ignore
     // them for indexing purposes, which potentially makes the index
     // table smaller and faster to pack.
+
+    // 1) epsilon
+    string_symbol_map[internal_epsilon] = hfst::size_t_to_ushort(symbol_table.size());
+    symbol_table.push_back(internal_epsilon);
     
+    // 2) input symbols
+    for (std::set<std::string>::const_iterator it = input_symbols.begin();
+         it != input_symbols.end(); ++it) {
+        if (!is_epsilon(*it)) {
+            string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
+            symbol_table.push_back(*it);
+            ++seen_input_symbols;
+        }
+    }
+    
+    // 3) Flag diacritics
+    for (std::set<std::string>::const_iterator it = flag_diacritics.begin();
+         it != flag_diacritics.end(); ++it) {
+        if (!is_epsilon(*it)) {
+            string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
+            // TODO: cl.exe: conversion from 'size_t' to 'char16_t'
+            flag_symbols.insert((unsigned short)symbol_table.size());
+            symbol_table.push_back(*it);
+            // don't increment seen_input_symbols - we use it for
+            // indexing
+        }
+    }
+    
+    // 4) non-input symbols
+    for (std::set<std::string>::const_iterator it = other_symbols.begin();
+         it != other_symbols.end(); ++it) {
+        if (!is_epsilon(*it) && input_symbols.count(*it) == 0 &&
+            flag_diacritics.count(*it) == 0) {
+            string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
+            symbol_table.push_back(*it);
+        }
+    }
+}
+
+// Use the symbol table of \a harmonizer instead of making one
+static void take_symbol_table(
+    hfst_ol::Transducer * harmonizer,
+    hfst_ol::SymbolTable & symbol_table,
+    std::map<std::string, SymbolNumber> & string_symbol_map,
+    SymbolNumber & seen_input_symbols,
+    std::set<SymbolNumber> & flag_symbols)
+{
+    symbol_table = harmonizer->get_symbol_table();
+    string_symbol_map = harmonizer->get_alphabet().build_string_symbol_map();
+    seen_input_symbols = harmonizer->get_header().input_symbol_count();
+    for (SymbolNumber i = 0; i < symbol_table.size(); ++i) {
+        if (harmonizer->get_alphabet().is_flag_diacritic(i) ||
+            hfst_ol::PmatchAlphabet::is_insertion(symbol_table[i])) {
+            flag_symbols.insert(i);
+        }
+    }
+}
+
+void get_states_and_symbols(
+    const HfstBasicTransducer * t,
+    std::vector<hfst_ol::StatePlaceholder> & state_placeholders,
+    hfst_ol::SymbolTable & symbol_table,
+    SymbolNumber & seen_input_symbols,
+    std::set<SymbolNumber> & flag_symbols,
+    hfst_ol::Transducer * harmonizer)
+{
     // We also gather information about possible gaps in the state numbering,
     // because we want it to be contiguous from now on.
 
     // If we have been told to use a certain symbol table,
     // there's no need to keep track of symbols here.
-    StringSet * input_symbols = new StringSet();
-    StringSet * flag_diacritics = new StringSet();
-    StringSet * other_symbols = new StringSet();
+    StringSet input_symbols;
+    StringSet flag_diacritics;
+    StringSet other_symbols;
     
     unsigned int first_transition = 0;
     unsigned int state_number = 0;
@@ -190,14 +286,9 @@ void get_states_and_symbols(
             ++first_transition;
             // If we don't already have a symbol table, collect symbols
             if (harmonizer == NULL) {
-                if (FdOperation::is_diacritic(tr_it->get_input_symbol()) ||
-                    hfst_ol::PmatchAlphabet::is_insertion(
-                        tr_it->get_input_symbol())) {
-                    flag_diacritics->insert(tr_it->get_input_symbol());
-                } else {
-                    input_symbols->insert(tr_it->get_input_symbol());
-                }
-                other_symbols->insert(tr_it->get_output_symbol());
+                note_symbols(tr_it->get_input_symbol(),
+                             tr_it->get_output_symbol(),
+                             input_symbols, flag_diacritics, other_symbols);
             }
         }
         ++state_number;
@@ -207,58 +298,13 @@ void get_states_and_symbols(
 
     // Collect symbols if we need to
     if (harmonizer == NULL) {
-        
-        // 1) epsilon
-        string_symbol_map[internal_epsilon] = hfst::size_t_to_ushort(symbol_table.size());
-        symbol_table.push_back(internal_epsilon);
-        
-        // 2) input symbols
-        for (std::set<std::string>::iterator it = input_symbols->begin();
-             it != input_symbols->end(); ++it) {
-            if (!is_epsilon(*it)) {
-                string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
-                symbol_table.push_back(*it);
-                ++seen_input_symbols;
-            }
-        }
-        
-        // 3) Flag diacritics
-        for (std::set<std::string>::iterator it = flag_diacritics->begin();
-             it != flag_diacritics->end(); ++it) {
-            if (!is_epsilon(*it)) {
-                string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
-                // TODO: cl.exe: conversion from 'size_t' to 'char16_t'
-                flag_symbols.insert((unsigned short)symbol_table.size());
-                symbol_table.push_back(*it);
-                // don't increment seen_input_symbols - we use it for
-                // indexing
-            }
-        }
-        
-        // 4) non-input symbols
-        for (std::set<std::string>::iterator it = other_symbols->begin();
-             it != other_symbols->end(); ++it) {
-            if (!is_epsilon(*it) && input_symbols->count(*it) == 0 &&
-              flag_diacritics->count(*it) == 0) {
-                string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
-                symbol_table.push_back(*it);
-            }
-        }
-        
+        make_symbol_table(input_symbols, flag_diacritics, other_symbols,
+                          symbol_table, string_symbol_map,
+                          seen_input_symbols, flag_symbols);
     } else {
-        symbol_table = harmonizer->get_symbol_table();
-        string_symbol_map = harmonizer->get_alphabet().build_string_symbol_map();
-        seen_input_symbols = harmonizer->get_header().input_symbol_count();
-        for (SymbolNumber i = 0; i < symbol_table.size(); ++i) {
-            if (harmonizer->get_alphabet().is_flag_diacritic(i) ||
-                hfst_ol::PmatchAlphabet::is_insertion(symbol_table[i])) {
-                flag_symbols.insert(i);
-            }
-        }
+        take_symbol_table(harmonizer, symbol_table, string_symbol_map,
+                          seen_input_symbols, flag_symbols);
     }
-    delete input_symbols;
-    delete flag_diacritics;
-    delete other_symbols;
 
     // Do a second pass over the transitions, figuring out everything
     // about the states except starting indices
@@ -286,36 +332,162 @@ void get_states_and_symbols(
     }
 }
 
-  /* Create an hfst_ol::Transducer equivalent to HfstBasicTransducer \a t.
-     \a weighted defined whether the created transducer is weighted. */
-  hfst_ol::Transducer * ConversionFunctions::
-  hfst_basic_transducer_to_hfst_ol
-  (const HfstBasicTransducer * t, bool weighted, std::string options,
-   HfstTransducer * harmonizer)
-  {
-      const float packing_aggression = (float)0.85; // double -> const float
-      const int floor_jump_threshold = 4; // a packing aggression parameter
-      //bool quick = options == "quick";
-      // The transition array is indexed starting from this constant
-      const unsigned int TA_OFFSET = 2147483648u;
+#if HAVE_OPENFST
+/* The same as above for an OpenFst transducer. The start state becomes
+   state number zero by swapping its number with that of state zero. Arc
+   labels are mapped to optimized-lookup symbol numbers with a single
+   table indexed by label. */
+void get_states_and_symbols(
+    fst::StdVectorFst * t,
+    std::vector<hfst_ol::StatePlaceholder> & state_placeholders,
+    hfst_ol::SymbolTable & symbol_table,
+    SymbolNumber & seen_input_symbols,
+    std::set<SymbolNumber> & flag_symbols,
+    hfst_ol::Transducer * harmonizer)
+{
+    StringVector label_vector = TropicalWeightTransducer::get_symbol_vector(t);
+    StateId start = t->Start();
+    if (start == (StateId)fst::kNoStateId) {
+        // an empty transducer, only a non-final start state
+        state_placeholders.push_back(
+            hfst_ol::StatePlaceholder(0, false, 0, 0.0));
+        std::map<std::string, SymbolNumber> string_symbol_map;
+        if (harmonizer == NULL) {
+            make_symbol_table(StringSet(), StringSet(), StringSet(),
+                              symbol_table, string_symbol_map,
+                              seen_input_symbols, flag_symbols);
+        } else {
+            take_symbol_table(harmonizer, symbol_table, string_symbol_map,
+                              seen_input_symbols, flag_symbols);
+        }
+        return;
+    }
+    StateId number_of_states = (StateId)t->NumStates();
 
-      // If we got a harmonizer, we
-      // unpack the raw optimized-lookup backend from it
-      hfst_ol::Transducer * harmonizer_ol = NULL;
-      if (harmonizer != NULL) {
-          harmonizer_ol = harmonizer->implementation.hfst_ol;
+    // Which labels are used on the input and output sides
+    std::vector<bool> input_labels(label_vector.size(), false);
+    std::vector<bool> output_labels(label_vector.size(), false);
+    unsigned int first_transition = 0;
+    for (StateId state_number = 0; state_number < number_of_states;
+         ++state_number) {
+        StateId s = state_number;
+        if (s == 0) {
+            s = start;
+        } else if (s == start) {
+            s = 0;
+        }
+        bool final = t->Final(s) != fst::TropicalWeight::Zero();
+        state_placeholders.push_back(hfst_ol::StatePlaceholder(
+                                         state_number,
+                                         final,
+                                         first_transition,
+                                         final ? t->Final(s).Value() : 0.0));
+        ++first_transition; // there's a padding entry between states
+        for (fst::ArcIterator<fst::StdVectorFst> aiter(*t, s);
+             !aiter.Done(); aiter.Next()) {
+            const fst::StdArc &arc = aiter.Value();
+            if (arc.ilabel >= label_vector.size() ||
+                arc.olabel >= label_vector.size()) {
+                HFST_THROW_MESSAGE(HfstFatalException,
+                                   "arc label not in symbol table");
+            }
+            input_labels[arc.ilabel] = true;
+            output_labels[arc.olabel] = true;
+            ++first_transition;
+        }
+    }
+
+    std::map<std::string, SymbolNumber> string_symbol_map;
+    if (harmonizer == NULL) {
+        StringSet input_symbols;
+        StringSet flag_diacritics;
+        StringSet other_symbols;
+        for (unsigned int label = 0; label < label_vector.size(); ++label) {
+            if (input_labels[label]) {
+                if (FdOperation::is_diacritic(label_vector[label]) ||
+                    hfst_ol::PmatchAlphabet::is_insertion(
+                        label_vector[label])) {
+                    flag_diacritics.insert(label_vector[label]);
+                } else {
+                    input_symbols.insert(label_vector[label]);
+                }
+            }
+            if (output_labels[label]) {
+                other_symbols.insert(label_vector[label]);
+            }
+        }
+        make_symbol_table(input_symbols, flag_diacritics, other_symbols,
+                          symbol_table, string_symbol_map,
+                          seen_input_symbols, flag_symbols);
+    } else {
+        take_symbol_table(harmonizer, symbol_table, string_symbol_map,
+                          seen_input_symbols, flag_symbols);
+    }
+
+    // The one remapping from arc labels to optimized-lookup symbols
+    std::vector<SymbolNumber> label_map(label_vector.size(), 0);
+    for (unsigned int label = 0; label < label_vector.size(); ++label) {
+        if (input_labels[label] || output_labels[label]) {
+            label_map[label] = string_symbol_map[label_vector[label]];
+        }
+    }
+
+    for (StateId state_number = 0; state_number < number_of_states;
+         ++state_number) {
+        StateId s = state_number;
+        if (s == 0) {
+            s = start;
+        } else if (s == start) {
+            s = 0;
+        }
+        for (fst::ArcIterator<fst::StdVectorFst> aiter(*t, s);
+             !aiter.Done(); aiter.Next()) {
+            const fst::StdArc &arc = aiter.Value();
+            StateId target = arc.nextstate;
+            if (target == start) {
+                target = 0;
+            } else if (target == 0) {
+                target = start;
+            }
+            state_placeholders[state_number].add_input(
+                label_map[arc.ilabel], flag_symbols);
+            hfst_ol::TransitionPlaceholder trans(target,
+                                                 label_map[arc.ilabel],
+                                                 label_map[arc.olabel],
+                                                 arc.weight.Value());
+            state_placeholders[state_number].add_transition(trans);
+        }
+    }
+}
+#endif // HAVE_OPENFST
+
+/* Pack the states gathered by get_states_and_symbols into the index and
+   transition tables of an optimized-lookup transducer. \a options may
+   trade table size for packing time: "quick" gives up on holes in the
+   index table sooner and "compact" keeps trying to fill them. */
+static hfst_ol::Transducer * pack_hfst_ol(
+    std::vector<hfst_ol::StatePlaceholder> & state_placeholders,
+    const hfst_ol::SymbolTable & symbol_table,
+    SymbolNumber seen_input_symbols,
+    std::set<SymbolNumber> & flag_symbols,
+    bool weighted,
+    const std::string & options)
+{
+      // The floor below which no starting index is looked for is moved
+      // past indices followed by windows this full...
+      float packing_aggression = (float)0.85;
+      // ...and jumped past the latest state when it has been stuck for
+      // this many states
+      int floor_jump_threshold = 4;
+      if (ConversionFunctions::has_option(options, "quick")) {
+          packing_aggression = (float)0.5;
+          floor_jump_threshold = 0;
+      } else if (ConversionFunctions::has_option(options, "compact")) {
+          packing_aggression = (float)0.95;
+          floor_jump_threshold = 64;
       }
-      
-      std::vector<hfst_ol::StatePlaceholder> state_placeholders;
-      hfst_ol::SymbolTable symbol_table;
-      SymbolNumber seen_input_symbols = 1; // We always have epsilon
-      std::set<SymbolNumber> flag_symbols;
-      get_states_and_symbols(t,
-                             state_placeholders,
-                             symbol_table,
-                             seen_input_symbols,
-                             flag_symbols,
-                             harmonizer_ol);
+      // The transition array is indexed starting from this constant
+      const unsigned int TA_OFFSET = 2147483648u;
 
       // For determining the index table we first sort the states (excepting
     // the starting state) by number of different input symbols.
@@ -347,12 +519,9 @@ void get_states_and_symbols(
         if (it->is_simple()) {
             continue;
         }
-        unsigned int i = first_available_index;
-
-        // While this index is not suitable for a starting index, keep looking
-        while (!used_indices->fits(*it, flag_symbols, i)) {
-            ++i;
-        }
+        unsigned int i = used_indices->first_fit(
+            hfst_ol::IndexPlaceholders::entry_offsets(*it, flag_symbols),
+            first_available_index);
         it->start_index = i;
         previous_successful_index = i;
         // Once we've found a starting index, insert a finality marker and
@@ -368,9 +537,8 @@ void get_states_and_symbols(
             used_indices->assign(i + index_offset + 1, it->state_number, index_offset);
         }
 
-        while (used_indices->unsuitable(first_available_index, seen_input_symbols, packing_aggression)) {
-            ++first_available_index;
-        }
+        first_available_index = used_indices->first_suitable(
+            first_available_index, seen_input_symbols, packing_aggression);
         if (first_available_index == previous_first_index) {
             if (floor_stuck_counter > floor_jump_threshold) {
                 first_available_index = previous_successful_index + 1;
@@ -453,6 +621,184 @@ void get_states_and_symbols(
                                    wtransition_table);
   }
 
+
+  /* Create an hfst_ol::Transducer equivalent to HfstBasicTransducer \a t.
+     \a weighted defined whether the created transducer is weighted. */
+  hfst_ol::Transducer * ConversionFunctions::
+  hfst_basic_transducer_to_hfst_ol
+  (const HfstBasicTransducer * t, bool weighted, std::string options,
+   HfstTransducer * harmonizer)
+  {
+      // If we got a harmonizer, we
+      // unpack the raw optimized-lookup backend from it
+      hfst_ol::Transducer * harmonizer_ol = NULL;
+      if (harmonizer != NULL) {
+          harmonizer_ol = harmonizer->implementation.hfst_ol;
+      }
+      
+      std::vector<hfst_ol::StatePlaceholder> state_placeholders;
+      hfst_ol::SymbolTable symbol_table;
+      SymbolNumber seen_input_symbols = 1; // We always have epsilon
+      std::set<SymbolNumber> flag_symbols;
+      get_states_and_symbols(t,
+                             state_placeholders,
+                             symbol_table,
+                             seen_input_symbols,
+                             flag_symbols,
+                             harmonizer_ol);
+      return pack_hfst_ol(state_placeholders, symbol_table,
+                          seen_input_symbols, flag_symbols, weighted,
+                          options);
+  }
+
+  /* Create an hfst_ol::Transducer that is hfst_ol::Transducer \a t with
+     its input and output sides swapped, so that looking up in it is
+     looking down in \a t. It is packed according to \a options. */
+  hfst_ol::Transducer * ConversionFunctions::
+  hfst_ol_to_inverted_hfst_ol(hfst_ol::Transducer * t, std::string options)
+  {
+      bool weighted = t->get_header().probe_flag(hfst_ol::Weighted);
+      HfstBasicTransducer * basic = hfst_ol_to_hfst_basic_transducer(t);
+      HfstBasicTransducer inverted;
+      inverted.add_symbols_to_alphabet(basic->get_alphabet());
+      HfstState max_state = basic->get_max_state();
+      for (HfstState s = 0; s <= max_state; ++s) {
+          inverted.add_state(s);
+          const HfstBasicTransitions & transitions = basic->transitions(s);
+          for (HfstBasicTransitions::const_iterator it = transitions.begin();
+               it != transitions.end(); ++it) {
+              inverted.add_transition
+                (s, HfstBasicTransition(it->get_target_state(),
+                                        it->get_output_symbol(),
+                                        it->get_input_symbol(),
+                                        it->get_weight()), false);
+          }
+          if (basic->is_final_state(s)) {
+              inverted.set_final_weight(s, basic->get_final_weight(s));
+          }
+      }
+      delete basic;
+      return hfst_basic_transducer_to_hfst_ol(&inverted, weighted, options);
+  }
+
+#if HAVE_OPENFST
+  /* Create an hfst_ol::Transducer equivalent to an OpenFst tropical weight
+     transducer \a t without going through HfstBasicTransducer. */
+  hfst_ol::Transducer * ConversionFunctions::
+  tropical_ofst_to_hfst_ol
+  (fst::StdVectorFst * t, bool weighted, std::string options,
+   HfstTransducer * harmonizer)
+  {
+      hfst_ol::Transducer * harmonizer_ol = NULL;
+      if (harmonizer != NULL) {
+          harmonizer_ol = harmonizer->implementation.hfst_ol;
+      }
+      
+      std::vector<hfst_ol::StatePlaceholder> state_placeholders;
+      hfst_ol::SymbolTable symbol_table;
+      SymbolNumber seen_input_symbols = 1; // We always have epsilon
+      std::set<SymbolNumber> flag_symbols;
+      get_states_and_symbols(t,
+                             state_placeholders,
+                             symbol_table,
+                             seen_input_symbols,
+                             flag_symbols,
+                             harmonizer_ol);
+      return pack_hfst_ol(state_placeholders, symbol_table,
+                          seen_input_symbols, flag_symbols, weighted,
+                          options);
+  }
+
+  /* Create an OpenFst tropical weight transducer equivalent to
+     hfst_ol::Transducer \a t without going through HfstBasicTransducer.
+     States are numbered in the order they are found, as in
+     hfst_ol_to_hfst_basic_transducer. */
+  fst::StdVectorFst * ConversionFunctions::
+  hfst_ol_to_tropical_ofst(hfst_ol::Transducer * t)
+  {
+      fst::StdVectorFst * net = new fst::StdVectorFst();
+      bool weighted = t->get_header().probe_flag(hfst_ol::Weighted);
+      const hfst_ol::SymbolTable& symbols
+        = t->get_alphabet().get_symbol_table();
+
+      // The one remapping from optimized-lookup symbols to arc labels
+      NumberVector label_map
+        = HfstTropicalTransducerTransitionData::
+        get_harmonization_vector(symbols);
+
+      fst::SymbolTable st("");
+      st.AddSymbol(internal_epsilon, 0);
+      st.AddSymbol(internal_unknown, 1);
+      st.AddSymbol(internal_identity, 2);
+      for (SymbolNumber i = 0; i < symbols.size(); ++i) {
+          st.AddSymbol(symbols[i], label_map[i]);
+      }
+
+      std::vector<hfst_ol::TransitionTableIndex> agenda;
+      hfst_ol::HfstOlToBasicStateMap state_map;
+
+      StateId start = net->AddState();
+      net->SetStart(start);
+      state_map[0] = start;
+      agenda.push_back(0);
+      while(!agenda.empty())
+      {
+          hfst_ol::TransitionTableIndex current_index = agenda.back();
+          agenda.pop_back();
+          StateId current_state = state_map[current_index];
+
+          if(hfst_ol::indexes_transition_index_table(current_index))
+          {
+              hfst_ol::TransitionWIndex transition_index
+                = t->get_index(current_index);
+              if (transition_index.final()) {
+                  net->SetFinal(current_state,
+                                weighted ? transition_index.final_weight()
+                                : 0);
+              }
+          }
+          else
+          {
+              hfst_ol::TransitionW transition
+                = t->get_transition(current_index);
+              if (transition.final()) {
+                  net->SetFinal(current_state,
+                                weighted ? transition.get_weight() : 0);
+              }
+          }
+          
+          hfst_ol::TransitionTableIndexSet transitions
+            = t->get_transitions_from_state(current_index);
+          for(hfst_ol::TransitionTableIndexSet::const_iterator it
+                =transitions.begin();it!=transitions.end();it++)
+          {
+              hfst_ol::TransitionW transition = t->get_transition(*it);
+              hfst_ol::HfstOlToBasicStateMap::const_iterator target_it
+                = state_map.find(transition.get_target());
+              StateId target;
+              if (target_it == state_map.end())
+              {
+                  target = net->AddState();
+                  state_map[transition.get_target()] = target;
+                  agenda.push_back(transition.get_target());
+              }
+              else
+              {
+                  target = target_it->second;
+              }
+              net->AddArc(current_state,
+                          fst::StdArc(label_map[transition.get_input_symbol()],
+                                      label_map[transition.get_output_symbol()],
+                                      weighted ? transition.get_weight() : 0,
+                                      target));
+          }
+      }
+
+      net->SetInputSymbols(&st);
+      return net;
+  }
+#endif // HAVE_OPENFST
+
 HfstTransducer * ConversionFunctions::hfst_ol_to_hfst_transducer(
     hfst_ol::Transducer * t)
 {
@@ -22,6 +22,19 @@
 #include "HfstBasicTransducer.h"
 #include "SfstTransducer.h"
 
+#if HAVE_OPENFST
+#include "TropicalWeightTransducer.h"
+#ifdef _MSC_VER
+#include "back-ends/openfstwin/src/include/fst/fstlib.h"
+#else
+#if HAVE_OPENFST_UPSTREAM
+#include <fst/fstlib.h>
+#else
+#include "back-ends/openfst/src/include/fst/fstlib.h"
+#endif
+#endif // _MSC_VER
+#endif // HAVE_OPENFST
+
 #include <stdexcept>
 
 
@@ -224,6 +237,166 @@ namespace hfst { namespace implementations
     return t;
   }
 
+#if HAVE_OPENFST
+
+  /* -----------------------------------------------------------
+
+      Conversion functions between SFST and OpenFst tropical transducers
+      that do not go through HfstBasicTransducer. Symbols are handled as
+      numbers and remapped with a single table indexed by symbol number.
+
+     ----------------------------------------------------------- */
+
+  /* Create an OpenFst tropical transducer equivalent to an SFST
+     transducer \a t. The root node becomes the start state zero. */
+  fst::StdVectorFst * ConversionFunctions::
+  sfst_to_tropical_ofst(SFST::Transducer * t) {
+
+    // How numbers are recoded in the conversion
+    StringVector symbol_vector = SfstTransducer::get_symbol_vector(t);
+    // change SFST's internal "<>" to HFST's "@_EPSILON_SYMBOL_@"
+    symbol_vector.at(0) = internal_epsilon;
+    std::vector<unsigned int> harmonization_vector
+      = HfstTropicalTransducerTransitionData::
+      get_harmonization_vector(symbol_vector);
+
+    fst::StdVectorFst * net = new fst::StdVectorFst();
+
+    fst::SymbolTable st("");
+    st.AddSymbol(internal_epsilon, 0);
+    st.AddSymbol(internal_unknown, 1);
+    st.AddSymbol(internal_identity, 2);
+    for (unsigned int i = 1; i < symbol_vector.size(); i++) {
+      if (! symbol_vector[i].empty()) {
+        st.AddSymbol(symbol_vector[i], harmonization_vector[i]);
+      }
+    }
+
+    std::vector<SFST::Node*> indexing;
+    size_t number_of_nodes = t->nodeindexing(&indexing).first;
+    for (size_t i = 0; i < number_of_nodes; i++) {
+      net->AddState();
+    }
+    StateId root = t->root_node()->index;
+    net->SetStart(0);
+
+    if (t->root_node()->check_visited(VMARK))
+      VMARK++;
+
+    // Visit the nodes reachable from the root, swapping the numbers of
+    // the root and node zero
+    std::vector<SFST::Node*> agenda;
+    agenda.push_back(t->root_node());
+    t->root_node()->was_visited(VMARK);
+    while (! agenda.empty()) {
+      SFST::Node * node = agenda.back();
+      agenda.pop_back();
+
+      StateId origin = node->index;
+      if (origin == root)
+        origin = 0;
+      else if (origin == 0)
+        origin = root;
+
+      for( SFST::ArcsIter p(node->arcs()); p; p++ ) {
+        SFST::Arc *arc=p;
+        StateId target = arc->target_node()->index;
+        if (target == root)
+          target = 0;
+        else if (target == 0)
+          target = root;
+        net->AddArc(origin,
+                    fst::StdArc
+                    (harmonization_vector.at(arc->label().lower_char()),
+                     harmonization_vector.at(arc->label().upper_char()),
+                     0, target));
+        if (! arc->target_node()->was_visited(VMARK)) {
+          agenda.push_back(arc->target_node());
+        }
+      }
+
+      if (node->is_final()) {
+        net->SetFinal(origin, 0);
+      }
+    }
+
+    net->SetInputSymbols(&st);
+    return net;
+  }
+
+  /* Create an SFST::Transducer equivalent to OpenFst tropical transducer
+     \a t. Weights are ignored. */
+  SFST::Transducer * ConversionFunctions::
+  tropical_ofst_to_sfst(fst::StdVectorFst * t) {
+
+    // Create an SFST transducer and insert HFST special symbols to its alphabet
+    SFST::Transducer * net = new SFST::Transducer();
+    net->alphabet.add_symbol(internal_unknown.c_str(), 1);
+    net->alphabet.add_symbol(internal_identity.c_str(), 2);
+
+    // Copy the alphabet, giving each symbol its HFST number
+    StringVector symbol_vector = TropicalWeightTransducer::get_symbol_vector(t);
+    std::vector<unsigned int> numbers
+      = HfstTropicalTransducerTransitionData::
+      get_harmonization_vector(symbol_vector);
+    for (unsigned int i = 0; i < symbol_vector.size(); i++) {
+      const std::string & symbol = symbol_vector[i];
+      if (not symbol.empty() && not is_epsilon(symbol) &&
+          not is_unknown(symbol) && not is_identity(symbol))
+        net->alphabet.add_symbol(symbol.c_str(), numbers[i]);
+    }
+
+    // The one table that takes arc labels to SFST symbol numbers
+    std::map<std::string, unsigned int> symbol_map
+      = SfstTransducer::get_symbol_map(net);
+    symbol_map.erase("<>");
+    symbol_map[internal_epsilon] = 0;
+    std::vector<unsigned int> harm =
+      HfstTropicalTransducerTransitionData::get_reverse_harmonization_vector
+      (symbol_map);
+    for (unsigned int i = 0; i < numbers.size(); i++) {
+      if (not symbol_vector[i].empty())
+        numbers[i] = harm.at(numbers[i]);
+    }
+
+    StateId initial_state = t->Start();
+    if (initial_state == (StateId)fst::kNoStateId)
+      return net;
+
+    // State number-to-SFST Node mapping, the start state is the root
+    std::vector<SFST::Node*> state_vector;
+    for (StateId s = 0; s < (StateId)t->NumStates(); s++) {
+      state_vector.push_back
+        (s == initial_state ? net->root_node() : net->new_node());
+    }
+
+    for (fst::StateIterator<fst::StdVectorFst> siter(*t);
+         ! siter.Done(); siter.Next())
+      {
+        StateId s = siter.Value();
+        for (fst::ArcIterator<fst::StdVectorFst> aiter(*t,s);
+             !aiter.Done(); aiter.Next())
+          {
+            const fst::StdArc &arc = aiter.Value();
+            if (arc.ilabel >= numbers.size() ||
+                arc.olabel >= numbers.size())
+              {
+                HFST_THROW_MESSAGE(HfstFatalException,
+                                   "arc label not in symbol table");
+              }
+            SFST::Label l(numbers[arc.ilabel], numbers[arc.olabel]);
+            state_vector[s]->add_arc(l, state_vector[arc.nextstate], net);
+          }
+        if (t->Final(s) != fst::TropicalWeight::Zero()) {
+          state_vector[s]->set_final(1);
+        }
+      }
+
+    return net;
+  }
+
+#endif // HAVE_OPENFST
+
   }}
 #endif // #if HAVE_SFST || HAVE_LEAN_SFST
   
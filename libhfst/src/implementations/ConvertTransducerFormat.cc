@@ -65,6 +65,23 @@ namespace hfst { namespace implementations
     return retval;
   }
 
+  bool ConversionFunctions::has_option
+    (const std::string &options, const std::string &option)
+  {
+    size_t start = 0;
+    while (start < options.size()) {
+      size_t end = options.find_first_of(" ,", start);
+      if (end == std::string::npos) {
+        end = options.size();
+      }
+      if (options.compare(start, end - start, option) == 0) {
+        return true;
+      }
+      start = end + 1;
+    }
+    return false;
+  }
+
 
   HfstBasicTransducer * ConversionFunctions::
   hfst_transducer_to_hfst_basic_transducer
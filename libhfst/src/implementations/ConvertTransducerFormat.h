@@ -103,6 +103,11 @@ namespace implementations {
     static NumberVector get_harmonization_vector
       (const StringVector &coding_vector);
 
+    /* Whether the space- or comma-separated list of conversion options
+       \a options has \a option. */
+    static bool has_option(const std::string &options,
+                           const std::string &option);
+
     static HfstBasicTransducer * hfst_transducer_to_hfst_basic_transducer
       (const hfst::HfstTransducer &t);
 
@@ -155,6 +160,26 @@ namespace implementations {
 #endif
 
 #endif // HAVE_OPENFST || HAVE_LEAN_OPENFST_LOG
+
+  /* Direct conversions that do not go through HfstBasicTransducer. */
+#if HAVE_OPENFST
+#if HAVE_SFST || HAVE_LEAN_SFST
+  static fst::StdVectorFst * sfst_to_tropical_ofst(SFST::Transducer * t);
+  static SFST::Transducer * tropical_ofst_to_sfst(fst::StdVectorFst * t);
+#endif // HAVE_SFST || HAVE_LEAN_SFST
+
+#if HAVE_FOMA
+  static fst::StdVectorFst * foma_to_tropical_ofst(fsm * t);
+  static fsm * tropical_ofst_to_foma(fst::StdVectorFst * t);
+#endif // HAVE_FOMA
+
+  static fst::StdVectorFst * hfst_ol_to_tropical_ofst
+    (hfst_ol::Transducer * t);
+
+  static hfst_ol::Transducer * tropical_ofst_to_hfst_ol
+    (fst::StdVectorFst * t, bool weighted,
+     std::string options="", HfstTransducer * harmonizer = NULL);
+#endif // HAVE_OPENFST
   
   
   static HfstBasicTransducer * hfst_ol_to_hfst_basic_transducer
@@ -164,6 +189,9 @@ namespace implementations {
       (const HfstBasicTransducer * t, bool weighted,
        std::string options="", HfstTransducer * harmonizer = NULL);
 
+  static hfst_ol::Transducer * hfst_ol_to_inverted_hfst_ol
+    (hfst_ol::Transducer * t, std::string options="");
+
   // A way to smuggle a hfst_ol backend into a HfstTransducer wrapper
   static HfstTransducer * hfst_ol_to_hfst_transducer(hfst_ol::Transducer * t);
 
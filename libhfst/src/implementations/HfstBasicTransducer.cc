@@ -9,6 +9,7 @@
 // information.
 
 #include "HfstBasicTransducer.h"
+#include <climits>
 
 #ifndef MAIN_TEST
 
@@ -610,12 +611,12 @@
              final_weight_map[s1] = s2_it->second;
              final_weight_map[s2] = s1_weight;
            }
-           if (s1_it != end_it) {
+           else if (s1_it != end_it) {
              HfstTropicalTransducerTransitionData::WeightType w = s1_it->second;
              final_weight_map.erase(s1);
              final_weight_map[s2] = w;
            }
-           if (s2_it != end_it) {
+           else if (s2_it != end_it) {
              HfstTropicalTransducerTransitionData::WeightType w = s2_it->second;
              final_weight_map.erase(s2);
              final_weight_map[s1] = w;
@@ -2894,18 +2895,20 @@
            HfstState current_state = s;
            // Path inserted, return the final state on this path
            while (it != spv.end()) {
-            HfstBasicTransitions tr = state_vector[current_state];
+            const HfstBasicTransitions & tr = state_vector[current_state];
             bool transition_found=false;
             /* The target state of the transition followed or added */
             HfstState next_state;
 
-            // Find the transition
-            // (Searching is slow?)
+            // Find the transition, comparing symbol numbers
+            unsigned int input_number
+              = HfstTropicalTransducerTransitionData::get_number(it->first);
+            unsigned int output_number
+              = HfstTropicalTransducerTransitionData::get_number(it->second);
             for (const auto & tr_it: tr)
               {
-                HfstTropicalTransducerTransitionData data = tr_it.get_transition_data();
-                if (data.get_input_symbol().compare(it->first) == 0 &&
-                    data.get_output_symbol().compare(it->second) == 0)
+                if (tr_it.get_input_number() == input_number &&
+                    tr_it.get_output_number() == output_number)
                   {
                     transition_found=true;
                     next_state = tr_it.get_target_state();
@@ -2917,9 +2920,11 @@
             if (! transition_found)
               {
                 next_state = add_state();
-                HfstBasicTransition transition(next_state, it->first,
-                                          it->second, 0);
-                add_transition(current_state, transition);
+                HfstBasicTransition transition(next_state, input_number,
+                                               output_number, 0, true);
+                alphabet.insert(it->first);
+                alphabet.insert(it->second);
+                add_transition(current_state, transition, false);
               }
 
             // Advance to the next transition on path
@@ -3420,6 +3425,194 @@
                                                  epsilon_path_states, fds, obey_flags);
          }
 
+     HfstEpsilonCycleIndex::HfstEpsilonCycleIndex(HfstBasicTransducer & t):
+       fsm(t), reaches_cycle(t.get_max_state() + 1, false),
+       marks(t.get_max_state() + 1, 0), mark(0)
+     {
+       // Tarjan's algorithm over the input epsilon and flag transitions,
+       // with an explicit stack instead of recursion
+       const HfstState UNVISITED = UINT_MAX;
+       HfstState n = (HfstState)reaches_cycle.size();
+       std::vector<unsigned int> order(n, UNVISITED);
+       std::vector<unsigned int> lowlink(n, 0);
+       std::vector<HfstState> component(n, UNVISITED);
+       std::vector<HfstState> component_stack;
+       // states being visited and the next transition to follow in each
+       std::vector<std::pair<HfstState, size_t> > path;
+       unsigned int counter = 0;
+
+       for (HfstState root = 0; root < n; root++)
+         {
+           if (order[root] != UNVISITED)
+             { continue; }
+           order[root] = lowlink[root] = counter++;
+           component_stack.push_back(root);
+           path.push_back(std::pair<HfstState, size_t>(root, 0));
+
+           while (! path.empty())
+             {
+               HfstState state = path.back().first;
+               const HfstBasicTransitions & transitions = fsm[state];
+               size_t i = path.back().second;
+               while (i < transitions.size() &&
+                      ! is_epsilon_like(transitions[i].get_input_symbol()))
+                 { i++; }
+               if (i < transitions.size())
+                 {
+                   path.back().second = i + 1;
+                   HfstState target = transitions[i].get_target_state();
+                   if (order[target] == UNVISITED)
+                     {
+                       order[target] = lowlink[target] = counter++;
+                       component_stack.push_back(target);
+                       path.push_back(std::pair<HfstState, size_t>(target, 0));
+                     }
+                   else if (component[target] == UNVISITED)
+                     {
+                       // still on the component stack
+                       lowlink[state] = std::min(lowlink[state], order[target]);
+                     }
+                   continue;
+                 }
+
+               path.pop_back();
+               if (! path.empty())
+                 {
+                   HfstState parent = path.back().first;
+                   lowlink[parent] = std::min(lowlink[parent], lowlink[state]);
+                 }
+               if (lowlink[state] != order[state])
+                 { continue; }
+
+               // state is the root of a component. The components its
+               // transitions lead out to are already finished.
+               size_t begin = component_stack.size();
+               do
+                 {
+                   begin--;
+                   component[component_stack[begin]] = state;
+                 }
+               while (component_stack[begin] != state);
+               bool reaches = (component_stack.size() - begin > 1);
+               for (size_t m = begin; m < component_stack.size() && ! reaches; m++)
+                 {
+                   const HfstBasicTransitions & member_transitions
+                     = fsm[component_stack[m]];
+                   for (const auto & transition : member_transitions)
+                     {
+                       if (! is_epsilon_like(transition.get_input_symbol()))
+                         { continue; }
+                       HfstState target = transition.get_target_state();
+                       // a loop, or a way out to a component that reaches one
+                       if (target == component_stack[m] ||
+                           (component[target] != state && reaches_cycle[target]))
+                         {
+                           reaches = true;
+                           break;
+                         }
+                     }
+                 }
+               for (size_t m = begin; m < component_stack.size(); m++)
+                 { reaches_cycle[component_stack[m]] = reaches; }
+               component_stack.resize(begin);
+             }
+         }
+     }
+
+     bool HfstEpsilonCycleIndex::is_epsilon_like(const std::string & symbol) const
+     {
+       return is_epsilon(symbol) || FdOperation::is_diacritic(symbol);
+     }
+
+     bool HfstEpsilonCycleIndex::consumes
+       (const std::string & symbol, const std::string & input, bool obey_flags) const
+     {
+       if (is_epsilon(symbol))
+         { return false; }
+       // A flag that is not valid on the path is matched literally when
+       // flags are obeyed
+       if (FdOperation::is_diacritic(symbol))
+         { return obey_flags && symbol == input; }
+       if (symbol == input)
+         { return true; }
+       return (symbol == "@_UNKNOWN_SYMBOL_@" || symbol == "@_IDENTITY_SYMBOL_@") &&
+         fsm.get_alphabet().find(input) == fsm.get_alphabet().end();
+     }
+
+     void HfstEpsilonCycleIndex::next_mark()
+     {
+       mark++;
+       if (mark == 0)
+         {
+           std::fill(marks.begin(), marks.end(), 0);
+           mark = 1;
+         }
+     }
+
+     bool HfstEpsilonCycleIndex::is_lookup_infinitely_ambiguous
+       (const StringVector & s, bool obey_flags/*=false*/)
+     {
+       // The states reached by consuming the first index symbols of s,
+       // without the states reachable from them by epsilons
+       std::vector<HfstState> reached(1, 0);
+       std::vector<HfstState> closure;
+       for (size_t index = 0; ; index++)
+         {
+           for (HfstState state : reached)
+             {
+               if (reaches_cycle[state])
+                 {
+                   return (! obey_flags) ||
+                     fsm.is_lookup_infinitely_ambiguous(s, true);
+                 }
+             }
+           if (index == s.size())
+             { return false; }
+
+           next_mark();
+           closure.clear();
+           for (HfstState state : reached)
+             {
+               if (marks[state] != mark)
+                 {
+                   marks[state] = mark;
+                   closure.push_back(state);
+                 }
+             }
+           for (size_t i = 0; i < closure.size(); i++)
+             {
+               for (const auto & transition : fsm[closure[i]])
+                 {
+                   HfstState target = transition.get_target_state();
+                   if (marks[target] != mark &&
+                       is_epsilon_like(transition.get_input_symbol()))
+                     {
+                       marks[target] = mark;
+                       closure.push_back(target);
+                     }
+                 }
+             }
+
+           next_mark();
+           reached.clear();
+           for (HfstState state : closure)
+             {
+               for (const auto & transition : fsm[state])
+                 {
+                   HfstState target = transition.get_target_state();
+                   if (marks[target] != mark &&
+                       consumes(transition.get_input_symbol(), s[index], obey_flags))
+                     {
+                       marks[target] = mark;
+                       reached.push_back(target);
+                     }
+                 }
+             }
+           if (reached.empty())
+             { return false; }
+         }
+     }
+
 
 
          void HfstBasicTransducer::push_back_to_two_level_path
@@ -20,6 +20,7 @@
  #include <iosfwd>
  #include <algorithm>
  #include <stack>
+ #include <vector>
 
  #include "../HfstSymbolDefs.h"
  #include "../HfstExceptionDefs.h"
@@ -1121,6 +1122,55 @@
      friend class ConversionFunctions;
      friend class hfst::HarmonizeUnknownAndIdentitySymbols;
      };
+
+     /** @brief The input epsilon cycles of an HfstBasicTransducer, found
+         once so that any number of lookups can be checked for infinite
+         ambiguity.
+
+         The strongly connected components of the graph of input epsilon
+         and flag diacritic transitions are computed when the index is
+         created. Checking a lookup is then a walk along the lookup path
+         that stops as soon as it meets a state from which a cyclic
+         component can be reached. Neither step recurses, so deep
+         transducers are safe.
+
+         The transducer must not be changed while the index is in use. */
+     class HfstEpsilonCycleIndex
+     {
+     protected:
+       HfstBasicTransducer & fsm;
+       /* Whether a cycle of input epsilons and flags can be reached from
+          each state along such transitions. */
+       std::vector<bool> reaches_cycle;
+       /* Per state marks of the walk, set when equal to mark */
+       std::vector<unsigned int> marks;
+       unsigned int mark;
+
+       void next_mark();
+
+       bool is_epsilon_like(const std::string & symbol) const;
+       bool consumes(const std::string & symbol, const std::string & input,
+                     bool obey_flags) const;
+
+     public:
+       /** @brief Index the input epsilon cycles of \a t. */
+       HFSTDLL HfstEpsilonCycleIndex(HfstBasicTransducer & t);
+
+       /** @brief Whether lookup of \a s in the indexed transducer can
+           have infinitely many results.
+
+           This gives the same answer as
+           HfstBasicTransducer::is_lookup_infinitely_ambiguous. When
+           \a obey_flags is true and the walk finds a cycle, the cycle is
+           confirmed with that function, as only a path through the
+           transducer can tell whether the flags on the cycle are
+           valid.
+
+           The walk keeps its state in the index, so one index must not
+           be used by several threads at a time. */
+       HFSTDLL bool is_lookup_infinitely_ambiguous
+         (const StringVector & s, bool obey_flags=false);
+     };
      
    }
    
@@ -0,0 +1,302 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#include "HfstMinimalAcyclicBuilder.h"
+
+#include <algorithm>
+#include <functional>
+#include <set>
+
+namespace hfst {
+
+  namespace implementations {
+
+    static inline void hash_combine(size_t & seed, size_t value)
+    {
+      seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    size_t HfstMinimalAcyclicBuilder::NodeHash::operator()(HfstState s) const
+    {
+      const Node & node = (*nodes)[s];
+      size_t seed = node.final ? 1 : 0;
+      if (node.final)
+        hash_combine(seed, std::hash<float>()(node.weight));
+      for (ArcVector::const_iterator it = node.arcs.begin();
+           it != node.arcs.end(); it++)
+        {
+          hash_combine(seed, it->input);
+          hash_combine(seed, it->output);
+          hash_combine(seed, it->target);
+        }
+      return seed;
+    }
+
+    bool HfstMinimalAcyclicBuilder::NodeEqual::operator()
+      (HfstState s1, HfstState s2) const
+    {
+      const Node & n1 = (*nodes)[s1];
+      const Node & n2 = (*nodes)[s2];
+      if (n1.final != n2.final)
+        return false;
+      if (n1.final && n1.weight != n2.weight)
+        return false;
+      if (n1.arcs.size() != n2.arcs.size())
+        return false;
+      for (size_t i = 0; i < n1.arcs.size(); i++)
+        {
+          if (n1.arcs[i].input != n2.arcs[i].input ||
+              n1.arcs[i].output != n2.arcs[i].output ||
+              n1.arcs[i].target != n2.arcs[i].target)
+            return false;
+        }
+      return true;
+    }
+
+    HfstMinimalAcyclicBuilder::HfstMinimalAcyclicBuilder():
+      state_register(0, NodeHash(&nodes), NodeEqual(&nodes))
+    {
+      path.push_back(new_node());
+    }
+
+    HfstState HfstMinimalAcyclicBuilder::new_node()
+    {
+      HfstState s;
+      if (free_nodes.empty())
+        {
+          s = (HfstState)nodes.size();
+          nodes.push_back(Node());
+        }
+      else
+        {
+          s = free_nodes.back();
+          free_nodes.pop_back();
+        }
+      Node & node = nodes[s];
+      node.final = false;
+      node.weight = 0;
+      node.in_degree = 0;
+      node.arcs.clear();
+      return s;
+    }
+
+    /* Free state \a s. Nothing may lead to \a s any more. */
+    void HfstMinimalAcyclicBuilder::delete_node(HfstState s)
+    {
+      Node & node = nodes[s];
+      for (ArcVector::const_iterator it = node.arcs.begin();
+           it != node.arcs.end(); it++)
+        {
+          nodes[it->target].in_degree--;
+        }
+      node.arcs.clear();
+      free_nodes.push_back(s);
+    }
+
+    /* A copy of state \a s that nothing leads to yet. */
+    HfstState HfstMinimalAcyclicBuilder::clone_node(HfstState s)
+    {
+      HfstState c = new_node();
+      nodes[c].final = nodes[s].final;
+      nodes[c].weight = nodes[s].weight;
+      nodes[c].arcs = nodes[s].arcs;
+      for (ArcVector::const_iterator it = nodes[c].arcs.begin();
+           it != nodes[c].arcs.end(); it++)
+        {
+          nodes[it->target].in_degree++;
+        }
+      return c;
+    }
+
+    /* The arc of state \a s with the given symbols or the position where
+       such an arc would be inserted. */
+    HfstMinimalAcyclicBuilder::ArcVector::iterator
+    HfstMinimalAcyclicBuilder::find_arc(HfstState s, unsigned int input,
+                                        unsigned int output)
+    {
+      Arc key;
+      key.input = input;
+      key.output = output;
+      key.target = 0;
+      return std::lower_bound(nodes[s].arcs.begin(), nodes[s].arcs.end(),
+                              key);
+    }
+
+    /* Redirect the arc of state \a s with the given symbols to
+       \a target. The arc must exist and \a s must not be registered. */
+    void HfstMinimalAcyclicBuilder::set_target
+    (HfstState s, unsigned int input, unsigned int output, HfstState target)
+    {
+      ArcVector::iterator it = find_arc(s, input, output);
+      nodes[it->target].in_degree--;
+      it->target = target;
+      nodes[target].in_degree++;
+    }
+
+    /* Minimize the states on the path of the last string that are deeper
+       than \a depth, starting from the deepest one. Each state is either
+       replaced by an equivalent registered state or registered itself.
+       The path is truncated to \a depth. */
+    void HfstMinimalAcyclicBuilder::replace_or_register(size_t depth)
+    {
+      while (path.size() - 1 > depth)
+        {
+          HfstState s = path.back();
+          path.pop_back();
+          Arc label = last_string.back();
+          last_string.pop_back();
+
+          std::pair<Register::iterator, bool> result
+            = state_register.insert(s);
+          if (! result.second)
+            {
+              set_target(path.back(), label.input, label.output,
+                         *result.first);
+              delete_node(s);
+            }
+        }
+    }
+
+    void HfstMinimalAcyclicBuilder::add
+    (const StringPairVector &spv, float weight)
+    {
+      std::vector<Arc> symbols;
+      symbols.reserve(spv.size());
+      for (StringPairVector::const_iterator it = spv.begin();
+           it != spv.end(); it++)
+        {
+          Arc arc;
+          arc.input = HfstTropicalTransducerTransitionData::get_number
+            (it->first);
+          arc.output = HfstTropicalTransducerTransitionData::get_number
+            (it->second);
+          arc.target = 0;
+          symbols.push_back(arc);
+        }
+
+      // The prefix shared with the last string is still unregistered,
+      // the rest of the last path can be minimized now
+      size_t prefix = 0;
+      while (prefix < symbols.size() && prefix < last_string.size() &&
+             symbols[prefix].input == last_string[prefix].input &&
+             symbols[prefix].output == last_string[prefix].output)
+        {
+          prefix++;
+        }
+      replace_or_register(prefix);
+
+      // If strings with a common prefix are not adjacent, the path may
+      // continue in registered states. Take them out of the register
+      // before they are changed, cloning those that are shared.
+      HfstState s = path.back();
+      while (prefix < symbols.size())
+        {
+          ArcVector::iterator it
+            = find_arc(s, symbols[prefix].input, symbols[prefix].output);
+          if (it == nodes[s].arcs.end() ||
+              it->input != symbols[prefix].input ||
+              it->output != symbols[prefix].output)
+            break;
+          HfstState next = it->target;
+          if (nodes[next].in_degree > 1)
+            {
+              next = clone_node(next);
+              set_target(s, symbols[prefix].input, symbols[prefix].output,
+                         next);
+            }
+          else
+            {
+              state_register.erase(next);
+            }
+          path.push_back(next);
+          last_string.push_back(symbols[prefix]);
+          s = next;
+          prefix++;
+        }
+
+      // Add the rest of the string as new states
+      while (prefix < symbols.size())
+        {
+          HfstState next = new_node();
+          Arc arc = symbols[prefix];
+          arc.target = next;
+          nodes[s].arcs.insert
+            (find_arc(s, arc.input, arc.output), arc);
+          nodes[next].in_degree = 1;
+          path.push_back(next);
+          last_string.push_back(symbols[prefix]);
+          s = next;
+          prefix++;
+        }
+
+      // The same string with a smaller weight remains
+      Node & final_node = nodes[s];
+      if (! final_node.final || weight < final_node.weight)
+        {
+          final_node.final = true;
+          final_node.weight = weight;
+        }
+    }
+
+    size_t HfstMinimalAcyclicBuilder::size() const
+    {
+      return nodes.size() - free_nodes.size();
+    }
+
+    void HfstMinimalAcyclicBuilder::finish(HfstBasicTransducer &t)
+    {
+      replace_or_register(0);
+      HfstState start = path.back();
+
+      // Number the states breadth first from the start state
+      const HfstState NO_STATE = (HfstState)-1;
+      std::vector<HfstState> numbers(nodes.size(), NO_STATE);
+      std::vector<HfstState> agenda;
+      std::set<unsigned int> alphabet;
+      numbers[start] = 0;
+      agenda.push_back(start);
+      for (size_t i = 0; i < agenda.size(); i++)
+        {
+          const Node & node = nodes[agenda[i]];
+          HfstState origin = numbers[agenda[i]];
+          t.add_state(origin);
+          for (ArcVector::const_iterator it = node.arcs.begin();
+               it != node.arcs.end(); it++)
+            {
+              if (numbers[it->target] == NO_STATE)
+                {
+                  numbers[it->target] = (HfstState)agenda.size();
+                  agenda.push_back(it->target);
+                }
+              t.add_transition(origin, HfstBasicTransition
+                               (numbers[it->target], it->input, it->output,
+                                0, true), false);
+              alphabet.insert(it->input);
+              alphabet.insert(it->output);
+            }
+          if (node.final)
+            t.set_final_weight(origin, node.weight);
+        }
+      for (std::set<unsigned int>::const_iterator it = alphabet.begin();
+           it != alphabet.end(); it++)
+        {
+          t.add_symbol_to_alphabet
+            (HfstTropicalTransducerTransitionData::get_symbol(*it));
+        }
+
+      state_register.clear();
+      nodes.clear();
+      free_nodes.clear();
+      last_string.clear();
+      path.clear();
+      path.push_back(new_node());
+    }
+
+  }
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#ifndef _HFST_MINIMAL_ACYCLIC_BUILDER_H_
+#define _HFST_MINIMAL_ACYCLIC_BUILDER_H_
+
+/** @file HfstMinimalAcyclicBuilder.h
+    @brief Class HfstMinimalAcyclicBuilder */
+
+#include <vector>
+#include <unordered_set>
+
+#include "../HfstDataTypes.h"
+#include "HfstBasicTransducer.h"
+
+#include "../hfstdll.h"
+
+namespace hfst {
+
+  namespace implementations {
+
+    /** @brief Incremental construction of a minimal acyclic transducer
+        from a list of string pairs.
+
+        Strings are added one at a time and the part of the transducer
+        that no later string can change is minimized right away, so the
+        result is never bigger than the minimal transducer plus the path
+        of the last string (Daciuk et al. 2000). Input where strings with
+        a common prefix are adjacent, e.g. a sorted word list, costs
+        nothing extra. Other input is handled by cloning the states
+        shared with other strings before a path is changed.
+
+        The weight of a string is kept in its final state. If the same
+        string is added more than once, the smallest weight is kept, as
+        in HfstBasicTransducer::disjunct.
+
+        \verbatim
+        HfstMinimalAcyclicBuilder builder;
+        HfstTokenizer TOK;
+        builder.add(TOK.tokenize("cat"), 0.5);
+        builder.add(TOK.tokenize("cats"), 0.5);
+        builder.add(TOK.tokenize("dog"), 0.3);
+        HfstBasicTransducer lexicon;
+        builder.finish(lexicon);
+        \endverbatim
+    */
+    class HfstMinimalAcyclicBuilder
+    {
+    protected:
+      struct Arc
+      {
+        unsigned int input;
+        unsigned int output;
+        HfstState target;
+        bool operator<(const Arc &another) const
+        {
+          if (input != another.input)
+            return input < another.input;
+          return output < another.output;
+        }
+      };
+      typedef std::vector<Arc> ArcVector;
+
+      struct Node
+      {
+        bool final;
+        float weight;
+        unsigned int in_degree;
+        ArcVector arcs; // sorted by input and output number
+      };
+
+      // Hash and equality of states by their right language
+      struct NodeHash
+      {
+        const std::vector<Node> * nodes;
+        NodeHash(const std::vector<Node> * n): nodes(n) {}
+        size_t operator()(HfstState s) const;
+      };
+      struct NodeEqual
+      {
+        const std::vector<Node> * nodes;
+        NodeEqual(const std::vector<Node> * n): nodes(n) {}
+        bool operator()(HfstState s1, HfstState s2) const;
+      };
+      typedef std::unordered_set<HfstState, NodeHash, NodeEqual> Register;
+
+      std::vector<Node> nodes;
+      std::vector<HfstState> free_nodes;
+      Register state_register;
+
+      // The symbol numbers of the last string added and the states on
+      // its path. path[0] is the start state. The states on the path
+      // are not in the register.
+      std::vector<Arc> last_string;
+      std::vector<HfstState> path;
+
+      HfstState new_node();
+      void delete_node(HfstState s);
+      HfstState clone_node(HfstState s);
+      ArcVector::iterator find_arc(HfstState s, unsigned int input,
+                                   unsigned int output);
+      void set_target(HfstState s, unsigned int input, unsigned int output,
+                      HfstState target);
+      void replace_or_register(size_t depth);
+
+    public:
+      /** @brief Create a builder with an empty transducer. */
+      HFSTDLL HfstMinimalAcyclicBuilder();
+
+      /** @brief Add the path \a spv with final weight \a weight. */
+      HFSTDLL void add(const StringPairVector &spv, float weight);
+
+      /** @brief Minimize what is left and copy the result to \a t.
+
+          \a t should be empty. The builder is empty afterwards. */
+      HFSTDLL void finish(HfstBasicTransducer &t);
+
+      /** @brief The number of states currently in use. */
+      HFSTDLL size_t size() const;
+    };
+
+  }
+}
+
+#endif // _HFST_MINIMAL_ACYCLIC_BUILDER_H_
@@ -14,18 +14,19 @@
 namespace hfst { namespace implementations
 {
   HfstOlInputStream::HfstOlInputStream(bool weighted):
-    i_stream(),input_stream(std::cin), weighted(weighted)
+    i_stream(),input_stream(std::cin), weighted(weighted),
+    memory_mapped(false)
   {}
   HfstOlInputStream::HfstOlInputStream
   (const std::string &filename, bool weighted):
     filename(std::string(filename)),
     i_stream(filename.c_str(), std::ios::in | std::ios::binary),
-    input_stream(i_stream),weighted(weighted)
+    input_stream(i_stream),weighted(weighted), memory_mapped(false)
   {}
 
   HfstOlInputStream::HfstOlInputStream
   (std::istream &is, bool weighted):
-    input_stream(is),weighted(weighted)
+    input_stream(is),weighted(weighted), memory_mapped(false)
   {}
 
   /* Skip the identifier string "HFST_OL_TYPE" or "HFST_OLW_TYPE" */
@@ -72,6 +73,9 @@ namespace hfst { namespace implementations
       { return input_stream.good(); }
   }
   
+  void HfstOlInputStream::set_memory_mapping(bool value)
+  { memory_mapped = value; }
+
   bool HfstOlInputStream::is_fst(void) const
   {
     return (is_fst(input_stream)!=0);
@@ -166,7 +170,9 @@ void HfstOlInputStream::ignore(unsigned int n)
       if (has_header)
         skip_hfst_header();
 
-      hfst_ol::Transducer* t = new hfst_ol::Transducer(input_stream);
+      hfst_ol::Transducer* t = (memory_mapped && !filename.empty()) ?
+        new hfst_ol::Transducer(input_stream, filename) :
+        new hfst_ol::Transducer(input_stream);
       //t->display();
       return t;
     }
@@ -37,6 +37,7 @@ namespace hfst { namespace implementations
     ifstream i_stream;
     istream &input_stream;
     bool weighted;
+    bool memory_mapped;
     void skip_identifier_version_3_0(void);
     void skip_hfst_header(void);
   public:
@@ -50,6 +51,10 @@ namespace hfst { namespace implementations
     bool is_bad(void) const;
     bool is_good(void) const;
     bool is_fst(void) const;
+    /* Serve the tables of transducers read from a file from a memory map
+       of the file instead of copying them. Has no effect on streams that
+       were not opened from a file. */
+    void set_memory_mapping(bool value);
 
     char stream_get();
     short stream_get_short();
@@ -765,12 +765,12 @@
              final_weight_map[s1] = s2_it->second;
              final_weight_map[s2] = s1_weight;
            }
-           if (s1_it != end_it) {
+           else if (s1_it != end_it) {
              typename C::WeightType w = s1_it->second;
              final_weight_map.erase(s1);
              final_weight_map[s2] = w;
            }
-           if (s2_it != end_it) {
+           else if (s2_it != end_it) {
              typename C::WeightType w = s2_it->second;
              final_weight_map.erase(s2);
              final_weight_map[s1] = w;
@@ -15,6 +15,7 @@
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <functional>
 #include "../HfstExceptionDefs.h"
 
 #include "../hfstdll.h"
@@ -38,18 +39,162 @@ namespace hfst {
         return SymbolType("@_IDENTITY_SYMBOL_@");
       }
 
-    HfstTropicalTransducerTransitionData::Number2SymbolVector
-    HfstTropicalTransducerTransitionData::number2symbol_map;
-    Number2SymbolVectorInitializer
-    dummy1(HfstTropicalTransducerTransitionData::number2symbol_map);
-    HfstTropicalTransducerTransitionData::Symbol2NumberMap
-    HfstTropicalTransducerTransitionData::symbol2number_map;
-    Symbol2NumberMapInitializer
-    dummy2(HfstTropicalTransducerTransitionData::symbol2number_map);
-    unsigned int HfstTropicalTransducerTransitionData::max_number=2;
+    HfstSymbolInterner::HfstSymbolInterner(): count(0)
+    {
+      for (unsigned int i = 0; i < MAX_CHUNKS; i++)
+        chunks[i].store(NULL, std::memory_order_relaxed);
+      table.store(new_table(256), std::memory_order_relaxed);
+      get_number("@_EPSILON_SYMBOL_@");
+      get_number("@_UNKNOWN_SYMBOL_@");
+      get_number("@_IDENTITY_SYMBOL_@");
+    }
+
+    HfstSymbolInterner::~HfstSymbolInterner()
+    {
+      for (unsigned int i = 0; i < MAX_CHUNKS; i++)
+        delete[] chunks[i].load(std::memory_order_relaxed);
+      delete_table(table.load(std::memory_order_relaxed));
+      for (std::vector<HashTable *>::iterator it = old_tables.begin();
+           it != old_tables.end(); it++)
+        delete_table(*it);
+    }
+
+    size_t HfstSymbolInterner::hash(const std::string &symbol)
+    {
+      return std::hash<std::string>()(symbol);
+    }
+
+    /* Chunk i holds FIRST_CHUNK_SIZE << i symbols. */
+    void HfstSymbolInterner::chunk_position
+    (unsigned int number, unsigned int &chunk, unsigned int &offset)
+    {
+      unsigned long long v = number / FIRST_CHUNK_SIZE + 1;
+      chunk = 0;
+      while (v > 1)
+        {
+          v >>= 1;
+          chunk++;
+        }
+      offset = number - FIRST_CHUNK_SIZE * ((1u << chunk) - 1);
+    }
+
+    HfstSymbolInterner::HashTable * HfstSymbolInterner::new_table(size_t size)
+    {
+      HashTable * t = new HashTable();
+      t->mask = size - 1;
+      t->slots = new std::atomic<unsigned long long>[size];
+      for (size_t i = 0; i < size; i++)
+        t->slots[i].store(0, std::memory_order_relaxed);
+      return t;
+    }
+
+    void HfstSymbolInterner::delete_table(HashTable * t)
+    {
+      delete[] t->slots;
+      delete t;
+    }
+
+    void HfstSymbolInterner::insert(HashTable * t, unsigned long long slot)
+    {
+      size_t i = (size_t)(slot >> 32) & t->mask;
+      while (t->slots[i].load(std::memory_order_relaxed) != 0)
+        i = (i + 1) & t->mask;
+      t->slots[i].store(slot, std::memory_order_release);
+    }
+
+    const std::string &HfstSymbolInterner::get_symbol(unsigned int number) const
+    {
+      unsigned int chunk, offset;
+      chunk_position(number, chunk, offset);
+      return chunks[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    long long HfstSymbolInterner::find(const std::string &symbol, size_t h) const
+    {
+      const HashTable * t = table.load(std::memory_order_acquire);
+      unsigned long long tag = (unsigned long long)(h & 0xffffffff) << 32;
+      size_t i = h & 0xffffffff & t->mask;
+      while (true)
+        {
+          unsigned long long slot
+            = t->slots[i].load(std::memory_order_acquire);
+          if (slot == 0)
+            return -1;
+          if ((slot & 0xffffffff00000000ULL) == tag)
+            {
+              unsigned int number = (unsigned int)(slot & 0xffffffff) - 1;
+              if (get_symbol(number) == symbol)
+                return number;
+            }
+          i = (i + 1) & t->mask;
+        }
+    }
+
+    unsigned int HfstSymbolInterner::add(const std::string &symbol, size_t h)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      // Another thread may have added it
+      long long found = find(symbol, h);
+      if (found >= 0)
+        return (unsigned int)found;
+
+      unsigned int number = count.load(std::memory_order_relaxed);
+      unsigned int chunk, offset;
+      chunk_position(number, chunk, offset);
+      if (chunk >= MAX_CHUNKS)
+        HFST_THROW_MESSAGE(HfstFatalException,
+                           "HfstSymbolInterner: too many symbols");
+      std::string * symbols = chunks[chunk].load(std::memory_order_relaxed);
+      if (symbols == NULL)
+        {
+          symbols = new std::string[FIRST_CHUNK_SIZE << chunk];
+          chunks[chunk].store(symbols, std::memory_order_release);
+        }
+      symbols[offset] = symbol;
+      // The symbol must be visible before anything refers to its number
+      count.store(number + 1, std::memory_order_release);
+
+      unsigned long long slot
+        = ((unsigned long long)(h & 0xffffffff) << 32) | (number + 1);
+      HashTable * t = table.load(std::memory_order_relaxed);
+      if (2 * (number + 1) > t->mask + 1)
+        {
+          HashTable * bigger = new_table(2 * (t->mask + 1));
+          for (size_t i = 0; i <= t->mask; i++)
+            {
+              unsigned long long old_slot
+                = t->slots[i].load(std::memory_order_relaxed);
+              if (old_slot != 0)
+                insert(bigger, old_slot);
+            }
+          insert(bigger, slot);
+          table.store(bigger, std::memory_order_release);
+          old_tables.push_back(t);
+        }
+      else
+        {
+          insert(t, slot);
+        }
+      return number;
+    }
+
+    unsigned int HfstSymbolInterner::get_number(const std::string &symbol)
+    {
+      size_t h = hash(symbol);
+      long long found = find(symbol, h);
+      if (found >= 0)
+        return (unsigned int)found;
+      return add(symbol, h);
+    }
+
+    HfstSymbolInterner &HfstTropicalTransducerTransitionData::symbol_interner()
+    {
+      static HfstSymbolInterner interner;
+      return interner;
+    }
 
     unsigned int HfstTropicalTransducerTransitionData::get_max_number() {
-      return max_number;
+      return symbol_interner().size() - 1;
     }
 
     std::vector<unsigned int> HfstTropicalTransducerTransitionData::get_harmonization_vector
@@ -70,6 +215,7 @@ namespace hfst {
         (const std::map<HfstTropicalTransducerTransitionData::SymbolType, unsigned int> &symbols)
       {
         std::vector<unsigned int> harmv;
+        unsigned int max_number = get_max_number();
         harmv.reserve(max_number+1);
         harmv.resize(max_number+1, 0);
         for (unsigned int i=0; i<harmv.size(); i++)
@@ -84,7 +230,8 @@ namespace hfst {
 
       const std::string & HfstTropicalTransducerTransitionData::get_symbol(unsigned int number)
       {
-        if (number >= number2symbol_map.size()) {
+        HfstSymbolInterner &interner = symbol_interner();
+        if (number >= interner.size()) {
           std::string message("HfstTropicalTransducerTransitionData: "
                               "number ");
           std::ostringstream oss;
@@ -94,33 +241,17 @@ namespace hfst {
           HFST_THROW_MESSAGE
             (HfstFatalException, message);
         }
-        return number2symbol_map[number];
+        return interner.get_symbol(number);
       }
 
       unsigned int HfstTropicalTransducerTransitionData::get_number(const std::string &symbol)
       {
         if(symbol.empty()) { // FAIL
-          Symbol2NumberMap::iterator it = symbol2number_map.find(symbol);
-          if (it == symbol2number_map.end()) {
-            std::cerr << "ERROR: No number for the empty symbol\n"
-                      << std::endl;
-          }
-          else {
-            std::cerr << "ERROR: The empty symbol corresdponds to number "
-                      << it->second << std::endl;
-          }
+          std::cerr << "ERROR: No number for the empty symbol\n"
+                    << std::endl;
           assert(false);
         }
-
-        Symbol2NumberMap::iterator it = symbol2number_map.find(symbol);
-        if (it == symbol2number_map.end())
-          {
-            max_number++;
-            symbol2number_map[symbol] = max_number;
-            number2symbol_map.push_back(symbol);
-            return max_number;
-          }
-        return it->second;
+        return symbol_interner().get_number(symbol);
       }
 
 
@@ -249,20 +380,6 @@ namespace hfst {
       weight = another.weight;
     }
 
-    Number2SymbolVectorInitializer::Number2SymbolVectorInitializer
-    (HfstTropicalTransducerTransitionData::Number2SymbolVector &vect) {
-      vect.push_back(std::string("@_EPSILON_SYMBOL_@"));
-      vect.push_back(std::string("@_UNKNOWN_SYMBOL_@"));
-      vect.push_back(std::string("@_IDENTITY_SYMBOL_@"));
-    }
-
-    Symbol2NumberMapInitializer::Symbol2NumberMapInitializer
-    (HfstTropicalTransducerTransitionData::Symbol2NumberMap &map) {
-      map["@_EPSILON_SYMBOL_@"] = 0;
-      map["@_UNKNOWN_SYMBOL_@"] = 1;
-      map["@_IDENTITY_SYMBOL_@"] = 2;
-    }
-
   } // namespace implementations
 
 } // namespace hfst
@@ -19,6 +19,8 @@
 #include <cstdio>
 #include <iosfwd>
 #include <vector>
+#include <atomic>
+#include <mutex>
 #include "../HfstExceptionDefs.h"
 
 #include "../hfstdll.h"
@@ -33,6 +35,65 @@ namespace hfst {
       }
     };
     
+    /* A two-way mapping between symbols and numbers that can be shared
+       by threads.
+
+       Numbers are given in the order the symbols are first seen and never
+       change. Finding the symbol of a number or the number of a symbol
+       that is already known takes no locks. Adding a new symbol takes a
+       mutex.
+
+       Symbols are stored in chunks that double in size and are never
+       moved, so a reference to a symbol stays valid. The symbol-to-number
+       index is an open-addressing hash table. When it grows, the old
+       table is kept until the interner is destroyed, because other
+       threads may still be reading it. */
+    class HfstSymbolInterner {
+    public:
+      HFSTDLL HfstSymbolInterner();
+      HFSTDLL ~HfstSymbolInterner();
+
+      /* The number of \a symbol, adding it if needed. */
+      HFSTDLL unsigned int get_number(const std::string &symbol);
+
+      /* The symbol of \a number. \a number must be less than size(). */
+      HFSTDLL const std::string &get_symbol(unsigned int number) const;
+
+      /* How many symbols have a number. */
+      unsigned int size() const
+      { return count.load(std::memory_order_acquire); }
+
+    private:
+      static const unsigned int FIRST_CHUNK_SIZE = 64;
+      static const unsigned int MAX_CHUNKS = 26;
+
+      struct HashTable {
+        size_t mask;
+        // zero or (hash << 32 | (number + 1))
+        std::atomic<unsigned long long> * slots;
+      };
+
+      std::atomic<std::string *> chunks[MAX_CHUNKS];
+      std::atomic<unsigned int> count;
+      std::atomic<HashTable *> table;
+      std::vector<HashTable *> old_tables;
+      std::mutex mutex;
+
+      static size_t hash(const std::string &symbol);
+      static void chunk_position(unsigned int number,
+                                 unsigned int &chunk, unsigned int &offset);
+      static HashTable * new_table(size_t size);
+      static void delete_table(HashTable * t);
+      static void insert(HashTable * t, unsigned long long slot);
+
+      // The number of \a symbol or -1 if it has none
+      long long find(const std::string &symbol, size_t h) const;
+      unsigned int add(const std::string &symbol, size_t h);
+
+      HfstSymbolInterner(const HfstSymbolInterner &);
+      HfstSymbolInterner &operator=(const HfstSymbolInterner &);
+    };
+
     /** @brief One implementation of template class C in
         HfstTransition.
         
@@ -43,8 +104,8 @@ namespace hfst {
         \internal Actually a HfstTropicalTransducerTransitionData has an
         input and an output number of type unsigned int, but this
         implementation is hidden from the user.
-        The class has two static maps and functions that take care of conversion
-        between strings and internal numbers.
+        The class has a static HfstSymbolInterner and functions that take
+        care of conversion between strings and internal numbers.
         
         @see HfstTransition HfstBasicTransition */
     class HfstTropicalTransducerTransitionData {
@@ -55,23 +116,15 @@ namespace hfst {
       typedef float WeightType;
       /** @brief A set of symbols. */
       typedef std::set<SymbolType> SymbolTypeSet;
-      
-      typedef std::vector<SymbolType>
-        Number2SymbolVector;
-      typedef std::map<SymbolType, unsigned int, string_comparison>
-        Symbol2NumberMap;
 
       HFSTDLL static SymbolType get_epsilon();
       HFSTDLL static SymbolType get_unknown();
       HFSTDLL static SymbolType get_identity();
       
     public: /* FIXME: Should be private. */
-      /* Maps that contain information of the mappings between strings
-         and numbers */
-      HFSTDLL static Number2SymbolVector number2symbol_map;
-      HFSTDLL static Symbol2NumberMap symbol2number_map;
-      /* The biggest number in use. */
-      HFSTDLL static unsigned int max_number;
+      /* The mapping between strings and numbers, shared by all
+         transducers and threads */
+      HFSTDLL static HfstSymbolInterner &symbol_interner();
 
       /* Get the biggest number used to represent a symbol. */
       HFSTDLL static unsigned int get_max_number();
@@ -178,31 +231,15 @@ namespace hfst {
       HFSTDLL bool less_than_ignore_weight(const HfstTropicalTransducerTransitionData &another) const;
       HFSTDLL void operator=(const HfstTropicalTransducerTransitionData &another);
       
-      friend class Number2SymbolVectorInitializer;
-      friend class Symbol2NumberMapInitializer;
-
       friend class ComposeIntersectFst;
       friend class ComposeIntersectLexicon;
       friend class ComposeIntersectRule;
       friend class ComposeIntersectRulePair;
       friend class HfstBasicTransducer;
+      friend class HfstMinimalAcyclicBuilder;
 
     };
 
-    // Initialization of static members in class
-    // HfstTropicalTransducerTransitionData..
-    class Number2SymbolVectorInitializer {
-    public:
-      HFSTDLL Number2SymbolVectorInitializer
-        (HfstTropicalTransducerTransitionData::Number2SymbolVector &vect);
-    };
-
-    class Symbol2NumberMapInitializer {
-    public:
-      HFSTDLL Symbol2NumberMapInitializer
-        (HfstTropicalTransducerTransitionData::Symbol2NumberMap &map);
-    };
-
   } // namespace implementations
 
 } // namespace hfst
@@ -8,6 +8,7 @@
 // information.
 
 #include "convert.h"
+#include <bitset>
 
 #ifdef _MSC_VER
 #include "back-ends/openfstwin/src/include/fst/fstlib.h"
@@ -133,6 +134,87 @@ bool compare_states_by_state_number(
     return lhs.state_number < rhs.state_number;
 }
 
+// The number of set bits in \a word
+static unsigned int count_bits(IndexPlaceholders::Word word)
+{
+    return hfst::size_t_to_uint(
+        std::bitset<IndexPlaceholders::WORD_BITS>(word).count());
+}
+
+unsigned int IndexPlaceholders::count_used(unsigned int position,
+                                           unsigned int count) const
+{
+    unsigned int filled = 0;
+    while (count >= WORD_BITS) {
+        filled += count_bits(window(position));
+        position += WORD_BITS;
+        count -= WORD_BITS;
+    }
+    if (count != 0) {
+        filled += count_bits(window(position) & ((Word(1) << count) - 1));
+    }
+    return filled;
+}
+
+std::vector<unsigned int> IndexPlaceholders::entry_offsets(
+    StatePlaceholder const & state,
+    std::set<SymbolNumber> const & flag_symbols)
+{
+    std::vector<unsigned int> offsets(1, 0);
+    for (std::vector<std::vector<TransitionPlaceholder> >::const_iterator it =
+             state.transition_placeholders.begin();
+         it != state.transition_placeholders.end(); ++it) {
+        SymbolNumber index_offset = it->at(0).input;
+        if (flag_symbols.count(index_offset) != 0) {
+            index_offset = 0;
+        }
+        offsets.push_back(index_offset + 1);
+    }
+    return offsets;
+}
+
+unsigned int IndexPlaceholders::first_fit(
+    std::vector<unsigned int> const & offsets,
+    unsigned int position) const
+{
+    // Bit n of candidates stands for starting at position + n. Each offset
+    // rules out the candidates that would put an entry on a used position,
+    // so a fully used stretch of the table costs one pass per 64 positions.
+    while (true) {
+        Word candidates = ~Word(0);
+        for (std::vector<unsigned int>::const_iterator it = offsets.begin();
+             it != offsets.end() && candidates != 0; ++it) {
+            candidates &= ~window(position + *it);
+        }
+        if (candidates != 0) {
+            // the lowest remaining candidate
+            return position + count_bits((candidates & (0 - candidates)) - 1);
+        }
+        position += WORD_BITS;
+    }
+}
+
+unsigned int IndexPlaceholders::first_suitable(
+    unsigned int index,
+    SymbolNumber const symbols,
+    float const packing_aggression) const
+{
+    if (symbols == 0) {
+        while (used(index)) {
+            ++index;
+        }
+        return index;
+    }
+    // filled slides along with index instead of being recounted
+    unsigned int filled = count_used(index + 1, symbols);
+    while (used(index) || filled >= (packing_aggression*symbols)) {
+        filled -= used(index + 1);
+        filled += used(index + symbols + 1);
+        ++index;
+    }
+    return index;
+}
+
 #if HAVE_OPENFST
 
 bool check_finality(TransduceR * tr, StateId s)
@@ -197,76 +197,72 @@ bool compare_states_by_input_size(
 bool compare_states_by_state_number(
     const StatePlaceholder & lhs, const StatePlaceholder & rhs);
 
+/* The index table under construction. Alongside the entries a bitset of
+   the used positions is kept, so that a starting index can be searched for
+   64 candidate positions at a time. */
 struct IndexPlaceholders
 {
+    typedef unsigned long long Word;
+    static const unsigned int WORD_BITS = 64;
+
     std::vector<unsigned int> indices;
     std::vector<std::pair<unsigned int, SymbolNumber> > targets;
+    std::vector<Word> used_bits;
 
     bool used(unsigned int const position) const
         {
-            return position < indices.size() && indices[position] != NO_TABLE_INDEX;
+            return position / WORD_BITS < used_bits.size() &&
+                ((used_bits[position / WORD_BITS] >> (position % WORD_BITS)) & 1);
         }
 
     void assign(unsigned int const position, unsigned int target, SymbolNumber sym)
         {
-            while (position >= indices.size()) {
-                indices.push_back(NO_TABLE_INDEX);
+            if (position >= indices.size()) {
+                indices.resize(position + 1, NO_TABLE_INDEX);
+                used_bits.resize(position / WORD_BITS + 1, 0);
             }
             indices[position] = hfst::size_t_to_uint(targets.size());
             targets.push_back(std::pair<unsigned int, SymbolNumber>(target, sym));
+            used_bits[position / WORD_BITS] |= Word(1) << (position % WORD_BITS);
         }
 
     std::pair<unsigned int, SymbolNumber> get_target(unsigned int index)
         {
             return targets[indices[index]];
         }
-    
-    bool fits(StatePlaceholder const & state,
-              std::set<SymbolNumber> const & flag_symbols,
-              unsigned int const position) const
+
+    // The used bits of the positions from position to position + 63
+    Word window(unsigned int const position) const
         {
-            if (used(position)) {
-                return false;
+            size_t word = position / WORD_BITS;
+            unsigned int shift = position % WORD_BITS;
+            Word low = word < used_bits.size() ? used_bits[word] : 0;
+            if (shift == 0) {
+                return low;
             }
-            for (std::vector<std::vector<TransitionPlaceholder> >::const_iterator it = state.transition_placeholders.begin();
-                 it != state.transition_placeholders.end(); ++it) {
-                SymbolNumber index_offset = it->at(0).input;
-                if (flag_symbols.count(index_offset) != 0) {
-                    index_offset = 0;
-                }
-                if (used(index_offset + position + 1)) {
-                    return false;
-                }
-            }
-            return true;
+            Word high = word + 1 < used_bits.size() ? used_bits[word + 1] : 0;
+            return (low >> shift) | (high << (WORD_BITS - shift));
         }
 
-    bool unsuitable(unsigned int const index,
-                    SymbolNumber const symbols,
-                    float const packing_aggression) const
-    {
-    if (used(index)) {
-        return true;
-    }
-    
-    // "Perfect packing" (under this strategy)
-/*              for (unsigned int i = 0; i < symbols; ++i) {
-        
-        if (count(index + i) == 0) {
-        return true;
-        }
-        return false;
-        }*/
-
-    unsigned int filled = 0;
-    for (unsigned int i = 0; i < symbols; ++i) {
-        filled += used(index + i + 1);
-        if (filled >= (packing_aggression*symbols)) {
-            return true; // too full
-        }
-    }
-    return false;
-    }
+    unsigned int count_used(unsigned int position, unsigned int count) const;
+
+    /* The offsets from its starting index of the entries \a state needs:
+       0 for the finality marker and one past each input symbol, flag
+       diacritics sharing the place of epsilon. */
+    static std::vector<unsigned int> entry_offsets(
+        StatePlaceholder const & state,
+        std::set<SymbolNumber> const & flag_symbols);
+
+    /* The first starting index at or after \a position at which the
+       entries at \a offsets are all free. */
+    unsigned int first_fit(std::vector<unsigned int> const & offsets,
+                           unsigned int position) const;
+
+    /* The first index at or after \a index which is free and whose next
+       \a symbols entries are less than \a packing_aggression full. */
+    unsigned int first_suitable(unsigned int index,
+                                SymbolNumber const symbols,
+                                float const packing_aggression) const;
 };
 
 
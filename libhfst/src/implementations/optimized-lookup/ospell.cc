@@ -8,6 +8,8 @@
 // information.
 #include "transducer.h"
 
+#include <algorithm>
+
 namespace hfst_ol {
 
 int nByte_utf8(unsigned char c)
@@ -67,85 +69,97 @@ bool InputString::initialize(const Encoder & encoder,
     return true;
 }
 
-TreeNode TreeNode::update_lexicon(SymbolNumber next_symbol,
-                                  TransitionTableIndex next_lexicon,
-                                  Weight weight)
+void Speller::start_search(void)
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
-                    this->input_state,
-                    this->mutator_state,
-                    next_lexicon,
-                    this->flag_state,
-                    this->weight + weight);
+    nodes.clear();
+    free_nodes.clear();
+    flag_states.clear();
+    flag_state_references.clear();
+    free_flag_states.clear();
+    queue = TreeNodeQueue();
+    flag_states.push_back(hfst::FdState<SymbolNumber>(lexicon->get_fd_table()));
+    flag_state_references.push_back(1);
+    nodes.push_back(TreeNode(NO_TREE_NODE, NO_SYMBOL_NUMBER, 0, 0, 0, 0, 0.0));
+    queue.push(QueuedTreeNode(0.0, 0));
 }
 
-TreeNode TreeNode::update_mutator(SymbolNumber next_symbol,
-                                  TransitionTableIndex next_mutator,
-                                  Weight weight)
+void Speller::add_node(TreeNodeIndex parent,
+                       SymbolNumber symbol,
+                       unsigned int input_state,
+                       TransitionTableIndex mutator_state,
+                       TransitionTableIndex lexicon_state,
+                       FlagStateIndex flag_state,
+                       Weight weight)
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
-                    this->input_state,
-                    next_mutator,
-                    this->lexicon_state,
-                    this->flag_state,
-                    this->weight + weight);
+    weight += nodes[parent].weight;
+    TreeNode node(parent, symbol, input_state, mutator_state,
+                  lexicon_state, flag_state, weight);
+    TreeNodeIndex i;
+    if (free_nodes.size() > 0) {
+        i = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[i] = node;
+    } else {
+        i = nodes.size();
+        nodes.push_back(node);
+    }
+    ++nodes[parent].children;
+    ++flag_state_references[flag_state];
+    queue.push(QueuedTreeNode(weight, i));
 }
 
-TreeNode TreeNode::update(SymbolNumber next_symbol,
-                          unsigned int next_input,
-                          TransitionTableIndex next_mutator,
-                          TransitionTableIndex next_lexicon,
-                          Weight weight)
+FlagStateIndex Speller::add_flag_state(
+    const hfst::FdState<SymbolNumber> & state)
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
-                    next_input,
-                    next_mutator,
-                    next_lexicon,
-                    this->flag_state,
-                    this->weight + weight);
+    // unreferenced until a node is added with it
+    if (free_flag_states.size() > 0) {
+        FlagStateIndex i = free_flag_states.back();
+        free_flag_states.pop_back();
+        flag_states[i] = state;
+        return i;
+    }
+    flag_states.push_back(state);
+    flag_state_references.push_back(0);
+    return flag_states.size() - 1;
 }
 
-TreeNode TreeNode::update(SymbolNumber next_symbol,
-                          TransitionTableIndex next_mutator,
-                          TransitionTableIndex next_lexicon,
-                          Weight weight)
+void Speller::release_node(TreeNodeIndex i)
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
-                    this->input_state,
-                    next_mutator,
-                    next_lexicon,
-                    this->flag_state,
-                    this->weight + weight);
+    while (i != NO_TREE_NODE && nodes[i].children == 0) {
+        FlagStateIndex f = nodes[i].flag_state;
+        if (--flag_state_references[f] == 0) {
+            free_flag_states.push_back(f);
+        }
+        free_nodes.push_back(i);
+        i = nodes[i].parent;
+        if (i != NO_TREE_NODE) {
+            --nodes[i].children;
+        }
+    }
 }
 
-void Speller::lexicon_epsilons(void)
+void Speller::lexicon_epsilons(TreeNodeIndex i)
 {
-    if (!lexicon->has_epsilons_or_flags(queue.front().lexicon_state + 1)) {
+    const TreeNode front = nodes[i];
+    if (!lexicon->has_epsilons_or_flags(front.lexicon_state + 1)) {
         return;
     }
-    TransitionTableIndex next = lexicon->next(queue.front().lexicon_state, 0);
+    TransitionTableIndex next = lexicon->next(front.lexicon_state, 0);
     STransition i_s = lexicon->take_epsilons_and_flags(next);
     
     while (i_s.symbol != NO_SYMBOL_NUMBER) {
         if (lexicon->get_transition(next).get_input_symbol() == 0) {
-            queue.push_back(queue.front().update_lexicon(i_s.symbol,
-                                                         i_s.index,
-                                                         i_s.weight));
+            add_node(i, i_s.symbol, front.input_state, front.mutator_state,
+                     i_s.index, front.flag_state, i_s.weight);
         } else {
-            TreeNode front = queue.front();
-            if (front.flag_state.apply_operation(
+            // only a successful flag operation gets its own flag state,
+            // other nodes share the state of their parent
+            hfst::FdState<SymbolNumber> flagged = flag_states[front.flag_state];
+            if (flagged.apply_operation(
                     lexicon->get_transition(next).get_input_symbol())) {
-                queue.push_back(front.update_lexicon(i_s.symbol,
-                                                     i_s.index,
-                                                     i_s.weight));
+                add_node(i, i_s.symbol, front.input_state,
+                         front.mutator_state, i_s.index,
+                         add_flag_state(flagged), i_s.weight);
             }
         }
         ++next;
@@ -153,27 +167,24 @@ void Speller::lexicon_epsilons(void)
     }
 }
 
-void Speller::lexicon_consume(void)
+void Speller::lexicon_consume(TreeNodeIndex i)
 {
-    unsigned int input_state = queue.front().input_state;
+    const TreeNode front = nodes[i];
+    unsigned int input_state = front.input_state;
     if (input_state >= input.len()||
         !lexicon->has_transitions(
-            queue.front().lexicon_state + 1, input[input_state])) {
+            front.lexicon_state + 1, input[input_state])) {
         return;
     }
 
-    TransitionTableIndex next = lexicon->next(queue.front().lexicon_state,
+    TransitionTableIndex next = lexicon->next(front.lexicon_state,
                                               input[input_state]);
     STransition i_s = lexicon->take_non_epsilons(next,
                                                  input[input_state]);
 
     while (i_s.symbol != NO_SYMBOL_NUMBER) {
-        queue.push_back(queue.front().update(
-                            i_s.symbol,
-                            input_state + 1,
-                            queue.front().mutator_state,
-                            i_s.index,
-                            i_s.weight));
+        add_node(i, i_s.symbol, input_state + 1, front.mutator_state,
+                 i_s.index, front.flag_state, i_s.weight);
         
         ++next;
         i_s = lexicon->take_non_epsilons(next, input[input_state]);
@@ -181,40 +192,40 @@ void Speller::lexicon_consume(void)
     
 }
 
-void Speller::mutator_epsilons(void)
+void Speller::mutator_epsilons(TreeNodeIndex i)
 {
-    if (!mutator->has_transitions(queue.front().mutator_state + 1, 0)) {
+    const TreeNode front = nodes[i];
+    if (!mutator->has_transitions(front.mutator_state + 1, 0)) {
         return;
     }
-    TransitionTableIndex next_m = mutator->next(queue.front().mutator_state, 0);
+    TransitionTableIndex next_m = mutator->next(front.mutator_state, 0);
     STransition mutator_i_s = mutator->take_epsilons(next_m);
    
     while (mutator_i_s.symbol != NO_SYMBOL_NUMBER) {
         if (mutator_i_s.symbol == 0) {
-            queue.push_back(queue.front().update_mutator(mutator_i_s.symbol,
-                                                         mutator_i_s.index,
-                                                         mutator_i_s.weight));
+            add_node(i, mutator_i_s.symbol, front.input_state,
+                     mutator_i_s.index, front.lexicon_state,
+                     front.flag_state, mutator_i_s.weight);
         } else {
             if (!lexicon->has_transitions(
-                    queue.front().lexicon_state + 1,
+                    front.lexicon_state + 1,
                     alphabet_translator[mutator_i_s.symbol])) {
                 ++next_m;
                 mutator_i_s = mutator->take_epsilons(next_m);
                 continue;
             }
             TransitionTableIndex next_l = lexicon->next(
-                queue.front().lexicon_state,
+                front.lexicon_state,
                 alphabet_translator[mutator_i_s.symbol]);
             STransition lexicon_i_s = lexicon->take_non_epsilons(
                 next_l,
                 alphabet_translator[mutator_i_s.symbol]);
             
             while (lexicon_i_s.symbol != NO_SYMBOL_NUMBER) {
-                queue.push_back(queue.front().update(
-                                    lexicon_i_s.symbol,
-                                    mutator_i_s.index,
-                                    lexicon_i_s.index,
-                                    lexicon_i_s.weight + mutator_i_s.weight));
+                add_node(i, lexicon_i_s.symbol, front.input_state,
+                         mutator_i_s.index, lexicon_i_s.index,
+                         front.flag_state,
+                         lexicon_i_s.weight + mutator_i_s.weight);
                 ++next_l;
                 lexicon_i_s = lexicon->take_non_epsilons(
                     next_l,
@@ -226,16 +237,17 @@ void Speller::mutator_epsilons(void)
     }
 }
 
-void Speller::consume_input(void)
+void Speller::consume_input(TreeNodeIndex i)
 {
-    unsigned int input_state = queue.front().input_state;
+    const TreeNode front = nodes[i];
+    unsigned int input_state = front.input_state;
     if (input_state >= input.len()||
-        !mutator->has_transitions(queue.front().mutator_state + 1,
+        !mutator->has_transitions(front.mutator_state + 1,
                                   input[input_state])) {
         return; // not enough input to consume of no suitable transitions
     }
     
-    TransitionTableIndex next_m = mutator->next(queue.front().mutator_state,
+    TransitionTableIndex next_m = mutator->next(front.mutator_state,
                                                 input[input_state]);
     
     STransition mutator_i_s = mutator->take_non_epsilons(next_m,
@@ -245,14 +257,12 @@ void Speller::consume_input(void)
 
         if (mutator_i_s.symbol == 0) {
             
-            queue.push_back(queue.front().update(0,
-                                                 input_state + 1,
-                                                 mutator_i_s.index,
-                                                 queue.front().lexicon_state,
-                                                 mutator_i_s.weight));
+            add_node(i, 0, input_state + 1, mutator_i_s.index,
+                     front.lexicon_state, front.flag_state,
+                     mutator_i_s.weight);
         } else {
             if (!lexicon->has_transitions(
-                    queue.front().lexicon_state + 1,
+                    front.lexicon_state + 1,
                     alphabet_translator[mutator_i_s.symbol])) {
                 ++next_m;
                 mutator_i_s = mutator->take_non_epsilons(next_m,
@@ -260,7 +270,7 @@ void Speller::consume_input(void)
                 continue;
             }
             TransitionTableIndex next_l = lexicon->next(
-                queue.front().lexicon_state,
+                front.lexicon_state,
                 alphabet_translator[mutator_i_s.symbol]);
             
             STransition lexicon_i_s = lexicon->take_non_epsilons(
@@ -268,12 +278,10 @@ void Speller::consume_input(void)
                 alphabet_translator[mutator_i_s.symbol]);
             
             while (lexicon_i_s.symbol != NO_SYMBOL_NUMBER) {
-                queue.push_back(
-                    queue.front().update(lexicon_i_s.symbol,
-                                         input_state + 1,
-                                         mutator_i_s.index,
-                                         lexicon_i_s.index,
-                                         lexicon_i_s.weight + mutator_i_s.weight));
+                add_node(i, lexicon_i_s.symbol, input_state + 1,
+                         mutator_i_s.index, lexicon_i_s.index,
+                         front.flag_state,
+                         lexicon_i_s.weight + mutator_i_s.weight);
                 ++next_l;
                 lexicon_i_s = lexicon->take_non_epsilons(
                     next_l,
@@ -287,70 +295,195 @@ void Speller::consume_input(void)
 }
 
 
-CorrectionQueue Speller::correct(char * line)
+CorrectionQueue Speller::search_corrections(char * line, int max_results,
+                                            Weight max_weight, Weight beam)
 {
     // if input initialization fails, return empty correction queue
     if (!init_input(line, mutator->get_encoder(),
                     mutator->get_unknown_symbol())) {
         return CorrectionQueue();
     }
-    std::map<std::string, Weight> corrections;
-    TreeNode start_node(lexicon->get_fd_table());
-    queue.assign(1, start_node);
+    start_search();
+    if (!nonnegative_weights) {
+        return search_all_corrections(max_results, max_weight, beam);
+    }
+    // Nodes come out of the queue in order of weight. A correction is
+    // held back in candidates until no node with a smaller weight is
+    // left, and is then known to be the best one for its string.
+    // This assumes that weights are non-negative.
+    std::set<std::string> corrected;
+    CorrectionQueue candidates;
+    CorrectionQueue correction_queue;
+    Weight limit = max_weight;
 
-    while (queue.size() > 0) {
-        lexicon_epsilons();
-        mutator_epsilons();
-        if (queue.front().input_state == input.len()) {
+    while (queue.size() > 0 || candidates.size() > 0) {
+        while (candidates.size() > 0 &&
+               (queue.size() == 0 ||
+                candidates.top().second <= queue.top().first)) {
+            StringWeightPair correction = candidates.top();
+            candidates.pop();
+            if (limit >= 0.0 && correction.second > limit) {
+                continue;
+            }
+            if (!corrected.insert(correction.first).second) {
+                continue; // a better one has already been given
+            }
+            if (correction_queue.size() == 0 && beam >= 0.0 &&
+                (limit < 0.0 || correction.second + beam < limit)) {
+                limit = correction.second + beam;
+            }
+            correction_queue.push(correction);
+            if (max_results > 0 &&
+                correction_queue.size() >= (size_t)max_results) {
+                return correction_queue;
+            }
+        }
+        if (queue.size() == 0) {
+            break;
+        }
+        TreeNodeIndex i = queue.top().second;
+        queue.pop();
+        if (limit >= 0.0 && nodes[i].weight > limit) {
+            // everything that is left is at least this heavy
+            queue = TreeNodeQueue();
+            continue;
+        }
+        lexicon_epsilons(i);
+        mutator_epsilons(i);
+        const TreeNode & front = nodes[i];
+        if (front.input_state == input.len()) {
             /* if our transducers are in final states
              * we generate the correction
              */
-            if (mutator->final_index(queue.front().mutator_state)&&
-                lexicon->final_index(queue.front().lexicon_state)) {
-                std::string string = stringify(queue.front().string);
-                Weight weight = queue.front().weight +
-                    lexicon->final_weight(queue.front().lexicon_state) +
-                    mutator->final_weight(queue.front().mutator_state);
-                /* if the correction is novel or better than before, insert it
-                 */
+            if (mutator->final_index(front.mutator_state)&&
+                lexicon->final_index(front.lexicon_state)) {
+                Weight weight = front.weight +
+                    lexicon->final_weight(front.lexicon_state) +
+                    mutator->final_weight(front.mutator_state);
+                candidates.push(StringWeightPair(stringify(i), weight));
+            }
+        } else {
+            consume_input(i);
+        }
+        release_node(i);
+    }
+    return correction_queue;
+}
+
+CorrectionQueue Speller::search_all_corrections(int max_results,
+                                                Weight max_weight,
+                                                Weight beam)
+{
+    // With negative weights a node can get lighter as it is expanded,
+    // so nothing is pruned and every string keeps its lightest weight
+    std::map<std::string, Weight> corrections;
+    while (queue.size() > 0) {
+        TreeNodeIndex i = queue.top().second;
+        queue.pop();
+        lexicon_epsilons(i);
+        mutator_epsilons(i);
+        const TreeNode & front = nodes[i];
+        if (front.input_state == input.len()) {
+            if (mutator->final_index(front.mutator_state)&&
+                lexicon->final_index(front.lexicon_state)) {
+                std::string string = stringify(i);
+                Weight weight = front.weight +
+                    lexicon->final_weight(front.lexicon_state) +
+                    mutator->final_weight(front.mutator_state);
                 if (corrections.count(string) == 0||
                     corrections[string] > weight) {
                     corrections[string] = weight;
                 }
             }
         } else {
-            consume_input();
+            consume_input(i);
         }
-        queue.pop_front();
+        release_node(i);
+    }
+    CorrectionQueue sorted;
+    for (std::map<std::string, Weight>::iterator it = corrections.begin();
+         it != corrections.end(); ++it) {
+        sorted.push(StringWeightPair(it->first, it->second));
     }
     CorrectionQueue correction_queue;
-    std::map<std::string, Weight>::iterator it;
-    for (it = corrections.begin(); it != corrections.end(); ++it) {
-        correction_queue.push(StringWeightPair(it->first, it->second));
+    // the beam can take the limit below zero
+    bool limited = max_weight >= 0.0;
+    Weight limit = max_weight;
+    while (sorted.size() > 0) {
+        StringWeightPair correction = sorted.top();
+        sorted.pop();
+        if (limited && correction.second > limit) {
+            break;
+        }
+        if (correction_queue.size() == 0 && beam >= 0.0 &&
+            (!limited || correction.second + beam < limit)) {
+            limit = correction.second + beam;
+            limited = true;
+        }
+        correction_queue.push(correction);
+        if (max_results > 0 &&
+            correction_queue.size() >= (size_t)max_results) {
+            break;
+        }
     }
     return correction_queue;
 }
 
-bool Speller::check(char * line)
+bool Speller::search_lexicon(char * line)
 {
     if (!init_input(line, lexicon->get_encoder(), NO_SYMBOL_NUMBER)) {
         return false;
     }
-    TreeNode start_node(lexicon->get_fd_table());
-    queue.assign(1, start_node);
+    start_search();
 
     while (queue.size() > 0) {
-        if (queue.front().input_state == input.len()&&
-            lexicon->final_index(queue.front().lexicon_state)) {
+        TreeNodeIndex i = queue.top().second;
+        queue.pop();
+        if (nodes[i].input_state == input.len()&&
+            lexicon->final_index(nodes[i].lexicon_state)) {
             return true;
         }
-        lexicon_epsilons();
-        lexicon_consume();
-        queue.pop_front();
+        lexicon_epsilons(i);
+        lexicon_consume(i);
+        release_node(i);
     }
     return false;
 }
 
+void Speller::set_cache(SpellerCache * c)
+{
+    cache = c;
+}
+
+bool Speller::check(char * line)
+{
+    if (cache == NULL) {
+        return search_lexicon(line);
+    }
+    bool result;
+    if (!cache->find_check(lexicon, line, result)) {
+        result = search_lexicon(line);
+        cache->store_check(lexicon, line, result);
+    }
+    return result;
+}
+
+CorrectionQueue Speller::correct(char * line, int max_results,
+                                 Weight max_weight, Weight beam)
+{
+    if (cache == NULL) {
+        return search_corrections(line, max_results, max_weight, beam);
+    }
+    CorrectionQueue result;
+    if (!cache->find_correct(mutator, lexicon, line,
+                             max_results, max_weight, beam, result)) {
+        result = search_corrections(line, max_results, max_weight, beam);
+        cache->store_correct(mutator, lexicon, line,
+                             max_results, max_weight, beam, result);
+    }
+    return result;
+}
+
 std::string Speller::stringify(SymbolNumberVector symbol_vector)
 {
     std::string s;
@@ -361,6 +494,17 @@ std::string Speller::stringify(SymbolNumberVector symbol_vector)
     return s;
 }
 
+std::string Speller::stringify(TreeNodeIndex i)
+{
+    // the symbols are found from the end backwards
+    SymbolNumberVector symbol_vector;
+    for (; nodes[i].parent != NO_TREE_NODE; i = nodes[i].parent) {
+        symbol_vector.push_back(nodes[i].symbol);
+    }
+    std::reverse(symbol_vector.begin(), symbol_vector.end());
+    return stringify(symbol_vector);
+}
+
 bool Speller::init_input(char * str,
                          const Encoder & encoder,
                          SymbolNumber other)
@@ -395,4 +539,144 @@ void Speller::build_alphabet_translator(void)
         }
 }
 
+bool SpellerCache::Key::operator<(const Key & other) const
+{
+    if (mutator != other.mutator) {
+        return mutator < other.mutator;
+    }
+    if (lexicon != other.lexicon) {
+        return lexicon < other.lexicon;
+    }
+    if (input != other.input) {
+        return input < other.input;
+    }
+    if (correcting != other.correcting) {
+        return correcting < other.correcting;
+    }
+    if (max_results != other.max_results) {
+        return max_results < other.max_results;
+    }
+    if (max_weight != other.max_weight) {
+        return max_weight < other.max_weight;
+    }
+    return beam < other.beam;
+}
+
+SpellerCache::SpellerCache(size_t max_entries):
+    entries(), entry_map(), max_entries(max_entries), hits(0), misses(0)
+{}
+
+bool SpellerCache::find(const Key & key, Entry & entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<Key, EntryList::iterator>::iterator it = entry_map.find(key);
+    if (it == entry_map.end()) {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    // move to the front as the most recently used
+    entries.splice(entries.begin(), entries, it->second);
+    entry = it->second->second;
+    return true;
+}
+
+void SpellerCache::store(const Key & key, const Entry & entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_entries == 0) {
+        return;
+    }
+    std::map<Key, EntryList::iterator>::iterator it = entry_map.find(key);
+    if (it != entry_map.end()) {
+        // another thread got here first
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() >= max_entries) {
+        entry_map.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.push_front(std::make_pair(key, entry));
+    entry_map[key] = entries.begin();
+}
+
+bool SpellerCache::find_check(const Transducer * lexicon,
+                              const std::string & input, bool & result)
+{
+    Key key = { 0, lexicon->get_serial(), input, false, 0, 0.0, 0.0 };
+    Entry entry;
+    if (!find(key, entry)) {
+        return false;
+    }
+    result = entry.in_lexicon;
+    return true;
+}
+
+void SpellerCache::store_check(const Transducer * lexicon,
+                               const std::string & input, bool result)
+{
+    Key key = { 0, lexicon->get_serial(), input, false, 0, 0.0, 0.0 };
+    Entry entry;
+    entry.in_lexicon = result;
+    store(key, entry);
+}
+
+bool SpellerCache::find_correct(const Transducer * mutator,
+                                const Transducer * lexicon,
+                                const std::string & input, int max_results,
+                                Weight max_weight, Weight beam,
+                                CorrectionQueue & result)
+{
+    Key key = { mutator->get_serial(), lexicon->get_serial(), input, true,
+                max_results, max_weight, beam };
+    Entry entry;
+    if (!find(key, entry)) {
+        return false;
+    }
+    result = entry.corrections;
+    return true;
+}
+
+void SpellerCache::store_correct(const Transducer * mutator,
+                                 const Transducer * lexicon,
+                                 const std::string & input, int max_results,
+                                 Weight max_weight, Weight beam,
+                                 const CorrectionQueue & result)
+{
+    Key key = { mutator->get_serial(), lexicon->get_serial(), input, true,
+                max_results, max_weight, beam };
+    Entry entry;
+    entry.in_lexicon = false;
+    entry.corrections = result;
+    store(key, entry);
+}
+
+unsigned long SpellerCache::get_hits(void) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+unsigned long SpellerCache::get_misses(void) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+size_t SpellerCache::size(void) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void SpellerCache::clear(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    entry_map.clear();
+    hits = 0;
+    misses = 0;
+}
+
 } // namespace hfst_ol
@@ -83,6 +83,22 @@ PmatchAlphabet::PmatchAlphabet(TransducerAlphabet const & a,
     }
 }
 
+PmatchAlphabet::PmatchAlphabet(PmatchAlphabet const & a,
+                               PmatchContainer * cont):
+    PmatchAlphabet(a)
+{
+    container = cont;
+    // Until they are replaced, the RTNs still belong to a
+    for (RtnVector::iterator it = rtns.begin(); it != rtns.end(); ++it) {
+        *it = NULL;
+    }
+    for (size_t i = 0; i < rtns.size(); ++i) {
+        if (a.rtns[i] != NULL) {
+            rtns[i] = new PmatchTransducer(*a.rtns[i], *this, cont);
+        }
+    }
+}
+
 PmatchAlphabet::PmatchAlphabet(void):
     TransducerAlphabet()
 {}
@@ -321,7 +337,10 @@ PmatchContainer::PmatchContainer(std::istream & inputstream):
     line_number(0),
     profile_mode(false),
     single_codepoint_tokenization(false),
-    running_weight(0.0)
+    running_weight(0.0),
+    stream_open(false),
+    input_exhausted(false),
+    max_symbol_bytes(4)
 {
     set_properties();
     reset_recursion();
@@ -351,10 +370,9 @@ PmatchContainer::PmatchContainer(std::istream & inputstream):
     global_flag_state = alphabet.get_fd_table();
     encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
 
-    if (properties.count("initial-symbols") == 1) {
-        collect_first_symbols(properties["initial-symbols"]);
-    }
-    
+    collect_first_symbols(properties);
+
+
     toplevel = new hfst_ol::PmatchTransducer(
         inputstream,
         header.index_table_size(),
@@ -393,7 +411,10 @@ PmatchContainer::PmatchContainer(Transducer * t):
     locate_mode(false),
     profile_mode(false),
     single_codepoint_tokenization(false),
-    running_weight(0.0)
+    running_weight(0.0),
+    stream_open(false),
+    input_exhausted(false),
+    max_symbol_bytes(4)
 {
     set_properties();
     reset_recursion();
@@ -424,7 +445,10 @@ PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
     line_number(0),
     profile_mode(false),
     single_codepoint_tokenization(false),
-    running_weight(0.0)
+    running_weight(0.0),
+    stream_open(false),
+    input_exhausted(false),
+    max_symbol_bytes(4)
 {
     set_properties();
     reset_recursion();
@@ -448,6 +472,7 @@ PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
         orig_symbol_count = symbol_count = alphabet.get_orig_symbol_count();
         global_flag_state = alphabet.get_fd_table();
         encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
+        collect_first_symbols(properties);
         TransducerTable<TransitionW> transitions = backend->copy_transitionw_table();
         TransducerTable<TransitionWIndex> indices = backend->copy_windex_table();
         toplevel = new hfst_ol::PmatchTransducer(
@@ -521,6 +546,8 @@ PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
         orig_symbol_count = symbol_count = alphabet.get_orig_symbol_count();
         global_flag_state = alphabet.get_fd_table();
         encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
+        std::map<std::string, std::string> top_properties = top->get_properties();
+        collect_first_symbols(top_properties);
         TransducerTable<TransitionW> transitions = harmonized_tmp->copy_transitionw_table();
         TransducerTable<TransitionWIndex> indices = harmonized_tmp->copy_windex_table();
         toplevel = new hfst_ol::PmatchTransducer(
@@ -584,6 +611,37 @@ void PmatchContainer::add_rtn(Transducer * rtn, const std::string & name)
     }
 }
 
+PmatchContainer::PmatchContainer(const PmatchContainer & other):
+    alphabet(other.alphabet, this),
+    orig_symbol_count(other.orig_symbol_count),
+    symbol_count(other.symbol_count),
+    entry_stack(),
+    possible_first_symbols(other.possible_first_symbols),
+    global_flag_state(alphabet.get_fd_table()),
+    verbose(other.verbose),
+    count_patterns(other.count_patterns),
+    delete_patterns(other.delete_patterns),
+    extract_patterns(other.extract_patterns),
+    locate_mode(other.locate_mode),
+    mark_patterns(other.mark_patterns),
+    max_context_length(other.max_context_length),
+    max_recursion(other.max_recursion),
+    need_separators(other.need_separators),
+    xerox_composition(other.xerox_composition),
+    line_number(0),
+    profile_mode(other.profile_mode),
+    single_codepoint_tokenization(other.single_codepoint_tokenization),
+    running_weight(0.0),
+    stream_open(false),
+    input_exhausted(false),
+    max_symbol_bytes(other.max_symbol_bytes)
+{
+    reset_recursion();
+    // The symbols added by other while tokenizing are in the alphabet too
+    encoder = new Encoder(alphabet.get_symbol_table(), symbol_count);
+    toplevel = new hfst_ol::PmatchTransducer(*other.toplevel, alphabet, this);
+}
+
 PmatchContainer::PmatchContainer(void)
 {
     // Not used, but apparently needed by swig to construct these
@@ -867,11 +925,12 @@ SymbolNumber PmatchAlphabet::get_special(SpecialSymbol special) const
     return special_symbols.at(special);
 }
 
-void PmatchContainer::process(const std::string & input_str)
+void PmatchContainer::start_input(void)
 {
-    initialize_input(input_str.c_str());
-    unsigned int input_pos = 0;
-    unsigned int printable_input_pos = 0;
+    input.clear();
+    pending_text.clear();
+    stream_pos = 0;
+    printable_input_pos = 0;
     running_weight = 0.0;
     stack_depth = 0;
     best_input_pos = 0;
@@ -882,26 +941,67 @@ void PmatchContainer::process(const std::string & input_str)
     old_captures.clear();
     best_captures.clear();
     captures.clear();
+    nonmatching_locations.clear();
+    printable_input_returned = false;
     reset_recursion();
-    DoubleTape nonmatching_locations;
-    while (has_queued_input(input_pos)) {
-        best_result.clear();
-        SymbolNumber current_input = input[input_pos];
+}
+
+void PmatchContainer::process(const std::string & input_str)
+{
+    start_input();
+    stream_open = false;
+    initialize_input(input_str.c_str());
+    process_input();
+}
+
+void PmatchContainer::process_input(void)
+{
+    while (has_queued_input(stream_pos)) {
+        SymbolNumber current_input = input[stream_pos];
         if (not_possible_first_symbol(current_input)) {
-            copy_to_result(current_input, current_input);
-            ++input_pos;
-            if (locate_mode && alphabet.is_printable(current_input)) {
-                ++printable_input_pos;
-                nonmatching_locations.push_back(
-                    SymbolPair(current_input, current_input));
+            // Pass over the whole run of symbols no match can start with
+            // before doing any per-match work
+            size_t skip_end = stream_pos + 1;
+            while (skip_end < input.size() &&
+                   not_possible_first_symbol(input[skip_end])) {
+                ++skip_end;
+            }
+            for (; stream_pos < skip_end; ++stream_pos) {
+                current_input = input[stream_pos];
+                copy_to_result(current_input, current_input);
+                if (locate_mode && alphabet.is_printable(current_input)) {
+                    ++printable_input_pos;
+                    nonmatching_locations.push_back(
+                        SymbolPair(current_input, current_input));
+                }
             }
             continue;
         }
+        if (stream_open && input.size() - stream_pos <= max_context_length) {
+            // Wait for enough input to look ahead
+            break;
+        }
+        best_result.clear();
         tape.clear();
         tape_locations.clear();
         unsigned int tape_pos = 0;
-        unsigned int old_input_pos = input_pos;
-        toplevel->match(input_pos, tape_pos);
+        unsigned int old_input_pos = stream_pos;
+        unsigned int old_best_input_pos = best_input_pos;
+        Weight old_best_weight = best_weight;
+        unsigned int old_recursion_depth_left = recursion_depth_left;
+        input_exhausted = false;
+        toplevel->match(stream_pos, tape_pos);
+        if (input_exhausted) {
+            // The match might get longer with more input, so this
+            // position is tried again when there is some
+            best_input_pos = old_best_input_pos;
+            best_weight = old_best_weight;
+            recursion_depth_left = old_recursion_depth_left;
+            best_result.clear();
+            best_captures.clear();
+            tape_locations.clear();
+            break;
+        }
         if (candidate_found()) {
             // We got some output
             if (locate_mode) {
@@ -927,29 +1027,134 @@ void PmatchContainer::process(const std::string & input_str)
             } else {
                 copy_to_result(best_result);
             }
-            input_pos = best_input_pos;
+            stream_pos = best_input_pos;
             old_captures.insert(old_captures.end(), best_captures.begin(), best_captures.end());
         }
-        if (!candidate_found() || input_pos == old_input_pos) {
+        if (!candidate_found() || stream_pos == old_input_pos) {
             // If no input was consumed, we move one position up
             copy_to_result(current_input, current_input);
-            ++input_pos;
+            ++stream_pos;
             if (locate_mode && alphabet.is_printable(current_input)) {
                 ++printable_input_pos;
                 nonmatching_locations.push_back(SymbolPair(current_input, current_input));
             }
         }
     }
-    if (locate_mode && !nonmatching_locations.empty()) {
+    if (!stream_open && locate_mode && !nonmatching_locations.empty()) {
         LocationVector ls;
         Location nonmatching = alphabet.locatefy(printable_input_pos - hfst::size_t_to_uint(nonmatching_locations.size()),
                                                  WeightedDoubleTape(nonmatching_locations, 0.0));
         nonmatching.output = "@_NONMATCHING_@";
         ls.push_back(nonmatching);
         locations.push_back(ls);
+        nonmatching_locations.clear();
+    }
+}
+
+void PmatchContainer::trim_input(void)
+{
+    // Left contexts look back at most max_context_length symbols, but
+    // captures can be referred to from anywhere later on
+    if (stream_pos <= max_context_length + 1) {
+        return;
+    }
+    unsigned int keep_from = stream_pos - hfst::size_t_to_uint(max_context_length) - 1;
+    for (std::vector<Capture>::const_iterator it = old_captures.begin();
+         it != old_captures.end(); ++it) {
+        keep_from = std::min(keep_from, it->begin);
+    }
+    // Erase only when it moves less than it frees
+    if (keep_from < 4096 || keep_from < input.size() / 2) {
+        return;
+    }
+    input.erase(input.begin(), input.begin() + keep_from);
+    stream_pos -= keep_from;
+    best_input_pos = best_input_pos > keep_from ? best_input_pos - keep_from : 0;
+    for (std::vector<Capture>::iterator it = old_captures.begin();
+         it != old_captures.end(); ++it) {
+        it->begin -= keep_from;
+        it->end -= keep_from;
     }
 }
 
+void PmatchContainer::feed_stream(const std::string & text, bool end_of_input,
+                                  double time_cutoff, Weight weight_cutoff)
+{
+    max_time = time_cutoff;
+    max_weight = weight_cutoff;
+    if (max_time > 0.0) {
+        start_clock = clock();
+        call_counter = 0;
+        limit_reached = false;
+    }
+    SymbolNumber boundary_sym = alphabet.get_special(boundary);
+    if (!stream_open) {
+        start_input();
+        stream_open = true;
+        // A token is at most the longest symbol or one utf-8 character
+        max_symbol_bytes = 4;
+        const SymbolTable & symbols = alphabet.get_symbol_table();
+        for (SymbolTable::const_iterator it = symbols.begin();
+             it != symbols.end(); ++it) {
+            max_symbol_bytes = std::max(max_symbol_bytes, it->size());
+        }
+        if (boundary_sym != NO_SYMBOL_NUMBER) {
+            input.push_back(boundary_sym);
+        }
+    } else {
+        result.clear();
+        locations.clear();
+    }
+    pending_text.append(text);
+    char * text_start = const_cast<char *>(pending_text.c_str());
+    char * text_pos = text_start;
+    if (end_of_input) {
+        tokenize(&text_pos, NULL);
+        pending_text.clear();
+        if (boundary_sym != NO_SYMBOL_NUMBER) {
+            input.push_back(boundary_sym);
+        }
+        stream_open = false;
+    } else if (pending_text.size() >= max_symbol_bytes) {
+        // Only tokenize where all of the longest possible token is there
+        tokenize(&text_pos,
+                 text_start + pending_text.size() - max_symbol_bytes + 1);
+        pending_text.erase(0, text_pos - text_start);
+    }
+    process_input();
+    if (stream_open) {
+        trim_input();
+    }
+}
+
+std::string PmatchContainer::match_stream(const std::string & input,
+                                          bool end_of_input,
+                                          double time_cutoff,
+                                          Weight weight_cutoff)
+{
+    locate_mode = false;
+    feed_stream(input, end_of_input, time_cutoff, weight_cutoff);
+    std::string retval = alphabet.stringify(result, printable_input_returned);
+    for (DoubleTape::const_iterator it = result.begin();
+         !printable_input_returned && it != result.end(); ++it) {
+        printable_input_returned = alphabet.is_printable(it->input);
+    }
+    result.clear();
+    return retval;
+}
+
+LocationVectorVector PmatchContainer::locate_stream(const std::string & input,
+                                                    bool end_of_input,
+                                                    double time_cutoff,
+                                                    Weight weight_cutoff)
+{
+    locate_mode = true;
+    feed_stream(input, end_of_input, time_cutoff, weight_cutoff);
+    LocationVectorVector retval;
+    retval.swap(locations);
+    return retval;
+}
+
 std::string PmatchContainer::match(const std::string & input,
                                    double time_cutoff,
                                    Weight weight_cutoff)
@@ -1059,11 +1264,12 @@ void PmatchContainer::copy_to_result(SymbolNumber input_sym, SymbolNumber output
     result.push_back(SymbolPair(input_sym, output_sym));
 }
 
-std::string PmatchAlphabet::stringify(const DoubleTape & str)
+std::string PmatchAlphabet::stringify(const DoubleTape & str,
+                                      bool after_printable_input)
 {
     std::string retval;
     std::stack<unsigned int> start_tag_pos;
-    bool input_contained_printable_symbol = false;
+    bool input_contained_printable_symbol = after_printable_input;
     for (DoubleTape::const_iterator it = str.begin();
          it != str.end(); ++it) {
         if (!input_contained_printable_symbol && is_printable(it->input)) {
@@ -1175,6 +1381,9 @@ std::string PmatchContainer::get_unsatisfied_rtn_name(void) const
 bool PmatchContainer::has_queued_input(unsigned int input_pos)
 {
     // we catch underflow due to left context checking here
+    if (stream_open && input_pos >= input.size() && (input_pos + 1 != 0)) {
+        input_exhausted = true;
+    }
     return input_pos < input.size() && (input_pos + 1 != 0);
 }
 
@@ -1183,6 +1392,9 @@ bool PmatchContainer::input_matches_at(unsigned int pos,
                                        SymbolNumberVector::iterator end)
 {
     if (pos + (end - begin) >= input.size()) {
+        if (stream_open) {
+            input_exhausted = true;
+        }
         return false;
     }
     for (size_t i = 0; begin + i != end; ++i) {
@@ -1193,14 +1405,37 @@ bool PmatchContainer::input_matches_at(unsigned int pos,
     return true;
 }
 
+// Read a table of size entries of T from is
+template<class T>
+static std::shared_ptr<const std::vector<T> > read_table(
+    std::istream & is, TransitionTableIndex size)
+{
+    std::vector<T> * table = new std::vector<T>();
+    char * tab = (char*) malloc(T::size * size);
+    is.read(tab, T::size * size);
+    char * orig_p = tab;
+    table->reserve(size);
+    while(size) {
+        table->push_back(T(tab));
+        --size;
+        tab += T::size;
+    }
+    free(orig_p);
+    return std::shared_ptr<const std::vector<T> >(table);
+}
+
 PmatchTransducer::PmatchTransducer(std::istream & is,
                                    TransitionTableIndex index_table_size,
                                    TransitionTableIndex transition_table_size,
                                    PmatchAlphabet & alpha,
                                    std::string _name,
                                    PmatchContainer * cont):
-    alphabet(alpha),
     name(_name),
+    index_storage(read_table<TransitionWIndex>(is, index_table_size)),
+    transition_storage(read_table<TransitionW>(is, transition_table_size)),
+    transition_table(*transition_storage),
+    index_table(*index_storage),
+    alphabet(alpha),
     container(cont)
 {
     orig_symbol_count = hfst::size_t_to_uint(alphabet.get_symbol_table().size());
@@ -1215,28 +1450,6 @@ PmatchTransducer::PmatchTransducer(std::istream & is,
     local_variables.negative_context_success = false;
     local_variables.pending_passthrough = false;
     local_stack.push(local_variables);
-
-    // Allocate and read tables
-    char * indextab = (char*) malloc(TransitionWIndex::size * index_table_size);
-    char * transitiontab = (char*) malloc(TransitionW::size * transition_table_size);
-    is.read(indextab, TransitionWIndex::size * index_table_size);
-    is.read(transitiontab, TransitionW::size * transition_table_size);
-    char * orig_p = indextab;
-    index_table.reserve(index_table_size);
-    while(index_table_size) {
-        index_table.push_back(TransitionWIndex(indextab));
-        --index_table_size;
-        indextab += TransitionWIndex::size;
-    }
-    free(orig_p);
-    orig_p = transitiontab;
-    transition_table.reserve(transition_table_size);
-    while(transition_table_size) {
-        transition_table.push_back(TransitionW(transitiontab));
-        --transition_table_size;
-        transitiontab += TransitionW::size;
-    }
-    free(orig_p);
 }
 
 PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
@@ -1244,10 +1457,12 @@ PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
                                    PmatchAlphabet & alpha,
                                    std::string _name,
                                    PmatchContainer * cont):
-    transition_table(transition_vector),
-    index_table(index_vector),
-    alphabet(alpha),
     name(_name),
+    index_storage(new std::vector<TransitionWIndex>(index_vector)),
+    transition_storage(new std::vector<TransitionW>(transition_vector)),
+    transition_table(*transition_storage),
+    index_table(*index_storage),
+    alphabet(alpha),
     container(cont)
 {
     orig_symbol_count = hfst::size_t_to_uint(alphabet.get_symbol_table().size());
@@ -1264,6 +1479,20 @@ PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
     local_stack.push(local_variables);
 }
 
+PmatchTransducer::PmatchTransducer(const PmatchTransducer & other,
+                                   PmatchAlphabet & alpha,
+                                   PmatchContainer * cont):
+    name(other.name),
+    local_stack(other.local_stack),
+    index_storage(other.index_storage),
+    transition_storage(other.transition_storage),
+    transition_table(*transition_storage),
+    index_table(*index_storage),
+    alphabet(alpha),
+    orig_symbol_count(other.orig_symbol_count),
+    container(cont)
+{}
+
 void PmatchContainer::set_properties(void)
 {
     count_patterns = false;
@@ -1343,15 +1572,23 @@ void PmatchContainer::set_properties(std::map<std::string, std::string> & proper
     }
 }
 
-void PmatchContainer::collect_first_symbols(const std::string & symbols_list)
+void PmatchContainer::collect_first_symbols(std::map<std::string, std::string> & properties)
 {
-    SymbolNumberVector first_symbols = symbol_vector_from_symbols(symbols_list);
+    possible_first_symbols.clear();
+    if (properties.count("initial-symbols") == 0 ||
+        properties["initial-symbols"].empty()) {
+        return;
+    }
+    SymbolNumberVector first_symbols =
+        symbol_vector_from_symbols(properties["initial-symbols"]);
+    // Tokenizing the list may have added symbols
+    possible_first_symbols.assign(symbol_count, 0);
     for (SymbolNumberVector::const_iterator it = first_symbols.begin();
          it != first_symbols.end(); ++it) {
-        while (*it >= possible_first_symbols.size()) {
-            possible_first_symbols.push_back(false);
+        if (*it >= possible_first_symbols.size()) {
+            possible_first_symbols.resize(*it + 1, 0);
         }
-        possible_first_symbols[*it] = true;
+        possible_first_symbols[*it] = 1;
     }
 }
 
@@ -1368,15 +1605,26 @@ void PmatchContainer::initialize_input(const char * input_s)
 {
     input.clear();
     char * input_str = const_cast<char *>(input_s);
-    char ** input_str_ptr = &input_str;
-    SymbolNumber k = NO_SYMBOL_NUMBER;
     SymbolNumber boundary_sym = alphabet.get_special(boundary);
-    char * single_codepoint_scratch;
-    char single_codepoint_scratch_orig[5] = {};
     if (boundary_sym != NO_SYMBOL_NUMBER) {
         input.push_back(boundary_sym);
     }
-    while (**input_str_ptr != 0) {
+    tokenize(&input_str, NULL);
+    if (boundary_sym != NO_SYMBOL_NUMBER) {
+        input.push_back(boundary_sym);
+    }
+    return;
+}
+
+/* Append the tokens of the text at *input_str_ptr to input and move the
+   pointer past them. If end is given, only tokens starting before it are
+   read. */
+void PmatchContainer::tokenize(char ** input_str_ptr, const char * end)
+{
+    SymbolNumber k = NO_SYMBOL_NUMBER;
+    char * single_codepoint_scratch;
+    char single_codepoint_scratch_orig[5] = {};
+    while (**input_str_ptr != 0 && (end == NULL || *input_str_ptr < end)) {
         char * original_input_loc = *input_str_ptr;
         if (single_codepoint_tokenization) {
             int bytes_to_tokenize = nByte_utf8(**input_str_ptr);
@@ -1413,10 +1661,6 @@ void PmatchContainer::initialize_input(const char * input_s)
         }
         input.push_back(k);
     }
-    if (boundary_sym != NO_SYMBOL_NUMBER) {
-        input.push_back(boundary_sym);
-    }
-    return;
 }
 
 void PmatchTransducer::match(unsigned int input_tape_pos,
@@ -1686,15 +1930,15 @@ void PmatchTransducer::take_flag(SymbolNumber input,
                                  unsigned int tape_pos,
                                  TransitionTableIndex i)
 {
-    std::vector<short> old_global_values;
+    hfst::FdValues old_global_values;
     if (alphabet.is_global_flag(input)) {
-        (old_global_values = container->global_flag_state.get_values());
+        (old_global_values = container->global_flag_state.get_value_array());
         if (((container->global_flag_state).apply_operation
              (*(alphabet.get_operation(input)))) == false) {
             return;
         }
     }
-    std::vector<short> old_values(local_stack.top().flag_state.get_values());
+    hfst::FdValues old_values(local_stack.top().flag_state.get_value_array());
     if (local_stack.top().flag_state.apply_operation(
             *(alphabet.get_operation(input)))) {
         // flag diacritic allowed
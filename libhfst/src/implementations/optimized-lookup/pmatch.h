@@ -11,6 +11,7 @@
 
 #include <map>
 #include <stack>
+#include <memory>
 #include <sstream>
 #include <algorithm>
 #include <ctime>
@@ -89,6 +90,9 @@ namespace hfst_ol {
     public:
         PmatchAlphabet(std::istream& is, SymbolNumber symbol_count, PmatchContainer * cont);
         PmatchAlphabet(TransducerAlphabet const & a, PmatchContainer * cont);
+        // A copy for another container, with its own RTNs sharing the
+        // tables of the ones in a
+        PmatchAlphabet(PmatchAlphabet const & a, PmatchContainer * cont);
         PmatchAlphabet(void);
         ~PmatchAlphabet(void);
         virtual void add_symbol(const std::string & symbol);
@@ -120,7 +124,8 @@ namespace hfst_ol {
         std::string get_counter_name(SymbolNumber symbol);
         SymbolNumber get_special(SpecialSymbol special) const;
         SymbolNumberVector get_specials(void) const;
-        std::string stringify(const DoubleTape & str);
+        std::string stringify(const DoubleTape & str,
+                              bool after_printable_input = false);
         Location locatefy(unsigned int input_offset,
                           const WeightedDoubleTape & str);
 
@@ -161,7 +166,9 @@ namespace hfst_ol {
         std::vector<Capture> captures;
         std::vector<Capture> best_captures;
         std::vector<Capture> old_captures;
-        std::vector<bool> possible_first_symbols;
+        // Whether a match can start with each symbol, if known. A plain
+        // byte per symbol keeps the skip loop in process_input() cheap.
+        std::vector<char> possible_first_symbols;
         // The flag state for global flags
         hfst::FdState<SymbolNumber> global_flag_state;
         bool verbose;
@@ -202,17 +209,49 @@ namespace hfst_ol {
         unsigned int best_input_pos;
         Weight best_weight;
 
+        // State of the input being processed. With streamed input it is
+        // kept between the pieces of text.
+        // Text that hasn't been tokenized yet
+        std::string pending_text;
+        // Whether more input may still follow what is in input
+        bool stream_open;
+        // Whether matching wanted to look past the end of an open stream
+        bool input_exhausted;
+        // Where matching continues in input
+        unsigned int stream_pos;
+        unsigned int printable_input_pos;
+        DoubleTape nonmatching_locations;
+        // Whether result has had printable input before the part that
+        // hasn't been returned yet
+        bool printable_input_returned;
+        // Bytes of text needed to be sure of the next token
+        size_t max_symbol_bytes;
+
+        void tokenize(char ** input_str_ptr, const char * end);
+        void start_input(void);
+        void process_input(void);
+        void trim_input(void);
+        void feed_stream(const std::string & text, bool end_of_input,
+                         double time_cutoff, Weight weight_cutoff);
+
     public:
 
         PmatchContainer(std::istream & is);
         PmatchContainer(Transducer * toplevel);
         PmatchContainer(std::vector<hfst::HfstTransducer> transducers);
+        // Another container for the same transducers, sharing their tables
+        // but with its own input and matching state, eg. for matching in
+        // another thread. other shouldn't be matching while it's copied.
+        PmatchContainer(const PmatchContainer & other);
+        // Not assignable: each container owns its toplevel transducer and
+        // encoder, which the copy constructor makes anew
+        PmatchContainer & operator=(const PmatchContainer & other) = delete;
         PmatchContainer(void);
         ~PmatchContainer(void);
 
         void set_properties(void);
         void set_properties(std::map<std::string, std::string> & properties);
-        void collect_first_symbols(const std::string & symbol_list);
+        void collect_first_symbols(std::map<std::string, std::string> & properties);
         SymbolNumberVector symbol_vector_from_symbols(const std::string & symbols);
         void initialize_input(const char * input);
         bool has_unsatisfied_rtns(void) const;
@@ -225,6 +264,19 @@ namespace hfst_ol {
         LocationVectorVector locate(const std::string & input,
                                     double time_cutoff = 0.0,
                                     Weight weight_cutoff = INFINITE_WEIGHT);
+        // Streaming versions of match() and locate(). The input is given
+        // in pieces of any size, the last one with end_of_input set, and
+        // each call returns what has become final. Only a window of
+        // max_context_length symbols before and after the current
+        // position is kept, unless a match or a capture needs more.
+        std::string match_stream(const std::string & input,
+                                 bool end_of_input,
+                                 double time_cutoff = 0.0,
+                                 Weight weight_cutoff = INFINITE_WEIGHT);
+        LocationVectorVector locate_stream(const std::string & input,
+                                           bool end_of_input,
+                                           double time_cutoff = 0.0,
+                                           Weight weight_cutoff = INFINITE_WEIGHT);
         void note_analysis(unsigned int input_pos, unsigned int tape_pos);
         void grab_location(unsigned int input_pos, unsigned int tape_pos);
         std::pair<SymbolNumberVector::iterator,
@@ -242,7 +294,7 @@ namespace hfst_ol {
                 return false;
             }
             return sym >= possible_first_symbols.size() ||
-                possible_first_symbols[sym] == false;
+                possible_first_symbols[sym] == 0;
         }
         void copy_to_result(const DoubleTape & best_result);
         void copy_to_result(SymbolNumber input, SymbolNumber output);
@@ -353,9 +405,13 @@ namespace hfst_ol {
         };
 
         std::stack<LocalVariables> local_stack;
-    
-        std::vector<TransitionW> transition_table;
-        std::vector<TransitionWIndex> index_table;
+
+        // The tables are only read during matching, so they are shared
+        // between the copies of a transducer in different containers.
+        std::shared_ptr<const std::vector<TransitionWIndex> > index_storage;
+        std::shared_ptr<const std::vector<TransitionW> > transition_storage;
+        const std::vector<TransitionW> & transition_table;
+        const std::vector<TransitionWIndex> & index_table;
 
         PmatchAlphabet & alphabet;
         SymbolNumber orig_symbol_count;
@@ -435,6 +491,10 @@ namespace hfst_ol {
                          std::string name,
                          PmatchContainer * container);
 
+        PmatchTransducer(const PmatchTransducer & other,
+                         PmatchAlphabet & alphabet,
+                         PmatchContainer * container);
+
         bool final_index(TransitionTableIndex i) const
         {
             if (indexes_transition_table(i)) {
@@ -9,12 +9,16 @@
 
 #include "pmatch_tokenize.h"
 
+#include <atomic>
 
 #if USE_ICU_UNICODE
+#include <memory>
 #include <unicode/unistr.h>
 #include <unicode/brkiter.h>
-static UErrorCode characterBoundaryStatus = U_ZERO_ERROR;
-static icu::BreakIterator* characterBoundary = icu::BreakIterator::createCharacterInstance(NULL, characterBoundaryStatus);
+// A BreakIterator keeps the text it was set to, so threads tokenizing in
+// parallel need one each
+static thread_local UErrorCode characterBoundaryStatus = U_ZERO_ERROR;
+static thread_local std::unique_ptr<icu::BreakIterator> characterBoundary(icu::BreakIterator::createCharacterInstance(NULL, characterBoundaryStatus));
 #endif
 
 namespace hfst_ol_tokenize {
@@ -29,7 +33,7 @@ using hfst_ol::LocationVectorVector;
 
 static const string subreading_separator = "#";
 static const string wtag = "W"; // TODO: cg-conv has an argument --wtag, allow changing here as well?
-static bool IS_CG_TAG_MODIFIER_WARNED = false; // Only warn once on skipping modifier letters
+static std::atomic<bool> IS_CG_TAG_MODIFIER_WARNED(false); // Only warn once on skipping modifier letters
 
 void print_escaping_backslashes(std::string const & str, std::ostream & outstream)
 {
@@ -244,9 +248,8 @@ bool is_cg_tag(const string & str) {
     const int32_t i_after = characterBoundary->following(0);
     if(u_charType(us.char32At(i_after)) == U_MODIFIER_LETTER) {
         const bool is_tag = us.length() > characterBoundary->following(i_after);
-        if(!IS_CG_TAG_MODIFIER_WARNED && !is_tag) {
+        if(!is_tag && !IS_CG_TAG_MODIFIER_WARNED.exchange(true)) { // warn only once
             std::cerr << "WARNING: Skipping modifier letter for baseform letter " << str << " (to avoid this warning, ensure Modifiers are not part of the same Multichar_symbol as their preceding Character)" << std::endl;
-            IS_CG_TAG_MODIFIER_WARNED = true; // warn only once
         }
         return is_tag;
     }
@@ -10,6 +10,13 @@
 #include "./transducer.h"
 
 #include <cstdio> // testing
+#include <atomic>
+
+#ifndef _MSC_VER
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#endif
 
 #ifndef MAIN_TEST
 
@@ -206,7 +213,7 @@ bool OlLetterTrie::has_key_starting_with(const char c) const
     return letters[(unsigned char) c] != NULL;
 }
 
-SymbolNumber OlLetterTrie::find_key(char ** p)
+SymbolNumber OlLetterTrie::find_key(char ** p) const
 {
     const char * old_p = *p;
     ++(*p);
@@ -245,7 +252,7 @@ void Encoder::read_input_symbol(const char * s, const int s_num)
     letters.add_string(s, s_num);
 }
 
-SymbolNumber Encoder::find_key(char ** p)
+SymbolNumber Encoder::find_key(char ** p) const
 {
     if (!should_ascii_tokenize((unsigned char) **p) ||
         ascii_symbols[(unsigned char)(**p)] == NO_SYMBOL_NUMBER)
@@ -257,30 +264,48 @@ SymbolNumber Encoder::find_key(char ** p)
     return s;
 }
 
-bool Transducer::initialize_input(const char * input)
+LookupSession::LookupSession(const Transducer & t):
+    alphabet(*t.alphabet), tables(*t.tables), encoder(*t.encoder),
+    extra_symbol_base(0), extra_symbols(), extra_symbol_map(),
+    current_weight(0.0), lookup_paths(NULL),
+    input_tape(), output_tape(),
+    flag_state(t.alphabet->get_fd_table()), found_transition(false),
+    max_lookups(-1), recursion_depth_left(MAX_RECURSION_DEPTH),
+    max_time(0.0), start_clock()
+{}
+
+bool LookupSession::initialize_input(const char * input)
 {
     char * input_str = const_cast<char *>(input);
     char ** input_str_ptr = &input_str;
     unsigned int i = 0;
     SymbolNumber k = NO_SYMBOL_NUMBER;
+    extra_symbol_base = hfst::size_t_to_uint(alphabet.get_symbol_table().size());
+    extra_symbols.clear();
+    extra_symbol_map.clear();
     while(**input_str_ptr != 0) {
         char * original_input_loc = *input_str_ptr;
-        k = encoder->find_key(input_str_ptr);
+        k = encoder.find_key(input_str_ptr);
         if (k == NO_SYMBOL_NUMBER) {
-            // Add what we assume to be an unknown utf-8 symbol to the alphabet
+            // Give what we assume to be an unknown utf-8 symbol a number
+            // of its own for the duration of this lookup
             *input_str_ptr = original_input_loc;
             int bytes_to_tokenize = nByte_utf8(**input_str_ptr);
             if (bytes_to_tokenize == 0) {
                 return false; // tokenization failed
             }
-            char * new_symbol = new char[bytes_to_tokenize + 1];
-            memcpy(new_symbol, *input_str_ptr, bytes_to_tokenize);
-            new_symbol[bytes_to_tokenize] = '\0';
+            std::string new_symbol(*input_str_ptr, bytes_to_tokenize);
             (*input_str_ptr) += bytes_to_tokenize;
-            alphabet->add_symbol(new_symbol);
-            k = hfst::size_t_to_uint(alphabet->get_symbol_table().size() - 1);
-            encoder->read_input_symbol(new_symbol, k);
-            delete [] new_symbol;
+            StringSymbolMap::const_iterator it =
+                extra_symbol_map.find(new_symbol);
+            if (it != extra_symbol_map.end()) {
+                k = it->second;
+            } else {
+                k = hfst::size_t_to_uint(
+                    extra_symbol_base + extra_symbols.size());
+                extra_symbols.push_back(new_symbol);
+                extra_symbol_map[new_symbol] = k;
+            }
         }
         input_tape.write(i, k);
         ++i;
@@ -289,6 +314,29 @@ bool Transducer::initialize_input(const char * input)
     return true;
 }
 
+const std::string LookupSession::string_from_symbol(
+    const SymbolNumber symbol) const
+{
+    if (symbol >= extra_symbol_base &&
+        symbol - extra_symbol_base < extra_symbols.size()) {
+        return extra_symbols[symbol - extra_symbol_base];
+    }
+    return alphabet.string_from_symbol(symbol);
+}
+
+LookupSession & Transducer::get_session(void)
+{
+    if (session == NULL) {
+        session = new LookupSession(*this);
+    }
+    return *session;
+}
+
+bool Transducer::initialize_input(const char * input)
+{
+    return get_session().initialize_input(input);
+}
+
 void Transducer::include_symbol_in_alphabet(const std::string & sym)
 {
     SymbolNumber key = alphabet->symbol_from_string(sym);
@@ -306,6 +354,47 @@ void Transducer::include_symbol_in_alphabet(const std::string & sym)
 
 HfstOneLevelPaths * Transducer::lookup_fd(const StringVector & s, ssize_t limit,
                                           double time_cutoff)
+{
+    return get_session().lookup_fd(s, limit, time_cutoff);
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(const std::string & s, ssize_t limit,
+                                          double time_cutoff)
+{
+    return get_session().lookup_fd(s, limit, time_cutoff);
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
+                                          double time_cutoff)
+{
+    return get_session().lookup_fd(s, limit, time_cutoff);
+}
+
+HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const std::string & s, ssize_t limit,
+                                                double time_cutoff)
+{
+    return get_session().lookup_fd_pairs(s, limit, time_cutoff);
+}
+
+HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
+                                                double time_cutoff)
+{
+    return get_session().lookup_fd_pairs(s, limit, time_cutoff);
+}
+
+bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
+{
+    return get_session().is_lookup_infinitely_ambiguous(s);
+}
+
+bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
+{
+    return get_session().is_lookup_infinitely_ambiguous(s);
+}
+
+HfstOneLevelPaths * LookupSession::lookup_fd(const StringVector & s,
+                                             ssize_t limit,
+                                             double time_cutoff)
 {
     std::string input_str;
     for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
@@ -314,19 +403,21 @@ HfstOneLevelPaths * Transducer::lookup_fd(const StringVector & s, ssize_t limit,
     return lookup_fd(input_str, limit, time_cutoff);
 }
 
-HfstOneLevelPaths * Transducer::lookup_fd(const std::string & s, ssize_t limit,
-                                          double time_cutoff)
+HfstOneLevelPaths * LookupSession::lookup_fd(const std::string & s,
+                                             ssize_t limit,
+                                             double time_cutoff)
 {
     return lookup_fd(s.c_str(), limit, time_cutoff);
 }
 
-HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const std::string & s, ssize_t limit,
-                                                double time_cutoff)
+HfstTwoLevelPaths * LookupSession::lookup_fd_pairs(const std::string & s,
+                                                   ssize_t limit,
+                                                   double time_cutoff)
 {
     return lookup_fd_pairs(s.c_str(), limit, time_cutoff);
 }
 
-bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
+bool LookupSession::is_lookup_infinitely_ambiguous(const std::string & s)
 {
     if (!initialize_input(s.c_str())) {
         return false;
@@ -336,13 +427,13 @@ bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
         find_loop(0, 0);
     } catch (bool e) {
         current_weight = 0.0;
-        flag_state = alphabet->get_fd_table();
+        flag_state = alphabet.get_fd_table();
         return e;
     }
     return false;
 }
 
-bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
+bool LookupSession::is_lookup_infinitely_ambiguous(const StringVector & s)
 {
     std::string input_str;
     for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
@@ -351,25 +442,30 @@ bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
     return is_lookup_infinitely_ambiguous(input_str);
 }
 
-
-HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
-                                          double time_cutoff)
+void LookupSession::start_lookup(ssize_t limit, double time_cutoff)
 {
     max_lookups = limit;
     max_time = 0.0;
     if (time_cutoff > 0.0) {
         max_time = time_cutoff;
-        start_clock = clock();
+        start_clock = std::chrono::steady_clock::now();
     }
+    current_weight = 0.0;
+    flag_state = alphabet.get_fd_table();
+    recursion_depth_left = MAX_RECURSION_DEPTH;
+}
+
+HfstOneLevelPaths * LookupSession::lookup_fd(const char * s, ssize_t limit,
+                                             double time_cutoff)
+{
+    start_lookup(limit, time_cutoff);
     HfstOneLevelPaths * results = new HfstOneLevelPaths;
     if (!initialize_input(s)) {
         return results;
     }
     lookup_paths = new HfstTwoLevelPaths;
     traversal_states.clear();
-    //current_weight += s.second;
     get_analyses(0, 0, 0);
-    //current_weight -= s.second;
     for (HfstTwoLevelPaths::iterator it = lookup_paths->begin();
          it != lookup_paths->end(); ++it) {
         HfstOneLevelPath output_path;
@@ -385,15 +481,11 @@ HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
     return results;
 }
 
-HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
-                                                double time_cutoff)
+HfstTwoLevelPaths * LookupSession::lookup_fd_pairs(const char * s,
+                                                   ssize_t limit,
+                                                   double time_cutoff)
 {
-    max_lookups = limit;
-    max_time = 0.0;
-    if (time_cutoff > 0.0) {
-        max_time = time_cutoff;
-        start_clock = clock();
-    }
+    start_lookup(limit, time_cutoff);
     HfstTwoLevelPaths * results = new HfstTwoLevelPaths;
     lookup_paths = results;
     if (!initialize_input(s)) {
@@ -401,23 +493,21 @@ HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
         return results;
     }
     traversal_states.clear();
-    //current_weight += s.second;
     get_analyses(0, 0, 0);
-    //current_weight -= s.second;
     lookup_paths = NULL;
     return results;
 }
 
-void Transducer::try_epsilon_transitions(unsigned int input_pos,
+void LookupSession::try_epsilon_transitions(unsigned int input_pos,
                                          unsigned int output_pos,
                                          TransitionTableIndex i)
 {
     while (true)
     {
-        SymbolNumber input = tables->get_transition_input(i);
-        SymbolNumber output = tables->get_transition_output(i);
-        TransitionTableIndex target = tables->get_transition_target(i);
-        Weight weight = tables->get_weight(i);
+        SymbolNumber input = tables.get_transition_input(i);
+        SymbolNumber output = tables.get_transition_output(i);
+        TransitionTableIndex target = tables.get_transition_target(i);
+        Weight weight = tables.get_weight(i);
         Weight old_weight = current_weight;
         if (input == 0) // epsilon
         {
@@ -427,10 +517,10 @@ void Transducer::try_epsilon_transitions(unsigned int input_pos,
             found_transition = true;
             current_weight = old_weight;
             ++i;
-        } else if (alphabet->is_flag_diacritic(input)) {
-            FlagDiacriticState flags = flag_state.get_values();
+        } else if (alphabet.is_flag_diacritic(input)) {
+            hfst::FdValues flags = flag_state.get_value_array();
             if (flag_state.apply_operation(
-                    *(alphabet->get_operation(input)))) {
+                    *(alphabet.get_operation(input)))) {
                 // flag diacritic allowed
                 TraversalState flag_reachable(target, flags);
                 if (traversal_states.count(flag_reachable) == 1) {
@@ -456,44 +546,44 @@ void Transducer::try_epsilon_transitions(unsigned int input_pos,
     }
 }
 
-void Transducer::try_epsilon_indices(unsigned int input_pos,
+void LookupSession::try_epsilon_indices(unsigned int input_pos,
                                      unsigned int output_pos,
                                      TransitionTableIndex i)
 {
-    if (tables->get_index_input(i) == 0)
+    if (tables.get_index_input(i) == 0)
     {
         try_epsilon_transitions(input_pos,
                                 output_pos,
-                                tables->get_index_target(i) -
+                                tables.get_index_target(i) -
                                 TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
 }
 
-void Transducer::find_transitions(SymbolNumber input,
+void LookupSession::find_transitions(SymbolNumber input,
                                   unsigned int input_pos,
                                   unsigned int output_pos,
                                   TransitionTableIndex i)
 {
 
-    while (tables->get_transition_input(i) != NO_SYMBOL_NUMBER)
+    while (tables.get_transition_input(i) != NO_SYMBOL_NUMBER)
     {
-        if (tables->get_transition_input(i) == input)
+        if (tables.get_transition_input(i) == input)
         {
             Weight old_weight = current_weight;
             // We're not going to find an epsilon / flag loop
             traversal_states.clear();
-            SymbolNumber output = tables->get_transition_output(i);
-            if (alphabet->is_meta_arc(output)) {
+            SymbolNumber output = tables.get_transition_output(i);
+            if (alphabet.is_meta_arc(output)) {
                 // we got here via default, identity or unknown, so look
                 // back in the input tape to find the symbol we want to write
                 output = input_tape[input_pos - 1];
             }
             output_tape.write(output_pos, input, output);
-            current_weight += tables->get_weight(i);
+            current_weight += tables.get_weight(i);
             get_analyses(input_pos,
                          output_pos + 1,
-                         tables->get_transition_target(i));
+                         tables.get_transition_target(i));
             current_weight = old_weight;
             found_transition = true;
         }
@@ -505,17 +595,17 @@ void Transducer::find_transitions(SymbolNumber input,
     }
 }
 
-void Transducer::find_index(SymbolNumber input,
+void LookupSession::find_index(SymbolNumber input,
                             unsigned int input_pos,
                             unsigned int output_pos,
                             TransitionTableIndex i)
 {
-    if (tables->get_index_input(i+input) == input)
+    if (tables.get_index_input(i+input) == input)
     {
         find_transitions(input,
                          input_pos,
                          output_pos,
-                         tables->get_index_target(i+input) -
+                         tables.get_index_target(i+input) -
                          TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
@@ -524,7 +614,7 @@ void Transducer::find_index(SymbolNumber input,
 
 
 
-void Transducer::get_analyses(unsigned int input_pos,
+void LookupSession::get_analyses(unsigned int input_pos,
                               unsigned int output_pos,
                               TransitionTableIndex i)
 {
@@ -541,7 +631,9 @@ void Transducer::get_analyses(unsigned int input_pos,
     }
     if (max_time > 0.0) {
         // quit if we've overspent our time
-        if ((((double) clock() - start_clock) / CLOCKS_PER_SEC) > max_time) {
+        std::chrono::duration<double> spent =
+            std::chrono::steady_clock::now() - start_clock;
+        if (spent.count() > max_time) {
             return;
         }
     }
@@ -553,9 +645,9 @@ void Transducer::get_analyses(unsigned int input_pos,
         if (input_tape[input_pos] == NO_SYMBOL_NUMBER) {
             if (max_lookups < 0 || (ssize_t)lookup_paths->size() < max_lookups) {
                 output_tape.write(output_pos, NO_SYMBOL_NUMBER, NO_SYMBOL_NUMBER);
-                if (tables->get_transition_finality(i)) {
+                if (tables.get_transition_finality(i)) {
                     Weight old_weight = current_weight;
-                    current_weight += tables->get_weight(i);
+                    current_weight += tables.get_weight(i);
                     note_analysis();
                     current_weight = old_weight;
                 }
@@ -576,25 +668,25 @@ void Transducer::get_analyses(unsigned int input_pos,
         SymbolNumber input = input_tape[input_pos];
         ++input_pos;
 
-        if (input < alphabet->get_orig_symbol_count()) {
+        if (input < alphabet.get_orig_symbol_count()) {
             // Input is in the alphabet
             find_transitions(input,
                              input_pos,
                              output_pos,
                              i+1);
         } else {
-            if (alphabet->get_identity_symbol() != NO_SYMBOL_NUMBER) {
-                find_transitions(alphabet->get_identity_symbol(),
+            if (alphabet.get_identity_symbol() != NO_SYMBOL_NUMBER) {
+                find_transitions(alphabet.get_identity_symbol(),
                                  input_pos, output_pos, i+1);
             }
-            if (alphabet->get_unknown_symbol() != NO_SYMBOL_NUMBER) {
-                find_transitions(alphabet->get_unknown_symbol(),
+            if (alphabet.get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+                find_transitions(alphabet.get_unknown_symbol(),
                                  input_pos, output_pos, i+1);
             }
         }
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER &&
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER &&
             !found_transition) {
-            find_transitions(alphabet->get_default_symbol(),
+            find_transitions(alphabet.get_default_symbol(),
                              input_pos, output_pos, i+1);
         }
     }
@@ -603,9 +695,9 @@ void Transducer::get_analyses(unsigned int input_pos,
         if (input_tape[input_pos] == NO_SYMBOL_NUMBER) {
             if (max_lookups < 0 || (ssize_t)lookup_paths->size() < max_lookups) {
                 output_tape.write(output_pos, NO_SYMBOL_NUMBER, NO_SYMBOL_NUMBER);
-                if (tables->get_index_finality(i)) {
+                if (tables.get_index_finality(i)) {
                     Weight old_weight = current_weight;
-                    current_weight += tables->get_final_weight(i);
+                    current_weight += tables.get_final_weight(i);
                     note_analysis();
                     current_weight = old_weight;
                 }
@@ -624,23 +716,23 @@ void Transducer::get_analyses(unsigned int input_pos,
         SymbolNumber input = input_tape[input_pos];
         ++input_pos;
 
-        if (input < alphabet->get_orig_symbol_count()) {
+        if (input < alphabet.get_orig_symbol_count()) {
             // Input is in the alphabet
             find_index(input, input_pos, output_pos, i+1);
         } else {
-            if (alphabet->get_identity_symbol() != NO_SYMBOL_NUMBER) {
-                find_index(alphabet->get_identity_symbol(),
+            if (alphabet.get_identity_symbol() != NO_SYMBOL_NUMBER) {
+                find_index(alphabet.get_identity_symbol(),
                            input_pos, output_pos, i+1);
             }
-            if (alphabet->get_unknown_symbol() != NO_SYMBOL_NUMBER) {
-                find_index(alphabet->get_unknown_symbol(),
+            if (alphabet.get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+                find_index(alphabet.get_unknown_symbol(),
                            input_pos, output_pos, i+1);
             }
         }
         // If we have a default symbol defined and we didn't find an index,
         // check for that
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
-            find_index(alphabet->get_default_symbol(),
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
+            find_index(alphabet.get_default_symbol(),
                        input_pos, output_pos, i+1);
         }
     }
@@ -648,49 +740,535 @@ void Transducer::get_analyses(unsigned int input_pos,
     ++recursion_depth_left;
 }
 
-void Transducer::note_analysis(void)
+void LookupSession::note_analysis(void)
 {
     HfstTwoLevelPath result;
     for (DoubleTape::const_iterator it = output_tape.begin();
          it->output != NO_SYMBOL_NUMBER; ++it) {
-        result.second.push_back(StringPair(alphabet->string_from_symbol(it->input),
-                                           alphabet->string_from_symbol(it->output)));
+        result.second.push_back(StringPair(string_from_symbol(it->input),
+                                           string_from_symbol(it->output)));
     }
     result.first = current_weight;
     lookup_paths->insert(result);
 }
 
+// Whether any transition or final weight of a weighted transducer is
+// negative, in which case a path can't be abandoned for being too heavy
+static bool has_negative_weights(const TransducerHeader & header,
+                                 const TransducerTablesInterface & tables)
+{
+    if (!header.probe_flag(Weighted)) {
+        return false;
+    }
+    for (TransitionTableIndex i = 0; i < header.index_table_size(); ++i) {
+        if (tables.get_index_finality(i) && tables.get_final_weight(i) < 0) {
+            return true;
+        }
+    }
+    for (TransitionTableIndex i = 0; i < header.target_table_size(); ++i) {
+        if (tables.get_weight(i) < 0 &&
+            (tables.get_transition_input(i) != NO_SYMBOL_NUMBER ||
+             tables.get_transition_finality(i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Transducer::has_negative_weights(void) const
+{
+    return hfst_ol::has_negative_weights(*header, *tables);
+}
+
+template <class T>
+static void append_bytes(std::string & s, const T & value)
+{
+    s.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+CascadeLookupSession::CascadeLookupSession(
+    const std::vector<const Transducer *> & cascade):
+    levels(), encoder(*cascade.front()->encoder),
+    symbols(), symbol_map(), alphabet_symbol_count(0),
+    input_tape(), first_input_tape(), output_tape(), current_weight(0.0),
+    lookup_paths(NULL), active_configurations(), dead_ends(), cut_count(0),
+    cycle_count(0), analysis_count(0),
+    nonnegative_weights(true), weight_beam(-1.0), best_weight(0.0),
+    max_lookups(-1), recursion_depth_left(MAX_RECURSION_DEPTH),
+    max_time(0.0), start_clock()
+{
+    // Epsilon is 0 in every transducer and in the cascade
+    add_symbol("");
+    for (std::vector<const Transducer *>::const_iterator it = cascade.begin();
+         it != cascade.end(); ++it) {
+        Level level;
+        level.alphabet = (*it)->alphabet;
+        level.tables = (*it)->tables;
+        level.state = 0;
+        level.flag_state = level.alphabet->get_fd_table();
+        const SymbolTable & table = level.alphabet->get_symbol_table();
+        level.output_symbols.push_back(0);
+        for (size_t s = 1; s < table.size(); ++s) {
+            level.output_symbols.push_back(add_symbol(table[s]));
+        }
+        levels.push_back(level);
+        if (has_negative_weights(*(*it)->header, *(*it)->tables)) {
+            nonnegative_weights = false;
+        }
+    }
+    alphabet_symbol_count = hfst::size_t_to_uint(symbols.size());
+    for (std::vector<Level>::iterator it = levels.begin();
+         it != levels.end(); ++it) {
+        it->input_symbols.assign(alphabet_symbol_count, NO_SYMBOL_NUMBER);
+        for (SymbolNumber s = 1; s < it->alphabet->get_orig_symbol_count();
+             ++s) {
+            if (!it->alphabet->is_flag_diacritic(s)) {
+                it->input_symbols[it->output_symbols[s]] = s;
+            }
+        }
+    }
+}
+
+SymbolNumber CascadeLookupSession::add_symbol(const std::string & symbol)
+{
+    StringSymbolMap::const_iterator it = symbol_map.find(symbol);
+    if (it != symbol_map.end()) {
+        return it->second;
+    }
+    SymbolNumber s = hfst::size_t_to_uint(symbols.size());
+    symbols.push_back(symbol);
+    symbol_map[symbol] = s;
+    return s;
+}
+
+bool CascadeLookupSession::initialize_input(const char * input)
+{
+    // Forget the unknown symbols of the previous input
+    for (size_t s = alphabet_symbol_count; s < symbols.size(); ++s) {
+        symbol_map.erase(symbols[s]);
+    }
+    symbols.resize(alphabet_symbol_count);
+    input_tape.clear();
+    first_input_tape.clear();
+    char * input_str = const_cast<char *>(input);
+    char ** input_str_ptr = &input_str;
+    while (**input_str_ptr != 0) {
+        char * original_input_loc = *input_str_ptr;
+        SymbolNumber k = encoder.find_key(input_str_ptr);
+        if (k == NO_SYMBOL_NUMBER) {
+            // An unknown utf-8 symbol, which a later transducer may
+            // still know
+            *input_str_ptr = original_input_loc;
+            int bytes_to_tokenize = nByte_utf8(**input_str_ptr);
+            if (bytes_to_tokenize == 0) {
+                return false; // tokenization failed
+            }
+            std::string new_symbol(*input_str_ptr, bytes_to_tokenize);
+            (*input_str_ptr) += bytes_to_tokenize;
+            input_tape.push_back(add_symbol(new_symbol));
+        } else {
+            input_tape.push_back(levels.front().output_symbols[k]);
+        }
+        first_input_tape.push_back(k);
+    }
+    input_tape.push_back(NO_SYMBOL_NUMBER);
+    return true;
+}
+
+std::string CascadeLookupSession::configuration_key(const Continuation & c)
+{
+    std::string key;
+    append_bytes(key, c.kind);
+    append_bytes(key, c.level);
+    append_bytes(key, c.symbol);
+    append_bytes(key, c.input_pos);
+    append_bytes(key, c.next);
+    for (std::vector<Level>::const_iterator it = levels.begin();
+         it != levels.end(); ++it) {
+        append_bytes(key, it->state);
+        const hfst::FdValues & flags = it->flag_state.get_value_array();
+        for (const hfst::FdValue * f = flags.begin(); f != flags.end(); ++f) {
+            append_bytes(key, *f);
+        }
+    }
+    return key;
+}
+
+bool CascadeLookupSession::enter(const Continuation & c, std::string & key)
+{
+    bool out_of_time = false;
+    if (max_time > 0.0) {
+        std::chrono::duration<double> spent =
+            std::chrono::steady_clock::now() - start_clock;
+        out_of_time = spent.count() > max_time;
+    }
+    if (recursion_depth_left == 0 || out_of_time ||
+        (max_lookups >= 0 && (ssize_t)lookup_paths->size() >= max_lookups) ||
+        (weight_beam >= 0.0 && nonnegative_weights && analysis_count > 0 &&
+         current_weight > best_weight + weight_beam)) {
+        ++cut_count;
+        return false;
+    }
+    key = configuration_key(c);
+    // Configurations that are waiting for nothing else are the same
+    // whichever way they were reached
+    if (c.next == NULL && dead_ends.count(key) == 1) {
+        return false;
+    }
+    if (!active_configurations.insert(key).second) {
+        // Back in a configuration through epsilon transitions, ie. going
+        // around a cycle of the product
+        ++cut_count;
+        ++cycle_count;
+        return false;
+    }
+    --recursion_depth_left;
+    return true;
+}
+
+void CascadeLookupSession::leave(const std::string & key)
+{
+    active_configurations.erase(key);
+    ++recursion_depth_left;
+}
+
+TransitionTableIndex CascadeLookupSession::find_transitions(
+    const Level & level, SymbolNumber input) const
+{
+    TransitionTableIndex i = level.state;
+    if (indexes_transition_table(i)) {
+        i -= TRANSITION_TARGET_TABLE_START;
+        if (level.tables->get_transition_input(i + 1) == input) {
+            return i + 1;
+        }
+    } else if (level.tables->get_index_input(i + 1 + input) == input) {
+        return level.tables->get_index_target(i + 1 + input) -
+            TRANSITION_TARGET_TABLE_START;
+    }
+    return NO_TABLE_INDEX;
+}
+
+bool CascadeLookupSession::is_final(const Level & level, Weight & weight) const
+{
+    TransitionTableIndex i = level.state;
+    if (indexes_transition_table(i)) {
+        i -= TRANSITION_TARGET_TABLE_START;
+        if (!level.tables->get_transition_finality(i)) {
+            return false;
+        }
+        weight = level.tables->get_weight(i);
+    } else {
+        if (!level.tables->get_index_finality(i)) {
+            return false;
+        }
+        weight = level.tables->get_final_weight(i);
+    }
+    return true;
+}
+
+void CascadeLookupSession::resume(const Continuation * c)
+{
+    switch (c->kind) {
+    case Continuation::Input:
+        read_input(c->input_pos);
+        break;
+    case Continuation::Deliver:
+        deliver(c->level, c->symbol, c->next);
+        break;
+    case Continuation::Flush:
+        flush(c->level);
+        break;
+    }
+}
+
+// All the transducers are between symbols; the first one reads the
+// input at input_pos
+void CascadeLookupSession::read_input(unsigned int input_pos)
+{
+    if (input_tape[input_pos] == NO_SYMBOL_NUMBER) {
+        flush(0);
+        return;
+    }
+    Continuation again(Continuation::Input, 0, 0, input_pos, NULL);
+    std::string key;
+    if (!enter(again, key)) {
+        return;
+    }
+    unsigned long analyses = analysis_count;
+    unsigned long cuts = cut_count;
+    try_epsilons(0, &again);
+    Continuation advance(Continuation::Input, 0, 0, input_pos + 1, NULL);
+    consume(0, first_input_tape[input_pos], input_tape[input_pos], &advance);
+    if (analysis_count == analyses && cut_count == cuts) {
+        dead_ends.insert(key);
+    }
+    leave(key);
+}
+
+// The transducer at level has to read symbol, which the previous one
+// wrote, before next can go on
+void CascadeLookupSession::deliver(size_t level, SymbolNumber symbol,
+                                   const Continuation * next)
+{
+    Continuation again(Continuation::Deliver, level, symbol, 0, next);
+    std::string key;
+    if (!enter(again, key)) {
+        return;
+    }
+    try_epsilons(level, &again);
+    const Level & l = levels[level];
+    consume(level, symbol < l.input_symbols.size() ?
+            l.input_symbols[symbol] : NO_SYMBOL_NUMBER, symbol, next);
+    leave(key);
+}
+
+// The transducers before level have finished in a final state; the rest
+// may still take epsilon transitions before finishing
+void CascadeLookupSession::flush(size_t level)
+{
+    if (level == levels.size()) {
+        note_analysis();
+        return;
+    }
+    Continuation again(Continuation::Flush, level, 0, 0, NULL);
+    std::string key;
+    if (!enter(again, key)) {
+        return;
+    }
+    unsigned long analyses = analysis_count;
+    unsigned long cuts = cut_count;
+    try_epsilons(level, &again);
+    Weight weight;
+    if (is_final(levels[level], weight)) {
+        Weight old_weight = current_weight;
+        current_weight += weight;
+        flush(level + 1);
+        current_weight = old_weight;
+    }
+    if (analysis_count == analyses && cut_count == cuts) {
+        dead_ends.insert(key);
+    }
+    leave(key);
+}
+
+void CascadeLookupSession::try_epsilons(size_t level,
+                                        const Continuation * then)
+{
+    Level & l = levels[level];
+    TransitionTableIndex i = l.state;
+    if (indexes_transition_table(i)) {
+        i = i - TRANSITION_TARGET_TABLE_START + 1;
+    } else {
+        i = find_transitions(l, 0);
+        if (i == NO_TABLE_INDEX) {
+            return;
+        }
+    }
+    // Flags are only passed on from the last transducer, as output
+    bool last = level + 1 == levels.size();
+    while (true) {
+        SymbolNumber input = l.tables->get_transition_input(i);
+        if (input == 0) {
+            take(level, i,
+                 l.output_symbols[l.tables->get_transition_output(i)], then);
+        } else if (l.alphabet->is_flag_diacritic(input)) {
+            hfst::FdValues flags = l.flag_state.get_value_array();
+            if (l.flag_state.apply_operation(
+                    *(l.alphabet->get_operation(input)))) {
+                take(level, i, last ?
+                     l.output_symbols[l.tables->get_transition_output(i)] : 0,
+                     then);
+            }
+            l.flag_state.assign_values(flags);
+        } else {
+            return;
+        }
+        ++i;
+    }
+}
+
+void CascadeLookupSession::consume(size_t level, SymbolNumber input,
+                                   SymbolNumber symbol,
+                                   const Continuation * then)
+{
+    const Level & l = levels[level];
+    bool found_transition = false;
+    if (input != NO_SYMBOL_NUMBER) {
+        found_transition = try_symbol(level, input, symbol, then);
+    } else {
+        if (l.alphabet->get_identity_symbol() != NO_SYMBOL_NUMBER) {
+            found_transition |= try_symbol(
+                level, l.alphabet->get_identity_symbol(), symbol, then);
+        }
+        if (l.alphabet->get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+            found_transition |= try_symbol(
+                level, l.alphabet->get_unknown_symbol(), symbol, then);
+        }
+    }
+    if (!found_transition &&
+        l.alphabet->get_default_symbol() != NO_SYMBOL_NUMBER) {
+        try_symbol(level, l.alphabet->get_default_symbol(), symbol, then);
+    }
+}
+
+bool CascadeLookupSession::try_symbol(size_t level, SymbolNumber input,
+                                      SymbolNumber symbol,
+                                      const Continuation * then)
+{
+    const Level & l = levels[level];
+    TransitionTableIndex i = find_transitions(l, input);
+    if (i == NO_TABLE_INDEX) {
+        return false;
+    }
+    while (l.tables->get_transition_input(i) == input) {
+        SymbolNumber output = l.tables->get_transition_output(i);
+        // Default, identity and unknown write the symbol they read
+        take(level, i, l.alphabet->is_meta_arc(output) ?
+             symbol : l.output_symbols[output], then);
+        ++i;
+    }
+    return true;
+}
+
+void CascadeLookupSession::take(size_t level, TransitionTableIndex i,
+                                SymbolNumber output,
+                                const Continuation * then)
+{
+    Level & l = levels[level];
+    TransitionTableIndex old_state = l.state;
+    Weight old_weight = current_weight;
+    l.state = l.tables->get_transition_target(i);
+    current_weight += l.tables->get_weight(i);
+    emit(level, output, then);
+    l.state = old_state;
+    current_weight = old_weight;
+}
+
+void CascadeLookupSession::emit(size_t level, SymbolNumber output,
+                                const Continuation * then)
+{
+    if (level + 1 == levels.size()) {
+        output_tape.push_back(output);
+        resume(then);
+        output_tape.pop_back();
+    } else if (output == 0) {
+        resume(then);
+    } else {
+        deliver(level + 1, output, then);
+    }
+}
+
+void CascadeLookupSession::note_analysis(void)
+{
+    if (max_lookups >= 0 && (ssize_t)lookup_paths->size() >= max_lookups) {
+        ++cut_count;
+        return;
+    }
+    HfstOneLevelPath result;
+    for (SymbolNumberVector::const_iterator it = output_tape.begin();
+         it != output_tape.end(); ++it) {
+        result.second.push_back(symbols[*it]);
+    }
+    result.first = current_weight;
+    lookup_paths->insert(result);
+    if (analysis_count == 0 || current_weight < best_weight) {
+        best_weight = current_weight;
+    }
+    ++analysis_count;
+}
+
+HfstOneLevelPaths * CascadeLookupSession::lookup_fd(const StringVector & s,
+                                                    ssize_t limit,
+                                                    double time_cutoff,
+                                                    Weight beam)
+{
+    std::string input_str;
+    for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
+        input_str.append(*it);
+    }
+    return lookup_fd(input_str, limit, time_cutoff, beam);
+}
+
+HfstOneLevelPaths * CascadeLookupSession::lookup_fd(const std::string & s,
+                                                    ssize_t limit,
+                                                    double time_cutoff,
+                                                    Weight beam)
+{
+    max_lookups = limit;
+    max_time = 0.0;
+    if (time_cutoff > 0.0) {
+        max_time = time_cutoff;
+        start_clock = std::chrono::steady_clock::now();
+    }
+    weight_beam = beam;
+    current_weight = 0.0;
+    recursion_depth_left = MAX_RECURSION_DEPTH;
+    cut_count = 0;
+    cycle_count = 0;
+    analysis_count = 0;
+    for (std::vector<Level>::iterator it = levels.begin();
+         it != levels.end(); ++it) {
+        it->state = 0;
+        it->flag_state = it->alphabet->get_fd_table();
+    }
+    output_tape.clear();
+    HfstOneLevelPaths * results = new HfstOneLevelPaths;
+    if (!initialize_input(s.c_str())) {
+        return results;
+    }
+    lookup_paths = results;
+    read_input(0);
+    lookup_paths = NULL;
+    active_configurations.clear();
+    dead_ends.clear();
+    return results;
+}
+
+static unsigned long next_serial(void)
+{
+    static std::atomic<unsigned long> serial_counter(1);
+    return serial_counter++;
+}
+
 Transducer::Transducer():
     header(NULL), alphabet(NULL), tables(NULL),
-    current_weight(0.0), lookup_paths(NULL), encoder(NULL),
-    input_tape(), output_tape(),
-    flag_state(), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH){}
+    encoder(NULL), session(NULL), inverse(NULL), serial(next_serial()) {}
 
 Transducer::Transducer(std::istream& is):
     header(new TransducerHeader(is)),
     alphabet(new TransducerAlphabet(is, header->symbol_count())),
-    tables(NULL), current_weight(0.0), lookup_paths(NULL),
+    tables(NULL),
     encoder(new Encoder(alphabet->get_symbol_table(),
                         header->input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet->get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
 {
     load_tables(is);
 }
 
 
+Transducer::Transducer(std::istream& is, const std::string & filename):
+    header(new TransducerHeader(is)),
+    alphabet(new TransducerAlphabet(is, header->symbol_count())),
+    tables(NULL),
+    encoder(new Encoder(alphabet->get_symbol_table(),
+                        header->input_symbol_count())),
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
+{
+    map_tables(is, filename);
+}
+
 Transducer::Transducer(bool weighted):
     header(new TransducerHeader(weighted)),
     alphabet(new TransducerAlphabet()),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet->get_symbol_table(),
                         header->input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet->get_fd_table()), found_transition(false),
-    max_lookups(-1), recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
 {
     if(weighted)
         tables = new TransducerTables<TransitionWIndex,TransitionW>();
@@ -706,13 +1284,11 @@ Transducer::Transducer(const TransducerHeader& header,
     alphabet(new TransducerAlphabet(alphabet)),
     tables(new TransducerTables<TransitionIndex,Transition>(
                index_table, transition_table)),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet.get_symbol_table(),
                         header.input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet.get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
 {}
 
 Transducer::Transducer(const TransducerHeader& header,
@@ -723,23 +1299,88 @@ Transducer::Transducer(const TransducerHeader& header,
     alphabet(new TransducerAlphabet(alphabet)),
     tables(new TransducerTables<TransitionWIndex,TransitionW>(
                index_table, transition_table)),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet.get_symbol_table(),
                         header.input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet.get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
 {}
 
+Transducer::Transducer(const Transducer& t):
+    header(new TransducerHeader(*t.header)),
+    alphabet(new TransducerAlphabet(*t.alphabet)),
+    tables(t.tables->share()),
+    encoder(new Encoder(alphabet->get_symbol_table(),
+                        header->input_symbol_count())),
+    session(NULL),
+    inverse(NULL),
+    serial(next_serial())
+{
+    // Mapped tables are shared, others copied
+    if (tables == NULL) {
+        // The copy_*_table() accessors only read t
+        Transducer & source = const_cast<Transducer &>(t);
+        if (header->probe_flag(Weighted)) {
+            tables = new TransducerTables<TransitionWIndex,TransitionW>(
+                source.copy_windex_table(), source.copy_transitionw_table());
+        } else {
+            tables = new TransducerTables<TransitionIndex,Transition>(
+                source.copy_index_table(), source.copy_transition_table());
+        }
+    }
+    if (t.inverse != NULL) {
+        inverse = new Transducer(*t.inverse);
+    }
+}
+
 Transducer::~Transducer()
 {
+    delete inverse;
+    delete session;
     delete header;
     delete alphabet;
     delete tables;
     delete encoder;
 }
 
+void Transducer::set_inverse(Transducer * t)
+{
+    if (t != inverse) {
+        delete inverse;
+        inverse = t;
+    }
+}
+
+Transducer * Transducer::get_or_build_inverse
+(const std::function<Transducer *(Transducer *)> & build)
+{
+    std::call_once(inverse_once, [&]() {
+            if (inverse == NULL) {
+                inverse = build(this);
+            }
+        });
+    return inverse;
+}
+
+float Transducer::get_index_fill_ratio(void) const
+{
+    TransitionTableIndex packed = header->index_table_size();
+    if (packed > header->input_symbol_count()) {
+        packed -= header->input_symbol_count();
+    }
+    if (packed == 0) {
+        return 1.0;
+    }
+    TransitionTableIndex filled = 0;
+    for (TransitionTableIndex i = 0; i < packed; ++i) {
+        if (tables->get_index_input(i) != NO_SYMBOL_NUMBER ||
+            tables->get_index_finality(i)) {
+            ++filled;
+        }
+    }
+    return (float)filled / packed;
+}
+
 TransducerTable<TransitionWIndex> Transducer::copy_windex_table()
 {
     if (!header->probe_flag(Weighted)) {
@@ -773,7 +1414,8 @@ TransducerTable<TransitionIndex> Transducer::copy_index_table()
     }
     TransducerTable<TransitionIndex> another;
     for (unsigned int i = 0; i < header->index_table_size(); ++i) {
-        another.append(tables->get_index(i));
+        another.append(TransitionIndex(tables->get_index_input(i),
+                                       tables->get_index_target(i)));
     }
     return another;
 }
@@ -784,7 +1426,9 @@ TransducerTable<Transition> Transducer::copy_transition_table()
     }
     TransducerTable<Transition> another;
     for (unsigned int i = 0; i < header->target_table_size(); ++i) {
-        another.append(tables->get_transition(i));
+        another.append(Transition(tables->get_transition_input(i),
+                                  tables->get_transition_output(i),
+                                  tables->get_transition_target(i)));
     }
     return another;
 }
@@ -803,18 +1447,96 @@ void Transducer::load_tables(std::istream& is)
     }
 }
 
+void Transducer::map_tables(std::istream& is, const std::string & filename)
+{
+    std::streamoff offset = is.tellg();
+    if (offset < 0) {
+        HFST_THROW(StreamNotReadableException);
+    }
+    size_t index_bytes = (header->probe_flag(Weighted) ?
+                          TransitionWIndex::size : TransitionIndex::size)
+        * header->index_table_size();
+    size_t transition_bytes = (header->probe_flag(Weighted) ?
+                               TransitionW::size : Transition::size)
+        * header->target_table_size();
+    MappedFile * mapping = new MappedFile(filename);
+    if ((size_t)offset + index_bytes + transition_bytes
+        > mapping->get_length()) {
+        delete mapping;
+        HFST_THROW(TransducerHasWrongTypeException);
+    }
+    if(header->probe_flag(Weighted))
+        tables = new MappedTransducerTables<TransitionWIndex,TransitionW>(
+            mapping, (size_t)offset, header->index_table_size());
+    else
+        tables = new MappedTransducerTables<TransitionIndex,Transition>(
+            mapping, (size_t)offset, header->index_table_size());
+    // leave the stream where reading the tables would have left it
+    is.seekg(index_bytes + transition_bytes, std::ios::cur);
+    if(!is) {
+        HFST_THROW(TransducerHasWrongTypeException);
+    }
+}
+
+#ifndef _MSC_VER
+MappedFile::MappedFile(const std::string & filename):
+    data(NULL), length(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        HFST_THROW_MESSAGE(StreamNotReadableException, filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        HFST_THROW_MESSAGE(StreamNotReadableException, filename);
+    }
+    length = (size_t)st.st_size;
+    if (length > 0) {
+        data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED || data == NULL) {
+        data = NULL;
+        HFST_THROW_MESSAGE(StreamNotReadableException, filename);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != NULL) {
+        munmap(data, length);
+    }
+}
+#else
+MappedFile::MappedFile(const std::string & filename):
+    data(NULL), length(0)
+{
+    (void)filename;
+    HFST_THROW_MESSAGE(FunctionNotImplementedException,
+                       "memory-mapped optimized-lookup transducers");
+}
+
+MappedFile::~MappedFile() {}
+#endif
+
 void Transducer::write(std::ostream& os) const
 {
     header->write(os);
     alphabet->write(os);
+    bool weighted = header->probe_flag(Weighted);
     for(size_t i=0;i<header->index_table_size();i++)
-      tables->get_index(hfst::size_t_to_uint(i)).write(os, header->probe_flag(Weighted));
+      get_index(hfst::size_t_to_uint(i)).write(os, weighted);
     for(size_t i=0;i<header->target_table_size();i++)
-      tables->get_transition(hfst::size_t_to_uint(i)).write(os, header->probe_flag(Weighted));
+      get_transition(hfst::size_t_to_uint(i)).write(os, weighted);
 }
 
 Transducer * Transducer::copy(Transducer * t, bool weighted)
 {
+    if (weighted == t->get_header().probe_flag(Weighted)) {
+        return new Transducer(*t);
+    }
     Transducer * another;
     if (weighted) {
         another = new Transducer(
@@ -979,7 +1701,7 @@ Weight Transducer::final_weight(const TransitionTableIndex i) const
     if (i >= TRANSITION_TARGET_TABLE_START) {
         return get_transition(i - TRANSITION_TARGET_TABLE_START).get_weight();
     } else {
-        return get_index(i).final_weight();
+        return tables->get_final_weight(i);
     }
 }
 
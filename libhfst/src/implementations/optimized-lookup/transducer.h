@@ -28,8 +28,14 @@
 #include <utility>
 #include <deque>
 #include <queue>
+#include <functional>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <time.h>
+#include <chrono>
 
 #include "../../HfstExceptionDefs.h"
 #include "../../HfstFlagDiacritics.h"
@@ -78,8 +84,8 @@ class STransition;
 struct TraversalState
 {
     TransitionTableIndex index;
-    FlagDiacriticState flags;
-    TraversalState(TransitionTableIndex i, FlagDiacriticState f):
+    hfst::FdValues flags;
+    TraversalState(TransitionTableIndex i, const hfst::FdValues & f):
         index(i), flags(f) {}
     bool operator==(const TraversalState & rhs) const;
     bool operator<(const TraversalState & rhs) const;
@@ -681,12 +687,21 @@ public:
 class TransducerTablesInterface
 {
 public:
+    /* How the entries are stored. Transducer reads in-memory tables
+       directly instead of through the virtual accessors. */
+    enum Storage { InMemory, InMemoryWeighted, Other };
+protected:
+    Storage storage;
+public:
+    TransducerTablesInterface(Storage storage = Other): storage(storage) {}
     virtual ~TransducerTablesInterface() {}
+
+    Storage get_storage(void) const { return storage; }
+
+    // Another handle to the same entries, for tables that can be shared
+    // without copying them, otherwise NULL
+    virtual TransducerTablesInterface * share(void) const { return NULL; }
   
-    virtual const TransitionIndex& get_index(
-        TransitionTableIndex i) const = 0;
-    virtual const Transition& get_transition(
-        TransitionTableIndex i) const = 0;
     virtual Weight get_weight(
         TransitionTableIndex i) const = 0;
     virtual SymbolNumber get_transition_input(
@@ -709,6 +724,11 @@ public:
     virtual void display() const {}
 };
 
+inline TransducerTablesInterface::Storage storage_of(const TransitionIndex *)
+{ return TransducerTablesInterface::InMemory; }
+inline TransducerTablesInterface::Storage storage_of(const TransitionWIndex *)
+{ return TransducerTablesInterface::InMemoryWeighted; }
+
 template <class T1, class T2>
 class TransducerTables : public TransducerTablesInterface
 {
@@ -718,19 +738,23 @@ protected:
 public:
     TransducerTables(std::istream& is, TransitionTableIndex index_table_size,
                      TransitionTableIndex transition_table_size):
+        TransducerTablesInterface(storage_of(static_cast<T1 *>(NULL))),
         index_table(
             is, index_table_size),
         transition_table(is, transition_table_size) { }
     
-    TransducerTables(): index_table(1, T1::create_final()),
-                        transition_table() {}
+    TransducerTables():
+        TransducerTablesInterface(storage_of(static_cast<T1 *>(NULL))),
+        index_table(1, T1::create_final()),
+        transition_table() {}
     TransducerTables(const TransducerTable<T1>& index_table,
                      const TransducerTable<T2>& transition_table):
+        TransducerTablesInterface(storage_of(static_cast<T1 *>(NULL))),
         index_table(index_table), transition_table(transition_table) {}
 
-    const TransitionIndex& get_index(TransitionTableIndex i) const
+    const T1& get_index(TransitionTableIndex i) const
         {return index_table[i];}
-    const Transition& get_transition(TransitionTableIndex i) const
+    const T2& get_transition(TransitionTableIndex i) const
         {return transition_table[i];}
     Weight get_weight(TransitionTableIndex i) const
         { return transition_table[i].get_weight(); }
@@ -760,6 +784,81 @@ public:
         }
 };
 
+/* A read-only memory map of a whole file */
+class MappedFile
+{
+private:
+    void * data;
+    size_t length;
+    // not copyable
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+public:
+    MappedFile(const std::string & filename);
+    ~MappedFile();
+
+    const char * get_data(void) const
+        { return static_cast<const char *>(data); }
+    size_t get_length(void) const { return length; }
+};
+
+/* Tables that are read in place from a MappedFile, which they own
+   together with the tables share()d from them. Entries are decoded from
+   the mapped bytes when accessed, so loading or copying copies nothing
+   and every process mapping the same file shares its pages. */
+template <class T1, class T2>
+class MappedTransducerTables : public TransducerTablesInterface
+{
+protected:
+    std::shared_ptr<const MappedFile> mapping;
+    const char * index_table;
+    const char * transition_table;
+
+    T1 index_at(TransitionTableIndex i) const
+        {
+            if (i >= TRANSITION_TARGET_TABLE_START) {
+                i -= TRANSITION_TARGET_TABLE_START;
+            }
+            return T1(const_cast<char *>(index_table + T1::size * i));
+        }
+    T2 transition_at(TransitionTableIndex i) const
+        {
+            if (i >= TRANSITION_TARGET_TABLE_START) {
+                i -= TRANSITION_TARGET_TABLE_START;
+            }
+            return T2(const_cast<char *>(transition_table + T2::size * i));
+        }
+public:
+    MappedTransducerTables(MappedFile * mapping, size_t offset,
+                           TransitionTableIndex index_table_size):
+        mapping(mapping),
+        index_table(mapping->get_data() + offset),
+        transition_table(mapping->get_data() + offset +
+                         T1::size * index_table_size) {}
+
+    TransducerTablesInterface * share(void) const
+        { return new MappedTransducerTables<T1,T2>(*this); }
+
+    Weight get_weight(TransitionTableIndex i) const
+        { return transition_at(i).get_weight(); }
+    SymbolNumber get_transition_input(TransitionTableIndex i) const
+        { return transition_at(i).get_input_symbol(); }
+    SymbolNumber get_transition_output(TransitionTableIndex i) const
+        { return transition_at(i).get_output_symbol(); }
+    TransitionTableIndex get_transition_target(TransitionTableIndex i) const
+        { return transition_at(i).get_target(); }
+    bool get_transition_finality(TransitionTableIndex i) const
+        { return transition_at(i).final(); }
+    SymbolNumber get_index_input(TransitionTableIndex i) const
+        { return index_at(i).get_input_symbol(); }
+    TransitionTableIndex get_index_target(TransitionTableIndex i) const
+        { return index_at(i).get_target(); }
+    bool get_index_finality(TransitionTableIndex i) const
+        { return index_at(i).final(); }
+    Weight get_final_weight(TransitionTableIndex i) const
+        { return index_at(i).final_weight(); }
+};
+
 
 // There follow some classes for implementing lookup
     
@@ -788,7 +887,7 @@ public:
     void add_string(const char * p,SymbolNumber symbol_key);
     bool has_key_starting_with(const char c) const;
     
-    SymbolNumber find_key(char ** p);
+    SymbolNumber find_key(char ** p) const;
     
 };
 
@@ -810,7 +909,7 @@ public:
             read_input_symbols(st);
         }
 
-    SymbolNumber find_key(char ** p);
+    SymbolNumber find_key(char ** p) const;
 
     friend class Transducer;
     friend class PmatchContainer;
@@ -893,7 +992,15 @@ public:
         }
 };
 
+class LookupSession;
+class CascadeLookupSession;
+
 /** \brief A compiled transducer format, suitable for fast lookup operations.
+
+    The per-query state of lookup is kept in a LookupSession. The lookup
+    methods of the transducer itself use a session of its own, so they
+    may not be called concurrently, but any number of separately
+    constructed sessions may look up in the same transducer at once.
  */
 class Transducer
 {
@@ -902,63 +1009,28 @@ protected:
     TransducerAlphabet* alphabet;
     TransducerTablesInterface* tables;
     void load_tables(std::istream& is);
+    void map_tables(std::istream& is, const std::string & filename);
 
     // for lookup
-    Weight current_weight;
-    HfstTwoLevelPaths * lookup_paths;
     Encoder * encoder;
-    Tape input_tape;
-    DoubleTape output_tape;
-    hfst::FdState<SymbolNumber> flag_state;
-    // This is to keep track of whether we're going to take a default transition
-    bool found_transition;
-    // For keeping a tally of previously epsilon-visited states to control
-    // going into loops
-    TraversalStates traversal_states;
+    LookupSession * session;
+    LookupSession & get_session(void);
 
-    ssize_t max_lookups;
-    unsigned int recursion_depth_left;
-    double max_time;
-    clock_t start_clock;
-
-    void try_epsilon_transitions(unsigned int input_tape_pos,
-                                 unsigned int output_tape_pos,
-                                 TransitionTableIndex i);
-  
-    void try_epsilon_indices(unsigned int input_tape_pos,
-                             unsigned int output_tape_pos,
-                             TransitionTableIndex i);
-
-    void find_transitions(SymbolNumber input,
-                          unsigned int input_tape_pos,
-                          unsigned int output_tape_pos,
-                          TransitionTableIndex i);
-
-    void find_index(SymbolNumber input,
-                    unsigned int input_tape_pos,
-                    unsigned int output_tape_pos,
-                    TransitionTableIndex i);
-    
-    void get_analyses(unsigned int input_tape_pos,
-                      unsigned int output_tape_pos,
-                      TransitionTableIndex i);
-    
-    void find_loop_epsilon_transitions(unsigned int input_pos,
-                                       TransitionTableIndex i);
-    void find_loop_epsilon_indices(unsigned int input_pos,
-                                   TransitionTableIndex i);
-    void find_loop_transitions(SymbolNumber input,
-                               unsigned int input_pos,
-                               TransitionTableIndex i);
-    void find_loop_index(SymbolNumber input,
-                         unsigned int input_pos,
-                         TransitionTableIndex i);
-    void find_loop(unsigned int input_pos,
-                   TransitionTableIndex i);
+    // The same transducer with its input and output sides swapped, for
+    // looking down; owned by this transducer
+    Transducer * inverse;
+    // Lets only one thread build the inverse when it is built lazily
+    std::once_flag inverse_once;
 
+    // Unique among all transducers constructed in this process
+    unsigned long serial;
 
 public:
     Transducer(std::istream& is);
+    /* Read the header and alphabet from \a is and serve the tables from a
+       memory map of \a filename, which must be the file \a is is reading.
+       \a is is left positioned after the transducer. */
+    Transducer(std::istream& is, const std::string & filename);
     Transducer(bool weighted);
     Transducer(Transducer * t);
     Transducer();
@@ -970,6 +1042,9 @@ public:
                const TransducerAlphabet& alphabet,
                const TransducerTable<TransitionWIndex>& index_table,
                const TransducerTable<TransitionW>& transition_table);
+    // Copies the tables (and lookdown inverse) of \a t but not its lookup
+    // state. Memory-mapped tables are shared instead.
+    Transducer(const Transducer& t);
     virtual ~Transducer();
 
     void write(std::ostream& os) const;
@@ -982,15 +1057,58 @@ public:
         { return *alphabet; }
     const Encoder& get_encoder(void) const
         { return *encoder; }
+    // Unlike the address, never reused by another transducer, so results
+    // can be kept by it after the transducer is gone
+    unsigned long get_serial(void) const
+        { return serial; }
     const hfst::FdTable<SymbolNumber>& get_fd_table() const
         { return alphabet->get_fd_table(); }
     const SymbolTable& get_symbol_table() const
         { return alphabet->get_symbol_table(); }
 
-    const TransitionIndex& get_index(TransitionTableIndex i) const
-        { return tables->get_index(i); }
-    const Transition& get_transition(TransitionTableIndex i) const
-        { return tables->get_transition(i); }
+    // For unweighted transducers the weights of these are zero, except
+    // for the final weight of an index, which is meaningless. In-memory
+    // tables are read without a virtual call.
+    TransitionWIndex get_index(TransitionTableIndex i) const
+        {
+            switch (tables->get_storage()) {
+            case TransducerTablesInterface::InMemoryWeighted:
+                return static_cast<const TransducerTables<
+                    TransitionWIndex,TransitionW> *>(tables)->get_index(i);
+            case TransducerTablesInterface::InMemory: {
+                const TransitionIndex & index = static_cast<
+                    const TransducerTables<TransitionIndex,Transition> *>(
+                        tables)->get_index(i);
+                return TransitionWIndex(index.get_input_symbol(),
+                                        index.get_target());
+            }
+            default:
+                return TransitionWIndex(tables->get_index_input(i),
+                                        tables->get_index_target(i));
+            }
+        }
+    TransitionW get_transition(TransitionTableIndex i) const
+        {
+            switch (tables->get_storage()) {
+            case TransducerTablesInterface::InMemoryWeighted:
+                return static_cast<const TransducerTables<
+                    TransitionWIndex,TransitionW> *>(
+                        tables)->get_transition(i);
+            case TransducerTablesInterface::InMemory: {
+                const Transition & transition = static_cast<
+                    const TransducerTables<TransitionIndex,Transition> *>(
+                        tables)->get_transition(i);
+                return TransitionW(transition.get_input_symbol(),
+                                   transition.get_output_symbol(),
+                                   transition.get_target(), 0.0);
+            }
+            default:
+                return TransitionW(tables->get_transition_input(i),
+                                   tables->get_transition_output(i),
+                                   tables->get_transition_target(i),
+                                   tables->get_weight(i));
+            }
+        }
     
     bool final_index(TransitionTableIndex i) const
         {
@@ -1004,9 +1122,15 @@ public:
         {
             return header->probe_flag(Has_input_epsilon_cycles);
         }
+    // Whether any transition or final weight is negative
+    bool has_negative_weights(void) const;
 
     bool is_lookup_infinitely_ambiguous(const StringVector & s);
     bool is_lookup_infinitely_ambiguous(const std::string & input);
+
+    // The share of the index table, apart from the padding at its end,
+    // taken up by transitions and final weights
+    float get_index_fill_ratio(void) const;
     
     TransducerTable<TransitionWIndex> copy_windex_table();
     TransducerTable<TransitionW> copy_transitionw_table();
@@ -1024,6 +1148,9 @@ public:
 
 
     bool initialize_input(const char * input_str);
+    /* Add \a sym to the alphabet and the encoder. This modifies the
+       transducer, so no session may be looking up in it at the same time.
+    */
     void include_symbol_in_alphabet(const std::string & sym);
     HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
         double time_cutoff = 0.0);
@@ -1039,7 +1166,6 @@ public:
                                         double time_cutoff = 0.0);
     HfstTwoLevelPaths * lookup_fd_pairs(const char * s, ssize_t limit = -1,
                                         double time_cutoff = 0.0);
-    void note_analysis(void);
 
     // Methods for supporting ospell
     SymbolNumber get_unknown_symbol(void) const
@@ -1062,8 +1188,259 @@ public:
     bool is_weighted(void)
         { return header->probe_flag(Weighted);}
 
+    /* The inverse of this transducer, which serves lookdown, or NULL if it
+       hasn't been built. Copies of the transducer don't share it. */
+    Transducer * get_inverse(void) const
+        { return inverse; }
+    /* Take ownership of \a t as the inverse of this transducer. */
+    void set_inverse(Transducer * t);
+    /* The inverse of this transducer, which \a build makes from it the
+       first time it is needed. Several threads may call this at the same
+       time; only one of them builds the inverse. */
+    Transducer * get_or_build_inverse
+        (const std::function<Transducer *(Transducer *)> & build);
+
     
     friend class ConvertTransducer;
+    friend class LookupSession;
+    friend class CascadeLookupSession;
+};
+
+/** \brief The scratch state of lookup in an optimized-lookup Transducer.
+
+    A session only reads the transducer it was constructed with, so one
+    transducer may be shared by several sessions, eg. one per thread,
+    without locking. A session itself must not be used by two threads at
+    the same time. Input symbols that are missing from the alphabet are
+    numbered locally in the session instead of being added to the
+    transducer.
+*/
+class LookupSession
+{
+protected:
+    const TransducerAlphabet & alphabet;
+    const TransducerTablesInterface & tables;
+    const Encoder & encoder;
+
+    // Symbols of the current input that the alphabet doesn't have,
+    // numbered from extra_symbol_base upwards
+    SymbolNumber extra_symbol_base;
+    SymbolTable extra_symbols;
+    StringSymbolMap extra_symbol_map;
+
+    Weight current_weight;
+    HfstTwoLevelPaths * lookup_paths;
+    Tape input_tape;
+    DoubleTape output_tape;
+    hfst::FdState<SymbolNumber> flag_state;
+    // This is to keep track of whether we're going to take a default transition
+    bool found_transition;
+    // For keeping a tally of previously epsilon-visited states to control
+    // going into loops
+    TraversalStates traversal_states;
+
+    ssize_t max_lookups;
+    unsigned int recursion_depth_left;
+    double max_time;
+    // Wall-clock rather than process time, so that sessions running in
+    // different threads don't use up each other's time budget
+    std::chrono::steady_clock::time_point start_clock;
+
+    void try_epsilon_transitions(unsigned int input_tape_pos,
+                                 unsigned int output_tape_pos,
+                                 TransitionTableIndex i);
+  
+    void try_epsilon_indices(unsigned int input_tape_pos,
+                             unsigned int output_tape_pos,
+                             TransitionTableIndex i);
+
+    void find_transitions(SymbolNumber input,
+                          unsigned int input_tape_pos,
+                          unsigned int output_tape_pos,
+                          TransitionTableIndex i);
+
+    void find_index(SymbolNumber input,
+                    unsigned int input_tape_pos,
+                    unsigned int output_tape_pos,
+                    TransitionTableIndex i);
+    
+    void get_analyses(unsigned int input_tape_pos,
+                      unsigned int output_tape_pos,
+                      TransitionTableIndex i);
+    
+    void find_loop_epsilon_transitions(unsigned int input_pos,
+                                       TransitionTableIndex i);
+    void find_loop_epsilon_indices(unsigned int input_pos,
+                                   TransitionTableIndex i);
+    void find_loop_transitions(SymbolNumber input,
+                               unsigned int input_pos,
+                               TransitionTableIndex i);
+    void find_loop_index(SymbolNumber input,
+                         unsigned int input_pos,
+                         TransitionTableIndex i);
+    void find_loop(unsigned int input_pos,
+                   TransitionTableIndex i);
+
+    void start_lookup(ssize_t limit, double time_cutoff);
+    void note_analysis(void);
+
+public:
+    LookupSession(const Transducer & t);
+
+    bool initialize_input(const char * input_str);
+    const std::string string_from_symbol(const SymbolNumber symbol) const;
+
+    HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    /* Tokenize and lookup, accounting for flag diacritics, the surface string
+       \a s. The return value, a pointer to HfstOneLevelPaths
+       (which is a set) of analyses, is newly allocated.
+    */
+    HfstOneLevelPaths * lookup_fd(const std::string & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    HfstOneLevelPaths * lookup_fd(const char * s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    HfstTwoLevelPaths * lookup_fd_pairs(const std::string & s,
+                                        ssize_t limit = -1,
+                                        double time_cutoff = 0.0);
+    HfstTwoLevelPaths * lookup_fd_pairs(const char * s, ssize_t limit = -1,
+                                        double time_cutoff = 0.0);
+
+    bool is_lookup_infinitely_ambiguous(const StringVector & s);
+    bool is_lookup_infinitely_ambiguous(const std::string & input);
+};
+
+/** \brief Lookup through a cascade of optimized-lookup transducers as if
+    they had been composed, without computing the composition.
+
+    Each symbol a transducer outputs is given to the next one as input as
+    soon as it is written, so the search walks the product of the
+    transducers one tuple of states at a time and never collects the
+    intermediate strings. Symbols are matched between the transducers by
+    their strings. Flag diacritics are obeyed within each transducer and
+    are not passed on to the next one. Tuples of states that have been
+    found not to lead to a result at some input position are remembered
+    for the rest of the lookup, so intermediate ambiguity that leads to
+    the same states is explored only once. Paths that come back to the
+    same tuple of states through epsilon transitions are abandoned, so
+    the results are finite.
+
+    Like a LookupSession, the session only reads its transducers.
+*/
+class CascadeLookupSession
+{
+protected:
+    struct Level
+    {
+        const TransducerAlphabet * alphabet;
+        const TransducerTablesInterface * tables;
+        // Cascade symbol number -> input symbol of this transducer, or
+        // NO_SYMBOL_NUMBER for symbols it doesn't know
+        SymbolNumberVector input_symbols;
+        // Symbol of this transducer -> cascade symbol number
+        SymbolNumberVector output_symbols;
+        TransitionTableIndex state;
+        hfst::FdState<SymbolNumber> flag_state;
+    };
+
+    // What to do once a transition has been taken and its output has
+    // been consumed by the rest of the cascade
+    struct Continuation
+    {
+        enum Kind { Input, Deliver, Flush };
+        Kind kind;
+        size_t level;
+        SymbolNumber symbol;
+        unsigned int input_pos;
+        const Continuation * next;
+        Continuation(Kind k, size_t l, SymbolNumber s, unsigned int i,
+                     const Continuation * n):
+            kind(k), level(l), symbol(s), input_pos(i), next(n) {}
+    };
+
+    std::vector<Level> levels;
+    const Encoder & encoder;
+
+    // The strings of all the symbols of the cascade; symbols of the input
+    // that none of the transducers know are added after
+    // alphabet_symbol_count for the duration of a lookup
+    SymbolTable symbols;
+    StringSymbolMap symbol_map;
+    SymbolNumber alphabet_symbol_count;
+
+    SymbolNumberVector input_tape;
+    // The input as the first transducer tokenized it. As in a
+    // LookupSession, symbols it has only on its output side are unknown
+    // to it here.
+    SymbolNumberVector first_input_tape;
+    SymbolNumberVector output_tape;
+    Weight current_weight;
+    HfstOneLevelPaths * lookup_paths;
+
+    // Configurations being explored, to back out of epsilon cycles, and
+    // configurations known not to lead to a result
+    std::set<std::string> active_configurations;
+    std::set<std::string> dead_ends;
+    // How many times the search has been cut short, since a
+    // configuration whose search was cut can't be known to be a dead end
+    unsigned long cut_count;
+    // How many of those times a path went around an epsilon cycle
+    unsigned long cycle_count;
+    unsigned long analysis_count;
+
+    bool nonnegative_weights;
+    Weight weight_beam;
+    Weight best_weight;
+
+    ssize_t max_lookups;
+    unsigned int recursion_depth_left;
+    double max_time;
+    std::chrono::steady_clock::time_point start_clock;
+
+    SymbolNumber add_symbol(const std::string & symbol);
+    bool initialize_input(const char * input);
+    std::string configuration_key(const Continuation & c);
+    bool enter(const Continuation & c, std::string & key);
+    void leave(const std::string & key);
+    TransitionTableIndex find_transitions(const Level & level,
+                                          SymbolNumber input) const;
+    bool is_final(const Level & level, Weight & weight) const;
+
+    void resume(const Continuation * c);
+    void read_input(unsigned int input_pos);
+    void deliver(size_t level, SymbolNumber symbol, const Continuation * next);
+    void flush(size_t level);
+    void try_epsilons(size_t level, const Continuation * then);
+    void consume(size_t level, SymbolNumber input, SymbolNumber symbol,
+                 const Continuation * then);
+    bool try_symbol(size_t level, SymbolNumber input, SymbolNumber symbol,
+                    const Continuation * then);
+    void take(size_t level, TransitionTableIndex i, SymbolNumber output,
+              const Continuation * then);
+    void emit(size_t level, SymbolNumber output, const Continuation * then);
+    void note_analysis(void);
+
+public:
+    /* The transducers, at least one, are given in the order in which
+       they are applied to the input; they must outlive the session. */
+    CascadeLookupSession(const std::vector<const Transducer *> & cascade);
+
+    /* Look up \a s, tokenized by the first transducer. With a
+       nonnegative \a beam, and if none of the transducers has negative
+       weights, paths that are already heavier than the best result by
+       more than \a beam are abandoned. The return value is newly
+       allocated. */
+    HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0,
+                                  Weight beam = -1.0);
+    HfstOneLevelPaths * lookup_fd(const std::string & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0,
+                                  Weight beam = -1.0);
+    /* Whether the last lookup abandoned a path that went around an
+       epsilon cycle, ie. whether the composition may have infinitely many
+       results for it. */
+    bool is_lookup_infinitely_ambiguous(void) const
+        { return cycle_count != 0; }
 };
 
 class STransition{
@@ -1202,64 +1579,54 @@ typedef std::priority_queue<StringWeightPair,
 
   };*/
 
+typedef size_t TreeNodeIndex;
+typedef size_t FlagStateIndex;
+const TreeNodeIndex NO_TREE_NODE = (TreeNodeIndex)-1;
+
+/* A node of the correction search. Nodes are kept in a pool in the Speller
+   and refer to the node they were reached from, so the output string is
+   only built for the nodes that give a correction. Flag diacritic states
+   are pooled the same way and shared by all nodes until a flag changes
+   them. An expanded node goes back to the pool once none of its children
+   is left, so the pool only holds the frontier and its ancestors.
+*/
 class TreeNode
 {
 public:
-    SymbolNumberVector string;
+    TreeNodeIndex parent;
+    SymbolNumber symbol;
     unsigned int input_state;
     TransitionTableIndex mutator_state;
     TransitionTableIndex lexicon_state;
-    hfst::FdState<SymbolNumber> flag_state;
+    FlagStateIndex flag_state;
     Weight weight;
+    // children that are queued or have queued descendants
+    unsigned int children;
 
-    TreeNode(SymbolNumberVector prev_string,
+    TreeNode(TreeNodeIndex p,
+             SymbolNumber s,
              unsigned int i,
              TransitionTableIndex mutator,
              TransitionTableIndex lexicon,
-             hfst::FdState<SymbolNumber> state,
+             FlagStateIndex state,
              Weight w):
-        string(prev_string),
+        parent(p),
+        symbol(s),
         input_state(i),
         mutator_state(mutator),
         lexicon_state(lexicon),
         flag_state(state),
-        weight(w)
+        weight(w),
+        children(0)
         { }
-
-    TreeNode(hfst::FdState<SymbolNumber> start_state): // starting state node
-        string(SymbolNumberVector()),
-        input_state(0),
-        mutator_state(0),
-        lexicon_state(0),
-        flag_state(start_state),
-        weight(0.0)
-        { }
-
-    TreeNode update_lexicon(SymbolNumber next_symbol,
-                            TransitionTableIndex next_lexicon,
-                            Weight weight);
-
-    TreeNode update_mutator(SymbolNumber next_symbol,
-                            TransitionTableIndex next_mutator,
-                            Weight weight);
-
-    void increment_mutator(void);
-
-    TreeNode update(SymbolNumber next_symbol,
-                    unsigned int next_input,
-                    TransitionTableIndex next_mutator,
-                    TransitionTableIndex next_lexicon,
-                    Weight weight);
-
-    TreeNode update(SymbolNumber next_symbol,
-                    TransitionTableIndex next_mutator,
-                    TransitionTableIndex next_lexicon,
-                    Weight weight);
-
-
 };
 
-typedef std::deque<TreeNode> TreeNodeQueue;
+// The search queue holds the weights and pool indices of the nodes, the
+// lightest node coming out first
+typedef std::pair<Weight, TreeNodeIndex> QueuedTreeNode;
+typedef std::priority_queue<QueuedTreeNode,
+                            std::vector<QueuedTreeNode>,
+                            std::greater<QueuedTreeNode> > TreeNodeQueue;
 
 int nByte_utf8(unsigned char c);
 
@@ -1297,6 +1664,69 @@ public:
         { }
 };
 
+/** \brief A bounded cache of Speller results.
+
+    Results of check() and correct() are kept by the transducers that
+    gave them, input string and search limits. When the cache is full, the
+    least recently used result is dropped. One cache may be shared by
+    spellers in several threads, also ones with different transducers.
+*/
+class SpellerCache
+{
+public:
+    SpellerCache(size_t max_entries);
+
+    bool find_check(const Transducer * lexicon,
+                    const std::string & input, bool & result);
+    void store_check(const Transducer * lexicon,
+                     const std::string & input, bool result);
+    bool find_correct(const Transducer * mutator, const Transducer * lexicon,
+                      const std::string & input, int max_results,
+                      Weight max_weight, Weight beam,
+                      CorrectionQueue & result);
+    void store_correct(const Transducer * mutator, const Transducer * lexicon,
+                       const std::string & input, int max_results,
+                       Weight max_weight, Weight beam,
+                       const CorrectionQueue & result);
+
+    unsigned long get_hits(void) const;
+    unsigned long get_misses(void) const;
+    size_t size(void) const;
+    void clear(void);
+
+private:
+    struct Key
+    {
+        // Transducer serials, the mutator is 0 for check()
+        unsigned long mutator;
+        unsigned long lexicon;
+        std::string input;
+        bool correcting;
+        int max_results;
+        Weight max_weight;
+        Weight beam;
+
+        bool operator<(const Key & other) const;
+    };
+    struct Entry
+    {
+        bool in_lexicon;
+        CorrectionQueue corrections;
+    };
+    typedef std::list<std::pair<Key, Entry> > EntryList;
+
+    // most recently used first
+    EntryList entries;
+    std::map<Key, EntryList::iterator> entry_map;
+    size_t max_entries;
+    unsigned long hits;
+    unsigned long misses;
+    mutable std::mutex mutex;
+
+    bool find(const Key & key, Entry & entry);
+    void store(const Key & key, const Entry & entry);
+};
+
 /** \brief A spellchecker, constructed from two optimized-lookup transducer
     instances. An alphabet translator is built at construction time.
 */
@@ -1307,18 +1737,34 @@ public:
     Transducer * lexicon;
     InputString input;
     TreeNodeQueue queue;
+    std::vector<TreeNode> nodes;
+    std::vector<TreeNodeIndex> free_nodes;
+    std::vector<hfst::FdState<SymbolNumber> > flag_states;
+    // how many nodes refer to each flag state
+    std::vector<unsigned int> flag_state_references;
+    std::vector<FlagStateIndex> free_flag_states;
     SymbolNumberVector alphabet_translator;
 //    hfst::FdTable<SymbolNumber> operations;
     std::vector<std::string> symbol_table;
+    SpellerCache * cache;
+    bool nonnegative_weights;
     
     Speller(Transducer * mutator_ptr, Transducer * lexicon_ptr):
         mutator(mutator_ptr),
         lexicon(lexicon_ptr),
         input(InputString()),
         queue(TreeNodeQueue()),
+        nodes(),
+        free_nodes(),
+        flag_states(),
+        flag_state_references(),
+        free_flag_states(),
         alphabet_translator(SymbolNumberVector()),
 //  operations(lexicon->get_fd_table()),
-        symbol_table(lexicon->get_symbol_table())
+        symbol_table(lexicon->get_symbol_table()),
+        cache(NULL),
+        nonnegative_weights(!mutator_ptr->has_negative_weights() &&
+                            !lexicon_ptr->has_negative_weights())
         {
             build_alphabet_translator();
         }
@@ -1326,17 +1772,50 @@ public:
     bool init_input(char * str, const Encoder & encoder, SymbolNumber other);
 
     void build_alphabet_translator(void);
-    void lexicon_epsilons(void);
-    void mutator_epsilons(void);
-    void consume_input(void);
-    void lexicon_consume(void);
+    void start_search(void);
+    void add_node(TreeNodeIndex parent,
+                  SymbolNumber symbol,
+                  unsigned int input_state,
+                  TransitionTableIndex mutator_state,
+                  TransitionTableIndex lexicon_state,
+                  FlagStateIndex flag_state,
+                  Weight weight);
+    FlagStateIndex add_flag_state(const hfst::FdState<SymbolNumber> & state);
+    // Return expanded node \a i and the ancestors it was the last child
+    // of to the pool
+    void release_node(TreeNodeIndex i);
+    void lexicon_epsilons(TreeNodeIndex i);
+    void mutator_epsilons(TreeNodeIndex i);
+    void consume_input(TreeNodeIndex i);
+    void lexicon_consume(TreeNodeIndex i);
+    bool search_lexicon(char * line);
+    CorrectionQueue search_corrections(char * line, int max_results,
+                                       Weight max_weight, Weight beam);
+    CorrectionQueue search_all_corrections(int max_results,
+                                           Weight max_weight, Weight beam);
+    /** Look up the results of check() and correct() in \a c before
+        searching, and store them there afterwards. The cache isn't owned
+        by the speller. NULL, the default, means no caching.
+     */
+    void set_cache(SpellerCache * c);
     /** See if \a line is in the lexicon.
      */
     bool check(char * line);
     /** Return a priority queue of corrections of \a line.
+
+        The search goes best first and stops when \a max_results
+        corrections have been found, if it is positive. Corrections
+        weighing more than \a max_weight, or more than \a beam over the
+        best correction, are not searched for if the limit is
+        non-negative. If either transducer has negative weights, a lighter
+        correction can be found after a heavier one, so the whole search
+        space is explored first, each correction gets its lowest weight,
+        and the limits are applied to the results.
      */
-    CorrectionQueue correct(char * line);
+    CorrectionQueue correct(char * line, int max_results = 0,
+                            Weight max_weight = -1.0, Weight beam = -1.0);
     std::string stringify(SymbolNumberVector symbol_vector);
+    std::string stringify(TreeNodeIndex i);
 };
 
 }
@@ -0,0 +1,150 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+//! @file CompilationCache.cc
+//!
+//! @brief Implementation of the on-disk cache of compiled transducers
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+#include "CompilationCache.h"
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstOutputStream.h"
+
+namespace hfst {
+
+CompilationCache::CompilationCache(const std::string & dir):
+    directory(dir),
+    hit_count(0),
+    miss_count(0)
+{
+    if (directory.empty())
+        { directory = "."; }
+}
+
+std::string
+CompilationCache::hash(const std::string & text)
+{
+    // Two independent 64-bit hashes: FNV-1a and a multiply-xorshift
+    // one seeded differently
+    unsigned long long h1 = 14695981039346656037ULL;
+    unsigned long long h2 = 0x9e3779b97f4a7c15ULL ^ text.size();
+    for (std::string::const_iterator it = text.begin();
+         it != text.end(); ++it) {
+        unsigned char c = (unsigned char)*it;
+        h1 ^= c;
+        h1 *= 1099511628211ULL;
+        h2 += c;
+        h2 *= 0xff51afd7ed558ccdULL;
+        h2 ^= h2 >> 32;
+    }
+    h2 ^= h2 >> 33;
+    h2 *= 0xc4ceb9fe1a85ec53ULL;
+    h2 ^= h2 >> 33;
+    std::ostringstream os;
+    os << std::hex << std::setfill('0')
+       << std::setw(16) << h1 << std::setw(16) << h2;
+    return os.str();
+}
+
+// Every stored key starts with the library version and the header
+// version HfstOutputStream writes, so that entries written by another
+// version are never read even if the compiler's own key is the same
+static const std::string KEY_HEADER =
+    "hfst " PACKAGE_VERSION "\n"
+    "stream 3.3\n";
+
+std::string
+CompilationCache::entry_name(const std::string & full_key) const
+{
+    return directory + "/" + hash(full_key);
+}
+
+// Whether file @a name holds exactly @a text
+static bool
+file_contains(const std::string & name, const std::string & text)
+{
+    std::ifstream in(name.c_str(), std::ios::in | std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    return contents == text;
+}
+
+HfstTransducer *
+CompilationCache::get(const std::string & key) const
+{
+    std::string full_key = KEY_HEADER + key;
+    std::string name = entry_name(full_key);
+    // Most lookups miss, so check the stored key quietly before opening
+    // a stream. A different key with the same hash is a miss too.
+    if (!file_contains(name + ".key", full_key)) {
+        ++miss_count;
+        return NULL;
+    }
+    try {
+        HfstInputStream in(name + ".hfst");
+        if (in.is_eof()) {
+            in.close();
+            ++miss_count;
+            return NULL;
+        }
+        HfstTransducer * retval = new HfstTransducer(in);
+        in.close();
+        ++hit_count;
+        return retval;
+    } catch (const HfstException &) {
+        // an unreadable entry is treated as a miss and overwritten
+        ++miss_count;
+        return NULL;
+    }
+}
+
+void
+CompilationCache::put(const std::string & key,
+                      const HfstTransducer & transducer) const
+{
+    std::string full_key = KEY_HEADER + key;
+    std::string name = entry_name(full_key);
+    std::random_device rd;
+    std::ostringstream suffix;
+    suffix << ".tmp" << std::hex << rd();
+    std::string transducer_tmp = name + ".hfst" + suffix.str();
+    std::string key_tmp = name + ".key" + suffix.str();
+    try {
+        HfstOutputStream out(transducer_tmp, transducer.get_type());
+        out << const_cast<HfstTransducer &>(transducer);
+        out.close();
+    } catch (const HfstException &) {
+        remove(transducer_tmp.c_str());
+        return;
+    }
+    std::ofstream key_out(key_tmp.c_str(), std::ios::out | std::ios::binary);
+    key_out << full_key;
+    key_out.close();
+    // The transducer is replaced before its key, so that a reader who
+    // finds the new key also finds the new transducer
+    if (!key_out ||
+        rename(transducer_tmp.c_str(), (name + ".hfst").c_str()) != 0 ||
+        rename(key_tmp.c_str(), (name + ".key").c_str()) != 0) {
+        // e.g. Windows does not replace existing files
+        remove(transducer_tmp.c_str());
+        remove(key_tmp.c_str());
+    }
+}
+
+}
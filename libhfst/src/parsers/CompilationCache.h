@@ -0,0 +1,77 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+//! @file CompilationCache.h
+//!
+//! @brief An on-disk cache of compiled transducers for the script compilers.
+
+#ifndef GUARD_CompilationCache_h
+#define GUARD_CompilationCache_h
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string>
+#include "../HfstDataTypes.h"
+
+namespace hfst {
+
+//! @brief A content-addressed directory of compiled transducers.
+//!
+//! The compilers build a key for each expression from everything its
+//! result depends on: its source text, the keys of the definitions it
+//! uses and the settings in effect. The result is stored in a file named
+//! after a hash of the key, so an expression whose key has not changed
+//! since the last run is read instead of compiled again. The full key,
+//! with the library version, is stored next to the result and compared
+//! when it is read.
+//! Keys never need to be removed; the directory can be emptied at any
+//! time.
+class CompilationCache
+{
+  private:
+    std::string directory;
+    mutable unsigned long hit_count;
+    mutable unsigned long miss_count;
+    //! The path of the entry for @a full_key without an extension; the
+    //! transducer is in the .hfst file and the key in the .key file.
+    std::string entry_name(const std::string & full_key) const;
+
+  public:
+    //! @brief A cache in the existing directory @a dir.
+    CompilationCache(const std::string & dir);
+
+    //! @brief A hex string of 32 digits identifying @a text.
+    //!
+    //! Keys of dependencies can be included in other keys as hashes
+    //! to keep them short.
+    static std::string hash(const std::string & text);
+
+    //! @brief The transducer stored with @a key or NULL if there is none.
+    //!        The caller takes ownership.
+    HfstTransducer * get(const std::string & key) const;
+
+    //! @brief Store @a transducer with @a key.
+    //!
+    //! The files are written under temporary names and renamed, so that
+    //! a reader never sees half of them. Failures are silently ignored;
+    //! the result is just compiled again next time.
+    void put(const std::string & key, const HfstTransducer & transducer) const;
+
+    //! @brief The number of calls to get() that found a transducer.
+    unsigned long hits() const { return hit_count; }
+
+    //! @brief The number of calls to get() that found nothing.
+    unsigned long misses() const { return miss_count; }
+};
+
+}
+
+#endif
@@ -55,15 +55,12 @@ using hfst::ImplementationType;
 using hfst::xre::XreCompiler;
 using hfst::StringVector;
 
-//using same alg as strings to fst
-static StringVector multichar_symbols;
-
-
 // stupid flex and yacc
-extern FILE* hlexcin;
-extern int hlexcparse();
-extern int hlexcnerrs;
-extern int hlexclex_destroy();
+typedef void * yyscan_t;
+extern int hlexcparse(yyscan_t, hfst::lexc::LexcCompiler&);
+extern int hlexclex_init_extra(hfst::lexc::LexcCompiler*, yyscan_t*);
+extern void hlexcset_in(FILE*, yyscan_t);
+extern int hlexclex_destroy(yyscan_t);
 
 #ifndef DEBUG_MAIN
 
@@ -71,7 +68,7 @@ namespace hfst { namespace lexc {
 
     bool debug = false;
 
-LexcCompiler* lexc_ = 0;
+static const TokenLocation first_token_location = { 1, 1, 1, 1 };
 
 LexcCompiler::LexcCompiler() :
     quiet_(false),
@@ -93,7 +90,10 @@ LexcCompiler::LexcCompiler() :
     winoss_(std::ostringstream()),
     redirected_stream_(NULL),
 #endif
-    parseErrors_(false)
+    parseErrors_(false),
+    firstLexicon_(true),
+    scanner_(NULL),
+    location_(first_token_location)
 {
     xre_.set_expand_definitions(true);
     xre_.set_error_stream(this->error_);
@@ -120,7 +120,10 @@ LexcCompiler::LexcCompiler(ImplementationType impl) :
     winoss_(std::ostringstream()),
     redirected_stream_(NULL),
 #endif
-    parseErrors_(false)
+    parseErrors_(false),
+    firstLexicon_(true),
+    scanner_(NULL),
+    location_(first_token_location)
 {
     tokenizer_.add_multichar_symbol("@_EPSILON_SYMBOL_@");
     tokenizer_.add_multichar_symbol("@0@");
@@ -154,7 +157,10 @@ LexcCompiler::LexcCompiler(ImplementationType impl, bool withFlags, bool alignSt
     winoss_(std::ostringstream()),
     redirected_stream_(NULL),
 #endif
-    parseErrors_(false)
+    parseErrors_(false),
+    firstLexicon_(true),
+    scanner_(NULL),
+    location_(first_token_location)
 {
     tokenizer_.add_multichar_symbol("@_EPSILON_SYMBOL_@");
     tokenizer_.add_multichar_symbol("@0@");
@@ -171,6 +177,10 @@ LexcCompiler::LexcCompiler(ImplementationType impl, bool withFlags, bool alignSt
 
 LexcCompiler::~LexcCompiler()
 {
+  if (scanner_ != NULL)
+    {
+      hlexclex_destroy(scanner_);
+    }
   for(const auto &it: regexps_)
   {
     delete it.second;
@@ -188,6 +198,7 @@ LexcCompiler::~LexcCompiler()
       totalEntries_ = 0;
       currentEntries_ = 0;
       parseErrors_ = false;
+      firstLexicon_ = true;
       lexiconNames_.clear();
       noFlags_.clear();
       continuations_.clear();
@@ -251,22 +262,49 @@ LexcCompiler::~LexcCompiler()
     }
 
 
+// The previous scanner is destroyed only here, since messages about
+// compiling what it read refer to its last token
+void
+LexcCompiler::reset_scanner(FILE* infile, const char* filename)
+{
+    if (scanner_ != NULL)
+      {
+        hlexclex_destroy(scanner_);
+      }
+    hlexclex_init_extra(this, &scanner_);
+    hlexcset_in(infile, scanner_);
+    location_ = first_token_location;
+    infilename_ = filename;
+}
+
+void * LexcCompiler::getScanner()
+{
+    return scanner_;
+}
+
+const std::string & LexcCompiler::getInfileName() const
+{
+    return infilename_;
+}
+
+TokenLocation & LexcCompiler::getTokenLocation()
+{
+    return location_;
+}
+
 LexcCompiler& LexcCompiler::parse(FILE* infile)
 {
-    lexc_ = this;
     if (infile == stdin)
       {
-        hfst::lexc::set_infile_name("<stdin>");
+        reset_scanner(infile, "<stdin>");
       }
     else
       {
-        hfst::lexc::set_infile_name("<unnamed>");
+        reset_scanner(infile, "<unnamed>");
       }
-    hlexclex_destroy();
-    hlexcin = infile;
-    hlexcparse();
+    int parse_retval = hlexcparse(scanner_, *this);
     xre_.remove_defined_multichar_symbols();
-    if (hlexcnerrs > 0)
+    if (parse_retval != 0)
       {
         parseErrors_ = true;
       }
@@ -275,11 +313,8 @@ LexcCompiler& LexcCompiler::parse(FILE* infile)
 
 LexcCompiler& LexcCompiler::parse(const char* filename)
 {
-    lexc_ = this;
-    hlexclex_destroy();
-    hfst::lexc::set_infile_name(filename);
-    hlexcin = hfst::hfst_fopen(filename, "r");
-    if (hlexcin == NULL)
+    FILE* infile = hfst::hfst_fopen(filename, "r");
+    if (infile == NULL)
       {
         std::ostream * err = get_stream(error_);
         *err << "could not open " << filename << " for reading" << std::endl;
@@ -287,9 +322,10 @@ LexcCompiler& LexcCompiler::parse(const char* filename)
         parseErrors_ = true;
         return *this;
       }
-    hlexcparse();
+    reset_scanner(infile, filename);
+    int parse_retval = hlexcparse(scanner_, *this);
     xre_.remove_defined_multichar_symbols();
-    if (hlexcnerrs > 0)
+    if (parse_retval != 0)
       {
         parseErrors_ = true;
       }
@@ -491,43 +527,31 @@ LexcCompiler::addStringEntry(const string& data,
     return *this;
 }
 
-// to handle information to warn_about_one_sided_flags_
-static bool treat_one_sided_flags_as_errors_ = false;
-static bool quiet_one_sided_flags_ = false;
-static std::ostream * errorstr_ = NULL;
-
-static void warn_about_one_sided_flags(const std::pair<std::string, std::string> & symbol_pair)
+// Warn about, or with --Werror fail on, the pairs of @a symbol_pairs that
+// have a flag diacritic on one side only
+void
+LexcCompiler::warn_about_one_sided_flags(const StringPairVector & symbol_pairs)
 {
-  if (FdOperation::is_diacritic(symbol_pair.first))
+  for (StringPairVector::const_iterator it = symbol_pairs.begin();
+       it != symbol_pairs.end(); ++it)
     {
-      if (symbol_pair.first != symbol_pair.second)
+      bool one_sided = FdOperation::is_diacritic(it->first) ?
+        (it->first != it->second) : FdOperation::is_diacritic(it->second);
+      if (! one_sided)
         {
-          if (treat_one_sided_flags_as_errors_)
-            {
-              // error messages are always printed
-              *errorstr_ << std::endl << "*** ERROR: one-sided flag diacritic: " << symbol_pair.first << ":" << symbol_pair.second << " [--Werror]" << std::endl;
-              lexc_->flush(errorstr_);
-              throw "one-sided flag";
-            }
-          if (!quiet_one_sided_flags_)
-            {
-              hfst::lexc::error_at_current_token(0, 0, "Warning: one-sided flag diacritic.");
-            }
+          continue;
         }
-      return;
-    }
-  if (FdOperation::is_diacritic(symbol_pair.second))
-    {
-      if (treat_one_sided_flags_as_errors_)
+      if (treat_warnings_as_errors_)
         {
           // error messages are always printed
-          *hfst::lexc::errorstr_ << std::endl << "*** ERROR: one-sided flag diacritic: " << symbol_pair.first << ":" << symbol_pair.second << " [--Werror]" << std::endl;
-          lexc_->flush(errorstr_);
+          std::ostream * err = get_stream(error_);
+          *err << std::endl << "*** ERROR: one-sided flag diacritic: " << it->first << ":" << it->second << " [--Werror]" << std::endl;
+          flush(err);
           throw "one-sided flag";
         }
-      if (!quiet_one_sided_flags_)
+      if (!quiet_)
         {
-          hfst::lexc::error_at_current_token(0, 0, "Warning: one-sided flag diacritic.");
+          hfst::lexc::error_at_current_token(*this, 0, 0, "Warning: one-sided flag diacritic.");
         }
     }
 }
@@ -581,11 +605,6 @@ LexcCompiler::addStringPairEntry(const string& upper, const string& lower,
     tokenizer_.add_multichar_symbol("0");      // epsilon
     tokenizer_.add_multichar_symbol("@ZERO@"); // literal zero
 
-    // information for function pointer &warn_about_one_sided_flags
-    treat_one_sided_flags_as_errors_ = treat_warnings_as_errors_;
-    quiet_one_sided_flags_ = quiet_;
-    errorstr_ = this->get_stream(this->error_);
-    
     StringPairVector newVector;
 
     
@@ -624,8 +643,7 @@ LexcCompiler::addStringPairEntry(const string& upper, const string& lower,
         
         
         newVector = tokenizer_.tokenize(joinerEnc + as1 + encodedCont,
-                                            joinerEnc + as2 + encodedCont,
-                                            &warn_about_one_sided_flags);
+                                            joinerEnc + as2 + encodedCont);
     }else
     {
         StringPairVector upperV;
@@ -646,8 +664,7 @@ LexcCompiler::addStringPairEntry(const string& upper, const string& lower,
 
             }
             newVector = tokenizer_.tokenize(joinerEnc + upper + encodedCont,
-                                            joinerEnc + lower + epsilons + encodedCont,
-                                            &warn_about_one_sided_flags);
+                                            joinerEnc + lower + epsilons + encodedCont);
 
         }
         else if (upperSize < lowerSize)
@@ -659,17 +676,16 @@ LexcCompiler::addStringPairEntry(const string& upper, const string& lower,
 
             }
             newVector = tokenizer_.tokenize(joinerEnc + upper + epsilons + encodedCont,
-                                            joinerEnc + lower + encodedCont,
-                                            &warn_about_one_sided_flags);
+                                            joinerEnc + lower + encodedCont);
         }
         else
         {
             newVector = tokenizer_.tokenize(joinerEnc + upper + encodedCont,
-                                            joinerEnc + lower + encodedCont,
-                                            &warn_about_one_sided_flags);
+                                            joinerEnc + lower + encodedCont);
         }
         
     }
+    warn_about_one_sided_flags(newVector);
     std::string zero("@ZERO@");
     size_t start_pos = 0;
     for (StringPairVector::iterator it = newVector.begin(); it != newVector.end(); it++)
@@ -809,7 +825,6 @@ LexcCompiler::addXreDefinition(const string& definition_name, const string& xre)
 LexcCompiler&
 LexcCompiler::setCurrentLexiconName(const string& lexiconName)
 {
-    static bool firstLexicon = true;
     currentLexiconName_ = lexiconName;
 
     if (!allow_multiple_sublexicon_definitions_)
@@ -836,26 +851,26 @@ LexcCompiler::setCurrentLexiconName(const string& lexiconName)
 
     std::ostream * err = get_stream(error_);
 
-    if ((firstLexicon) && (lexiconName == "Root"))
+    if ((firstLexicon_) && (lexiconName == "Root"))
     {
         setInitialLexiconName(lexiconName);
     }
-    else if ((firstLexicon) && (lexiconName != "Root"))
+    else if ((firstLexicon_) && (lexiconName != "Root"))
     {
       if (!quiet_) *err << "first lexicon is not named Root" << std::endl;
         setInitialLexiconName(lexiconName);
     }
-    else if ((!firstLexicon) && (lexiconName == "Root"))
+    else if ((!firstLexicon_) && (lexiconName == "Root"))
     {
       if (!quiet_) *err << "Root is not first the first lexicon" << std::endl;
         setInitialLexiconName(lexiconName);
     }
-    if (!firstLexicon && !quiet_)
+    if (!firstLexicon_ && !quiet_)
     {
       *err << currentEntries_ << " ";
     }
     if (!quiet_) *err << lexiconName << "...";
-    firstLexicon = false;
+    firstLexicon_ = false;
 
     flush(err);
 
@@ -38,6 +38,15 @@ namespace hfst {
 //! @brief Namespace for Xerox LexC related specific functions and classes.
 namespace lexc {
 
+//! @brief Position of the last token read, for the messages.
+struct TokenLocation
+{
+  int first_line;
+  int first_column;
+  int last_line;
+  int last_column;
+};
+
 //! @brief A compiler holding information contained in lexc style lexicons.
 //! A single LexcCompiler can be extended by adding entries to it, but little
 //! else can be done with it. It is sufficient to implement clone of lexc.
@@ -56,6 +65,10 @@ class LexcCompiler
 
   ~LexcCompiler();
 
+  //! @brief a compiler owns its scanner, so it cannot be copied.
+  LexcCompiler(const LexcCompiler &) = delete;
+  LexcCompiler & operator=(const LexcCompiler &) = delete;
+
   void reset();
 
   //! @brief compile lexc description from @c infile into current compiler
@@ -65,6 +78,17 @@ class LexcCompiler
   //!        compiler.
   LexcCompiler& parse(const char* filename);
 
+  //! @brief the scanner of the last parse, or NULL.
+  //! It is kept until the next parse, since messages about compiling the
+  //! parsed lexicons refer to the last token read.
+  void * getScanner();
+
+  //! @brief name of the file being parsed, for the messages.
+  const std::string & getInfileName() const;
+
+  //! @brief position of the last token read, for the messages.
+  TokenLocation & getTokenLocation();
+
   //! @brief set verbosity options.
   //! 0 means quiet, 1 the default and 2 (or bigger) the verbose mode.
   //! When verbose is 2, LexcCompiler will output the messages that Xerox
@@ -185,11 +209,16 @@ class LexcCompiler
   size_t totalEntries_;
   size_t currentEntries_;
   bool parseErrors_;
+  bool firstLexicon_;
+  void * scanner_;
+  std::string infilename_;
+  TokenLocation location_;
+
+  void reset_scanner(FILE* infile, const char* filename);
+  void warn_about_one_sided_flags(const hfst::StringPairVector & symbol_pairs);
 }
 ;
 
-// ugh, the global
-extern LexcCompiler* lexc_;
 } }
 
 // vim:set ft=cpp.doxygen:
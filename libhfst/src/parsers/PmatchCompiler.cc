@@ -15,12 +15,15 @@
 #include "pmatch_utils.h"
 #include "HfstTransducer.h"
 
+#include <thread>
+
 #ifndef UNIT_TEST
 
 namespace hfst { namespace pmatch {
 PmatchCompiler::PmatchCompiler() :
     flatten(false),
     verbose(false),
+    thread_count(std::thread::hardware_concurrency()),
     definitions_(),
     format_(hfst::TROPICAL_OPENFST_TYPE)
 {}
@@ -28,6 +31,7 @@ PmatchCompiler::PmatchCompiler() :
 PmatchCompiler::PmatchCompiler(hfst::ImplementationType impl) :
     flatten(false),
     verbose(false),
+    thread_count(std::thread::hardware_concurrency()),
     definitions_(),
     format_(impl)
 {}
@@ -35,18 +39,29 @@ PmatchCompiler::PmatchCompiler(hfst::ImplementationType impl) :
 void
 PmatchCompiler::define(const std::string& name, const std::string& pmatch)
 {
-  compile(pmatch);
-  if (definitions.count(name) != 0) {
-      definitions_[name] = definitions[name]->evaluate();
+  PmatchCompilation compilation(format_, verbose, flatten,
+                                include_cosine_distances, includedir,
+                                cache_directory);
+  compilation.thread_count = thread_count;
+  std::map<std::string, HfstTransducer*> compiled =
+      hfst::pmatch::compile(compilation, pmatch, definitions_);
+  for (std::map<std::string, HfstTransducer*>::iterator it = compiled.begin();
+       it != compiled.end(); ++it) {
+      delete it->second;
+  }
+  if (compilation.definitions.count(name) != 0) {
+      definitions_[name] = compilation.definitions[name]->evaluate();
   }
 }
 
 std::map<std::string, HfstTransducer*>
 PmatchCompiler::compile(const std::string& pmatch)
 {
-    return hfst::pmatch::compile(pmatch, definitions_, format_,
-                                 verbose, flatten, include_cosine_distances,
-                                 includedir);
+    PmatchCompilation compilation(format_, verbose, flatten,
+                                  include_cosine_distances, includedir,
+                                  cache_directory);
+    compilation.thread_count = thread_count;
+    return hfst::pmatch::compile(compilation, pmatch, definitions_);
 }
 
 void PmatchCompiler::set_include_path(std::string path)
@@ -54,6 +69,16 @@ void PmatchCompiler::set_include_path(std::string path)
     includedir = path;
 }
 
+void PmatchCompiler::set_cache_directory(std::string dir)
+{
+    cache_directory = dir;
+}
+
+void PmatchCompiler::set_thread_count(size_t count)
+{
+    thread_count = count;
+}
+
 }}
 
 #else // UNIT_TEST
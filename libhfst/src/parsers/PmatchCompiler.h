@@ -42,6 +42,8 @@ private:
     bool verbose;
     bool include_cosine_distances;
     std::string includedir;
+    std::string cache_directory;
+    size_t thread_count;
   public:
   //! @brief Construct compiler for unknown format transducers.
   PmatchCompiler();
@@ -63,6 +65,15 @@ private:
   //!        A null pointer is returned on fatal error, if abort is not called.
   std::map<std::string, HfstTransducer*> compile(const std::string& pmatch);
   void set_include_path(std::string path);
+  //! @brief Store compiled definitions in directory @a dir and reuse them
+  //!        when a definition and everything it uses are unchanged.
+  //!        An empty @a dir disables the cache.
+  void set_cache_directory(std::string dir);
+
+  //! @brief Harmonize the compiled transducers in at most @a count
+  //!        threads. The default is one per hardware thread, zero means
+  //!        one thread.
+  void set_thread_count(size_t count);
 
   private:
   std::map<std::string,hfst::HfstTransducer*> definitions_;
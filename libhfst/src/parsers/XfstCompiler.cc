@@ -21,6 +21,8 @@
 #include <queue>
 #include <stack>
 #include <memory>
+#include <algorithm>
+#include <sstream>
 
 using std::string;
 using std::map;
@@ -29,6 +31,7 @@ using std::stack;
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <cstdarg>
 
@@ -61,14 +64,15 @@ using std::stack;
 #endif
 
 #ifndef DEBUG_MAIN
-extern FILE* hxfstin;
-extern int hxfstparse(void);
-
-extern int hxfstlex(void);
 struct yy_buffer_state;
 typedef yy_buffer_state *YY_BUFFER_STATE;
-extern YY_BUFFER_STATE hxfst_scan_string(const char*);
-extern void hxfst_delete_buffer(YY_BUFFER_STATE);
+typedef void * yyscan_t;
+extern int hxfstparse(yyscan_t, hfst::xfst::XfstCompiler&);
+extern int hxfstlex_init_extra(hfst::xfst::XfstScannerState*, yyscan_t*);
+extern void hxfstset_in(FILE*, yyscan_t);
+extern YY_BUFFER_STATE hxfst_scan_string(const char*, yyscan_t);
+extern void hxfst_delete_buffer(YY_BUFFER_STATE, yyscan_t);
+extern int hxfstlex_destroy(yyscan_t);
 
 #include "implementations/HfstBasicTransducer.h"
 
@@ -97,13 +101,9 @@ using hfst::implementations::HfstBasicTransition;
 namespace hfst {
 namespace xfst {
 
-  // whether we need to reset the lexc parser before reading lexc
-  static bool has_lexc_been_read_ = false;
-
-  static std::map<std::string, std::string> variable_explanations_;
-
-  static void initialize_variable_explanations()
+  static std::map<std::string, std::string> make_variable_explanations()
   {
+    std::map<std::string, std::string> variable_explanations_;
     variable_explanations_["assert"] = "quit the application if test result is 0 and quit-on-fail is ON";
     variable_explanations_["att-epsilon"] = "epsilon symbol used when reading from att files";
     variable_explanations_["char-encoding"] = "character encoding used";
@@ -137,6 +137,15 @@ namespace xfst {
     variable_explanations_["use-timer"] = "<NOT IMPLEMENTED>";
     variable_explanations_["verbose"] = "print more information";
     variable_explanations_["xerox-composition"] = "treat flag diacritics as ordinary symbols in composition";
+    return variable_explanations_;
+  }
+
+  // The same for all compilers, so built only once
+  static const std::map<std::string, std::string> & variable_explanations()
+  {
+    static const std::map<std::string, std::string> explanations =
+      make_variable_explanations();
+    return explanations;
   }
 
   static const char * APPLY_END_STRING = "<ctrl-d>";
@@ -150,10 +159,12 @@ namespace xfst {
         output_to_console_(false),
         xre_(hfst::TROPICAL_OPENFST_TYPE),
         lexc_(hfst::TROPICAL_OPENFST_TYPE),
+        has_lexc_been_read_(false),
         format_(hfst::TROPICAL_OPENFST_TYPE),
         verbose_(false),
         verbose_prompt_(false),
         latest_regex_compiled(NULL),
+        cache_(NULL),
         quit_requested_(false),
         fail_flag_(false),
         output_(&std::cout),
@@ -207,7 +218,6 @@ namespace xfst {
         variables_["use-timer"] = "OFF";
         variables_["verbose"] = "OFF";
         variables_["xerox-composition"] = "ON";
-        initialize_variable_explanations();
         prompt();
       }
 
@@ -217,10 +227,12 @@ namespace xfst {
         output_to_console_(false),
         xre_(impl),
         lexc_(impl),
+        has_lexc_been_read_(false),
         format_(impl),
         verbose_(false),
         verbose_prompt_(false),
         latest_regex_compiled(NULL),
+        cache_(NULL),
         quit_requested_(false),
         fail_flag_(false),
         output_(&std::cout),
@@ -274,7 +286,6 @@ namespace xfst {
         variables_["use-timer"] = "OFF";
         variables_["verbose"] = "OFF";
         variables_["xerox-composition"] = "ON";
-        initialize_variable_explanations();
         prompt();
       }
 
@@ -293,6 +304,13 @@ namespace xfst {
       {
         delete latest_regex_compiled;
       }
+    delete cache_;
+    for (size_t i = 0; i < 2; ++i)
+      {
+        delete lookup_views_[i].cycles;
+        delete lookup_views_[i].fsm;
+        delete lookup_views_[i].tokenizer;
+      }
   }
 
   int XfstCompiler::xfst_fclose(FILE * f, const char * name)
@@ -665,20 +683,16 @@ namespace xfst {
   }
 
     XfstCompiler&
-    XfstCompiler::lookup(char* line, HfstBasicTransducer * t)
+    XfstCompiler::lookup(char* line, const LookupView & view)
       {
         char* token = strstrip(line);
-        StringSet alpha = t->get_input_symbols();
-        HfstTokenizer tok;
-        for (const auto & it : alpha)
-          {
-            tok.add_multichar_symbol(it);
-          }
-        StringVector lookup_path = tok.tokenize_one_level(std::string(token));
+        HfstBasicTransducer * t = view.fsm;
+        StringVector lookup_path
+          = view.tokenizer->tokenize_one_level(std::string(token));
         free(token);
 
         size_t cutoff = -1;
-        if (t->is_lookup_infinitely_ambiguous(lookup_path, variables_["obey-flags"] == "ON"))
+        if (view.cycles->is_lookup_infinitely_ambiguous(lookup_path, variables_["obey-flags"] == "ON"))
           {
             cutoff = string_to_size_t(variables_["lookup-cycle-cutoff"]);
             if (verbose_)
@@ -703,11 +717,11 @@ namespace xfst {
         if (variables_["print-pairs"] == "OFF")
           {
             HfstOneLevelPaths paths = extract_output_paths(results);
-            printed = this->print_paths(paths);
+            printed = this->print_paths(paths, &output());
           }
         else
           {
-            printed = this->print_paths(results);
+            printed = this->print_paths(results, &output());
           }
 
         if (!printed)
@@ -743,7 +757,32 @@ namespace xfst {
           paths = t->lookup(std::string(token), cutoff);
         }
 
-        bool printed = this->print_paths(*paths);
+        bool printed = this->print_paths(*paths, &output());
+        if (!printed)
+          {
+            output() << "???" << std::endl;
+            flush(&output());
+          }
+
+        delete paths;
+        return *this;
+      }
+
+  XfstCompiler&
+    XfstCompiler::lookdown(char* line, const HfstTransducer * t, size_t cutoff)
+      {
+        char* token = strstrip(line);
+        HfstOneLevelPaths * paths = NULL;
+
+        if (variables_["obey-flags"] == "ON") {
+          paths = t->lookdown_fd(std::string(token), cutoff);
+        }
+        else {
+          paths = t->lookdown(std::string(token), cutoff);
+        }
+        free(token);
+
+        bool printed = this->print_paths(*paths, &output());
         if (!printed)
           {
             output() << "???" << std::endl;
@@ -861,8 +900,53 @@ namespace xfst {
   }
 
 
+  const XfstCompiler::LookupView &
+  XfstCompiler::get_lookup_view(ApplyDirection direction)
+  {
+    LookupView & view = lookup_views_[direction];
+    if (view.fsm != NULL && view.generation == stack_.get_generation())
+      {
+        return view;
+      }
+    delete view.cycles;
+    delete view.fsm;
+    delete view.tokenizer;
+    view.cycles = NULL;
+    view.fsm = NULL;
+    view.tokenizer = NULL;
+
+    const HfstTransducer * t = get_stack().top();
+    if (direction == APPLY_UP_DIRECTION)
+      {
+        // lookdown is implemented only for optimized-lookup transducers
+        if (verbose_)
+          {
+            error() << "warning: apply up not implemented, inverting transducer and performing apply down" << std::endl
+                    << "for faster performance, invert and minimize top network and do apply down instead" << std::endl << std::endl;
+            flush(&error());
+          }
+        HfstTransducer inverted(*t);
+        inverted.invert().minimize(); // the user has been warned for possible slow performance
+        view.fsm = new HfstBasicTransducer(inverted);
+      }
+    else
+      {
+        view.fsm = new HfstBasicTransducer(*t);
+      }
+
+    view.tokenizer = new HfstTokenizer();
+    StringSet alpha = view.fsm->get_input_symbols();
+    for (const auto & it : alpha)
+      {
+        view.tokenizer->add_multichar_symbol(it);
+      }
+    view.cycles = new hfst::implementations::HfstEpsilonCycleIndex(*view.fsm);
+    view.generation = stack_.get_generation();
+    return view;
+  }
+
     XfstCompiler&
-    XfstCompiler::apply_down_line(char* line) // apply_up_line -> apply_down_line
+    XfstCompiler::apply_line(char* line, ApplyDirection direction)
       {
         if (stack_.size() < 1)
           {
@@ -871,46 +955,38 @@ namespace xfst {
             prompt();
             return *this;
           }
-        HfstTransducer * t = stack_.top();
+        const HfstTransducer * t = get_stack().top();
         if (t->get_type() != hfst::HFST_OL_TYPE && t->get_type() != hfst::HFST_OLW_TYPE)
           {
-            //hfst_fprintf(warnstream_, "lookup might be slow, consider 'convert net'\n");
-            HfstBasicTransducer fsm(*t);
-            return this->lookup(line, &fsm);
+            return this->lookup(line, get_lookup_view(direction));
           }
 
         size_t ol_cutoff = string_to_size_t(variables_["lookup-cycle-cutoff"]); // -1; fix this
         StringVector foo; // this gets ignored by ol transducer's is_lookup_infinitely_ambiguous
-        if (t->is_lookup_infinitely_ambiguous(foo))
+        bool infinitely_ambiguous = (direction == APPLY_UP_DIRECTION) ?
+          t->is_lookdown_infinitely_ambiguous(foo) :
+          t->is_lookup_infinitely_ambiguous(foo);
+        if (infinitely_ambiguous && verbose_)
           {
-            ol_cutoff = string_to_size_t(variables_["lookup-cycle-cutoff"]);;
-            if (verbose_)
-              {
-                error() << "warning: transducer is infinitely ambiguous, limiting number of cycles to " << ol_cutoff << std::endl;
-                flush(&error());
-              }
+            error() << "warning: transducer is infinitely ambiguous, limiting number of cycles to " << ol_cutoff << std::endl;
+            flush(&error());
           }
 
+        if (direction == APPLY_UP_DIRECTION)
+          return this->lookdown(line, t, ol_cutoff);
         return this->lookup(line, t, ol_cutoff);
       }
 
+    XfstCompiler&
+    XfstCompiler::apply_down_line(char* line) // apply_up_line -> apply_down_line
+      {
+        return apply_line(line, APPLY_DOWN_DIRECTION);
+      }
+
     XfstCompiler&
     XfstCompiler::apply_up_line(char* line) // apply_down_line -> apply_up_line
       {
-        GET_TOP(t);
-        // lookdown not yet implemented in HFST
-        if (verbose_)
-          {
-            error() << "warning: apply up not implemented, inverting transducer and performing apply down" << std::endl
-                    << "for faster performance, invert and minimize top network and do apply down instead" << std::endl << std::endl;
-            flush(&error());
-          }
-        t = new HfstTransducer(*(stack_.top()));
-        t->invert().minimize(); // the user has been warned for possible slow performance
-        HfstBasicTransducer fsm(*t);
-        this->lookup(line, &fsm);
-        delete t;
-        return *this;
+        return apply_line(line, APPLY_UP_DIRECTION);
       }
 
     XfstCompiler&
@@ -1012,42 +1088,23 @@ namespace xfst {
             prompt();
             return *this;
           }
-        HfstTransducer * t = stack_.top();
+        const HfstTransducer * t = get_stack().top();
         size_t ol_cutoff = string_to_size_t(variables_["lookup-cycle-cutoff"]); ; // -1; fix this // number of cycles needs to be limited for an infinitely ambiguous ol transducer
                                // because it doesn't support is_lookup_infinitely_ambiguous(const string &)
 
-        HfstBasicTransducer * fsm = NULL;
-
-        if (direction == APPLY_UP_DIRECTION)
-          {
-            if (t->get_type() == hfst::HFST_OL_TYPE ||
-                t->get_type() == hfst::HFST_OLW_TYPE)
-              {
-                error() << "Operation not supported for optimized lookup format. Consider 'remove-optimization' to convert into ordinary format." << std::endl;
-                flush(&error());
-                prompt();
-                return *this;
-              }
-
-            // lookdown not yet implemented in HFST
-            if (verbose_)
-              {
-                error() << "warning: apply up not implemented, inverting transducer and performing apply down" << std::endl
-                        << "for faster performance, invert and minimize top network and do apply down instead" << std::endl << std::endl;
-                flush(&error());
-              }
-            t = new HfstTransducer(*(stack_.top()));
-            t->invert().minimize(); // the user has been warned for possible slow performance
-          }
+        const LookupView * view = NULL;
 
         if (t->get_type() != hfst::HFST_OL_TYPE && t->get_type() != hfst::HFST_OLW_TYPE)
           {
-            fsm = new HfstBasicTransducer(*t);
+            view = &get_lookup_view(direction);
           }
         else
           {
             StringVector foo; // this gets ignored by ol transducer's is_lookup_infinitely_ambiguous
-            if (t->is_lookup_infinitely_ambiguous(foo))
+            bool infinitely_ambiguous = (direction == APPLY_UP_DIRECTION) ?
+              t->is_lookdown_infinitely_ambiguous(foo) :
+              t->is_lookup_infinitely_ambiguous(foo);
+            if (infinitely_ambiguous)
               {
                 ol_cutoff = string_to_size_t(variables_["lookup-cycle-cutoff"]);
                 if (verbose_)
@@ -1086,8 +1143,10 @@ namespace xfst {
               }
 
             // perform lookup/lookdown
-            if (fsm != NULL)
-              lookup(line, fsm);
+            if (view != NULL)
+              lookup(line, *view);
+            else if (direction == APPLY_UP_DIRECTION)
+              lookdown(line, t, ol_cutoff);
             else
               lookup(line, t, ol_cutoff);
             free(line);
@@ -1096,11 +1155,6 @@ namespace xfst {
         // ignore all readline history given to the apply command
         ignore_history_after_index(ind);
 
-        if (direction == APPLY_UP_DIRECTION)
-          delete t;
-        if (fsm != NULL)
-          delete fsm;
-
         PROMPT_AND_RETURN_THIS;
       }
 
@@ -1234,6 +1288,7 @@ namespace xfst {
   {
     bool was_defined = xre_.is_definition(name);
     xre_.define(name, *transducer);
+    definition_keys_.erase(name);
     if (variables_["name-nets"] == "ON") {
       transducer->set_name(name);
     }
@@ -1292,7 +1347,12 @@ namespace xfst {
 
       /*else*/ if (latest_regex_compiled != NULL)
         {
-          HfstTransducer* compiled = xre_.compile(xre);
+          // compile_regex has already read the regex from the cache or
+          // stored it there
+          HfstTransducer* compiled = (cache_ != NULL) ?
+            new HfstTransducer(*latest_regex_compiled) : xre_.compile(xre);
+          std::string key;
+          bool cacheable = (cache_ != NULL) && regex_cache_key(xre, key);
           if (!compiled)
             {
               error() << "Could not define variable '" << std::string(name) << "'" << std::endl;
@@ -1301,6 +1361,10 @@ namespace xfst {
             }
           this->define(name, compiled);
           original_definitions_[name] = xre;
+          if (cacheable)
+            {
+              definition_keys_[name] = hfst::CompilationCache::hash(key);
+            }
         }
       else
         {
@@ -1519,6 +1583,7 @@ namespace xfst {
             {
               delete it->second;
               definitions_.erase(it);
+              definition_keys_.erase(name);
               xre_.undefine(name);  // XRE
             }
           name = strtok(NULL, " ");
@@ -1759,6 +1824,7 @@ namespace xfst {
         flush(&error());
         delete it->second;
         definitions_.erase(def_name);
+        definition_keys_.erase(def_name);
       }
     definitions_[def_name] = t;
     return *this;
@@ -2116,7 +2182,14 @@ namespace xfst {
               output().width(20);
               output() << var.first << ": ";
               output().width(6);
-              output() << var.second << ": " << variable_explanations_[var.first] << std::endl;
+              output() << var.second << ": ";
+              std::map<std::string, std::string>::const_iterator explanation
+                = variable_explanations().find(var.first);
+              if (explanation != variable_explanations().end())
+                {
+                  output() << explanation->second;
+                }
+              output() << std::endl;
             }
         }
       flush(&output());
@@ -3783,10 +3856,114 @@ namespace xfst {
         delete latest_regex_compiled;
         latest_regex_compiled = NULL;
       }
+    if (cache_ == NULL)
+      {
+        latest_regex_compiled = xre_.compile_first(indata, chars_read);  // XRE
+        return *this;
+      }
+
+    // The end of the regex is not known before it is parsed. Every regex
+    // in the cache was stored with the exact text up to and including its
+    // final semicolon, and the parser stops at the first semicolon that
+    // can end a regex, so the first few candidate ends are tried.
+    const unsigned int MAX_CANDIDATES = 8;
+    unsigned int candidates = 0;
+    std::string key;
+    for (const char * end = strchr(indata, ';');
+         end != NULL && candidates < MAX_CANDIDATES;
+         end = strchr(end + 1, ';'))
+      {
+        // An odd number of percent signs escapes the semicolon
+        const char * escape = end;
+        while (escape != indata && *(escape - 1) == '%')
+          {
+            escape--;
+          }
+        if ((end - escape) % 2 == 1)
+          {
+            continue;
+          }
+        candidates++;
+        std::string candidate(indata, end - indata + 1);
+        if (regex_cache_key(candidate, key))
+          {
+            HfstTransducer * cached = cache_->get(key);
+            if (cached != NULL)
+              {
+                latest_regex_compiled = cached;
+                chars_read = (unsigned int)candidate.size();
+                return *this;
+              }
+          }
+      }
+
     latest_regex_compiled = xre_.compile_first(indata, chars_read);  // XRE
+    if (latest_regex_compiled != NULL &&
+        regex_cache_key(std::string(indata, chars_read), key))
+      {
+        cache_->put(key, *latest_regex_compiled);
+      }
     return *this;
   }
 
+  bool
+  XfstCompiler::regex_cache_key(const std::string & xre, std::string & key) const
+  {
+    std::ostringstream os;
+    os << "xfst regex 1" << std::endl
+       << "format " << format_ << std::endl;
+    for (const auto & var : variables_)
+      {
+        os << "set " << var.first << " " << var.second << std::endl;
+      }
+    os << "regex " << xre << std::endl;
+
+    // A name can be used with its special characters escaped
+    std::string unescaped = xre;
+    unescaped.erase(std::remove(unescaped.begin(), unescaped.end(), '%'),
+                    unescaped.end());
+
+    // A name is taken to be used if it occurs anywhere in the regex. This
+    // can only make the key longer than necessary.
+    for (const auto & def : definitions_)
+      {
+        if (xre.find(def.first) == std::string::npos &&
+            unescaped.find(def.first) == std::string::npos)
+          {
+            continue;
+          }
+        auto it = definition_keys_.find(def.first);
+        if (it == definition_keys_.end())
+          {
+            return false;
+          }
+        os << "define " << def.first << " " << it->second << std::endl;
+      }
+    for (const auto & def : function_definitions_)
+      {
+        if (xre.find(def.first) != std::string::npos ||
+            unescaped.find(def.first) != std::string::npos)
+          {
+            os << "function " << def.first << " " << def.second << std::endl;
+          }
+      }
+    for (const auto & list : lists_)
+      {
+        if (xre.find(list.first) != std::string::npos ||
+            unescaped.find(list.first) != std::string::npos)
+          {
+            os << "list " << list.first;
+            for (const auto & symbol : list.second)
+              {
+                os << " " << symbol;
+              }
+            os << std::endl;
+          }
+      }
+    key = os.str();
+    return true;
+  }
+
   XfstCompiler&
   XfstCompiler::read_regex(const char* indata)
     {
@@ -5087,12 +5264,45 @@ namespace xfst {
     {
       return stack_;
     }
+  // Each parse has a scanner of its own, so parses in other threads or
+  // nested in this one don't share the state of the lexer
+  static int
+  parse_with_new_scanner(XfstCompiler & compiler, FILE* infile,
+                         const char* line)
+    {
+      XfstScannerState state = { compiler, 0 };
+      yyscan_t new_scanner;
+      hxfstlex_init_extra(&state, &new_scanner);
+      YY_BUFFER_STATE bs = NULL;
+      if (line != NULL)
+        {
+          bs = hxfst_scan_string(line, new_scanner);
+        }
+      else
+        {
+          hxfstset_in(infile, new_scanner);
+        }
+      int rv = 1;
+      try
+        {
+          rv = hxfstparse(new_scanner, compiler);
+        }
+      catch (...)
+        {
+          hxfstlex_destroy(new_scanner);
+          throw;
+        }
+      if (bs != NULL)
+        {
+          hxfst_delete_buffer(bs, new_scanner);
+        }
+      hxfstlex_destroy(new_scanner);
+      return rv;
+    }
   int
   XfstCompiler::parse(FILE* infile)
     {
-      hxfstin = infile;
-      xfst_ = this;
-      int rv = hxfstparse();
+      int rv = parse_with_new_scanner(*this, infile, NULL);
       return rv;
     }
   int
@@ -5100,26 +5310,21 @@ namespace xfst {
     {
       if (! this->check_filename(filename)) { return -1; }
 
-      hxfstin = hfst::hfst_fopen(filename, "r");
-      if (hxfstin == NULL)
+      FILE* infile = hfst::hfst_fopen(filename, "r");
+      if (infile == NULL)
         {
           error() << "could not open " << filename << " for reading" << std::endl;
           flush(&error());
           return -1;
         }
-      xfst_ = this;
-      int rv = hxfstparse();
-      fclose(hxfstin);
+      int rv = parse_with_new_scanner(*this, infile, NULL);
+      fclose(infile);
       return rv;
     }
   int
   XfstCompiler::parse_line(char line[])
   {
-    hxfstin = NULL;
-    xfst_ = this;
-    YY_BUFFER_STATE bs = hxfst_scan_string(line);
-    int rv = hxfstparse();
-    hxfst_delete_buffer(bs);
+    int rv = parse_with_new_scanner(*this, NULL, line);
     /*if (rv != 0)
       {
         prompt();
@@ -5129,12 +5334,8 @@ namespace xfst {
   int
   XfstCompiler::parse_line(std::string line)
   {
-    hxfstin = NULL;
-    xfst_ = this;
     char * line_ = strdup(line.c_str());
-    YY_BUFFER_STATE bs = hxfst_scan_string(line_);
-    int rv = hxfstparse();
-    hxfst_delete_buffer(bs);
+    int rv = parse_with_new_scanner(*this, NULL, line_);
     free(line_);
     return rv;
   }
@@ -5146,6 +5347,20 @@ namespace xfst {
     return *this;
   }
 
+  XfstCompiler&
+  XfstCompiler::setCacheDirectory(const std::string & dir)
+  {
+    delete cache_;
+    cache_ = dir.empty() ? NULL : new hfst::CompilationCache(dir);
+    return *this;
+  }
+
+  const hfst::CompilationCache *
+  XfstCompiler::getCache() const
+  {
+    return cache_;
+  }
+
   bool
   XfstCompiler::getRestrictedMode() const
   {
@@ -5252,9 +5467,6 @@ namespace xfst {
       return *this;
     }
 
-// silly globls
-XfstCompiler* xfst_ = 0;
-
 }}
 
 #else
@@ -30,6 +30,7 @@
 #include <stack>
 
 #include "HfstTransducer.h"
+#include "CompilationCache.h"
 #include "XreCompiler.h"
 #include "LexcCompiler.h"
 
@@ -473,6 +474,10 @@ class XfstCompiler
      "print net".
   */
   XfstCompiler& compile_regex(const char * indata, unsigned int & chars_read);
+  /* Store to \a key everything the result of compiling \a xre depends on.
+     Return false if it depends on something that cannot be expressed as
+     text, e.g. a definition taken from the stack. */
+  bool regex_cache_key(const std::string & xre, std::string & key) const;
 
   //! @brief Sekrit HFST raw command mode!
   XfstCompiler& hfst(const char * data);
@@ -512,6 +517,13 @@ class XfstCompiler
   //! @brief Whether restricted mode is on.
   bool getRestrictedMode() const;
 
+  //! @brief Store compiled regexes in directory @a dir and reuse them when
+  //!        the same regex is compiled again with the same definitions and
+  //!        variables. An empty @a dir disables the cache.
+  XfstCompiler& setCacheDirectory(const std::string & dir);
+  //! @brief The cache set with setCacheDirectory, or NULL if none is used.
+  const hfst::CompilationCache * getCache() const;
+
   //! @brief Whether it has been requested to quit the program.
   //  Needed in interactive mode where user input is read line by line.
   bool quit_requested() const;
@@ -693,8 +705,26 @@ class XfstCompiler
   XfstCompiler& print_transducer_info();
   XfstCompiler& add_prop_line(char* line);
 
+  /* The top network prepared for lookup in one direction: as an
+     HfstBasicTransducer, inverted for apply up, a tokenizer for its
+     input symbols and the index of its input epsilon cycles. */
+  struct LookupView
+  {
+    LookupView(): generation(0), fsm(NULL), tokenizer(NULL), cycles(NULL) {}
+    unsigned long generation; // of the stack when the view was built
+    HfstBasicTransducer * fsm;
+    hfst::HfstTokenizer * tokenizer;
+    hfst::implementations::HfstEpsilonCycleIndex * cycles; // of fsm
+  };
+
   XfstCompiler& lookup(char* line, const HfstTransducer * t, size_t cutoff);
-  XfstCompiler& lookup(char* line, HfstBasicTransducer * t);
+  XfstCompiler& lookup(char* line, const LookupView & view);
+  XfstCompiler& lookdown(char* line, const HfstTransducer * t, size_t cutoff);
+  /* Get the lookup view of the top network for \a direction, building it
+     if the stack has changed since it was built. The stack must not be
+     empty and the top network must not be in optimized-lookup format. */
+  const LookupView & get_lookup_view(ApplyDirection direction);
+  XfstCompiler& apply_line(char* line, ApplyDirection direction);
 
   XfstCompiler& apply_up_line(char* line);
   XfstCompiler& apply_down_line(char* line);
@@ -715,6 +745,8 @@ class XfstCompiler
   hfst::xre::XreCompiler xre_;
   /* The lexc compiler. */
   hfst::lexc::LexcCompiler lexc_;
+  /* Whether lexc_ must be reset before reading lexc. */
+  bool has_lexc_been_read_;
 #if HAVE_TWOLC
   /* The twolc compiler. */
   hfst::twolc::TwolcCompiler twolc_;
@@ -724,7 +756,32 @@ class XfstCompiler
   std::map<std::string,std::string> original_function_definitions_;
   std::map<std::string,std::string> function_definitions_;
   std::map<std::string,unsigned int> function_arguments_;
-  std::stack<hfst::HfstTransducer*> stack_;
+  /* The stack of networks. It counts the accesses that may change it,
+     including getting a modifiable top, so that lookup views of the top
+     network can be kept until then. */
+  class NetworkStack : public std::stack<hfst::HfstTransducer*>
+  {
+  public:
+    NetworkStack(): generation(0) {}
+    NetworkStack & operator=(const std::stack<hfst::HfstTransducer*> & s)
+      { std::stack<hfst::HfstTransducer*>::operator=(s); ++generation;
+        return *this; }
+    void push(hfst::HfstTransducer * t)
+      { ++generation; std::stack<hfst::HfstTransducer*>::push(t); }
+    void pop()
+      { ++generation; std::stack<hfst::HfstTransducer*>::pop(); }
+    hfst::HfstTransducer *& top()
+      { ++generation; return std::stack<hfst::HfstTransducer*>::top(); }
+    hfst::HfstTransducer * const & top() const
+      { return std::stack<hfst::HfstTransducer*>::top(); }
+    unsigned long get_generation() const
+      { return generation; }
+  private:
+    unsigned long generation;
+  };
+  NetworkStack stack_;
+  /* The lookup views of the top network, indexed by ApplyDirection. */
+  LookupView lookup_views_[2];
   std::map<std::string,hfst::HfstTransducer*> names_;
   std::map<std::string,std::string> aliases_;
   std::map<std::string,std::string> variables_;
@@ -738,6 +795,11 @@ class XfstCompiler
      where they end before giving them to the actual parser. By storing the result
      in this variable, there is no need to parse a regexp again on the parse level. */
   hfst::HfstTransducer * latest_regex_compiled;
+  /* The cache of compiled regexes or NULL if it is not used. */
+  hfst::CompilationCache * cache_;
+  /* For each definition compiled from a cacheable regex, the hash of the
+     key of the regex. Definitions not listed here are not cacheable. */
+  std::map<std::string,std::string> definition_keys_;
   // Whether the script has encountered the quit command ('quit', 'exit', etc.).
   // Needed in interactive mode, where user input is read line by line.
   bool quit_requested_;
@@ -761,9 +823,6 @@ class XfstCompiler
   bool restricted_mode_;
 }
 ;
-
-// ugh, the global
-extern XfstCompiler* xfst_;
 }}
 // vim:set ft=cpp.doxygen:
 #endif
@@ -23,28 +23,23 @@
 
 namespace hfst { namespace xre {
 
-    unsigned int cr=0; // number of chars read from xre input
-    unsigned int lr=1; // number of lines read from xre input
-    std::set<unsigned int> positions;
-    char * position_symbol = NULL;
-    std::ostream * error_(&std::cerr);
-#ifdef WINDOWS
-    std::ostringstream winoss_;
-    std::ostream * redirected_stream_ = NULL;
-    bool output_to_console_(false);
-#endif
-    bool verbose_(false);
-    std::set<std::string> * defined_multichar_symbols_(NULL);
-
 XreCompiler::XreCompiler() :
     definitions_(),
     function_definitions_(),
     function_arguments_(),
     list_definitions_(),
     format_(hfst::TROPICAL_OPENFST_TYPE),
-    verbose_(false)
+    verbose_(false),
+    error_(&std::cerr),
+    expand_definitions_(false),
+    harmonize_(true),
+    harmonize_flags_(false),
+    check_multichar_symbols_(false),
+    defined_multichar_symbols_(),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
+    , redirected_stream_(NULL)
 #endif
 {}
 
@@ -54,9 +49,17 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     function_arguments_(),
     list_definitions_(),
     format_(impl),
-    verbose_(false)
+    verbose_(false),
+    error_(&std::cerr),
+    expand_definitions_(false),
+    harmonize_(true),
+    harmonize_flags_(false),
+    check_multichar_symbols_(false),
+    defined_multichar_symbols_(),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
+    , redirected_stream_(NULL)
 #endif
 {}
 
@@ -66,9 +69,17 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     function_arguments_(args.function_arguments),
     list_definitions_(args.list_definitions),
     format_(args.format),
-    verbose_(false)
+    verbose_(false),
+    error_(&std::cerr),
+    expand_definitions_(false),
+    harmonize_(true),
+    harmonize_flags_(false),
+    check_multichar_symbols_(false),
+    defined_multichar_symbols_(),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
+    , redirected_stream_(NULL)
 #endif
 {}
 
@@ -84,7 +95,6 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     void XreCompiler::set_verbosity(bool verbose)
     {
       this->verbose_ = verbose;
-      hfst::xre::verbose_ = verbose; // TODO
     }
 
     bool XreCompiler::get_verbosity()
@@ -92,15 +102,14 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
       return this->verbose_;
     }
 
-    // TODO: get rid of global variables
     void XreCompiler::set_error_stream(std::ostream * os)
     {
-      hfst::xre::error_ = os;
+      error_ = os;
     }
 
     std::ostream * XreCompiler::get_error_stream()
     {
-      return hfst::xre::error_;
+      return error_;
     }
 
   XreCompiler&
@@ -108,7 +117,6 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
   {
 #ifdef WINDOWS
     output_to_console_ = value;
-    hfst::xre::output_to_console_ = value;
 #else
     (void)value;
 #endif
@@ -129,10 +137,10 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     std::ostream * XreCompiler::get_stream(std::ostream * oss)
     {
 #ifdef WINDOWS
-      if (hfst::xre::output_to_console_ && (oss == &std::cerr || oss == &std::cout))
+      if (output_to_console_ && (oss == &std::cerr || oss == &std::cout))
         {
-          hfst::xre::redirected_stream_ = oss;
-          return &hfst::xre::winoss_;
+          redirected_stream_ = oss;
+          return &winoss_;
         }
 #endif
       return oss;
@@ -141,16 +149,16 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     void XreCompiler::flush(std::ostream * oss)
     {
 #ifdef WINDOWS
-      if (hfst::xre::output_to_console_ && (oss == &hfst::xre::winoss_))
+      if (output_to_console_ && (oss == &winoss_))
         {
-          if (hfst::xre::redirected_stream_ == &std::cerr)
-            hfst_fprintf_console(stderr, hfst::xre::winoss_.str().c_str());
-          else if (hfst::xre::redirected_stream_ == &std::cout)
-            hfst_fprintf_console(stdout, hfst::xre::winoss_.str().c_str());
+          if (redirected_stream_ == &std::cerr)
+            hfst_fprintf_console(stderr, winoss_.str().c_str());
+          else if (redirected_stream_ == &std::cout)
+            hfst_fprintf_console(stdout, winoss_.str().c_str());
           else
             ;
-          hfst::xre::redirected_stream_ = NULL;
-          hfst::xre::winoss_.str("");
+          redirected_stream_ = NULL;
+          winoss_.str("");
         }
 #endif
     }
@@ -232,32 +240,20 @@ XreCompiler::undefine(const std::string& name)
 void
 XreCompiler::remove_defined_multichar_symbols()
 {
-  if (defined_multichar_symbols_ != NULL)
-    {
-      delete defined_multichar_symbols_;
-      defined_multichar_symbols_ = NULL;
-    }
+  check_multichar_symbols_ = false;
+  defined_multichar_symbols_.clear();
 }
 
 void
 XreCompiler::add_defined_multichar_symbol(const std::string & symbol)
 {
-  if (defined_multichar_symbols_ == NULL)
-    {
-      defined_multichar_symbols_ = new std::set<std::string>();
-    }
-  defined_multichar_symbols_->insert(symbol);
+  check_multichar_symbols_ = true;
+  defined_multichar_symbols_.insert(symbol);
 }
 
-extern bool expand_definitions;
-extern bool harmonize_;
-extern bool harmonize_flags_;
-    //extern bool verbose_;
-    //extern FILE * warning_stream;
-
 void XreCompiler::set_expand_definitions(bool expand)
 {
-  expand_definitions=expand;
+  expand_definitions_=expand;
 }
 
 void XreCompiler::set_harmonization(bool harmonize)
@@ -273,7 +269,7 @@ void XreCompiler::set_flag_harmonization(bool harmonize_flags)
 bool
 XreCompiler::contained_only_comments()
 {
-  return contains_only_comments;
+  return contained_only_comments_;
 }
 
 HfstTransducer*
@@ -281,12 +277,11 @@ XreCompiler::compile(const std::string& xre)
 {
   // debug
   //std::cerr << "XreCompiler: " << this << " : compile(\"" << xre << "\")" << std::endl;
-  unsigned int cr_before = cr;
-  cr = 0;
+  XreCompilation compilation(*this, xre);
   try
     {
-      HfstTransducer * retval = hfst::xre::compile(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_);
-      cr = cr_before;
+      HfstTransducer * retval = hfst::xre::compile(compilation);
+      contained_only_comments_ = compilation.contains_only_comments;
       return retval;
     }
   catch (const char * msg)
@@ -303,13 +298,12 @@ XreCompiler::compile_first(const std::string& xre, unsigned int & chars_read)
 {
   // debug
   //std::cerr << "XreCompiler: " << this << " : compile_first(\"" << xre << "\"";
-  unsigned int cr_before = cr;
-  cr = 0;
+  XreCompilation compilation(*this, xre);
   try
     {
-      HfstTransducer * retval = hfst::xre::compile_first(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_, chars_read);
+      HfstTransducer * retval = hfst::xre::compile_first(compilation, chars_read);
       //std::cerr << ", " << chars_read << ")" << std::endl;
-      cr = cr_before;
+      contained_only_comments_ = compilation.contains_only_comments;
       return retval;
     }
   catch (const char * msg)
@@ -324,14 +318,10 @@ XreCompiler::compile_first(const std::string& xre, unsigned int & chars_read)
 bool XreCompiler::get_positions_of_symbol_in_xre
 (const std::string & symbol, const std::string & xre, std::set<unsigned int> & positions_)
 {
-  position_symbol = strdup(symbol.c_str());
-  positions.clear();
-  unsigned int cr_before = cr;
-  cr = 0;
-  HfstTransducer * compiled =
-    hfst::xre::compile(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_);
-  free(position_symbol);
-  position_symbol = NULL;
+  XreCompilation compilation(*this, xre);
+  compilation.position_symbol = symbol.c_str();
+  HfstTransducer * compiled = hfst::xre::compile(compilation);
+  contained_only_comments_ = compilation.contains_only_comments;
   if (compiled == NULL)
     {
       /*fprintf(stderr, "error in XreCompiler::get_positions_of_symbol_in_xre: xre '%s' "
@@ -340,11 +330,34 @@ bool XreCompiler::get_positions_of_symbol_in_xre
       return false;
     }
   delete compiled;
-  positions_ = positions;
-  cr = cr_before;
+  positions_ = compilation.positions;
   return true;
 }
 
+XreCompilation::XreCompilation(XreCompiler & compiler_, const std::string & xre):
+  compiler(compiler_),
+  data(xre.c_str()),
+  definitions(compiler_.definitions_),
+  function_definitions(compiler_.function_definitions_),
+  function_arguments(compiler_.function_arguments_),
+  symbol_lists(compiler_.list_definitions_),
+  last_compiled(NULL),
+  contains_only_comments(false),
+  format(compiler_.format_),
+  cr(0),
+  lr(1),
+  allow_extra_text_at_end(false),
+  position_symbol(NULL),
+  has_weight_been_zeroed(false),
+  error(compiler_.error_),
+  verbose(compiler_.verbose_),
+  expand_definitions(compiler_.expand_definitions_),
+  harmonize(compiler_.harmonize_),
+  harmonize_flags(compiler_.harmonize_flags_),
+  defined_multichar_symbols(compiler_.check_multichar_symbols_ ?
+                            &compiler_.defined_multichar_symbols_ : NULL)
+{}
+
 }}
 
 #else // UNIT_TEST
@@ -29,6 +29,12 @@
 
 #include <string>
 #include <cstdio>
+#include <set>
+#include <map>
+#include <iostream>
+#ifdef WINDOWS
+#include <sstream>
+#endif
 #include "../HfstDataTypes.h"
 
 namespace hfst {
@@ -155,21 +161,28 @@ class XreCompiler
   XreCompiler& setOutputToConsole(bool value);
   bool getOutputToConsole();
 
-  // TODO get rid of global variables so these functions can be non-static
-  static std::ostream * get_stream(std::ostream * oss);
-  static void flush(std::ostream * oss);
+  std::ostream * get_stream(std::ostream * oss);
+  void flush(std::ostream * oss);
 
   private:
+  friend struct XreCompilation;
   std::map<std::string,hfst::HfstTransducer*> definitions_;
   std::map<std::string, std::string> function_definitions_;
   std::map<std::string, unsigned int > function_arguments_;
   std::map<std::string, std::set<std::string> > list_definitions_;
   hfst::ImplementationType format_;
   bool verbose_;
+  std::ostream * error_;
+  bool expand_definitions_;
+  bool harmonize_;
+  bool harmonize_flags_;
+  bool check_multichar_symbols_;
+  std::set<std::string> defined_multichar_symbols_;
+  bool contained_only_comments_;
 #ifdef WINDOWS
   bool output_to_console_;
-  // global std::ostringstream * winoss_;
-  // global std::ostream * redirected_stream_;
+  std::ostringstream winoss_;
+  std::ostream * redirected_stream_;
 #endif
 
 }
@@ -83,6 +83,10 @@ void CommandLine::print_help(void)
         << "  -D, --dont-resolve-right Don't resolve right-arrow conflicts."
         << std::endl
         << "  -f, --format=FORMAT      Store result in format FORMAT."
+        << std::endl
+        << "  -T, --threads=N          Compile the rules in N threads"
+        << std::endl
+        << "                           (default: one per hardware thread)"
         << std::endl << std::endl;
 
   std::cerr << "Format may be one of openfst-log, openfst-tropical, foma or sfst."
@@ -107,6 +111,7 @@ int CommandLine::parse_options(int argc, char** argv)
   char * infilename = NULL;
   char * debug_file_name = NULL;
   ImplementationType form = hfst::TROPICAL_OPENFST_TYPE;
+  size_t threads = 0;
 
   // use of this function requires options are settable on global scope
   while (true)
@@ -125,12 +130,13 @@ int CommandLine::parse_options(int argc, char** argv)
       {"dont-resolve-right",no_argument, 0, 'D'},
       {"debug_file",required_argument, 0, 'd'},
       {"format",required_argument, 0, 'f'},
+      {"threads",required_argument, 0, 'T'},
       {0,0,0,0}
         };
       int option_index = 0;
       // add tool-specific options here
       int c = getopt_long(argc, argv,
-               ":hVvqsu" "i:o:" "RDi:d:f:",
+               ":hVvqsu" "i:o:" "RDi:d:f:T:",
                long_options, &option_index);
       if (-1 == c)
         {
@@ -212,6 +218,16 @@ int CommandLine::parse_options(int argc, char** argv)
           exit(1);
         }
       break;
+    case 'T':
+      if (atoi(optarg) < 1)
+        {
+          std::cerr << "Invalid thread count \"" << optarg << "\"."
+            << " Try running with option -h or --help."
+            << std::endl;
+          exit(1);
+        }
+      threads = (size_t)atoi(optarg);
+      break;
     case ':':
       std::cerr << "Missing argument for -" << (char)optopt
             << ". Try using --help."
@@ -262,6 +278,7 @@ int CommandLine::parse_options(int argc, char** argv)
   if (this->has_output_file)
     { this->output_file_name = outfilename; }
   this->format = form;
+  this->thread_count = threads;
   //this->help = help;
   //this->usage = usage;
   //this->version = version;
@@ -287,6 +304,7 @@ CommandLine::CommandLine(int argc,char * argv[]):
   output_file(NULL),
   resolve_left_conflicts(false),
   resolve_right_conflicts(true),
+  thread_count(0),
   help(false),
   version(false),
   usage(false),
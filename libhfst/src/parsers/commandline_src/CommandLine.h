@@ -53,6 +53,7 @@ class CommandLine
   ImplementationType format;
   bool resolve_left_conflicts;
   bool resolve_right_conflicts;
+  size_t thread_count;
   bool help;
   bool version;
   bool usage;
@@ -1,4 +1,5 @@
-%option 8Bit batch nounput noyywrap prefix="hlexc"
+%option 8Bit batch nounput noyywrap reentrant bison-bridge prefix="hlexc"
+%option extra-type="hfst::lexc::LexcCompiler *"
 
 %{
 // Copyright (c) 2016 University of Helsinki
@@ -20,17 +21,17 @@
 #  include <config.h>
 #endif
 
-#include "lexc-parser.hh"
 #include "lexc-utils.h"
+#include "lexc-parser.hh"
 #include "HfstDataTypes.h"
 
 #include <assert.h>
 
 
-extern void hlexcerror(const char *text);
+extern void hlexcerror(hfst::lexc::LexcCompiler & lexc, const char *text);
 
 #undef YY_FATAL_ERROR
-#define YY_FATAL_ERROR(msg) hlexcerror(msg);
+#define YY_FATAL_ERROR(msg) hlexcerror(*hlexcget_extra(yyscanner), msg);
 
 %}
 
@@ -93,28 +94,28 @@ LWSP [\r\n\t ]
 
 <INITIAL>^{WSP}*("Multichar_Symbols"|"MULTICHAR_SYMBOLS"){LWSP}+ {
     BEGIN MULTICHARS;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     return MULTICHARS_START;
 }
 
 <INITIAL,MULTICHARS>^{WSP}*("NOFLAGS"|"NoFlags"){LWSP}+ {
     BEGIN NOFLAGS;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     return NOFLAGS_START;
 }
 
 <INITIAL,MULTICHARS,NOFLAGS>^{WSP}*("Definitions"|"Declarations"|"DEFINITIONS"|"DECLARATIONS"){LWSP}+ {
     BEGIN DEFINITIONS;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     return DEFINITIONS_START;
 }
 
 <INITIAL,MULTICHARS,NOFLAGS,DEFINITIONS>{WSP}*("LEXICON"){WSP}+{LEXICONNAME} {
     BEGIN LEXICONS;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     char* lexicon_start;
-    lexicon_start = hfst::lexc::strstrip(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(lexicon_start, "LEXICON",
+    lexicon_start = hfst::lexc::strstrip(yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(lexicon_start, "LEXICON",
                                           NULL, true);
     free(lexicon_start);
     return LEXICON_START;
@@ -122,150 +123,150 @@ LWSP [\r\n\t ]
 
 <INITIAL,MULTICHARS,NOFLAGS,DEFINITIONS>{WSP}*("Lexicon"){WSP}+{LEXICONNAME} {
     BEGIN LEXICONS;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     char* lexicon_start;
-    lexicon_start = hfst::lexc::strstrip(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(lexicon_start, "Lexicon",
+    lexicon_start = hfst::lexc::strstrip(yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(lexicon_start, "Lexicon",
                                           NULL, true);
     free(lexicon_start);
     return LEXICON_START_WRONG_CASE;
 }
 
 <INITIAL,MULTICHARS,NOFLAGS,DEFINITIONS>^{WSP}*("END"){LWSP}+ {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     return END_START;
 }
 
 <INITIAL>!.* {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 }
 
 <INITIAL>{LWSP} {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 }
 
 <MULTICHARS>{STRINGTOKEN} {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = hfst::lexc::strip_percents(hlexctext, false);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = hfst::lexc::strip_percents(*yyextra, yytext, false);
     return MULTICHAR_SYMBOL;
 }
 
-<MULTICHARS>!.* { hfst::lexc::token_update_positions(hlexctext); }
+<MULTICHARS>!.* { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
-<MULTICHARS>{LWSP} { hfst::lexc::token_update_positions(hlexctext); }
+<MULTICHARS>{LWSP} { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
 <NOFLAGS>{LEXICONNAME} {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = strdup(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = strdup(yytext);
     return LEXICON_NAME;
 }
 
-<NOFLAGS>!.* { hfst::lexc::token_update_positions(hlexctext); }
+<NOFLAGS>!.* { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
-<NOFLAGS>{LWSP} { hfst::lexc::token_update_positions(hlexctext); }
+<NOFLAGS>{LWSP} { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
 <NOFLAGS>";" { BEGIN INITIAL; }
 
 <DEFINITIONS>{STRINGTOKEN}{WSP}*/"=" {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = hfst::lexc::strstrip(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = hfst::lexc::strstrip(yytext);
     return DEFINITION_NAME;
 }
 
 <DEFINITIONS>"="{XRETOKEN}";" {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(hlexctext, "=", ";", false);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(yytext, "=", ";", false);
     return DEFINITION_EXPRESSION;
 }
 
-<DEFINITIONS>!.* { hfst::lexc::token_update_positions(hlexctext); }
+<DEFINITIONS>!.* { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
-<DEFINITIONS>{LWSP} { hfst::lexc::token_update_positions(hlexctext); }
+<DEFINITIONS>{LWSP} { hfst::lexc::token_update_positions(*yyextra, yytext); }
 
 <LEXICONS>{WSP}*"LEXICON"{WSP}+{LEXICONNAME} {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     char* lexicon_start;
-    lexicon_start = hfst::lexc::strstrip(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(lexicon_start, "LEXICON", 0, true);
+    lexicon_start = hfst::lexc::strstrip(yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(lexicon_start, "LEXICON", 0, true);
     free(lexicon_start);
     return LEXICON_START;
 }
 
 <LEXICONS>^{WSP}*"Lexicon"{WSP}+{LEXICONNAME} {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     char* lexicon_start;
-    lexicon_start = hfst::lexc::strstrip(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(lexicon_start, "Lexicon", 0, true);
+    lexicon_start = hfst::lexc::strstrip(yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(lexicon_start, "Lexicon", 0, true);
     free(lexicon_start);
     return LEXICON_START_WRONG_CASE;
 }
 
 <LEXICONS>{STRINGTOKEN} {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = hfst::lexc::strip_percents(hlexctext, false);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = hfst::lexc::strip_percents(*yyextra, yytext, false);
     return ULSTRING;
 }
 
 <LEXICONS>"<"{WSP}*{XRETOKEN}{WSP}*">" {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = hfst::lexc::strdup_nonconst_part(hlexctext, "<", ">", false);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = hfst::lexc::strdup_nonconst_part(yytext, "<", ">", false);
     return XEROX_REGEXP;
 }
 
 <LEXICONS>{LEXICONNAME}/{WSP}*("\""|";") {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = strdup(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = strdup(yytext);
     return LEXICON_NAME;
 }
 
 <LEXICONS>"\""[^\n\t""]*"\"" {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexclval.name = strdup(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    yylval->name = strdup(yytext);
     return ENTRY_GLOSS;
 }
 
 <LEXICONS>^{WSP}*"END"{LWSP}+ {
     BEGIN ENDED;
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
     return END_START;
 }
 
 <LEXICONS>";" {
-    hfst::lexc::token_update_positions(hlexctext);
-    return hlexctext[0];
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    return yytext[0];
 }
 
 <LEXICONS>":" {
-    hfst::lexc::token_update_positions(hlexctext);
-    return hlexctext[0];
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    return yytext[0];
 }
 
 <LEXICONS>!.* {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 
 }
 <LEXICONS>{LWSP} {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 
 }
 
 <ENDED>. {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 
 }
 <ENDED>{LWSP} {
-    hfst::lexc::token_update_positions(hlexctext);
+    hfst::lexc::token_update_positions(*yyextra, yytext);
 }
 
 <*>[\x80-\xff] {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexcerror("Illegal 8-bit sequence (cannot form valid UTF-8)");
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    hlexcerror(*yyextra, "Illegal 8-bit sequence (cannot form valid UTF-8)");
     return ERROR;
 }
 
 <*>. {
-    hfst::lexc::token_update_positions(hlexctext);
-    hlexcerror("Syntax error in lexer (no valid token found at the point)");
+    hfst::lexc::token_update_positions(*yyextra, yytext);
+    hlexcerror(*yyextra, "Syntax error in lexer (no valid token found at the point)");
     return ERROR;
 }
 
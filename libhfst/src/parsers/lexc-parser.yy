@@ -28,57 +28,60 @@ using std::string;
 #include "lexc-utils.h"
 
 // obligatory yacc stuff
-extern int hlexclineno;
-void hlexcerror(const char *text);
-int hlexclex(void);
+union YYSTYPE;
+typedef void * yyscan_t;
+void hlexcerror(yyscan_t, hfst::lexc::LexcCompiler & lexc, const char *text);
+void hlexcerror(hfst::lexc::LexcCompiler & lexc, const char *text);
+int hlexclex(YYSTYPE *, yyscan_t);
 
 // Actual functions to handle parsed stuff
 static
 void
-handle_multichar(const string& multichar)
+handle_multichar(hfst::lexc::LexcCompiler & lexc, const string& multichar)
 {
     //in multichars, both @ZERO@ ("%0") and literal 0 ("0") are allowed
-    hfst::lexc::lexc_->addAlphabet(multichar);
+    lexc.addAlphabet(multichar);
 
     string str = std::string(multichar);
     string zero = "@ZERO@";
     size_t start_pos = str.find(zero);
     if(start_pos != std::string::npos)
         str.replace(start_pos, zero.length(), "0");
-    hfst::lexc::lexc_->addAlphabet(str);
+    lexc.addAlphabet(str);
 
     str = std::string(multichar);
     zero = "0";
     start_pos = str.find(zero);
     if(start_pos != std::string::npos)
         str.replace(start_pos, zero.length(), "@ZERO@");
-    hfst::lexc::lexc_->addAlphabet(str);
+    lexc.addAlphabet(str);
 }
 
 static
 void
-handle_noflag(const string& lexname)
+handle_noflag(hfst::lexc::LexcCompiler & lexc, const string& lexname)
 {
     //fprintf(stderr, "DEBUG: Adding %s to noflags\n", lexname.c_str());
-    std::ostream * err = hfst::lexc::lexc_->get_stream((hfst::lexc::lexc_->get_error_stream()));
+    std::ostream * err = lexc.get_stream((lexc.get_error_stream()));
     *err << "DEBUG: Adding " << lexname << " to noflags" << std::endl;
-    hfst::lexc::lexc_->flush(err);
-    hfst::lexc::lexc_->addNoFlag(lexname);
+    lexc.flush(err);
+    lexc.addNoFlag(lexname);
 }
 static
 void
-handle_definition(const string& variable_name, const string& reg_exp)
+handle_definition(hfst::lexc::LexcCompiler & lexc,
+                  const string& variable_name, const string& reg_exp)
 {
-    hfst::lexc::lexc_->addXreDefinition(variable_name, reg_exp);
+    lexc.addXreDefinition(variable_name, reg_exp);
 }
 
 static
 bool
-handle_lexicon_name(const string& lexiconName)
+handle_lexicon_name(hfst::lexc::LexcCompiler & lexc, const string& lexiconName)
 {
   try
   {
-    hfst::lexc::lexc_->setCurrentLexiconName(lexiconName);
+    lexc.setCurrentLexiconName(lexiconName);
   }
   catch(const char * msg)
   {
@@ -124,19 +127,21 @@ handle_string_entry_common(const string&,
 
 static
 void
-handle_string_entry(const string& data, const string& cont, const string& gloss)
+handle_string_entry(hfst::lexc::LexcCompiler & lexc, const string& data,
+                    const string& cont, const string& gloss)
 {
     double weight = 0;
     bool is_glossed = false;
     bool is_heavy = false;
     handle_string_entry_common(cont, gloss, &weight, &is_glossed, &is_heavy);
-    hfst::lexc::lexc_->addStringEntry(data, cont, weight);
+    lexc.addStringEntry(data, cont, weight);
 }
 
 static
 bool
-handle_string_pair_entry(const string& upper, const string& lower,
-                                const string& cont, const string& gloss)
+handle_string_pair_entry(hfst::lexc::LexcCompiler & lexc,
+                         const string& upper, const string& lower,
+                         const string& cont, const string& gloss)
 {
     double weight = 0;
     bool is_glossed = false;
@@ -146,7 +151,7 @@ handle_string_pair_entry(const string& upper, const string& lower,
     if (upper != "0" && lower != "0")
     {
        try {
-         hfst::lexc::lexc_->addStringPairEntry(upper, lower, cont, weight);
+         lexc.addStringPairEntry(upper, lower, cont, weight);
        } catch(const char * msg) {
          (void)msg;
          return false;
@@ -161,7 +166,7 @@ handle_string_pair_entry(const string& upper, const string& lower,
        if (lower == "0")
          lower_ = std::string("");
        try {
-         hfst::lexc::lexc_->addStringPairEntry(upper_, lower_, cont, weight);
+         lexc.addStringPairEntry(upper_, lower_, cont, weight);
        } catch(const char * msg) {
          (void)msg;
          return false;
@@ -172,22 +177,22 @@ handle_string_pair_entry(const string& upper, const string& lower,
 
 static
 void
-handle_regexp_entry(const string& reg_exp, const string& cont,
-                           const string& gloss)
+handle_regexp_entry(hfst::lexc::LexcCompiler & lexc, const string& reg_exp,
+                    const string& cont, const string& gloss)
 {
     double weight = 0;
     bool is_glossed = false;
     bool is_heavy = false;
     handle_string_entry_common(cont, gloss, &weight, &is_glossed, &is_heavy);
-    hfst::lexc::lexc_->addXreEntry(reg_exp, cont, weight);
+    lexc.addXreEntry(reg_exp, cont, weight);
 }
 
 static
 void
-hlexcwarn(const char* text)
+hlexcwarn(hfst::lexc::LexcCompiler & lexc, const char* text)
 {
-  if (! hfst::lexc::lexc_->isQuiet())
-    { hfst::lexc::error_at_current_token(0, 0, text); }
+  if (! lexc.isQuiet())
+    { hfst::lexc::error_at_current_token(lexc, 0, 0, text); }
 }
 
 
@@ -207,10 +212,13 @@ handle_end()
 
 // ouch
 %name-prefix="hlexc"
+// reentrant, the state is in the scanner and the compiler
+%define api.pure
+%lex-param {void * scanner}
+%parse-param {void * scanner}
+%parse-param {hfst::lexc::LexcCompiler & lexc}
 // yup, nice messages
 %error-verbose
-// just cos I use the llloc struct
-%locations
 
 %union
 {
@@ -245,7 +253,7 @@ MULTICHAR_SYMBOL_LIST: MULTICHAR_SYMBOL_LIST MULTICHAR_SYMBOL2
                  ;
 
 MULTICHAR_SYMBOL2: MULTICHAR_SYMBOL {
-            handle_multichar($1);
+            handle_multichar(lexc, $1);
             free($1);
         }
         ;
@@ -262,7 +270,7 @@ NOFLAG_LEXICON_LIST: NOFLAG_LEXICON_LIST NOFLAG_LEXICON2
                  ;
 
 NOFLAG_LEXICON2: LEXICON_NAME {
-            handle_noflag($1);
+            handle_noflag(lexc, $1);
             free($1);
         }
         ;
@@ -279,7 +287,7 @@ DEFINITION_LIST: DEFINITION_LIST DEFINITION_LINE
                   ;
 
 DEFINITION_LINE: DEFINITION_NAME DEFINITION_EXPRESSION {
-                    handle_definition($1, $2);
+                    handle_definition(lexc, $1, $2);
                     free( $1);
                     free( $2);
                 }
@@ -293,20 +301,20 @@ LEXICONS: LEXICONS LEXICON2 LEXICON_LINES
           ;
 
 LEXICON2: LEXICON_START {
-            bool retval = handle_lexicon_name($1);
+            bool retval = handle_lexicon_name(lexc, $1);
             free($1);
             if (!retval)
-              { hlexcerror("Sublexicon defined more than once."); YYABORT; }
+              { hlexcerror(lexc, "Sublexicon defined more than once."); YYABORT; }
           }
           | LEXICON_START_WRONG_CASE {
-            if (hfst::lexc::lexc_->areWarningsTreatedAsErrors())
-              { hlexcerror("Keyword 'Lexicon' used instead of 'LEXICON'. [--Werror]"); YYABORT; }
+            if (lexc.areWarningsTreatedAsErrors())
+              { hlexcerror(lexc, "Keyword 'Lexicon' used instead of 'LEXICON'. [--Werror]"); YYABORT; }
             else
-              { hlexcwarn("Titlecase Lexicon parsed as LEXICON"); }
-            bool retval = handle_lexicon_name($1);
+              { hlexcwarn(lexc, "Titlecase Lexicon parsed as LEXICON"); }
+            bool retval = handle_lexicon_name(lexc, $1);
             free($1);
             if (!retval)
-              { hlexcerror("Sublexicon defined more than once."); YYABORT; }
+              { hlexcerror(lexc, "Sublexicon defined more than once."); YYABORT; }
           }
           ;
 
@@ -315,90 +323,90 @@ LEXICON_LINES: LEXICON_LINES LEXICON_LINE
           ;
 
 LEXICON_LINE: ULSTRING LEXICON_NAME ';' {
-                handle_string_entry($1, $2, "");
+                handle_string_entry(lexc, $1, $2, "");
                 free( $1);
                 free( $2);
               }
               | ULSTRING ':' ULSTRING
                 LEXICON_NAME ';' {
-                bool retval = handle_string_pair_entry($1, $3, $4, "");
+                bool retval = handle_string_pair_entry(lexc, $1, $3, $4, "");
                 free( $1);
                 free( $3);
                 free( $4);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | LEXICON_NAME ';' {
-                handle_string_entry("", $1, "");
+                handle_string_entry(lexc, "", $1, "");
                 free( $1);
               }
               | ULSTRING ':' LEXICON_NAME ';' {
-                bool retval = handle_string_pair_entry($1, "", $3, "");
+                bool retval = handle_string_pair_entry(lexc, $1, "", $3, "");
                 free( $1);
                 free( $3);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | ':' ULSTRING LEXICON_NAME ';' {
-                bool retval = handle_string_pair_entry("", $2, $3, "");
+                bool retval = handle_string_pair_entry(lexc, "", $2, $3, "");
                 free( $2);
                 free( $3);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | ':' LEXICON_NAME ';' {
-                handle_string_entry("", $2, "");
+                handle_string_entry(lexc, "", $2, "");
                 free( $2);
               }
               | ULSTRING LEXICON_NAME ENTRY_GLOSS ';' {
-                handle_string_entry($1, $2, $3);
+                handle_string_entry(lexc, $1, $2, $3);
                 free( $1);
                 free( $2);
                 free( $3);
               }
               | ULSTRING ':' ULSTRING
                 LEXICON_NAME ENTRY_GLOSS ';' {
-                bool retval = handle_string_pair_entry($1, $3, $4, $5);
+                bool retval = handle_string_pair_entry(lexc, $1, $3, $4, $5);
                 free( $1);
                 free( $3);
                 free( $4);
                 free( $5);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | LEXICON_NAME ENTRY_GLOSS ';' {
-                handle_string_entry("", $1, $2);
+                handle_string_entry(lexc, "", $1, $2);
                 free( $1);
                 free( $2);
               }
               | ULSTRING ':' LEXICON_NAME ENTRY_GLOSS ';' {
-                bool retval = handle_string_pair_entry($1, "", $3, $4);
+                bool retval = handle_string_pair_entry(lexc, $1, "", $3, $4);
                 free( $1);
                 free( $3);
                 free( $4);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | ':' ULSTRING LEXICON_NAME ENTRY_GLOSS ';' {
-                bool retval = handle_string_pair_entry("", $2, $3, $4);
+                bool retval = handle_string_pair_entry(lexc, "", $2, $3, $4);
                 free( $2);
                 free( $3);
                 free( $4);
                 if (!retval)
-                  { hlexcerror("Erroneous string pair entry."); YYABORT; }
+                  { hlexcerror(lexc, "Erroneous string pair entry."); YYABORT; }
               }
               | ':' LEXICON_NAME ENTRY_GLOSS ';' {
-                handle_string_entry("", $2, $3);
+                handle_string_entry(lexc, "", $2, $3);
                 free( $2);
                 free( $3);
               }
               | XEROX_REGEXP LEXICON_NAME ';' {
-                handle_regexp_entry($1, $2, "");
+                handle_regexp_entry(lexc, $1, $2, "");
                 free( $1);
                 free( $2);
               }
               | XEROX_REGEXP LEXICON_NAME ENTRY_GLOSS ';' {
-                handle_regexp_entry($1, $2, $3);
+                handle_regexp_entry(lexc, $1, $2, $3);
                 free( $1);
                 free( $2);
                 free( $3);
@@ -413,15 +421,19 @@ END_PART: END_START {
 %%
 
 // oblig. declarations
-extern FILE* hlexcin;
-int hlexcparse(void);
+int hlexcparse(yyscan_t, hfst::lexc::LexcCompiler&);
 
 // gah, bison/flex error mechanism here
 void
-hlexcerror(const char* text)
+hlexcerror(yyscan_t, hfst::lexc::LexcCompiler & lexc, const char* text)
 {
-    hfst::lexc::error_at_current_token(0, 0, text);
-    hlexcnerrs++;
+    hlexcerror(lexc, text);
+}
+
+void
+hlexcerror(hfst::lexc::LexcCompiler & lexc, const char* text)
+{
+    hfst::lexc::error_at_current_token(lexc, 0, 0, text);
 }
 
 // vim: set ft=yacc:
@@ -40,15 +40,11 @@
 using std::string;
 
 // flex stuffa
-extern int hlexclineno;
-static char* hlexcfilename = 0;
-extern char* hlexctext;
-extern YYLTYPE hlexclloc;
+typedef void * yyscan_t;
+extern char* hlexcget_text(yyscan_t);
 
 namespace hfst { namespace lexc {
 
-extern hfst::lexc::LexcCompiler * lexc_;
-
 
 string&
 stripPercents(string& s)
@@ -173,28 +169,9 @@ count_newlines(const char *linestring)
 }
 
 void
-set_infile_name(const char* s)
-{
-    free(hlexcfilename);
-    hlexcfilename = strdup(s);
-}
-
-void
-token_reset_positions()
-{
-    hlexclloc.first_line = hlexclloc.last_line = 1;
-    hlexclloc.first_column = hlexclloc.last_column = 1;
-    hlexclineno = 1;
-    if (hlexcfilename != 0)
-    {
-        free(hlexcfilename);
-    }
-    hlexcfilename = 0;
-}
-
-void
-token_update_positions(const char *token)
+token_update_positions(LexcCompiler& lexc, const char *token)
 {
+    TokenLocation& hlexclloc = lexc.getTokenLocation();
     size_t token_length = strlen(token);
     int newlines = hfst::size_t_to_int(count_newlines(token));
     hlexclloc.first_line = hlexclloc.last_line;
@@ -214,8 +191,10 @@ token_update_positions(const char *token)
 }
 
 char*
-strdup_token_positions()
+strdup_token_positions(LexcCompiler& lexc)
 {
+    const char* hlexcfilename = lexc.getInfileName().c_str();
+    const TokenLocation& hlexclloc = lexc.getTokenLocation();
     // N.B. reason for this error format is automagic support by vim/emacs/jedit
     // must be â€œfilename:lineno:colno-lineno:colno: stuffâ€�
     // c.f. http://www.gnu.org/prep/standards/standards.html#Errors
@@ -249,10 +228,16 @@ strdup_token_positions()
 }
 
 char*
-strdup_token_part()
+strdup_token_part(LexcCompiler& lexc)
 {
+    const char* hlexctext = "";
+    void* scanner = lexc.getScanner();
+    if ((scanner != NULL) && (hlexcget_text(scanner) != NULL))
+    {
+        hlexctext = hlexcget_text(scanner);
+    }
     char *error_token = (char*)malloc(sizeof(char)*strlen(hlexctext)+100);
-    char* maybelbr = strchr(hlexctext, '\n');
+    const char* maybelbr = strchr(hlexctext, '\n');
     if (maybelbr != NULL)
     {
         char* beforelbr = (char*)malloc(sizeof(char)*strlen(hlexctext)+1);
@@ -274,7 +259,7 @@ strdup_token_part()
 }
 
 char*
-strip_percents(const char* s, bool do_zeros)
+strip_percents(LexcCompiler& lexc, const char* s, bool do_zeros)
 {
     char* rv = 0;
     if (do_zeros)
@@ -360,9 +345,10 @@ strip_percents(const char* s, bool do_zeros)
     if (escaping)
     {
       //fprintf(stderr, "Stray escape char %% in %s\n", s);
-      std::ostream * err = hfst::lexc::lexc_->get_stream((hfst::lexc::lexc_->get_error_stream()));
+      std::ostream * err = lexc.get_stream((lexc.get_error_stream()));
       *err << "Stray escape char %% in " << s << std::endl;
-      hfst::lexc::lexc_->flush(err);
+      lexc.flush(err);
+      free(rv);
       return NULL;
     }
     return rv;
@@ -442,15 +428,16 @@ strdup_nonconst_part(const char* token, const char* prefix,
 }
 
 void
-error_at_current_token(int, int, const char* format)
+error_at_current_token(LexcCompiler& lexc, int, int, const char* format)
 {
-    char* leader = strdup_token_positions();
-    char* token = strdup_token_part();
+    char* leader = strdup_token_positions(lexc);
+    char* token = strdup_token_part(lexc);
     //fprintf(stderr, "%s: %s %s\n", leader, format, token);
-      std::ostream * err = hfst::lexc::lexc_->get_stream((hfst::lexc::lexc_->get_error_stream()));
+      std::ostream * err = lexc.get_stream((lexc.get_error_stream()));
       *err << leader << ": " << format << ": " << token << std::endl;
-      hfst::lexc::lexc_->flush(err);
+      lexc.flush(err);
     free(leader);
+    free(token);
 }
 
 
@@ -33,6 +33,8 @@ using namespace std;
 
 namespace hfst { namespace lexc {
 
+class LexcCompiler;
+
 const char LEXC_JOINER_START[] = "$_LEXC_JOINER.";
 const char LEXC_JOINER_END[] = "_$";
 const char LEXC_FLAG_LEFT_START[] = "$R.LEXNAME.";
@@ -75,27 +77,19 @@ std::string replace_zero(const std::string s);
 
 // FLEX HANDLING
 
-//! @brief Set filename used for position messages.
-void set_infile_name(const char* s);
-
-//! @brief Initialise memory of file positions to zeros.
-//!
-//! Sets all members of current yylloc structure to zeros.
-void token_reset_positions();
-
 //! @brief Keep memory of positions of last parsed tokens for error messages.
 //!
-//! Counts length, height and width of the given token. Update yylloc structure
-//! provided by lex and yacc, for location data.
-void token_update_positions(const char* token);
+//! Counts length, height and width of the given token and updates the
+//! token location of @a lexc.
+void token_update_positions(LexcCompiler& lexc, const char* token);
 
-//! @brief writes token positions in standard format.
-char* strdup_token_positions();
+//! @brief writes token positions of @a lexc in standard format.
+char* strdup_token_positions(LexcCompiler& lexc);
 
-//! @brief create some sensible representation of current token.
-char* strdup_token_part();
+//! @brief create some sensible representation of current token of @a lexc.
+char* strdup_token_part(LexcCompiler& lexc);
 //! @brief Strips percent escaping and strdups
-char* strip_percents(const char* s, bool do_zeros);
+char* strip_percents(LexcCompiler& lexc, const char* s, bool do_zeros);
 
 //! @brief Strips initial and final white space and strdups
 char* strstrip(const char* s);
@@ -109,7 +103,8 @@ char* strdup_nonconst_part(const char* token,
 
 // help flex/yacc with meaningful error messages
 //! @brief print error_at_line style error message for current token
-void error_at_current_token(int status, int errnum, const char* format);
+void error_at_current_token(LexcCompiler& lexc, int status, int errnum,
+                            const char* format);
 
 //! @brief Finds med alignment between two strings
 //! Given an upper-lower string lexicon entry, the upper-lower pair is aligned by minimum edit distance with the following costs:
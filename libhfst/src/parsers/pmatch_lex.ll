@@ -1,4 +1,5 @@
-%option 8Bit batch yylineno noyywrap nounput prefix="pmatch"
+%option 8Bit batch yylineno noyywrap nounput reentrant bison-bridge prefix="pmatch"
+%option extra-type="hfst::pmatch::PmatchCompilation *"
 
 %{
 // Copyright (c) 2016 University of Helsinki
@@ -19,12 +20,18 @@
 #include "pmatch_parse.hh"
 
 #undef YY_INPUT
-#define YY_INPUT(buf, retval, maxlen)   (retval = hfst::pmatch::getinput(buf, maxlen))
+#define YY_INPUT(buf, retval, maxlen)   (retval = hfst::pmatch::getinput(*yyextra, buf, maxlen))
 
-extern int pmatcherror(const char *text);
+// Keep track of the position in the input for the compilation cache,
+// which needs the source text of each definition
+#define YY_USER_ACTION yyextra->input_offset += yyleng;
+#define DEFINITION_STARTS yyextra->definition_start = yyextra->input_offset - yyleng
+#define DEFINITION_ENDS yyextra->definition_end = yyextra->input_offset
+
+extern int pmatcherror(hfst::pmatch::PmatchCompilation &, const char *text);
 
 #undef YY_FATAL_ERROR
-#define YY_FATAL_ERROR(msg) pmatcherror(msg);
+#define YY_FATAL_ERROR(msg) pmatcherror(*pmatchget_extra(yyscanner), msg);
 
 %}
 
@@ -66,11 +73,11 @@ HEXCHAR [0-9]|[a-f]
 UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})
 %%
 
-[Dd]"efine" { return DEFINE; }
-"DefFun" { return DEFINE; }
-"regex" { return REGEX; }
+[Dd]"efine" { DEFINITION_STARTS; return DEFINE; }
+"DefFun" { DEFINITION_STARTS; return DEFINE; }
+"regex" { DEFINITION_STARTS; return REGEX; }
 "set" { return SET_VARIABLE; }
-"list" { return DEFINED_LIST; }
+"list" { DEFINITION_STARTS; return DEFINED_LIST; }
 "Lit(" { return LIT_LEFT; }
 "Ins(" { return INS_LEFT; }
 "EndTag(" { return ENDTAG_LEFT; }
@@ -101,7 +108,7 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 "Sigma(" { return SIGMA_LEFT; }
 "Counter(" { return COUNTER_LEFT; }
 [Dd]"efine(" { return DEFINE_LEFT; }
-"DefIns" { return DEFINS; }
+"DefIns" { DEFINITION_STARTS; return DEFINS; }
 
 "Alpha" { return ALPHA; }
 "UppercaseAlpha" { return UPPERALPHA; }
@@ -111,44 +118,49 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 "Whitespace" { return WHITESPACE; }
 
 "count-patterns" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("count-patterns") + 1), "count-patterns");
+    yylval->label = strcpy((char *) malloc(strlen("count-patterns") + 1), "count-patterns");
     return VARIABLE_NAME;
 }
 "delete-patterns" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("delete-patterns") + 1), "delete-patterns");
+    yylval->label = strcpy((char *) malloc(strlen("delete-patterns") + 1), "delete-patterns");
     return VARIABLE_NAME;
 }
 "extract-patterns" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("extract-patterns") + 1), "extract-patterns");
+    yylval->label = strcpy((char *) malloc(strlen("extract-patterns") + 1), "extract-patterns");
     return VARIABLE_NAME;
 }
 "locate-patterns" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("locate-patterns") + 1), "locate-patterns");
+    yylval->label = strcpy((char *) malloc(strlen("locate-patterns") + 1), "locate-patterns");
     return VARIABLE_NAME;
 }
 "mark-patterns" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("mark-patterns") + 1), "mark-patterns");
+    yylval->label = strcpy((char *) malloc(strlen("mark-patterns") + 1), "mark-patterns");
     return VARIABLE_NAME;
 }
 "need-separators" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("need-separators") + 1), "need-separators");
+    yylval->label = strcpy((char *) malloc(strlen("need-separators") + 1), "need-separators");
     return VARIABLE_NAME;
 }
 "max-context-length" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("max-context_length") + 1), "max-context-length");
+    yylval->label = strcpy((char *) malloc(strlen("max-context_length") + 1), "max-context-length");
     return VARIABLE_NAME;
 }
 "max-recursion" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("max-recursion") + 1), "max-recursion");
+    yylval->label = strcpy((char *) malloc(strlen("max-recursion") + 1), "max-recursion");
     return VARIABLE_NAME;
 }
 "xerox-composition" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("xerox-composition") + 1), "xerox-composition");
+    yylval->label = strcpy((char *) malloc(strlen("xerox-composition") + 1), "xerox-composition");
     return VARIABLE_NAME;
 }
 
 "vector-similarity-projection-factor" {
-    pmatchlval.label = strcpy((char *) malloc(strlen("vector-similarity-projection-factor") + 1), "vector-similarity-projection-factor");
+    yylval->label = strcpy((char *) malloc(strlen("vector-similarity-projection-factor") + 1), "vector-similarity-projection-factor");
+    return VARIABLE_NAME;
+}
+
+"vector-index" {
+    yylval->label = strcpy((char *) malloc(strlen("vector-index") + 1), "vector-index");
     return VARIABLE_NAME;
 }
 
@@ -216,27 +228,27 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 "\\\\\\" { return LEFT_QUOTIENT; }
 
 "^"{UINTEGER}","{UINTEGER} {
-    pmatchlval.values = hfst::pmatch::get_n_to_k(pmatchtext);
+    yylval->values = hfst::pmatch::get_n_to_k(yytext);
     return CATENATE_N_TO_K;
 }
 
 "^{"{UINTEGER}","{UINTEGER}"}" {
-    pmatchlval.values = hfst::pmatch::get_n_to_k(pmatchtext);
+    yylval->values = hfst::pmatch::get_n_to_k(yytext);
     return CATENATE_N_TO_K;
 }
 
 "^>"{UINTEGER} {
-    pmatchlval.value = strtol(pmatchtext + 2, 0, 10);
+    yylval->value = strtol(yytext + 2, 0, 10);
     return CATENATE_N_PLUS;
 }
 
 "^<"{UINTEGER} {
-    pmatchlval.value = strtol(pmatchtext + 2, 0, 10);
+    yylval->value = strtol(yytext + 2, 0, 10);
     return CATENATE_N_MINUS;
 }
 
 "^"{UINTEGER}                  {
-    pmatchlval.value = strtol(pmatchtext + 1, 0, 10);
+    yylval->value = strtol(yytext + 1, 0, 10);
     return CATENATE_N;
 }
 
@@ -246,50 +258,50 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 ".l"  { return LOWER_PROJECT; }
 
 "@bin\""[^""]+"\""|"@\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_BIN;
 }
 
 "@txt\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_TEXT;
 }
 
 "@stxt\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_SPACED;
 }
 
 "@pl\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_PROLOG;
 }
 
 "@lexc\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_LEXC;
 }
 
 "@re\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_RE;
 }
 
 "@vec\""[^""]+"\"" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '"');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '"');
     return READ_VEC;
 }
 
 "\""(({UNICODE_ESCAPE}|{U8C})"-"({UNICODE_ESCAPE}|{U8C}))+"\"" {
-    pmatchlval.pmatchObject = hfst::pmatch::parse_range(pmatchtext);
+    yylval->pmatchObject = hfst::pmatch::parse_range(*yyextra, yytext);
     return CHARACTER_RANGE;
 }
 
 {NAME_CH}+"(" {
-    char * label = (char *) malloc(strlen(pmatchtext));
-    strncpy(label, pmatchtext, strlen(pmatchtext));
-    label[strlen(pmatchtext) - 1] = '\0';
-    pmatchlval.label = hfst::pmatch::strip_percents(label);
+    char * label = (char *) malloc(strlen(yytext));
+    strncpy(label, yytext, strlen(yytext));
+    label[strlen(yytext) - 1] = '\0';
+    yylval->label = hfst::pmatch::strip_percents(label);
     free(label);
     return SYMBOL_WITH_LEFT_PAREN;
 }
@@ -310,22 +322,22 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 ":" { return PAIR_SEPARATOR; }
 
 "::"{WEIGHT} {
-    pmatchlval.weight = hfst::pmatch::get_weight(pmatchtext + 2);
+    yylval->weight = hfst::pmatch::get_weight(yytext + 2);
     return WEIGHT;
 }
 
 "{"([^}]|"\\}")+"}" {
-    pmatchlval.label = hfst::pmatch::get_escaped_delimited(pmatchtext, '{', '}');
+    yylval->label = hfst::pmatch::get_escaped_delimited(yytext, '{', '}');
     return CURLY_LITERAL;
 }
 
 "\""([^"\""]|"\\\"")+"\"" {
-    pmatchlval.label = hfst::pmatch::parse_quoted(pmatchtext);
+    yylval->label = hfst::pmatch::parse_quoted(yytext);
     return QUOTED_LITERAL;
 }
 
 {NAME_CH}+ {
-    pmatchlval.label = hfst::pmatch::strip_percents(pmatchtext);
+    yylval->label = hfst::pmatch::strip_percents(yytext);
     return SYMBOL;
 }
 
@@ -333,12 +345,14 @@ UNICODE_ESCAPE ("\\u"{HEXCHAR}{HEXCHAR}{HEXCHAR}{HEXCHAR})|("\\U00"{HEXCHAR}{HEX
 "," { return COMMA; }
 
 ";"{WSP}*{WEIGHT} {
-    pmatchlval.weight = hfst::pmatch::get_weight(pmatchtext + 2);
+    DEFINITION_ENDS;
+    yylval->weight = hfst::pmatch::get_weight(yytext + 2);
     return END_OF_WEIGHTED_EXPRESSION;
 }
 
 ";" {
-    pmatchlval.weight = 0.0;
+    DEFINITION_ENDS;
+    yylval->weight = 0.0;
     return END_OF_WEIGHTED_EXPRESSION;
 }
 
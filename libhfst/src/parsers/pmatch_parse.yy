@@ -24,13 +24,23 @@
     using namespace hfst::pmatch;
     using namespace hfst::xeroxRules;
 
-    extern int pmatcherror(const char * text);
-    extern int pmatchlex();
-    extern int pmatchlineno;
+    union YYSTYPE;
+    typedef void * yyscan_t;
+
+    extern int pmatcherror(yyscan_t, hfst::pmatch::PmatchCompilation &,
+                           const char * text);
+    extern int pmatcherror(hfst::pmatch::PmatchCompilation &,
+                           const char * text);
+    extern int pmatchlex(YYSTYPE *, yyscan_t);
+    extern int pmatchget_lineno(yyscan_t);
 
     %}
 
 %name-prefix="pmatch"
+%define api.pure
+%lex-param {void * scanner}
+%parse-param {void * scanner}
+%parse-param {hfst::pmatch::PmatchCompilation & compilation}
      %error-verbose
      
      %union {
@@ -108,35 +118,36 @@ TAG_LEFT LST_LEFT EXC_LEFT INTERPOLATE_LEFT SIGMA_LEFT COUNTER_LEFT
 
 PMATCH: //empty
 | PMATCH DEFINITION {
-    if (verbose) {
+    if (compilation.verbose) {
         std::cerr << std::setiosflags(std::ios::fixed) << std::setprecision(2);
-        double duration = (clock() - timer) /
+        double duration = (clock() - compilation.timer) /
             (double) CLOCKS_PER_SEC;
-        timer = clock();
+        compilation.timer = clock();
         std::cerr << "defined " << $2->first << " in " << duration << " seconds\n";
     }
-    if (definitions.count($2->first) != 0) {
+    if (compilation.definitions.count($2->first) != 0) {
         std::stringstream warning;
-        warning << "definition of " << $2->first << " on line " << pmatchlineno
+        warning << "definition of " << $2->first << " on line " << pmatchget_lineno(scanner)
                 << " shadows earlier definition\n";
         warn(warning.str());
-        delete definitions[$2->first];
+        delete compilation.definitions[$2->first];
     }
-    definitions.insert(*$2);
+    compilation.definitions.insert(*$2);
+    record_definition_source(compilation, $2->first);
  }
 | PMATCH SET_VARIABLE VARIABLE_NAME SYMBOL {
-    hfst::pmatch::variables[$3] = $4;
+    compilation.variables[$3] = $4;
     free($3); free($4);
  } |
  PMATCH SET_VARIABLE VARIABLE_NAME EPSILON_TOKEN {
      // the symbol can be 0, and that pretty much has to be reserved for
      // epsilon, so we detect that possibility here
-     hfst::pmatch::variables[$3] = "0";
+     compilation.variables[$3] = "0";
      free($3);
  } | PMATCH READ_VEC {
-     std::string filepath = hfst::pmatch::path_from_filename($2);
+     std::string filepath = hfst::pmatch::path_from_filename(compilation, $2);
      free($2);
-     hfst::pmatch::read_vec(filepath);
+     hfst::pmatch::read_vec(compilation, filepath);
    };
 
 DEFINITION: DEFINE SYMBOL EXPRESSION1 {
@@ -146,8 +157,8 @@ DEFINITION: DEFINE SYMBOL EXPRESSION1 {
  } |
  DEFINS SYMBOL EXPRESSION1 {
      $$ = new std::pair<std::string, PmatchObject*>(
-         $2, new PmatchString(get_Ins_transition($2)));
-     def_insed_expressions[$2] = $3;
+         $2, new PmatchString(compilation, get_Ins_transition($2)));
+     compilation.def_insed_expressions[$2] = $3;
      $3->name = $2;
      free($2);
  } |
@@ -156,15 +167,15 @@ DEFINITION: DEFINE SYMBOL EXPRESSION1 {
      $2->name = "TOP";
  } |
  DEFINE SYMBOL_WITH_LEFT_PAREN ARGLIST RIGHT_PARENTHESIS EXPRESSION1 {
-     PmatchFunction * fun = new PmatchFunction(*$3, $5);
+     PmatchFunction * fun = new PmatchFunction(compilation, *$3, $5);
      fun->name = $2;
      $$ = new std::pair<std::string, PmatchObject*>(std::string($2), fun);
-     function_names.insert($2);
+     compilation.function_names.insert($2);
      free($2);
  } |
  DEFINED_LIST SYMBOL EXPRESSION1 {
      $$ = new std::pair<std::string, PmatchObject *>(
-         $2, new PmatchUnaryOperation(MakeSigma, $3));
+         $2, new PmatchUnaryOperation(compilation, MakeSigma, $3));
      $3->name = $2;
  };
 
@@ -177,29 +188,29 @@ QUOTED_LITERAL { $$ = new std::vector<std::string>(1, std::string($1)); free($1)
 
 EXPRESSION1: EXPRESSION2 END_OF_WEIGHTED_EXPRESSION {
      $1->weight += $2;
-     if (need_delimiters) {
-         $$ = new PmatchUnaryOperation(AddDelimiters, $1);
+     if (compilation.need_delimiters) {
+         $$ = new PmatchUnaryOperation(compilation, AddDelimiters, $1);
      } else {
          $$ = $1;
      }
-     need_delimiters = false;
+     compilation.need_delimiters = false;
 };
 
 EXPRESSION2: EXPRESSION3 {} |
-EXPRESSION2 COMPOSITION EXPRESSION3 { $$ = new PmatchBinaryOperation(Compose, $1, $3); } |
-EXPRESSION2 CROSS_PRODUCT EXPRESSION3 { $$ = new PmatchBinaryOperation(CrossProduct, $1, $3); } |
-EXPRESSION2 LENIENT_COMPOSITION EXPRESSION3 { $$ = new PmatchBinaryOperation(LenientCompose, $1, $3); } |
-EXPRESSION2 MERGE_RIGHT_ARROW EXPRESSION3 { $$ = new PmatchBinaryOperation(Merge, $1, $3);} |
-EXPRESSION2 MERGE_LEFT_ARROW EXPRESSION3 { $$ = new PmatchBinaryOperation(Merge, $3, $1); } |
+EXPRESSION2 COMPOSITION EXPRESSION3 { $$ = new PmatchBinaryOperation(compilation, Compose, $1, $3); } |
+EXPRESSION2 CROSS_PRODUCT EXPRESSION3 { $$ = new PmatchBinaryOperation(compilation, CrossProduct, $1, $3); } |
+EXPRESSION2 LENIENT_COMPOSITION EXPRESSION3 { $$ = new PmatchBinaryOperation(compilation, LenientCompose, $1, $3); } |
+EXPRESSION2 MERGE_RIGHT_ARROW EXPRESSION3 { $$ = new PmatchBinaryOperation(compilation, Merge, $1, $3);} |
+EXPRESSION2 MERGE_LEFT_ARROW EXPRESSION3 { $$ = new PmatchBinaryOperation(compilation, Merge, $3, $1); } |
 SUBSTITUTE_LEFT LEFT_BRACKET EXPRESSION3 COMMA EXPRESSION3 COMMA EXPRESSION3 RIGHT_BRACKET {
-    $$ = new PmatchTernaryOperation(Substitute, $3, $5, $7);
+    $$ = new PmatchTernaryOperation(compilation, Substitute, $3, $5, $7);
 } |
 EXPRESSION2 PAIR_SEPARATOR_WO_RIGHT {
-    $$ = new PmatchBinaryOperation(CrossProduct, $1, new PmatchQuestionMark); } |
+    $$ = new PmatchBinaryOperation(compilation, CrossProduct, $1, new PmatchQuestionMark(compilation)); } |
 PAIR_SEPARATOR_WO_LEFT EXPRESSION2 {
-    $$ = new PmatchBinaryOperation(CrossProduct, new PmatchQuestionMark, $2); } |
+    $$ = new PmatchBinaryOperation(compilation, CrossProduct, new PmatchQuestionMark(compilation), $2); } |
 PAIR_SEPARATOR_SOLE {
-    $$ = new PmatchQuestionMark;
+    $$ = new PmatchQuestionMark(compilation);
 };
 
 EXPRESSION3: EXPRESSION4 { } |
@@ -208,24 +219,24 @@ PARALLEL_RULES { };
 PARALLEL_RULES: PARALLEL_RULES COMMACOMMA RULE
 {
     if ($3->arrow != $1->arrow) {
-        pmatcherror("Replace type mismatch in parallel rules");
+        pmatcherror(compilation, "Replace type mismatch in parallel rules");
     }
     $$ = dynamic_cast<PmatchParallelRulesContainer *>($$);
     $1->rules.push_back($3);
 } | RULE {
-    $$ = new PmatchParallelRulesContainer($1);
+    $$ = new PmatchParallelRulesContainer(compilation, $1);
 };
 
 RULE: MAPPINGPAIR_VECTOR
-{ $$ = new PmatchReplaceRuleContainer($1); } |
+{ $$ = new PmatchReplaceRuleContainer(compilation, $1); } |
 MAPPINGPAIR_VECTOR CONTEXTS_WITH_MARK
-{ $$ = new PmatchReplaceRuleContainer($1, $2); };
+{ $$ = new PmatchReplaceRuleContainer(compilation, $1, $2); };
       
 // Mappings: ( ie. a -> b , c -> d , ... , g -> d)
 MAPPINGPAIR_VECTOR: MAPPINGPAIR_VECTOR COMMA MAPPINGPAIR
       {
           if ($1->arrow != $3->arrow) {
-             pmatcherror("Replace type mismatch in parallel rules.");
+             pmatcherror(compilation, "Replace type mismatch in parallel rules.");
           }
          $1->push_back($3);
       }
@@ -233,40 +244,40 @@ MAPPINGPAIR_VECTOR: MAPPINGPAIR_VECTOR COMMA MAPPINGPAIR
     
 MAPPINGPAIR: EXPRESSION3 REPLACE_ARROW EXPRESSION3
 {
-    $$ = new PmatchMappingPairsContainer($2, $1, $3); }
+    $$ = new PmatchMappingPairsContainer(compilation, $2, $1, $3); }
 | EXPRESSION3 REPLACE_ARROW EXPRESSION3 MARKUP_MARKER EXPRESSION3 {
-    $$ = new PmatchMappingPairsContainer($2, new PmatchMarkupContainer($1, $3, $5)); }
+    $$ = new PmatchMappingPairsContainer(compilation, $2, new PmatchMarkupContainer($1, $3, $5)); }
 | EXPRESSION3 REPLACE_ARROW EXPRESSION3 MARKUP_MARKER {
-    $$ = new PmatchMappingPairsContainer($2, new PmatchMarkupContainer($1, $3, new PmatchEpsilonArc));
+    $$ = new PmatchMappingPairsContainer(compilation, $2, new PmatchMarkupContainer($1, $3, new PmatchEpsilonArc(compilation)));
 } | EXPRESSION3 REPLACE_ARROW MARKUP_MARKER EXPRESSION3 {
-    $$ = new PmatchMappingPairsContainer($2, new PmatchMarkupContainer($1, new PmatchEpsilonArc, $4));
+    $$ = new PmatchMappingPairsContainer(compilation, $2, new PmatchMarkupContainer($1, new PmatchEpsilonArc(compilation), $4));
 } | LEFT_BRACKET_DOTTED RIGHT_BRACKET_DOTTED REPLACE_ARROW EXPRESSION3 {
-    $$ = new PmatchMappingPairsContainer($3, new PmatchEpsilonArc, $4);
+    $$ = new PmatchMappingPairsContainer(compilation, $3, new PmatchEpsilonArc(compilation), $4);
 } | LEFT_BRACKET_DOTTED EXPRESSION3 RIGHT_BRACKET_DOTTED REPLACE_ARROW EXPRESSION3 {
-    $$ = new PmatchMappingPairsContainer($4, $2, $5);
+    $$ = new PmatchMappingPairsContainer(compilation, $4, $2, $5);
 } | EXPRESSION3 REPLACE_ARROW LEFT_BRACKET_DOTTED RIGHT_BRACKET_DOTTED {
-    $$ = new PmatchMappingPairsContainer($2, $1, new PmatchEpsilonArc);
+    $$ = new PmatchMappingPairsContainer(compilation, $2, $1, new PmatchEpsilonArc(compilation));
 } | EXPRESSION3 REPLACE_ARROW LEFT_BRACKET_DOTTED EXPRESSION3 RIGHT_BRACKET_DOTTED {
-    $$ = new PmatchMappingPairsContainer($2, $1, $4); };
+    $$ = new PmatchMappingPairsContainer(compilation, $2, $1, $4); };
 
 // Contexts: ( ie. || k _ f , ... , f _ s )
 CONTEXTS_WITH_MARK: CONTEXT_MARK CONTEXTS_VECTOR
 {
-    $$ = new PmatchContextsContainer($1, $2);
+    $$ = new PmatchContextsContainer(compilation, $1, $2);
 };
 CONTEXTS_VECTOR: CONTEXT
 {
-    $$ = new PmatchContextsContainer($1);
+    $$ = new PmatchContextsContainer(compilation, $1);
 } | CONTEXTS_VECTOR COMMA CONTEXT {
     $1->push_back($3);
     $$ = $1;
 };
 
 CONTEXT:
-EXPRESSION3 CENTER_MARKER EXPRESSION3  { $$ = new PmatchContextsContainer($1, $3); } |
-EXPRESSION3 CENTER_MARKER { $$ = new PmatchContextsContainer($1, new PmatchEpsilonArc); } |
-CENTER_MARKER EXPRESSION3 { $$ = new PmatchContextsContainer(new PmatchEpsilonArc, $2); } |
-CENTER_MARKER { $$ = new PmatchContextsContainer(new PmatchEpsilonArc, new PmatchEpsilonArc);
+EXPRESSION3 CENTER_MARKER EXPRESSION3  { $$ = new PmatchContextsContainer(compilation, $1, $3); } |
+EXPRESSION3 CENTER_MARKER { $$ = new PmatchContextsContainer(compilation, $1, new PmatchEpsilonArc(compilation)); } |
+CENTER_MARKER EXPRESSION3 { $$ = new PmatchContextsContainer(compilation, new PmatchEpsilonArc(compilation), $2); } |
+CENTER_MARKER { $$ = new PmatchContextsContainer(compilation, new PmatchEpsilonArc(compilation), new PmatchEpsilonArc(compilation));
 };
 
 CONTEXT_MARK:
@@ -287,14 +298,14 @@ OPTIONAL_REPLACE_LEFT { $$ = E_OPTIONAL_REPLACE_LEFT;
 };
 
 EXPRESSION4: EXPRESSION5 { } |
-EXPRESSION4 SHUFFLE EXPRESSION5 { $$ = new PmatchBinaryOperation(Shuffle, $1, $3); } |
-EXPRESSION4 BEFORE EXPRESSION5 { $$ = new PmatchBinaryOperation(Before, $1, $3);} |
-EXPRESSION4 AFTER EXPRESSION5 { $$ = new PmatchBinaryOperation(After, $1, $3); };
+EXPRESSION4 SHUFFLE EXPRESSION5 { $$ = new PmatchBinaryOperation(compilation, Shuffle, $1, $3); } |
+EXPRESSION4 BEFORE EXPRESSION5 { $$ = new PmatchBinaryOperation(compilation, Before, $1, $3);} |
+EXPRESSION4 AFTER EXPRESSION5 { $$ = new PmatchBinaryOperation(compilation, After, $1, $3); };
 
 EXPRESSION5: EXPRESSION6 { } |
-EXPRESSION6 RIGHT_ARROW RESTR_CONTEXTS { $$ = new PmatchRestrictionContainer($1, $3); } |
-EXPRESSION6 LEFT_ARROW EXPRESSION6 CENTER_MARKER EXPRESSION6 { pmatcherror("Left arrow with contexts not implemented"); } |
-EXPRESSION6 LEFT_RIGHT_ARROW EXPRESSION6 CENTER_MARKER EXPRESSION6 { pmatcherror("Left-right arrow with contexts not implemented"); };
+EXPRESSION6 RIGHT_ARROW RESTR_CONTEXTS { $$ = new PmatchRestrictionContainer(compilation, $1, $3); } |
+EXPRESSION6 LEFT_ARROW EXPRESSION6 CENTER_MARKER EXPRESSION6 { pmatcherror(compilation, "Left arrow with contexts not implemented"); } |
+EXPRESSION6 LEFT_RIGHT_ARROW EXPRESSION6 CENTER_MARKER EXPRESSION6 { pmatcherror(compilation, "Left-right arrow with contexts not implemented"); };
 
 RESTR_CONTEXTS: RESTR_CONTEXT {
     $$ = new MappingPairVector();
@@ -307,210 +318,210 @@ RESTR_CONTEXTS COMMA RESTR_CONTEXT {
 
 RESTR_CONTEXT:
 EXPRESSION6 CENTER_MARKER EXPRESSION6 { $$ = new PmatchObjectPair($1, $3); } |
-EXPRESSION6 CENTER_MARKER { $$ = new PmatchObjectPair($1, new PmatchEpsilonArc); } |
-CENTER_MARKER EXPRESSION6 { $$ = new PmatchObjectPair(new PmatchEpsilonArc, $2); } |
-CENTER_MARKER { $$ = new PmatchObjectPair(new PmatchEmpty, new PmatchEmpty); };
+EXPRESSION6 CENTER_MARKER { $$ = new PmatchObjectPair($1, new PmatchEpsilonArc(compilation)); } |
+CENTER_MARKER EXPRESSION6 { $$ = new PmatchObjectPair(new PmatchEpsilonArc(compilation), $2); } |
+CENTER_MARKER { $$ = new PmatchObjectPair(new PmatchEmpty(compilation), new PmatchEmpty(compilation)); };
 
 EXPRESSION6: EXPRESSION7 { } |
-EXPRESSION6 UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(Disjunct, $1, $3); } |
-EXPRESSION6 INTERSECTION EXPRESSION7 { $$ = new PmatchBinaryOperation(Intersect, $1, $3); } |
-EXPRESSION6 MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(Subtract, $1, $3); } |
-EXPRESSION6 UPPER_MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(UpperSubtract, $1, $3); } |
-EXPRESSION6 LOWER_MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(LowerSubtract, $1, $3); } |
-EXPRESSION6 UPPER_PRIORITY_UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(UpperPriorityUnion, $1, $3); } |
-EXPRESSION6 LOWER_PRIORITY_UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(LowerPriorityUnion, $1, $3); };
+EXPRESSION6 UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, Disjunct, $1, $3); } |
+EXPRESSION6 INTERSECTION EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, Intersect, $1, $3); } |
+EXPRESSION6 MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, Subtract, $1, $3); } |
+EXPRESSION6 UPPER_MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, UpperSubtract, $1, $3); } |
+EXPRESSION6 LOWER_MINUS EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, LowerSubtract, $1, $3); } |
+EXPRESSION6 UPPER_PRIORITY_UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, UpperPriorityUnion, $1, $3); } |
+EXPRESSION6 LOWER_PRIORITY_UNION EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, LowerPriorityUnion, $1, $3); };
 
 EXPRESSION7: EXPRESSION8 { } |
-EXPRESSION7 EXPRESSION7 { $$ = new PmatchBinaryOperation(Concatenate, $1, $2); };
+EXPRESSION7 EXPRESSION7 { $$ = new PmatchBinaryOperation(compilation, Concatenate, $1, $2); };
 
 EXPRESSION8: EXPRESSION9 { } |
-EXPRESSION8 IGNORING EXPRESSION9 { $$ = new PmatchBinaryOperation(InsertFreely, $1, $3); } |
-EXPRESSION8 IGNORE_INTERNALLY EXPRESSION9 { $$ = new PmatchBinaryOperation(IgnoreInternally, $1, $3); } |
-EXPRESSION8 LEFT_QUOTIENT EXPRESSION9 { pmatcherror("Left quotient not implemented"); };
+EXPRESSION8 IGNORING EXPRESSION9 { $$ = new PmatchBinaryOperation(compilation, InsertFreely, $1, $3); } |
+EXPRESSION8 IGNORE_INTERNALLY EXPRESSION9 { $$ = new PmatchBinaryOperation(compilation, IgnoreInternally, $1, $3); } |
+EXPRESSION8 LEFT_QUOTIENT EXPRESSION9 { pmatcherror(compilation, "Left quotient not implemented"); };
 
 EXPRESSION9: EXPRESSION10 { } |
-COMPLEMENT EXPRESSION10 { $$ = new PmatchUnaryOperation(Complement, $2); } |
-CONTAINMENT EXPRESSION10 { $$ = new PmatchUnaryOperation(Containment, $2); } |
-CONTAINMENT_ONCE EXPRESSION10 { $$ = new PmatchUnaryOperation(ContainmentOnce, $2); } |
-CONTAINMENT_OPT EXPRESSION10 { $$ = new PmatchUnaryOperation(ContainmentOptional, $2); };
+COMPLEMENT EXPRESSION10 { $$ = new PmatchUnaryOperation(compilation, Complement, $2); } |
+CONTAINMENT EXPRESSION10 { $$ = new PmatchUnaryOperation(compilation, Containment, $2); } |
+CONTAINMENT_ONCE EXPRESSION10 { $$ = new PmatchUnaryOperation(compilation, ContainmentOnce, $2); } |
+CONTAINMENT_OPT EXPRESSION10 { $$ = new PmatchUnaryOperation(compilation, ContainmentOptional, $2); };
 
 EXPRESSION10: EXPRESSION11 { } |
-EXPRESSION11 STAR { $$ = new PmatchUnaryOperation(RepeatStar, $1); } |
-EXPRESSION11 PLUS { $$ = new PmatchUnaryOperation(RepeatPlus, $1); } |
-EXPRESSION11 REVERSE { $$ = new PmatchUnaryOperation(Reverse, $1); } |
-EXPRESSION11 INVERT { $$ = new PmatchUnaryOperation(Invert, $1); } |
-EXPRESSION11 UPPER_PROJECT { $$ = new PmatchUnaryOperation(InputProject, $1); } |
-EXPRESSION11 LOWER_PROJECT { $$ = new PmatchUnaryOperation(OutputProject, $1); } |
+EXPRESSION11 STAR { $$ = new PmatchUnaryOperation(compilation, RepeatStar, $1); } |
+EXPRESSION11 PLUS { $$ = new PmatchUnaryOperation(compilation, RepeatPlus, $1); } |
+EXPRESSION11 REVERSE { $$ = new PmatchUnaryOperation(compilation, Reverse, $1); } |
+EXPRESSION11 INVERT { $$ = new PmatchUnaryOperation(compilation, Invert, $1); } |
+EXPRESSION11 UPPER_PROJECT { $$ = new PmatchUnaryOperation(compilation, InputProject, $1); } |
+EXPRESSION11 LOWER_PROJECT { $$ = new PmatchUnaryOperation(compilation, OutputProject, $1); } |
 EXPRESSION11 CATENATE_N {
-    $$ = new PmatchNumericOperation(RepeatN, $1);
+    $$ = new PmatchNumericOperation(compilation, RepeatN, $1);
     (dynamic_cast<PmatchNumericOperation *>($$))->values.push_back($2);
 } |
 EXPRESSION11 CATENATE_N_PLUS {
-    $$ = new PmatchNumericOperation(RepeatNPlus, $1);
+    $$ = new PmatchNumericOperation(compilation, RepeatNPlus, $1);
     (dynamic_cast<PmatchNumericOperation *>($$))->values.push_back($2 + 1);
 } |
 EXPRESSION11 CATENATE_N_MINUS {
-    $$ = new PmatchNumericOperation(RepeatNMinus, $1);
+    $$ = new PmatchNumericOperation(compilation, RepeatNMinus, $1);
     (dynamic_cast<PmatchNumericOperation *>($$))->values.push_back($2 - 1);
 } |
 EXPRESSION11 CATENATE_N_TO_K {
-    $$ = new PmatchNumericOperation(RepeatNToK, $1);
+    $$ = new PmatchNumericOperation(compilation, RepeatNToK, $1);
     (dynamic_cast<PmatchNumericOperation *>($$))->values.push_back($2[0]);
     (dynamic_cast<PmatchNumericOperation *>($$))->values.push_back($2[1]);
     free($2);
 };
 
 EXPRESSION11: EXPRESSION12 { } |
-TERM_COMPLEMENT EXPRESSION12 { $$ = new PmatchUnaryOperation(TermComplement, $2); };
+TERM_COMPLEMENT EXPRESSION12 { $$ = new PmatchUnaryOperation(compilation, TermComplement, $2); };
 
 EXPRESSION12: EXPRESSION13 { } |
 LEFT_BRACKET EXPRESSION2 RIGHT_BRACKET { $$ = $2; } |
-EXPRESSION12 PAIR_SEPARATOR EXPRESSION12 { $$ = new PmatchBinaryOperation(CrossProduct, $1, $3); } |
-LEFT_PARENTHESIS EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(Optionalize, $2); } |
+EXPRESSION12 PAIR_SEPARATOR EXPRESSION12 { $$ = new PmatchBinaryOperation(compilation, CrossProduct, $1, $3); } |
+LEFT_PARENTHESIS EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, Optionalize, $2); } |
 EXPRESSION12 WEIGHT { $$ = $1; $$->weight += $2; } |
 LEFT_BRACKET EXPRESSION2 RIGHT_BRACKET TAG_LEFT SYMBOL RIGHT_PARENTHESIS {
-    $$ = new PmatchUnaryOperation(AddDelimiters,
-                                  new PmatchBinaryOperation(Concatenate, $2,
-                                                            hfst::pmatch::make_end_tag($5)));
+    $$ = new PmatchUnaryOperation(compilation, AddDelimiters,
+                                  new PmatchBinaryOperation(compilation, Concatenate, $2,
+                                                            hfst::pmatch::make_end_tag(compilation, $5)));
     free($5); } |
 LEFT_BRACKET EXPRESSION2 RIGHT_BRACKET TAG_LEFT QUOTED_LITERAL RIGHT_PARENTHESIS {
-    $$ = new PmatchUnaryOperation(AddDelimiters,
-                                  new PmatchBinaryOperation(Concatenate, $2,
-                                                            hfst::pmatch::make_end_tag($5)));
+    $$ = new PmatchUnaryOperation(compilation, AddDelimiters,
+                                  new PmatchBinaryOperation(compilation, Concatenate, $2,
+                                                            hfst::pmatch::make_end_tag(compilation, $5)));
     free($5); } |
     LEFT_BRACKET EXPRESSION2 RIGHT_BRACKET WITH_LEFT SYMBOL EQUALS SYMBOL RIGHT_PARENTHESIS {
-        $$ = new PmatchBinaryOperation(
+        $$ = new PmatchBinaryOperation(compilation,
             Concatenate,
-            new PmatchBinaryOperation(Concatenate,
-                                      hfst::pmatch::make_with_tag_entry($5, $7),
+            new PmatchBinaryOperation(compilation, Concatenate,
+                                      hfst::pmatch::make_with_tag_entry(compilation, $5, $7),
                                       $2),
-            hfst::pmatch::make_with_tag_exit($5));
+            hfst::pmatch::make_with_tag_exit(compilation, $5));
     free($5); free($7); };
 
 EXPRESSION13:
-QUOTED_LITERAL { $$ = new PmatchString(std::string($1)); free($1); } |
-EPSILON_TOKEN { $$ = new PmatchString(hfst::internal_epsilon); } |
-BOUNDARY_MARKER { $$ = new PmatchString("@BOUNDARY@"); } |
-LIT_LEFT SYMBOL RIGHT_PARENTHESIS { $$ = new PmatchString(std::string($2)); free($2); } |
+QUOTED_LITERAL { $$ = new PmatchString(compilation, std::string($1)); free($1); } |
+EPSILON_TOKEN { $$ = new PmatchString(compilation, hfst::internal_epsilon); } |
+BOUNDARY_MARKER { $$ = new PmatchString(compilation, "@BOUNDARY@"); } |
+LIT_LEFT SYMBOL RIGHT_PARENTHESIS { $$ = new PmatchString(compilation, std::string($2)); free($2); } |
 CURLY_LITERAL {
-    PmatchString * retval = new PmatchString(std::string($1));
+    PmatchString * retval = new PmatchString(compilation, std::string($1));
     retval->multichar = true;
     $$ = retval; free($1);
 } |
-ANY_TOKEN { $$ = new PmatchQuestionMark; } |
+ANY_TOKEN { $$ = new PmatchQuestionMark(compilation); } |
 EXPLODE { } |
 IMPLODE { } |
 FUNCALL { } |
 //MAP { } |
 INSERTION { } |
-LIKE { } |
-ALPHA { $$ = new PmatchAcceptor(Alpha); } |
-LOWERALPHA { $$ = new PmatchAcceptor(LowercaseAlpha); } |
-UPPERALPHA { $$ = new PmatchAcceptor(UppercaseAlpha); } |
-NUM { $$ = new PmatchAcceptor(Numeral); } |
-PUNCT { $$ = new PmatchAcceptor(Punctuation); } |
-WHITESPACE { $$ = new PmatchAcceptor(Whitespace); } |
-CAP_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(Cap, $2); } |
-OPTCAP_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(OptCap, $2); } |
-TOLOWER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(ToLower, $2); } |
-TOUPPER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(ToUpper, $2); } |
-OPT_TOLOWER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(OptToLower, $2); } |
-OPT_TOUPPER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(OptToUpper, $2); } |
-ANY_CASE_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(AnyCase, $2); } |
+LIKE { $$ = $1; compilation.definition_is_cacheable = false; } |
+ALPHA { $$ = new PmatchAcceptor(compilation, Alpha); } |
+LOWERALPHA { $$ = new PmatchAcceptor(compilation, LowercaseAlpha); } |
+UPPERALPHA { $$ = new PmatchAcceptor(compilation, UppercaseAlpha); } |
+NUM { $$ = new PmatchAcceptor(compilation, Numeral); } |
+PUNCT { $$ = new PmatchAcceptor(compilation, Punctuation); } |
+WHITESPACE { $$ = new PmatchAcceptor(compilation, Whitespace); } |
+CAP_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, Cap, $2); } |
+OPTCAP_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, OptCap, $2); } |
+TOLOWER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, ToLower, $2); } |
+TOUPPER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, ToUpper, $2); } |
+OPT_TOLOWER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, OptToLower, $2); } |
+OPT_TOUPPER_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, OptToUpper, $2); } |
+ANY_CASE_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, AnyCase, $2); } |
 
 CAP_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(CapUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, CapUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(CapLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, CapLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(Cap, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, Cap, $2);
     }
     free($4);
 } |
 OPTCAP_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(OptCapUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptCapUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(OptCapLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptCapLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(OptCap, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, OptCap, $2);
     }
     free($4);
 } |
 TOLOWER_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(ToLowerUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, ToLowerUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(ToLowerLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, ToLowerLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(ToLower, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, ToLower, $2);
     }
     free($4);
 } |
 TOUPPER_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(ToUpperUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, ToUpperUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(ToUpperLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, ToUpperLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(ToUpper, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, ToUpper, $2);
     }
     free($4);
 } |
 OPT_TOLOWER_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(OptToLowerUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptToLowerUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(OptToLowerLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptToLowerLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(OptToLower, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, OptToLower, $2);
     }
     free($4);
 } |
 OPT_TOUPPER_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(OptToUpperUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptToUpperUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(OptToUpperLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, OptToUpperLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(OptToUpper, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, OptToUpper, $2);
     }
     free($4);
 } |
 ANY_CASE_LEFT EXPRESSION2 COMMA SYMBOL RIGHT_PARENTHESIS {
     if (strcmp($4, "U") == 0) {
-        $$ = new PmatchUnaryOperation(AnyCaseUpper, $2);
+        $$ = new PmatchUnaryOperation(compilation, AnyCaseUpper, $2);
     } else if (strcmp($4, "L") == 0) {
-        $$ = new PmatchUnaryOperation(AnyCaseLower, $2);
+        $$ = new PmatchUnaryOperation(compilation, AnyCaseLower, $2);
     } else {
-        pmatcherror("Side argument to casing function not understood\n");
-        $$ = new PmatchUnaryOperation(AnyCase, $2);
+        pmatcherror(compilation, "Side argument to casing function not understood\n");
+        $$ = new PmatchUnaryOperation(compilation, AnyCase, $2);
     }
     free($4);
 } |
-DEFINE_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(AddDelimiters, $2); } |
-READ_FROM { } |
+DEFINE_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, AddDelimiters, $2); } |
+READ_FROM { $$ = $1; compilation.definition_is_cacheable = false; } |
 CHARACTER_RANGE { $$ = $1; } |
-LST_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(MakeList, $2); } |
-EXC_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(MakeExcList, $2); } |
-INTERPOLATE_LEFT FUNCALL_ARGLIST RIGHT_PARENTHESIS { $$ = new PmatchBuiltinFunction(Interpolate, $2); } |
-SIGMA_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(MakeSigma, $2); } |
-COUNTER_LEFT SYMBOL RIGHT_PARENTHESIS { $$ = hfst::pmatch::make_counter($2); free($2); } |
-ENDTAG { $$ = $1; hfst::pmatch::need_delimiters = true; } |
+LST_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, MakeList, $2); } |
+EXC_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, MakeExcList, $2); } |
+INTERPOLATE_LEFT FUNCALL_ARGLIST RIGHT_PARENTHESIS { $$ = new PmatchBuiltinFunction(compilation, Interpolate, $2); } |
+SIGMA_LEFT EXPRESSION2 RIGHT_PARENTHESIS { $$ = new PmatchUnaryOperation(compilation, MakeSigma, $2); } |
+COUNTER_LEFT SYMBOL RIGHT_PARENTHESIS { $$ = hfst::pmatch::make_counter(compilation, $2); free($2); } |
+ENDTAG { $$ = $1; compilation.need_delimiters = true; } |
 CAPTURE {
     $$ = $1;
-    hfst::pmatch::need_delimiters = true; } |
+    compilation.need_delimiters = true; } |
 CONTEXT_CONDITION {
     $$ = $1;
     // We will wrap the current definition with entry and exit guards
-    hfst::pmatch::need_delimiters = true;
+    compilation.need_delimiters = true;
     // Should we switch off the automatic separator-seeking context condition now?
 //    hfst::pmatch::variables["need-separators"] = "off";
 } |
@@ -518,44 +529,46 @@ SYMBOL {
     std::string sym($1);
     free($1);
     if (sym.size() == 0) {
-        $$ = new PmatchEmpty;
+        $$ = new PmatchEmpty(compilation);
     } else {
-        $$ = new PmatchSymbol(sym);
-        used_definitions.insert(sym);
+        $$ = new PmatchSymbol(compilation, sym);
+        compilation.used_definitions.insert(sym);
+        compilation.definition_uses.insert(sym);
     }
 };
 
 EXPLODE: EXPLODE_LEFT CONCATENATED_STRING_LIST RIGHT_PARENTHESIS
 {
-    $$ = new PmatchUnaryOperation(Explode, $2);
+    $$ = new PmatchUnaryOperation(compilation, Explode, $2);
 };
 
 IMPLODE: IMPLODE_LEFT CONCATENATED_STRING_LIST RIGHT_PARENTHESIS
 {
-    $$ = new PmatchUnaryOperation(Implode, $2);
+    $$ = new PmatchUnaryOperation(compilation, Implode, $2);
 };
 
 CONCATENATED_STRING_LIST: STRINGLIKE
 { $$ = $1; } |
 STRINGLIKE COMMA CONCATENATED_STRING_LIST
 {
-    $$ = new PmatchBinaryOperation(Concatenate, $1, $3);
+    $$ = new PmatchBinaryOperation(compilation, Concatenate, $1, $3);
 };
 
 FUNCALL: SYMBOL_WITH_LEFT_PAREN FUNCALL_ARGLIST RIGHT_PARENTHESIS
 {
     std::string sym($1);
-    if (function_names.count($1) == 0) {
+    if (compilation.function_names.count($1) == 0) {
         std::stringstream ss;
         ss << "Function " << sym << " hasn't been defined\n";
-        pmatcherror(ss.str().c_str());
-        $$ = new PmatchString("");
+        pmatcherror(compilation, ss.str().c_str());
+        $$ = new PmatchString(compilation, "");
     } else {
-        $$ = new PmatchFuncall(
+        $$ = new PmatchFuncall(compilation,
             $2,
-            dynamic_cast<PmatchFunction *>(symbol_from_global_context(sym)));
+            dynamic_cast<PmatchFunction *>(symbol_from_global_context(compilation, sym)));
     }
-    used_definitions.insert(sym);
+    compilation.used_definitions.insert(sym);
+    compilation.definition_uses.insert(sym);
     free($1);
 };
 
@@ -565,42 +578,43 @@ EXPRESSION2 { $$ = new std::vector<PmatchObject *>(1, $1); } |
 { $$ = new std::vector<PmatchObject *>; };
 
 INSERTION: INS_LEFT SYMBOL RIGHT_PARENTHESIS {
-    if (!hfst::pmatch::flatten) {
-        if(hfst::pmatch::definitions.count($2) == 0) {
-            hfst::pmatch::unsatisfied_insertions.insert($2);
+    if (!compilation.flatten) {
+        if(compilation.definitions.count($2) == 0) {
+            compilation.unsatisfied_insertions.insert($2);
         }
-        $$ = new PmatchString(hfst::pmatch::get_Ins_transition($2));
-        hfst::pmatch::inserted_names.insert($2);
-        hfst::pmatch::used_definitions.insert($2);
-    } else if(hfst::pmatch::definitions.count($2) != 0) {
-        $$ = hfst::pmatch::definitions[$2];
+        $$ = new PmatchString(compilation, hfst::pmatch::get_Ins_transition($2));
+        compilation.inserted_names.insert($2);
+        compilation.used_definitions.insert($2);
+    } else if(compilation.definitions.count($2) != 0) {
+        $$ = compilation.definitions[$2];
+        compilation.definition_uses.insert($2);
     } else {
-        $$ = new PmatchEmpty;
+        $$ = new PmatchEmpty(compilation);
         std::stringstream ss;
-        ss << "Insertion of " << $2 << " on line " << pmatchlineno << " is undefined and --flatten is in use\n";
-        pmatcherror(ss.str().c_str());
+        ss << "Insertion of " << $2 << " on line " << pmatchget_lineno(scanner) << " is undefined and --flatten is in use\n";
+        pmatcherror(compilation, ss.str().c_str());
     }
     free($2);
 };
 
 LIKE: LIKE_LEFT ARGLIST RIGHT_PARENTHESIS {
     if ($2->size() == 0) {
-        $$ = hfst::pmatch::compile_like_arc("");
+        $$ = hfst::pmatch::compile_like_arc(compilation, "");
     } else if ($2->size() == 1) {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](0));
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](0));
     } else {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](0),
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](0),
                                             $2->operator[](1));
     }
     delete($2);
 } |
 LIKE_LEFT ARGLIST RIGHT_PARENTHESIS CATENATE_N {
     if ($2->size() == 0) {
-        $$ = hfst::pmatch::compile_like_arc("");
+        $$ = hfst::pmatch::compile_like_arc(compilation, "");
     } else if ($2->size() == 1) {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](0), $4);
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](0), $4);
     } else {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](0),
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](0),
                                             $2->operator[](1), $4);
     }
     delete($2);
@@ -609,9 +623,9 @@ UNLIKE_LEFT ARGLIST RIGHT_PARENTHESIS {
     if ($2->size() < 2) {
         std::stringstream err;
         err << "Unlike() operation takes exactly 2 arguments, got " << $2->size();
-        pmatcherror(err.str().c_str());
+        pmatcherror(compilation, err.str().c_str());
     } else {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](1),
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](1),
                                             $2->operator[](0), 10, true);
     }
     delete($2);
@@ -620,9 +634,9 @@ UNLIKE_LEFT ARGLIST RIGHT_PARENTHESIS CATENATE_N {
     if ($2->size() < 2) {
         std::stringstream err;
         err << "Unlike() operation takes exactly 2 arguments, got " << $2->size();
-        pmatcherror(err.str().c_str());
+        pmatcherror(compilation, err.str().c_str());
     } else {
-        $$ = hfst::pmatch::compile_like_arc($2->operator[](1),
+        $$ = hfst::pmatch::compile_like_arc(compilation, $2->operator[](1),
                                             $2->operator[](0), $4, true);
     }
     delete($2);
@@ -630,33 +644,35 @@ UNLIKE_LEFT ARGLIST RIGHT_PARENTHESIS CATENATE_N {
 
 
 ENDTAG: ENDTAG_LEFT SYMBOL RIGHT_PARENTHESIS {
-    $$ = hfst::pmatch::make_end_tag($2);
+    $$ = hfst::pmatch::make_end_tag(compilation, $2);
     free($2);
 } | ENDTAG_LEFT QUOTED_LITERAL RIGHT_PARENTHESIS {
-    $$ = hfst::pmatch::make_end_tag($2);
+    $$ = hfst::pmatch::make_end_tag(compilation, $2);
     free($2);
 };
 
 CAPTURE: CAPTURE_LEFT SYMBOL RIGHT_PARENTHESIS {
-    $$ = hfst::pmatch::make_capture_tag($2);
-    PmatchObject * captured = hfst::pmatch::make_captured_tag($2);
+    $$ = hfst::pmatch::make_capture_tag(compilation, $2);
+    PmatchObject * captured = hfst::pmatch::make_captured_tag(compilation, $2);
     std::pair<std::string, PmatchObject*> captured_def($2, captured);
-    if (definitions.count(captured_def.first) != 0) {
+    if (compilation.definitions.count(captured_def.first) != 0) {
         std::stringstream warning;
-        warning << "definition of " << captured_def.first << " on line " << pmatchlineno
+        warning << "definition of " << captured_def.first << " on line " << pmatchget_lineno(scanner)
                 << " shadows earlier definition\n";
         warn(warning.str());
-        delete definitions[captured_def.first];
+        delete compilation.definitions[captured_def.first];
     }
-    definitions.insert(captured_def);
+    compilation.definitions.insert(captured_def);
+    record_definition_source(compilation, captured_def.first,
+                             "@capture " + captured_def.first);
     free($2);
 } | CAPTURE_LEFT QUOTED_LITERAL RIGHT_PARENTHESIS {
-    $$ = hfst::pmatch::make_capture_tag($2);
+    $$ = hfst::pmatch::make_capture_tag(compilation, $2);
     free($2);
 };
 
 READ_FROM: READ_BIN {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
     HfstTransducer * read = NULL;
     try {
@@ -667,48 +683,48 @@ READ_FROM: READ_BIN {
         std::string ermsg =
             std::string("Couldn't read transducer from ") +
             filepath;
-        pmatcherror(ermsg.c_str());
+        pmatcherror(compilation, ermsg.c_str());
     }
-    if (read->get_type() != hfst::pmatch::format) {
-        read->convert(hfst::pmatch::format);
+    if (read->get_type() != compilation.format) {
+        read->convert(compilation.format);
     }
-    $$ = new PmatchTransducerContainer(read);
+    $$ = new PmatchTransducerContainer(compilation, read);
 } | READ_TEXT {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
-    $$ = new PmatchTransducerContainer(hfst::pmatch::read_text(filepath));
+    $$ = new PmatchTransducerContainer(compilation, hfst::pmatch::read_text(filepath));
 } | READ_SPACED {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
-    $$ = new PmatchTransducerContainer(hfst::pmatch::read_spaced_text(filepath));
+    $$ = new PmatchTransducerContainer(compilation, hfst::pmatch::read_spaced_text(filepath));
 } | READ_PROLOG {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
     FILE * f = NULL;
     f = hfst::hfst_fopen(filepath.c_str(), "r");
     if (f == NULL) {
-        pmatcherror("File cannot be opened.\n");
+        pmatcherror(compilation, "File cannot be opened.\n");
     } else {
         try {
             unsigned int linecount = 0;
             HfstBasicTransducer tmp = HfstBasicTransducer::read_in_prolog_format(f, linecount);
             fclose(f);
-            HfstTransducer * t = new HfstTransducer(tmp, hfst::pmatch::format);
+            HfstTransducer * t = new HfstTransducer(tmp, compilation.format);
             t->minimize();
-            $$ = new PmatchTransducerContainer(t);
+            $$ = new PmatchTransducerContainer(compilation, t);
         }
         catch (const HfstException & e) {
             (void) e;
             fclose(f);
-            pmatcherror("Error reading prolog file.\n");
+            pmatcherror(compilation, "Error reading prolog file.\n");
         }
     }
 } | READ_LEXC {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
-    $$ = new PmatchTransducerContainer(hfst::HfstTransducer::read_lexc_ptr(filepath, format, hfst::pmatch::verbose));
+    $$ = new PmatchTransducerContainer(compilation, hfst::HfstTransducer::read_lexc_ptr(filepath, compilation.format, compilation.verbose));
 } | READ_RE {
-    std::string filepath = hfst::pmatch::path_from_filename($1);
+    std::string filepath = hfst::pmatch::path_from_filename(compilation, $1);
     free($1);
     std::string regex;
     std::string tmp;
@@ -721,10 +737,10 @@ READ_FROM: READ_BIN {
     if (regex.size() == 0) {
         std::stringstream err;
         err << "Failed to read regex from " << filepath << ".\n";
-        pmatcherror(err.str().c_str());
+        pmatcherror(compilation, err.str().c_str());
     }
     hfst::xre::XreCompiler xre_compiler;
-    $$ = new PmatchTransducerContainer(xre_compiler.compile(regex));
+    $$ = new PmatchTransducerContainer(compilation, xre_compiler.compile(regex));
     };
 
 CONTEXT_CONDITION:
@@ -747,13 +763,13 @@ PMATCH_OR_CONTEXT: OR_LEFT PMATCH_CONTEXTS RIGHT_PARENTHESIS
             $$ = *it;
         } else {
             PmatchObject * tmp = $$;
-            $$ = new PmatchBinaryOperation(Disjunct, tmp, *it);
+            $$ = new PmatchBinaryOperation(compilation, Disjunct, tmp, *it);
         }
     }
     delete $2;
     // Zero the counter for making minimization
     // guards for disjuncted negative contexts
-    hfst::pmatch::zero_minimization_guard();
+    hfst::pmatch::zero_minimization_guard(compilation);
 };
 
 PMATCH_AND_CONTEXT: AND_LEFT PMATCH_CONTEXTS RIGHT_PARENTHESIS
@@ -765,7 +781,7 @@ PMATCH_AND_CONTEXT: AND_LEFT PMATCH_CONTEXTS RIGHT_PARENTHESIS
             $$ = *it;
         } else {
             PmatchObject * tmp = $$;
-            $$ = new PmatchBinaryOperation(Concatenate, tmp, *it);
+            $$ = new PmatchBinaryOperation(compilation, Concatenate, tmp, *it);
         }
     }
     delete $2;
@@ -782,27 +798,27 @@ PMATCH_CONTEXT COMMA PMATCH_CONTEXTS {
 
 PMATCH_RIGHT_CONTEXT: RC_LEFT EXPRESSION2 RIGHT_PARENTHESIS {
     $2->mark_context_children();
-    $$ = new PmatchUnaryOperation(RC, $2);
+    $$ = new PmatchUnaryOperation(compilation, RC, $2);
 };
 
 PMATCH_NEGATIVE_RIGHT_CONTEXT: NRC_LEFT EXPRESSION2 RIGHT_PARENTHESIS {
     $2->mark_context_children();
-    $$ = new PmatchUnaryOperation(NRC, $2);
+    $$ = new PmatchUnaryOperation(compilation, NRC, $2);
 };
 
 PMATCH_LEFT_CONTEXT: LC_LEFT EXPRESSION2 RIGHT_PARENTHESIS {
     $2->mark_context_children();
-    $$ = new PmatchUnaryOperation(LC, $2);
+    $$ = new PmatchUnaryOperation(compilation, LC, $2);
 };
 
 PMATCH_NEGATIVE_LEFT_CONTEXT: NLC_LEFT EXPRESSION2 RIGHT_PARENTHESIS {
     $2->mark_context_children();
-    $$ = new PmatchUnaryOperation(NLC, $2);
+    $$ = new PmatchUnaryOperation(compilation, NLC, $2);
 };
 
-STRINGLIKE: QUOTED_LITERAL { $$ = new PmatchString($1); free($1); } |
-CURLY_LITERAL { $$ = new PmatchString(std::string($1), true); free($1); } |
-SYMBOL { $$ = new PmatchSymbol($1); free($1); }
+STRINGLIKE: QUOTED_LITERAL { $$ = new PmatchString(compilation, $1); free($1); } |
+CURLY_LITERAL { $$ = new PmatchString(compilation, std::string($1), true); free($1); } |
+SYMBOL { $$ = new PmatchSymbol(compilation, $1); free($1); }
 ;
 
 // MAP: MAP_LEFT SYMBOL COMMA READ_TEXT RIGHT_PARENTHESIS {
@@ -16,44 +16,68 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <random>
 #include <sstream>
+#include <thread>
 
 #include "HfstTransducer.h"
 #include "HfstExceptionDefs.h"
+#include "thread-utils.h"
 
 #include "pmatch_utils.h"
 #include "xre_utils.h"
+#include "XreCompiler.h"
 //#include "tools/src/HfstUtf8.h"
 #include "implementations/optimized-lookup/pmatch.h"
 
 using std::string;
 using std::map;
 
-extern int pmatchlineno;
-extern char* pmatchtext;
-extern int pmatchparse();
-extern int pmatchnerrs;
+typedef void * yyscan_t;
+extern int pmatchparse(yyscan_t, hfst::pmatch::PmatchCompilation &);
+extern int pmatchlex_init_extra(hfst::pmatch::PmatchCompilation *, yyscan_t*);
+extern int pmatchlex_destroy(yyscan_t);
+extern int pmatchget_lineno(yyscan_t);
+extern char * pmatchget_text(yyscan_t);
+
+// The line being parsed, or 0 outside of parsing
+static int current_lineno(hfst::pmatch::PmatchCompilation & compilation)
+{
+    if (compilation.scanner == NULL) {
+        return 0;
+    }
+    return pmatchget_lineno(compilation.scanner);
+}
 
 int
-pmatcherror(const char *msg)
+pmatcherror(yyscan_t scanner, hfst::pmatch::PmatchCompilation & compilation,
+            const char *msg)
 {
     std::string parsedata;
-    if (strlen(hfst::pmatch::data) < 60) {
-        parsedata = hfst::pmatch::data;
+    if (compilation.data == NULL) {
+        parsedata = "";
+    }
+    else if (strlen(compilation.data) < 60) {
+        parsedata = compilation.data;
     }
     else {
-        parsedata = std::string(hfst::pmatch::data, 59) + "... [truncated]";
+        parsedata = std::string(compilation.data, 59) + "... [truncated]";
     }
     std::string errmsg = "pmatch parsing failed: ";
     errmsg.append(msg);
     errmsg.append("\n*** parsing ");
     errmsg.append(parsedata);
-    errmsg.append(" at line ");
-    std::ostringstream ss;
-    ss << pmatchlineno;
-    errmsg.append(ss.str());
-    errmsg.append(" near ");
-    errmsg.append(pmatchtext);
+    if (scanner != NULL) {
+        errmsg.append(" at line ");
+        std::ostringstream ss;
+        ss << pmatchget_lineno(scanner);
+        errmsg.append(ss.str());
+        errmsg.append(" near ");
+        errmsg.append(pmatchget_text(scanner));
+    }
     errmsg.append("\n");
 
     // TODO: clean the potentially large amounts of data we're leaking in case
@@ -62,14 +86,21 @@ pmatcherror(const char *msg)
     HFST_THROW_MESSAGE(HfstException, errmsg);
 }
 
-void pmatchwarning(const char *msg)
+int
+pmatcherror(hfst::pmatch::PmatchCompilation & compilation, const char *msg)
+{
+    return pmatcherror(compilation.scanner, compilation, msg);
+}
+
+void pmatchwarning(hfst::pmatch::PmatchCompilation & compilation,
+                   const char *msg)
 {
-    if (hfst::pmatch::verbose) {
+    if (compilation.verbose) {
         std::string warnmsg = "pmatch: ";
         warnmsg.append(msg);
         warnmsg.append(" on line ");
         std::ostringstream ss;
-        ss << pmatchlineno;
+        ss << current_lineno(compilation);
         warnmsg.append(ss.str());
         warnmsg.append("\n");
         std::cerr << warnmsg;
@@ -81,31 +112,55 @@ namespace hfst
 namespace pmatch
 {
 
-char* data;
-std::map<std::string, hfst::pmatch::PmatchObject*> definitions;
-std::map<std::string, std::string> variables;
-std::vector<std::map<std::string, PmatchObject*> > call_stack;
-std::map<std::string, PmatchObject*> def_insed_expressions;
-std::set<std::string> inserted_names;
-std::set<std::string> unsatisfied_insertions;
-std::set<std::string> used_definitions;
-std::set<std::string> function_names;
-std::set<std::string> capture_names;
-std::vector<WordVector> word_vectors;
-char* startptr;
-hfst::ImplementationType format;
-size_t len;
-bool verbose;
-bool flatten;
-bool include_cosine_distances;
-std::string includedir;
-clock_t timer;
-int minimization_guard_count;
-bool need_delimiters;
-WordVecFloat vector_similarity_projection_factor;
-
-std::map<std::string, hfst::HfstTransducer> named_transducers;
-PmatchUtilityTransducers* utils=NULL;
+PmatchCompilation::PmatchCompilation(ImplementationType type,
+                                     bool be_verbose, bool do_flatten,
+                                     bool do_include_cosine_distances,
+                                     std::string includedir_,
+                                     std::string cache_directory):
+    data(NULL),
+    scanner(NULL),
+    startptr(NULL),
+    len(0),
+    format(type),
+    verbose(be_verbose),
+    flatten(do_flatten),
+    include_cosine_distances(do_include_cosine_distances),
+    includedir(includedir_),
+    timer(0),
+    minimization_guard_count(0),
+    need_delimiters(false),
+    vector_similarity_projection_factor(1.0),
+    compilation_cache(NULL),
+    thread_count(std::thread::hardware_concurrency()),
+    input_offset(0),
+    definition_start(0),
+    definition_end(0),
+    definition_is_cacheable(true),
+    utils(NULL)
+{
+    variables["count-patterns"] = "off";
+    variables["delete-patterns"] = "off";
+    variables["extract-patterns"] = "off";
+    variables["locate-patterns"] = "off";
+    variables["mark-patterns"] = "on";
+    variables["max-context-length"] = "254";
+    variables["max-recursion"] =  "5000";
+    variables["need-separators"] = "on";
+    variables["xerox-composition"] = "on";
+    variables["vector-similarity-projection-factor"] = "1.0";
+    variables["vector-index"] = "off";
+    if (cache_directory != "") {
+        compilation_cache = new CompilationCache(cache_directory);
+    }
+}
+
+// The parsed objects are not deleted, as they may share parts with
+// each other
+PmatchCompilation::~PmatchCompilation()
+{
+    delete compilation_cache;
+    delete utils;
+}
 
 void warn(std::string warning)
 {
@@ -113,58 +168,61 @@ void warn(std::string warning)
 }
 
 PmatchUtilityTransducers*
-get_utils()
+get_utils(PmatchCompilation & compilation)
 {
-  if (utils == NULL)
+  if (compilation.utils == NULL)
     {
-      utils = new PmatchUtilityTransducers();
+      compilation.utils = new PmatchUtilityTransducers(compilation.format);
     }
-  return utils;
+  return compilation.utils;
 }
 
-void zero_minimization_guard(void)
+void zero_minimization_guard(PmatchCompilation & compilation)
 {
-    minimization_guard_count = 0;
+    compilation.minimization_guard_count = 0;
 }
 
-PmatchTransducerContainer * make_minimization_guard(void)
+PmatchTransducerContainer * make_minimization_guard(PmatchCompilation & compilation)
 {
     std::stringstream guard;
-    if(minimization_guard_count == 0) {
+    if(compilation.minimization_guard_count == 0) {
         guard << hfst::internal_epsilon;
     } else {
-        guard << "@PMATCH_GUARD_" << minimization_guard_count << "@";
+        guard << "@PMATCH_GUARD_" << compilation.minimization_guard_count << "@";
     }
-    ++minimization_guard_count;
-    return epsilon_to_symbol_container(guard.str());
+    ++compilation.minimization_guard_count;
+    return epsilon_to_symbol_container(compilation, guard.str());
 }
 
-bool symbol_in_global_context(std::string & sym)
+bool symbol_in_global_context(PmatchCompilation & compilation,
+                              std::string & sym)
 {
-    return definitions.count(sym) != 0;
+    return compilation.definitions.count(sym) != 0;
 }
 
-bool symbol_in_local_context(std::string & sym)
+bool symbol_in_local_context(PmatchCompilation & compilation, std::string & sym)
 {
-    if (call_stack.size() == 0) {
+    if (compilation.call_stack.size() == 0) {
         return false;
     }
-    return call_stack.back().count(sym) != 0;
+    return compilation.call_stack.back().count(sym) != 0;
 }
 
-PmatchObject * symbol_from_global_context(std::string & sym)
+PmatchObject * symbol_from_global_context(PmatchCompilation & compilation,
+                                          std::string & sym)
 {
-    if (symbol_in_global_context(sym)) {
-        return definitions[sym];
+    if (symbol_in_global_context(compilation, sym)) {
+        return compilation.definitions[sym];
     } else {
         return (PmatchObject *) NULL;
     }
 }
 
-PmatchObject * symbol_from_local_context(std::string & sym)
+PmatchObject * symbol_from_local_context(PmatchCompilation & compilation,
+                                         std::string & sym)
 {
-    if (symbol_in_local_context(sym)) {
-        return call_stack.back()[sym];
+    if (symbol_in_local_context(compilation, sym)) {
+        return compilation.call_stack.back()[sym];
     } else {
         return (PmatchObject *) NULL;
     }
@@ -209,15 +267,15 @@ get_n_to_k(const char* s)
 
 
 int
-getinput(char *buf, int maxlen)
+getinput(PmatchCompilation & compilation, char *buf, int maxlen)
 {
     int retval = 0;
-    if ( maxlen > (int)len ) {
-        maxlen = hfst::size_t_to_int(len);
+    if ( maxlen > (int)compilation.len ) {
+        maxlen = hfst::size_t_to_int(compilation.len);
     }
-    memcpy(buf, data, maxlen);
-    data += maxlen;
-    len -= maxlen;
+    memcpy(buf, compilation.data, maxlen);
+    compilation.data += maxlen;
+    compilation.len -= maxlen;
     retval = maxlen;
     return retval;
 }
@@ -324,76 +382,128 @@ HfstTransducer * add_pmatch_delimiters(HfstTransducer * regex)
     return delimited_regex;
 }
 
-PmatchTransducerContainer * make_end_tag(std::string tag)
-{ return epsilon_to_symbol_container("@PMATCH_ENDTAG_" + tag + "@"); }
+PmatchTransducerContainer * make_end_tag(PmatchCompilation & compilation,
+                                         std::string tag)
+{ return epsilon_to_symbol_container(compilation, "@PMATCH_ENDTAG_" + tag + "@"); }
 
-PmatchTransducerContainer * make_capture_tag(std::string tag)
-{ return epsilon_to_symbol_container("@PMATCH_CAPTURE_" + tag + "@"); }
+PmatchTransducerContainer * make_capture_tag(PmatchCompilation & compilation,
+                                             std::string tag)
+{ return epsilon_to_symbol_container(compilation, "@PMATCH_CAPTURE_" + tag + "@"); }
 
-PmatchTransducerContainer * make_captured_tag(std::string tag)
-{ return epsilon_to_symbol_container("@PMATCH_CAPTURED_" + tag + "@"); }
+PmatchTransducerContainer * make_captured_tag(PmatchCompilation & compilation,
+                                              std::string tag)
+{ return epsilon_to_symbol_container(compilation, "@PMATCH_CAPTURED_" + tag + "@"); }
 
-PmatchObject * make_with_tag_entry(std::string key, std::string value)
+PmatchObject * make_with_tag_entry(PmatchCompilation & compilation,
+                                   std::string key, std::string value)
 {
-    return new PmatchString("@P.PMATCH_GLOBAL_" + key + "." + value + "@");
+    return new PmatchString(compilation, "@P.PMATCH_GLOBAL_" + key + "." + value + "@");
 }
 
-PmatchObject * make_with_tag_exit(std::string key)
+PmatchObject * make_with_tag_exit(PmatchCompilation & compilation,
+                                  std::string key)
 {
-    return new PmatchString("@C.PMATCH_GLOBAL_" + key + "@");
+    return new PmatchString(compilation, "@C.PMATCH_GLOBAL_" + key + "@");
 }
 
-// Get the n best candidates in the original space using an insertion sort
-std::vector<std::pair<WordVector, WordVecFloat> > get_top_n(size_t n,
-                                                            std::vector<WordVector> & vecs,
-                                                            WordVector & comparison_point)
+// Trees in the approximate index of word vectors, the most vectors in a leaf
+// and how many candidates to look at for each word asked for
+static const size_t VECTOR_INDEX_TREES = 16;
+static const size_t VECTOR_INDEX_LEAF_SIZE = 32;
+static const size_t VECTOR_INDEX_SEARCH_FACTOR = 1024;
+
+// The n rows with the smallest distances, ties going to the earlier row
+class NearestRows
 {
-    std::vector<std::pair<WordVector, WordVecFloat> > retval;
-    for (std::vector<WordVector>::const_iterator it = vecs.begin();
-         it != vecs.end(); ++it) {
-        WordVecFloat cosdist = cosine_distance(*it, comparison_point);
-        for (size_t i = 0; i <= retval.size(); ++i) {
-            if (i == retval.size()) {
-                // We made it to the top
-                retval.push_back(std::pair<WordVector, WordVecFloat>(
-                                     WordVector(*it), cosdist));
-                break;
-            } else {
-                // Walking the list
-                if (cosdist >= retval[i].second) {
-                    if (i == 0 && retval.size() == n) {
-                        break;
-                    }
-                    retval.insert(retval.begin() + i, std::pair<WordVector, WordVecFloat>(
-                                      WordVector(*it), cosdist));
-                    break;
-                } else {
-                    continue;
-                }
-            }
+    size_t n;
+    std::vector<std::pair<WordVecFloat, size_t> > heap;
+public:
+    NearestRows(size_t n_): n(n_) {}
+    void add(WordVecFloat distance, size_t row)
+    {
+        std::pair<WordVecFloat, size_t> candidate(distance, row);
+        if (heap.size() < n) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (n > 0 && candidate < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+    // The words from the most distant to the nearest
+    std::vector<std::pair<std::string, WordVecFloat> > get(
+        const WordVectorMatrix & vecs)
+    {
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<std::pair<std::string, WordVecFloat> > retval;
+        for (size_t i = heap.size(); i > 0; --i) {
+            retval.push_back(std::pair<std::string, WordVecFloat>(
+                                 vecs.words[heap[i - 1].second],
+                                 heap[i - 1].first));
+        }
+        return retval;
+    }
+};
+
+// Get the n best candidates in the original space, only looking at the
+// candidates from the approximate index if there is one and approximate
+// is set
+std::vector<std::pair<std::string, WordVecFloat> > get_top_n(
+    size_t n,
+    const WordVectorMatrix & vecs,
+    const WordVector & comparison_point,
+    bool approximate)
+{
+    std::vector<WordVecFloat> query(comparison_point.vector);
+    if (comparison_point.norm > 0) {
+        for (size_t i = 0; i < query.size(); ++i) {
+            query[i] /= comparison_point.norm;
+        }
+    }
+    NearestRows nearest(n);
+    // Sometimes very nearby vectors combined with rounding error will produce
+    // a slightly negative distance, so make sure to use at least 0.0
+    if (approximate && !vecs.index.empty()) {
+        std::vector<unsigned int> candidates = vecs.index.candidates(
+            vecs, &query[0], n * VECTOR_INDEX_SEARCH_FACTOR);
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            WordVecFloat cosdist = 1.0 - dot_product(
+                vecs.row(candidates[i]), &query[0], vecs.dimension);
+            nearest.add(std::max(static_cast<WordVecFloat>(0.0), cosdist),
+                        candidates[i]);
         }
-        if (retval.size() > n) {
-            retval.erase(retval.begin());
+    } else {
+        for (size_t i = 0; i < vecs.size(); ++i) {
+            WordVecFloat cosdist = 1.0 - dot_product(
+                vecs.row(i), &query[0], vecs.dimension);
+            nearest.add(std::max(static_cast<WordVecFloat>(0.0), cosdist), i);
         }
     }
-    return retval;
+    return nearest.get(vecs);
 }
 
-// Get the n best candidates in the transformed space using an insertion sort
-std::vector<std::pair<WordVector, WordVecFloat> > get_top_n_transformed(
+// Get the n best candidates in the transformed space
+std::vector<std::pair<std::string, WordVecFloat> > get_top_n_transformed(
     size_t n,
-    const std::vector<WordVector> & vecs,
+    const WordVectorMatrix & vecs,
     std::vector<WordVecFloat> plane_vec,
     std::vector<WordVecFloat> comparison_point,
     WordVecFloat translation_term,
-    bool negative)
+    bool negative,
+    WordVecFloat projection_factor)
 {
-    std::vector<std::pair<WordVector, WordVecFloat> > retval;
+    NearestRows nearest(n);
     WordVecFloat plane_vec_square_sum = square_sum(plane_vec);
     WordVecFloat comparison_point_norm = norm(comparison_point);
-    for (std::vector<WordVector>::const_iterator it = vecs.begin();
-         it != vecs.end(); ++it) {
-        WordVector transformed_vec(*it);
+    WordVecFloat plane_dot_comparison = dot_product(plane_vec, comparison_point);
+    for (size_t i = 0; i < vecs.size(); ++i) {
+        WordVecFloat vec_norm = vecs.norms[i];
+        WordVecFloat vec_dot_plane =
+            vec_norm * dot_product(vecs.row(i), &plane_vec[0], vecs.dimension);
+        WordVecFloat vec_dot_comparison =
+            vec_norm * dot_product(vecs.row(i), &comparison_point[0],
+                                   vecs.dimension);
 
         /*
          * First, given a plane "plane_vec = translation term" and a point,
@@ -402,46 +512,30 @@ std::vector<std::pair<WordVector, WordVecFloat> > get_top_n_transformed(
          */
 
         WordVecFloat transformed_vec_scaler =
-            (translation_term - dot_product(transformed_vec.vector, plane_vec))
-            / plane_vec_square_sum;
-        transformed_vec_scaler *= vector_similarity_projection_factor;
+            (translation_term - vec_dot_plane) / plane_vec_square_sum;
+        transformed_vec_scaler *= projection_factor;
         if(negative) {
-            transformed_vec.vector =
-                pointwise_minus(transformed_vec.vector,
-                                pointwise_multiplication(transformed_vec_scaler, plane_vec));
-        } else {
-            transformed_vec.vector =
-                pointwise_plus(transformed_vec.vector,
-                               pointwise_multiplication(transformed_vec_scaler, plane_vec));
-        }
-        transformed_vec.norm = norm(transformed_vec.vector);
-        WordVecFloat cosdist = 1 - dot_product(transformed_vec.vector, comparison_point)
-            / (transformed_vec.norm * comparison_point_norm);
-        for (size_t i = 0; i <= retval.size(); ++i) {
-            if (i == retval.size()) {
-                // We made it to the top
-                retval.push_back(std::pair<WordVector, WordVecFloat>(transformed_vec,
-                                                                     cosdist));
-                break;
-            } else {
-                // Walking the list
-                if (cosdist >= retval[i].second) {
-                    if (i == 0 && retval.size() == n) {
-                        break;
-                    }
-                    retval.insert(retval.begin() + i,
-                                  std::pair<WordVector, WordVecFloat>(transformed_vec, cosdist));
-                    break;
-                } else {
-                    continue;
-                }
-            }
-        }
-        if (retval.size() > n) {
-            retval.erase(retval.begin());
+            transformed_vec_scaler = -transformed_vec_scaler;
         }
+
+        /*
+         * The transformed vector is vec + scaler * plane_vec, so its dot
+         * product with the comparison point and its norm follow from
+         * those of vec without building it.
+         */
+
+        WordVecFloat transformed_dot_comparison = vec_dot_comparison
+            + transformed_vec_scaler * plane_dot_comparison;
+        WordVecFloat transformed_norm = sqrt(
+            vec_norm * vec_norm
+            + 2 * transformed_vec_scaler * vec_dot_plane
+            + transformed_vec_scaler * transformed_vec_scaler
+            * plane_vec_square_sum);
+        WordVecFloat cosdist = 1 - transformed_dot_comparison
+            / (transformed_norm * comparison_point_norm);
+        nearest.add(cosdist, i);
     }
-    return retval;
+    return nearest.get(vecs);
 }
 
 template<typename T> std::vector<T> pointwise_minus(std::vector<T> l,
@@ -484,6 +578,24 @@ template<typename T> T dot_product(std::vector<T> l,
     return ret;
 }
 
+WordVecFloat dot_product(const WordVecFloat * l, const WordVecFloat * r,
+                         size_t size)
+{
+    // Separate sums let the compiler use vector instructions
+    WordVecFloat ret0 = 0, ret1 = 0, ret2 = 0, ret3 = 0;
+    size_t i = 0;
+    for(; i + 4 <= size; i += 4) {
+        ret0 += l[i] * r[i];
+        ret1 += l[i + 1] * r[i + 1];
+        ret2 += l[i + 2] * r[i + 2];
+        ret3 += l[i + 3] * r[i + 3];
+    }
+    for(; i < size; ++i) {
+        ret0 += l[i] * r[i];
+    }
+    return (ret0 + ret1) + (ret2 + ret3);
+}
+
 template<typename T> T square_sum(std::vector<T> v)
 {
     T ret = 0;
@@ -513,98 +625,104 @@ WordVecFloat cosine_distance(std::vector<WordVecFloat> left, std::vector<WordVec
     return std::max(static_cast<WordVecFloat>(0.0), retval);
 }
 
+// Whether Like() should use the approximate index, building it if needed
+static bool use_vector_index(PmatchCompilation & compilation)
+{
+    if (compilation.variables["vector-index"] != "on") {
+        return false;
+    }
+    compilation.word_vectors.prepare_index(compilation.verbose);
+    return true;
+}
+
 // Single-word Like()
-PmatchObject * compile_like_arc(std::string word,
+PmatchObject * compile_like_arc(PmatchCompilation & compilation,
+                                std::string word,
                                 unsigned int nwords)
 {
-    WordVector this_word;
-    for (std::vector<WordVector>::iterator it = word_vectors.begin();
-         it != word_vectors.end(); ++it) {
-        if (word == it->word) {
-            this_word = *it;
-            break;
-        }
-    }
-    if (this_word.word.empty()) {
+    size_t this_row = compilation.word_vectors.find(word);
+    if (this_row == compilation.word_vectors.size()) {
         // got no matches
-        PmatchString * word_o = new PmatchString(word);
+        PmatchString * word_o = new PmatchString(compilation, word);
         word_o->multichar = true;
-        pmatchwarning("no matches for argument to Like() operation");
+        pmatchwarning(compilation, "no matches for argument to Like() operation");
         return word_o;
     }
 
-    std::vector<std::pair<WordVector, WordVecFloat> > top_n = get_top_n(nwords, word_vectors, this_word);
+    WordVector this_word = compilation.word_vectors.get(this_row);
+    bool approximate = use_vector_index(compilation);
+    std::vector<std::pair<std::string, WordVecFloat> > top_n = get_top_n(nwords, compilation.word_vectors, this_word, approximate);
 
     HfstTokenizer tok;
-    HfstTransducer * retval = new HfstTransducer(format);
-    if (verbose) {
+    HfstTransducer * retval = new HfstTransducer(compilation.format);
+    if (compilation.verbose) {
         std::cerr << "Inserting into Like(" << word << "):" << std::endl;
     }
     for (size_t i = 0; i < top_n.size(); ++i) {
-        if (verbose) {
-            std::cerr << "  " << top_n[i].first.word << std::endl;
+        if (compilation.verbose) {
+            std::cerr << "  " << top_n[i].first << std::endl;
         }
-        HfstTransducer tmp(top_n[i].first.word, tok, format);
-        if (include_cosine_distances) {
+        HfstTransducer tmp(top_n[i].first, tok, compilation.format);
+        if (compilation.include_cosine_distances) {
             tmp.set_final_weights(top_n[i].second);
         }
         retval->disjunct(tmp);
     }
-    return new PmatchTransducerContainer(retval);
+    return new PmatchTransducerContainer(compilation, retval);
 }
 
 // the general case
-PmatchObject * compile_like_arc(std::string word1, std::string word2,
+PmatchObject * compile_like_arc(PmatchCompilation & compilation,
+                                std::string word1, std::string word2,
                                 unsigned int nwords, bool is_negative)
 {
     WordVector this_word1;
     WordVector this_word2;
-    for (std::vector<WordVector>::iterator it = word_vectors.begin();
-         (it != word_vectors.end() &&
-          (this_word1.word.empty() || this_word2.word.empty())); ++it) {
-        if (word1 == it->word) {
-            this_word1 = *it;
-        }
-        if (word2 == it->word) {
-            this_word2 = *it;
-        }
+    size_t row1 = compilation.word_vectors.find(word1);
+    size_t row2 = compilation.word_vectors.find(word2);
+    if (row1 != compilation.word_vectors.size()) {
+        this_word1 = compilation.word_vectors.get(row1);
+    }
+    if (row2 != compilation.word_vectors.size()) {
+        this_word2 = compilation.word_vectors.get(row2);
     }
     if (this_word1.word.empty() && this_word2.word.empty()) {
         // got no matches
-        PmatchString * word1_o = new PmatchString(word1);
-        PmatchString * word2_o = new PmatchString(word2);
+        PmatchString * word1_o = new PmatchString(compilation, word1);
+        PmatchString * word2_o = new PmatchString(compilation, word2);
         word1_o->multichar = true; word2_o->multichar = true;
-        pmatchwarning("no matches for arguments to Like() operation");
-        return new PmatchBinaryOperation(Disjunct, word1_o, word2_o);
+        pmatchwarning(compilation, "no matches for arguments to Like() operation");
+        return new PmatchBinaryOperation(compilation, Disjunct, word1_o, word2_o);
     }
 
     if (this_word1.word.empty() || this_word2.word.empty()) {
         // just one match
-        pmatchwarning("only one match for arguments to Like() operation, using nearest neighbours");
+        pmatchwarning(compilation, "only one match for arguments to Like() operation, using nearest neighbours");
         WordVector this_word = (this_word1.word.empty() ? this_word2 : this_word1);
-        std::vector<std::pair<WordVector, WordVecFloat> > top_n = get_top_n(nwords, word_vectors, this_word);
+        bool approximate = use_vector_index(compilation);
+        std::vector<std::pair<std::string, WordVecFloat> > top_n = get_top_n(nwords, compilation.word_vectors, this_word, approximate);
         HfstTokenizer tok;
-        HfstTransducer * retval = new HfstTransducer(format);
-        if (verbose) {
+        HfstTransducer * retval = new HfstTransducer(compilation.format);
+        if (compilation.verbose) {
             std::cerr << "Inserting into Like(" << this_word.word << "):" << std::endl;
         }
 
         for (size_t i = 0; i < top_n.size(); ++i) {
-            if (verbose) {
-                std::cerr << "  " << top_n[i].first.word << std::endl;
+            if (compilation.verbose) {
+                std::cerr << "  " << top_n[i].first << std::endl;
             }
-            HfstTransducer tmp(top_n[i].first.word, tok, format);
-            if (include_cosine_distances) {
+            HfstTransducer tmp(top_n[i].first, tok, compilation.format);
+            if (compilation.include_cosine_distances) {
                 tmp.set_final_weights(top_n[i].second);
             }
             retval->disjunct(tmp);
         }
-        return new PmatchTransducerContainer(retval);
+        return new PmatchTransducerContainer(compilation, retval);
     }
 
-    if(variables["vector-similarity-projection-factor"] != "1.0") {
-        vector_similarity_projection_factor =
-            strtod(variables["vector-similarity-projection-factor"].c_str(), NULL);
+    if(compilation.variables["vector-similarity-projection-factor"] != "1.0") {
+        compilation.vector_similarity_projection_factor =
+            strtod(compilation.variables["vector-similarity-projection-factor"].c_str(), NULL);
     }
     /*
      * When there are two vectors A and B, we compute the vector A - B that
@@ -629,35 +747,36 @@ PmatchObject * compile_like_arc(std::string word1, std::string word2,
 
     std::vector<WordVecFloat> comparison_point;
     if (is_negative == true) {
-        if (verbose) {
+        if (compilation.verbose) {
             std::cerr << "Inserting into Unlike(" << this_word1.word << ", " << this_word2.word << "):" << std::endl;
         }
         WordVecFloat comparison_scaler =
             (hyperplane_translation_term - dot_product(this_word1.vector, B_minus_A)) / square_sum(B_minus_A);
-        comparison_scaler *= vector_similarity_projection_factor;
+        comparison_scaler *= compilation.vector_similarity_projection_factor;
         comparison_point = pointwise_minus(this_word1.vector, pointwise_multiplication(comparison_scaler, B_minus_A));
     } else {
-        if (verbose) {
+        if (compilation.verbose) {
             std::cerr << "Inserting into Like(" << this_word1.word << ", " << this_word2.word << "):" << std::endl;
         }
         comparison_point = pointwise_plus(this_word2.vector, pointwise_multiplication(
                                               static_cast<WordVecFloat>(0.5), B_minus_A));
     }
 
-    std::vector<std::pair<WordVector, WordVecFloat> > top_n = get_top_n_transformed(nwords,
-                                                                                    word_vectors,
+    std::vector<std::pair<std::string, WordVecFloat> > top_n = get_top_n_transformed(nwords,
+                                                                                    compilation.word_vectors,
                                                                                     B_minus_A,
                                                                                     comparison_point,
                                                                                     hyperplane_translation_term,
-                                                                                    is_negative);
+                                                                                    is_negative,
+                                                                                    compilation.vector_similarity_projection_factor);
     HfstTokenizer tok;
-    HfstTransducer * retval = new HfstTransducer(format);
+    HfstTransducer * retval = new HfstTransducer(compilation.format);
     for (size_t i = 0; i < top_n.size() && i <= nwords; ++i) {
-        if (verbose) {
-            std::cerr << "  " << top_n[i].first.word << std::endl;
+        if (compilation.verbose) {
+            std::cerr << "  " << top_n[i].first << std::endl;
         }
-        HfstTransducer tmp(top_n[i].first.word, tok, format);
-        if (include_cosine_distances) {
+        HfstTransducer tmp(top_n[i].first, tok, compilation.format);
+        if (compilation.include_cosine_distances) {
             tmp.set_final_weights(top_n[i].second);
         }
         retval->disjunct(tmp);
@@ -670,11 +789,12 @@ PmatchObject * compile_like_arc(std::string word1, std::string word2,
         //     }
         // }
     }
-    return new PmatchTransducerContainer(retval);
+    return new PmatchTransducerContainer(compilation, retval);
 }
 
-PmatchTransducerContainer * make_counter(std::string name)
-{ return epsilon_to_symbol_container("@PMATCH_COUNTER_" + name + "@"); }
+PmatchTransducerContainer * make_counter(PmatchCompilation & compilation,
+                                         std::string name)
+{ return epsilon_to_symbol_container(compilation, "@PMATCH_COUNTER_" + name + "@"); }
 
 hfst::StringSet get_non_special_alphabet(HfstTransducer * t)
 {
@@ -715,40 +835,41 @@ HfstTransducer * make_exc_list(HfstTransducer * t, ImplementationType f)
     return new HfstTransducer(arc, f);
 }
 
-HfstTransducer * make_sigma(HfstTransducer * t)
+HfstTransducer * make_sigma(HfstTransducer * t, ImplementationType f)
 {
     HfstTransducer * retval =
-        new HfstTransducer(format);
+        new HfstTransducer(f);
     hfst::StringSet alphabet = get_non_special_alphabet(t);
     for (hfst::StringSet::const_iterator it = alphabet.begin();
          it != alphabet.end(); ++it) {
-            retval->disjunct(HfstTransducer(*it, format));
+            retval->disjunct(HfstTransducer(*it, f));
     }
     return retval;
 }
 
-PmatchTransducerContainer * epsilon_to_symbol_container(std::string s)
+PmatchTransducerContainer * epsilon_to_symbol_container(PmatchCompilation & compilation,
+                                                        std::string s)
 {
-    HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, s, format);
-    return new PmatchTransducerContainer(tmp);
+    HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, s, compilation.format);
+    return new PmatchTransducerContainer(compilation, tmp);
 }
 
-PmatchTransducerContainer * make_rc_entry(void)
-{ return epsilon_to_symbol_container(RC_ENTRY_SYMBOL); }
-PmatchTransducerContainer * make_lc_entry(void)
-{ return epsilon_to_symbol_container(LC_ENTRY_SYMBOL); }
-PmatchTransducerContainer * make_nrc_entry(void)
-{ return epsilon_to_symbol_container(NRC_ENTRY_SYMBOL); }
-PmatchTransducerContainer * make_nlc_entry(void)
-{ return epsilon_to_symbol_container(NLC_ENTRY_SYMBOL); }
-PmatchTransducerContainer * make_rc_exit(void)
-{ return epsilon_to_symbol_container(RC_EXIT_SYMBOL); }
-PmatchTransducerContainer * make_lc_exit(void)
-{ return epsilon_to_symbol_container(LC_EXIT_SYMBOL); }
-PmatchTransducerContainer * make_nrc_exit(void)
-{ return epsilon_to_symbol_container(NRC_EXIT_SYMBOL); }
-PmatchTransducerContainer * make_nlc_exit(void)
-{ return epsilon_to_symbol_container(NLC_EXIT_SYMBOL); }
+PmatchTransducerContainer * make_rc_entry(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, RC_ENTRY_SYMBOL); }
+PmatchTransducerContainer * make_lc_entry(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, LC_ENTRY_SYMBOL); }
+PmatchTransducerContainer * make_nrc_entry(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, NRC_ENTRY_SYMBOL); }
+PmatchTransducerContainer * make_nlc_entry(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, NLC_ENTRY_SYMBOL); }
+PmatchTransducerContainer * make_rc_exit(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, RC_EXIT_SYMBOL); }
+PmatchTransducerContainer * make_lc_exit(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, LC_EXIT_SYMBOL); }
+PmatchTransducerContainer * make_nrc_exit(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, NRC_EXIT_SYMBOL); }
+PmatchTransducerContainer * make_nlc_exit(PmatchCompilation & compilation)
+{ return epsilon_to_symbol_container(compilation, NLC_EXIT_SYMBOL); }
 
 char * get_delimited(const char *s, char delim_left, char delim_right)
 {
@@ -1000,12 +1121,13 @@ std::string codepoint_to_utf8(unsigned int codepoint)
     }
 }
 
-PmatchTransducerContainer * parse_range(const char * s)
+PmatchTransducerContainer * parse_range(PmatchCompilation & compilation,
+                                        const char * s)
 {
     char * quoted = get_delimited(s, '"');
     char * orig_quoted = quoted;
     char ** c = & quoted;
-    HfstTransducer * retval = new HfstTransducer(format);
+    HfstTransducer * retval = new HfstTransducer(compilation.format);
     while (**c != '\0') {
         unsigned int codepoint1 = 0;
         unsigned int codepoint2 = 0;
@@ -1029,7 +1151,7 @@ PmatchTransducerContainer * parse_range(const char * s)
         if (**c != '-') {
             std::string errstring("Could not parse range expression: ");
             errstring.append(std::string(s));
-            pmatcherror(errstring.c_str());
+            pmatcherror(compilation, errstring.c_str());
         }
         *c += 1;
         if (strlen(*c) >= 6 && **c == '\\' &&
@@ -1051,20 +1173,20 @@ PmatchTransducerContainer * parse_range(const char * s)
         if (codepoint1 == 0 || codepoint2 == 0) {
             std::string errstring("Malformed character in range expression: ");
             errstring.append(std::string(s));
-            pmatcherror(errstring.c_str());
+            pmatcherror(compilation, errstring.c_str());
         }
         if (codepoint2 < codepoint1) {
             std::string errstring("Range expression goes from higher to lower: ");
             errstring.append(std::string(s));
-            pmatcherror(errstring.c_str());
+            pmatcherror(compilation, errstring.c_str());
         }
         while (codepoint1 <= codepoint2) {
-            retval->disjunct(HfstTransducer(codepoint_to_utf8(codepoint1), format));
+            retval->disjunct(HfstTransducer(codepoint_to_utf8(codepoint1), compilation.format));
             ++codepoint1;
         }
     }
     free(orig_quoted);
-    return new PmatchTransducerContainer(retval);
+    return new PmatchTransducerContainer(compilation, retval);
 }
 
 double
@@ -1084,33 +1206,122 @@ get_weight(const char *s)
     return rv;
 }
 
-void init_globals(void)
+void record_definition_source(PmatchCompilation & compilation,
+                              const std::string & name,
+                              const std::string & text)
 {
-    definitions.clear();
-    variables.clear();
-    variables["count-patterns"] = "off";
-    variables["delete-patterns"] = "off";
-    variables["extract-patterns"] = "off";
-    variables["locate-patterns"] = "off";
-    variables["mark-patterns"] = "on";
-    variables["max-context-length"] = "254";
-    variables["max-recursion"] =  "5000";
-    variables["need-separators"] = "on";
-    variables["xerox-composition"] = "on";
-    variables["vector-similarity-projection-factor"] = "1.0";
-    call_stack.clear();
-    def_insed_expressions.clear();
-    inserted_names.clear();
-    unsatisfied_insertions.clear();
-    used_definitions.clear();
-    function_names.clear();
-    capture_names.clear();
-    zero_minimization_guard();
-    need_delimiters = false;
-    pmatchnerrs = 0;
+    // A name that is defined again may already have been bound to the
+    // earlier definition, so neither is cacheable
+    bool redefined = compilation.definition_sources.count(name) != 0;
+    DefinitionSource & source = compilation.definition_sources[name];
+    source = DefinitionSource();
+    if (text != "") {
+        source.cacheable = !redefined;
+        source.text = text;
+        return;
+    }
+    // If the parser has read ahead into the next definition, the span is
+    // no longer known. len is what getinput has not read yet.
+    size_t input_size = (compilation.data - compilation.startptr) + compilation.len;
+    if (!redefined && compilation.definition_is_cacheable &&
+        compilation.definition_start < compilation.definition_end &&
+        compilation.definition_end <= input_size) {
+        source.cacheable = true;
+        source.text = std::string(compilation.startptr + compilation.definition_start,
+                                  compilation.definition_end - compilation.definition_start);
+        source.uses = compilation.definition_uses;
+    }
+    compilation.definition_is_cacheable = true;
+    compilation.definition_uses.clear();
+}
+
+/* Store to \a key everything the evaluation of the definition of \a name
+   depends on and return true, or return false if it is not cacheable.
+   The keys of the definitions it uses are included as hashes. */
+static bool definition_cache_key(PmatchCompilation & compilation,
+                                 const std::string & name, std::string & key)
+{
+    std::map<std::string, std::string>::iterator known =
+        compilation.definition_keys.find(name);
+    if (known != compilation.definition_keys.end() && known->second == "") {
+        // uncacheable or being computed, i.e. in a cycle
+        return false;
+    }
+    std::map<std::string, DefinitionSource>::iterator source =
+        compilation.definition_sources.find(name);
+    // With --flatten, an inserted definition may become part of a context
+    // condition, which changes how it is evaluated everywhere
+    if (source == compilation.definition_sources.end() || !source->second.cacheable ||
+        (compilation.definitions.count(name) != 0 &&
+         compilation.definitions[name]->parent_is_context)) {
+        compilation.definition_keys[name] = "";
+        return false;
+    }
+    if (compilation.cache_settings == "") {
+        std::stringstream settings;
+        settings << "pmatch definition 1\n"
+                 << "format " << compilation.format << "\n"
+                 << "flatten " << compilation.flatten << "\n"
+                 << "cosine-distances " << compilation.include_cosine_distances << "\n";
+        for (std::map<std::string, std::string>::iterator it =
+                 compilation.variables.begin(); it != compilation.variables.end(); ++it) {
+            settings << "set " << it->first << " " << it->second << "\n";
+        }
+        compilation.cache_settings = settings.str();
+    }
+    compilation.definition_keys[name] = "";
+    std::stringstream ss;
+    ss << compilation.cache_settings << "define " << name << "\n"
+       << source->second.text << "\n";
+    for (std::set<std::string>::iterator it = source->second.uses.begin();
+         it != source->second.uses.end(); ++it) {
+        if (compilation.definitions.count(*it) == 0) {
+            ss << "use " << *it << " undefined\n";
+            continue;
+        }
+        std::map<std::string, std::string>::iterator dependency =
+            compilation.definition_keys.find(*it);
+        if (dependency == compilation.definition_keys.end()) {
+            std::string dependency_key;
+            definition_cache_key(compilation, *it, dependency_key);
+            dependency = compilation.definition_keys.find(*it);
+        }
+        if (dependency->second == "") {
+            return false;
+        }
+        ss << "use " << *it << " " << dependency->second << "\n";
+    }
+    key = ss.str();
+    compilation.definition_keys[name] = CompilationCache::hash(key);
+    return true;
 }
 
-string expand_includes(const string & script)
+HfstTransducer * evaluate_definition(PmatchCompilation & compilation,
+                                     const std::string & name,
+                                     PmatchObject * def, bool insed)
+{
+    std::string key;
+    // Only results that would be kept in def->cache are stored, i.e.
+    // not functions or anything evaluated inside function calls
+    if (compilation.compilation_cache == NULL || compilation.call_stack.size() != 0 ||
+        def->cache != NULL || compilation.function_names.count(name) != 0 ||
+        !definition_cache_key(compilation, name, key)) {
+        return def->evaluate();
+    }
+    if (insed) {
+        key.append("DefIns\n");
+    }
+    HfstTransducer * retval = compilation.compilation_cache->get(key);
+    if (retval == NULL) {
+        retval = def->evaluate();
+        compilation.compilation_cache->put(key, *retval);
+    } else if (def->should_use_cache()) {
+        def->cache = new HfstTransducer(*retval);
+    }
+    return retval;
+}
+
+string expand_includes(PmatchCompilation & compilation, const string & script)
 {
     if (script.find("@include\"") == string::npos) {
         return string(script);
@@ -1146,14 +1357,14 @@ string expand_includes(const string & script)
             if (terminating_quote_pos != string::npos) {
                 size_t filename_start_pos = it - script.begin() + 9;
                 size_t filename_len = terminating_quote_pos - filename_start_pos;
-                string filepath = path_from_filename(script.substr(filename_start_pos,
+                string filepath = path_from_filename(compilation, script.substr(filename_start_pos,
                                                                    filename_len).c_str());
                 std::ifstream infile;
                 infile.open(filepath.c_str());
                 if(!infile.good()) {
                     std::stringstream errstring;
                     errstring << "could not open file " << filepath << " for @include\n";
-                    pmatcherror(errstring.str().c_str());
+                    pmatcherror(compilation, errstring.str().c_str());
                 }
                 char c = infile.get();
                 while(infile.good()) {
@@ -1171,125 +1382,199 @@ string expand_includes(const string & script)
     return retval;
 }
 
+// Transducers to be harmonized with each other, converted to the output
+// format and minimized
+struct HarmonizationJob
+{
+    std::vector<HfstBasicTransducer *> transducers;
+    std::vector<HfstTransducer *> results;
+    StringSet alphabet;
+};
+
+// Harmonize, convert and minimize the transducers of the job. The
+// OpenFst operations involved don't share anything between different
+// transducers, so they are done by at most thread_count threads. Other
+// backends keep global state, so their transducers are done one at a time.
+static void run_harmonization_job(HarmonizationJob & job,
+                                  ImplementationType format,
+                                  size_t thread_count)
+{
+    job.results.assign(job.transducers.size(), NULL);
+    if (format != TROPICAL_OPENFST_TYPE && format != LOG_OPENFST_TYPE) {
+        thread_count = 1;
+    }
+    try {
+        hfst::run_in_threads(job.transducers.size(), thread_count, [&](size_t i) {
+            HfstBasicTransducer * basic = job.transducers[i];
+            // foma and xfsm harmonize when transducers are combined, so
+            // HfstTransducer::harmonize leaves their transducers alone
+            if (format != FOMA_TYPE && format != XFSM_TYPE) {
+                // Harmonizing changes both transducers, so each job has
+                // its own transducer with every symbol
+                HfstBasicTransducer all_symbols;
+                all_symbols.add_symbols_to_alphabet(job.alphabet);
+                basic->harmonize(all_symbols);
+            }
+            job.results[i] = new HfstTransducer(*basic, format);
+            delete basic;
+            job.transducers[i] = NULL;
+            job.results[i]->minimize();
+        });
+    } catch (...) {
+        for (size_t i = 0; i < job.transducers.size(); ++i) {
+            delete job.transducers[i];
+            delete job.results[i];
+        }
+        throw;
+    }
+}
+
 std::map<std::string, HfstTransducer*>
 compile(const string& pmatch, map<string,HfstTransducer*>& defs,
         ImplementationType impl, bool be_verbose, bool do_flatten,
         bool do_include_cosine_distances,
-        std::string includedir_)
-{
-    // lock here?
-    init_globals();
-    string expanded_script = expand_includes(pmatch);
-    data = strdup(expanded_script.c_str());
-    startptr = data;
-    len = strlen(data);
-    verbose = be_verbose;
-    flatten = do_flatten;
-    include_cosine_distances = do_include_cosine_distances;
-    includedir = includedir_;
-    vector_similarity_projection_factor = 1.0;
+        std::string includedir_, std::string cache_directory)
+{
+    PmatchCompilation compilation(impl, be_verbose, do_flatten,
+                                  do_include_cosine_distances, includedir_,
+                                  cache_directory);
+    return compile(compilation, pmatch, defs);
+}
+
+std::map<std::string, HfstTransducer*>
+compile(PmatchCompilation & compilation, const string& pmatch,
+        map<string,HfstTransducer*>& defs)
+{
+    string expanded_script = expand_includes(compilation, pmatch);
+    compilation.data = strdup(expanded_script.c_str());
+    compilation.startptr = compilation.data;
+    compilation.len = strlen(compilation.data);
     for (map<string, HfstTransducer*>::iterator it = defs.begin();
          it != defs.end(); ++it) {
-        definitions[it->first] = new PmatchTransducerContainer(it->second);
+        compilation.definitions[it->first] =
+            new PmatchTransducerContainer(compilation, it->second);
+        compilation.definition_sources[it->first] = DefinitionSource();
     }
-    format = impl;
-    if (hfst::pmatch::verbose) {
-        timer = clock();
+    if (compilation.verbose) {
+        compilation.timer = clock();
         std::cerr << std::endl;
     }
-    pmatchparse();
-    free(startptr);
+    // The scanner reads the script through getinput(). Its line count
+    // starts at 1 when it creates its first buffer.
+    pmatchlex_init_extra(&compilation, &compilation.scanner);
+    int parse_retval;
+    try {
+        parse_retval = pmatchparse(compilation.scanner, compilation);
+    } catch (...) {
+        pmatchlex_destroy(compilation.scanner);
+        compilation.scanner = NULL;
+        free(compilation.startptr);
+        compilation.data = compilation.startptr = NULL;
+        throw;
+    }
+    pmatchlex_destroy(compilation.scanner);
+    compilation.scanner = NULL;
+    free(compilation.startptr);
+    compilation.data = compilation.startptr = NULL;
     std::map<std::string, hfst::HfstTransducer*> retval;
      for (std::set<std::string>::const_iterator it =
-              unsatisfied_insertions.begin();
-          it != unsatisfied_insertions.end(); ++it) {
-         if (definitions.count(*it) == 0) {
+              compilation.unsatisfied_insertions.begin();
+          it != compilation.unsatisfied_insertions.end(); ++it) {
+         if (compilation.definitions.count(*it) == 0) {
              std::cerr << "Inserted transducer "
                        << *it << " was never defined!\n";
              return retval;
          }
      }
-     if (hfst::pmatch::verbose) {
+     if (compilation.verbose) {
          std::map<std::string, PmatchObject*>::iterator defs_itr;
-         for (defs_itr = definitions.begin(); defs_itr != definitions.end();
+         for (defs_itr = compilation.definitions.begin(); defs_itr != compilation.definitions.end();
               ++defs_itr) {
-             if (used_definitions.count(defs_itr->first) == 0 &&
+             if (compilation.used_definitions.count(defs_itr->first) == 0 &&
                  defs_itr->first.compare("TOP") != 0) {
                  std::cerr << "Warning: " << defs_itr->first << " defined but never used\n";
              }
          }
      }
 
-    if (pmatchnerrs != 0) {
-        data = 0;
-        len = 0;
+    if (parse_retval != 0) {
         return retval;
     }
     // Our helper for harmonizing all the networks' alphabets with
     // each other
-    if (hfst::pmatch::verbose) {
+    if (compilation.verbose) {
         std::cerr << "\nCompiling and harmonizing...\n";
-        timer = clock();
+        compilation.timer = clock();
     }
 
-    if (inserted_names.size() > 0 || def_insed_expressions.size() > 0) {
-        HfstTransducer dummy(format);
-        // We keep TOP and any inserted transducers
+    if (compilation.inserted_names.size() > 0 || compilation.def_insed_expressions.size() > 0) {
+        // We keep TOP and any inserted transducers. Evaluating them shares
+        // cached results between definitions, so it happens here one at a
+        // time, and the results are copied out so that they have nothing
+        // in common.
+        HarmonizationJob job;
+        std::vector<std::string> names;
         std::map<std::string, PmatchObject *>::iterator defs_it;
-        for (defs_it = definitions.begin(); defs_it != definitions.end();
+        for (defs_it = compilation.definitions.begin(); defs_it != compilation.definitions.end();
              ++defs_it) {
             if (defs_it->first.compare("TOP") == 0 ||
-                inserted_names.count(defs_it->first) != 0 ||
-                def_insed_expressions.count(defs_it->first) != 0) {
+                compilation.inserted_names.count(defs_it->first) != 0 ||
+                compilation.def_insed_expressions.count(defs_it->first) != 0) {
                 HfstTransducer * tmp = NULL;
-                if (def_insed_expressions.count(defs_it->first) != 0) {
-                    tmp = def_insed_expressions[defs_it->first]->evaluate();
+                if (compilation.def_insed_expressions.count(defs_it->first) != 0) {
+                    tmp = evaluate_definition(compilation, 
+                        defs_it->first,
+                        compilation.def_insed_expressions[defs_it->first], true);
                 } else {
-                    tmp = defs_it->second->evaluate();
+                    tmp = evaluate_definition(compilation, defs_it->first,
+                                              defs_it->second);
                 }
-                tmp->minimize();
-                dummy.harmonize(*tmp);
-                // This is what it will be called in the archive
-                tmp->set_name(defs_it->first);
-                retval[defs_it->first] = tmp;
+                StringSet alphabet = tmp->get_alphabet();
+                job.alphabet.insert(alphabet.begin(), alphabet.end());
+                job.transducers.push_back(new HfstBasicTransducer(*tmp));
+                delete tmp;
+                names.push_back(defs_it->first);
             }
         }
-        // Now that dummy is harmonized with everything, we harmonize everything
-        // with dummy and minimize the results
-        std::map<std::string, HfstTransducer *>::iterator tr_it;
-        for(tr_it = retval.begin(); tr_it != retval.end(); ++tr_it) {
-            tr_it->second->harmonize(dummy);
-            tr_it->second->minimize();
+        // Now that we have every symbol, we harmonize everything with them
+        // and minimize the results
+        run_harmonization_job(job, compilation.format, compilation.thread_count);
+        for (size_t i = 0; i < names.size(); ++i) {
+            // This is what it will be called in the archive
+            job.results[i]->set_name(names[i]);
+            retval[names[i]] = job.results[i];
         }
     } else {
-        if (definitions.size() == 0) {
+        if (compilation.definitions.size() == 0) {
             std::cerr << "warning: pmatch compilation had an empty result\n";
-                retval.insert(std::pair<std::string, hfst::HfstTransducer*>("TOP", new HfstTransducer(format)));
-        } else if (definitions.count("TOP") == 0) {
+                retval.insert(std::pair<std::string, hfst::HfstTransducer*>("TOP", new HfstTransducer(compilation.format)));
+        } else if (compilation.definitions.count("TOP") == 0) {
             std::cerr << "Pmatch compilation warning: regex or TOP was undefined, using ";
-            std::cerr << definitions.begin()->first << " as root\n";
-            hfst::HfstTransducer * tmp = definitions.begin()->second->evaluate();
+            std::cerr << compilation.definitions.begin()->first << " as root\n";
+            hfst::HfstTransducer * tmp = evaluate_definition(compilation, 
+                compilation.definitions.begin()->first, compilation.definitions.begin()->second);
             tmp->minimize();
             tmp->set_name("TOP");
             retval.insert(std::pair<std::string, hfst::HfstTransducer*>("TOP", tmp));
         } else {
-            hfst::HfstTransducer * tmp = definitions["TOP"]->evaluate();
+            hfst::HfstTransducer * tmp = evaluate_definition(compilation, 
+                "TOP", compilation.definitions["TOP"]);
             tmp->minimize();
             tmp->set_name("TOP");
             retval.insert(std::pair<std::string, hfst::HfstTransducer*>("TOP", tmp));
         }
     }
 
-    if (hfst::pmatch::verbose) {
-        double duration = (clock() - hfst::pmatch::timer) /
+    if (compilation.verbose) {
+        double duration = (clock() - compilation.timer) /
             (double) CLOCKS_PER_SEC;
-        hfst::pmatch::timer = clock();
+        compilation.timer = clock();
         std::cerr << "compiled and harmonized in " << duration << " seconds\n";
     }
 
     StringSet allowed_initial_symbols;
     StringSet disallowed_initial_symbols;
-    definitions["TOP"]->collect_initial_symbols_into(
+    compilation.definitions["TOP"]->collect_initial_symbols_into(
         allowed_initial_symbols, disallowed_initial_symbols);
     std::string initial_symbols_list;
     std::string disallowed_initial_symbols_list;
@@ -1298,7 +1583,7 @@ compile(const string& pmatch, map<string,HfstTransducer*>& defs,
     for (StringSet::iterator it = allowed_initial_symbols.begin();
          it != allowed_initial_symbols.end(); ++it) {
         if (is_special(*it)) {
-            if (hfst::pmatch::verbose) {
+            if (compilation.verbose) {
                 std::cerr << "Not setting initial symbol list due to special symbol " << *it << std::endl;
             }
             initial_symbols_ok = false;
@@ -1308,7 +1593,7 @@ compile(const string& pmatch, map<string,HfstTransducer*>& defs,
     for (StringSet::iterator it = disallowed_initial_symbols.begin();
          it != disallowed_initial_symbols.end(); ++it) {
         if (is_special(*it)) {
-            if (hfst::pmatch::verbose) {
+            if (compilation.verbose) {
                 std::cerr << "Not setting initial symbol list due to special symbol " << *it << std::endl;
             }
             initial_symbols_ok = false;
@@ -1316,27 +1601,27 @@ compile(const string& pmatch, map<string,HfstTransducer*>& defs,
         disallowed_initial_symbols_list.append(*it);
     }
     if (allowed_initial_symbols.size() > 200) {
-        if (hfst::pmatch::verbose) {
+        if (compilation.verbose) {
             std::cerr << "Not setting initial symbol list due to excess length: " << allowed_initial_symbols.size() << std::endl;
         }
         initial_symbols_ok = false;
     }
     if (disallowed_initial_symbols.size() > 200) {
-        if (hfst::pmatch::verbose) {
+        if (compilation.verbose) {
             std::cerr << "Not setting initial symbol list due to excess length: " << disallowed_initial_symbols.size() << std::endl;
         }
         initial_symbols_ok = false;
     }
     if (initial_symbols_ok && initial_symbols_list.size() != 0) {
-        variables["initial-symbols"] = initial_symbols_list;
+        compilation.variables["initial-symbols"] = initial_symbols_list;
     }
     if (initial_symbols_ok && disallowed_initial_symbols_list.size() != 0) {
-        variables["disallowed-initial-symbols"] = disallowed_initial_symbols_list;
+        compilation.variables["disallowed-initial-symbols"] = disallowed_initial_symbols_list;
     }
-    if (variables["need-separators"] == "on") {
-        HfstTransducer not_whitespace(hfst::internal_identity, format);
-        not_whitespace.subtract(*(get_utils()->latin1_whitespace_acceptor));
-        HfstTransducer anything(hfst::internal_identity, format);
+    if (compilation.variables["need-separators"] == "on") {
+        HfstTransducer not_whitespace(hfst::internal_identity, compilation.format);
+        not_whitespace.subtract(*(get_utils(compilation)->latin1_whitespace_acceptor));
+        HfstTransducer anything(hfst::internal_identity, compilation.format);
         anything.repeat_star();
         HfstTransducer begins_and_ends_with_non_whitespace(not_whitespace);
         begins_and_ends_with_non_whitespace.concatenate(anything);
@@ -1344,43 +1629,47 @@ compile(const string& pmatch, map<string,HfstTransducer*>& defs,
         begins_and_ends_with_non_whitespace.compose(*(retval["TOP"]));
         HfstTransducer is_single_non_whitespace(not_whitespace);
         is_single_non_whitespace.compose(*(retval["TOP"]));
-        HfstTransducer empty(format);
+        HfstTransducer empty(compilation.format);
         if (begins_and_ends_with_non_whitespace.compare(empty) == false ||
             is_single_non_whitespace.compare(empty) == false) {
-            HfstTransducer whitespace_punct_context(*(get_utils()->latin1_whitespace_acceptor));
-            whitespace_punct_context.disjunct(*(get_utils()->latin1_punct_acceptor));
-            whitespace_punct_context.disjunct(HfstTransducer("@BOUNDARY@", format));
-            HfstTransducer * top_with_boundaries = new HfstTransducer(hfst::internal_epsilon, LC_ENTRY_SYMBOL, format);
+            HfstTransducer whitespace_punct_context(*(get_utils(compilation)->latin1_whitespace_acceptor));
+            whitespace_punct_context.disjunct(*(get_utils(compilation)->latin1_punct_acceptor));
+            whitespace_punct_context.disjunct(HfstTransducer("@BOUNDARY@", compilation.format));
+            HfstTransducer * top_with_boundaries = new HfstTransducer(hfst::internal_epsilon, LC_ENTRY_SYMBOL, compilation.format);
             top_with_boundaries->concatenate(whitespace_punct_context);
-            top_with_boundaries->concatenate(HfstTransducer(hfst::internal_epsilon, LC_EXIT_SYMBOL, format));
-            HfstTransducer RC(hfst::internal_epsilon, RC_ENTRY_SYMBOL, format);
+            top_with_boundaries->concatenate(HfstTransducer(hfst::internal_epsilon, LC_EXIT_SYMBOL, compilation.format));
+            HfstTransducer RC(hfst::internal_epsilon, RC_ENTRY_SYMBOL, compilation.format);
             RC.concatenate(whitespace_punct_context);
-            RC.concatenate(HfstTransducer(hfst::internal_epsilon, RC_EXIT_SYMBOL, format));
+            RC.concatenate(HfstTransducer(hfst::internal_epsilon, RC_EXIT_SYMBOL, compilation.format));
             top_with_boundaries->concatenate(*(retval["TOP"]));
             top_with_boundaries->concatenate(RC);
             delete retval["TOP"];
             retval["TOP"] = add_pmatch_delimiters(top_with_boundaries);
             (retval["TOP"])->minimize();
-            if (hfst::pmatch::verbose) {
-                double duration = (clock() - hfst::pmatch::timer) /
+            (retval["TOP"])->set_name("TOP");
+            if (compilation.verbose) {
+                double duration = (clock() - compilation.timer) /
                     (double) CLOCKS_PER_SEC;
-                hfst::pmatch::timer = clock();
+                compilation.timer = clock();
                 std::cerr << "added automatic context separators in " << duration << " seconds\n";
             }
         }
     }
-    for(std::map<std::string, std::string>::iterator it = variables.begin();
-        it != variables.end(); ++it) {
+    for(std::map<std::string, std::string>::iterator it = compilation.variables.begin();
+        it != compilation.variables.end(); ++it) {
         retval["TOP"]->set_property(it->first, it->second);
     }
-    data = 0;
-    len = 0;
+    if (compilation.verbose && compilation.compilation_cache != NULL) {
+        std::cerr << "read " << compilation.compilation_cache->hits()
+                  << " definitions from the cache, compiled "
+                  << compilation.compilation_cache->misses() << std::endl;
+    }
     return retval;
 }
 
-void print_size_info(HfstTransducer * net)
+void print_size_info(PmatchCompilation & compilation, HfstTransducer * net)
 {
-    if (!hfst::pmatch::verbose) {
+    if (!compilation.verbose) {
         return;
     }
     HfstBasicTransducer tmp(*net);
@@ -1431,27 +1720,329 @@ HfstTransducer * read_text(std::string filename, ImplementationType type,
 HfstTransducer * read_spaced_text(std::string filename, ImplementationType type)
 { return read_text(filename, type, true); }
 
-std::string path_from_filename(const char * filename)
+std::string path_from_filename(PmatchCompilation & compilation,
+                               const char * filename)
 {
     std::string retval(filename);
-    if (includedir.size() > 0 && retval.size() > 0) {
+    if (compilation.includedir.size() > 0 && retval.size() > 0) {
         // includedir won't be > 0 under Windows until this mechanism is ported
         if (retval[0] != '/') {
             // not an absolute dir
-            retval.insert(0, includedir);
+            retval.insert(0, compilation.includedir);
         }
     }
     return retval;
 }
 
-void read_vec(std::string filename)
+WordVector WordVectorMatrix::get(size_t i) const
+{
+    WordVector retval;
+    retval.word = words[i];
+    retval.norm = norms[i];
+    retval.vector.assign(row(i), row(i) + dimension);
+    for (size_t j = 0; j < dimension; ++j) {
+        retval.vector[j] *= norms[i];
+    }
+    return retval;
+}
+
+size_t WordVectorMatrix::find(const std::string & word) const
+{
+    return std::find(words.begin(), words.end(), word) - words.begin();
+}
+
+void WordVectorMatrix::push_back(const std::string & word,
+                                 const std::vector<WordVecFloat> & vector)
+{
+    if (words.empty()) {
+        dimension = vector.size();
+    }
+    WordVecFloat vector_norm = norm(vector);
+    words.push_back(word);
+    norms.push_back(vector_norm);
+    for (size_t i = 0; i < vector.size(); ++i) {
+        unit_vectors.push_back(vector_norm > 0 ? vector[i] / vector_norm : 0);
+    }
+}
+
+void WordVectorMatrix::clear()
+{
+    filename.clear();
+    dimension = 0;
+    words.clear();
+    norms.clear();
+    unit_vectors.clear();
+    index.clear();
+}
+
+void WordVectorMatrix::prepare_index(bool verbose)
+{
+    if (!index.empty() || size() == 0) {
+        return;
+    }
+    std::string index_filename = filename + ".idx";
+    if (index.read(index_filename, *this)) {
+        if (verbose) {
+            std::cerr << "Read vector index " << index_filename << std::endl;
+        }
+        return;
+    }
+    if (verbose) {
+        std::cerr << "Building an index of " << size() << " vectors\n";
+    }
+    index.build(*this, VECTOR_INDEX_TREES);
+    if (!index.write(index_filename, *this)) {
+        std::cerr << "pmatch: could not write vector index file "
+                  << index_filename << std::endl;
+    }
+}
+
+void WordVectorIndex::clear()
+{
+    nodes.clear();
+    roots.clear();
+    leaf_items.clear();
+}
+
+// Split items[begin, end) by a random hyperplane and return the new node
+static unsigned int build_vector_tree(WordVectorIndex & index,
+                                      const WordVectorMatrix & vecs,
+                                      std::vector<unsigned int> & items,
+                                      size_t begin, size_t end,
+                                      std::mt19937 & random,
+                                      std::vector<WordVecFloat> & normal)
+{
+    unsigned int node = index.nodes.size();
+    index.nodes.push_back(WordVectorTreeNode());
+    if (end - begin <= VECTOR_INDEX_LEAF_SIZE) {
+        index.nodes[node].a = WordVectorTreeNode::NO_VECTOR;
+        index.nodes[node].b = WordVectorTreeNode::NO_VECTOR;
+        index.nodes[node].left = index.leaf_items.size();
+        index.nodes[node].right = end - begin;
+        index.leaf_items.insert(index.leaf_items.end(),
+                                items.begin() + begin, items.begin() + end);
+        return node;
+    }
+    std::uniform_int_distribution<size_t> pick(begin, end - 1);
+    unsigned int a = items[pick(random)];
+    unsigned int b = items[pick(random)];
+    for (size_t i = 0; a == b && i < 8; ++i) {
+        b = items[pick(random)];
+    }
+    // Vectors on the same side of the hyperplane as a go right
+    for (size_t i = 0; i < vecs.dimension; ++i) {
+        normal[i] = vecs.row(a)[i] - vecs.row(b)[i];
+    }
+    size_t middle = begin;
+    for (size_t i = begin; i < end; ++i) {
+        if (dot_product(vecs.row(items[i]), &normal[0], vecs.dimension) < 0) {
+            std::swap(items[i], items[middle]);
+            ++middle;
+        }
+    }
+    // Duplicate vectors and bad luck may leave a side (nearly) empty,
+    // split those in half to keep the tree shallow
+    size_t smaller = std::min(middle - begin, end - middle);
+    if (smaller <= (end - begin) / 32) {
+        middle = begin + (end - begin) / 2;
+    }
+    unsigned int left = build_vector_tree(index, vecs, items, begin, middle,
+                                          random, normal);
+    unsigned int right = build_vector_tree(index, vecs, items, middle, end,
+                                           random, normal);
+    index.nodes[node].a = a;
+    index.nodes[node].b = b;
+    index.nodes[node].left = left;
+    index.nodes[node].right = right;
+    return node;
+}
+
+void WordVectorIndex::build(const WordVectorMatrix & vecs, size_t trees)
+{
+    clear();
+    // A fixed seed gives the same index for the same vectors
+    std::mt19937 random(vecs.size());
+    std::vector<unsigned int> items(vecs.size());
+    std::vector<WordVecFloat> normal(vecs.dimension);
+    for (size_t t = 0; t < trees; ++t) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            items[i] = i;
+        }
+        roots.push_back(build_vector_tree(*this, vecs, items, 0, items.size(),
+                                          random, normal));
+    }
+}
+
+std::vector<unsigned int> WordVectorIndex::candidates(
+    const WordVectorMatrix & vecs, const WordVecFloat * query,
+    size_t search_k) const
+{
+    // Visit the nodes by how far the query is from the hyperplanes on the
+    // way to them, the leaves that the query falls in first
+    std::priority_queue<std::pair<WordVecFloat, unsigned int> > agenda;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        agenda.push(std::pair<WordVecFloat, unsigned int>(
+                        std::numeric_limits<WordVecFloat>::max(), roots[i]));
+    }
+    std::vector<unsigned int> retval;
+    while (!agenda.empty() && retval.size() < search_k) {
+        WordVecFloat margin = agenda.top().first;
+        const WordVectorTreeNode & node = nodes[agenda.top().second];
+        agenda.pop();
+        if (node.a == WordVectorTreeNode::NO_VECTOR) {
+            retval.insert(retval.end(), leaf_items.begin() + node.left,
+                          leaf_items.begin() + node.left + node.right);
+            continue;
+        }
+        const WordVecFloat * a = vecs.row(node.a);
+        const WordVecFloat * b = vecs.row(node.b);
+        // The distance to the hyperplane, |a - b| = sqrt(2 - 2 a.b)
+        WordVecFloat side = dot_product(query, a, vecs.dimension)
+            - dot_product(query, b, vecs.dimension);
+        WordVecFloat normal_norm = sqrt(std::max(
+            static_cast<WordVecFloat>(0.0),
+            2 - 2 * dot_product(a, b, vecs.dimension)));
+        if (normal_norm > 0) {
+            side /= normal_norm;
+        }
+        agenda.push(std::pair<WordVecFloat, unsigned int>(
+                        std::min(margin, side), node.right));
+        agenda.push(std::pair<WordVecFloat, unsigned int>(
+                        std::min(margin, -side), node.left));
+    }
+    std::sort(retval.begin(), retval.end());
+    retval.erase(std::unique(retval.begin(), retval.end()), retval.end());
+    return retval;
+}
+
+static const char VECTOR_INDEX_MAGIC[] = "HFST vector index 1\n";
+
+// Identifies the vectors an index was built for
+static unsigned long long vector_checksum(const WordVectorMatrix & vecs)
+{
+    // FNV-1a over the words and the lengths of the vectors
+    unsigned long long retval = 14695981039346656037ULL;
+    for (size_t i = 0; i < vecs.size(); ++i) {
+        const std::string & word = vecs.words[i];
+        const char * norm_bytes = (const char *) &vecs.norms[i];
+        for (size_t j = 0; j <= word.size(); ++j) {
+            retval = (retval ^ (unsigned char) word.c_str()[j])
+                * 1099511628211ULL;
+        }
+        for (size_t j = 0; j < sizeof(WordVecFloat); ++j) {
+            retval = (retval ^ (unsigned char) norm_bytes[j]) * 1099511628211ULL;
+        }
+    }
+    return retval;
+}
+
+template<typename T> static void write_index_array(std::ostream & out,
+                                                   const std::vector<T> & v)
+{
+    unsigned long long size = v.size();
+    out.write((const char *) &size, sizeof(size));
+    if (size > 0) {
+        out.write((const char *) &v[0], sizeof(T) * v.size());
+    }
+}
+
+template<typename T> static bool read_index_array(std::istream & in,
+                                                  std::vector<T> & v,
+                                                  unsigned long long max_size)
+{
+    unsigned long long size = 0;
+    in.read((char *) &size, sizeof(size));
+    if (!in.good() || size > max_size) {
+        return false;
+    }
+    v.resize(size);
+    if (size > 0) {
+        in.read((char *) &v[0], sizeof(T) * size);
+    }
+    return in.good();
+}
+
+bool WordVectorIndex::write(const std::string & filename,
+                            const WordVectorMatrix & vecs) const
+{
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!out.good()) {
+        return false;
+    }
+    unsigned long long header[3] =
+        { vecs.size(), vecs.dimension, vector_checksum(vecs) };
+    out.write(VECTOR_INDEX_MAGIC, sizeof(VECTOR_INDEX_MAGIC) - 1);
+    out.write((const char *) header, sizeof(header));
+    write_index_array(out, nodes);
+    write_index_array(out, roots);
+    write_index_array(out, leaf_items);
+    return out.good();
+}
+
+bool WordVectorIndex::read(const std::string & filename,
+                           const WordVectorMatrix & vecs)
+{
+    clear();
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        return false;
+    }
+    char magic[sizeof(VECTOR_INDEX_MAGIC) - 1];
+    unsigned long long header[3];
+    in.read(magic, sizeof(magic));
+    in.read((char *) header, sizeof(header));
+    // Each tree has fewer nodes than twice the number of vectors
+    unsigned long long max_items = vecs.size() * VECTOR_INDEX_TREES * 2;
+    if (!in.good() || memcmp(magic, VECTOR_INDEX_MAGIC, sizeof(magic)) != 0 ||
+        header[0] != vecs.size() || header[1] != vecs.dimension ||
+        header[2] != vector_checksum(vecs) ||
+        !read_index_array(in, nodes, max_items) ||
+        !read_index_array(in, roots, max_items) ||
+        !read_index_array(in, leaf_items, max_items)) {
+        clear();
+        return false;
+    }
+    // Don't trust the file further than we have to
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const WordVectorTreeNode & node = nodes[i];
+        bool ok;
+        if (node.a == WordVectorTreeNode::NO_VECTOR) {
+            ok = node.left <= leaf_items.size() &&
+                node.right <= leaf_items.size() - node.left;
+        } else {
+            // Children come after their parent, so there are no cycles
+            ok = node.a < vecs.size() && node.b < vecs.size() &&
+                node.left > i && node.left < nodes.size() &&
+                node.right > i && node.right < nodes.size();
+        }
+        if (!ok) {
+            clear();
+            return false;
+        }
+    }
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (roots[i] >= nodes.size()) {
+            clear();
+            return false;
+        }
+    }
+    for (size_t i = 0; i < leaf_items.size(); ++i) {
+        if (leaf_items[i] >= vecs.size()) {
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void read_vec(PmatchCompilation & compilation, std::string filename)
 {
     bool binary_format = false;
     if (filename.rfind(".bin") == filename.size() - 4) {
         binary_format = true;
     }
-    if (word_vectors.size() != 0) {
-        word_vectors.clear();
+    if (compilation.word_vectors.size() != 0) {
+        compilation.word_vectors.clear();
         std::cerr << "pmatch: vector model file " << filename
                   << " overrides earlier one\n";
     }
@@ -1471,7 +2062,10 @@ void read_vec(std::string filename)
     ss >> lexicon_size;
     ss.ignore(1);
     ss >> dimension;
-    word_vectors.reserve(lexicon_size + 1);
+    compilation.word_vectors.filename = filename;
+    compilation.word_vectors.words.reserve(lexicon_size + 1);
+    compilation.word_vectors.norms.reserve(lexicon_size + 1);
+    compilation.word_vectors.unit_vectors.reserve((lexicon_size + 1) * dimension);
     size_t words_read = 0;
     if (binary_format) {
         size_t vector_data_size = sizeof(float) * dimension;
@@ -1482,15 +2076,14 @@ void read_vec(std::string filename)
             std::getline(infile, line, separator);
             infile.read(&vector_data[0], vector_data_size);
             infile.ignore(1);
-            WordVector wv;
-            wv.word = line;
             // This will not compile is WordVectorFloat is not float,
             // in which case a conversion needs to happen, but
             // we can reasonably expect it to be a float for the
             // foreseeable future
-            wv.vector.assign((float*) vector_data.data(), (float*) (vector_data.data() + vector_data_size));
-            wv.norm = norm(wv.vector);
-            word_vectors.push_back(wv);
+            std::vector<WordVecFloat> components(
+                (float*) vector_data.data(),
+                (float*) (vector_data.data() + vector_data_size));
+            compilation.word_vectors.push_back(line, components);
             ++words_read;
         }
     } else {
@@ -1525,24 +2118,20 @@ void read_vec(std::string filename)
                 components.push_back(strtof(line.substr(pos + 1).c_str(), NULL));
             }
 #endif
-            if (word_vectors.size() != 0 && word_vectors[0].vector.size() != components.size()) {
+            if (compilation.word_vectors.size() != 0 && compilation.word_vectors.dimension != components.size()) {
                 std::cerr << "pmatch warning: vector file " << filename <<
                     " appears malformed\n  (reading line " << words_read + 1 << ")\n";
                 continue;
             }
-            WordVector wv;
-            wv.word = word;
-            wv.vector = components;
-            wv.norm = norm(components);
-            word_vectors.push_back(wv);
+            compilation.word_vectors.push_back(word, components);
         }
     }
     infile.close();
-    if (verbose) {
-        if (word_vectors.size() == 0) {
+    if (compilation.verbose) {
+        if (compilation.word_vectors.size() == 0) {
             std::cerr << "Tried to read word vector file, empty result\n";
         }
-        std::cerr << "Read " << word_vectors.size() << " vectors of dimensionality " << word_vectors[0].vector.size() << std::endl;
+        std::cerr << "Read " << compilation.word_vectors.size() << " vectors of dimensionality " << compilation.word_vectors.dimension << std::endl;
     }
 }
 
@@ -1583,7 +2172,8 @@ std::vector<std::vector<std::string> > read_args(char * filename, unsigned int a
     return retval;
 }
 
-PmatchUtilityTransducers::PmatchUtilityTransducers(void)
+PmatchUtilityTransducers::PmatchUtilityTransducers(ImplementationType type):
+    format(type)
 {
     latin1_acceptor = make_latin1_acceptor();
     latin1_alpha_acceptor = make_latin1_alpha_acceptor();
@@ -1960,7 +2550,7 @@ HfstTransducer * PmatchUtilityTransducers::tolower(HfstTransducer & t, Side side
     // This is to match flags in t with ?'s in "anything"
     hfst::set_xerox_composition(true);
 
-    HfstTransducer anything(hfst::internal_identity, hfst::pmatch::format);
+    HfstTransducer anything(hfst::internal_identity, format);
     if (optional == false) {
         anything.subtract(get_uppercase_acceptor_from_transducer(t));
     }
@@ -1998,7 +2588,7 @@ HfstTransducer * PmatchUtilityTransducers::toupper(HfstTransducer & t, Side side
     // This is to match flags in t with ?'s in "anything"
     hfst::set_xerox_composition(true);
 
-    HfstTransducer anything(hfst::internal_identity, hfst::pmatch::format);
+    HfstTransducer anything(hfst::internal_identity, format);
     if (optional == false) {
         anything.subtract(get_lowercase_acceptor_from_transducer(t));
     }
@@ -2029,11 +2619,12 @@ HfstTransducer * PmatchUtilityTransducers::toupper(HfstTransducer & t, Side side
     return retval;
 }
 
-PmatchObject::PmatchObject(void)
+PmatchObject::PmatchObject(PmatchCompilation & c):
+    compilation(c)
 {
     name = "";
     weight = 0.0;
-    line_defined = pmatchlineno;
+    line_defined = current_lineno(compilation);
     cache = (HfstTransducer*) (NULL);
     parent_is_context = false;
 }
@@ -2057,14 +2648,14 @@ HfstTransducer * PmatchObject::evaluate(std::vector<PmatchObject *> args)
         }
     } else {
         std::stringstream errstring;
-        errstring << "Object " << name << " on line " << pmatchlineno << " has no argument handling";
+        errstring << "Object " << name << " on line " << current_lineno(compilation) << " has no argument handling";
         throw std::invalid_argument(errstring.str());
     }
 }
 
 PmatchObject * PmatchObject::evaluate_as_arg(void)
 {
-    return new PmatchTransducerContainer(evaluate());
+    return new PmatchTransducerContainer(compilation, evaluate());
 }
 
 void PmatchObject::expand_Ins_arcs(StringSet & ss)
@@ -2087,12 +2678,12 @@ void PmatchObject::expand_Ins_arcs(StringSet & ss)
                     std::string ins_name = it->substr(3, it->size() - 3 - 1);
                     did_no_expansions = false;
                     expansions_done.insert(*it);
-                    if (definitions.count(ins_name) != 0) {
+                    if (compilation.definitions.count(ins_name) != 0) {
                         StringSet allowed, disallowed;
-                        if (def_insed_expressions.count(ins_name) != 0) {
-                            def_insed_expressions[ins_name]->collect_initial_symbols_into(allowed, disallowed);
+                        if (compilation.def_insed_expressions.count(ins_name) != 0) {
+                            compilation.def_insed_expressions[ins_name]->collect_initial_symbols_into(allowed, disallowed);
                         } else {
-                            definitions[ins_name]->collect_initial_symbols_into(allowed, disallowed);
+                            compilation.definitions[ins_name]->collect_initial_symbols_into(allowed, disallowed);
                         }
                         if (allowed.size() != 0) {
                             expanded_symbols.insert(allowed.begin(), allowed.end());
@@ -2327,21 +2918,22 @@ HfstTransducer * PmatchSymbol::evaluate(void)
 {
     start_timing();
     HfstTransducer * retval = NULL;
-    if (symbol_in_local_context(sym)) {
-        retval = symbol_from_local_context(sym)->evaluate();
-    } else if (symbol_in_global_context(sym)) {
-        if (flatten && def_insed_expressions.count(sym) == 1) {
-            retval = def_insed_expressions[sym]->evaluate();
+    if (symbol_in_local_context(compilation, sym)) {
+        retval = symbol_from_local_context(compilation, sym)->evaluate();
+    } else if (symbol_in_global_context(compilation, sym)) {
+        if (compilation.flatten && compilation.def_insed_expressions.count(sym) == 1) {
+            retval = evaluate_definition(compilation, sym, compilation.def_insed_expressions[sym],
+                                         true);
         } else {
-            retval = symbol_from_global_context(sym)->evaluate();
+            retval = evaluate_definition(compilation, sym, symbol_from_global_context(compilation, sym));
         }
-        used_definitions.insert(sym);
+        compilation.used_definitions.insert(sym);
     } else {
-        if (verbose) {
+        if (compilation.verbose) {
             std::cerr << "Warning: interpreting undefined symbol \"" << sym
                       << "\" as label on line " << line_defined << "\n";
         }
-        retval = new HfstTransducer(sym, format);
+        retval = new HfstTransducer(sym, compilation.format);
     }
     retval->set_final_weights(hfst::double_to_float(weight), true);
     retval->minimize();
@@ -2351,31 +2943,31 @@ HfstTransducer * PmatchSymbol::evaluate(void)
 
 PmatchObject * PmatchSymbol::evaluate_as_arg(void)
 {
-    if (symbol_in_local_context(sym)) {
-        return symbol_from_local_context(sym)->evaluate_as_arg();
-    } else if (symbol_in_global_context(sym)) {
-        used_definitions.insert(sym);
-        if (flatten && def_insed_expressions.count(sym) == 1) {
-            return def_insed_expressions[sym]->evaluate_as_arg();
+    if (symbol_in_local_context(compilation, sym)) {
+        return symbol_from_local_context(compilation, sym)->evaluate_as_arg();
+    } else if (symbol_in_global_context(compilation, sym)) {
+        compilation.used_definitions.insert(sym);
+        if (compilation.flatten && compilation.def_insed_expressions.count(sym) == 1) {
+            return compilation.def_insed_expressions[sym]->evaluate_as_arg();
         } else {
-            return symbol_from_global_context(sym)->evaluate_as_arg();
+            return symbol_from_global_context(compilation, sym)->evaluate_as_arg();
         }
     } else {
-        if (verbose) {
+        if (compilation.verbose) {
             std::cerr << "Warning: interpreting undefined symbol \"" << sym
                       << "\" as label on line " << line_defined << "\n";
         }
-        return new PmatchString(sym);
+        return new PmatchString(compilation, sym);
     }
 }
 
 void PmatchSymbol::collect_strings_into(StringVector & strings)
 {
-    if (symbol_in_local_context(sym)) {
-        symbol_from_local_context(sym)->collect_strings_into(strings);
-    } else if (symbol_in_global_context(sym)) {
-        symbol_from_global_context(sym)->collect_strings_into(strings);
-        used_definitions.insert(sym);
+    if (symbol_in_local_context(compilation, sym)) {
+        symbol_from_local_context(compilation, sym)->collect_strings_into(strings);
+    } else if (symbol_in_global_context(compilation, sym)) {
+        symbol_from_global_context(compilation, sym)->collect_strings_into(strings);
+        compilation.used_definitions.insert(sym);
     } else {
         strings.push_back(sym);
     }
@@ -2390,9 +2982,9 @@ HfstTransducer * PmatchString::evaluate(void) {
     HfstTransducer * tmp;
     if(multichar) {
         HfstTokenizer tok;
-        tmp = new HfstTransducer(string, tok, format);
+        tmp = new HfstTransducer(string, tok, compilation.format);
     } else {
-        tmp = new HfstTransducer(string, format);
+        tmp = new HfstTransducer(string, compilation.format);
     }
     tmp->set_final_weights(hfst::double_to_float(weight), true);
     if (cache == NULL && should_use_cache() == true) {
@@ -2411,7 +3003,7 @@ PmatchObject * PmatchString::evaluate_as_arg(void) {
 
 HfstTransducer * PmatchFunction::evaluate(std::vector<PmatchObject *> funargs)
 {
-    if (verbose) {
+    if (compilation.verbose) {
         my_timer = clock();
     }
     if (funargs.size() != args.size()) {
@@ -2420,17 +3012,17 @@ HfstTransducer * PmatchFunction::evaluate(std::vector<PmatchObject *> funargs)
         throw std::invalid_argument(errstring.str());
     }
     std::map<std::string, PmatchObject *> local_env;
-    if (call_stack.size() != 0) {
-        local_env = call_stack.back();
+    if (compilation.call_stack.size() != 0) {
+        local_env = compilation.call_stack.back();
     };
     for (int i = 0; i < (int)args.size(); ++i) {
         local_env[args[i]] = funargs[i];
     }
-    call_stack.push_back(local_env);
+    compilation.call_stack.push_back(local_env);
     HfstTransducer * retval = root->evaluate();
     retval->set_final_weights(hfst::double_to_float(weight), true);
-    call_stack.pop_back();
-    if (verbose) {
+    compilation.call_stack.pop_back();
+    if (compilation.verbose) {
         double duration = (clock() - my_timer) /
             (double) CLOCKS_PER_SEC;
         std::cerr << "Call to " << name << " evaluated in " << duration << " seconds\n";
@@ -2534,15 +3126,15 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
             whole_string += *it;
         }
         if (whole_string.size() > 0) {
-            retval = new HfstTransducer(whole_string, format);
+            retval = new HfstTransducer(whole_string, compilation.format);
         } else {
-            retval = new HfstTransducer(format);
+            retval = new HfstTransducer(compilation.format);
         }
         retval->set_final_weights(hfst::double_to_float(weight), true);
         if (cache == NULL && should_use_cache() == true) {
             cache = retval;
             report_time();
-            print_size_info(cache);
+            print_size_info(compilation, cache);
             return new HfstTransducer(*cache);
         }
         report_time();
@@ -2557,15 +3149,15 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
         }
         HfstTokenizer tok;
         if (whole_string.size() > 0) {
-            retval = new HfstTransducer(whole_string, tok, format);
+            retval = new HfstTransducer(whole_string, tok, compilation.format);
         } else {
-            retval = new HfstTransducer(format);
+            retval = new HfstTransducer(compilation.format);
         }
         retval->set_final_weights(hfst::double_to_float(weight), true);
         if (cache == NULL && should_use_cache() == true) {
             cache = retval;
             report_time();
-            print_size_info(cache);
+            print_size_info(compilation, cache);
             return new HfstTransducer(*cache);
         }
         report_time();
@@ -2592,13 +3184,13 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
     } else if (op == Complement) {
         // Defined here only for automata, so can project to input
         HfstTransducer * complement =
-            new HfstTransducer(hfst::internal_identity, hfst::pmatch::format);
+            new HfstTransducer(hfst::internal_identity, compilation.format);
         complement->repeat_star();
         complement->subtract(*retval);
         delete retval;
         retval = complement;
     } else if (op == Containment) {
-        HfstTransducer any(hfst::internal_identity, hfst::pmatch::format);
+        HfstTransducer any(hfst::internal_identity, compilation.format);
         any.repeat_star();
         HfstTransducer * left = new HfstTransducer(any);
         left->concatenate(*retval);
@@ -2606,140 +3198,134 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
         delete retval;
         retval = left;
     } else if (op == ContainmentOnce) {
-        hfst::ImplementationType xre_orig_type = hfst::xre::format;
-        hfst::xre::format = hfst::pmatch::format;
         HfstTransducer * new_retval = hfst::xre::contains_once(retval);
-        hfst::xre::format = xre_orig_type;
         delete retval;
         retval = new_retval;
     } else if (op == ContainmentOptional) {
-        hfst::ImplementationType xre_orig_type = hfst::xre::format;
-        hfst::xre::format = hfst::pmatch::format;
         HfstTransducer * new_retval = hfst::xre::contains_once_optional(retval);
-        hfst::xre::format = xre_orig_type;
         delete retval;
         retval = new_retval;
     } else if (op == TermComplement) {
         HfstTransducer* any = new HfstTransducer(hfst::internal_identity,
-                                                 hfst::pmatch::format);
+                                                 compilation.format);
         hfst::StringSet alphabet = get_non_special_alphabet(retval);
         for (hfst::StringSet::iterator it = alphabet.begin(); it != alphabet.end(); ++it) {
-            HfstTransducer symbol(*it, hfst::pmatch::format);
+            HfstTransducer symbol(*it, compilation.format);
             any->subtract(symbol);
         }
         delete retval;
         retval = any;
     } else if (op == Cap) {
-        HfstTransducer * tmp = get_utils()->cap(*retval);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval);
         delete retval;
         retval = tmp;
     } else if (op == OptCap) {
-        HfstTransducer * tmp = get_utils()->cap(*retval, Both, true);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval, Both, true);
         delete retval;
         retval = tmp;
     } else if (op == ToLower) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval);
         delete retval;
         retval = tmp;
     } else if (op == ToUpper) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval);
         delete retval;
         retval = tmp;
     } else if (op == OptToLower) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval, Both, true);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval, Both, true);
         tmp->disjunct(*retval);
         delete retval;
         retval = tmp;
     } else if (op == OptToUpper) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval, Both, true);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval, Both, true);
         delete retval;
         retval = tmp;
     } else if (op == AnyCase) {
-        HfstTransducer * toupper = get_utils()->toupper(*retval, Both, true);
-        HfstTransducer * tolower = get_utils()->tolower(*retval, Both, true);
+        HfstTransducer * toupper = get_utils(compilation)->toupper(*retval, Both, true);
+        HfstTransducer * tolower = get_utils(compilation)->tolower(*retval, Both, true);
         retval->disjunct(*toupper);
         retval->disjunct(*tolower);
         delete toupper; delete tolower;
     } else if (op == CapUpper) {
-        HfstTransducer * tmp = get_utils()->cap(*retval, Upper);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval, Upper);
         delete retval;
         retval = tmp;
     } else if (op == OptCapUpper) {
-        HfstTransducer * tmp = get_utils()->cap(*retval, Upper, true);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval, Upper, true);
         delete retval;
         retval = tmp;
     } else if (op == ToLowerUpper) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval, Upper);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval, Upper);
         delete retval;
         retval = tmp;
     } else if (op == ToUpperUpper) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval, Upper);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval, Upper);
         delete retval;
         retval = tmp;
     } else if (op == OptToLowerUpper) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval, Upper, true);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval, Upper, true);
         tmp->disjunct(*retval);
         delete retval;
         retval = tmp;
     } else if (op == OptToUpperUpper) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval, Upper, true);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval, Upper, true);
         delete retval;
         retval = tmp;
     } else if (op == AnyCaseUpper) {
-        HfstTransducer * toupper = get_utils()->toupper(*retval, Upper, true);
-        HfstTransducer * tolower = get_utils()->tolower(*retval, Upper, true);
+        HfstTransducer * toupper = get_utils(compilation)->toupper(*retval, Upper, true);
+        HfstTransducer * tolower = get_utils(compilation)->tolower(*retval, Upper, true);
         retval->disjunct(*toupper);
         retval->disjunct(*tolower);
         delete toupper; delete tolower;
     } else if (op == CapLower) {
-        HfstTransducer * tmp = get_utils()->cap(*retval, Lower);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval, Lower);
         delete retval;
         retval = tmp;
     } else if (op == OptCapLower) {
-        HfstTransducer * tmp = get_utils()->cap(*retval, Lower, true);
+        HfstTransducer * tmp = get_utils(compilation)->cap(*retval, Lower, true);
         delete retval;
         retval = tmp;
     } else if (op == ToLowerLower) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval, Lower);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval, Lower);
         delete retval;
         retval = tmp;
     } else if (op == ToUpperLower) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval, Lower);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval, Lower);
         delete retval;
         retval = tmp;
     } else if (op == OptToLowerLower) {
-        HfstTransducer * tmp = get_utils()->tolower(*retval, Lower, true);
+        HfstTransducer * tmp = get_utils(compilation)->tolower(*retval, Lower, true);
         tmp->disjunct(*retval);
         delete retval;
         retval = tmp;
     } else if (op == OptToUpperLower) {
-        HfstTransducer * tmp = get_utils()->toupper(*retval, Lower, true);
+        HfstTransducer * tmp = get_utils(compilation)->toupper(*retval, Lower, true);
         delete retval;
         retval = tmp;
     } else if (op == AnyCaseLower) {
-        HfstTransducer * toupper = get_utils()->toupper(*retval, Lower, true);
-        HfstTransducer * tolower = get_utils()->tolower(*retval, Lower, true);
+        HfstTransducer * toupper = get_utils(compilation)->toupper(*retval, Lower, true);
+        HfstTransducer * tolower = get_utils(compilation)->tolower(*retval, Lower, true);
         retval->disjunct(*toupper);
         retval->disjunct(*tolower);
         delete toupper; delete tolower;
     } else if (op == MakeSigma) {
-        HfstTransducer * tmp = make_sigma(retval);
+        HfstTransducer * tmp = make_sigma(retval, compilation.format);
         delete retval;
         retval = tmp;
     } else if (op == MakeList) {
-        HfstTransducer * tmp = make_list(retval);
+        HfstTransducer * tmp = make_list(retval, compilation.format);
         delete retval;
         retval = tmp;
     } else if (op == MakeExcList) {
-        HfstTransducer * tmp = make_exc_list(retval);
+        HfstTransducer * tmp = make_exc_list(retval, compilation.format);
         delete retval;
         retval = tmp;
     } else if (op == LC) {
         if (!parent_is_context) {
             retval->reverse();
-            HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, LC_ENTRY_SYMBOL, format);
+            HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, LC_ENTRY_SYMBOL, compilation.format);
             tmp->concatenate(*retval);
-            HfstTransducer lc_exit(hfst::internal_epsilon, LC_EXIT_SYMBOL, format);
+            HfstTransducer lc_exit(hfst::internal_epsilon, LC_EXIT_SYMBOL, compilation.format);
             tmp->concatenate(lc_exit);
             delete retval;
             retval = tmp;
@@ -2747,11 +3333,11 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
     } else if (op == NLC) {
         if (!parent_is_context) {
             retval->reverse();
-            PmatchTransducerContainer * tmp = make_minimization_guard();
+            PmatchTransducerContainer * tmp = make_minimization_guard(compilation);
             HfstTransducer * head = tmp->evaluate(); delete tmp;
-            HfstTransducer passthrough(PASSTHROUGH_SYMBOL, format);
-            HfstTransducer nlc_entry(hfst::internal_epsilon, NLC_ENTRY_SYMBOL, format);
-            HfstTransducer nlc_exit(hfst::internal_epsilon, NLC_EXIT_SYMBOL, format);
+            HfstTransducer passthrough(PASSTHROUGH_SYMBOL, compilation.format);
+            HfstTransducer nlc_entry(hfst::internal_epsilon, NLC_ENTRY_SYMBOL, compilation.format);
+            HfstTransducer nlc_exit(hfst::internal_epsilon, NLC_EXIT_SYMBOL, compilation.format);
             nlc_entry.concatenate(*retval);
             nlc_entry.concatenate(nlc_exit);
             nlc_entry.disjunct(passthrough);
@@ -2761,20 +3347,20 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
             }
     } else if (op == RC) {
         if (!parent_is_context) {
-            HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, RC_ENTRY_SYMBOL, format);
+            HfstTransducer * tmp = new HfstTransducer(hfst::internal_epsilon, RC_ENTRY_SYMBOL, compilation.format);
             tmp->concatenate(*retval);
-            HfstTransducer rc_exit(hfst::internal_epsilon, RC_EXIT_SYMBOL, format);
+            HfstTransducer rc_exit(hfst::internal_epsilon, RC_EXIT_SYMBOL, compilation.format);
             tmp->concatenate(rc_exit);
             delete retval;
             retval = tmp;
         }
     } else if (op == NRC) {
         if (!parent_is_context) {
-            PmatchTransducerContainer * tmp = make_minimization_guard();
+            PmatchTransducerContainer * tmp = make_minimization_guard(compilation);
             HfstTransducer * head = tmp->evaluate(); delete tmp;
-            HfstTransducer passthrough(PASSTHROUGH_SYMBOL, format);
-            HfstTransducer nrc_entry(hfst::internal_epsilon, NRC_ENTRY_SYMBOL, format);
-            HfstTransducer nrc_exit(hfst::internal_epsilon, NRC_EXIT_SYMBOL, format);
+            HfstTransducer passthrough(PASSTHROUGH_SYMBOL, compilation.format);
+            HfstTransducer nrc_entry(hfst::internal_epsilon, NRC_ENTRY_SYMBOL, compilation.format);
+            HfstTransducer nrc_exit(hfst::internal_epsilon, NRC_EXIT_SYMBOL, compilation.format);
             nrc_entry.concatenate(*retval);
             nrc_entry.concatenate(nrc_exit);
             nrc_entry.disjunct(passthrough);
@@ -2789,7 +3375,7 @@ HfstTransducer * PmatchUnaryOperation::evaluate(void)
         cache = retval;
         cache->minimize();
         report_time();
-        print_size_info(cache);
+        print_size_info(compilation, cache);
         return new HfstTransducer(*cache);
     }
     report_time();
@@ -2812,7 +3398,7 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
             left->collect_strings_into(strings);
             right->collect_strings_into(strings);
             HfstTokenizer tok;
-            retval = new HfstTransducer(format);
+            retval = new HfstTransducer(compilation.format);
             for (StringVector::iterator it = strings.begin(); it != strings.end(); ++it) {
                 StringPairVector spv = tok.tokenize(*it);
                 retval->disjunct(spv);
@@ -2821,7 +3407,7 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
             if (cache == NULL && should_use_cache() == true) {
                 cache = retval;
                 // No minimization because we did it the clever way!
-                print_size_info(cache);
+                print_size_info(compilation, cache);
                 report_time();
                 return new HfstTransducer(*cache);
             }
@@ -2848,10 +3434,10 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
     } else if (op == Subtract) {
         lhs->subtract(*rhs);
     } else if (op == UpperSubtract) {
-        pmatcherror("Upper subtraction not implemented.");
+        pmatcherror(compilation, "Upper subtraction not implemented.");
         return lhs;
     } else if (op == LowerSubtract) {
-        pmatcherror("Lower subtraction not implemented.");
+        pmatcherror(compilation, "Lower subtraction not implemented.");
         return lhs;
     } else if (op == UpperPriorityUnion) {
         lhs->priority_union(*rhs);
@@ -2865,7 +3451,7 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
             lhs->shuffle(*rhs);
         } catch (const TransducersAreNotAutomataException & e) {
             (void)e;
-            pmatchwarning("tried to shuffle with non-automaton transducers,\n"
+            pmatchwarning(compilation, "tried to shuffle with non-automaton transducers,\n"
                           "    shuffling with their input projection instead.");
             lhs->input_project();
             rhs->input_project();
@@ -2891,15 +3477,23 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
         delete middle_part;
         delete right_part;
     } else if (op == Merge) {
-        HfstTransducer * tmp;
         try {
-            tmp = hfst::xre::merge_first_to_second(lhs, rhs);
+            // No xre definitions are available to the merge
+            struct hfst::xre::XreConstructorArguments args
+                (std::map<std::string, HfstTransducer*>(),
+                 std::map<std::string, std::string>(),
+                 std::map<std::string, unsigned int>(),
+                 std::map<std::string, std::set<std::string> >(),
+                 compilation.format);
+            lhs->optimize();
+            rhs->merge(*lhs, args);
+            // The result is in rhs, and the other one is deleted below
+            std::swap(lhs, rhs);
         }
         catch (const TransducersAreNotAutomataException & e) {
             (void)e;
-            pmatcherror("Error: transducers must be automata in merge operation.");
+            pmatcherror(compilation, "Error: transducers must be automata in merge operation.");
         }
-        delete lhs; lhs = tmp;
     }
     delete rhs;
     lhs->set_final_weights(hfst::double_to_float(weight), true);
@@ -2907,7 +3501,7 @@ HfstTransducer * PmatchBinaryOperation::evaluate(void)
     if (cache == NULL && should_use_cache() == true) {
         cache = retval;
         cache->minimize();
-        print_size_info(cache);
+        print_size_info(compilation, cache);
         report_time();
         return new HfstTransducer(*cache);
     }
@@ -2970,22 +3564,22 @@ HfstTransducer * PmatchAcceptor::evaluate(void)
     HfstTransducer * retval = NULL;
     switch(set) {
     case Alpha:
-        retval = new HfstTransducer(* get_utils()->latin1_alpha_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_alpha_acceptor);
         break;
     case UppercaseAlpha:
-        retval = new HfstTransducer(* get_utils()->latin1_uppercase_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_uppercase_acceptor);
         break;
     case LowercaseAlpha:
-        retval = new HfstTransducer(* get_utils()->latin1_lowercase_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_lowercase_acceptor);
         break;
     case Numeral:
-        retval = new HfstTransducer(* get_utils()->latin1_numeral_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_numeral_acceptor);
         break;
     case Punctuation:
-        retval = new HfstTransducer(* get_utils()->latin1_punct_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_punct_acceptor);
         break;
     case Whitespace:
-        retval = new HfstTransducer(* get_utils()->latin1_whitespace_acceptor);
+        retval = new HfstTransducer(* get_utils(compilation)->latin1_whitespace_acceptor);
     }
     retval->set_final_weights(hfst::double_to_float(weight), true);
     report_time();
@@ -3026,7 +3620,7 @@ HfstTransducer * PmatchParallelRulesContainer::evaluate(void)
         break;
     case hfst::xeroxRules::E_REPLACE_RIGHT_MARKUP:
     default:
-        pmatcherror("Unrecognized arrow type");
+        pmatcherror(compilation, "Unrecognized arrow type");
         return (HfstTransducer *) NULL;
     }
     retval->set_final_weights(hfst::double_to_float(weight), true);
@@ -3084,7 +3678,7 @@ HfstTransducer * PmatchReplaceRuleContainer::evaluate(void)
         break;
     case hfst::xeroxRules::E_REPLACE_RIGHT_MARKUP:
     default:
-        pmatcherror("Unrecognized arrow");
+        pmatcherror(compilation, "Unrecognized arrow");
         return (HfstTransducer *) NULL;
     }
     retval->set_final_weights(hfst::double_to_float(weight), true);
@@ -3127,7 +3721,7 @@ HfstTransducer * PmatchQuestionMark::evaluate(void)
 {
     start_timing();
     HfstTransducer * retval = NULL;
-    retval = new HfstTransducer(hfst::internal_identity, format);
+    retval = new HfstTransducer(hfst::internal_identity, compilation.format);
     retval->set_final_weights(hfst::double_to_float(weight), true);
     report_time();
     return retval;
@@ -3167,7 +3761,8 @@ TransducerPointerPair PmatchMarkupContainer::evaluate_pair(void) {
     HfstTransducer * loa = left_of_arrow->evaluate();
     HfstTransducer * lom = left->evaluate();
     HfstTransducer * rom = right->evaluate();
-    HfstTransducerPair tmpMappingPair(*loa, HfstTransducer(format));
+    HfstTransducerPair tmpMappingPair(
+        *loa, HfstTransducer(left_of_arrow->compilation.format));
     HfstTransducerPair marks(*lom, *rom);
     HfstTransducerPair MappingPair = hfst::xeroxRules::create_mapping_for_mark_up_replace(tmpMappingPair, marks);
     delete loa; delete lom; delete rom;
@@ -3176,7 +3771,7 @@ TransducerPointerPair PmatchMarkupContainer::evaluate_pair(void) {
     return retval;
 }
 
-HfstTransducer * PmatchMappingPairsContainer::evaluate(void) { pmatcherror("Should never happen\n"); return 0; }
-HfstTransducer * PmatchContextsContainer::evaluate(void) { pmatcherror("Should never happen\n"); return 0; }
+HfstTransducer * PmatchMappingPairsContainer::evaluate(void) { pmatcherror(compilation, "Should never happen\n"); return 0; }
+HfstTransducer * PmatchContextsContainer::evaluate(void) { pmatcherror(compilation, "Should never happen\n"); return 0; }
 
 } }
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include "HfstTransducer.h"
 #include "HfstXeroxRules.h"
+#include "CompilationCache.h"
 #include "xre_utils.h"
 
 #if USE_GLIB_UNICODE
@@ -34,10 +35,14 @@
 #include <unicode/uchar.h>
 #endif
 
-void pmatchwarning(const char *msg);
+namespace hfst { namespace pmatch { struct PmatchCompilation; } }
+
+void pmatchwarning(hfst::pmatch::PmatchCompilation & compilation,
+                   const char *msg);
 
 namespace hfst { namespace pmatch {
 
+struct PmatchCompilation;
 struct PmatchFunction;
 struct PmatchObject;
 struct PmatchTransducerContainer;
@@ -45,29 +50,7 @@ struct PmatchTransducerContainer;
 typedef std::pair<std::string, std::string> StringPair;
 typedef float WordVecFloat;
 struct WordVector;
-
-extern char* data;
-extern char* startptr;
-extern size_t len;
-extern std::map<std::string, PmatchObject*> definitions;
-extern std::map<std::string, std::string> variables;
-extern std::vector<std::map<std::string, PmatchObject*> > call_stack;
-extern std::map<std::string, PmatchObject*> def_insed_expressions;
-extern std::set<std::string> inserted_names;
-extern std::set<std::string> unsatisfied_insertions;
-extern std::set<std::string> used_definitions;
-extern std::set<std::string> function_names;
-extern std::set<std::string> capture_names;
-extern std::vector<WordVector> word_vectors;
-extern ImplementationType format;
-extern bool verbose;
-extern bool flatten;
-extern bool include_cosine_distances;
-extern std::string includedir;
-extern clock_t timer;
-extern int minimization_guard_count;
-extern bool need_delimiters;
-extern WordVecFloat vector_similarity_projection_factor;
+struct WordVectorMatrix;
 
 struct PmatchUtilityTransducers;
 const std::string RC_ENTRY_SYMBOL = "@PMATCH_RC_ENTRY@";
@@ -92,19 +75,55 @@ enum Side {
 
 void add_to_pmatch_symbols(StringSet symbols);
 void warn(std::string warning);
-PmatchUtilityTransducers* get_utils();
-void zero_minimization_guard();
-bool symbol_in_global_context(std::string & sym);
-bool symbol_in_local_context(std::string & sym);
-PmatchObject * symbol_from_global_context(std::string & sym);
-PmatchObject * symbol_from_local_context(std::string & sym);
+PmatchUtilityTransducers* get_utils(PmatchCompilation & compilation);
+void zero_minimization_guard(PmatchCompilation & compilation);
+bool symbol_in_global_context(PmatchCompilation & compilation,
+                              std::string & sym);
+bool symbol_in_local_context(PmatchCompilation & compilation,
+                             std::string & sym);
+PmatchObject * symbol_from_global_context(PmatchCompilation & compilation,
+                                          std::string & sym);
+PmatchObject * symbol_from_local_context(PmatchCompilation & compilation,
+                                         std::string & sym);
 bool string_set_has_meta_arc(StringSet & ss);
 bool is_special(const std::string & symbol);
 
+/**
+ * @brief The source of a definition and the names it uses, for the
+ * compilation cache. A definition is not cacheable if it reads files or
+ * word vectors, is defined more than once or is given to compile()
+ * already compiled.
+ */
+struct DefinitionSource
+{
+    bool cacheable;
+    std::string text;
+    std::set<std::string> uses;
+    DefinitionSource(): cacheable(false) {}
+};
+
+/**
+ * @brief Record the source of the definition of @a name that was just
+ * parsed: the text between definition_start and definition_end and
+ * definition_uses. If @a text is given, it is used instead.
+ */
+void record_definition_source(PmatchCompilation & compilation,
+                              const std::string & name,
+                              const std::string & text = "");
+
+/**
+ * @brief Evaluate @a def, the definition of @a name, using the compilation
+ * cache if there is one. @a insed tells that @a def is the expression of a
+ * DefIns definition instead of the definition itself.
+ */
+HfstTransducer * evaluate_definition(PmatchCompilation & compilation,
+                                     const std::string & name,
+                                     PmatchObject * def, bool insed = false);
+
 /**
  * @brief input handling function for flex that parses strings.
  */
-int getinput(char *buf, int maxlen);
+int getinput(PmatchCompilation & compilation, char *buf, int maxlen);
 
 /**
  * @brief remove percent escaping from given string @a s.
@@ -136,25 +155,33 @@ HfstTransducer * add_pmatch_delimiters(HfstTransducer * regex);
 /**
  * @brief utility functions for making special arcs
  */
-PmatchTransducerContainer * epsilon_to_symbol_container(std::string s);
-PmatchTransducerContainer * make_end_tag(std::string tag);
-PmatchTransducerContainer * make_capture_tag(std::string tag);
-PmatchTransducerContainer * make_captured_tag(std::string tag);
-PmatchObject * make_with_tag_entry(std::string key, std::string value);
-PmatchObject * make_with_tag_exit(std::string key);
-
-std::vector<std::pair<WordVector, WordVecFloat> > get_top_n(
+PmatchTransducerContainer * epsilon_to_symbol_container(
+    PmatchCompilation & compilation, std::string s);
+PmatchTransducerContainer * make_end_tag(PmatchCompilation & compilation,
+                                         std::string tag);
+PmatchTransducerContainer * make_capture_tag(PmatchCompilation & compilation,
+                                             std::string tag);
+PmatchTransducerContainer * make_captured_tag(PmatchCompilation & compilation,
+                                              std::string tag);
+PmatchObject * make_with_tag_entry(PmatchCompilation & compilation,
+                                   std::string key, std::string value);
+PmatchObject * make_with_tag_exit(PmatchCompilation & compilation,
+                                  std::string key);
+
+std::vector<std::pair<std::string, WordVecFloat> > get_top_n(
     size_t n,
-    const std::vector<WordVector> & vecs,
-    WordVector & comparison_point);
+    const WordVectorMatrix & vecs,
+    const WordVector & comparison_point,
+    bool approximate = false);
 
-std::vector<std::pair<WordVector, WordVecFloat> > get_top_n_transformed(
+std::vector<std::pair<std::string, WordVecFloat> > get_top_n_transformed(
     size_t n,
-    const std::vector<WordVector> & vecs,
+    const WordVectorMatrix & vecs,
     std::vector<WordVecFloat> plane_vec,
     std::vector<WordVecFloat> comparison_point,
     WordVecFloat translation_term,
-    bool negative);
+    bool negative,
+    WordVecFloat projection_factor = 1.0);
 
 template<typename T> std::vector<T> pointwise_minus(std::vector<T> l,
                                                     std::vector<T> r);
@@ -164,32 +191,36 @@ template<typename T> std::vector<T> pointwise_multiplication(T,
                                                              std::vector<T> r);
 template<typename T> T dot_product(std::vector<T> l,
                                    std::vector<T> r);
+WordVecFloat dot_product(const WordVecFloat * l, const WordVecFloat * r,
+                         size_t size);
 template<typename T> T square_sum(std::vector<T> v);
 template<typename T> T norm(std::vector<T> v);
 WordVecFloat cosine_distance(WordVector left, WordVector right);
-PmatchObject * compile_like_arc(std::string word1, std::string word2,
+PmatchObject * compile_like_arc(PmatchCompilation & compilation,
+                                std::string word1, std::string word2,
                                 unsigned int nwords = 10, bool is_negative = false);
-PmatchObject * compile_like_arc(std::string word,
+PmatchObject * compile_like_arc(PmatchCompilation & compilation,
+                                std::string word,
                                 unsigned int nwords = 10);
 
-PmatchTransducerContainer * make_counter(std::string name);
+PmatchTransducerContainer * make_counter(PmatchCompilation & compilation,
+                                         std::string name);
 
 StringSet get_non_special_alphabet(HfstTransducer * t);
-HfstTransducer * make_list(HfstTransducer * t,
-                           ImplementationType f = format);
-HfstTransducer * make_exc_list(HfstTransducer * t,
-                               ImplementationType f = format);
-HfstTransducer * make_sigma(HfstTransducer * t);
-PmatchTransducerContainer * make_minimization_guard();
+HfstTransducer * make_list(HfstTransducer * t, ImplementationType f);
+HfstTransducer * make_exc_list(HfstTransducer * t, ImplementationType f);
+HfstTransducer * make_sigma(HfstTransducer * t, ImplementationType f);
+PmatchTransducerContainer * make_minimization_guard(
+    PmatchCompilation & compilation);
 PmatchTransducerContainer * make_passthrough();
-PmatchTransducerContainer * make_rc_entry();
-PmatchTransducerContainer * make_lc_entry();
-PmatchTransducerContainer * make_nrc_entry();
-PmatchTransducerContainer * make_nlc_entry();
-PmatchTransducerContainer * make_rc_exit();
-PmatchTransducerContainer * make_lc_exit();
-PmatchTransducerContainer * make_nrc_exit();
-PmatchTransducerContainer * make_nlc_exit();
+PmatchTransducerContainer * make_rc_entry(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_lc_entry(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_nrc_entry(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_nlc_entry(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_rc_exit(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_lc_exit(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_nrc_exit(PmatchCompilation & compilation);
+PmatchTransducerContainer * make_nlc_exit(PmatchCompilation & compilation);
 
 /**
  * @brief find first segment from strign @a s delimited by char delim.
@@ -204,15 +235,25 @@ char* parse_quoted(const char *s);
 
 unsigned int next_utf8_to_codepoint(unsigned char **c);
 std::string codepoint_to_utf8(unsigned int codepoint);
-PmatchTransducerContainer * parse_range(const char *s);
+PmatchTransducerContainer * parse_range(PmatchCompilation & compilation,
+                                        const char *s);
 
 int* get_n_to_k(const char* s);
 
 double get_weight(const char* s);
 
-void init_globals();
+string expand_includes(PmatchCompilation & compilation,
+                       const string & script);
 
-string expand_includes(const string & script);
+/**
+ * @brief compile @a pmatch with the settings of @a compilation, which
+ * must not have been used for compiling anything before. What was parsed
+ * stays in @a compilation.
+ */
+std::map<std::string, HfstTransducer*>
+    compile(PmatchCompilation & compilation,
+            const std::string& pmatch,
+            std::map<std::string,hfst::HfstTransducer*>& defs);
 
 /**
  * @brief compile new transducer
@@ -223,9 +264,10 @@ std::map<std::string, HfstTransducer*>
             hfst::ImplementationType type,
             bool be_verbose = false, bool do_flatten = false,
             bool include_cosine_distances = false,
-            std::string includedir = "");
+            std::string includedir = "",
+            std::string cache_directory = "");
 
-void print_size_info(HfstTransducer * net);
+void print_size_info(PmatchCompilation & compilation, HfstTransducer * net);
 
 /**
  * @brief Given a text file, read it line by line and return an acceptor
@@ -242,7 +284,8 @@ HfstTransducer * read_spaced_text(std::string filename,
  * @brief Concatenate include directory with filename to get a real path
  * (unless the filename is already an absolute path)
  */
-std::string path_from_filename(const char * filename);
+std::string path_from_filename(PmatchCompilation & compilation,
+                               const char * filename);
 
 struct WordVector
 {
@@ -251,11 +294,85 @@ struct WordVector
     WordVecFloat norm;
 };
 
+/**
+ * @brief A node of a random projection tree. An inner node splits the
+ * vectors by the hyperplane halfway between the vectors \a a and \a b,
+ * a leaf (a == NO_VECTOR) holds \a right vectors from position \a left
+ * on in WordVectorIndex::leaf_items.
+ */
+struct WordVectorTreeNode
+{
+    static const unsigned int NO_VECTOR = 0xffffffff;
+    unsigned int a;
+    unsigned int b;
+    unsigned int left;
+    unsigned int right;
+};
+
+/**
+ * @brief An approximate nearest neighbour index of a WordVectorMatrix,
+ * a forest of random projection trees. Vectors that fall into the same
+ * leaf as the query in some tree, or a leaf near it, are the candidates
+ * for the nearest neighbours.
+ */
+struct WordVectorIndex
+{
+    std::vector<WordVectorTreeNode> nodes;
+    std::vector<unsigned int> roots;
+    std::vector<unsigned int> leaf_items;
+
+    bool empty() const { return roots.empty(); }
+    void clear();
+    /** Build \a trees trees for \a vecs. */
+    void build(const WordVectorMatrix & vecs, size_t trees);
+    /** Read an index of \a vecs from \a filename, false if there
+        is none or it was made for other vectors. */
+    bool read(const std::string & filename, const WordVectorMatrix & vecs);
+    bool write(const std::string & filename,
+               const WordVectorMatrix & vecs) const;
+    /** The vectors in the leaves nearest to \a query, at least
+        \a search_k of them if there are so many. */
+    std::vector<unsigned int> candidates(const WordVectorMatrix & vecs,
+                                         const WordVecFloat * query,
+                                         size_t search_k) const;
+};
+
+/**
+ * @brief The word vectors read by read_vec. The vectors are scaled to
+ * unit length and stored one after another, so the cosine similarity of
+ * two rows is their dot product.
+ */
+struct WordVectorMatrix
+{
+    std::string filename;
+    size_t dimension;
+    std::vector<std::string> words;
+    std::vector<WordVecFloat> norms;
+    std::vector<WordVecFloat> unit_vectors;
+    WordVectorIndex index;
+
+    WordVectorMatrix(): dimension(0) {}
+    size_t size() const { return words.size(); }
+    const WordVecFloat * row(size_t i) const
+    { return &unit_vectors[i * dimension]; }
+    /** The row \a i at its original length */
+    WordVector get(size_t i) const;
+    /** The row of \a word, size() if there is none */
+    size_t find(const std::string & word) const;
+    void push_back(const std::string & word,
+                   const std::vector<WordVecFloat> & vector);
+    void clear();
+    /** Read the approximate index from the file next to the vector file,
+        named like it with .idx appended, or build it and try to write it
+        there. Like() uses the index if the variable vector-index is on. */
+    void prepare_index(bool verbose = false);
+};
+
 /**
  * @brief Given a list of words and their vector representations, parse it into
- * hfst::pmatch::word_vectors
+ * the word_vectors of @a compilation
  */
-void read_vec(std::string filename);
+void read_vec(PmatchCompilation & compilation, std::string filename);
 
 /**
  * @brief Given a text file, read it line by line and return a tokenized
@@ -355,8 +472,12 @@ template<typename T, size_t N>
 
 struct PmatchUtilityTransducers
 {
-    PmatchUtilityTransducers();
+    PmatchUtilityTransducers(ImplementationType type = TROPICAL_OPENFST_TYPE);
     ~PmatchUtilityTransducers();
+
+    // The type of what is being compiled
+    ImplementationType format;
+
     /**
      * Character class acceptors
      */
@@ -428,24 +549,83 @@ struct PmatchUtilityTransducers
                              bool optional = false );
 };
 
+/**
+ * @brief The state of one pmatch compilation: the settings, what has been
+ * parsed and the scanner of the script. The parser and the objects it
+ * makes keep a reference to it, so scripts can be compiled in different
+ * threads, each with its own PmatchCompilation.
+ */
+struct PmatchCompilation
+{
+    char* data;
+    void * scanner;
+    char* startptr;
+    size_t len;
+    std::map<std::string, PmatchObject*> definitions;
+    std::map<std::string, std::string> variables;
+    std::vector<std::map<std::string, PmatchObject*> > call_stack;
+    std::map<std::string, PmatchObject*> def_insed_expressions;
+    std::set<std::string> inserted_names;
+    std::set<std::string> unsatisfied_insertions;
+    std::set<std::string> used_definitions;
+    std::set<std::string> function_names;
+    std::set<std::string> capture_names;
+    WordVectorMatrix word_vectors;
+    ImplementationType format;
+    bool verbose;
+    bool flatten;
+    bool include_cosine_distances;
+    std::string includedir;
+    clock_t timer;
+    int minimization_guard_count;
+    bool need_delimiters;
+    WordVecFloat vector_similarity_projection_factor;
+    CompilationCache * compilation_cache;
+    // The most threads that harmonize the compiled transducers, by default
+    // one per hardware thread. Zero means one thread.
+    size_t thread_count;
+    size_t input_offset;
+    size_t definition_start;
+    size_t definition_end;
+    bool definition_is_cacheable;
+    std::set<std::string> definition_uses;
+    std::map<std::string, DefinitionSource> definition_sources;
+    // Hashes of the cache keys of definitions, empty for uncacheable ones
+    std::map<std::string, std::string> definition_keys;
+    std::string cache_settings;
+    // Made when first needed, see get_utils()
+    PmatchUtilityTransducers* utils;
+
+    PmatchCompilation(ImplementationType type = TROPICAL_OPENFST_TYPE,
+                      bool be_verbose = false, bool do_flatten = false,
+                      bool do_include_cosine_distances = false,
+                      std::string includedir_ = "",
+                      std::string cache_directory = "");
+    ~PmatchCompilation();
+private:
+    PmatchCompilation(const PmatchCompilation &);
+    PmatchCompilation & operator=(const PmatchCompilation &);
+};
+
 struct PmatchObject {
+    PmatchCompilation & compilation;
     std::string name; // optional, given if the object appears as a definition
     double weight;
     int line_defined;
     clock_t my_timer;
     HfstTransducer * cache;
     bool parent_is_context;
-    PmatchObject();
+    PmatchObject(PmatchCompilation & c);
     virtual ~PmatchObject() throw() = default;
     void start_timing()
         {
-            if (verbose && name != "") {
+            if (compilation.verbose && name != "") {
                 my_timer = clock();
             }
         }
     void report_time()
         {
-            if (verbose && name != "") {
+            if (compilation.verbose && name != "") {
                 double duration = (clock() - my_timer) /
                     (double) CLOCKS_PER_SEC;
                 std::cerr << name << " compiled in " << duration << " seconds\n";
@@ -454,7 +634,7 @@ struct PmatchObject {
         }
     bool should_use_cache()
         {
-            return name != "" && call_stack.size() == 0;
+            return name != "" && compilation.call_stack.size() == 0;
         }
 
     virtual bool is_unweighted_disjunction_of_strings()
@@ -484,7 +664,8 @@ struct PmatchSymbol: public PmatchObject {
     // This handles argumentless function calls and definition invocations,
     // which are the same thing under the hood.
     std::string sym;
-    PmatchSymbol(std::string str): sym(str) { }
+    PmatchSymbol(PmatchCompilation & comp, std::string str):
+        PmatchObject(comp), sym(str) { }
     HfstTransducer * evaluate();
     void collect_strings_into(StringVector & strings);
     PmatchObject * evaluate_as_arg(void);
@@ -494,8 +675,9 @@ struct PmatchSymbol: public PmatchObject {
 struct PmatchString: public PmatchObject {
     std::string string;
     bool multichar;
-    PmatchString(std::string str, bool is_multichar = false):
-        string(str), multichar(is_multichar) { }
+    PmatchString(PmatchCompilation & comp,
+                 std::string str, bool is_multichar = false):
+        PmatchObject(comp), string(str), multichar(is_multichar) { }
     HfstTransducer * evaluate();
     std::string as_string() { return string; }
     StringPair as_string_pair()
@@ -507,6 +689,7 @@ struct PmatchString: public PmatchObject {
 };
 
 struct PmatchQuestionMark: public PmatchObject {
+    PmatchQuestionMark(PmatchCompilation & comp): PmatchObject(comp) { }
     HfstTransducer * evaluate();
     std::string as_string() { return hfst::internal_unknown; }
     StringPair as_string_pair()
@@ -608,8 +791,9 @@ struct PmatchNumericOperation: public PmatchObject{
     PmatchNumericOp op;
     PmatchObject * root;
     std::vector<int> values;
-    PmatchNumericOperation(PmatchNumericOp _op, PmatchObject * _root):
-        op(_op), root(_root) {}
+    PmatchNumericOperation(PmatchCompilation & comp,
+                           PmatchNumericOp _op, PmatchObject * _root):
+        PmatchObject(comp), op(_op), root(_root) {}
     HfstTransducer * evaluate();
     void mark_context_children()
         {
@@ -621,8 +805,9 @@ struct PmatchNumericOperation: public PmatchObject{
 struct PmatchUnaryOperation: public PmatchObject{
     PmatchUnaryOp op;
     PmatchObject * root;
-    PmatchUnaryOperation(PmatchUnaryOp _op, PmatchObject * _root):
-        op(_op), root(_root) {}
+    PmatchUnaryOperation(PmatchCompilation & comp,
+                         PmatchUnaryOp _op, PmatchObject * _root):
+        PmatchObject(comp), op(_op), root(_root) {}
     HfstTransducer * evaluate();
     StringSet get_initial_RC_initial_symbols();
     StringSet get_initial_NRC_initial_symbols();
@@ -640,8 +825,9 @@ struct PmatchBinaryOperation: public PmatchObject{
     PmatchBinaryOp op;
     PmatchObject * left;
     PmatchObject * right;
-    PmatchBinaryOperation(PmatchBinaryOp _op, PmatchObject * _left, PmatchObject * _right):
-        op(_op), left(_left), right(_right) {}
+    PmatchBinaryOperation(PmatchCompilation & comp,
+                          PmatchBinaryOp _op, PmatchObject * _left, PmatchObject * _right):
+        PmatchObject(comp), op(_op), left(_left), right(_right) {}
     HfstTransducer * evaluate();
     StringPair as_string_pair();
     bool is_unweighted_disjunction_of_strings();
@@ -663,8 +849,9 @@ struct PmatchTernaryOperation: public PmatchObject{
     PmatchObject * left;
     PmatchObject * middle;
     PmatchObject * right;
-    PmatchTernaryOperation(PmatchTernaryOp _op, PmatchObject * _left, PmatchObject * _middle, PmatchObject * _right):
-        op(_op), left(_left), middle(_middle), right(_right) {}
+    PmatchTernaryOperation(PmatchCompilation & comp,
+                           PmatchTernaryOp _op, PmatchObject * _left, PmatchObject * _middle, PmatchObject * _right):
+        PmatchObject(comp), op(_op), left(_left), middle(_middle), right(_right) {}
     HfstTransducer * evaluate();
     void mark_context_children()
         {
@@ -677,12 +864,13 @@ struct PmatchTernaryOperation: public PmatchObject{
 
 struct PmatchTransducerContainer: public PmatchObject{
     HfstTransducer * t;
-    PmatchTransducerContainer(HfstTransducer * target):
-        t(target) {}
+    PmatchTransducerContainer(PmatchCompilation & comp,
+                              HfstTransducer * target):
+        PmatchObject(comp), t(target) {}
     ~PmatchTransducerContainer() throw() { delete t; }
     HfstTransducer * evaluate() {
-        if (t->get_type() != format) {
-            t->convert(format);
+        if (t->get_type() != compilation.format) {
+            t->convert(compilation.format);
         }
         HfstTransducer * retval = new HfstTransducer(*t);
         retval->set_final_weights(hfst::double_to_float(weight), true);
@@ -697,9 +885,10 @@ struct PmatchFunction: public PmatchObject {
     std::vector<std::string> args;
     PmatchObject * root;
 
-    PmatchFunction(std::vector<std::string> argument_vector,
+    PmatchFunction(PmatchCompilation & comp,
+                   std::vector<std::string> argument_vector,
                    PmatchObject * function_root):
-    args(argument_vector), root(function_root) { }
+    PmatchObject(comp), args(argument_vector), root(function_root) { }
 
     HfstTransducer * evaluate(std::vector<PmatchObject *> funargs);
     HfstTransducer * evaluate();
@@ -709,8 +898,9 @@ struct PmatchFunction: public PmatchObject {
 struct PmatchFuncall: public PmatchObject {
     std::vector<PmatchObject * >* args;
     PmatchFunction * fun;
-    PmatchFuncall(std::vector<PmatchObject *>* argument_vector,
-                  PmatchFunction * function): args(argument_vector),
+    PmatchFuncall(PmatchCompilation & comp,
+                  std::vector<PmatchObject *>* argument_vector,
+                  PmatchFunction * function): PmatchObject(comp), args(argument_vector),
                                               fun(function) { }
     HfstTransducer * evaluate();
     void mark_context_children()
@@ -726,9 +916,9 @@ struct PmatchFuncall: public PmatchObject {
 struct PmatchBuiltinFunction: public PmatchObject {
     std::vector<PmatchObject *>* args;
     PmatchBuiltin type;
-    PmatchBuiltinFunction(PmatchBuiltin _type,
+    PmatchBuiltinFunction(PmatchCompilation & comp, PmatchBuiltin _type,
                           std::vector<PmatchObject*>* argument_vector):
-    args(argument_vector), type(_type) {}
+    PmatchObject(comp), args(argument_vector), type(_type) {}
     HfstTransducer * evaluate();
     void mark_context_children()
         {
@@ -765,8 +955,9 @@ struct PmatchRestrictionContainer: public PmatchObject
 {
     PmatchObject * left;
     MappingPairVector * contexts;
-    PmatchRestrictionContainer(PmatchObject * l, MappingPairVector * c):
-        left(l), contexts(c) { }
+    PmatchRestrictionContainer(PmatchCompilation & comp,
+                               PmatchObject * l, MappingPairVector * c):
+        PmatchObject(comp), left(l), contexts(c) { }
     HfstTransducer * evaluate();
     void mark_context_children()
         {
@@ -788,14 +979,15 @@ struct PmatchMappingPairsContainer: public PmatchObject
 {
     ReplaceArrow arrow;
     MappingPairVector mapping_pairs;
-    PmatchMappingPairsContainer(ReplaceArrow a, MappingPairVector pairs):
-        arrow(a), mapping_pairs(pairs) {}
-    PmatchMappingPairsContainer(ReplaceArrow a,
+    PmatchMappingPairsContainer(PmatchCompilation & comp,
+                                ReplaceArrow a, MappingPairVector pairs):
+        PmatchObject(comp), arrow(a), mapping_pairs(pairs) {}
+    PmatchMappingPairsContainer(PmatchCompilation & comp, ReplaceArrow a,
                                 PmatchObject * left, PmatchObject * right):
-        arrow(a) { mapping_pairs.push_back(new PmatchObjectPair(left, right)); }
-    PmatchMappingPairsContainer(ReplaceArrow a,
+        PmatchObject(comp), arrow(a) { mapping_pairs.push_back(new PmatchObjectPair(left, right)); }
+    PmatchMappingPairsContainer(PmatchCompilation & comp, ReplaceArrow a,
                                 PmatchObjectPair * pair):
-        arrow(a) { mapping_pairs.push_back(pair); }
+        PmatchObject(comp), arrow(a) { mapping_pairs.push_back(pair); }
     void push_back(PmatchMappingPairsContainer * one_pair)
         {
             for(MappingPairVector::iterator it = one_pair->mapping_pairs.begin();
@@ -811,14 +1003,19 @@ struct PmatchContextsContainer: public PmatchObject
 {
     ReplaceType type;
     MappingPairVector context_pairs;
-    PmatchContextsContainer(ReplaceType t, MappingPairVector pairs):
-        type(t), context_pairs(pairs) {}
-    PmatchContextsContainer(ReplaceType t, PmatchContextsContainer * context):
-        type(t), context_pairs(context->context_pairs)
+    PmatchContextsContainer(PmatchCompilation & comp,
+                            ReplaceType t, MappingPairVector pairs):
+        PmatchObject(comp), type(t), context_pairs(pairs) {}
+    PmatchContextsContainer(PmatchCompilation & comp,
+                            ReplaceType t, PmatchContextsContainer * context):
+        PmatchObject(comp), type(t), context_pairs(context->context_pairs)
         { /* check for type compatibility */ }
-    PmatchContextsContainer(PmatchContextsContainer * context):
-        type(context->type), context_pairs(context->context_pairs) {}
-    PmatchContextsContainer(PmatchObject * left, PmatchObject * right)
+    PmatchContextsContainer(PmatchCompilation & comp,
+                            PmatchContextsContainer * context):
+        PmatchObject(comp), type(context->type), context_pairs(context->context_pairs) {}
+    PmatchContextsContainer(PmatchCompilation & comp,
+                            PmatchObject * left, PmatchObject * right):
+        PmatchObject(comp)
         { context_pairs.push_back(new PmatchObjectPair(left, right)); }
     void push_back(PmatchContextsContainer * one_context)
         {
@@ -838,16 +1035,19 @@ struct PmatchReplaceRuleContainer: public PmatchObject
     MappingPairVector mapping;
     MappingPairVector context;
     PmatchReplaceRuleContainer(
+        PmatchCompilation & comp,
         ReplaceArrow a,
         ReplaceType t,
         MappingPairVector m,
         MappingPairVector c):
-        arrow(a), type(t), mapping(m), context(c) {}
-    PmatchReplaceRuleContainer(PmatchMappingPairsContainer * pairs):
-        arrow(pairs->arrow), mapping(pairs->mapping_pairs) {}
-    PmatchReplaceRuleContainer(PmatchMappingPairsContainer * pairs,
+        PmatchObject(comp), arrow(a), type(t), mapping(m), context(c) {}
+    PmatchReplaceRuleContainer(PmatchCompilation & comp,
+                               PmatchMappingPairsContainer * pairs):
+        PmatchObject(comp), arrow(pairs->arrow), mapping(pairs->mapping_pairs) {}
+    PmatchReplaceRuleContainer(PmatchCompilation & comp,
+                               PmatchMappingPairsContainer * pairs,
                                PmatchContextsContainer * contexts):
-        arrow(pairs->arrow), type(contexts->type),
+        PmatchObject(comp), arrow(pairs->arrow), type(contexts->type),
           mapping(pairs->mapping_pairs), context(contexts->context_pairs) {}
     hfst::xeroxRules::Rule make_mapping();
     HfstTransducer * evaluate();
@@ -857,29 +1057,34 @@ struct PmatchParallelRulesContainer: public PmatchObject
 {
     ReplaceArrow arrow;
     std::vector<PmatchReplaceRuleContainer *> rules;
-    PmatchParallelRulesContainer(PmatchReplaceRuleContainer * rule):
-        arrow(rule->arrow), rules(1, rule) {}
+    PmatchParallelRulesContainer(PmatchCompilation & comp,
+                                 PmatchReplaceRuleContainer * rule):
+        PmatchObject(comp), arrow(rule->arrow), rules(1, rule) {}
     std::vector<hfst::xeroxRules::Rule> make_mappings();
     HfstTransducer * evaluate();
 };
 
 struct PmatchEpsilonArc: public PmatchObject
 {
+    PmatchEpsilonArc(PmatchCompilation & comp): PmatchObject(comp) { }
     HfstTransducer * evaluate()
-        { return new HfstTransducer(hfst::internal_epsilon, format); }
+        { return new HfstTransducer(hfst::internal_epsilon,
+                                    compilation.format); }
     std::string as_string() { return hfst::internal_epsilon; }
 };
 
 struct PmatchEmpty: public PmatchObject
 {
+    PmatchEmpty(PmatchCompilation & comp): PmatchObject(comp) { }
     HfstTransducer * evaluate()
-        { return new HfstTransducer(format); }
+        { return new HfstTransducer(compilation.format); }
 };
 
 struct PmatchAcceptor: public PmatchObject
 {
     PmatchPredefined set;
-    PmatchAcceptor(PmatchPredefined s): set(s) {}
+    PmatchAcceptor(PmatchCompilation & comp,
+                   PmatchPredefined s): PmatchObject(comp), set(s) {}
     HfstTransducer * evaluate();
 };
 
@@ -141,6 +141,9 @@ class OtherSymbolTransducer
   //! @brief Set the type of transducer to be used
   static void set_transducer_type(ImplementationType transducer_type);
 
+  //! @brief Get the type of transducer in use.
+  static ImplementationType get_transducer_type(void);
+
   //! @brief Construct empty transducer.
   OtherSymbolTransducer(void);
 
@@ -154,6 +157,11 @@ class OtherSymbolTransducer
   //! @brief Copy constructor.
   OtherSymbolTransducer(const OtherSymbolTransducer &another);
 
+  //! @brief Replace the transducer of @a this with an equal one, which
+  //! shares no data with the copies of @a this. Copies share data that
+  //! may not be used in different threads at the same time.
+  OtherSymbolTransducer &detach(void);
+
   //! @brief Set @a this equal to @another.
   OtherSymbolTransducer &operator=(const OtherSymbolTransducer &another);
 
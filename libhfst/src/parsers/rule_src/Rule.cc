@@ -82,6 +82,13 @@ bool Rule::empty(void) const
 OtherSymbolTransducer Rule::compile(void)
 { return OtherSymbolTransducer(); }
 
+void Rule::detach(void)
+{
+  center.detach();
+  context.detach();
+  rule_transducer.detach();
+}
+
 void Rule::store(HfstOutputStream &out)
 {
   if (is_empty)
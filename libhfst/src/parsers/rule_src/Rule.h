@@ -65,6 +65,10 @@ class Rule
   //! @brief Compile @a this.
   virtual OtherSymbolTransducer compile(void);
 
+  //! @brief Detach the transducers of @a this from their copies in other
+  //! rules, so that @a this can be compiled in another thread.
+  void detach(void);
+
   //! @brief Store this transducer in @a out.
   void store(HfstOutputStream &out);
 
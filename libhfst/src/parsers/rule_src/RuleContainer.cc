@@ -16,7 +16,12 @@
 //  You should have received a copy of the GNU Lesser General Public License
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <thread>
+#include <string>
+#include <algorithm>
+
 #include "RuleContainer.h"
+#include "thread-utils.h"
 
 RuleContainer::RuleContainer(void):
   report(true)
@@ -35,15 +40,26 @@ void RuleContainer::add_rule(Rule * rule)
 
 void RuleContainer::compile(std::ostream &msg_out,bool be_verbose)
 {
-  for (RuleVector::iterator it = rule_vector.begin();
+  size_t threads = get_thread_count(rule_vector.size());
+  // Rules may share transducers with each other, e.g. contexts.
+  if (threads > 1)
+    {
+      for (RuleVector::iterator it = rule_vector.begin();
        it != rule_vector.end();
        ++it)
+    { (*it)->detach(); }
+    }
+
+  if (be_verbose)
     {
-      if (be_verbose)
+      for (RuleVector::iterator it = rule_vector.begin();
+       it != rule_vector.end();
+       ++it)
     { msg_out << "Compiling " << Rule::get_print_name((*it)->get_name())
           << std::endl; }
-      (*it)->compile();
     }
+  hfst::run_in_threads(rule_vector.size(),threads,[&](size_t i)
+    { rule_vector[i]->compile(); });
 }
 
 void RuleContainer::store
@@ -68,6 +84,25 @@ void RuleContainer::add_missing_symbols_freely(const SymbolRange &diacritics)
     { (*it)->add_missing_symbols_freely(diacritics); }
 }
 
+size_t RuleContainer::max_thread_count = 0;
+
+void RuleContainer::set_thread_count(size_t count)
+{ max_thread_count = count; }
+
+// The OpenFst operations used in compiling rules don't share anything between
+// different transducers that aren't copies of each other, but the other
+// backends keep global state.
+size_t RuleContainer::get_thread_count(size_t job_count)
+{
+  ImplementationType type = OtherSymbolTransducer::get_transducer_type();
+  if (type != hfst::TROPICAL_OPENFST_TYPE && type != hfst::LOG_OPENFST_TYPE)
+    { return 1; }
+  size_t threads = max_thread_count;
+  if (threads == 0)
+    { threads = std::max(1u,std::thread::hardware_concurrency()); }
+  return std::max<size_t>(1,std::min(threads,job_count));
+}
+
 #ifdef TEST_RULE_CONTAINER
 #include <cassert>
 int main(void)
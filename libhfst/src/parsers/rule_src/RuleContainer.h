@@ -41,6 +41,18 @@ class RuleContainer
   void compile(std::ostream &msg_out,bool be_verbose);
   void store(HfstOutputStream &out,std::ostream &msg_out,bool be_verbose);
   void add_missing_symbols_freely(const SymbolRange &diacritics);
+
+  //! @brief Return the number of threads to run @a job_count independent
+  //! jobs in with hfst::run_in_threads. Jobs that share transducers have to
+  //! be detached from each other first, when this is more than one.
+  static size_t get_thread_count(size_t job_count);
+
+  //! @brief Use at most @a count threads in compiling rules. Zero, the
+  //! default, means one thread per hardware thread.
+  static void set_thread_count(size_t count);
+
+ private:
+  static size_t max_thread_count;
 };
 
 #endif // RULE_CONTAINER_H_
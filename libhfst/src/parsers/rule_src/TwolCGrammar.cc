@@ -15,6 +15,7 @@
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "TwolCGrammar.h"
+#include "thread-utils.h"
 
 std::string TwolCGrammar::get_original_name(const std::string &name)
 { return name.substr(0,name.find("SUBCASE:")); }
@@ -182,12 +183,48 @@ void TwolCGrammar::compile_and_store(HfstOutputStream &out)
   right_arrow_rule_container.compile(std::cerr,(! be_quiet) && be_verbose);
   other_rule_container.compile(std::cerr,(! be_quiet) && be_verbose);
 
+  std::vector<StringRuleSetMap::const_iterator> subcases;
   for (StringRuleSetMap::const_iterator it = name_to_rule_subcases.begin();
        it != name_to_rule_subcases.end();
        ++it)
-    { compiled_rule_container.add_rule
-    (new Rule(it->first,Rule::RuleVector(it->second.begin(),
-                         it->second.end()))); }
+    { subcases.push_back(it); }
+
+  // Intersecting the subcases of one rule doesn't touch the other rules,
+  // once they share no transducers with each other.
+  size_t threads = RuleContainer::get_thread_count(subcases.size());
+  if (threads > 1)
+    {
+      for (size_t i = 0; i < subcases.size(); ++i)
+    {
+      for (RuleSet::const_iterator it = subcases[i]->second.begin();
+           it != subcases[i]->second.end();
+           ++it)
+        { (*it)->detach(); }
+    }
+    }
+  Rule::RuleVector compiled_rules(subcases.size(),NULL);
+  try
+    {
+      hfst::run_in_threads(subcases.size(),threads,[&](size_t i)
+        {
+          compiled_rules[i] =
+        new Rule(subcases[i]->first,
+             Rule::RuleVector(subcases[i]->second.begin(),
+                      subcases[i]->second.end()));
+        });
+    }
+  catch (...)
+    {
+      for (Rule::RuleVector::iterator it = compiled_rules.begin();
+       it != compiled_rules.end();
+       ++it)
+    { delete *it; }
+      throw;
+    }
+  for (Rule::RuleVector::const_iterator it = compiled_rules.begin();
+       it != compiled_rules.end();
+       ++it)
+    { compiled_rule_container.add_rule(*it); }
   compiled_rule_container.add_missing_symbols_freely(diacritics);
 
   if (! be_quiet)
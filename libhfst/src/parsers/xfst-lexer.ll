@@ -1,4 +1,4 @@
-%option 8Bit batch noyywrap prefix="hxfst"
+%option 8Bit batch noyywrap reentrant bison-bridge extra-type="hfst::xfst::XfstScannerState *" prefix="hxfst"
 
 %{
 // Copyright (c) 2016 University of Helsinki
@@ -24,20 +24,21 @@ namespace hfst {
   class HfstTransducer;
 }
 
-#include "xfst-parser.hh"
 #include "xfst-utils.h"
 #include "XfstCompiler.h"
+#include "xfst-parser.hh"
 
 #include <assert.h>
 
 #include "HfstDataTypes.h"
 
-extern void hxfsterror(const char *text);
+extern void hxfsterror(hfst::xfst::XfstCompiler & xfst, const char *text);
 
 #undef YY_FATAL_ERROR
-#define YY_FATAL_ERROR(msg) hxfsterror(msg)
+#define YY_FATAL_ERROR(msg) hxfsterror(hxfstget_extra(yyscanner)->compiler, msg)
 
-int source_stack_size = 0;
+// The number of files being sourced is kept in the scanner
+#define source_stack_size yyextra->source_stack_size
 
 %}
 
@@ -101,7 +102,7 @@ LWSP [\t ]*
 }
 
 ^{LWSP}("apply up"|"up"){LWSP}(""|"\r")$ {
-    if (hfst::xfst::xfst_->getReadInteractiveTextFromStdin())
+    if (yyextra->compiler.getReadInteractiveTextFromStdin())
     {
         // let XfstCompiler take care of the input to apply up command
         return APPLY_UP;
@@ -115,17 +116,17 @@ LWSP [\t ]*
 }
 
 ^{LWSP}("apply up"){WSP}.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("apply up "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("apply up "));
     return APPLY_UP_SINGLE;
 }
 
 ^{LWSP}("up"){WSP}.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("up "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("up "));
     return APPLY_UP_SINGLE;
 }
 
 ^{LWSP}("apply down"|"down"){LWSP}(""|"\r")$ {
-    if (hfst::xfst::xfst_->getReadInteractiveTextFromStdin())
+    if (yyextra->compiler.getReadInteractiveTextFromStdin())
     {
         // let XfstCompiler take care of the input to apply down command
         return APPLY_DOWN;
@@ -139,12 +140,12 @@ LWSP [\t ]*
 }
 
 ^{LWSP}("apply down"){WSP}.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("apply down "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("apply down "));
     return APPLY_DOWN_SINGLE;
 }
 
 ^{LWSP}("down"){WSP}.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("down "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("down "));
     return APPLY_DOWN_SINGLE;
 }
 
@@ -161,12 +162,12 @@ LWSP [\t ]*
 }
 
 ^{LWSP}"apropos"{WSP}+.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("apropos "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("apropos "));
     return APROPOS;
 }
 
 ^{LWSP}"apropos"{WSP}* {
-    hxfstlval.text = strdup("");
+    yylval->text = strdup("");
     return APROPOS;
 }
 
@@ -226,25 +227,25 @@ LWSP [\t ]*
 "define"{WSP}+{NAMETOKEN}{LWSP}";" {
     char * dup = strdup(yytext);
     dup[strlen(dup)-1] = ' '; // get rid of the ';'
-    hxfstlval.name = hfst::xfst::strstrip(dup+strlen("define "));
+    yylval->name = hfst::xfst::strstrip(dup+strlen("define "));
     free(dup);
     return DEFINE_NAME;
 }
 
 "define"{WSP}+{NAMETOKEN}{LWSP}(""|"\r")$ {
-    hxfstlval.name = hfst::xfst::strstrip(yytext+strlen("define "));
+    yylval->name = hfst::xfst::strstrip(yytext+strlen("define "));
     return DEFINE_NAME;
 }
 
 "define"{WSP}+{NAMETOKEN}{PROTOTYPE} {
     BEGIN(REGEX_STATE);
-    hxfstlval.name = hfst::xfst::strstrip(yytext+strlen("define "));
+    yylval->name = hfst::xfst::strstrip(yytext+strlen("define "));
     return DEFINE_FUNCTION;
 }
 
 "define"{WSP}+{NAMETOKEN} {
     BEGIN(REGEX_STATE);
-    hxfstlval.name = hfst::xfst::strstrip(yytext+strlen("define "));
+    yylval->name = hfst::xfst::strstrip(yytext+strlen("define "));
     return DEFINE_NAME;
 }
 
@@ -253,12 +254,12 @@ LWSP [\t ]*
 }
 
 "echo"{WSP}+.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("echo "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("echo "));
     return ECHO_;
 }
 
 ^{LWSP}"echo"{WSP}* {
-    hxfstlval.text = strdup("");
+    yylval->text = strdup("");
     return ECHO_;
 }
 
@@ -287,17 +288,17 @@ LWSP [\t ]*
 }
 
 "help"{WSP}+.* {
-    hxfstlval.text = hfst::xfst::strstrip(hxfsttext + strlen("help "));
+    yylval->text = hfst::xfst::strstrip(yytext + strlen("help "));
     return DESCRIBE;
 }
 
 ^{LWSP}("help"|"apropos"){WSP}* {
-    hxfstlval.text = strdup("");
+    yylval->text = strdup("");
     return DESCRIBE;
 }
 
 "hfst"{WSP}*.*$ {
-    hxfstlval.text = strdup(hxfsttext);
+    yylval->text = strdup(yytext);
     return HFST;
 }
 
@@ -475,7 +476,7 @@ LWSP [\t ]*
 }
 
 ^{LWSP}("quit"|"exit"|"bye"|"stop"|"hyvästi"|"au revoir"|"näkemiin"|"viszlát"|"auf wiedersehen"|"has") {
-    hxfstlval.name = strdup("");
+    yylval->name = strdup("");
     return QUIT;
 }
 
@@ -569,7 +570,7 @@ LWSP [\t ]*
 }
 
 "system"{WSP}+.*$ {
-    hxfstlval.text = strdup(yytext+7);
+    yylval->text = strdup(yytext+7);
     return SYSTEM;
 }
 
@@ -661,34 +662,34 @@ LWSP [\t ]*
     BEGIN(0);
 
     // search for a special end string
-    std::string str(hxfsttext);
+    std::string str(yytext);
     std::size_t end_found = str.find("<ctrl-d>");
 
     // CASE 1: no end string found: the rest is input to apply
     if (end_found == std::string::npos) {
-        hxfstlval.text = strdup(hxfsttext);
+        yylval->text = strdup(yytext);
         return APPLY_INPUT;
     }
 
     // CASE 2: there are other commands after the input to apply
-    unsigned int total_length = (unsigned int)strlen(hxfsttext);
+    unsigned int total_length = (unsigned int)strlen(yytext);
     unsigned int endpos = (unsigned int)end_found;
 
     // copy the input to apply and set is as return value
     char * buf = (char*) malloc(endpos + 1);
     for (unsigned int i=0; i < endpos; i++)
     {
-      buf[i] = hxfsttext[i];
+      buf[i] = yytext[i];
     }
     buf[endpos] = '\0';
-    hxfstlval.text = strdup(buf);
+    yylval->text = strdup(buf);
     free(buf);
 
     // put back the rest of the input text, excluding the "<ctrl-d>"
     if (total_length > 0)
     {
-      // unput modifies hxfsttext, so it must be copied before unputting
-      char * text_read = strdup(hxfsttext);
+      // unput modifies yytext, so it must be copied before unputting
+      char * text_read = strdup(yytext);
       // unputting must be done in reverse order
       for(unsigned int i=total_length-1;
           i >= (endpos + (unsigned int)strlen("<ctrl-d>"));
@@ -709,28 +710,28 @@ LWSP [\t ]*
     BEGIN(0);
 
     unsigned int chars_read = 0;
-    unsigned int total_length = (unsigned int)strlen(hxfsttext);
+    unsigned int total_length = (unsigned int)strlen(yytext);
 
     // compile regex to find out where it ends
     // as a positive side effect, the regex is also conveniently compiled
     // into a transducer which is stored in XfstCompiler::latest_regex_compiled
-    (void) hfst::xfst::xfst_->compile_regex(hxfsttext, chars_read);
+    (void) yyextra->compiler.compile_regex(yytext, chars_read);
 
     // copy the input to regex and set is as return value
     char * buf = (char*) malloc(chars_read+1);
     for (unsigned int i=0; i < chars_read; i++)
     {
-      buf[i] = hxfsttext[i];
+      buf[i] = yytext[i];
     }
     buf[chars_read] = '\0';
-    hxfstlval.text = strdup(buf);
+    yylval->text = strdup(buf);
     free(buf);
 
     // put back the rest of the input text
     if (total_length > 0)
     {
-      // unput modifies hxfsttext, so it must be copied before unputting
-      char * text_read = strdup(hxfsttext);
+      // unput modifies yytext, so it must be copied before unputting
+      char * text_read = strdup(yytext);
       // unputting must be done in reverse order
       for(unsigned int i=total_length-1; i >= chars_read; i--)
       {
@@ -746,36 +747,36 @@ LWSP [\t ]*
   // ^ include directive
 
   FILE * tmp = NULL;
-  if ((tmp = hfst::hfst_fopen(hfst::xfst::strstrip(hxfsttext), "r" )) != NULL)
+  if ((tmp = hfst::hfst_fopen(hfst::xfst::strstrip(yytext), "r" )) != NULL)
   {
-    //printf("Opening file '%s'.\n", hfst::xfst::strstrip(hxfsttext));
+    //printf("Opening file '%s'.\n", hfst::xfst::strstrip(yytext));
     // push the included text onto the lexer stack
-    hxfstpush_buffer_state(hxfst_create_buffer(tmp, 32000));
+    hxfstpush_buffer_state(hxfst_create_buffer(tmp, 32000, yyscanner), yyscanner);
     ++source_stack_size;
   }
   else
   {
     char buffer [1024];
-    sprintf(buffer, "Error opening file '%s'\n",hfst::xfst::strstrip(hxfsttext));
-    hxfsterror(buffer);
+    sprintf(buffer, "Error opening file '%s'\n",hfst::xfst::strstrip(yytext));
+    hxfsterror(yyextra->compiler, buffer);
   }
   BEGIN(INITIAL);
 }
 
 ">"{WSP}*{NAMETOKEN} {
-    hxfstlval.file = hfst::xfst::strstrip(hxfsttext+1);
+    yylval->file = hfst::xfst::strstrip(yytext+1);
     return REDIRECT_OUT;
 }
 "<"{WSP}*{NAMETOKEN} {
-    hxfstlval.file = hfst::xfst::strstrip(hxfsttext+1);
+    yylval->file = hfst::xfst::strstrip(yytext+1);
     return REDIRECT_IN;
 }
 
 {RANGE} {
-    char* range = hfst::xfst::strstrip(hxfsttext);
+    char* range = hfst::xfst::strstrip(yytext);
     char* s = range;
-    hxfstlval.list = static_cast<char**>(malloc(sizeof(char*)*2));
-    char* p = hxfstlval.list[0];
+    yylval->list = static_cast<char**>(malloc(sizeof(char*)*2));
+    char* p = yylval->list[0];
     while (*s != '-')
     {
         *p = *s;
@@ -783,7 +784,7 @@ LWSP [\t ]*
         s++;
     }
     *p = '\0';
-    p = hxfstlval.list[1];
+    p = yylval->list[1];
     s++;
     while (*s != '\0')
     {
@@ -797,7 +798,7 @@ LWSP [\t ]*
 }
 
 "("[a-zA-Z_0-9 ,]*")" {
-    hxfstlval.name = strdup(hxfsttext);
+    yylval->name = strdup(yytext);
     return PROTOTYPE;
 }
 
@@ -814,7 +815,7 @@ LWSP [\t ]*
     return END_SUB;
 }
 {NAMETOKEN} {
-    hxfstlval.name = strdup(hxfsttext);
+    yylval->name = strdup(yytext);
     return NAMETOKEN;
 }
 
@@ -839,17 +840,17 @@ LWSP [\t ]*
     }
     // EOF encountered because reaching end of included input
     else {
-      hxfstpop_buffer_state();
+      hxfstpop_buffer_state(yyscanner);
     }
 }
 
 [\x80-\xff] {
-    hxfsterror("Illegal 8-bit sequence (cannot form valid UTF-8)");
+    hxfsterror(yyextra->compiler, "Illegal 8-bit sequence (cannot form valid UTF-8)");
     return XFST_ERROR;
 }
 
 . {
-    hxfsterror("Syntax error in lexer (no valid token found at the point)");
+    hxfsterror(yyextra->compiler, "Syntax error in lexer (no valid token found at the point)");
     return XFST_ERROR;
 }
 
@@ -31,21 +31,26 @@ namespace hfst {
 #include "XfstCompiler.h"
 #include "xfst-utils.h"
 
-#define CHECK if (hfst::xfst::xfst_->get_fail_flag()) { YYABORT; }
+#define CHECK if (xfst.get_fail_flag()) { YYABORT; }
 
 // obligatory yacc stuff
-extern int hxfstlineno;
-void hxfsterror(const char *text);
-int hxfstlex(void);
+union YYSTYPE;
+typedef void * yyscan_t;
+void hxfsterror(yyscan_t, hfst::xfst::XfstCompiler & xfst, const char *text);
+void hxfsterror(hfst::xfst::XfstCompiler & xfst, const char *text);
+int hxfstlex(YYSTYPE *, yyscan_t);
 
 %}
 
 // ouch
 %name-prefix="hxfst"
+// reentrant, the state is in the scanner and the compiler
+%define api.pure
+%lex-param {void * scanner}
+%parse-param {void * scanner}
+%parse-param {hfst::xfst::XfstCompiler & xfst}
 // yup, nice messages
 %error-verbose
-// just cos I use the llloc struct
-%locations
 
 %union
 {
@@ -105,372 +110,372 @@ COMMAND_LIST: COMMAND_LIST COMMAND
             ;
 
 COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->add_props(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.add_props(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | ADD_PROPS NAMETOKEN_LIST CTRLD {
-            hfst::xfst::xfst_->add_props($2);
+            xfst.add_props($2);
             free($2); CHECK;
        }
        | EDIT_PROPS END_COMMAND {
-            hxfsterror("NETWORK PROPERTY EDITOR unimplemented\n");
+            hxfsterror(xfst, "NETWORK PROPERTY EDITOR unimplemented\n");
             return EXIT_FAILURE;
        }
        // apply
        | APPLY_UP END_COMMAND {
-       	    hfst::xfst::xfst_->apply_up(stdin); CHECK;
+       	    xfst.apply_up(stdin); CHECK;
        }
        | APPLY_UP APPLY_INPUT END_COMMAND {
-       	    hfst::xfst::xfst_->apply_up($2); CHECK; free($2);
+       	    xfst.apply_up($2); CHECK; free($2);
        }
        | APPLY_UP_SINGLE END_COMMAND {
-            hfst::xfst::xfst_->apply_up($1);
+            xfst.apply_up($1);
             free($1); CHECK;
        }
        | APPLY_UP REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->apply_up(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.apply_up(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | APPLY_UP END_COMMAND NAMETOKEN_LIST END_SUB {
-            hfst::xfst::xfst_->apply_up($3);
+            xfst.apply_up($3);
             free($3); CHECK;
        }
        | APPLY_DOWN END_COMMAND {
-            hfst::xfst::xfst_->apply_down(stdin); CHECK;
+            xfst.apply_down(stdin); CHECK;
        }
        | APPLY_DOWN APPLY_INPUT END_COMMAND {
-       	    hfst::xfst::xfst_->apply_down($2); CHECK; free($2);
+       	    xfst.apply_down($2); CHECK; free($2);
        }
        | APPLY_DOWN_SINGLE END_COMMAND {
-            hfst::xfst::xfst_->apply_down($1);
+            xfst.apply_down($1);
             free($1); CHECK;
        }
        | APPLY_DOWN REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->apply_down(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.apply_down(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | APPLY_DOWN END_COMMAND NAMETOKEN_LIST END_SUB {
-            hfst::xfst::xfst_->apply_down($3);
+            xfst.apply_down($3);
             free($3); CHECK;
        }
        | APPLY_MED NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->apply_med($2);
+            xfst.apply_med($2);
             free($2); CHECK;
        }
        | APPLY_MED REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->apply_med(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.apply_med(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | APPLY_MED END_COMMAND NAMETOKEN_LIST END_SUB {
-            hfst::xfst::xfst_->apply_med($3);
+            xfst.apply_med($3);
             free($3); CHECK;
        }
        | LOOKUP_OPTIMIZE END_COMMAND {
-            hfst::xfst::xfst_->lookup_optimize(); CHECK;
+            xfst.lookup_optimize(); CHECK;
        }
        | REMOVE_OPTIMIZATION END_COMMAND {
-            hfst::xfst::xfst_->remove_optimization(); CHECK;
+            xfst.remove_optimization(); CHECK;
        }
        // ambiguous
        | AMBIGUOUS END_COMMAND {
-            hxfsterror("unimplemetend ambiguous\n");
+            hxfsterror(xfst, "unimplemetend ambiguous\n");
             return EXIT_FAILURE;
        }
        | EXTRACT_AMBIGUOUS END_COMMAND {
-            hxfsterror("unimplemetend ambiguous\n");
+            hxfsterror(xfst, "unimplemetend ambiguous\n");
             return EXIT_FAILURE;
        }
        | EXTRACT_UNAMBIGUOUS END_COMMAND {
-            hxfsterror("unimplemetend ambiguous\n");
+            hxfsterror(xfst, "unimplemetend ambiguous\n");
             return EXIT_FAILURE;
        }
        // define
        | DEFINE_ALIAS NAMETOKEN COMMAND_SEQUENCE END_COMMAND{
-            hfst::xfst::xfst_->define_alias($2, $3);
+            xfst.define_alias($2, $3);
             free($2);
             free($3); CHECK;
        }
        | DEFINE_ALIAS NAMETOKEN END_COMMAND NAMETOKEN_LIST END_SUB {
-            hfst::xfst::xfst_->define_alias($2, $4);
+            xfst.define_alias($2, $4);
             free($2);
             free($4); CHECK;
        }
        | LIST NAMETOKEN NAMETOKEN_LIST SEMICOLON END_COMMAND {
-            hfst::xfst::xfst_->define_list($2, $3);
+            xfst.define_list($2, $3);
             free($2);
             free($3); CHECK;
        }
        | LIST NAMETOKEN RANGE END_COMMAND {
-            hfst::xfst::xfst_->define_list($2, $3[0], $3[1]);
+            xfst.define_list($2, $3[0], $3[1]);
             free($2);
             free($3[0]);
             free($3[1]);
             free($3); CHECK;
        }
        | DEFINE_NAME {
-            hfst::xfst::xfst_->define($1);
+            xfst.define($1);
             free($1); CHECK;
        }
        | DEFINE_NAME REGEX {
-            hfst::xfst::xfst_->define($1, $2);
+            xfst.define($1, $2);
             free($1);
             free($2); CHECK;
        }
        | DEFINE_FUNCTION REGEX {
-            hfst::xfst::xfst_->define_function($1, $2);
+            xfst.define_function($1, $2);
             free($1);
             free($2); CHECK;
        }
        | UNDEFINE NAMETOKEN_LIST END_COMMAND {
-            hfst::xfst::xfst_->undefine($2);
+            xfst.undefine($2);
             free($2); CHECK;
        }
        | UNLIST NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->unlist($2);
+            xfst.unlist($2);
             free($2); CHECK;
        }
        | NAME NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->name_net($2);
+            xfst.name_net($2);
             free($2); CHECK;
        }
        | LOADD NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->load_definitions($2);
+            xfst.load_definitions($2);
             free($2); CHECK;
        }
        // help
        | APROPOS END_COMMAND {
-            hfst::xfst::xfst_->apropos($1);
+            xfst.apropos($1);
             free($1); CHECK;
        }
        | DESCRIBE END_COMMAND {
-            hfst::xfst::xfst_->describe($1); CHECK;
+            xfst.describe($1); CHECK;
        }
        // stack
        | CLEAR END_COMMAND {
-            hfst::xfst::xfst_->clear(); CHECK;
+            xfst.clear(); CHECK;
        }
        | POP END_COMMAND {
-            hfst::xfst::xfst_->pop(); CHECK;
+            xfst.pop(); CHECK;
        }
        | PUSH_DEFINED NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->push($2);
+            xfst.push($2);
             free($2); CHECK;
        }
        | PUSH_DEFINED END_COMMAND {
-            hfst::xfst::xfst_->push(); CHECK;
+            xfst.push(); CHECK;
        }
        | TURN END_COMMAND {
-            hfst::xfst::xfst_->turn(); CHECK;
+            xfst.turn(); CHECK;
        }
        | ROTATE END_COMMAND {
-            hfst::xfst::xfst_->rotate(); CHECK;
+            xfst.rotate(); CHECK;
        }
        | LOADS REDIRECT_IN END_COMMAND {
-            hfst::xfst::xfst_->load_stack($2);
+            xfst.load_stack($2);
             free($2); CHECK;
        }
        | LOADS NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->load_stack($2);
+            xfst.load_stack($2);
             free($2); CHECK;
        }
        | LOADS NAMETOKEN SEMICOLON END_COMMAND {
-            hfst::xfst::xfst_->load_stack($2);
+            xfst.load_stack($2);
             free($2); CHECK;
        }
        // wrobble
        | COLLECT_EPSILON_LOOPS END_COMMAND {
-            hfst::xfst::xfst_->collect_epsilon_loops(); CHECK;
+            xfst.collect_epsilon_loops(); CHECK;
        }
        | COMPACT_SIGMA END_COMMAND {
-            hfst::xfst::xfst_->compact_sigma(); CHECK;
+            xfst.compact_sigma(); CHECK;
        }
        // flags
        | ELIMINATE_FLAG NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->eliminate_flag($2);
+            xfst.eliminate_flag($2);
             free($2); CHECK;
        }
        | ELIMINATE_ALL END_COMMAND {
-            hfst::xfst::xfst_->eliminate_flags(); CHECK;
+            xfst.eliminate_flags(); CHECK;
        }
        // system
        | ECHO_ {
-            hfst::xfst::xfst_->echo($1);
+            xfst.echo($1);
             free($1); CHECK;
        }
        | QUIT {
-            hfst::xfst::xfst_->quit($1);
+            xfst.quit($1);
             free($1);
             return EXIT_SUCCESS;
        }
        | HFST {
-            hfst::xfst::xfst_->hfst($1);
+            xfst.hfst($1);
             free($1); CHECK;
        }
        | SOURCE NAMETOKEN END_COMMAND {
-            hxfsterror("source not implemented yywrap\n");
+            hxfsterror(xfst, "source not implemented yywrap\n");
             free($2);
             return EXIT_FAILURE;
        }
        | SYSTEM {
-            hfst::xfst::xfst_->system($1);
+            xfst.system($1);
             free($1); CHECK;
        }
        | VIEW END_COMMAND {
-            hfst::xfst::xfst_->view_net(); CHECK;
-            //hxfsterror("view not implemented\n");
+            xfst.view_net(); CHECK;
+            //hxfsterror(xfst, "view not implemented\n");
             //return EXIT_FAILURE;
        }
        // vars
        | SET NAMETOKEN NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($3);
             if (i != -1)
-              hfst::xfst::xfst_->set($2, i);
+              xfst.set($2, i);
             else
-              hfst::xfst::xfst_->set($2, $3);
+              xfst.set($2, $3);
             free($2);
             free($3); CHECK;
        }
        | SHOW NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->show($2);
+            xfst.show($2);
             free($2); CHECK;
        }
        | SHOW_ALL END_COMMAND {
-            hfst::xfst::xfst_->show(); CHECK;
+            xfst.show(); CHECK;
        }
        | TWOSIDED_FLAGS END_COMMAND {
-            hfst::xfst::xfst_->twosided_flags(); CHECK;
+            xfst.twosided_flags(); CHECK;
        }
        // tests
        | TEST_EQ END_COMMAND {
-            hfst::xfst::xfst_->test_eq(); CHECK;
+            xfst.test_eq(); CHECK;
        }
        | TEST_FUNCT END_COMMAND {
-            hfst::xfst::xfst_->test_funct(); CHECK;
+            xfst.test_funct(); CHECK;
        }
        | TEST_ID END_COMMAND {
-            hfst::xfst::xfst_->test_id(); CHECK;
+            xfst.test_id(); CHECK;
        }
        | TEST_INFINITELY_AMBIGUOUS {
-            hfst::xfst::xfst_->test_infinitely_ambiguous(); CHECK;
+            xfst.test_infinitely_ambiguous(); CHECK;
        }
        | TEST_LOWER_BOUNDED END_COMMAND {
-            hfst::xfst::xfst_->test_lower_bounded(); CHECK;
+            xfst.test_lower_bounded(); CHECK;
        }
        | TEST_LOWER_UNI END_COMMAND {
-            hfst::xfst::xfst_->test_lower_uni(); CHECK;
+            xfst.test_lower_uni(); CHECK;
        }
        | TEST_UPPER_BOUNDED END_COMMAND {
-            hfst::xfst::xfst_->test_upper_bounded(); CHECK;
+            xfst.test_upper_bounded(); CHECK;
        }
        | TEST_UPPER_UNI END_COMMAND {
-            hfst::xfst::xfst_->test_upper_uni(); CHECK;
+            xfst.test_upper_uni(); CHECK;
        }
        | TEST_NONNULL END_COMMAND {
-            hfst::xfst::xfst_->test_nonnull(); CHECK;
+            xfst.test_nonnull(); CHECK;
        }
        | TEST_NULL END_COMMAND {
-            hfst::xfst::xfst_->test_null(); CHECK;
+            xfst.test_null(); CHECK;
        }
        | TEST_OVERLAP END_COMMAND {
-            hfst::xfst::xfst_->test_overlap(); CHECK;
+            xfst.test_overlap(); CHECK;
        }
        | TEST_SUBLANGUAGE END_COMMAND {
-            hfst::xfst::xfst_->test_sublanguage(); CHECK;
+            xfst.test_sublanguage(); CHECK;
        }
        | TEST_UNAMBIGUOUS END_COMMAND {
-            hfst::xfst::xfst_->test_unambiguous(); CHECK;
+            xfst.test_unambiguous(); CHECK;
        }
        // assertions
        | ASSERT TEST_EQ END_COMMAND {
-            hfst::xfst::xfst_->test_eq(true); CHECK;
+            xfst.test_eq(true); CHECK;
        }
        | ASSERT TEST_FUNCT END_COMMAND {
-            hfst::xfst::xfst_->test_funct(true); CHECK;
+            xfst.test_funct(true); CHECK;
        }
        | ASSERT TEST_ID END_COMMAND {
-            hfst::xfst::xfst_->test_id(true); CHECK;
+            xfst.test_id(true); CHECK;
        }
        | ASSERT TEST_LOWER_BOUNDED END_COMMAND {
-            hfst::xfst::xfst_->test_lower_bounded(true); CHECK;
+            xfst.test_lower_bounded(true); CHECK;
        }
        | ASSERT TEST_LOWER_UNI END_COMMAND {
-            hfst::xfst::xfst_->test_lower_uni(true); CHECK;
+            xfst.test_lower_uni(true); CHECK;
        }
        | ASSERT TEST_UPPER_BOUNDED END_COMMAND {
-            hfst::xfst::xfst_->test_upper_bounded(true); CHECK;
+            xfst.test_upper_bounded(true); CHECK;
        }
        | ASSERT TEST_UPPER_UNI END_COMMAND {
-            hfst::xfst::xfst_->test_upper_uni(true); CHECK;
+            xfst.test_upper_uni(true); CHECK;
        }
        | ASSERT TEST_NONNULL END_COMMAND {
-            hfst::xfst::xfst_->test_nonnull(true); CHECK;
+            xfst.test_nonnull(true); CHECK;
        }
        | ASSERT TEST_NULL END_COMMAND {
-            hfst::xfst::xfst_->test_null(true); CHECK;
+            xfst.test_null(true); CHECK;
        }
        | ASSERT TEST_OVERLAP END_COMMAND {
-            hfst::xfst::xfst_->test_overlap(true); CHECK;
+            xfst.test_overlap(true); CHECK;
        }
        | ASSERT TEST_SUBLANGUAGE END_COMMAND {
-            hfst::xfst::xfst_->test_sublanguage(true); CHECK;
+            xfst.test_sublanguage(true); CHECK;
        }
        | ASSERT TEST_UNAMBIGUOUS END_COMMAND {
-            hfst::xfst::xfst_->test_unambiguous(true); CHECK;
+            xfst.test_unambiguous(true); CHECK;
        }
        // substitutes
        | SUBSTITUTE_NAMED NAMETOKEN FOR NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->substitute_named($2, $4); // TODO!
+            xfst.substitute_named($2, $4); // TODO!
             free($2);
             free($4); CHECK;
        }
        | SUBSTITUTE_LABEL LABEL_LIST FOR LABEL END_COMMAND {
-            hfst::xfst::xfst_->substitute_label($2, $4);
+            xfst.substitute_label($2, $4);
             free($2);
             free($4); CHECK;
        }
        | SUBSTITUTE_SYMBOL QUOTED_NAMETOKEN_LIST FOR NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->substitute_symbol($2, $4);
+            xfst.substitute_symbol($2, $4);
             free($2);
             free($4); CHECK;
        }
        // prints
        | PRINT_ALIASES REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_aliases(&oss);
+              xfst.print_aliases(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_ALIASES END_COMMAND {
-            hfst::xfst::xfst_->print_aliases(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_aliases(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_ARCCOUNT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_arc_count(&oss);
+              xfst.print_arc_count(&oss);
               oss.close();
 	    }
 	    CHECK;
@@ -478,211 +483,211 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_ARCCOUNT NAMETOKEN END_COMMAND {
             if (strcmp($2, "upper") && strcmp($2, "lower"))
             {
-                hxfsterror("should be upper or lower");
+                hxfsterror(xfst, "should be upper or lower");
                 free($2);
                 return EXIT_FAILURE;
             }
-            hfst::xfst::xfst_->print_arc_count($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_arc_count($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_ARCCOUNT END_COMMAND {
-            hfst::xfst::xfst_->print_arc_count(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_arc_count(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_DEFINED REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
             {
 	      std::ofstream oss($2);
-              hfst::xfst::xfst_->print_defined(&oss);
+              xfst.print_defined(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_DEFINED END_COMMAND {
-            hfst::xfst::xfst_->print_defined(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_defined(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_DIR GLOB REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
             {
 	      std::ofstream oss($3);
-              hfst::xfst::xfst_->print_dir($2, &oss);
+              xfst.print_dir($2, &oss);
               oss.close();
 	    }
             free($3); CHECK;
        }
        | PRINT_DIR GLOB END_COMMAND {
-            hfst::xfst::xfst_->print_dir($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_dir($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_DIR REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_dir("*", &oss);
+              xfst.print_dir("*", &oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_DIR END_COMMAND {
-            hfst::xfst::xfst_->print_dir("*", &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_dir("*", &xfst.get_output_stream()); CHECK;
        }
        | PRINT_FILE_INFO REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
             {
 	      std::ofstream oss($2);
-              hfst::xfst::xfst_->print_file_info(&oss);
+              xfst.print_file_info(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_FILE_INFO END_COMMAND {
-            hfst::xfst::xfst_->print_file_info(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_file_info(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_FLAGS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_flags(&oss);
+              xfst.print_flags(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_FLAGS END_COMMAND {
-            hfst::xfst::xfst_->print_flags(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_flags(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_LABELS NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_labels($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_labels($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_LABELS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
             {
 	      std::ofstream oss($2);
-              hfst::xfst::xfst_->print_labels(&oss);
+              xfst.print_labels(&oss);
               oss.close();
 	      }
 	      CHECK;
        }
        | PRINT_LABELS END_COMMAND {
-            hfst::xfst::xfst_->print_labels(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_labels(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_LABEL_COUNT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_label_count(&oss);
+              xfst.print_label_count(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_LABEL_COUNT END_COMMAND {
-            hfst::xfst::xfst_->print_label_count(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_label_count(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_LIST NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
-              hfst::xfst::xfst_->print_list($2, &oss);
+              xfst.print_list($2, &oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_LIST NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_list($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_list($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_LISTS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
             {
 	      std::ofstream oss($2);
-              hfst::xfst::xfst_->print_list(&oss);
+              xfst.print_list(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_LISTS END_COMMAND {
-            hfst::xfst::xfst_->print_list(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_list(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_LONGEST_STRING REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_longest_string(&oss);
+              xfst.print_longest_string(&oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_LONGEST_STRING END_COMMAND {
-            //hfst::xfst::xfst_->print_longest_string(&hfst::xfst::xfst_->get_output_stream());
-            hfst::xfst::xfst_->print_longest_string(&hfst::xfst::xfst_->get_output_stream());
+            //xfst.print_longest_string(&xfst.get_output_stream());
+            xfst.print_longest_string(&xfst.get_output_stream());
             CHECK;
        }
        | PRINT_LONGEST_STRING_SIZE REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
             {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_longest_string_size(&oss);
+              xfst.print_longest_string_size(&oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_LONGEST_STRING_SIZE END_COMMAND {
-            //hfst::xfst::xfst_->print_longest_string_size(&hfst::xfst::xfst_->get_output_stream());
-            hfst::xfst::xfst_->print_longest_string_size(&hfst::xfst::xfst_->get_output_stream());
+            //xfst.print_longest_string_size(&xfst.get_output_stream());
+            xfst.print_longest_string_size(&xfst.get_output_stream());
             CHECK;
        }
        | PRINT_NAME REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_name(&oss);
+              xfst.print_name(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_NAME END_COMMAND {
-            hfst::xfst::xfst_->print_name(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_name(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_SHORTEST_STRING REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_shortest_string(&oss);
+              xfst.print_shortest_string(&oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_SHORTEST_STRING END_COMMAND {
-            //hfst::xfst::xfst_->print_shortest_string(&hfst::xfst::xfst_->get_output_stream());
-            hfst::xfst::xfst_->print_shortest_string(&hfst::xfst::xfst_->get_output_stream());
+            //xfst.print_shortest_string(&xfst.get_output_stream());
+            xfst.print_shortest_string(&xfst.get_output_stream());
             CHECK;
        }
        | PRINT_SHORTEST_STRING_SIZE REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_shortest_string_size(&oss);
+              xfst.print_shortest_string_size(&oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_SHORTEST_STRING_SIZE END_COMMAND {
-            //hfst::xfst::xfst_->print_shortest_string_size(&hfst::xfst::xfst_->get_output_stream());
-            hfst::xfst::xfst_->print_shortest_string_size(&hfst::xfst::xfst_->get_output_stream());
+            //xfst.print_shortest_string_size(&xfst.get_output_stream());
+            xfst.print_shortest_string_size(&xfst.get_output_stream());
             CHECK;
        }
        | PRINT_LOWER_WORDS NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_lower_words($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_lower_words($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); free($3); CHECK;
        }
        | PRINT_LOWER_WORDS NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
 	    {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_lower_words($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_lower_words($2, hfst::xfst::nametoken_to_number($3), &oss);
               //hfst::xfst::xfst_fclose(f, $4);
               oss.close();
 	    }
@@ -692,24 +697,24 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_LOWER_WORDS NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_lower_words(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_lower_words(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_lower_words($2, 0, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_lower_words($2, 0, &xfst.get_output_stream());
             free($2);
             CHECK;
        }
        | PRINT_LOWER_WORDS END_COMMAND {
-            hfst::xfst::xfst_->print_lower_words(NULL, 0, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_lower_words(NULL, 0, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_LOWER_WORDS NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_lower_words(NULL, i, &oss);
+                xfst.print_lower_words(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_lower_words($2, 0, &oss);
+                xfst.print_lower_words($2, 0, &oss);
               //hfst::xfst::xfst_fclose(f, $3);
               oss.close();
 	    }
@@ -717,24 +722,24 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
             CHECK;
        }
        | PRINT_LOWER_WORDS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_lower_words(NULL, 0, &oss);
+              xfst.print_lower_words(NULL, 0, &oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_RANDOM_LOWER NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_random_lower($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_random_lower($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); free($3); CHECK;
        }
        | PRINT_RANDOM_LOWER NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
             {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_random_lower($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_random_lower($2, hfst::xfst::nametoken_to_number($3), &oss);
               oss.close();
 	      //hfst::xfst::xfst_fclose(f, $4);
 	    }
@@ -744,47 +749,47 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_RANDOM_LOWER NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_random_lower(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_lower(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_random_lower($2, 15, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_lower($2, 15, &xfst.get_output_stream());
             free($2);CHECK;
        }
        | PRINT_RANDOM_LOWER END_COMMAND {
-            hfst::xfst::xfst_->print_random_lower(NULL, 15, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_random_lower(NULL, 15, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_RANDOM_LOWER NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_random_lower(NULL, i, &oss);
+                xfst.print_random_lower(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_random_lower($2, 15, &oss);
+                xfst.print_random_lower($2, 15, &oss);
               //hfst::xfst::xfst_fclose(f, $3);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_RANDOM_LOWER REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_random_lower(NULL, 15, &oss);
+              xfst.print_random_lower(NULL, 15, &oss);
               //hfst::xfst::xfst_fclose(f, $2);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_UPPER_WORDS NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_upper_words($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_upper_words($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_UPPER_WORDS NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
 	    {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_upper_words($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_upper_words($2, hfst::xfst::nametoken_to_number($3), &oss);
               //hfst::xfst::xfst_fclose(f, $4);
               oss.close();
 	    }
@@ -794,45 +799,45 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_UPPER_WORDS NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_upper_words(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_upper_words(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_upper_words($2, 0, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_upper_words($2, 0, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_UPPER_WORDS END_COMMAND {
-            hfst::xfst::xfst_->print_upper_words(NULL, 0, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_upper_words(NULL, 0, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_UPPER_WORDS NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_upper_words(NULL, i, &oss);
+                xfst.print_upper_words(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_upper_words($2, 0, &oss);
+                xfst.print_upper_words($2, 0, &oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_UPPER_WORDS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_upper_words(NULL, 0, &oss);
+              xfst.print_upper_words(NULL, 0, &oss);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_RANDOM_UPPER NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_random_upper($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_random_upper($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); free($3); CHECK;
        }
        | PRINT_RANDOM_UPPER NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
 	    {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_random_upper($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_random_upper($2, hfst::xfst::nametoken_to_number($3), &oss);
               oss.close();
 	    }
 	    free($2); free($3);
@@ -841,45 +846,45 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_RANDOM_UPPER NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_random_upper(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_upper(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_random_upper($2, 15, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_upper($2, 15, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_RANDOM_UPPER END_COMMAND {
-            hfst::xfst::xfst_->print_random_upper(NULL, 15, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_random_upper(NULL, 15, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_RANDOM_UPPER NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
             {
 	      std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_random_upper(NULL, i, &oss);
+                xfst.print_random_upper(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_random_upper($2, 15, &oss);
+                xfst.print_random_upper($2, 15, &oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_RANDOM_UPPER REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_random_upper(NULL, 15, &oss);
+              xfst.print_random_upper(NULL, 15, &oss);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_WORDS NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_words($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_words($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); free($3); CHECK;
        }
        | PRINT_WORDS NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
 	    {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_words($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_words($2, hfst::xfst::nametoken_to_number($3), &oss);
               oss.close();
 	    }
 	    free($2); free($3);
@@ -888,45 +893,45 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_WORDS NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_words(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_words(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_words($2, 0, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_words($2, 0, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_WORDS END_COMMAND {
-            hfst::xfst::xfst_->print_words(NULL, 0, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_words(NULL, 0, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_WORDS NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_words(NULL, i, &oss);
+                xfst.print_words(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_words($2, 0, &oss);
+                xfst.print_words($2, 0, &oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_WORDS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_words(NULL, 0, &oss);
+              xfst.print_words(NULL, 0, &oss);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT_RANDOM_WORDS NAMETOKEN NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_random_words($2, hfst::xfst::nametoken_to_number($3), &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_random_words($2, hfst::xfst::nametoken_to_number($3), &xfst.get_output_stream());
             free($2); free($3); CHECK;
        }
        | PRINT_RANDOM_WORDS NAMETOKEN NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($4))
+            if (xfst.check_filename($4))
 	    {
               std::ofstream oss($4);
-              hfst::xfst::xfst_->print_random_words($2, hfst::xfst::nametoken_to_number($3), &oss);
+              xfst.print_random_words($2, hfst::xfst::nametoken_to_number($3), &oss);
               oss.close();
 	    }
 	    free($2); free($3);
@@ -935,450 +940,450 @@ COMMAND: ADD_PROPS REDIRECT_IN END_COMMAND {
        | PRINT_RANDOM_WORDS NAMETOKEN END_COMMAND {
             int i = hfst::xfst::nametoken_to_number($2);
             if (i != -1)
-              hfst::xfst::xfst_->print_random_words(NULL, i, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_words(NULL, i, &xfst.get_output_stream());
             else
-              hfst::xfst::xfst_->print_random_words($2, 15, &hfst::xfst::xfst_->get_output_stream());
+              xfst.print_random_words($2, 15, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_RANDOM_WORDS END_COMMAND {
-            hfst::xfst::xfst_->print_random_words(NULL, 15, &hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_random_words(NULL, 15, &xfst.get_output_stream()); CHECK;
        }
        | PRINT_RANDOM_WORDS NAMETOKEN REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($3))
+            if (xfst.check_filename($3))
 	    {
               std::ofstream oss($3);
               int i = hfst::xfst::nametoken_to_number($2);
               if (i != -1)
-                hfst::xfst::xfst_->print_random_words(NULL, i, &oss);
+                xfst.print_random_words(NULL, i, &oss);
               else
-                hfst::xfst::xfst_->print_random_words($2, 15, &oss);
+                xfst.print_random_words($2, 15, &oss);
             oss.close();
 	    }
             free($2); CHECK;
        }
        | PRINT_RANDOM_WORDS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_random_words(NULL, 15, &oss);
+              xfst.print_random_words(NULL, 15, &oss);
               oss.close();
 	    }
             CHECK;
        }
        | PRINT NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_net($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_net($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_net(&oss);
+              xfst.print_net(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT END_COMMAND {
-            hfst::xfst::xfst_->print_net(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_net(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_PROPS NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_properties($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_properties($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_PROPS END_COMMAND {
-            hfst::xfst::xfst_->print_properties(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_properties(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_PROPS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_properties(&oss);
+              xfst.print_properties(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_SIGMA NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_sigma($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_sigma($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_SIGMA REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_sigma(&oss);
+              xfst.print_sigma(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_SIGMA END_COMMAND {
-            hfst::xfst::xfst_->print_sigma(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_sigma(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_SIGMA_COUNT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_sigma_count(&oss);
+              xfst.print_sigma_count(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_SIGMA_COUNT END_COMMAND {
-            hfst::xfst::xfst_->print_sigma_count(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_sigma_count(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_SIGMA_WORD_COUNT NAMETOKEN END_COMMAND {
             if (strcmp($2, "upper") && strcmp($2, "lower"))
             {
                 free($2);
-                hxfsterror("must be upper or lower\n");
+                hxfsterror(xfst, "must be upper or lower\n");
                 return EXIT_FAILURE;
             }
-            hfst::xfst::xfst_->print_sigma_word_count($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_sigma_word_count($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_SIGMA_WORD_COUNT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_sigma_word_count(&oss);
+              xfst.print_sigma_word_count(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_SIGMA_WORD_COUNT END_COMMAND {
-            hfst::xfst::xfst_->print_sigma_word_count(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_sigma_word_count(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_SIZE NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->print_size($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.print_size($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | PRINT_SIZE REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_size(&oss);
+              xfst.print_size(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_SIZE END_COMMAND {
-            hfst::xfst::xfst_->print_size(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_size(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_STACK REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_stack(&oss);
+              xfst.print_stack(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | PRINT_STACK END_COMMAND {
-            hfst::xfst::xfst_->print_stack(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.print_stack(&xfst.get_output_stream()); CHECK;
        }
        | PRINT_LABELMAPS REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->print_labelmaps(&oss);
+              xfst.print_labelmaps(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        // writes
        | SAVE_DOT NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->write_dot($2, &hfst::xfst::xfst_->get_output_stream());
+            xfst.write_dot($2, &xfst.get_output_stream());
             free($2); CHECK;
        }
        | SAVE_DOT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_dot(&oss);
+              xfst.write_dot(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | SAVE_DOT END_COMMAND {
-            hfst::xfst::xfst_->write_dot(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.write_dot(&xfst.get_output_stream()); CHECK;
        }
        | SAVE_DEFINITION NAMETOKEN LEFT_PAREN REDIRECT_OUT END_COMMAND {
-            hfst::xfst::xfst_->write_function($2, $4);
+            xfst.write_function($2, $4);
             free($2); CHECK;
        }
        | SAVE_DEFINITION NAMETOKEN LEFT_PAREN END_COMMAND {
-            hfst::xfst::xfst_->write_function($2, 0);
+            xfst.write_function($2, 0);
             free($2); CHECK;
        }
        | SAVE_DEFINITION NAMETOKEN REDIRECT_OUT END_COMMAND {
-            hfst::xfst::xfst_->write_definition($2, $3);
+            xfst.write_definition($2, $3);
             free($2); CHECK;
        }
        | SAVE_DEFINITION NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->write_definition($2, 0);
+            xfst.write_definition($2, 0);
             free($2); CHECK;
        }
        | SAVE_DEFINITIONS REDIRECT_OUT END_COMMAND {
-            hfst::xfst::xfst_->write_definitions($2); CHECK;
+            xfst.write_definitions($2); CHECK;
        }
        | SAVE_DEFINITIONS END_COMMAND {
-            hfst::xfst::xfst_->write_definitions(0); CHECK;
+            xfst.write_definitions(0); CHECK;
        }
        | SAVE_STACK NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->write_stack($2);
+            xfst.write_stack($2);
             free($2); CHECK;
        }
        | SAVE_PROLOG REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_prolog(&oss);
+              xfst.write_prolog(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | SAVE_PROLOG NAMETOKEN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_prolog(&oss);
+              xfst.write_prolog(&oss);
               oss.close();
 	    }
 	    free($2); CHECK;
        }
        | SAVE_PROLOG END_COMMAND {
-            hfst::xfst::xfst_->write_prolog(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.write_prolog(&xfst.get_output_stream()); CHECK;
        }
        | SAVE_SPACED REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_spaced(&oss);
+              xfst.write_spaced(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | SAVE_SPACED END_COMMAND {
-            hfst::xfst::xfst_->write_spaced(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.write_spaced(&xfst.get_output_stream()); CHECK;
        }
        | SAVE_TEXT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_text(&oss);
+              xfst.write_text(&oss);
               oss.close();
 	    }
 	    CHECK;
        }
        | SAVE_TEXT END_COMMAND {
-            hfst::xfst::xfst_->write_text(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.write_text(&xfst.get_output_stream()); CHECK;
        }
        // reads
        | READ_PROPS REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->read_props(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.read_props(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | READ_PROPS END_COMMAND {
-            hfst::xfst::xfst_->read_props(stdin); CHECK;
+            xfst.read_props(stdin); CHECK;
        }
        | READ_PROLOG NAMETOKEN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->read_prolog(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.read_prolog(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    free($2); CHECK;
        }
        | READ_PROLOG END_COMMAND {
-            hfst::xfst::xfst_->read_prolog(stdin); CHECK;
+            xfst.read_prolog(stdin); CHECK;
        }
        | READ_REGEX REGEX {
-            hfst::xfst::xfst_->read_regex($2);
+            xfst.read_regex($2);
             free($2); CHECK;
        }
        | READ_REGEX REDIRECT_IN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
-              FILE * f = hfst::xfst::xfst_->xfst_fopen($2, "r"); CHECK;
-              hfst::xfst::xfst_->read_regex(f);
-              hfst::xfst::xfst_->xfst_fclose(f, $2);
+              FILE * f = xfst.xfst_fopen($2, "r"); CHECK;
+              xfst.read_regex(f);
+              xfst.xfst_fclose(f, $2);
 	    }
 	    CHECK;
        }
        | READ_REGEX NAMETOKEN_LIST SEMICOLON END_COMMAND {
-            hfst::xfst::xfst_->read_regex($2);
+            xfst.read_regex($2);
             free($2); CHECK;
        }
        | READ_SPACED REDIRECT_IN END_COMMAND {
-            hfst::xfst::xfst_->read_spaced_from_file($2);
+            xfst.read_spaced_from_file($2);
             free($2); CHECK;
        }
        | READ_SPACED NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->read_spaced_from_file($2);
+            xfst.read_spaced_from_file($2);
             free($2); CHECK;
        }
        | READ_SPACED NAMETOKEN_LIST CTRLD {
-            hfst::xfst::xfst_->read_spaced($2);
+            xfst.read_spaced($2);
             free($2); CHECK;
        }
        | READ_TEXT REDIRECT_IN END_COMMAND {
-            hfst::xfst::xfst_->read_text_from_file($2);
+            xfst.read_text_from_file($2);
             free($2); CHECK;
        }
        | READ_TEXT NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->read_text_from_file($2);
+            xfst.read_text_from_file($2);
             free($2); CHECK;
        }
        | READ_TEXT NAMETOKEN_LIST CTRLD {
-            hfst::xfst::xfst_->read_text($2);
+            xfst.read_text($2);
             free($2); CHECK;
        }
        | READ_LEXC NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->read_lexc_from_file($2);
+            xfst.read_lexc_from_file($2);
             free($2); CHECK;
        }
        | READ_LEXC NAMETOKEN SEMICOLON END_COMMAND {
-            hfst::xfst::xfst_->read_lexc_from_file($2);
+            xfst.read_lexc_from_file($2);
             free($2); CHECK;
        }
        | READ_LEXC NAMETOKEN_LIST CTRLD {
-            hfst::xfst::xfst_->read_lexc_from_file(""); free($2); CHECK;
+            xfst.read_lexc_from_file(""); free($2); CHECK;
        }
        | READ_ATT NAMETOKEN END_COMMAND {
-            hfst::xfst::xfst_->read_att_from_file($2);
+            xfst.read_att_from_file($2);
             free($2); CHECK;
        }
        | WRITE_ATT END_COMMAND {
-            hfst::xfst::xfst_->write_att(&hfst::xfst::xfst_->get_output_stream()); CHECK;
+            xfst.write_att(&xfst.get_output_stream()); CHECK;
        }
        | WRITE_ATT REDIRECT_OUT END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_att(&oss);
+              xfst.write_att(&oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | WRITE_ATT NAMETOKEN END_COMMAND {
-            if (hfst::xfst::xfst_->check_filename($2))
+            if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_att(&oss);
+              xfst.write_att(&oss);
               oss.close();
 	    }
             free($2); CHECK;
        }
        | WRITE_ATT NAMETOKEN NAMETOKEN NAMETOKEN END_COMMAND {
             // todo: handle input and output symbol tables
-	    if (hfst::xfst::xfst_->check_filename($2))
+	    if (xfst.check_filename($2))
 	    {
               std::ofstream oss($2);
-              hfst::xfst::xfst_->write_att(&oss);
+              xfst.write_att(&oss);
               oss.close();
 	    }
             free($2); free($3); free($4); CHECK;
        }
        // net ops
        | CLEANUP END_COMMAND {
-            hfst::xfst::xfst_->cleanup_net(); CHECK;
+            xfst.cleanup_net(); CHECK;
        }
        | COMPLETE END_COMMAND {
-            hfst::xfst::xfst_->complete_net(); CHECK;
+            xfst.complete_net(); CHECK;
        }
        | COMPOSE END_COMMAND {
-            hfst::xfst::xfst_->compose_net(); CHECK;
+            xfst.compose_net(); CHECK;
        }
        | CONCATENATE END_COMMAND {
-            hfst::xfst::xfst_->concatenate_net(); CHECK;
+            xfst.concatenate_net(); CHECK;
        }
        | MINUS END_COMMAND {
-            hfst::xfst::xfst_->minus_net(); CHECK;
+            xfst.minus_net(); CHECK;
        }
        | CROSSPRODUCT END_COMMAND {
-            hfst::xfst::xfst_->crossproduct_net(); CHECK;
+            xfst.crossproduct_net(); CHECK;
        }
        | MINIMIZE END_COMMAND {
-            hfst::xfst::xfst_->minimize_net(); CHECK;
+            xfst.minimize_net(); CHECK;
        }
        | DETERMINIZE END_COMMAND {
-            hfst::xfst::xfst_->determinize_net(); CHECK;
+            xfst.determinize_net(); CHECK;
        }
        | EPSILON_REMOVE END_COMMAND {
-            hfst::xfst::xfst_->epsilon_remove_net(); CHECK;
+            xfst.epsilon_remove_net(); CHECK;
        }
        | PRUNE_NET END_COMMAND {
-            hfst::xfst::xfst_->prune_net(); CHECK;
+            xfst.prune_net(); CHECK;
        }
        | XFST_IGNORE END_COMMAND {
-            hfst::xfst::xfst_->ignore_net(); CHECK;
+            xfst.ignore_net(); CHECK;
        }
        | INTERSECT END_COMMAND {
-            hfst::xfst::xfst_->intersect_net(); CHECK;
+            xfst.intersect_net(); CHECK;
        }
        | INSPECT END_COMMAND {
-            hfst::xfst::xfst_->inspect_net(); CHECK;
+            xfst.inspect_net(); CHECK;
        }
        | INVERT END_COMMAND {
-            hfst::xfst::xfst_->invert_net(); CHECK;
+            xfst.invert_net(); CHECK;
        }
        | LOWER_SIDE END_COMMAND {
-            hfst::xfst::xfst_->lower_side_net(); CHECK;
+            xfst.lower_side_net(); CHECK;
        }
        | UPPER_SIDE END_COMMAND {
-            hfst::xfst::xfst_->upper_side_net(); CHECK;
+            xfst.upper_side_net(); CHECK;
        }
        | NEGATE END_COMMAND {
-            hfst::xfst::xfst_->negate_net(); CHECK;
+            xfst.negate_net(); CHECK;
        }
        | ONE_PLUS END_COMMAND {
-            hfst::xfst::xfst_->one_plus_net(); CHECK;
+            xfst.one_plus_net(); CHECK;
        }
        | ZERO_PLUS END_COMMAND {
-            hfst::xfst::xfst_->zero_plus_net(); CHECK;
+            xfst.zero_plus_net(); CHECK;
        }
        | XFST_OPTIONAL END_COMMAND {
-            hfst::xfst::xfst_->optional_net(); CHECK;
+            xfst.optional_net(); CHECK;
        }
        | REVERSE END_COMMAND {
-            hfst::xfst::xfst_->reverse_net(); CHECK;
+            xfst.reverse_net(); CHECK;
        }
        | SHUFFLE END_COMMAND {
-            hfst::xfst::xfst_->shuffle_net(); CHECK;
+            xfst.shuffle_net(); CHECK;
        }
        | SIGMA END_COMMAND {
-            hfst::xfst::xfst_->sigma_net(); CHECK;
+            xfst.sigma_net(); CHECK;
        }
        | SORT END_COMMAND {
-            hfst::xfst::xfst_->sort_net(); CHECK;
+            xfst.sort_net(); CHECK;
        }
        | SUBSTRING END_COMMAND {
-            hfst::xfst::xfst_->substring_net(); CHECK;
+            xfst.substring_net(); CHECK;
        }
        | UNION END_COMMAND {
-            hfst::xfst::xfst_->union_net(); CHECK;
+            xfst.union_net(); CHECK;
        }
        | LABEL_NET END_COMMAND {
-            hfst::xfst::xfst_->label_net(); CHECK;
+            xfst.label_net(); CHECK;
        }
        | COMPILE_REPLACE_LOWER END_COMMAND {
-            hfst::xfst::xfst_->compile_replace_lower_net(); CHECK;
+            xfst.compile_replace_lower_net(); CHECK;
        }
        | COMPILE_REPLACE_UPPER END_COMMAND {
-            hfst::xfst::xfst_->compile_replace_upper_net(); CHECK;
+            xfst.compile_replace_upper_net(); CHECK;
        }
        | END_COMMAND {
-            hfst::xfst::xfst_->prompt(); CHECK;
+            xfst.prompt(); CHECK;
        }
        | NAMETOKEN END_COMMAND {
-            if ( hfst::xfst::xfst_->unknown_command($1) != 0)
+            if ( xfst.unknown_command($1) != 0)
               {
-                hxfsterror("Command not recognized.\n");
+                hxfsterror(xfst, "Command not recognized.\n");
                 free($1);
                 YYABORT;
               }
@@ -1528,15 +1533,20 @@ LABEL_LIST: LABEL_LIST LABEL {
 %%
 
 // oblig. declarations
-extern FILE* hxfstin;
-int hxfstparse(void);
+int hxfstparse(yyscan_t, hfst::xfst::XfstCompiler&);
 
 // gah, bison/flex error mechanism here
 void
-hxfsterror(const char* text)
+hxfsterror(yyscan_t, hfst::xfst::XfstCompiler & xfst, const char* text)
 {
-    hfst::xfst::xfst_->error() << text << std::endl;
-    hfst::xfst::xfst_->flush(&hfst::xfst::xfst_->error());
+    hxfsterror(xfst, text);
+}
+
+void
+hxfsterror(hfst::xfst::XfstCompiler & xfst, const char* text)
+{
+    xfst.error() << text << std::endl;
+    xfst.flush(&xfst.error());
     //fprintf(stderr,  "%s\n", text);
 }
 
@@ -28,14 +28,14 @@
 
 #include <errno.h>
 
+#include "xfst-utils.h"
+
 #ifdef YACC_USE_PARSER_H_EXTENSION
   #include "xfst-parser.h"
 #else
   #include "xfst-parser.hh"
 #endif
 
-#include "xfst-utils.h"
-
 // for hfst::size_t_to_int
 #ifndef HAVE_GETLINE
   #include "HfstDataTypes.h"
@@ -44,9 +44,8 @@
 using std::string;
 
 // flex stuffa
-extern int hxfstlineno;
-extern char* hxfsttext;
-extern YYLTYPE hxfstlloc;
+typedef void * yyscan_t;
+extern char* hxfstget_text(yyscan_t);
 
 namespace hfst { namespace xfst {
 
@@ -66,10 +65,15 @@ namespace hfst { namespace xfst {
 #endif
 
 char*
-strdup_token_part()
+strdup_token_part(yyscan_t scanner)
 {
+    const char* hxfsttext = "";
+    if ((scanner != NULL) && (hxfstget_text(scanner) != NULL))
+    {
+        hxfsttext = hxfstget_text(scanner);
+    }
     char *error_token = (char*)malloc(sizeof(char)*strlen(hxfsttext)+100);
-    char* maybelbr = strchr(hxfsttext, '\n');
+    const char* maybelbr = strchr(hxfsttext, '\n');
     if (maybelbr != NULL)
     {
         char* beforelbr = (char*)malloc(sizeof(char)*strlen(hxfsttext)+1);
@@ -33,6 +33,21 @@ namespace hfst { namespace xfst {
     ssize_t getline(char** line, size_t* n, FILE* f);
 #endif
 
+class XfstCompiler;
+
+//! @brief The extra data of the scanner of one parse.
+struct XfstScannerState
+{
+  //! @brief The compiler that the parse is for.
+  XfstCompiler & compiler;
+  //! @brief The number of files being sourced.
+  int source_stack_size;
+};
+
+//! @brief create some sensible representation of current token of
+//! @a scanner.
+char* strdup_token_part(void * scanner);
+
 //! @brief Strips initial and final white space and strdups
 char* strstrip(const char* s);
 
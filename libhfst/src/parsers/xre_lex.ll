@@ -1,4 +1,5 @@
 %option 8Bit batch noyylineno noyywrap reentrant bison-bridge prefix="xre"
+%option extra-type="hfst::xre::XreCompilation *"
 
 %{
 
@@ -16,28 +17,16 @@
 #include "HfstTransducer.h"
 #include "HfstInputStream.h"
 #include "HfstXeroxRules.h"
-#include "xre_parse.hh"
 #include "xre_utils.h"
+#include "xre_parse.hh"
 
-#undef YY_INPUT
-#define YY_INPUT(buf, retval, maxlen)   (retval = hfst::xre::getinput(buf, maxlen))
-
-extern int xreerror(const char*);
+extern int xreerror(hfst::xre::XreCompilation &, const char*);
 
 #undef YY_FATAL_ERROR
-#define YY_FATAL_ERROR(msg) xreerror(msg);
-
-// These variablese are used when scanning a regex for a given SYMBOL
-// when performing variable substitution in function definition.
-namespace hfst {
-  namespace xre {
-    extern unsigned int cr; // number of characters read
-    extern std::set<unsigned int> positions; // positions of a given SYMBOL
-    extern char * position_symbol;  // the given SYMBOL
-} }
+#define YY_FATAL_ERROR(msg) xreerror(*xreget_extra(yyscanner), msg);
 
 // a macro that increments the number of characters read
-#define CR hfst::xre::cr += (unsigned int)strlen(yytext);
+#define CR yyextra->cr += (unsigned int)strlen(yytext);
 
 extern int xrelex ( YYSTYPE * lvalp, yyscan_t scanner );
 
@@ -213,9 +202,9 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
     return READ_RE;
 }
 
-"[.#.]" { hfst::xre::cr += 5; yylval->label = strdup(".#."); return SYMBOL; }
-"[.#." { hfst::xre::cr += 1; unput('.'); unput('#'); unput('.'); return LEFT_BRACKET; }
-".#.]" { hfst::xre::cr += 3; unput(']'); yylval->label = strdup(".#."); return SYMBOL; }
+"[.#.]" { yyextra->cr += 5; yylval->label = strdup(".#."); return SYMBOL; }
+"[.#." { yyextra->cr += 1; unput('.'); unput('#'); unput('.'); return LEFT_BRACKET; }
+".#.]" { yyextra->cr += 3; unput(']'); yylval->label = strdup(".#."); return SYMBOL; }
 "[." { CR; return LEFT_BRACKET_DOTTED; }
 ".]" { CR; return RIGHT_BRACKET_DOTTED; }
 "[" { CR; return LEFT_BRACKET; }
@@ -233,7 +222,7 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 
 "\""[^""]+"\"" {
     unsigned int length = 0;
-    yylval->label = hfst::xre::parse_quoted(yytext, length);
+    yylval->label = hfst::xre::parse_quoted(*yyextra, yytext, length);
     CR;
     if (length < 2)
       return QUOTED_LITERAL;
@@ -251,9 +240,9 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 "?" { CR; return ANY_TOKEN; }
 
 "0"({NAME_CH}|"0")+ {
-    if (hfst::xre::position_symbol != NULL) {
-      if (strcmp(hfst::xre::position_symbol, yytext) == 0) {
-        hfst::xre::positions.insert(hfst::xre::cr);
+    if (yyextra->position_symbol != NULL) {
+      if (strcmp(yyextra->position_symbol, yytext) == 0) {
+        yyextra->positions.insert(yyextra->cr);
       }
     }
     yylval->label = hfst::xre::strip_percents(yytext);
@@ -262,9 +251,9 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 }
 
 {NAME_CH} {
-    if (hfst::xre::position_symbol != NULL) {
-      if (strcmp(hfst::xre::position_symbol, yytext) == 0) {
-        hfst::xre::positions.insert(hfst::xre::cr);
+    if (yyextra->position_symbol != NULL) {
+      if (strcmp(yyextra->position_symbol, yytext) == 0) {
+        yyextra->positions.insert(yyextra->cr);
       }
     }
     yylval->label = hfst::xre::strip_percents(yytext);
@@ -273,9 +262,9 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 }
 
 {NAME_CH}({NAME_CH}|"0")+ {
-    if (hfst::xre::position_symbol != NULL) {
-      if (strcmp(hfst::xre::position_symbol, yytext) == 0) {
-        hfst::xre::positions.insert(hfst::xre::cr);
+    if (yyextra->position_symbol != NULL) {
+      if (strcmp(yyextra->position_symbol, yytext) == 0) {
+        yyextra->positions.insert(yyextra->cr);
       }
     }
     yylval->label = hfst::xre::strip_percents(yytext);
@@ -284,9 +273,9 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 }
 
 ".#." {
-    if (hfst::xre::position_symbol != NULL) {
-      if (strcmp(hfst::xre::position_symbol, yytext) == 0) {
-        hfst::xre::positions.insert(hfst::xre::cr);
+    if (yyextra->position_symbol != NULL) {
+      if (strcmp(yyextra->position_symbol, yytext) == 0) {
+        yyextra->positions.insert(yyextra->cr);
       }
     }
     yylval->label = hfst::xre::strip_percents(yytext);
@@ -312,7 +301,7 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
     return END_OF_EXPRESSION;
 }
 
-{LWSP}+ { hfst::xre::count_lines(yytext); /*fprintf(stderr, "ignoring whitespace '%s'..\n", yytext); */ /* ignorable whitespace */ }
+{LWSP}+ { hfst::xre::count_lines(*yyextra, yytext); /*fprintf(stderr, "ignoring whitespace '%s'..\n", yytext); */ /* ignorable whitespace */ }
 
 ("!"|"#")[^\n]*$ { CR; /* fprintf(stderr, "ignoring comment '%s'..\n", yytext); */ /* ignore comments */ }
 
@@ -25,49 +25,19 @@ using namespace hfst::implementations;
 
 #include "xre_utils.h"
 
-namespace hfst {
-  namespace xre {
-    // number of characters read, used for scanning function definition xre for argument symbols
-    extern unsigned int cr;
-    extern bool harmonize_;
-    extern bool harmonize_flags_;
-    extern bool allow_extra_text_at_end;
-
-    bool has_weight_been_zeroed = false; // to control how many times a warning is given
-    float zero_weights(float f)
-    {
-        if ((! has_weight_been_zeroed) && (f != 0))
-        {
-            hfst::xre::warn("warning: ignoring weights in rule context\n");
-            has_weight_been_zeroed = true;
-        }
-        return 0;
-    }
-
-    bool is_weighted()
-    {
-        return (hfst::xre::format == hfst::TROPICAL_OPENFST_TYPE ||
-                hfst::xre::format == hfst::LOG_OPENFST_TYPE);
-    }
-  }
-}
-
-using hfst::xre::harmonize_;
-using hfst::xre::harmonize_flags_;
-
 union YYSTYPE;
 struct yy_buffer_state;
 typedef yy_buffer_state * YY_BUFFER_STATE;
 typedef void * yyscan_t;
 
-extern int xreparse(yyscan_t);
-extern int xrelex_init (yyscan_t*);
+extern int xreparse(yyscan_t, hfst::xre::XreCompilation &);
+extern int xrelex_init_extra (hfst::xre::XreCompilation *, yyscan_t*);
 extern YY_BUFFER_STATE xre_scan_string (const char *, yyscan_t);
 extern void xre_delete_buffer (YY_BUFFER_STATE, yyscan_t);
 extern int xrelex_destroy (yyscan_t);
 
-extern int xreerror(yyscan_t, const char*);
-extern int xreerror(const char*);
+extern int xreerror(yyscan_t, hfst::xre::XreCompilation &, const char*);
+extern int xreerror(hfst::xre::XreCompilation &, const char*);
 int xrelex ( YYSTYPE * , yyscan_t );
 
 %}
@@ -76,6 +46,7 @@ int xrelex ( YYSTYPE * , yyscan_t );
 %define api.pure
 %lex-param {void * scanner}
 %parse-param {void * scanner}
+%parse-param {hfst::xre::XreCompilation & compilation}
 %error-verbose
 %debug
   
@@ -175,20 +146,20 @@ XRE: REGEXP1 { $$ = $1; }
      |
      {
        // only comments
-       hfst::xre::contains_only_comments = true;
+       compilation.contains_only_comments = true;
        return 0;
      }
      ;
 REGEXP1: REGEXP2 END_OF_EXPRESSION {
-       hfst::xre::last_compiled = $1;
-       $$ = hfst::xre::last_compiled;
-       if (hfst::xre::allow_extra_text_at_end) {
+       compilation.last_compiled = $1;
+       $$ = compilation.last_compiled;
+       if (compilation.allow_extra_text_at_end) {
          return 0;
        }
    }
    | REGEXP2 {
-        hfst::xre::last_compiled = $1;
-        $$ = hfst::xre::last_compiled;
+        compilation.last_compiled = $1;
+        $$ = compilation.last_compiled;
    }
 ;
 
@@ -201,8 +172,8 @@ REGEXP2: REPLACE
        {
         if ($1->has_flag_diacritics() && $3->has_flag_diacritics())
           {
-            if (! harmonize_flags_) {
-                 hfst::xre::warn("warning: both composition arguments contain flag diacritics that are not harmonized\n");
+            if (! compilation.harmonize_flags) {
+                 hfst::xre::warn(compilation, "warning: both composition arguments contain flag diacritics that are not harmonized\n");
             }
             else {
                 $1->harmonize_flag_diacritics(*$3);
@@ -210,12 +181,12 @@ REGEXP2: REPLACE
           }
 
          try {
-            $$ = & $1->compose(*$3, harmonize_).optimize();
+            $$ = & $1->compose(*$3, compilation.harmonize).optimize();
          }
          catch (const FlagDiacriticsAreNotIdentitiesException & e)
              {
                (void)e;
-               xreerror("Error: flag diacritics must be identities in composition if flag-is-epsilon is ON.\n"
+               xreerror(compilation, "Error: flag diacritics must be identities in composition if flag-is-epsilon is ON.\n"
                "I.e. only FLAG:FLAG is allowed, not FLAG1:FLAG2, FLAG:bar or foo:FLAG\n"
                "Apply twosided flag-diacritics (tfd) before composition.\n");
                YYABORT;
@@ -232,12 +203,12 @@ REGEXP2: REPLACE
         }
        | REGEXP2 MERGE_RIGHT_ARROW REPLACE {
           try {
-            $$ = & hfst::xre::merge_first_to_second($1, $3)->optimize();
+            $$ = & hfst::xre::merge_first_to_second(compilation, $1, $3)->optimize();
           }
           catch (const TransducersAreNotAutomataException & e)
           {
             (void)e;
-            xreerror("Error: transducers must be automata in merge operation.");
+            xreerror(compilation, "Error: transducers must be automata in merge operation.");
             delete $1;
             delete $3;
             YYABORT;
@@ -245,7 +216,7 @@ REGEXP2: REPLACE
           delete $1;
        }
        | REGEXP2 MERGE_LEFT_ARROW REPLACE {
-            $$ = & hfst::xre::merge_first_to_second($3, $1)->optimize();
+            $$ = & hfst::xre::merge_first_to_second(compilation, $3, $1)->optimize();
             delete $3;
        }
         // substitute
@@ -257,9 +228,9 @@ REGEXP2: REPLACE
        | SUB1 SUB2 SUB3 {
 
             StringSet alpha = $1->get_alphabet();
-            if (hfst::xre::is_definition($2))
+            if (hfst::xre::is_definition(compilation, $2))
             {
-                hfst::xre::warn("warning: using definition as an ordinary label, cannot substitute\n");
+                hfst::xre::warn(compilation, "warning: using definition as an ordinary label, cannot substitute\n");
                 $$ = & $1->optimize();
             }
             else if (alpha.find($2) == alpha.end())
@@ -274,7 +245,7 @@ REGEXP2: REPLACE
                 HfstTransducer * tmpTr = new HfstTransducer(*$1);
 
 	        bool empty_replace_transducer=false;
-	        HfstTransducer empty(hfst::xre::format);
+	        HfstTransducer empty(compilation.format);
 	        if (empty.compare(*$3))
 	        {
                         empty_replace_transducer=true;
@@ -284,8 +255,7 @@ REGEXP2: REPLACE
 	        {
                         // substitute all transitions {b:a, a:b, b:b} with b:b
 		        // as they will be removed anyway
-		        hfst::xre::set_substitution_function_symbol($2);
-		        tmpTr->substitute(&hfst::xre::substitution_function);
+		        tmpTr->substitute(hfst::xre::identity_substitutions(*tmpTr, $2));
 	        }
 
                 // `[ a:b, b, x y ]
@@ -298,11 +268,11 @@ REGEXP2: REPLACE
                         // [[a:b].i .o. b -> x | y].i - this is for cases when b is on left side
 
 	                // build Replace transducer
-                        HfstTransducerPair mappingPair(HfstTransducer($2, $2, hfst::xre::format), *$3);
+                        HfstTransducerPair mappingPair(HfstTransducer($2, $2, compilation.format), *$3);
                         HfstTransducerPairVector mappingPairVector;
                         mappingPairVector.push_back(mappingPair);
                         Rule rule(mappingPairVector);
-                        HfstTransducer replaceTr(hfst::xre::format);
+                        HfstTransducer replaceTr(compilation.format);
                         replaceTr = replace(rule, false);
 
                         // if we are replacing with flag diacritics, the rule must allow
@@ -336,7 +306,7 @@ SUB1: SUBSTITUTE_LEFT LEFT_BRACKET REPLACE COMMA { $$ = $3; } ; // first argumen
 SUB2: HALFARC COMMA { $$ = $1; } ;  // symbol that needs to be replaced
 SUB3: SYMBOL_LIST RIGHT_BRACKET {  $$ = $1;  }  // symbol list
       |
-      RIGHT_BRACKET { $$ = new HfstTransducer(hfst::xre::format); } // an empty symbol list
+      RIGHT_BRACKET { $$ = new HfstTransducer(compilation.format); } // an empty symbol list
       ;
 
 ////////////////////////////
@@ -374,7 +344,7 @@ REPLACE : REGEXP3 { $$ = $1; }
                  break;
                case E_REPLACE_RIGHT_MARKUP:
                default:
-                xreerror("Unhandled arrow stuff I suppose");
+                xreerror(compilation, "Unhandled arrow stuff I suppose");
                 YYABORT;
                 break;
             }
@@ -390,7 +360,7 @@ PARALLEL_RULES: PARALLEL_RULES COMMACOMMA RULE
            {
              delete $3;
              delete $1;
-             xreerror("Replace type mismatch in parallel rules");
+             xreerror(compilation, "Replace type mismatch in parallel rules");
              YYABORT;
            }
             Rule tmpRule($3->second);
@@ -438,7 +408,7 @@ MAPPINGPAIR_VECTOR: MAPPINGPAIR_VECTOR COMMA MAPPINGPAIR
 
          if ($1->first != $3->first)
          {
-            hfst::xre::warn("Replace arrows should be the same. Calculated as if all replacements had the first arrow.");
+            hfst::xre::warn(compilation, "Replace arrows should be the same. Calculated as if all replacements had the first arrow.");
          }
  
          $1->second.push_back($3->second);
@@ -462,8 +432,8 @@ MAPPINGPAIR_VECTOR: MAPPINGPAIR_VECTOR COMMA MAPPINGPAIR
     
 MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       {
-	  hfst::xre::warn_about_special_symbols_in_replace($1);
-	  hfst::xre::warn_about_special_symbols_in_replace($3);
+	  hfst::xre::warn_about_special_symbols_in_replace(compilation, $1);
+	  hfst::xre::warn_about_special_symbols_in_replace(compilation, $3);
           HfstTransducerPair mappingPair(*$1, *$3);
           $$ =  new std::pair< ReplaceArrow, HfstTransducerPair> ($2, mappingPair);
 
@@ -472,7 +442,7 @@ MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       | REPLACE REPLACE_ARROW REPLACE MARKUP_MARKER REPLACE
       {
           HfstTransducerPair marks(*$3, *$5);
-          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(hfst::xre::format));
+          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(compilation.format));
           HfstTransducerPair mappingPair = create_mapping_for_mark_up_replace( tmpMappingPair, marks );
           
           $$ =  new std::pair< ReplaceArrow, HfstTransducerPair> ($2, mappingPair);
@@ -480,9 +450,9 @@ MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       }
       | REPLACE REPLACE_ARROW REPLACE MARKUP_MARKER
       {
-          HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+          HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
           HfstTransducerPair marks(*$3, epsilon);
-          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(hfst::xre::format));
+          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(compilation.format));
           HfstTransducerPair mappingPair = create_mapping_for_mark_up_replace( tmpMappingPair, marks );
                    
           $$ =  new std::pair< ReplaceArrow, HfstTransducerPair> ($2, mappingPair);
@@ -490,9 +460,9 @@ MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       }
       | REPLACE REPLACE_ARROW MARKUP_MARKER REPLACE
       {
-          HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+          HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
           HfstTransducerPair marks(epsilon, *$4);
-          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(hfst::xre::format));
+          HfstTransducerPair tmpMappingPair(*$1, HfstTransducer(compilation.format));
           HfstTransducerPair mappingPair = create_mapping_for_mark_up_replace( tmpMappingPair, marks );
           
           $$ =  new std::pair< ReplaceArrow, HfstTransducerPair> ($2, mappingPair);
@@ -500,7 +470,7 @@ MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       }
        | LEFT_BRACKET_DOTTED RIGHT_BRACKET_DOTTED REPLACE_ARROW REPLACE
       {
-          HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+          HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
           //HfstTransducer mappingTr(epsilon);
           //mappingTr.cross_product(*$4);
           HfstTransducerPair mappingPair(epsilon, *$4);
@@ -517,7 +487,7 @@ MAPPINGPAIR: REPLACE REPLACE_ARROW REPLACE
       
        | REPLACE REPLACE_ARROW LEFT_BRACKET_DOTTED RIGHT_BRACKET_DOTTED
       {
-          HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+          HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
           HfstTransducerPair mappingPair(*$1, epsilon);
           
           $$ =  new std::pair< ReplaceArrow, HfstTransducerPair> ($2, mappingPair);
@@ -559,29 +529,29 @@ CONTEXT: REPLACE CENTER_MARKER REPLACE
          {
             if (hfst::xre::has_non_identity_pairs($1)) // if non-identity symbols present..
             {
-              xreerror("Contexts need to be automata");
+              xreerror(compilation, "Contexts need to be automata");
               YYABORT;
             }
             if (hfst::xre::has_non_identity_pairs($3)) // if non-identity symbols present..
             {
-              xreerror("Contexts need to be automata");
+              xreerror(compilation, "Contexts need to be automata");
               YYABORT;
             }
             
             HfstTransducer t1(*$1);
             HfstTransducer t2(*$3);
 
-             if (hfst::xre::is_weighted())
+             if (hfst::xre::is_weighted(compilation))
              {
-               hfst::xre::has_weight_been_zeroed=false;
-               t1.transform_weights(&hfst::xre::zero_weights);
+               compilation.has_weight_been_zeroed=false;
+               hfst::xre::zero_weights(compilation, t1);
              }
              t1.optimize().prune_alphabet(false);
 
-             if (hfst::xre::is_weighted())
+             if (hfst::xre::is_weighted(compilation))
              {
-               t2.transform_weights(&hfst::xre::zero_weights);
-               hfst::xre::has_weight_been_zeroed=false;
+               hfst::xre::zero_weights(compilation, t2);
+               compilation.has_weight_been_zeroed=false;
              }
              t2.optimize().prune_alphabet(false);
 
@@ -592,21 +562,21 @@ CONTEXT: REPLACE CENTER_MARKER REPLACE
          {
             if (hfst::xre::has_non_identity_pairs($1)) // if non-identity symbols present..
             {
-              xreerror("Contexts need to be automata");
+              xreerror(compilation, "Contexts need to be automata");
               YYABORT;
             }
 
             HfstTransducer t1(*$1);
             
-            if (hfst::xre::is_weighted())
+            if (hfst::xre::is_weighted(compilation))
             {
-              hfst::xre::has_weight_been_zeroed=false;
-              t1.transform_weights(&hfst::xre::zero_weights);
-              hfst::xre::has_weight_been_zeroed=false;
+              compilation.has_weight_been_zeroed=false;
+              hfst::xre::zero_weights(compilation, t1);
+              compilation.has_weight_been_zeroed=false;
             }
             t1.optimize().prune_alphabet(false);
 
-            HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+            HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
             $$ = new HfstTransducerPair(t1, epsilon);
             delete $1;
          }
@@ -615,27 +585,27 @@ CONTEXT: REPLACE CENTER_MARKER REPLACE
 
             if (hfst::xre::has_non_identity_pairs($2)) // if non-identity symbols present..
             {
-              xreerror("Contexts need to be automata");
+              xreerror(compilation, "Contexts need to be automata");
               YYABORT;
             }
             
             HfstTransducer t1(*$2);
 
-            if (hfst::xre::is_weighted())
+            if (hfst::xre::is_weighted(compilation))
             {
-              hfst::xre::has_weight_been_zeroed=false;
-              t1.transform_weights(&hfst::xre::zero_weights);
-              hfst::xre::has_weight_been_zeroed=false;
+              compilation.has_weight_been_zeroed=false;
+              hfst::xre::zero_weights(compilation, t1);
+              compilation.has_weight_been_zeroed=false;
             }
             t1.optimize().prune_alphabet(false);
              
-            HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+            HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
             $$ = new HfstTransducerPair(epsilon, t1);
             delete $2;
          }
        | CENTER_MARKER
           {
-            HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+            HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
             $$ = new HfstTransducerPair(epsilon, epsilon);
           }
       ;
@@ -694,7 +664,7 @@ REPLACE_ARROW: REPLACE_RIGHT
 ////////////////
 REGEXP3: REGEXP4 { $$ = $1; }
        | REGEXP3 SHUFFLE REGEXP4 {
-            xreerror("No shuffle");
+            xreerror(compilation, "No shuffle");
             //$$ = $1;
             delete $3;
             YYABORT;
@@ -719,7 +689,7 @@ REGEXP4: REGEXP5 { $$ = $1; }
         }
        // doesn't exist in xfst
        | REGEXP4 LEFT_ARROW REGEXP5 CENTER_MARKER REGEXP5 {
-            xreerror("No Arrows");
+            xreerror(compilation, "No Arrows");
             //$$ = $1;
             delete $3;
             delete $5;
@@ -727,7 +697,7 @@ REGEXP4: REGEXP5 { $$ = $1; }
         }
        // doesn't exist in xfst
        | REGEXP4 LEFT_RIGHT_ARROW REGEXP5 CENTER_MARKER REGEXP5 {
-            xreerror("No Arrows");
+            xreerror(compilation, "No Arrows");
             //$$ = $1;
             delete $3;
             delete $5;
@@ -761,7 +731,7 @@ RESTR_CONTEXT: REGEXP4 CENTER_MARKER REGEXP4
          {
            // std::cerr << "Mapping: \n" << *$1  << std::endl;
             
-            HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+            HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
             
            // std::cerr << "Epsilon: \n" << epsilon  << std::endl;
             $$ = new HfstTransducerPair(*$1, epsilon);
@@ -769,13 +739,13 @@ RESTR_CONTEXT: REGEXP4 CENTER_MARKER REGEXP4
          }
       | CENTER_MARKER REGEXP4
          {
-            HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+            HfstTransducer epsilon(hfst::internal_epsilon, compilation.format);
             $$ = new HfstTransducerPair(epsilon, *$2);
             delete $2;
          }
       | CENTER_MARKER
          {
-            HfstTransducer empty(hfst::xre::format);
+            HfstTransducer empty(compilation.format);
             $$ = new HfstTransducerPair(empty, empty);
          }
       ;
@@ -783,26 +753,26 @@ RESTR_CONTEXT: REGEXP4 CENTER_MARKER REGEXP4
 
 REGEXP5: REGEXP6 { $$ = $1; }
        | REGEXP5 UNION REGEXP6 {
-            $$ = & $1->disjunct(*$3, harmonize_);
+            $$ = & $1->disjunct(*$3, compilation.harmonize);
             delete $3;
         }
        | REGEXP5 INTERSECTION REGEXP6 {
         // std::cerr << "Intersection: \n"  << std::endl;
-            $$ = & $1->intersect(*$3, harmonize_).optimize().prune_alphabet(false);
+            $$ = & $1->intersect(*$3, compilation.harmonize).optimize().prune_alphabet(false);
             delete $3;
         }
        | REGEXP5 MINUS REGEXP6 {
-            $$ = & $1->subtract(*$3, harmonize_).prune_alphabet(false);
+            $$ = & $1->subtract(*$3, compilation.harmonize).prune_alphabet(false);
             delete $3;
         }
        | REGEXP5 UPPER_MINUS REGEXP6 {
-            xreerror("No upper minus");
+            xreerror(compilation, "No upper minus");
             //$$ = $1;
             delete $3;
             YYABORT;
         }
        | REGEXP5 LOWER_MINUS REGEXP6 {
-            xreerror("No lower minus");
+            xreerror(compilation, "No lower minus");
             //$$ = $1;
             delete $3;
             YYABORT;
@@ -823,7 +793,7 @@ REGEXP5: REGEXP6 { $$ = $1; }
 
 REGEXP6: REGEXP7 { $$ = $1; }
        | REGEXP6 REGEXP7 {
-        $$ = & $1->concatenate(*$2, harmonize_);
+        $$ = & $1->concatenate(*$2, compilation.harmonize);
         delete $2;
         }
        ;
@@ -836,13 +806,13 @@ REGEXP7: REGEXP8 { $$ = $1; }
             delete $3;
         }
        | REGEXP7 IGNORE_INTERNALLY REGEXP8 {
-            xreerror("No ignoring internally");
+            xreerror(compilation, "No ignoring internally");
             //$$ = $1;
             delete $3;
             YYABORT;
         }
        | REGEXP7 LEFT_QUOTIENT REGEXP8 {
-            xreerror("No left quotient");
+            xreerror(compilation, "No left quotient");
             //$$ = $1;
             delete $3;
             YYABORT;
@@ -854,11 +824,11 @@ REGEXP8: REGEXP9 { $$ = $1; }
        		// forbid pair complement (ie ~a:b)
 		if (! $2->is_automaton())
 		{
-		  xreerror("Complement operator ~ is defined only for automata\n"
+		  xreerror(compilation, "Complement operator ~ is defined only for automata\n"
 		           "Use expression [[?:?] - A]] instead where A is the relation to be complemented.");
 		  YYABORT;
 		}
-       		HfstTransducer complement = HfstTransducer::identity_pair( hfst::xre::format );
+       		HfstTransducer complement = HfstTransducer::identity_pair( compilation.format );
        		complement.repeat_star().optimize();
        		complement.subtract(*$2).prune_alphabet(false);
        		$$ = new HfstTransducer(complement);
@@ -868,7 +838,7 @@ REGEXP8: REGEXP9 { $$ = $1; }
             // std::cerr << "Containment: \n" << std::endl;
             if (hfst::xre::has_non_identity_pairs($2)) // if non-identity symbols present..
             {
-              hfst::xre::warn("warning: using transducer that is non an automaton in containment\n");
+              hfst::xre::warn(compilation, "warning: using transducer that is non an automaton in containment\n");
               $$ = hfst::xre::contains($2); // ..resort to simple containment
             }
             else
@@ -881,7 +851,7 @@ REGEXP8: REGEXP9 { $$ = $1; }
             // std::cerr << "Containment: \n" << std::endl;
             if (hfst::xre::has_non_identity_pairs($3)) // if non-identity symbols present..
             {
-              xreerror("Containment with weight only works with automata");
+              xreerror(compilation, "Containment with weight only works with automata");
               YYABORT;
             }
             $$ = hfst::xre::contains_with_weight($3, hfst::double_to_float($2));
@@ -937,7 +907,7 @@ REGEXP9: REGEXP10 { $$ = $1; }
 REGEXP10: REGEXP11 { $$ = $1; }
        | TERM_COMPLEMENT REGEXP10 {
             HfstTransducer* any = new HfstTransducer(hfst::internal_identity,
-                                        hfst::xre::format);
+                                        compilation.format);
             $$ = & ( any->subtract(*$2));
             delete $2;
         }
@@ -961,28 +931,28 @@ REGEXP11: REGEXP12 { $$ = $1; }
         }
         // [foo]:{bar}
         | LEFT_BRACKET REGEXP2 RIGHT_BRACKET PAIR_SEPARATOR CURLY_BRACKETS {
-     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($5,$5);
+     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer(compilation, $5,$5);
             free($5);
             $$ = & $2->cross_product(*tmp);
             delete tmp;
         }
         // {foo}:[bar]
         | CURLY_BRACKETS PAIR_SEPARATOR LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
-     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($1,$1);
+     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer(compilation, $1,$1);
             free($1);
             $$ = & $4->cross_product(*tmp);
             delete tmp;
         }
         // [foo]:bar
         | LEFT_BRACKET REGEXP2 RIGHT_BRACKET PAIR_SEPARATOR HALFARC {
-            HfstTransducer * tmp = hfst::xre::expand_definition($5);
+            HfstTransducer * tmp = hfst::xre::expand_definition(compilation, $5);
             free($5);
             $$ = & $2->cross_product(*tmp);
             delete tmp;
         }
         // foo:[bar]
         | HALFARC PAIR_SEPARATOR LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
-            $$ = hfst::xre::expand_definition($1);
+            $$ = hfst::xre::expand_definition(compilation, $1);
             free($1);
             $$ = & $$->cross_product(*$4);
             delete $4;
@@ -999,11 +969,11 @@ REGEXP11: REGEXP12 { $$ = $1; }
 SYMBOL_LIST: HALFARC {
             if (strcmp($1, hfst::internal_unknown.c_str()) == 0)
               {
-                $$ = new HfstTransducer(hfst::internal_identity, hfst::xre::format);
+                $$ = new HfstTransducer(hfst::internal_identity, compilation.format);
               }
             else
               {
-                $$ = new HfstTransducer($1, $1, hfst::xre::format);
+                $$ = new HfstTransducer($1, $1, compilation.format);
               }
             free($1);
         }
@@ -1011,11 +981,11 @@ SYMBOL_LIST: HALFARC {
             HfstTransducer * tmp ;
             if (strcmp($2, hfst::internal_unknown.c_str()) == 0)
               {
-                 tmp = new HfstTransducer(hfst::internal_identity, hfst::xre::format);
+                 tmp = new HfstTransducer(hfst::internal_identity, compilation.format);
               }
             else
               {
-                 tmp = new HfstTransducer($2, $2, hfst::xre::format);
+                 tmp = new HfstTransducer($2, $2, compilation.format);
               }
 
             $1->disjunct(*tmp, false); // do not harmonize
@@ -1040,7 +1010,7 @@ REGEXP12: LABEL { $$ = $1; }
               (void) e; // todo handle the exception
               char msg [256];
               sprintf(msg, "Error reading transducer file '%s'.", $1);
-              xreerror(msg);
+              xreerror(compilation, msg);
               free($1);
               YYABORT;
             }
@@ -1050,7 +1020,7 @@ REGEXP12: LABEL { $$ = $1; }
             f = hfst::hfst_fopen($1, "r");
             free($1);
             if (f == NULL) {
-              xreerror("File cannot be opened.\n");
+              xreerror(compilation, "File cannot be opened.\n");
               YYABORT;
             }
             else {
@@ -1065,7 +1035,7 @@ REGEXP12: LABEL { $$ = $1; }
                 tmp.disjunct(spv, 0);
               }
               fclose(f);
-              HfstTransducer * retval = new HfstTransducer(tmp, hfst::xre::format);
+              HfstTransducer * retval = new HfstTransducer(tmp, compilation.format);
               retval->optimize();
               $$ = retval;
             }
@@ -1075,7 +1045,7 @@ REGEXP12: LABEL { $$ = $1; }
             f = hfst::hfst_fopen($1, "r");
             free($1);
             if (f == NULL) {
-              xreerror("File cannot be opened.\n");
+              xreerror(compilation, "File cannot be opened.\n");
               YYABORT;
             }
             else {
@@ -1090,7 +1060,7 @@ REGEXP12: LABEL { $$ = $1; }
                 tmp.disjunct(spv, 0);
               }
               fclose(f);
-              HfstTransducer * retval = new HfstTransducer(tmp, hfst::xre::format);
+              HfstTransducer * retval = new HfstTransducer(tmp, compilation.format);
               retval->optimize();
               $$ = retval;
             }
@@ -1100,7 +1070,7 @@ REGEXP12: LABEL { $$ = $1; }
             f = hfst::hfst_fopen($1, "r");
             free($1);
             if (f == NULL) {
-              xreerror("File cannot be opened.\n");
+              xreerror(compilation, "File cannot be opened.\n");
               YYABORT;
             }
             else {
@@ -1108,14 +1078,14 @@ REGEXP12: LABEL { $$ = $1; }
                 unsigned int linecount = 0;
                 HfstBasicTransducer tmp = HfstBasicTransducer::read_in_prolog_format(f, linecount);
                 fclose(f);
-                HfstTransducer * retval = new HfstTransducer(tmp, hfst::xre::format);
+                HfstTransducer * retval = new HfstTransducer(tmp, compilation.format);
                 retval->optimize();
                 $$ = retval;
               }
               catch (const HfstException & e) {
                 (void) e; // todo handle the exception
                 fclose(f);
-                xreerror("Error reading prolog file.\n");
+                xreerror(compilation, "Error reading prolog file.\n");
                 YYABORT;
               }
             }
@@ -1124,7 +1094,7 @@ REGEXP12: LABEL { $$ = $1; }
             FILE * f = NULL;
             f = hfst::hfst_fopen($1, "r");
             if (f == NULL) {
-              xreerror("File cannot be opened.\n");
+              xreerror(compilation, "File cannot be opened.\n");
               fclose(f);
               free($1);
               YYABORT;
@@ -1140,26 +1110,26 @@ REGEXP12: LABEL { $$ = $1; }
 
               // create a new scanner for evaluating the regex
               yyscan_t scanner;
-              xrelex_init(&scanner);
+              xrelex_init_extra(&compilation, &scanner);
               YY_BUFFER_STATE bs = xre_scan_string(regex_string, scanner);
 
-              unsigned int chars_read = hfst::xre::cr;
-              hfst::xre::cr = 0;
+              unsigned int chars_read = compilation.cr;
+              compilation.cr = 0;
 
-              int parse_retval = xreparse(scanner);
+              int parse_retval = xreparse(scanner, compilation);
 
               xre_delete_buffer(bs,scanner);
               xrelex_destroy(scanner);
 
               free(regex_string);
 
-              hfst::xre::cr = chars_read;
+              compilation.cr = chars_read;
 
-              $$ = hfst::xre::last_compiled;
+              $$ = compilation.last_compiled;
 
               if (parse_retval != 0)
               {
-                xreerror("Error parsing regex.\n");
+                xreerror(compilation, "Error parsing regex.\n");
                 YYABORT;
               }
             }
@@ -1169,63 +1139,63 @@ REGEXP12: LABEL { $$ = $1; }
 LABEL: HALFARC {
         if (strcmp($1, hfst::internal_unknown.c_str()) == 0)
           {
-            $$ = new HfstTransducer(hfst::internal_identity, hfst::xre::format);
+            $$ = new HfstTransducer(hfst::internal_identity, compilation.format);
           }
         else
           {
             // HfstTransducer * tmp = new HfstTransducer($1, hfst::xre::format);
 	    // $$ = hfst::xre::expand_definition(tmp, $1);
-            $$ = hfst::xre::expand_definition($1);
+            $$ = hfst::xre::expand_definition(compilation, $1);
           }
         free($1);
      }
      |
      HALFARC PAIR_SEPARATOR HALFARC {
-     	$$ = hfst::xre::xfst_label_to_transducer($1,$3);
+     	$$ = hfst::xre::xfst_label_to_transducer(compilation, $1,$3);
         free($1);
         free($3);
      }
      | HALFARC PAIR_SEPARATOR CURLY_BRACKETS {
-        $$ = hfst::xre::xfst_label_to_transducer($1,$1);
+        $$ = hfst::xre::xfst_label_to_transducer(compilation, $1,$1);
         free($1);
-        HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($3,$3);
+        HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer(compilation, $3,$3);
         free($3);
         $$ = & $$->cross_product(*tmp);
         delete tmp;
      }
      | CURLY_BRACKETS PAIR_SEPARATOR HALFARC {
-        HfstTransducer * tmp = hfst::xre::xfst_label_to_transducer($3,$3);
+        HfstTransducer * tmp = hfst::xre::xfst_label_to_transducer(compilation, $3,$3);
         free($3);
-        $$ = hfst::xre::xfst_curly_label_to_transducer($1,$1);
+        $$ = hfst::xre::xfst_curly_label_to_transducer(compilation, $1,$1);
         free($1);
         $$ = & $$->cross_product(*tmp);
         delete tmp;
      }
      | CURLY_BRACKETS {
-     	$$ = hfst::xre::xfst_curly_label_to_transducer($1,$1);
+     	$$ = hfst::xre::xfst_curly_label_to_transducer(compilation, $1,$1);
         free($1);
      }
      | CURLY_BRACKETS PAIR_SEPARATOR CURLY_BRACKETS {
-     	$$ = hfst::xre::xfst_curly_label_to_transducer($1,$3);
+     	$$ = hfst::xre::xfst_curly_label_to_transducer(compilation, $1,$3);
         free($1);
 	free($3);
      }
         // function call
        | FUNCTION REGEXP_LIST RIGHT_PARENTHESIS {
-            if (! hfst::xre::is_valid_function_call($1, $2)) {
+            if (! hfst::xre::is_valid_function_call(compilation, $1, $2)) {
               delete $1; delete $2;
               return EXIT_FAILURE;
             }
             else {
               // create a new scanner for evaluating the function
               yyscan_t scanner;
-              xrelex_init(&scanner);
-              YY_BUFFER_STATE bs = xre_scan_string(hfst::xre::get_function_xre($1),scanner);
+              xrelex_init_extra(&compilation, &scanner);
+              YY_BUFFER_STATE bs = xre_scan_string(hfst::xre::get_function_xre(compilation, $1),scanner);
 
               // define special variables so that function arguments get the values given in regexp list
-              if (! hfst::xre::define_function_args($1, $2))
+              if (! hfst::xre::define_function_args(compilation, $1, $2))
               {
-                xreerror("Could not define function args.\n");  // TODO: more informative message
+                xreerror(compilation, "Could not define function args.\n");  // TODO: more informative message
                 free($1); delete $2;
                 YYABORT;
               }
@@ -1233,18 +1203,18 @@ LABEL: HALFARC {
               delete $2;
               // if we are scanning a function definition for argument symbols,
               // do not include the characters read when evaluating functions inside it
-              unsigned int chars_read = hfst::xre::cr;
+              unsigned int chars_read = compilation.cr;
 
-              int parse_retval = xreparse(scanner);
+              int parse_retval = xreparse(scanner, compilation);
 
-              hfst::xre::cr = chars_read;
-              hfst::xre::undefine_function_args($1);
+              compilation.cr = chars_read;
+              hfst::xre::undefine_function_args(compilation, $1);
               free($1);
 
               xre_delete_buffer(bs,scanner);
               xrelex_destroy(scanner);
 
-              $$ = hfst::xre::last_compiled;
+              $$ = compilation.last_compiled;
 
               if (parse_retval != 0)
               {
@@ -1263,11 +1233,11 @@ LABEL: HALFARC {
 
 SYMBOL_OR_QUOTED: SYMBOL
      | MULTICHAR_SYMBOL {
-       hfst::xre::check_multichar_symbol($1);
+       hfst::xre::check_multichar_symbol(compilation, $1);
        $$ = $1;
      }
      | QUOTED_MULTICHAR_LITERAL {
-       hfst::xre::check_multichar_symbol($1);
+       hfst::xre::check_multichar_symbol(compilation, $1);
        $$ = $1;
      }
      | QUOTED_LITERAL
@@ -1278,8 +1248,8 @@ HALFARC: SYMBOL_OR_QUOTED
        // Symbols of form <foo> are not harmonized in xfst, that is why
        // they need to be escaped as @_<foo>_@.
        // $$ = hfst::xre::escape_enclosing_angle_brackets($1);
-       hfst::xre::warn_about_hfst_special_symbol($1);
-       hfst::xre::warn_about_xfst_special_symbol($1);
+       hfst::xre::warn_about_hfst_special_symbol(compilation, $1);
+       hfst::xre::warn_about_xfst_special_symbol(compilation, $1);
        $$ = $1;
      }
      | EPSILON_TOKEN {
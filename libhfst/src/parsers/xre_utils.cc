@@ -29,71 +29,62 @@ using std::ostringstream;
 struct yy_buffer_state;
 typedef yy_buffer_state * YY_BUFFER_STATE;
 typedef void * yyscan_t;
-extern int xreparse(yyscan_t);
-extern int xrelex_init (yyscan_t*);
+extern int xreparse(yyscan_t, hfst::xre::XreCompilation &);
+extern int xrelex_init_extra (hfst::xre::XreCompilation *, yyscan_t*);
 extern YY_BUFFER_STATE xre_scan_string (const char *, yyscan_t);
 extern void xre_delete_buffer (YY_BUFFER_STATE, yyscan_t);
 extern int xrelex_destroy (yyscan_t);
 extern char * xreget_text(yyscan_t);
 
-namespace hfst {
-  namespace xre {
-    extern unsigned int cr; // number of characters read, defined in XreCompiler.cc
-    extern unsigned int lr; // number of lines read, defined in XreCompiler.cc
-    bool allow_extra_text_at_end = false;
-    extern std::ostream * error_;
-    extern bool verbose_;
-    extern std::set<std::string> * defined_multichar_symbols_;
-  }
-}
+using hfst::xre::XreCompilation;
 
-std::ostream * xreerrstr()
+std::ostream * xreerrstr(XreCompilation & compilation)
 {
-  return hfst::xre::XreCompiler::get_stream(hfst::xre::error_);
+  return compilation.compiler.get_stream(compilation.error);
 }
 
-void xreflush(std::ostream * os)
+void xreflush(XreCompilation & compilation, std::ostream * os)
 {
-  hfst::xre::XreCompiler::flush(os);
+  compilation.compiler.flush(os);
 }
 
-int xreerror(yyscan_t scanner, const char* msg)
+int xreerror(yyscan_t scanner, XreCompilation & compilation, const char* msg)
 {
-  if (hfst::xre::verbose_)
+  if (compilation.verbose)
     {
       const char * scanner_msg = xreget_text(scanner);
 
-      char * buffer = (char*) malloc(strlen(msg) + strlen(hfst::xre::data) + strlen(scanner_msg) + 100);
+      char * buffer = (char*) malloc(strlen(msg) + strlen(compilation.data) + strlen(scanner_msg) + 100);
 
       int n = sprintf(buffer, "*** xre parsing failed: %s\n", msg);
-      if (strlen(hfst::xre::data) < 60)
+      if (strlen(compilation.data) < 60)
         {
-          n = sprintf(buffer+n, "***    parsing %s [near %s] on line %u\n%c", hfst::xre::data,
-                      xreget_text(scanner), hfst::xre::lr, '\0');
+          n = sprintf(buffer+n, "***    parsing %s [near %s] on line %u\n%c", compilation.data,
+                      xreget_text(scanner), compilation.lr, '\0');
         }
       else
         {
           n = sprintf(buffer+n, "***    parsing %60s [near %s] on line %u...\n%c",
-                      hfst::xre::data, xreget_text(scanner), hfst::xre::lr, '\0');
+                      compilation.data, xreget_text(scanner), compilation.lr, '\0');
         }
 
-      std::ostream * err = xreerrstr();
+      std::ostream * err = xreerrstr(compilation);
       *(err) << std::string(buffer);
       free(buffer);
-      xreflush(err);
+      xreflush(compilation, err);
     }
   return 0;
 }
 
 int
-xreerror(const char *msg)
+xreerror(XreCompilation & compilation, const char *msg)
 {
   char buffer [1024];
   (void) sprintf(buffer, "*** xre parsing failed: %s\n", msg);
   buffer[1023] = '\0';
-  std::ostream * err = xreerrstr();
+  std::ostream * err = xreerrstr(compilation);
   *err << std::string(buffer);
-  xreflush(err);
+  xreflush(compilation, err);
   return 0;
 }
 
@@ -102,42 +93,22 @@ namespace hfst
 namespace xre
 {
 
-  char* data;
-  std::map<std::string,hfst::HfstTransducer*> definitions;
-  std::map<std::string,std::string>  function_definitions;
-  std::map<std::string,unsigned int> function_arguments;
-  std::map<std::string,std::set<string> > symbol_lists;
-  char* startptr; // changed this to an internal variable in compile functions
-hfst::HfstTransducer* last_compiled;
-bool contains_only_comments = false;
-hfst::ImplementationType format;
-size_t len;
-
-  bool expand_definitions=false;
-  bool harmonize_=true;
-  bool harmonize_flags_=false;
-  //bool verbose_=false;
-
-  std::string substitution_function_symbol;
-
-void set_substitution_function_symbol(const std::string &symbol)
-{
-  substitution_function_symbol=symbol;
-}
-
-bool substitution_function(const hfst::StringPair &p, hfst::StringPairSet &sps)
+HfstSymbolPairSubstitutions identity_substitutions
+(const HfstTransducer & t, const std::string & symbol)
 {
-  if (p.first == substitution_function_symbol ||
-      p.second == substitution_function_symbol)
+  HfstSymbolPairSubstitutions substitutions;
+  hfst::implementations::HfstBasicTransducer basic(t);
+  StringPairSet sps = basic.get_transition_pairs();
+  for (StringPairSet::const_iterator it = sps.begin(); it != sps.end(); it++)
     {
-      sps.insert(hfst::StringPair(substitution_function_symbol,
-                                  substitution_function_symbol));
-      return true;
+      if ((it->first == symbol) != (it->second == symbol))
+        {
+          substitutions[*it] = StringPair(symbol, symbol);
+        }
     }
-  return false;
+  return substitutions;
 }
 
-
 int*
 get_n_to_k(const char* s)
 {
@@ -161,20 +132,6 @@ get_n_to_k(const char* s)
 
 
 
-int
-getinput(char *buf, int maxlen)
-{
-    int retval = 0;
-    if ( maxlen > (int)len ) {
-        maxlen = hfst::size_t_to_int(len);
-    }
-    memcpy(buf, data, maxlen);
-    data += maxlen;
-    len -= maxlen;
-    retval = maxlen;
-    return retval;
-}
-
 char*
 strip_newline(char *s)
 {
@@ -187,29 +144,29 @@ strip_newline(char *s)
 }
 
 void 
-count_lines(const char * s)
+count_lines(XreCompilation & compilation, const char * s)
 {
   const char * c = s;
   while(*c != '\0')
     {
       if (*c == '\n')
         {
-          hfst::xre::lr += 1;
+          compilation.lr += 1;
         }
       else if (*c == '\r')
         {
           c++;
           if (*c == '\n')
             {
-              hfst::xre::cr += 1;
+              compilation.cr += 1;
             }
           else
             {
               c--;
             }
-          hfst::xre::lr += 1;
+          compilation.lr += 1;
         }
-      hfst::xre::cr += 1;
+      compilation.cr += 1;
       c++;
     }
 }
@@ -317,9 +274,9 @@ get_quoted(const char *s)
 }
 
 char*
-parse_quoted(const char *s, unsigned int & length)
+parse_quoted(XreCompilation & compilation, const char *s, unsigned int & length)
 {
-  std::ostream * err = xreerrstr();
+  std::ostream * err = xreerrstr(compilation);
 
     char* quoted = get_quoted(s);
 
@@ -351,7 +308,7 @@ parse_quoted(const char *s, unsigned int & length)
               case '6':
               case '7':
                 *err << "*** XRE unimplemented: parse octal escape in " << std::string(p);
-                xreflush(err);
+                xreflush(compilation, err);
                 *r = '\0';
                 p = p + 5;
                 break;
@@ -387,7 +344,7 @@ parse_quoted(const char *s, unsigned int & length)
                 break;
               case 'u':
                 *err << "Unimplemented: parse unicode escapes in " << std::string(p);
-                xreflush(err);
+                xreflush(compilation, err);
                 *r = '\0';
                 r++;
                 p = p + 6;
@@ -408,7 +365,7 @@ parse_quoted(const char *s, unsigned int & length)
                     else
                       {
                         *err << "*** XRE unimplemented: parse \\x" << i << std::endl;
-                        xreflush(err);
+                        xreflush(compilation, err);
                         //fprintf(stderr, "*** XRE unimplemented: "
                         //        "parse \\x%d\n", i);
                         *r = '\0';
@@ -420,7 +377,7 @@ parse_quoted(const char *s, unsigned int & length)
                 }
               case '\0':
                 *err << "End of line after \\ escape" << std::endl;
-                xreflush(err);
+                xreflush(compilation, err);
                 //fprintf(stderr, "End of line after \\ escape\n");
                 *r = '\0';
                 r++;
@@ -511,42 +468,28 @@ get_weight(const char *s)
     return rv;
 }
 
-HfstTransducer*
-compile(const string& xre, map<string,HfstTransducer*>& defs,
-        map<string, string>& func_defs,
-        map<string, unsigned int > func_args,
-        map<string, std::set<string> >& lists,
-        ImplementationType impl)
+// Parse the expression of \a compilation, returning the result or NULL
+static HfstTransducer*
+parse(XreCompilation & compilation)
 {
-    // lock here?
-    data = strdup(xre.c_str());
-    // use an internal variable startptr_ instead of global startptr
-    char * startptr_ = data;
-    len = strlen(data);
-    definitions = defs;
-    function_definitions = func_defs;
-    function_arguments = func_args;
-    symbol_lists = lists;
-    format = impl;
-
-    contains_only_comments = false;
+    // The scanner reads a copy of the expression
+    char * startptr = strdup(compilation.data);
+    compilation.contains_only_comments = false;
 
     yyscan_t scanner;
-    xrelex_init(&scanner);
-    YY_BUFFER_STATE bs = xre_scan_string(startptr_,scanner);
-    
-    int parse_retval = xreparse(scanner);
+    xrelex_init_extra(&compilation, &scanner);
+    YY_BUFFER_STATE bs = xre_scan_string(startptr,scanner);
+
+    int parse_retval = xreparse(scanner, compilation);
 
     xre_delete_buffer(bs,scanner);
     xrelex_destroy(scanner);
 
-    free(startptr_);
-    data = 0;
-    len = 0;
-    if (parse_retval == 0 && !contains_only_comments) // if (yynerrs == 0)
+    free(startptr);
+    if (parse_retval == 0 && !compilation.contains_only_comments) // if (yynerrs == 0)
       {
-        HfstTransducer* rv = new HfstTransducer(*last_compiled);
-        delete last_compiled;
+        HfstTransducer* rv = new HfstTransducer(*compilation.last_compiled);
+        delete compilation.last_compiled;
         return rv;
       }
     else
@@ -555,74 +498,36 @@ compile(const string& xre, map<string,HfstTransducer*>& defs,
       }
 }
 
-  // todo: Contains lots of code copied directly from compile(...), should be rewritten..
 HfstTransducer*
-compile_first(const string& xre, map<string,HfstTransducer*>& defs,
-              map<string, string>& func_defs,
-              map<string, unsigned int > func_args,
-              map<string, std::set<string> >& lists,
-              ImplementationType impl,
-              unsigned int & chars_read)
+compile(XreCompilation & compilation)
 {
-    // lock here?
-    data = strdup(xre.c_str());
-    // use an internal variable startptr_ instead of global startptr
-    char * startptr_ = data;
-    len = strlen(data);
-    definitions = defs;
-    function_definitions = func_defs;
-    function_arguments = func_args;
-    symbol_lists = lists;
-    format = impl;
-
-    contains_only_comments = false;
-
-    yyscan_t scanner;
-    xrelex_init(&scanner);
-    YY_BUFFER_STATE bs = xre_scan_string(startptr_,scanner);
-
-    bool tmp = hfst::xre::allow_extra_text_at_end;
-    hfst::xre::allow_extra_text_at_end = true;
-    hfst::xre::cr = 0;
-    hfst::xre::lr = 1;
-
-    int parse_retval = xreparse(scanner);
-    chars_read = hfst::xre::cr;
-    hfst::xre::allow_extra_text_at_end = tmp;
-
-    xre_delete_buffer(bs,scanner);
-    xrelex_destroy(scanner);
-
-    free(startptr_);
+    return parse(compilation);
+}
 
-    data = 0;
-    len = 0;
-    if (parse_retval == 0 && !contains_only_comments) // if (yynerrs == 0)
-      {
-        HfstTransducer* rv = new HfstTransducer(*last_compiled);
-        delete last_compiled;
-        return rv;
-      }
-    else
-      {
-        return NULL;
-      }
+HfstTransducer*
+compile_first(XreCompilation & compilation, unsigned int & chars_read)
+{
+    compilation.allow_extra_text_at_end = true;
+    HfstTransducer * retval = parse(compilation);
+    chars_read = compilation.cr;
+    return retval;
 }
 
 bool is_valid_function_call
-(const char * name, const std::vector<HfstTransducer> * args)
+(XreCompilation & compilation, const char * name,
+ const std::vector<HfstTransducer> * args)
 {
   std::map<std::string, std::string>::const_iterator name2xre
-    = function_definitions.find(name);
+    = compilation.function_definitions.find(name);
   std::map<std::string, unsigned int >::const_iterator name2args
-    = function_arguments.find(name);
+    = compilation.function_arguments.find(name);
 
-  if (name2xre == function_definitions.end() ||
-      name2args == function_arguments.end())
+  if (name2xre == compilation.function_definitions.end() ||
+      name2args == compilation.function_arguments.end())
     {
-      std::ostream * err = xreerrstr();
+      std::ostream * err = xreerrstr(compilation);
       *err << "No such function defined: '" << name << "'" << std::endl;
-      xreflush(err);
+      xreflush(compilation, err);
       //fprintf(stderr, "No such function defined: '%s'\n", name);
       return false;
     }
@@ -631,10 +536,10 @@ bool is_valid_function_call
 
   if ( number_of_args != args->size())
     {
-      std::ostream * err = xreerrstr();
+      std::ostream * err = xreerrstr(compilation);
       *err << "Wrong number of arguments: function '" << name << "' expects "
                            << (int)number_of_args << ", " << (int)args->size() << " given" << std::endl;
-      xreflush(err);
+      xreflush(compilation, err);
         //fprintf(stderr, "Wrong number of arguments: function '%s' expects %i, %i given\n",
         //       name, (int)number_of_args, (int)args->size());
       return false;
@@ -643,20 +548,21 @@ bool is_valid_function_call
   return true;
 }
 
-const char * get_function_xre(const char * name)
+const char * get_function_xre(XreCompilation & compilation, const char * name)
 {
   std::map<std::string,std::string>::const_iterator it
-    = function_definitions.find(name);
-  if (it == function_definitions.end())
+    = compilation.function_definitions.find(name);
+  if (it == compilation.function_definitions.end())
     {
       return NULL;
     }
   return it->second.c_str();
 }
 
-bool define_function_args(const char * name, const std::vector<HfstTransducer> * args)
+bool define_function_args(XreCompilation & compilation, const char * name,
+                          const std::vector<HfstTransducer> * args)
 {
-  if (! is_valid_function_call(name, args))
+  if (! is_valid_function_call(compilation, name, args))
     {
       return false;
     }
@@ -667,7 +573,7 @@ bool define_function_args(const char * name, const std::vector<HfstTransducer> *
       ostringstream os;
       os << arg_number;
       std::string function_arg = "@" + std::string(name) + os.str() + "@";
-      definitions[function_arg] = new HfstTransducer(*it);
+      compilation.definitions[function_arg] = new HfstTransducer(*it);
       //fprintf(stderr, "defined function arg: '%s', %i:\n", name, arg_number); // DEBUG
       //std::cerr << *it << std::endl;
       arg_number++;
@@ -675,10 +581,10 @@ bool define_function_args(const char * name, const std::vector<HfstTransducer> *
   return true;
 }
 
-void undefine_function_args(const char * name)
+void undefine_function_args(XreCompilation & compilation, const char * name)
 {
-  std::map<std::string, unsigned int>::const_iterator it = function_arguments.find(name);
-  if (it == function_arguments.end())
+  std::map<std::string, unsigned int>::const_iterator it = compilation.function_arguments.find(name);
+  if (it == compilation.function_arguments.end())
     {
       return;
     }
@@ -687,27 +593,27 @@ void undefine_function_args(const char * name)
       ostringstream os;
       os << arg_number;
       std::string function_arg = "@" + std::string(name) + os.str() + "@";
-      delete definitions[function_arg];
-      definitions.erase(function_arg);
+      delete compilation.definitions[function_arg];
+      compilation.definitions.erase(function_arg);
       //fprintf(stderr, "undefined function arg: '%s', %i:\n", name, arg_number); // DEBUG
     }
 }
 
-bool is_definition(const char* symbol)
+bool is_definition(XreCompilation & compilation, const char* symbol)
 {
   std::string symbol_(symbol);
-  if (definitions.find(symbol_) == definitions.end())
+  if (compilation.definitions.find(symbol_) == compilation.definitions.end())
     return false;
   return true;
 }
 
 HfstTransducer*
-expand_definition(const char* symbol)
+expand_definition(XreCompilation & compilation, const char* symbol)
 {
-  if (expand_definitions)
+  if (compilation.expand_definitions)
     {
       for (std::map<std::string,hfst::HfstTransducer*>::const_iterator it
-             = definitions.begin(); it != definitions.end(); it++)
+             = compilation.definitions.begin(); it != compilation.definitions.end(); it++)
         {
           if (strcmp(it->first.c_str(), symbol) == 0)
             {
@@ -715,17 +621,18 @@ expand_definition(const char* symbol)
             }
         }
     }
-  return new HfstTransducer(symbol, symbol, hfst::xre::format);
+  return new HfstTransducer(symbol, symbol, compilation.format);
 }
 
 
 HfstTransducer*
-expand_definition(HfstTransducer* tr, const char* symbol)
+expand_definition(XreCompilation & compilation, HfstTransducer* tr,
+                  const char* symbol)
 {
-  if (expand_definitions)
+  if (compilation.expand_definitions)
     {
       for (std::map<std::string,hfst::HfstTransducer*>::const_iterator it
-             = definitions.begin(); it != definitions.end(); it++)
+             = compilation.definitions.begin(); it != compilation.definitions.end(); it++)
         {
           if (strcmp(it->first.c_str(), symbol) == 0)
             {
@@ -754,7 +661,8 @@ expand_definition(HfstTransducer* tr, const char* symbol)
   }*/
 
 HfstTransducer*
-xfst_curly_label_to_transducer(const char* input, const char* output)
+xfst_curly_label_to_transducer(XreCompilation & compilation,
+                               const char* input, const char* output)
 {
   HfstTransducer * retval = NULL;
 
@@ -764,18 +672,18 @@ xfst_curly_label_to_transducer(const char* input, const char* output)
       StringVector sv = tok.tokenize_one_level(output);
       std::string first_token(sv.at(0));
       retval = new HfstTransducer
-        (hfst::internal_unknown, first_token, hfst::xre::format);
+        (hfst::internal_unknown, first_token, compilation.format);
 
       for (StringVector::const_iterator it = sv.begin();
            it != sv.end(); it++)
         {
-          HfstTransducer tmp(*it, first_token, hfst::xre::format);
+          HfstTransducer tmp(*it, first_token, compilation.format);
           retval->disjunct(tmp, false);
         }
       for (StringVector::const_iterator it = ++(sv.begin());
            it != sv.end(); it++)
         {
-          HfstTransducer tmp(hfst::internal_epsilon, *it, hfst::xre::format);
+          HfstTransducer tmp(hfst::internal_epsilon, *it, compilation.format);
           retval->concatenate(tmp, false);
         }
     }
@@ -785,18 +693,18 @@ xfst_curly_label_to_transducer(const char* input, const char* output)
       StringVector sv = tok.tokenize_one_level(input);
       std::string first_token(sv.at(0));
       retval = new HfstTransducer
-        (first_token, hfst::internal_unknown, hfst::xre::format);
+        (first_token, hfst::internal_unknown, compilation.format);
 
       for (StringVector::const_iterator it = sv.begin();
            it != sv.end(); it++)
         {
-          HfstTransducer tmp(first_token, *it, hfst::xre::format);
+          HfstTransducer tmp(first_token, *it, compilation.format);
           retval->disjunct(tmp, false);
         }
       for (StringVector::const_iterator it = ++(sv.begin());
            it != sv.end(); it++)
         {
-          HfstTransducer tmp(*it, hfst::internal_epsilon, hfst::xre::format);
+          HfstTransducer tmp(*it, hfst::internal_epsilon, compilation.format);
           retval->concatenate(tmp, false);
         }
     }
@@ -806,7 +714,7 @@ xfst_curly_label_to_transducer(const char* input, const char* output)
       std::string ostr(output);
       HfstTokenizer tok;
       tok.add_multichar_symbol(hfst::internal_epsilon);
-      retval = new HfstTransducer(istr, ostr, tok, hfst::xre::format);
+      retval = new HfstTransducer(istr, ostr, tok, compilation.format);
     }
 
   retval->minimize(); // it should be safe to minimize
@@ -814,12 +722,13 @@ xfst_curly_label_to_transducer(const char* input, const char* output)
 }
 
 HfstTransducer*
-xfst_label_to_transducer(const char* input, const char* output)
+xfst_label_to_transducer(XreCompilation & compilation,
+                         const char* input, const char* output)
 {
   HfstTransducer * retval = NULL;
 
-  bool input_is_definition = is_definition(input);
-  bool output_is_definition = is_definition(output);
+  bool input_is_definition = is_definition(compilation, input);
+  bool output_is_definition = is_definition(compilation, output);
   bool input_is_unknown = (strcmp(input, hfst::internal_unknown.c_str()) == 0);
   bool output_is_unknown = (strcmp(output, hfst::internal_unknown.c_str()) == 0);
 
@@ -829,18 +738,18 @@ xfst_label_to_transducer(const char* input, const char* output)
       HfstTransducer * tmp = NULL; // temporary transducer for cross-product calculation
       if (input_is_unknown)
         {
-          retval = new HfstTransducer(hfst::internal_identity, hfst::xre::format);
-          tmp = expand_definition(output);
+          retval = new HfstTransducer(hfst::internal_identity, compilation.format);
+          tmp = expand_definition(compilation, output);
         }
       else if (output_is_unknown)
         {
-          tmp = new HfstTransducer(hfst::internal_identity, hfst::xre::format);
-          retval = expand_definition(input);
+          tmp = new HfstTransducer(hfst::internal_identity, compilation.format);
+          retval = expand_definition(compilation, input);
         }
       else // neither is unknown
         {
-          retval = expand_definition(input);
-          tmp = expand_definition(output);
+          retval = expand_definition(compilation, input);
+          tmp = expand_definition(compilation, output);
         }
       retval->cross_product(*tmp);
       delete tmp;
@@ -850,25 +759,25 @@ xfst_label_to_transducer(const char* input, const char* output)
   // no definitions
   if  (input_is_unknown && output_is_unknown)
     {
-      retval = new HfstTransducer(hfst::internal_unknown, hfst::internal_unknown, hfst::xre::format);
-      HfstTransducer id(hfst::internal_identity, hfst::internal_identity, hfst::xre::format);
+      retval = new HfstTransducer(hfst::internal_unknown, hfst::internal_unknown, compilation.format);
+      HfstTransducer id(hfst::internal_identity, hfst::internal_identity, compilation.format);
       retval->disjunct(id).minimize(); // it should be safe to minimize
     }
   else if (input_is_unknown)
     {
-      retval = new HfstTransducer(hfst::internal_unknown, output, hfst::xre::format);
-      HfstTransducer output_tr(output, output, hfst::xre::format);
+      retval = new HfstTransducer(hfst::internal_unknown, output, compilation.format);
+      HfstTransducer output_tr(output, output, compilation.format);
       retval->disjunct(output_tr).minimize(); // it should be safe to minimize
     }
   else if (output_is_unknown)
     {
-      retval = new HfstTransducer(input, hfst::internal_unknown, hfst::xre::format);
-      HfstTransducer input_tr(input, input, hfst::xre::format);
+      retval = new HfstTransducer(input, hfst::internal_unknown, compilation.format);
+      HfstTransducer input_tr(input, input, compilation.format);
       retval->disjunct(input_tr).minimize(); // it should be safe to minimize
     }
   else
     {
-      retval = new HfstTransducer(input, output, hfst::xre::format);
+      retval = new HfstTransducer(input, output, compilation.format);
     }
   return retval;
 }
@@ -920,7 +829,7 @@ xfst_label_to_transducer(const char* input, const char* output)
 
   HfstTransducer * contains(const HfstTransducer * t)
   {
-    HfstTransducer any(hfst::internal_identity, hfst::xre::format);
+    HfstTransducer any(hfst::internal_identity, t->get_type());
     any.repeat_star().minimize(); // it should be safe to minimize
     HfstTransducer * retval = new HfstTransducer(any);
     retval->concatenate(*t).concatenate(any);
@@ -931,9 +840,9 @@ xfst_label_to_transducer(const char* input, const char* output)
   // [ 0::weight -> 0 || _ [t] ] - [?* - $[t]]
   HfstTransducer * contains_with_weight(const HfstTransducer * t, float weight)
   {
-    HfstTransducer weighted_epsilon(hfst::internal_epsilon, hfst::xre::format);
+    HfstTransducer weighted_epsilon(hfst::internal_epsilon, t->get_type());
     weighted_epsilon.set_final_weights(weight);
-    HfstTransducer epsilon(hfst::internal_epsilon, hfst::xre::format);
+    HfstTransducer epsilon(hfst::internal_epsilon, t->get_type());
 
     // mapping: 0::weight -> 0
     HfstTransducerPair mappingPair(weighted_epsilon, epsilon);
@@ -948,7 +857,7 @@ xfst_label_to_transducer(const char* input, const char* output)
     // weighted_rule = [ 0::weight @-> 0 || _ [t] ]
     // (add weight for each occurrence of t)
     hfst::xeroxRules::Rule rule(mappingPairVector, contextPairVector, hfst::xeroxRules::REPL_UP);
-    HfstTransducer weighted_rule(hfst::xre::format);
+    HfstTransducer weighted_rule(t->get_type());
     weighted_rule = replace(rule, false);
 
     // note that replace_leftmost_longest_match does not work correctly in the case of epsilons
@@ -973,11 +882,11 @@ xfst_label_to_transducer(const char* input, const char* output)
   HfstTransducer * contains_once(const HfstTransducer * c)
   {
     // any_star = [?*]
-    HfstTransducer any_star(hfst::internal_identity, hfst::xre::format);
+    HfstTransducer any_star(hfst::internal_identity, c->get_type());
     any_star.repeat_star().minimize(); // it should be safe to minimize
 
     // any_plus = [?+]
-    HfstTransducer any_plus(hfst::internal_identity, hfst::xre::format);
+    HfstTransducer any_plus(hfst::internal_identity, c->get_type());
     any_plus.repeat_plus().minimize(); // it should be safe to minimize
 
     // t1 = [?+ c ?*]
@@ -1023,7 +932,7 @@ xfst_label_to_transducer(const char* input, const char* output)
   {
     // neg_t = ~$[t]
     HfstTransducer * cont_t = contains(t);
-    HfstTransducer neg_t(hfst::internal_identity, hfst::xre::format);
+    HfstTransducer neg_t(hfst::internal_identity, t->get_type());
     neg_t.repeat_star();
     neg_t.optimize();
     neg_t.subtract(*cont_t);
@@ -1036,31 +945,33 @@ xfst_label_to_transducer(const char* input, const char* output)
     return retval;
   }
 
-  HfstTransducer * merge_first_to_second(HfstTransducer * tr1, HfstTransducer * tr2)
+  HfstTransducer * merge_first_to_second(XreCompilation & compilation,
+                                         HfstTransducer * tr1, HfstTransducer * tr2)
   {
     // Merge operation creates an XreCompiler that needs this information below. Otherwise, it will overwrite all this.
-    struct XreConstructorArguments args(hfst::xre::definitions, hfst::xre::function_definitions, hfst::xre::function_arguments, hfst::xre::symbol_lists, hfst::xre::format);
+    struct XreConstructorArguments args(compilation.definitions, compilation.function_definitions, compilation.function_arguments, compilation.symbol_lists, compilation.format);
 
     tr1->optimize();
     tr2->merge(*tr1, args);
     return tr2;
   }
 
-  void warn(const char * msg)
+  void warn(XreCompilation & compilation, const char * msg)
   {
-    if (!verbose_)
+    if (!compilation.verbose)
       return;
     
-    std::ostream * err = xreerrstr();
+    std::ostream * err = xreerrstr(compilation);
     *err << msg;
-    xreflush(err);
+    xreflush(compilation, err);
   }
 
-void warn_about_xfst_special_symbol(const char * symbol)
+void warn_about_xfst_special_symbol(XreCompilation & compilation,
+                                    const char * symbol)
 {
   if (strcmp("all", symbol) == 0) {
-    if (verbose_) {
-      warn("warning: symbol 'all' has no special meaning in hfst\n"); }
+    if (compilation.verbose) {
+      warn(compilation, "warning: symbol 'all' has no special meaning in hfst\n"); }
     return;
   }
 
@@ -1075,14 +986,15 @@ void warn_about_xfst_special_symbol(const char * symbol)
 
   if (symbol[max_index] != '>')
     return;
-  if (!verbose_)
+  if (!compilation.verbose)
     return;
-  std::ostream * err = xreerrstr();
+  std::ostream * err = xreerrstr(compilation);
   *err << "warning: '" << symbol << " ' is an ordinary symbol in hfst" << std::endl;
-  xreflush(err);
+  xreflush(compilation, err);
 }
 
-void warn_about_hfst_special_symbol(const char * symbol)
+void warn_about_hfst_special_symbol(XreCompilation & compilation,
+                                    const char * symbol)
 {
   if (symbol[0] != '@')
     return;
@@ -1098,22 +1010,23 @@ void warn_about_hfst_special_symbol(const char * symbol)
     return;
   if (symbol[max_index-1] != '_')
     return;
-  if (!verbose_)
+  if (!compilation.verbose)
     return;
-  if (hfst::xre::verbose_)
+  if (compilation.verbose)
     {
-      std::ostream * err = xreerrstr();
+      std::ostream * err = xreerrstr(compilation);
       *err << "warning: '" << symbol << "' is not an ordinary symbol in hfst" << std::endl;
-      xreflush(err);
+      xreflush(compilation, err);
     }
 }
 
-void warn_about_special_symbols_in_replace(HfstTransducer * t)
+void warn_about_special_symbols_in_replace(XreCompilation & compilation,
+                                           HfstTransducer * t)
 {
-  if (!verbose_)
+  if (!compilation.verbose)
     return;
 
-  std::ostream * err = xreerrstr();
+  std::ostream * err = xreerrstr(compilation);
 
   StringSet alphabet = t->get_alphabet();
   for (StringSet::const_iterator it = alphabet.begin();
@@ -1127,21 +1040,63 @@ void warn_about_special_symbols_in_replace(HfstTransducer * t)
           *err << "warning: using special symbol '" << *it << "' in replace rule, use substitute instead" << std::endl;
         }
     }
-  xreflush(err);
+  xreflush(compilation, err);
 }
 
-void check_multichar_symbol(const char * symbol)
+void check_multichar_symbol(XreCompilation & compilation, const char * symbol)
 {
-  if (defined_multichar_symbols_ == NULL)
+  if (compilation.defined_multichar_symbols == NULL)
     return;
   
-  if (defined_multichar_symbols_->find(std::string(symbol)) ==
-      defined_multichar_symbols_->end())
+  if (compilation.defined_multichar_symbols->find(std::string(symbol)) ==
+      compilation.defined_multichar_symbols->end())
     {
-      std::ostream * err = xreerrstr();
+      std::ostream * err = xreerrstr(compilation);
       *err << "warning: multichar symbol '" << symbol << "' used but not defined" << std::endl;
-      xreflush(err);
+      xreflush(compilation, err);
+    }
+}
+
+bool is_weighted(XreCompilation & compilation)
+{
+  return (compilation.format == hfst::TROPICAL_OPENFST_TYPE ||
+          compilation.format == hfst::LOG_OPENFST_TYPE);
+}
+
+static float zero_weight(float)
+{
+  return 0;
+}
+
+static bool has_weights(const HfstTransducer & t)
+{
+  hfst::implementations::HfstBasicTransducer basic(t);
+  for (hfst::implementations::HfstState s = 0;
+       s <= basic.get_max_state(); s++)
+    {
+      if (basic.is_final_state(s) && basic.get_final_weight(s) != 0)
+        return true;
+      const hfst::implementations::HfstBasicTransitions & transitions
+        = basic.transitions(s);
+      for (hfst::implementations::HfstBasicTransitions::const_iterator it
+             = transitions.begin(); it != transitions.end(); it++)
+        {
+          if (it->get_weight() != 0)
+            return true;
+        }
+    }
+  return false;
+}
+
+void zero_weights(XreCompilation & compilation, HfstTransducer & t)
+{
+  if (compilation.verbose && !compilation.has_weight_been_zeroed &&
+      has_weights(t))
+    {
+      warn(compilation, "warning: ignoring weights in rule context\n");
+      compilation.has_weight_been_zeroed = true;
     }
+  t.transform_weights(&zero_weight);
 }
 
 bool has_non_identity_pairs(const HfstTransducer * t)
@@ -19,28 +19,55 @@
 
 #include <map>
 #include "HfstDataTypes.h"
+#include "HfstSymbolDefs.h"
 
 namespace hfst { namespace xre {
 
-extern char* data;
-extern char* startptr;
-extern size_t len;
-extern std::map<std::string,hfst::HfstTransducer*> definitions;
-extern std::map<std::string,std::string> function_definitions;
-extern std::map<std::string,unsigned int> function_arguments;
-extern std::map<std::string, std::set<std::string> > symbol_lists;
-extern HfstTransducer* last_compiled;
-extern bool contains_only_comments;
-extern ImplementationType format;
+class XreCompiler;
 
-void set_substitution_function_symbol(const std::string &symbol);
-
-bool substitution_function(const hfst::StringPair &p, hfst::StringPairSet &sps);
+/**
+ * @brief The state of one regular expression compilation: the
+ * definitions and settings of the compiler and what has been read. The
+ * parser and the scanner get it as a parameter, so regular expressions
+ * can be compiled in several threads at the same time, each with its own
+ * XreCompiler.
+ */
+struct XreCompilation
+{
+    XreCompiler & compiler; // for the error stream
+    const char * data; // the regular expression, for error messages
+    std::map<std::string,hfst::HfstTransducer*> definitions;
+    std::map<std::string,std::string> function_definitions;
+    std::map<std::string,unsigned int> function_arguments;
+    std::map<std::string, std::set<std::string> > symbol_lists;
+    HfstTransducer* last_compiled;
+    bool contains_only_comments;
+    ImplementationType format;
+    unsigned int cr; // number of characters read
+    unsigned int lr; // number of lines read
+    bool allow_extra_text_at_end;
+    // The positions of position_symbol, if it is given
+    const char * position_symbol;
+    std::set<unsigned int> positions;
+    // To warn only once about weights in rule contexts
+    bool has_weight_been_zeroed;
+    // Settings of the compiler
+    std::ostream * error;
+    bool verbose;
+    bool expand_definitions;
+    bool harmonize;
+    bool harmonize_flags;
+    const std::set<std::string> * defined_multichar_symbols;
+
+    XreCompilation(XreCompiler & compiler, const std::string & xre);
+};
 
 /**
- * @brief input handling function for flex that parses strings.
+ * @brief The transition pairs of \a t that have \a symbol on one side but
+ * not on both, each substituted with symbol:symbol.
  */
-int getinput(char *buf, int maxlen);
+HfstSymbolPairSubstitutions identity_substitutions
+(const HfstTransducer & t, const std::string & symbol);
 
 
 /**
@@ -55,7 +82,7 @@ char* strip_percents(const char *s);
 
  char* strip_newline(char *s);
 
- void count_lines(const char * s);
+ void count_lines(XreCompilation & compilation, const char * s);
 
 /**
  * @brief add percents to string to form valid XRE symbol.
@@ -67,7 +94,8 @@ char* add_percents(const char* s);
  */
 char* get_quoted(const char *s);
 
- char* parse_quoted(const char *s, unsigned int & length);
+ char* parse_quoted(XreCompilation & compilation, const char *s,
+                    unsigned int & length);
 
 int* get_n_to_k(const char* s);
 
@@ -87,46 +115,45 @@ HfstTransducer* unescape_enclosing_angle_brackets(HfstTransducer *t);
 /**
  * @brief compile new transducer
  */
-HfstTransducer* compile(const std::string& xre,
-                        std::map<std::string,hfst::HfstTransducer*>& defs,
-                        std::map<std::string,std::string>& func_defs,
-                        std::map<std::string,unsigned int> func_args,
-                        std::map<std::string, std::set<std::string> >& lists,
-                        hfst::ImplementationType type);
+HfstTransducer* compile(XreCompilation & compilation);
 
 /**
- * @brief compile new transducer defined by the first regex in @a xre.
+ * @brief compile new transducer defined by the first regex in
+ * the expression of @a compilation.
  */
-HfstTransducer* compile_first(const std::string& xre,
-                              std::map<std::string,hfst::HfstTransducer*>& defs,
-                              std::map<std::string,std::string>& func_defs,
-                              std::map<std::string,unsigned int> func_args,
-                              std::map<std::string, std::set<std::string> >& lists,
-                              hfst::ImplementationType type,
+HfstTransducer* compile_first(XreCompilation & compilation,
                               unsigned int & chars_read);
 
 /**
  * @brief For a single-transition transducer, if the transition symbol is a name for
  * transducer definition, expand the transition into the corresponding transducer.
  */
-HfstTransducer* expand_definition(HfstTransducer* tr, const char* symbol);
+HfstTransducer* expand_definition(XreCompilation & compilation,
+                                  HfstTransducer* tr, const char* symbol);
 
 // the same but simpler..
-HfstTransducer* expand_definition(const char* symbol);
+HfstTransducer* expand_definition(XreCompilation & compilation,
+                                  const char* symbol);
 
- bool define_function_args(const char * name, const std::vector<HfstTransducer> * args);
- void undefine_function_args(const char * name);
+ bool define_function_args(XreCompilation & compilation, const char * name,
+                           const std::vector<HfstTransducer> * args);
+ void undefine_function_args(XreCompilation & compilation, const char * name);
 
- const char * get_function_xre(const char * name);
+ const char * get_function_xre(XreCompilation & compilation,
+                               const char * name);
 
-bool is_definition(const char* symbol);
+bool is_definition(XreCompilation & compilation, const char* symbol);
 
-bool is_valid_function_call(const char * name, const std::vector<HfstTransducer> * args);
+bool is_valid_function_call(XreCompilation & compilation, const char * name,
+                            const std::vector<HfstTransducer> * args);
 
 /** @brief Parse "input:output", ":output", "input:" or ":". */
- HfstTransducer* xfst_label_to_transducer(const char* input, const char* output);
+ HfstTransducer* xfst_label_to_transducer(XreCompilation & compilation,
+                                          const char* input, const char* output);
 
- HfstTransducer* xfst_curly_label_to_transducer(const char* input, const char* output);
+ HfstTransducer* xfst_curly_label_to_transducer(XreCompilation & compilation,
+                                                const char* input,
+                                                const char* output);
 
  HfstTransducer * contains(const HfstTransducer * t);
 
@@ -139,16 +166,25 @@ bool is_valid_function_call(const char * name, const std::vector<HfstTransducer>
 
  HfstTransducer * contains_once_optional(const HfstTransducer * t);
 
- HfstTransducer * merge_first_to_second(HfstTransducer * tr1, HfstTransducer * tr2);
+ HfstTransducer * merge_first_to_second(XreCompilation & compilation,
+                                        HfstTransducer * tr1, HfstTransducer * tr2);
 
- void warn(const char * msg);
- void warn_about_special_symbols_in_replace(HfstTransducer *t);
+ void warn(XreCompilation & compilation, const char * msg);
+ void warn_about_special_symbols_in_replace(XreCompilation & compilation,
+                                            HfstTransducer *t);
  /* Warn about \a symbol if it is of form "@_.*_@" and verbose mode is on. */
- void warn_about_hfst_special_symbol(const char * symbol);
+ void warn_about_hfst_special_symbol(XreCompilation & compilation,
+                                     const char * symbol);
  /* Warn about \a symbol if it is of form "<.*>" or "all" and verbose mode is on. */
- void warn_about_xfst_special_symbol(const char * symbol);
+ void warn_about_xfst_special_symbol(XreCompilation & compilation,
+                                     const char * symbol);
+
+ void check_multichar_symbol(XreCompilation & compilation, const char * symbol);
 
- void check_multichar_symbol(const char * symbol);
+ /* Whether weights are kept in the format of \a compilation. */
+ bool is_weighted(XreCompilation & compilation);
+ /* Zero weights in rule contexts, warning once. */
+ void zero_weights(XreCompilation & compilation, HfstTransducer & t);
 
  bool has_non_identity_pairs(const HfstTransducer * t);
 
@@ -0,0 +1,70 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+//! @file thread-utils.cc
+//!
+//! @brief Implementation of running independent jobs in several threads.
+
+#include "thread-utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hfst {
+
+// What the threads of one run_in_threads call share
+struct ThreadJobs
+{
+  size_t job_count;
+  const std::function<void(size_t)> * job;
+  std::atomic<size_t> next;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+static void run_thread_jobs(ThreadJobs * jobs)
+{
+  try
+    {
+      size_t i;
+      while ((i = jobs->next++) < jobs->job_count)
+        { (*jobs->job)(i); }
+    }
+  catch (...)
+    {
+      std::lock_guard<std::mutex> lock(jobs->error_mutex);
+      if (! jobs->error)
+        { jobs->error = std::current_exception(); }
+      jobs->next = jobs->job_count;
+    }
+}
+
+void run_in_threads(size_t job_count, size_t thread_count,
+                    const std::function<void(size_t)> &job)
+{
+  ThreadJobs jobs;
+  jobs.job_count = job_count;
+  jobs.job = &job;
+  jobs.next = 0;
+  size_t threads = std::max<size_t>(1, std::min(thread_count, job_count));
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i)
+    { workers.push_back(std::thread(run_thread_jobs, &jobs)); }
+  run_thread_jobs(&jobs);
+  for (size_t i = 0; i < workers.size(); ++i)
+    { workers[i].join(); }
+  if (jobs.error)
+    { std::rethrow_exception(jobs.error); }
+}
+
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+//! @file thread-utils.h
+//!
+//! @brief Running independent jobs in several threads.
+
+#ifndef GUARD_thread_utils_h
+#define GUARD_thread_utils_h
+
+#include <cstddef>
+#include <functional>
+
+#include "hfstdll.h"
+
+namespace hfst {
+
+//! @brief Call @a job for every index below @a job_count in at most
+//! @a thread_count threads, the calling thread being one of them.
+//!
+//! Each index is handed to the next free thread, so the jobs may not
+//! depend on each other. A @a thread_count of zero or one runs the jobs
+//! in order in the calling thread. When a job throws, the indices not
+//! yet started are skipped and the first exception is rethrown here
+//! after all threads have finished.
+HFSTDLL void run_in_threads(size_t job_count, size_t thread_count,
+                            const std::function<void(size_t)> &job);
+
+}
+
+#endif // GUARD_thread_utils_h
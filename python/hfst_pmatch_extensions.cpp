@@ -51,6 +51,7 @@ std::vector<hfst::HfstTransducer> compile_pmatch_expression(const std::string &
 
     // When done compiling everything, look for TOP and output it first.
     if (definitions.count("TOP") == 1) {
+        std::map<std::string, std::string> properties = definitions["TOP"]->get_properties();
         intermediate_tmp = hfst::implementations::ConversionFunctions::
             hfst_transducer_to_hfst_basic_transducer(*definitions["TOP"]);
         harmonized_tmp = hfst::implementations::ConversionFunctions::
@@ -61,6 +62,10 @@ std::vector<hfst::HfstTransducer> compile_pmatch_expression(const std::string &
         output_tmp = hfst::implementations::ConversionFunctions::
             hfst_ol_to_hfst_transducer(harmonized_tmp);
         output_tmp->set_name("TOP");
+        for(std::map<std::string, std::string>::iterator it = properties.begin();
+            it != properties.end(); ++it) {
+            output_tmp->set_property(it->first, it->second);
+        }
         retval.push_back(*output_tmp);
         delete definitions["TOP"];
         definitions.erase("TOP");
@@ -209,6 +209,7 @@ libhfst_source_files = ["libhfst/src/parsers/XfstCompiler" + cpp,
                         "libhfst/src/HfstPrintPCKimmo" + cpp,
                         "libhfst/src/hfst-string-conversions" + cpp,
                         "libhfst/src/string-utils" + cpp,
+                        "libhfst/src/thread-utils" + cpp,
                         "libhfst/src/implementations/HfstBasicTransducer" + cpp,
                         "libhfst/src/implementations/HfstBasicTransition" + cpp,
                         "libhfst/src/implementations/ConvertTransducerFormat" + cpp,
@@ -244,6 +245,7 @@ libhfst_source_files = ["libhfst/src/parsers/XfstCompiler" + cpp,
                         "libhfst/src/parsers/PmatchCompiler" + cpp,
                         "libhfst/src/parsers/XreCompiler" + cpp,
                         "libhfst/src/parsers/lexc-utils" + cpp,
+                        "libhfst/src/parsers/CompilationCache" + cpp,
                         "libhfst/src/parsers/pmatch_utils" + cpp,
                         "libhfst/src/parsers/xre_utils" + cpp,
                         "libhfst/src/parsers/xfst-utils" + cpp,
@@ -136,7 +136,7 @@ HfstInputStream.h HfstLookupFlagDiacritics.h HfstOutputStream.h \
 HfstSymbolDefs.h HfstTokenizer.h HfstTransducer.h HfstXeroxRules.h \
 HfstStrings2FstTokenizer.h hfst.h hfst.hpp.in hfst_apply_schemas.h hfstdll.h \
 hfst-string-conversions.h HfstPrintDot.h HfstPrintPCKimmo.h \
-string-utils.h;
+string-utils.h thread-utils.h;
 do
     cp libhfst/src/$file $1/libhfst/src/
 done
@@ -148,7 +148,7 @@ HfstInputStream HfstLookupFlagDiacritics HfstOutputStream HfstRules \
 HfstSymbolDefs HfstTokenizer HfstTransducer HfstXeroxRules \
 hfst-string-conversions \
 HfstStrings2FstTokenizer HfstXeroxRulesTest HfstPrintDot HfstPrintPCKimmo \
-string-utils;
+string-utils thread-utils;
 do
     cp libhfst/src/$file.cc $1/libhfst/src/$file.cpp
 done
@@ -203,7 +203,7 @@ done
 for file in \
 LexcCompiler PmatchCompiler XreCompiler XfstCompiler xfst_help_message \
 TwolcCompiler \
-lexc-utils pmatch_utils xre_utils xfst-utils SfstCompiler SfstAlphabet SfstBasic SfstUtf8;
+lexc-utils CompilationCache pmatch_utils xre_utils xfst-utils SfstCompiler SfstAlphabet SfstBasic SfstUtf8;
 do
     cp libhfst/src/parsers/$file.cc \
         $1/libhfst/src/parsers/$file.cpp
@@ -45,6 +45,7 @@ HfstPrintDot.cpp ^
 HfstPrintPCKimmo.cpp ^
 hfst-string-conversions.cpp ^
 string-utils.cpp ^
+thread-utils.cpp ^
 implementations\HfstTransitionGraph.cpp ^
 implementations\ConvertTransducerFormat.cpp ^
 implementations\HfstTropicalTransducerTransitionData.cpp ^
@@ -79,6 +80,7 @@ parsers\PmatchCompiler.cpp ^
 parsers\XreCompiler.cpp ^
 parsers\XfstCompiler.cpp ^
 parsers\lexc-utils.cpp ^
+parsers\CompilationCache.cpp ^
 parsers\pmatch_utils.cpp ^
 parsers\xre_utils.cpp ^
 parsers\xfst-utils.cpp ^
@@ -45,6 +45,7 @@ HfstPrintDot.cpp ^
 HfstPrintPCKimmo.cpp ^
 hfst-string-conversions.cpp ^
 string-utils.cpp ^
+thread-utils.cpp ^
 implementations\HfstBasicTransducer.cpp ^
 implementations\HfstBasicTransition.cpp ^
 implementations\HfstTropicalTransducerTransitionData.cpp ^
@@ -80,6 +81,7 @@ parsers\PmatchCompiler.cpp ^
 parsers\XreCompiler.cpp ^
 parsers\XfstCompiler.cpp ^
 parsers\lexc-utils.cpp ^
+parsers\CompilationCache.cpp ^
 parsers\pmatch_utils.cpp ^
 parsers\xre_utils.cpp ^
 parsers\xfst-utils.cpp ^
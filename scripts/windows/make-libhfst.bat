@@ -55,5 +55,6 @@ parsers\LexcCompiler.cpp ^
 parsers\PmatchCompiler.cpp ^
 parsers\XreCompiler.cpp ^
 parsers\lexc-utils.cpp ^
+parsers\CompilationCache.cpp ^
 parsers\pmatch_utils.cpp ^
 parsers\xre_utils.cpp /link %debug_link% openfst.lib libfoma.lib
@@ -0,0 +1,319 @@
+/*
+   Test file for CompilationCache.
+*/
+
+#include "HfstTransducer.h"
+#include "HfstOutputStream.h"
+#include "parsers/CompilationCache.h"
+#include "parsers/pmatch_utils.h"
+#include "parsers/XfstCompiler.h"
+#include "auxiliary_functions.cc"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef WINDOWS
+#include <direct.h>
+#endif
+
+using namespace hfst;
+using hfst::xfst::XfstCompiler;
+
+static const char * CACHE_DIRECTORY = "test_compilation_cache.d";
+
+/* An empty cache directory. */
+static void empty_cache_directory()
+{
+#ifdef WINDOWS
+  _mkdir(CACHE_DIRECTORY);
+#else
+  mkdir(CACHE_DIRECTORY, 0777);
+#endif
+  DIR * dir = opendir(CACHE_DIRECTORY);
+  assert(dir != NULL);
+  struct dirent * entry;
+  while ((entry = readdir(dir)) != NULL)
+    {
+      std::string name = entry->d_name;
+      if (name != "." && name != "..")
+        remove((std::string(CACHE_DIRECTORY) + "/" + name).c_str());
+    }
+  closedir(dir);
+}
+
+/* The path without an extension of the only entry in the cache
+   directory. */
+static std::string only_entry()
+{
+  DIR * dir = opendir(CACHE_DIRECTORY);
+  assert(dir != NULL);
+  std::string retval;
+  struct dirent * entry;
+  while ((entry = readdir(dir)) != NULL)
+    {
+      std::string name = entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".key") == 0)
+        {
+          assert(retval.empty());
+          retval = std::string(CACHE_DIRECTORY) + "/"
+            + name.substr(0, name.size() - 4);
+        }
+    }
+  closedir(dir);
+  assert(!retval.empty());
+  return retval;
+}
+
+static void write_file(const std::string & name, const std::string & text)
+{
+  FILE * f = fopen(name.c_str(), "wb");
+  assert(f != NULL);
+  fwrite(text.data(), 1, text.size(), f);
+  fclose(f);
+}
+
+static std::string read_file(const std::string & name)
+{
+  FILE * f = fopen(name.c_str(), "rb");
+  assert(f != NULL);
+  std::string retval;
+  char buffer[256];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    retval.append(buffer, n);
+  fclose(f);
+  return retval;
+}
+
+/* Storing and reading entries, and what counts as a miss. */
+static void test_cache()
+{
+  empty_cache_directory();
+  CompilationCache cache(CACHE_DIRECTORY);
+
+  std::string hash = CompilationCache::hash("key");
+  assert(hash.size() == 32);
+  assert(hash == CompilationCache::hash("key"));
+  assert(hash != CompilationCache::hash("key\n"));
+
+  assert(cache.get("key") == NULL);
+  assert(cache.hits() == 0 && cache.misses() == 1);
+
+  HfstTransducer cat("c", "k", TROPICAL_OPENFST_TYPE);
+  cat.concatenate(HfstTransducer("a", TROPICAL_OPENFST_TYPE));
+  cache.put("key", cat);
+  HfstTransducer * cached = cache.get("key");
+  assert(cached != NULL);
+  assert(cached->get_type() == TROPICAL_OPENFST_TYPE);
+  assert(cached->compare(cat));
+  delete cached;
+  assert(cache.hits() == 1 && cache.misses() == 1);
+
+  /* Another key, and another cache in the same directory */
+  assert(cache.get("other key") == NULL);
+  CompilationCache same_directory(CACHE_DIRECTORY);
+  cached = same_directory.get("key");
+  assert(cached != NULL && cached->compare(cat));
+  delete cached;
+  assert(cache.hits() == 1 && cache.misses() == 2);
+
+  /* Storing again replaces the entry */
+  HfstTransducer dog("d", TROPICAL_OPENFST_TYPE);
+  cache.put("key", dog);
+  cached = cache.get("key");
+  assert(cached != NULL && cached->compare(dog));
+  delete cached;
+
+  /* An unreadable entry is a miss */
+  empty_cache_directory();
+  cache.put("broken key", cat);
+  std::string entry = only_entry();
+  write_file(entry + ".hfst", "not a transducer");
+  assert(cache.get("broken key") == NULL);
+  assert(cache.hits() == 2 && cache.misses() == 3);
+  cache.put("broken key", cat);
+  cached = cache.get("broken key");
+  assert(cached != NULL && cached->compare(cat));
+  delete cached;
+
+  /* The full key is stored with the library version, and an entry
+     stored with another key is a miss */
+  std::string stored = read_file(entry + ".key");
+  std::string version = "hfst " PACKAGE_VERSION "\n";
+  assert(stored.compare(0, version.size(), version) == 0);
+  assert(stored.compare(stored.size() - 10, 10, "broken key") == 0);
+  write_file(entry + ".key", stored.substr(0, stored.size() - 3) + "KEY");
+  assert(cache.get("broken key") == NULL);
+  write_file(entry + ".key", "hfst 0.0\n" + stored.substr(version.size()));
+  assert(cache.get("broken key") == NULL);
+  assert(cache.hits() == 3 && cache.misses() == 5);
+  cache.put("broken key", dog);
+  cached = cache.get("broken key");
+  assert(cached != NULL && cached->compare(dog));
+  delete cached;
+}
+
+/* Compile \a script with the cache, counting the definitions read from
+   it and the ones compiled. */
+static HfstTransducer compile_cached(const std::string & script,
+                                     unsigned long & hits,
+                                     unsigned long & misses)
+{
+  std::map<std::string, HfstTransducer *> defs;
+  hfst::pmatch::PmatchCompilation compilation
+    (TROPICAL_OPENFST_TYPE, false, false, false, "", CACHE_DIRECTORY);
+  std::map<std::string, HfstTransducer *> compiled =
+    hfst::pmatch::compile(compilation, script, defs);
+  assert(compilation.compilation_cache != NULL);
+  hits = compilation.compilation_cache->hits();
+  misses = compilation.compilation_cache->misses();
+  assert(compiled.size() == 1);
+  HfstTransducer retval(*compiled["TOP"]);
+  delete compiled["TOP"];
+  return retval;
+}
+
+/* Unchanged definitions are read from the cache, changed ones and the
+   ones that use them are compiled again. */
+static void test_pmatch_cache()
+{
+  empty_cache_directory();
+  std::string script =
+    "Define Stem {cat} ;\n"
+    "Define Plural Stem {s} ;\n"
+    "Define Other {dog} ;\n"
+    "regex [Plural | Other] EndTag(animal) ;\n";
+  unsigned long hits = 0;
+  unsigned long misses = 0;
+  HfstTransducer first = compile_cached(script, hits, misses);
+  assert(hits == 0 && misses > 0);
+  unsigned long first_misses = misses;
+  HfstTransducer second = compile_cached(script, hits, misses);
+  assert(hits > 0 && misses == 0);
+  assert(first.compare(second));
+
+  /* Changing Stem changes Plural and TOP but not Other */
+  std::string changed =
+    "Define Stem {cow} ;\n"
+    "Define Plural Stem {s} ;\n"
+    "Define Other {dog} ;\n"
+    "regex [Plural | Other] EndTag(animal) ;\n";
+  HfstTransducer third = compile_cached(changed, hits, misses);
+  assert(hits > 0 && misses > 0 && misses < first_misses);
+  assert(!first.compare(third));
+  HfstTransducer fourth = compile_cached(changed, hits, misses);
+  assert(hits > 0 && misses == 0);
+  assert(third.compare(fourth));
+
+  /* Changing back finds the old entries */
+  HfstTransducer fifth = compile_cached(script, hits, misses);
+  assert(hits > 0 && misses == 0);
+  assert(first.compare(fifth));
+
+  /* Without the cache, the same results */
+  std::map<std::string, HfstTransducer *> defs;
+  std::map<std::string, HfstTransducer *> uncached =
+    hfst::pmatch::compile(changed, defs, TROPICAL_OPENFST_TYPE);
+  assert(uncached["TOP"]->compare(third));
+  delete uncached["TOP"];
+}
+
+/* Run \a script with the cache if \a cached, counting the regexes read
+   from it and the ones compiled. Return the networks on the stack, top
+   first. */
+static std::vector<HfstTransducer> run_xfst(const std::string & script,
+                                            bool cached,
+                                            unsigned long & hits,
+                                            unsigned long & misses)
+{
+  std::ostringstream out;
+  XfstCompiler compiler(TROPICAL_OPENFST_TYPE);
+  compiler.setVerbosity(false);
+  compiler.setPromptVerbosity(false);
+  compiler.set_output_stream(out);
+  compiler.set_error_stream(out);
+  if (cached)
+    compiler.setCacheDirectory(CACHE_DIRECTORY);
+  assert(compiler.parse_line(script) == 0);
+  hits = cached ? compiler.getCache()->hits() : 0;
+  misses = cached ? compiler.getCache()->misses() : 0;
+  std::vector<HfstTransducer> retval;
+  std::stack<HfstTransducer *> stack = compiler.get_stack();
+  while (!stack.empty())
+    {
+      retval.push_back(*stack.top());
+      stack.pop();
+    }
+  return retval;
+}
+
+/* A cached xfst script gives what the uncached one gives, and all of its
+   \a regexes regexes are read from the cache when it is run again. */
+static std::vector<HfstTransducer> check_xfst(const std::string & script,
+                                              unsigned long regexes)
+{
+  empty_cache_directory();
+  unsigned long hits = 0;
+  unsigned long misses = 0;
+  std::vector<HfstTransducer> uncached = run_xfst(script, false, hits, misses);
+  std::vector<HfstTransducer> first = run_xfst(script, true, hits, misses);
+  assert(hits == 0 && misses > 0);
+  std::vector<HfstTransducer> second = run_xfst(script, true, hits, misses);
+  assert(hits == regexes && misses == 0);
+  assert(first.size() == uncached.size() && second.size() == uncached.size());
+  for (size_t i = 0; i < uncached.size(); ++i)
+    {
+      assert(first[i].compare(uncached[i]));
+      assert(second[i].compare(uncached[i]));
+    }
+  return uncached;
+}
+
+/* Regexes compiled in xfst are read from the cache only while the
+   definitions they use are unchanged, and are found however they end. */
+static void test_xfst_cache()
+{
+  /* The same regex before and after X is defined again */
+  std::vector<HfstTransducer> nets = check_xfst
+    ("define X c a t ;\n"
+     "regex X s ;\n"
+     "define X d o g ;\n"
+     "regex X s ;\n", 4);
+  assert(nets.size() == 2);
+  assert(!nets[0].compare(nets[1]));
+  HfstTransducer dogs("d", TROPICAL_OPENFST_TYPE);
+  dogs.concatenate(HfstTransducer("o", TROPICAL_OPENFST_TYPE));
+  dogs.concatenate(HfstTransducer("g", TROPICAL_OPENFST_TYPE));
+  dogs.concatenate(HfstTransducer("s", TROPICAL_OPENFST_TYPE));
+  assert(nets[0].compare(dogs));
+
+  /* A percent sign escapes a semicolon, two percent signs do not */
+  nets = check_xfst
+    ("regex a %%;\n"
+     "regex b %; c ;\n", 2);
+  assert(nets.size() == 2);
+  HfstTransducer percent("a", TROPICAL_OPENFST_TYPE);
+  percent.concatenate(HfstTransducer("%", TROPICAL_OPENFST_TYPE));
+  assert(nets[1].compare(percent));
+
+  /* A regex spanning several lines */
+  nets = check_xfst
+    ("regex [ c a t\n"
+     "      | d o g ]\n"
+     "      s ;\n", 1);
+  assert(nets.size() == 1);
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("CompilationCache", TROPICAL_OPENFST_TYPE);
+  test_cache();
+  verbose_print("pmatch compilation with a cache", TROPICAL_OPENFST_TYPE);
+  test_pmatch_cache();
+  verbose_print("xfst regexes with a cache", TROPICAL_OPENFST_TYPE);
+  test_xfst_cache();
+  empty_cache_directory();
+  rmdir(CACHE_DIRECTORY);
+}
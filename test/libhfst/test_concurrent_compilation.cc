@@ -0,0 +1,99 @@
+/*
+   Test file for compiling in several threads at the same time.
+*/
+
+#include "HfstTransducer.h"
+#include "parsers/XreCompiler.h"
+#include "parsers/pmatch_utils.h"
+#include "auxiliary_functions.cc"
+
+#include <thread>
+#include <vector>
+
+using namespace hfst;
+using hfst::xre::XreCompiler;
+
+static const char * pmatch_scripts[] = {
+  "Define Greeting {hello} EndTag(greeting) ;\n"
+  "Define Animal [{cat} | {dog}] EndTag(animal) ;\n"
+  "Define Number [{1} | {2}]+ EndTag(number) ;\n"
+  "regex Ins(Greeting) | Ins(Animal) | Ins(Number) ;\n",
+  "Define Stem {cat} ;\n"
+  "Define Plural Stem {s} ;\n"
+  "Define Other {dog} ;\n"
+  "regex [Plural | Other] EndTag(animal) ;\n",
+  "Define A [{cat} | {cats} | {dog}] EndTag(animal) RC(\" \") ;\n"
+  "Define B [\"a\"+] EndTag(as) ;\n"
+  "Define C LC(\"x\") {yz} EndTag(yz) ;\n"
+  "regex A | B | C ;\n",
+  NULL
+};
+
+static const char * regexes[] = {
+  "[a:b | c:d]* e (f)",
+  "[c a t | d o g] -> x || _ .#.",
+  "$[a b] & [a | b | c]*",
+  "{cat}:{dog} .o. d -> k",
+  NULL
+};
+
+/* The number of times each thread compiles everything. */
+static const unsigned int ROUNDS = 3;
+
+/* Compile all scripts and regexes ROUNDS times into \a results. */
+static void compile_all(std::vector<HfstTransducer *> * results)
+{
+  for (unsigned int round = 0; round < ROUNDS; ++round)
+    {
+      for (unsigned int i = 0; pmatch_scripts[i] != NULL; ++i)
+        {
+          std::map<std::string, HfstTransducer *> defs;
+          std::map<std::string, HfstTransducer *> compiled =
+            hfst::pmatch::compile(pmatch_scripts[i], defs,
+                                  TROPICAL_OPENFST_TYPE);
+          results->push_back(new HfstTransducer(*compiled["TOP"]));
+          for (std::map<std::string, HfstTransducer *>::iterator it =
+                 compiled.begin(); it != compiled.end(); ++it)
+            { delete it->second; }
+        }
+      XreCompiler compiler(TROPICAL_OPENFST_TYPE);
+      for (unsigned int i = 0; regexes[i] != NULL; ++i)
+        {
+          HfstTransducer * t = compiler.compile(regexes[i]);
+          assert(t != NULL);
+          results->push_back(t);
+        }
+    }
+}
+
+/* Two threads compiling at the same time get what one thread gets. */
+static void test_concurrent_compilation()
+{
+  std::vector<HfstTransducer *> serial;
+  compile_all(&serial);
+
+  std::vector<HfstTransducer *> first;
+  std::vector<HfstTransducer *> second;
+  std::thread first_thread(compile_all, &first);
+  std::thread second_thread(compile_all, &second);
+  first_thread.join();
+  second_thread.join();
+
+  assert(first.size() == serial.size());
+  assert(second.size() == serial.size());
+  for (size_t i = 0; i < serial.size(); ++i)
+    {
+      assert(first[i]->compare(*serial[i]));
+      assert(second[i]->compare(*serial[i]));
+      delete serial[i];
+      delete first[i];
+      delete second[i];
+    }
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("pmatch and regex compilation in two threads",
+                TROPICAL_OPENFST_TYPE);
+  test_concurrent_compilation();
+}
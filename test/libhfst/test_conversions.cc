@@ -0,0 +1,373 @@
+/*
+   Test file for the conversions between foma or SFST and OpenFst tropical
+   transducers that do not go through HfstBasicTransducer. Each one must
+   give what the conversion through HfstBasicTransducer gives.
+*/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "HfstTransducer.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "auxiliary_functions.cc"
+
+#if HAVE_OPENFST
+
+#if HAVE_FOMA
+#ifndef _FOMALIB_H_
+  #define _FOMALIB_H_
+  #ifdef HAVE_FOMA_UPSTREAM
+    #include <fomalib.h>
+  #else
+    #include "back-ends/foma/fomalib.h"
+  #endif
+#endif
+#endif // HAVE_FOMA
+
+#if HAVE_SFST || HAVE_LEAN_SFST
+#include "back-ends/sfst/fst.h"
+#endif
+
+#if HAVE_OPENFST_UPSTREAM
+#include <fst/fstlib.h>
+#else
+#include "back-ends/openfst/src/include/fst/fstlib.h"
+#endif
+
+#include <vector>
+
+using namespace hfst;
+using hfst::implementations::HfstState;
+using hfst::implementations::HfstBasicTransducer;
+using hfst::implementations::HfstBasicTransition;
+using hfst::implementations::ConversionFunctions;
+
+typedef fst::StdArc::StateId StateId;
+
+/* ---------------------------------------------------------------------
+   Transducers to convert
+   --------------------------------------------------------------------- */
+
+/* Epsilon, unknown and identity symbols, with a cycle. */
+static HfstBasicTransducer special_symbols()
+{
+  HfstBasicTransducer t;
+  t.add_state(3);
+  t.add_transition(0, HfstBasicTransition(1, "a", "@_EPSILON_SYMBOL_@", 0));
+  t.add_transition(1, HfstBasicTransition(2, "@_IDENTITY_SYMBOL_@",
+                                          "@_IDENTITY_SYMBOL_@", 0));
+  t.add_transition(1, HfstBasicTransition(2, "@_UNKNOWN_SYMBOL_@", "b", 0));
+  t.add_transition(1, HfstBasicTransition(2, "@_UNKNOWN_SYMBOL_@",
+                                          "@_UNKNOWN_SYMBOL_@", 0));
+  t.add_transition(2, HfstBasicTransition(3, "@_EPSILON_SYMBOL_@", "c", 0));
+  t.add_transition(3, HfstBasicTransition(0, "d", "d", 0));
+  t.set_final_weight(3, 0);
+  return t;
+}
+
+/* Flag diacritics on both sides of the arcs. */
+static HfstBasicTransducer flag_diacritics()
+{
+  HfstBasicTransducer t;
+  t.add_state(3);
+  t.add_transition(0, HfstBasicTransition(1, "@P.CASE.NOM@", "@P.CASE.NOM@",
+                                          0));
+  t.add_transition(0, HfstBasicTransition(1, "@U.CASE.GEN@", "@U.CASE.GEN@",
+                                          0));
+  t.add_transition(1, HfstBasicTransition(2, "a", "a", 0));
+  t.add_transition(2, HfstBasicTransition(3, "@R.CASE.NOM@", "@R.CASE.NOM@",
+                                          0));
+  t.add_transition(2, HfstBasicTransition(3, "@D.CASE@", "@D.CASE@", 0));
+  t.set_final_weight(3, 0);
+  return t;
+}
+
+/* Weights on final states, the start state included, and on arcs. */
+static HfstBasicTransducer weighted_finals()
+{
+  HfstBasicTransducer t;
+  t.add_state(2);
+  t.add_transition(0, HfstBasicTransition(1, "a", "b", 0.5));
+  t.add_transition(1, HfstBasicTransition(2, "c", "c", 0.25));
+  t.set_final_weight(0, 2.0);
+  t.set_final_weight(1, 1.5);
+  t.set_final_weight(2, 0);
+  return t;
+}
+
+/* A start state and symbols, but no final states. */
+static HfstBasicTransducer no_finals()
+{
+  HfstBasicTransducer t;
+  t.add_state(1);
+  t.add_transition(0, HfstBasicTransition(1, "a", "b", 0));
+  return t;
+}
+
+static std::vector<HfstBasicTransducer> all_transducers()
+{
+  std::vector<HfstBasicTransducer> retval;
+  retval.push_back(special_symbols());
+  retval.push_back(flag_diacritics());
+  retval.push_back(weighted_finals());
+  retval.push_back(no_finals());
+  retval.push_back(HfstBasicTransducer());
+  return retval;
+}
+
+/* \a t with state s numbered (s + \a shift) mod the number of states,
+   which moves the start state away from zero. */
+static fst::StdVectorFst * shift_states(const fst::StdVectorFst * t,
+                                        StateId shift)
+{
+  fst::StdVectorFst * retval = new fst::StdVectorFst();
+  StateId n = t->NumStates();
+  for (StateId s = 0; s < n; s++)
+    retval->AddState();
+  for (StateId s = 0; s < n; s++)
+    {
+      for (fst::ArcIterator<fst::StdVectorFst> aiter(*t, s);
+           !aiter.Done(); aiter.Next())
+        {
+          fst::StdArc arc = aiter.Value();
+          arc.nextstate = (arc.nextstate + shift) % n;
+          retval->AddArc((s + shift) % n, arc);
+        }
+      retval->SetFinal((s + shift) % n, t->Final(s));
+    }
+  retval->SetStart((t->Start() + shift) % n);
+  retval->SetInputSymbols(t->InputSymbols());
+  return retval;
+}
+
+/* An OpenFst transducer without any states, not even a start state,
+   with the symbol table that HFST gives every transducer. */
+static fst::StdVectorFst * ofst_without_states()
+{
+  fst::SymbolTable symbols("");
+  symbols.AddSymbol("@_EPSILON_SYMBOL_@", 0);
+  symbols.AddSymbol("@_UNKNOWN_SYMBOL_@", 1);
+  symbols.AddSymbol("@_IDENTITY_SYMBOL_@", 2);
+  fst::StdVectorFst * retval = new fst::StdVectorFst();
+  retval->SetInputSymbols(&symbols);
+  return retval;
+}
+
+/* ---------------------------------------------------------------------
+   Comparing the results
+   --------------------------------------------------------------------- */
+
+/* A tropical HfstTransducer equivalent to \a basic, which is deleted. */
+static HfstTransducer to_tropical(HfstBasicTransducer * basic)
+{
+  HfstTransducer retval(*basic, TROPICAL_OPENFST_TYPE);
+  delete basic;
+  return retval;
+}
+
+static HfstTransducer from_ofst(fst::StdVectorFst * t)
+{
+  HfstTransducer retval =
+    to_tropical(ConversionFunctions::tropical_ofst_to_hfst_basic_transducer(t));
+  delete t;
+  return retval;
+}
+
+/* Whether \a direct and \a through_basic accept the same weighted pairs
+   and have the same alphabet. */
+static void assert_same(const HfstTransducer & direct,
+                        const HfstTransducer & through_basic)
+{
+  assert(direct.get_alphabet() == through_basic.get_alphabet());
+  assert(direct.compare(through_basic, false));
+}
+
+/* The direct conversions number the start state zero. */
+static void assert_start_zero(const fst::StdVectorFst * t)
+{
+  assert(t->Start() == 0);
+}
+
+#if HAVE_FOMA
+
+static HfstTransducer from_foma(fsm * t)
+{
+  HfstTransducer retval =
+    to_tropical(ConversionFunctions::foma_to_hfst_basic_transducer(t));
+  fsm_destroy(t);
+  return retval;
+}
+
+/* Renumber the states of \a t like shift_states does. */
+static void shift_foma_states(fsm * t, int shift)
+{
+  int n = 0;
+  for (fsm_state * line = t->states; line->state_no != -1; ++line)
+    {
+      n = std::max(n, std::max(line->state_no, line->target) + 1);
+    }
+  for (fsm_state * line = t->states; line->state_no != -1; ++line)
+    {
+      line->state_no = (line->state_no + shift) % n;
+      if (line->target != -1)
+        line->target = (line->target + shift) % n;
+    }
+}
+
+/* foma_to_tropical_ofst of \a t gives what foma_to_hfst_basic_transducer
+   and hfst_basic_transducer_to_tropical_ofst give. */
+static void test_foma_to_tropical_ofst(fsm * t)
+{
+  fst::StdVectorFst * direct = ConversionFunctions::foma_to_tropical_ofst(t);
+  assert_start_zero(direct);
+  HfstBasicTransducer * basic =
+    ConversionFunctions::foma_to_hfst_basic_transducer(t);
+  fst::StdVectorFst * through_basic =
+    ConversionFunctions::hfst_basic_transducer_to_tropical_ofst(basic);
+  delete basic;
+  assert_same(from_ofst(direct), from_ofst(through_basic));
+}
+
+/* tropical_ofst_to_foma of \a t gives what
+   tropical_ofst_to_hfst_basic_transducer and hfst_basic_transducer_to_foma
+   give. Weights are lost in both. */
+static void test_tropical_ofst_to_foma(fst::StdVectorFst * t)
+{
+  fsm * direct = ConversionFunctions::tropical_ofst_to_foma(t);
+  HfstBasicTransducer * basic =
+    ConversionFunctions::tropical_ofst_to_hfst_basic_transducer(t);
+  fsm * through_basic =
+    ConversionFunctions::hfst_basic_transducer_to_foma(basic);
+  delete basic;
+  assert_same(from_foma(direct), from_foma(through_basic));
+}
+
+static void test_foma_conversions(const HfstBasicTransducer & t)
+{
+  for (int shift = 0; shift < 3; shift++)
+    {
+      fsm * foma = ConversionFunctions::hfst_basic_transducer_to_foma(&t);
+      shift_foma_states(foma, shift);
+      test_foma_to_tropical_ofst(foma);
+      fsm_destroy(foma);
+
+      fst::StdVectorFst * ofst =
+        ConversionFunctions::hfst_basic_transducer_to_tropical_ofst(&t);
+      fst::StdVectorFst * shifted = shift_states(ofst, shift);
+      delete ofst;
+      test_tropical_ofst_to_foma(shifted);
+      delete shifted;
+    }
+}
+
+/* Transducers made by foma and OpenFst themselves. */
+static void test_foma_native()
+{
+  fsm * empty = fsm_empty_set();
+  test_foma_to_tropical_ofst(empty);
+  fsm_destroy(empty);
+
+  fst::StdVectorFst * no_states = ofst_without_states();
+  test_tropical_ofst_to_foma(no_states);
+  delete no_states;
+}
+
+#endif // HAVE_FOMA
+
+#if HAVE_SFST || HAVE_LEAN_SFST
+
+static HfstTransducer from_sfst(SFST::Transducer * t)
+{
+  HfstTransducer retval =
+    to_tropical(ConversionFunctions::sfst_to_hfst_basic_transducer(t));
+  delete t;
+  return retval;
+}
+
+/* sfst_to_tropical_ofst of \a t gives what sfst_to_hfst_basic_transducer
+   and hfst_basic_transducer_to_tropical_ofst give. SFST numbers its root
+   node zero, so the start state is zero to begin with. */
+static void test_sfst_to_tropical_ofst(SFST::Transducer * t)
+{
+  fst::StdVectorFst * direct = ConversionFunctions::sfst_to_tropical_ofst(t);
+  assert_start_zero(direct);
+  HfstBasicTransducer * basic =
+    ConversionFunctions::sfst_to_hfst_basic_transducer(t);
+  fst::StdVectorFst * through_basic =
+    ConversionFunctions::hfst_basic_transducer_to_tropical_ofst(basic);
+  delete basic;
+  assert_same(from_ofst(direct), from_ofst(through_basic));
+}
+
+/* tropical_ofst_to_sfst of \a t gives what
+   tropical_ofst_to_hfst_basic_transducer and hfst_basic_transducer_to_sfst
+   give. Weights are lost in both. */
+static void test_tropical_ofst_to_sfst(fst::StdVectorFst * t)
+{
+  SFST::Transducer * direct = ConversionFunctions::tropical_ofst_to_sfst(t);
+  HfstBasicTransducer * basic =
+    ConversionFunctions::tropical_ofst_to_hfst_basic_transducer(t);
+  SFST::Transducer * through_basic =
+    ConversionFunctions::hfst_basic_transducer_to_sfst(basic);
+  delete basic;
+  assert_same(from_sfst(direct), from_sfst(through_basic));
+}
+
+static void test_sfst_conversions(const HfstBasicTransducer & t)
+{
+  SFST::Transducer * sfst =
+    ConversionFunctions::hfst_basic_transducer_to_sfst(&t);
+  test_sfst_to_tropical_ofst(sfst);
+  delete sfst;
+
+  for (int shift = 0; shift < 3; shift++)
+    {
+      fst::StdVectorFst * ofst =
+        ConversionFunctions::hfst_basic_transducer_to_tropical_ofst(&t);
+      fst::StdVectorFst * shifted = shift_states(ofst, shift);
+      delete ofst;
+      test_tropical_ofst_to_sfst(shifted);
+      delete shifted;
+    }
+}
+
+/* Transducers made by SFST and OpenFst themselves. */
+static void test_sfst_native()
+{
+  SFST::Transducer * empty = new SFST::Transducer();
+  test_sfst_to_tropical_ofst(empty);
+  delete empty;
+
+  fst::StdVectorFst * no_states = ofst_without_states();
+  test_tropical_ofst_to_sfst(no_states);
+  delete no_states;
+}
+
+#endif // HAVE_SFST || HAVE_LEAN_SFST
+
+int main(int argc, char **argv)
+{
+  std::vector<HfstBasicTransducer> transducers = all_transducers();
+#if HAVE_FOMA
+  verbose_print("direct conversions to and from tropical", FOMA_TYPE);
+  for (size_t i = 0; i < transducers.size(); i++)
+    test_foma_conversions(transducers[i]);
+  test_foma_native();
+#endif
+#if HAVE_SFST || HAVE_LEAN_SFST
+  verbose_print("direct conversions to and from tropical", SFST_TYPE);
+  for (size_t i = 0; i < transducers.size(); i++)
+    test_sfst_conversions(transducers[i]);
+  test_sfst_native();
+#endif
+}
+
+#else // HAVE_OPENFST
+
+int main(int argc, char **argv)
+{
+  return 77;
+}
+
+#endif // HAVE_OPENFST
@@ -3,6 +3,7 @@
 */
 
 #include "HfstTransducer.h"
+#include "HfstFlagDiacritics.h"
 #include "auxiliary_functions.cc"
 
 using namespace hfst;
@@ -10,6 +11,101 @@ using hfst::implementations::HfstState;
 using hfst::implementations::HfstBasicTransducer;
 using hfst::implementations::HfstBasicTransition;
 
+/* FdTable and FdState with symbols of type T, where symbol \a far is
+   above the dense range of the table. */
+template<class T> static void test_fd_table(T far)
+{
+  FdTable<T> table;
+  table.define_diacritic(1, "@P.CASE.NOM@");
+  table.define_diacritic(2, "@R.CASE.NOM@");
+  table.define_diacritic(3, "@D.CASE@");
+  table.define_diacritic(4, "@C.CASE@");
+  table.define_diacritic(5, "@N.NUM.SG@");
+  table.define_diacritic(far, "@U.NUM.SG@");
+  table.define_diacritic(7, "@U.NUM.PL@");
+  table.define_diacritic(8, "@R.NUM@");
+  /* Redefined */
+  table.define_diacritic(9, "@P.CASE.GEN@");
+  table.define_diacritic(9, "@P.CASE.PAR@");
+
+  assert(!table.is_diacritic(0));
+  assert(!table.is_diacritic(10));
+  assert(table.is_diacritic(far));
+  assert(table.get_operation(far)->Name() == "@U.NUM.SG@");
+  assert(table.get_operation(9)->Name() == "@P.CASE.PAR@");
+  assert(table.get_operation(std::string("@R.CASE.NOM@")) ==
+         table.get_operation(2));
+  assert(table.num_features() == 2);
+
+  FdState<T> state(table);
+  assert(state.apply_operation((T)0)); // not a flag
+  assert(state.apply_operation((T)3));
+  assert(!state.apply_operation((T)2));
+  assert(state.apply_operation((T)1));
+  FdState<T> copy(state);
+  assert(copy == state);
+  assert(copy.apply_operation((T)2));
+  assert(!copy.apply_operation((T)3));
+  assert(copy.apply_operation((T)9));
+  assert(!copy.apply_operation((T)2));
+  assert(copy.apply_operation((T)4));
+  assert(copy.apply_operation((T)3));
+  assert(!(copy == state));
+
+  /* Unification against a negative setting */
+  assert(!state.apply_operation((T)8));
+  assert(state.apply_operation((T)5));
+  assert(state.apply_operation((T)8));
+  assert(!state.apply_operation(far));
+  assert(state.apply_operation((T)7));
+  assert(!state.apply_operation(far));
+  assert(state.apply_operation((T)7));
+
+  std::vector<T> valid;
+  valid.push_back(1);
+  valid.push_back(0);
+  valid.push_back(2);
+  valid.push_back(far);
+  assert(table.is_valid_string(valid));
+
+  state.reset();
+  assert(state.apply_operation((T)3) && !state.fails());
+}
+
+/* More features than FdValues keeps in place. */
+static void test_many_features()
+{
+  FdTable<unsigned short> table;
+  const unsigned short FEATURES = 2 * FdValues::INLINE_SIZE + 1;
+  for (unsigned short i = 0; i < FEATURES; i++)
+    {
+      std::ostringstream feature;
+      feature << "F" << i;
+      table.define_diacritic(2 * i, "@P." + feature.str() + ".ON@");
+      table.define_diacritic(2 * i + 1, "@R." + feature.str() + ".ON@");
+    }
+  assert(table.num_features() == FEATURES);
+  FdState<unsigned short> state(table);
+  for (unsigned short i = 0; i < FEATURES; i++)
+    {
+      assert(!state.apply_operation((unsigned short)(2 * i + 1)));
+      if (i % 2 == 0)
+        {
+          assert(state.apply_operation((unsigned short)(2 * i)));
+        }
+    }
+  FdState<unsigned short> copy(state);
+  assert(copy == state);
+  assert(copy.get_values().size() == FEATURES);
+  for (unsigned short i = 0; i < FEATURES; i++)
+    {
+      assert(copy.apply_operation((unsigned short)(2 * i + 1)) ==
+             (i % 2 == 0));
+    }
+  state.assign_values(copy.get_values());
+  assert(!state.fails() && state == copy);
+}
+
 int main(int argc, char **argv)
 {
 
@@ -108,5 +204,12 @@ int main(int argc, char **argv)
       // TODO: More tests...
 
     }
+
+  verbose_print("FdTable and FdState with dense symbols");
+  test_fd_table<unsigned short>(6);
+  verbose_print("FdTable and FdState with a sparse symbol");
+  test_fd_table<int>(1 << 24);
+  verbose_print("FdState with many features");
+  test_many_features();
 }
 
@@ -6,15 +6,72 @@
 */
 
 #include "HfstTransducer.h"
+#include "HfstTokenizer.h"
+#include "implementations/HfstMinimalAcyclicBuilder.h"
+#include "implementations/HfstTropicalTransducerTransitionData.h"
 #include "auxiliary_functions.cc"
 
+#include <thread>
+
 using namespace hfst;
 ;
 
 using implementations::HfstState;
 using implementations::HfstBasicTransition;
 using implementations::HfstBasicTransducer;
+using implementations::HfstMinimalAcyclicBuilder;
+using implementations::HfstSymbolInterner;
+using implementations::HfstEpsilonCycleIndex;
+
+/* Intern symbols "0".."count-1" in \a interner, starting from \a first
+   and going round, and store the numbers in \a numbers. */
+static void intern_symbols(HfstSymbolInterner * interner, unsigned int first,
+                           unsigned int count,
+                           std::vector<unsigned int> * numbers)
+{
+  numbers->resize(count);
+  for (unsigned int i=0; i < count; i++)
+    {
+      unsigned int symbol = (first + i) % count;
+      std::ostringstream oss;
+      oss << symbol;
+      (*numbers)[symbol] = interner->get_number(oss.str());
+    }
+}
 
+/* The symbols of \a s separated by spaces. */
+static StringVector split_symbols(const std::string & s)
+{
+  StringVector retval;
+  std::istringstream iss(s);
+  std::string symbol;
+  while (iss >> symbol)
+    {
+      retval.push_back(symbol);
+    }
+  return retval;
+}
+
+/* Whether lookup of \a s in \a t may have infinitely many results.
+   \a index, which indexes \a t, must agree with
+   HfstBasicTransducer::is_lookup_infinitely_ambiguous. */
+static bool infinitely_ambiguous(HfstBasicTransducer & t,
+                                 HfstEpsilonCycleIndex & index,
+                                 const std::string & s, bool obey_flags)
+{
+  StringVector input = split_symbols(s);
+  bool expected = t.is_lookup_infinitely_ambiguous(input, obey_flags);
+  assert(index.is_lookup_infinitely_ambiguous(input, obey_flags)
+         == expected);
+  return expected;
+}
+
+/* A pseudorandom number below \a n, the same on every platform. */
+static unsigned int next_random(unsigned int & seed, unsigned int n)
+{
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) % n;
+}
 
 int main(int argc, char **argv)
 {
@@ -180,6 +237,230 @@ int main(int argc, char **argv)
       }
   }
 
-  
-}
 
+  verbose_print("HfstMinimalAcyclicBuilder");
+
+  {
+    /* Unsorted, with shared prefixes and suffixes, a string pair and a
+       string that is added twice. */
+    const char * strings [][3] = {
+      { "cats", "cats", "1" }, { "dog", "dog", "2" }, { "cat", "cat", "3" },
+      { "bats", "bats", "0" }, { "dogs", "dogs", "1" }, { "cat", "cat", "0.5" },
+      { "act", "acts", "0" }, { "bat", "bat", "0" }, { "cat", "cat", "4" } };
+    const unsigned int STRINGS_SIZE = 9;
+
+    HfstTokenizer TOK;
+    HfstMinimalAcyclicBuilder builder;
+    HfstMinimalAcyclicBuilder unweighted_builder;
+    HfstBasicTransducer disjunction;
+    HfstBasicTransducer unweighted_disjunction;
+    for (unsigned int i=0; i < STRINGS_SIZE; i++)
+      {
+        StringPairVector spv = TOK.tokenize(strings[i][0], strings[i][1]);
+        float weight = (float)atof(strings[i][2]);
+        builder.add(spv, weight);
+        disjunction.disjunct(spv, weight);
+        unweighted_builder.add(spv, 0);
+        unweighted_disjunction.disjunct(spv, 0);
+      }
+    HfstBasicTransducer built;
+    builder.finish(built);
+    assert(builder.size() == 1); // the start state
+    HfstBasicTransducer unweighted_built;
+    unweighted_builder.finish(unweighted_built);
+
+    if (HfstTransducer::is_implementation_type_available
+        (TROPICAL_OPENFST_TYPE))
+      {
+        HfstTransducer expected(disjunction, TROPICAL_OPENFST_TYPE);
+        HfstTransducer result(built, TROPICAL_OPENFST_TYPE);
+        assert(result.compare(expected));
+
+        /* Minimal as such. Minimizing weighted transducers would also
+           push the weights, so the size is checked without them. */
+        HfstTransducer unweighted_expected
+          (unweighted_disjunction, TROPICAL_OPENFST_TYPE);
+        unweighted_expected.minimize();
+        HfstBasicTransducer minimal(unweighted_expected);
+        assert(unweighted_built.get_max_state() == minimal.get_max_state());
+      }
+
+    /* The lightest of the duplicates is kept. */
+    HfstTransducer result_ol(built, HFST_OLW_TYPE);
+    HfstOneLevelPaths * paths = result_ol.lookup_fd("cat");
+    assert(paths->size() == 1);
+    assert(paths->begin()->first == 0.5);
+    delete paths;
+
+    /* The builder can be used again. */
+    builder.add(TOK.tokenize("a"), 0);
+    HfstBasicTransducer a;
+    builder.finish(a);
+    assert(a.get_max_state() == 1);
+  }
+
+
+  verbose_print("HfstSymbolInterner");
+
+  {
+    HfstSymbolInterner interner;
+    assert(interner.size() == 3);
+    assert(interner.get_number("@_EPSILON_SYMBOL_@") == 0);
+    assert(interner.get_number("@_UNKNOWN_SYMBOL_@") == 1);
+    assert(interner.get_number("@_IDENTITY_SYMBOL_@") == 2);
+
+    /* Threads adding the same symbols in different orders, enough of
+       them to grow the hash table and fill several chunks, must agree
+       on their numbers. */
+    const unsigned int THREADS = 4;
+    const unsigned int SYMBOLS = 5000;
+    std::vector<std::vector<unsigned int> > numbers(THREADS);
+    std::vector<std::thread> threads;
+    for (unsigned int i=0; i < THREADS; i++)
+      {
+        threads.push_back(std::thread(intern_symbols, &interner,
+                                      i * SYMBOLS / THREADS, SYMBOLS,
+                                      &numbers[i]));
+      }
+    for (unsigned int i=0; i < THREADS; i++)
+      {
+        threads[i].join();
+      }
+    assert(interner.size() == SYMBOLS + 3);
+    std::vector<bool> seen(SYMBOLS + 3, false);
+    for (unsigned int symbol=0; symbol < SYMBOLS; symbol++)
+      {
+        unsigned int number = numbers[0][symbol];
+        for (unsigned int i=1; i < THREADS; i++)
+          {
+            assert(numbers[i][symbol] == number);
+          }
+        assert(number >= 3 && number < SYMBOLS + 3 && !seen[number]);
+        seen[number] = true;
+        std::ostringstream oss;
+        oss << symbol;
+        assert(interner.get_symbol(number) == oss.str());
+        assert(interner.get_number(oss.str()) == number);
+      }
+  }
+
+
+  verbose_print("HfstEpsilonCycleIndex");
+
+  {
+    // [a [0:x 0:y]*], where the cycle can only be entered after "a"
+    HfstBasicTransducer epsilons;
+    epsilons.add_transition(0, HfstBasicTransition(1, "a", "a", 0));
+    epsilons.add_transition
+      (1, HfstBasicTransition(2, "@_EPSILON_SYMBOL_@", "x", 0));
+    epsilons.add_transition
+      (2, HfstBasicTransition(1, "@_EPSILON_SYMBOL_@", "y", 0));
+    epsilons.set_final_weight(1, 0);
+    HfstEpsilonCycleIndex epsilons_index(epsilons);
+    assert(infinitely_ambiguous(epsilons, epsilons_index, "a", false));
+    assert(! infinitely_ambiguous(epsilons, epsilons_index, "", false));
+    assert(! infinitely_ambiguous(epsilons, epsilons_index, "b", false));
+    assert(! infinitely_ambiguous(epsilons, epsilons_index, "b a", false));
+
+    // After "a", a cycle whose flags are never valid and after "b", one
+    // whose flags are
+    HfstBasicTransducer flags;
+    flags.add_transition(0, HfstBasicTransition(1, "a", "a", 0));
+    flags.add_transition(1, HfstBasicTransition(2, "@P.F.x@", "@P.F.x@", 0));
+    flags.add_transition(2, HfstBasicTransition(1, "@R.F.y@", "@R.F.y@", 0));
+    flags.add_transition(0, HfstBasicTransition(3, "b", "b", 0));
+    flags.add_transition(3, HfstBasicTransition(4, "@P.F.x@", "@P.F.x@", 0));
+    flags.add_transition(4, HfstBasicTransition(3, "@R.F.x@", "@R.F.x@", 0));
+    flags.set_final_weight(1, 0);
+    flags.set_final_weight(3, 0);
+    HfstEpsilonCycleIndex flags_index(flags);
+    assert(infinitely_ambiguous(flags, flags_index, "a", false));
+    assert(! infinitely_ambiguous(flags, flags_index, "a", true));
+    assert(infinitely_ambiguous(flags, flags_index, "b", false));
+    assert(infinitely_ambiguous(flags, flags_index, "b", true));
+
+    // ?:? and ?:b lead to epsilon cycles, but only for symbols outside
+    // the alphabet
+    HfstBasicTransducer unknowns;
+    unknowns.add_transition
+      (0, HfstBasicTransition(1, "@_IDENTITY_SYMBOL_@",
+                              "@_IDENTITY_SYMBOL_@", 0));
+    unknowns.add_transition
+      (1, HfstBasicTransition(1, "@_EPSILON_SYMBOL_@", "x", 0));
+    unknowns.add_transition
+      (0, HfstBasicTransition(2, "@_UNKNOWN_SYMBOL_@", "b", 0));
+    unknowns.add_transition
+      (2, HfstBasicTransition(3, "@_EPSILON_SYMBOL_@", "y", 0));
+    unknowns.add_transition
+      (3, HfstBasicTransition(2, "@_EPSILON_SYMBOL_@", "z", 0));
+    unknowns.add_transition(0, HfstBasicTransition(4, "a", "a", 0));
+    unknowns.set_final_weight(1, 0);
+    unknowns.set_final_weight(2, 0);
+    unknowns.set_final_weight(4, 0);
+    HfstEpsilonCycleIndex unknowns_index(unknowns);
+    assert(infinitely_ambiguous(unknowns, unknowns_index, "c", false));
+    assert(infinitely_ambiguous(unknowns, unknowns_index, "c", true));
+    assert(! infinitely_ambiguous(unknowns, unknowns_index, "a", false));
+    assert(! infinitely_ambiguous(unknowns, unknowns_index, "a c", false));
+  }
+
+  {
+    // Small random transducers with epsilons, flags and unknown and
+    // identity symbols, and all short strings
+    const char * transition_symbols[] =
+      { "a", "b", "@_EPSILON_SYMBOL_@", "@P.F.x@", "@R.F.x@", "@P.F.y@",
+        "@D.F@", "@_UNKNOWN_SYMBOL_@", "@_IDENTITY_SYMBOL_@" };
+    const unsigned int TRANSITION_SYMBOLS = 9;
+    const char * input_symbols[] = { "a", "b", "c", "@P.F.x@" };
+    const unsigned int INPUT_SYMBOLS = 4;
+
+    unsigned int seed = 1;
+    unsigned int answers[2][2] = { { 0, 0 }, { 0, 0 } };
+    for (unsigned int n=0; n < 300; n++)
+      {
+        HfstBasicTransducer t;
+        unsigned int states = 1 + next_random(seed, 5);
+        unsigned int transitions = next_random(seed, 3 * states);
+        for (unsigned int i=0; i < transitions; i++)
+          {
+            std::string input =
+              transition_symbols[next_random(seed, TRANSITION_SYMBOLS)];
+            std::string output = input;
+            if (! FdOperation::is_diacritic(input) && next_random(seed, 2))
+              {
+                output = (input == "@_IDENTITY_SYMBOL_@") ? input : "a";
+              }
+            t.add_transition
+              (next_random(seed, states),
+               HfstBasicTransition(next_random(seed, states),
+                                   input, output, 0));
+          }
+        t.set_final_weight(next_random(seed, states), 0);
+        HfstEpsilonCycleIndex index(t);
+
+        std::vector<std::string> inputs(1, "");
+        for (unsigned int length=0; length <= 3; length++)
+          {
+            std::vector<std::string> longer;
+            for (unsigned int i=0; i < inputs.size(); i++)
+              {
+                for (unsigned int obey_flags=0; obey_flags < 2; obey_flags++)
+                  {
+                    bool answer = infinitely_ambiguous
+                      (t, index, inputs[i], obey_flags != 0);
+                    answers[obey_flags][answer]++;
+                  }
+                for (unsigned int j=0; j < INPUT_SYMBOLS; j++)
+                  {
+                    longer.push_back(inputs[i] + " " + input_symbols[j]);
+                  }
+              }
+            inputs.swap(longer);
+          }
+      }
+    // Both answers were checked, with and without obeying flags
+    assert(answers[0][0] > 0 && answers[0][1] > 0);
+    assert(answers[1][0] > 0 && answers[1][1] > 0);
+  }
+
+}
@@ -0,0 +1,188 @@
+/*
+   Test file for looking up in one optimized-lookup transducer from several
+   threads at the same time, each with a LookupSession of its own, and for
+   building its lookdown index from several threads.
+*/
+
+#include "HfstTransducer.h"
+#include "auxiliary_functions.cc"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace hfst;
+using hfst::implementations::HfstBasicTransducer;
+
+/* The number of threads, and the number of times each thread looks up
+   all inputs. */
+static const unsigned int THREADS = 4;
+static const unsigned int ROUNDS = 3;
+
+/* The path of the test data file \a name. */
+static std::string srcdir_file(const std::string & name)
+{
+  const char * srcdir = getenv("srcdir");
+  return std::string(srcdir == NULL ? "." : srcdir) + "/" + name;
+}
+
+/* Every string of at most three symbols of the alphabet of
+   test_optimized_lookup.att, and some with symbols it doesn't have. */
+static std::vector<StringVector> all_inputs()
+{
+  FILE * file = fopen(srcdir_file("test_optimized_lookup.att").c_str(), "rb");
+  assert(file != NULL);
+  HfstBasicTransducer basic(file);
+  fclose(file);
+
+  StringVector symbols;
+  const std::set<std::string> & alphabet = basic.get_alphabet();
+  for (std::set<std::string>::const_iterator it = alphabet.begin();
+       it != alphabet.end(); ++it)
+    {
+      if (! FdOperation::is_diacritic(*it) && ! is_epsilon(*it) &&
+          *it != "@_UNKNOWN_SYMBOL_@" && *it != "@_IDENTITY_SYMBOL_@")
+        { symbols.push_back(*it); }
+    }
+  std::vector<StringVector> retval;
+  std::vector<StringVector> inputs(1, StringVector());
+  for (size_t length = 0; length <= 3; ++length)
+    {
+      std::vector<StringVector> longer;
+      for (size_t i = 0; i < inputs.size(); ++i)
+        {
+          retval.push_back(inputs[i]);
+          for (size_t j = 0; j < symbols.size(); ++j)
+            {
+              longer.push_back(inputs[i]);
+              longer.back().push_back(symbols[j]);
+            }
+        }
+      inputs.swap(longer);
+    }
+  /* Symbols that are not in the alphabet are numbered in the session */
+  const char * unknown [] = { "+Sg", "<tag>", "ä", NULL };
+  for (unsigned int i = 0; unknown[i] != NULL; ++i)
+    {
+      for (size_t j = 0; j < symbols.size(); ++j)
+        {
+          StringVector input;
+          input.push_back(symbols[j]);
+          input.push_back(unknown[i]);
+          retval.push_back(input);
+          input.insert(input.begin(), unknown[i]);
+          retval.push_back(input);
+        }
+    }
+  return retval;
+}
+
+/* Look up all \a inputs ROUNDS times in a session of \a t of its own. */
+static void lookup_all(const hfst_ol::Transducer * t,
+                       const std::vector<StringVector> * inputs,
+                       std::vector<HfstOneLevelPaths> * results)
+{
+  hfst_ol::LookupSession session(*t);
+  for (unsigned int round = 0; round < ROUNDS; ++round)
+    {
+      for (size_t i = 0; i < inputs->size(); ++i)
+        {
+          HfstOneLevelPaths * paths = session.lookup_fd((*inputs)[i]);
+          results->push_back(*paths);
+          delete paths;
+        }
+    }
+}
+
+/* Threads looking up in the same transducer at the same time get what
+   one thread gets. */
+static void test_lookup_threads()
+{
+  std::ifstream in(srcdir_file("test_optimized_lookup.hfstol").c_str(),
+                   std::ios::in | std::ios::binary);
+  assert(in.good());
+  hfst_ol::Transducer t(in);
+  std::vector<StringVector> inputs = all_inputs();
+
+  std::vector<HfstOneLevelPaths> serial;
+  lookup_all(&t, &inputs, &serial);
+  assert(serial.size() == ROUNDS * inputs.size());
+  /* The same as from the session of the transducer itself */
+  bool found = false;
+  for (size_t i = 0; i < inputs.size(); ++i)
+    {
+      HfstOneLevelPaths * paths = t.lookup_fd(inputs[i]);
+      assert(serial[i] == *paths);
+      delete paths;
+      assert(serial[i] == serial[i + inputs.size()]);
+      found = found || !serial[i].empty();
+    }
+  assert(found);
+
+  std::vector<std::vector<HfstOneLevelPaths> > results(THREADS);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      threads.push_back(std::thread(lookup_all, &t, &inputs, &results[i]));
+    }
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      threads[i].join();
+    }
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      assert(results[i] == serial);
+    }
+}
+
+/* Ask for the inverse of \a t, counting the times it is built. */
+static void get_inverse(hfst_ol::Transducer * t,
+                        std::atomic<unsigned int> * built,
+                        hfst_ol::Transducer ** inverse)
+{
+  *inverse = t->get_or_build_inverse([built](hfst_ol::Transducer * t)
+    {
+      ++*built;
+      return new hfst_ol::Transducer(*t);
+    });
+}
+
+/* Threads that need the lookdown index of the same transducer at the
+   same time build it once. */
+static void test_inverse_threads()
+{
+  std::ifstream in(srcdir_file("test_optimized_lookup.hfstol").c_str(),
+                   std::ios::in | std::ios::binary);
+  assert(in.good());
+  hfst_ol::Transducer t(in);
+  assert(t.get_inverse() == NULL);
+
+  std::atomic<unsigned int> built(0);
+  std::vector<hfst_ol::Transducer *> inverses(THREADS, NULL);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      threads.push_back(std::thread(get_inverse, &t, &built, &inverses[i]));
+    }
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      threads[i].join();
+    }
+  assert(built == 1);
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      assert(inverses[i] != NULL && inverses[i] == t.get_inverse());
+    }
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("lookup in one transducer from several threads",
+                HFST_OLW_TYPE);
+  test_lookup_threads();
+  verbose_print("building the lookdown index from several threads",
+                HFST_OLW_TYPE);
+  test_inverse_threads();
+}
@@ -0,0 +1,641 @@
+/*
+   Test file for the optimized-lookup backend (hfst_ol::Transducer).
+*/
+
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstOutputStream.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "auxiliary_functions.cc"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <new>
+
+using namespace hfst;
+using hfst::implementations::HfstState;
+using hfst::implementations::HfstBasicTransducer;
+using hfst::implementations::HfstBasicTransition;
+using hfst::implementations::ConversionFunctions;
+
+/* cat:chat, cat:cats <1>, dog:dogs <2.5> */
+static HfstBasicTransducer animals()
+{
+  HfstBasicTransducer t;
+  HfstState s1 = t.add_state();
+  HfstState s2 = t.add_state();
+  HfstState s3 = t.add_state();
+  HfstState s4 = t.add_state();
+  HfstState s5 = t.add_state();
+  HfstState s6 = t.add_state();
+  HfstState s7 = t.add_state();
+  t.add_transition(0, HfstBasicTransition(s1, "c", "c", 0));
+  t.add_transition(s1, HfstBasicTransition(s2, "a", "h", 0));
+  t.add_transition(s2, HfstBasicTransition(s3, "t", "a", 0));
+  t.add_transition(s3, HfstBasicTransition(s4, "@_EPSILON_SYMBOL_@", "t", 0));
+  t.set_final_weight(s4, 0);
+  t.add_transition(s1, HfstBasicTransition(s5, "a", "a", 0));
+  t.add_transition(s5, HfstBasicTransition(s6, "t", "t", 0));
+  t.add_transition(s6, HfstBasicTransition(s7, "@_EPSILON_SYMBOL_@", "s", 1));
+  t.set_final_weight(s7, 0);
+  HfstState d1 = t.add_state();
+  HfstState d2 = t.add_state();
+  HfstState d3 = t.add_state();
+  HfstState d4 = t.add_state();
+  t.add_transition(0, HfstBasicTransition(d1, "d", "d", 0));
+  t.add_transition(d1, HfstBasicTransition(d2, "o", "o", 0));
+  t.add_transition(d2, HfstBasicTransition(d3, "g", "g", 0));
+  t.add_transition(d3, HfstBasicTransition(d4, "@_EPSILON_SYMBOL_@", "s", 0));
+  t.set_final_weight(d4, 2.5);
+  return t;
+}
+
+/* The results of looking up \a input in \a t. Unweighted transducers
+   built in memory may still carry weights that a copy or a written and
+   read transducer does not, so their weights are zeroed. */
+static HfstOneLevelPaths lookup(hfst_ol::Transducer & t,
+                                const std::string & input)
+{
+  HfstOneLevelPaths * paths = t.lookup_fd(input);
+  HfstOneLevelPaths retval;
+  for (HfstOneLevelPaths::const_iterator it = paths->begin();
+       it != paths->end(); ++it)
+    {
+      retval.insert(HfstOneLevelPath(t.is_weighted() ? it->first : 0,
+                                     it->second));
+    }
+  delete paths;
+  return retval;
+}
+
+static void test_copy(bool weighted)
+{
+  HfstBasicTransducer basic = animals();
+  hfst_ol::Transducer * original =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&basic, weighted);
+  HfstOneLevelPaths expected = lookup(*original, "cat");
+  assert(expected.size() == 2);
+
+  /* A copy must own its tables: destroying either copy first must leave
+     the other usable, and destroying both must not double free. */
+  hfst_ol::Transducer * copy = new hfst_ol::Transducer(*original);
+  delete original;
+  assert(lookup(*copy, "cat") == expected);
+  hfst_ol::Transducer * copy_of_copy = new hfst_ol::Transducer(*copy);
+  assert(lookup(*copy_of_copy, "cat") == expected);
+  delete copy_of_copy;
+  assert(lookup(*copy, "cat") == expected);
+  delete copy;
+}
+
+static const char * inputs [] = { "cat", "dog", "ca", "cats", "" };
+static const unsigned int INPUTS_SIZE=5;
+
+/* Lookups in all \a inputs through the HfstTransducer interface. */
+static std::vector<HfstOneLevelPaths> lookups(HfstTransducer & t)
+{
+  std::vector<HfstOneLevelPaths> retval;
+  for (unsigned int i=0; i<INPUTS_SIZE; i++)
+    {
+      HfstOneLevelPaths * paths = t.lookup_fd(std::string(inputs[i]));
+      retval.push_back(*paths);
+      delete paths;
+    }
+  return retval;
+}
+
+static void test_memory_mapping(ImplementationType type)
+{
+  HfstTransducer written(animals(), type);
+  {
+    HfstOutputStream out("optimized_lookup.hfst", type);
+    out << written;
+    out.close();
+  }
+  HfstInputStream loaded_in("optimized_lookup.hfst");
+  HfstTransducer loaded(loaded_in);
+  loaded_in.close();
+  std::vector<HfstOneLevelPaths> expected = lookups(loaded);
+  assert(expected[0].size() == 2);
+
+  HfstInputStream mapped_in("optimized_lookup.hfst");
+  mapped_in.set_memory_mapping(true);
+  HfstTransducer * mapped = new HfstTransducer(mapped_in);
+  mapped_in.close();
+  assert(lookups(*mapped) == expected);
+
+  /* Copies share the mapping, which must outlive the original. */
+  HfstTransducer copy(*mapped);
+  delete mapped;
+  assert(lookups(copy) == expected);
+}
+
+/* Add \a input:\a output to \a t, one weight per symbol pair. */
+static void add_path(HfstBasicTransducer & t, const std::string & input,
+                     const std::string & output,
+                     const std::vector<float> & weights)
+{
+  HfstState s = 0;
+  for (size_t i = 0; i < input.size(); i++)
+    {
+      HfstState target = t.add_state();
+      t.add_transition(s, HfstBasicTransition(target,
+                                              input.substr(i, 1),
+                                              output.substr(i, 1),
+                                              weights[i]));
+      s = target;
+    }
+  t.set_final_weight(s, 0);
+}
+
+/* The corrections of \a input by \a speller, lightest first. */
+static std::vector<hfst_ol::StringWeightPair> corrections
+(hfst_ol::Speller & speller, const std::string & input, int max_results=0,
+ hfst_ol::Weight max_weight=-1.0, hfst_ol::Weight beam=-1.0)
+{
+  std::vector<char> line(input.begin(), input.end());
+  line.push_back('\0');
+  hfst_ol::CorrectionQueue queue =
+    speller.correct(&line[0], max_results, max_weight, beam);
+  std::vector<hfst_ol::StringWeightPair> retval;
+  for (; !queue.empty(); queue.pop())
+    {
+      retval.push_back(queue.top());
+    }
+  return retval;
+}
+
+static void test_negative_error_model_weights()
+{
+  HfstBasicTransducer lexicon;
+  add_path(lexicon, "cat", "cat", std::vector<float>(3, 0));
+  add_path(lexicon, "cut", "cut", std::vector<float>(3, 0));
+
+  /* Two ways of keeping "cat": weight 0, and 2 - 5 = -3, which is only
+     known to be lighter after the heavier first step. */
+  HfstBasicTransducer error_model;
+  add_path(error_model, "cat", "cat", std::vector<float>(3, 0));
+  std::vector<float> detour(3, 0);
+  detour[0] = 2;
+  detour[1] = -5;
+  add_path(error_model, "cat", "cat", detour);
+  add_path(error_model, "cat", "cut", std::vector<float>(3, 1));
+
+  hfst_ol::Transducer * lexicon_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&lexicon, true);
+  hfst_ol::Transducer * error_model_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&error_model, true);
+  hfst_ol::Speller speller(error_model_ol, lexicon_ol);
+
+  std::vector<hfst_ol::StringWeightPair> result = corrections(speller, "cat");
+  assert(result.size() == 2);
+  assert(result[0].first == "cat" && result[0].second == -3);
+  assert(result[1].first == "cut" && result[1].second == 3);
+
+  result = corrections(speller, "cat", 1);
+  assert(result.size() == 1);
+  assert(result[0].first == "cat" && result[0].second == -3);
+
+  delete lexicon_ol;
+  delete error_model_ol;
+}
+
+/* Add the path of \a symbols, each its own input and output, to \a t. */
+static void add_symbols(HfstBasicTransducer & t,
+                        const std::vector<std::string> & symbols)
+{
+  HfstState s = 0;
+  for (size_t i = 0; i < symbols.size(); i++)
+    {
+      HfstState target = t.add_state();
+      t.add_transition(s, HfstBasicTransition(target, symbols[i],
+                                              symbols[i], 0));
+      s = target;
+    }
+  t.set_final_weight(s, 0);
+}
+
+static void test_corrections_with_flags()
+{
+  /* "ab" only through agreeing flags, "aab" not at all. */
+  HfstBasicTransducer lexicon;
+  const char * ab [] = { "@P.F.x@", "a", "@R.F.x@", "b" };
+  const char * aab [] = { "@P.F.y@", "a", "a", "@R.F.x@", "b" };
+  add_symbols(lexicon, std::vector<std::string>(ab, ab + 4));
+  add_symbols(lexicon, std::vector<std::string>(aab, aab + 5));
+
+  /* a and b kept for free or swapped for 1. */
+  HfstBasicTransducer error_model;
+  error_model.set_final_weight(0, 0);
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "a", 0));
+  error_model.add_transition(0, HfstBasicTransition(0, "b", "b", 0));
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "b", 1));
+  error_model.add_transition(0, HfstBasicTransition(0, "b", "a", 1));
+
+  hfst_ol::Transducer * lexicon_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&lexicon, true);
+  hfst_ol::Transducer * error_model_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&error_model, true);
+  hfst_ol::Speller speller(error_model_ol, lexicon_ol);
+
+  /* Repeated searches reuse the pooled nodes and flag states. The
+     flags are part of the corrections. */
+  const std::string flagged_ab = "@P.F.x@a@R.F.x@b";
+  for (unsigned int i = 0; i < 3; i++)
+    {
+      std::vector<hfst_ol::StringWeightPair> result =
+        corrections(speller, "bb");
+      assert(result.size() == 1);
+      assert(result[0].first == flagged_ab && result[0].second == 1);
+      result = corrections(speller, "ab");
+      assert(result.size() == 1);
+      assert(result[0].first == flagged_ab && result[0].second == 0);
+      result = corrections(speller, "ba");
+      assert(result.size() == 1);
+      assert(result[0].first == flagged_ab && result[0].second == 2);
+    }
+
+  delete lexicon_ol;
+  delete error_model_ol;
+}
+
+static void test_correction_limits()
+{
+  HfstBasicTransducer lexicon;
+  const char * words [] = { "cat", "cut", "cot", "cit" };
+  for (unsigned int i = 0; i < 4; i++)
+    {
+      add_path(lexicon, words[i], words[i], std::vector<float>(3, 0));
+    }
+
+  /* An "a" kept for free or changed for 1, 2 and 4. A "u" is never
+     kept, and is changed for 3, 4 and 6. */
+  HfstBasicTransducer error_model;
+  error_model.set_final_weight(0, 0);
+  error_model.add_transition(0, HfstBasicTransition(0, "c", "c", 0));
+  error_model.add_transition(0, HfstBasicTransition(0, "t", "t", 0));
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "a", 0));
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "u", 1));
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "o", 2));
+  error_model.add_transition(0, HfstBasicTransition(0, "a", "i", 4));
+  error_model.add_transition(0, HfstBasicTransition(0, "u", "a", 3));
+  error_model.add_transition(0, HfstBasicTransition(0, "u", "o", 4));
+  error_model.add_transition(0, HfstBasicTransition(0, "u", "i", 6));
+
+  hfst_ol::Transducer * lexicon_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&lexicon, true);
+  hfst_ol::Transducer * error_model_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&error_model, true);
+  hfst_ol::Speller speller(error_model_ol, lexicon_ol);
+
+  /* The weights are not negative, so these go through the best-first
+     search. */
+  std::vector<hfst_ol::StringWeightPair> result = corrections(speller, "cat");
+  assert(result.size() == 4);
+  assert(result[3].first == "cit" && result[3].second == 4);
+
+  /* Corrections heavier than max_weight are dropped. */
+  result = corrections(speller, "cat", 0, 2.5);
+  assert(result.size() == 3);
+  assert(result[0].first == "cat" && result[0].second == 0);
+  assert(result[1].first == "cut" && result[1].second == 1);
+  assert(result[2].first == "cot" && result[2].second == 2);
+  result = corrections(speller, "cat", 0, 2); // "cot" is not above it
+  assert(result.size() == 3);
+
+  /* The beam is counted from the best correction, here 0 and 3. */
+  result = corrections(speller, "cat", 0, -1.0, 1.5);
+  assert(result.size() == 2);
+  assert(result[0].first == "cat" && result[0].second == 0);
+  assert(result[1].first == "cut" && result[1].second == 1);
+  result = corrections(speller, "cut", 0, -1.0, 1.5);
+  assert(result.size() == 2);
+  assert(result[0].first == "cat" && result[0].second == 3);
+  assert(result[1].first == "cot" && result[1].second == 4);
+
+  /* The tighter of the two limits applies. */
+  result = corrections(speller, "cut", 0, 3.5, 1.5);
+  assert(result.size() == 1);
+  assert(result[0].first == "cat");
+  result = corrections(speller, "cut", 0, 10, 1.5);
+  assert(result.size() == 2);
+  result = corrections(speller, "cut", 0, 2.5);
+  assert(result.size() == 0);
+
+  delete lexicon_ol;
+  delete error_model_ol;
+}
+
+static void test_shared_speller_cache()
+{
+  HfstBasicTransducer cat_lexicon;
+  add_path(cat_lexicon, "cat", "cat", std::vector<float>(3, 0));
+  HfstBasicTransducer cut_lexicon;
+  add_path(cut_lexicon, "cut", "cut", std::vector<float>(3, 0));
+  /* Both know every symbol the error model gives, through dead ends. */
+  cat_lexicon.add_transition
+    (0, HfstBasicTransition(cat_lexicon.add_state(), "u", "u", 0));
+  cut_lexicon.add_transition
+    (0, HfstBasicTransition(cut_lexicon.add_state(), "a", "a", 0));
+  HfstBasicTransducer error_model;
+  add_path(error_model, "cat", "cat", std::vector<float>(3, 0));
+  add_path(error_model, "cat", "cut", std::vector<float>(3, 1));
+
+  hfst_ol::Transducer * cat_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&cat_lexicon, true);
+  hfst_ol::Transducer * cut_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&cut_lexicon, true);
+  hfst_ol::Transducer * error_model_ol =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&error_model, true);
+  hfst_ol::Speller cat_speller(error_model_ol, cat_ol);
+  hfst_ol::Speller cut_speller(error_model_ol, cut_ol);
+
+  /* The spellers must not get each other's results from the cache. */
+  hfst_ol::SpellerCache cache(10);
+  cat_speller.set_cache(&cache);
+  cut_speller.set_cache(&cache);
+  for (unsigned int i = 0; i < 2; i++)
+    {
+      char line [] = "cat";
+      assert(cat_speller.check(line));
+      assert(!cut_speller.check(line));
+
+      std::vector<hfst_ol::StringWeightPair> result =
+        corrections(cat_speller, "cat");
+      assert(result.size() == 1);
+      assert(result[0].first == "cat" && result[0].second == 0);
+      result = corrections(cut_speller, "cat");
+      assert(result.size() == 1);
+      assert(result[0].first == "cut" && result[0].second == 3);
+    }
+  assert(cache.size() == 4);
+  assert(cache.get_misses() == 4);
+  assert(cache.get_hits() == 4);
+
+  /* A transducer read to the address of a deleted one must not get the
+     results of the deleted one. */
+  std::stringstream cut_stream;
+  cut_ol->write(cut_stream);
+  void * storage = ::operator new(sizeof(hfst_ol::Transducer));
+  hfst_ol::Transducer * lexicon = new (storage) hfst_ol::Transducer(*cat_ol);
+  {
+    hfst_ol::Speller speller(error_model_ol, lexicon);
+    speller.set_cache(&cache);
+    char line [] = "cat";
+    assert(speller.check(line));
+    assert(corrections(speller, "cat")[0].first == "cat");
+  }
+  lexicon->~Transducer();
+  lexicon = new (storage) hfst_ol::Transducer(cut_stream);
+  {
+    hfst_ol::Speller speller(error_model_ol, lexicon);
+    speller.set_cache(&cache);
+    char line [] = "cat";
+    assert(!speller.check(line));
+    std::vector<hfst_ol::StringWeightPair> result =
+      corrections(speller, "cat");
+    assert(result.size() == 1);
+    assert(result[0].first == "cut" && result[0].second == 3);
+  }
+  lexicon->~Transducer();
+  ::operator delete(storage);
+
+  delete cat_ol;
+  delete cut_ol;
+  delete error_model_ol;
+}
+
+/* Converting from OpenFst straight to optimized-lookup must honour the
+   conversion options like the conversion through HfstBasicTransducer. */
+static void test_conversion_options(const std::string & options)
+{
+  if (! HfstTransducer::is_implementation_type_available
+      (TROPICAL_OPENFST_TYPE))
+    { return; }
+  HfstBasicTransducer basic = animals();
+  hfst_ol::Transducer * expected =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol
+    (&basic, true, options);
+
+  HfstTransducer t(basic, TROPICAL_OPENFST_TYPE);
+  t.convert(HFST_OLW_TYPE, options + " lookdown");
+  hfst_ol::Transducer * converted =
+    ConversionFunctions::hfst_transducer_to_hfst_ol(&t);
+  assert(converted->get_inverse() != NULL);
+  assert(converted->get_header().index_table_size() ==
+         expected->get_header().index_table_size());
+  assert(converted->get_header().target_table_size() ==
+         expected->get_header().target_table_size());
+  assert(lookup(*converted, "cat") == lookup(*expected, "cat"));
+  delete expected;
+}
+
+static const char * outputs [] = { "chat", "cats", "dogs", "cat", "" };
+static const unsigned int OUTPUTS_SIZE=5;
+
+/* Lookdowns in all \a outputs through the HfstTransducer interface, or
+   lookups if \a down is false. The weights are zeroed as in lookup above
+   unless \a t is weighted. */
+static std::vector<HfstOneLevelPaths> lookdowns(HfstTransducer & t,
+                                                bool down=true)
+{
+  std::vector<HfstOneLevelPaths> retval;
+  for (unsigned int i=0; i<OUTPUTS_SIZE; i++)
+    {
+      HfstOneLevelPaths * paths = down ?
+        t.lookdown_fd(std::string(outputs[i])) :
+        t.lookup_fd(std::string(outputs[i]));
+      HfstOneLevelPaths unweighted;
+      for (HfstOneLevelPaths::const_iterator it = paths->begin();
+           it != paths->end(); ++it)
+        {
+          unweighted.insert(HfstOneLevelPath
+                            (t.get_type() == HFST_OLW_TYPE ? it->first : 0,
+                             it->second));
+        }
+      retval.push_back(unweighted);
+      delete paths;
+    }
+  return retval;
+}
+
+/* Lookdown must give what lookup gives in the inverted transducer, also
+   when the index has been written and read back or converted between the
+   optimized-lookup types. */
+static void test_lookdown(ImplementationType type)
+{
+  if (! HfstTransducer::is_implementation_type_available
+      (TROPICAL_OPENFST_TYPE))
+    { return; }
+  HfstTransducer inverted(animals(), TROPICAL_OPENFST_TYPE);
+  inverted.invert().convert(type);
+  std::vector<HfstOneLevelPaths> expected = lookdowns(inverted, false);
+  assert(expected[0].size() == 1);
+
+  HfstTransducer written(animals(), TROPICAL_OPENFST_TYPE);
+  written.convert(type, "lookdown");
+  assert(ConversionFunctions::hfst_transducer_to_hfst_ol(&written)
+         ->get_inverse() != NULL);
+  assert(lookdowns(written) == expected);
+  {
+    HfstOutputStream out("optimized_lookup.hfst", type);
+    out << written;
+    out.close();
+  }
+  HfstInputStream in("optimized_lookup.hfst");
+  HfstTransducer loaded(in);
+  in.close();
+  assert(ConversionFunctions::hfst_transducer_to_hfst_ol(&loaded)
+         ->get_inverse() != NULL);
+  assert(lookdowns(loaded) == expected);
+  assert(lookups(loaded)[0].size() == 2);
+
+  /* The index is kept when converting to the other optimized-lookup type,
+     as when a stream is read as the other type. */
+  ImplementationType other_type =
+    (type == HFST_OL_TYPE) ? HFST_OLW_TYPE : HFST_OL_TYPE;
+  loaded.convert(other_type);
+  assert(ConversionFunctions::hfst_transducer_to_hfst_ol(&loaded)
+         ->get_inverse() != NULL);
+  std::vector<HfstOneLevelPaths> converted = lookdowns(loaded);
+  for (unsigned int i=0; i<OUTPUTS_SIZE; i++)
+    { assert(converted[i].size() == expected[i].size()); }
+}
+
+/* The path of the test data file \a name. */
+static std::string srcdir_file(const std::string & name)
+{
+  const char * srcdir = getenv("srcdir");
+  return std::string(srcdir == NULL ? "." : srcdir) + "/" + name;
+}
+
+/* The fixed transducer in test_optimized_lookup.att. */
+static HfstBasicTransducer fixed_transducer()
+{
+  FILE * file = fopen(srcdir_file("test_optimized_lookup.att").c_str(), "rb");
+  assert(file != NULL);
+  HfstBasicTransducer t(file);
+  fclose(file);
+  return t;
+}
+
+/* The default packing must give the tables it gave before the index slot
+   search was rewritten. test_optimized_lookup.hfstol was converted from
+   test_optimized_lookup.att with the old linear search. */
+static void test_default_packing()
+{
+  HfstBasicTransducer basic = fixed_transducer();
+  hfst_ol::Transducer * converted =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&basic, true);
+  std::ostringstream converted_bytes;
+  converted->write(converted_bytes);
+  delete converted;
+
+  std::ifstream expected_in(srcdir_file("test_optimized_lookup.hfstol").c_str(),
+                            std::ios::in | std::ios::binary);
+  assert(expected_in.good());
+  std::ostringstream expected_bytes;
+  expected_bytes << expected_in.rdbuf();
+  assert(converted_bytes.str() == expected_bytes.str());
+}
+
+/* All results of looking up every string of at most three symbols of the
+   alphabet of \a basic in \a t. */
+static std::vector<HfstOneLevelPaths> all_lookups
+(hfst_ol::Transducer & t, const HfstBasicTransducer & basic)
+{
+  StringVector symbols;
+  const std::set<std::string> & alphabet = basic.get_alphabet();
+  for (std::set<std::string>::const_iterator it = alphabet.begin();
+       it != alphabet.end(); ++it)
+    {
+      if (! FdOperation::is_diacritic(*it) && ! is_epsilon(*it) &&
+          *it != "@_UNKNOWN_SYMBOL_@" && *it != "@_IDENTITY_SYMBOL_@")
+        { symbols.push_back(*it); }
+    }
+  std::vector<HfstOneLevelPaths> retval;
+  std::vector<StringVector> inputs(1, StringVector());
+  for (size_t length = 0; length <= 3; ++length)
+    {
+      std::vector<StringVector> longer;
+      for (size_t i = 0; i < inputs.size(); ++i)
+        {
+          HfstOneLevelPaths * paths = t.lookup_fd(inputs[i]);
+          retval.push_back(*paths);
+          delete paths;
+          for (size_t j = 0; j < symbols.size(); ++j)
+            {
+              longer.push_back(inputs[i]);
+              longer.back().push_back(symbols[j]);
+            }
+        }
+      inputs.swap(longer);
+    }
+  return retval;
+}
+
+/* The "quick" and "compact" packings lay out the tables differently from
+   the default one but must not change what is looked up. */
+static void test_packing_options()
+{
+  HfstBasicTransducer basic = fixed_transducer();
+  hfst_ol::Transducer * packed =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol(&basic, true);
+  hfst_ol::Transducer * quick =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol
+    (&basic, true, "quick");
+  hfst_ol::Transducer * compact =
+    ConversionFunctions::hfst_basic_transducer_to_hfst_ol
+    (&basic, true, "compact");
+  assert(quick->get_header().index_table_size() !=
+         compact->get_header().index_table_size());
+
+  std::vector<HfstOneLevelPaths> expected = all_lookups(*packed, basic);
+  unsigned int found = 0;
+  for (size_t i = 0; i < expected.size(); ++i)
+    { found += hfst::size_t_to_uint(expected[i].size()); }
+  assert(found > 0);
+  assert(all_lookups(*quick, basic) == expected);
+  assert(all_lookups(*compact, basic) == expected);
+  delete packed;
+  delete quick;
+  delete compact;
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("hfst_ol::Transducer copy constructor", HFST_OL_TYPE);
+  test_copy(false);
+  verbose_print("hfst_ol::Transducer copy constructor", HFST_OLW_TYPE);
+  test_copy(true);
+
+  verbose_print("memory-mapped lookup", HFST_OL_TYPE);
+  test_memory_mapping(HFST_OL_TYPE);
+  verbose_print("memory-mapped lookup", HFST_OLW_TYPE);
+  test_memory_mapping(HFST_OLW_TYPE);
+
+  verbose_print("spelling correction with negative weights", HFST_OLW_TYPE);
+  test_negative_error_model_weights();
+  verbose_print("spelling correction with flag diacritics", HFST_OLW_TYPE);
+  test_corrections_with_flags();
+  verbose_print("spelling correction with weight limits", HFST_OLW_TYPE);
+  test_correction_limits();
+  verbose_print("spellers sharing a cache", HFST_OLW_TYPE);
+  test_shared_speller_cache();
+
+  verbose_print("lookdown", HFST_OL_TYPE);
+  test_lookdown(HFST_OL_TYPE);
+  verbose_print("lookdown", HFST_OLW_TYPE);
+  test_lookdown(HFST_OLW_TYPE);
+
+  verbose_print("default index packing", HFST_OLW_TYPE);
+  test_default_packing();
+  verbose_print("quick and compact index packing", HFST_OLW_TYPE);
+  test_packing_options();
+
+  verbose_print("conversion options", TROPICAL_OPENFST_TYPE);
+  test_conversion_options("");
+  test_conversion_options("quick");
+  test_conversion_options("compact");
+}
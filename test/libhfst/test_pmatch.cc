@@ -0,0 +1,609 @@
+/*
+   Test file for pmatch.
+*/
+
+#include "HfstTransducer.h"
+#include "parsers/pmatch_utils.h"
+#include "parsers/PmatchCompiler.h"
+#include "implementations/optimized-lookup/pmatch.h"
+#include "auxiliary_functions.cc"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace hfst;
+using namespace hfst::pmatch;
+
+typedef std::vector<std::pair<std::string, WordVecFloat> > Neighbours;
+
+static const char * VECTOR_FILE = "test_pmatch_vectors";
+
+/* \a count vectors of dimension \a dimension around \a clusters random
+   centers, named w0, w1... */
+static WordVectorMatrix make_vectors(size_t count, size_t dimension,
+                                     size_t clusters, unsigned int seed)
+{
+  std::mt19937 random(seed);
+  std::normal_distribution<WordVecFloat> normal;
+  std::vector<std::vector<WordVecFloat> > centers(
+    clusters, std::vector<WordVecFloat>(dimension));
+  for (size_t i = 0; i < clusters; ++i)
+    for (size_t j = 0; j < dimension; ++j)
+      centers[i][j] = normal(random);
+  WordVectorMatrix vecs;
+  for (size_t i = 0; i < count; ++i)
+    {
+      std::vector<WordVecFloat> v(dimension);
+      for (size_t j = 0; j < dimension; ++j)
+        v[j] = centers[i % clusters][j] + 0.3 * normal(random);
+      vecs.push_back("w" + std::to_string(i), v);
+    }
+  return vecs;
+}
+
+static double dot(const std::vector<WordVecFloat> & l,
+                  const std::vector<WordVecFloat> & r)
+{
+  double retval = 0;
+  for (size_t i = 0; i < l.size(); ++i)
+    retval += (double)l[i] * r[i];
+  return retval;
+}
+
+/* The cosine distance of \a l and \a r, computed without the matrix. */
+static double cosine_distance(const std::vector<WordVecFloat> & l,
+                              const std::vector<WordVecFloat> & r)
+{
+  return std::max(0.0, 1.0 - dot(l, r) / sqrt(dot(l, l) * dot(r, r)));
+}
+
+/* The \a n smallest distances of all the vectors from \a query, from
+   the most distant to the nearest like get_top_n gives them. */
+static std::vector<double> nearest_distances
+(size_t n, const WordVectorMatrix & vecs, const std::vector<WordVecFloat> & query)
+{
+  std::vector<double> distances;
+  for (size_t i = 0; i < vecs.size(); ++i)
+    distances.push_back(cosine_distance(vecs.get(i).vector, query));
+  std::sort(distances.begin(), distances.end());
+  distances.resize(std::min(n, distances.size()));
+  std::reverse(distances.begin(), distances.end());
+  return distances;
+}
+
+/* Check that each neighbour is at the distance given for it and that the
+   distances are \a expected. */
+static void check_neighbours(const Neighbours & neighbours,
+                             const WordVectorMatrix & vecs,
+                             const std::vector<WordVecFloat> & query,
+                             const std::vector<double> & expected)
+{
+  assert(neighbours.size() == expected.size());
+  for (size_t i = 0; i < neighbours.size(); ++i)
+    {
+      size_t row = vecs.find(neighbours[i].first);
+      assert(row < vecs.size());
+      double distance = cosine_distance(vecs.get(row).vector, query);
+      assert(fabs(distance - neighbours[i].second) < 1e-4);
+      assert(fabs(expected[i] - neighbours[i].second) < 1e-4);
+    }
+}
+
+static void test_word_vector_matrix()
+{
+  WordVectorMatrix vecs;
+  std::vector<WordVecFloat> v;
+  v.push_back(3);
+  v.push_back(0);
+  v.push_back(4);
+  vecs.push_back("a", v);
+  v[0] = 0;
+  v[2] = 0;
+  vecs.push_back("zero", v);
+
+  assert(vecs.size() == 2);
+  assert(vecs.dimension == 3);
+  assert(vecs.find("a") == 0);
+  assert(vecs.find("b") == vecs.size());
+  /* Rows are unit vectors, get() gives the original back */
+  assert(fabs(vecs.row(0)[0] - 0.6) < 1e-6);
+  assert(fabs(vecs.row(0)[2] - 0.8) < 1e-6);
+  assert(vecs.norms[0] == 5);
+  WordVector a = vecs.get(0);
+  assert(a.word == "a" && a.norm == 5);
+  assert(fabs(a.vector[0] - 3) < 1e-5 && fabs(a.vector[2] - 4) < 1e-5);
+  assert(vecs.row(1)[0] == 0 && vecs.norms[1] == 0);
+
+  vecs.clear();
+  assert(vecs.size() == 0 && vecs.dimension == 0 && vecs.index.empty());
+}
+
+static void test_exact_top_n()
+{
+  WordVectorMatrix vecs = make_vectors(500, 12, 10, 1);
+  for (size_t q = 0; q < 20; ++q)
+    {
+      WordVector query = vecs.get(q * 23);
+      /* Move the query off the stored vector */
+      query.vector[q % 12] += 0.5;
+      query.norm = sqrt(dot(query.vector, query.vector));
+      Neighbours top = get_top_n(7, vecs, query);
+      check_neighbours(top, vecs, query.vector,
+                       nearest_distances(7, vecs, query.vector));
+    }
+  /* Asking for more than there are gives all of them */
+  WordVector query = vecs.get(0);
+  assert(get_top_n(vecs.size() + 5, vecs, query).size() == vecs.size());
+  assert(get_top_n(0, vecs, query).size() == 0);
+  /* Without an index the approximate search is exact */
+  assert(get_top_n(5, vecs, query, true) == get_top_n(5, vecs, query));
+}
+
+static void test_approximate_top_n()
+{
+  /* More vectors than the index searches for one neighbour, so the
+     candidates are a real subset */
+  WordVectorMatrix vecs = make_vectors(3000, 8, 30, 2);
+  vecs.index.build(vecs, 16);
+  assert(!vecs.index.empty());
+  assert(vecs.index.roots.size() == 16);
+  /* Every vector is in exactly one leaf of each tree */
+  assert(vecs.index.leaf_items.size() == 16 * vecs.size());
+
+  for (size_t q = 0; q < 100; ++q)
+    {
+      WordVector query = vecs.get(q * 29);
+      /* A stored vector falls in its own leaf in every tree */
+      Neighbours nearest = get_top_n(1, vecs, query, true);
+      assert(nearest.size() == 1);
+      assert(nearest[0].first == query.word);
+
+      /* The approximate neighbours are real ones, never nearer than the
+         exact ones at the same rank */
+      Neighbours approximate = get_top_n(2, vecs, query, true);
+      std::vector<double> exact = nearest_distances(2, vecs, query.vector);
+      assert(approximate.size() == exact.size());
+      for (size_t i = 0; i < approximate.size(); ++i)
+        {
+          size_t row = vecs.find(approximate[i].first);
+          assert(row < vecs.size());
+          assert(fabs(cosine_distance(vecs.get(row).vector, query.vector)
+                      - approximate[i].second) < 1e-4);
+          assert(approximate[i].second > exact[i] - 1e-4);
+        }
+    }
+
+  /* Building again gives the same index */
+  WordVectorIndex again;
+  again.build(vecs, 16);
+  assert(again.roots == vecs.index.roots);
+  assert(again.leaf_items == vecs.index.leaf_items);
+}
+
+static void test_index_file()
+{
+  WordVectorMatrix vecs = make_vectors(400, 6, 8, 3);
+  vecs.filename = VECTOR_FILE;
+  std::string index_file = std::string(VECTOR_FILE) + ".idx";
+  remove(index_file.c_str());
+
+  /* Built and written */
+  vecs.prepare_index();
+  assert(!vecs.index.empty());
+  FILE * f = fopen(index_file.c_str(), "r");
+  assert(f != NULL);
+  fclose(f);
+
+  /* Read back for the same vectors */
+  WordVectorMatrix same = make_vectors(400, 6, 8, 3);
+  same.filename = VECTOR_FILE;
+  assert(same.index.read(index_file, same));
+  assert(same.index.roots == vecs.index.roots);
+  assert(same.index.leaf_items == vecs.index.leaf_items);
+  assert(same.index.nodes.size() == vecs.index.nodes.size());
+  WordVector query = vecs.get(7);
+  assert(get_top_n(3, same, query, true) == get_top_n(3, vecs, query, true));
+
+  /* Rejected for other vectors, even of the same size */
+  WordVectorMatrix other = make_vectors(400, 6, 8, 4);
+  assert(!other.index.read(index_file, other));
+  assert(other.index.empty());
+  WordVectorMatrix renamed = make_vectors(400, 6, 8, 3);
+  renamed.words[10] = "renamed";
+  assert(!renamed.index.read(index_file, renamed));
+  WordVectorMatrix fewer = make_vectors(399, 6, 8, 3);
+  assert(!fewer.index.read(index_file, fewer));
+
+  /* prepare_index rebuilds a stale index and replaces the file */
+  other.filename = VECTOR_FILE;
+  other.prepare_index();
+  assert(!other.index.empty());
+  assert(other.index.read(index_file, other));
+  assert(!same.index.read(index_file, same));
+
+  /* A truncated file is rejected */
+  f = fopen(index_file.c_str(), "w");
+  fputs("HFST vector index 1\n", f);
+  fclose(f);
+  assert(!same.index.read(index_file, same));
+  assert(!same.index.read(std::string(VECTOR_FILE) + ".missing", same));
+
+  remove(index_file.c_str());
+}
+
+/* The distances from \a comparison_point of each vector moved towards
+   the hyperplane plane_vec . x = translation_term, built explicitly. */
+static std::vector<double> transformed_distances
+(size_t n, const WordVectorMatrix & vecs,
+ const std::vector<WordVecFloat> & plane_vec,
+ const std::vector<WordVecFloat> & comparison_point,
+ WordVecFloat translation_term, bool negative,
+ WordVecFloat projection_factor)
+{
+  std::vector<double> distances;
+  for (size_t i = 0; i < vecs.size(); ++i)
+    {
+      std::vector<WordVecFloat> v = vecs.get(i).vector;
+      double scaler = (translation_term - dot(v, plane_vec))
+        / dot(plane_vec, plane_vec) * projection_factor;
+      if (negative)
+        scaler = -scaler;
+      for (size_t j = 0; j < v.size(); ++j)
+        v[j] += scaler * plane_vec[j];
+      distances.push_back(cosine_distance(v, comparison_point));
+    }
+  std::sort(distances.begin(), distances.end());
+  distances.resize(std::min(n, distances.size()));
+  std::reverse(distances.begin(), distances.end());
+  return distances;
+}
+
+static void test_transformed_top_n()
+{
+  WordVectorMatrix vecs = make_vectors(300, 5, 6, 5);
+  WordVector a = vecs.get(1);
+  WordVector b = vecs.get(2);
+  std::vector<WordVecFloat> plane_vec(a.vector.size());
+  for (size_t i = 0; i < plane_vec.size(); ++i)
+    plane_vec[i] = b.vector[i] - a.vector[i];
+  WordVecFloat translation_term = dot(b.vector, plane_vec)
+    - dot(plane_vec, plane_vec) * 0.5;
+
+  WordVecFloat factors[] = { 1.0, 0.5 };
+  for (size_t f = 0; f < 2; ++f)
+    {
+      for (int negative = 0; negative < 2; ++negative)
+        {
+          Neighbours top = get_top_n_transformed
+            (5, vecs, plane_vec, a.vector, translation_term, negative,
+             factors[f]);
+          std::vector<double> expected = transformed_distances
+            (5, vecs, plane_vec, a.vector, translation_term, negative,
+             factors[f]);
+          assert(top.size() == expected.size());
+          for (size_t i = 0; i < top.size(); ++i)
+            {
+              assert(vecs.find(top[i].first) < vecs.size());
+              assert(fabs(expected[i] - top[i].second) < 1e-4);
+            }
+        }
+    }
+}
+
+/* The transducers of \a script compiled into \a type, by name. */
+static std::map<std::string, HfstTransducer> compile_script
+(const std::string & script, ImplementationType type)
+{
+  std::map<std::string, HfstTransducer *> defs;
+  std::map<std::string, HfstTransducer *> compiled =
+    hfst::pmatch::compile(script, defs, type);
+  std::map<std::string, HfstTransducer> retval;
+  for (std::map<std::string, HfstTransducer *>::iterator it =
+         compiled.begin(); it != compiled.end(); ++it)
+    {
+      retval.insert(std::make_pair(it->first, *(it->second)));
+      delete it->second;
+    }
+  return retval;
+}
+
+static std::vector<HfstTransducer> archive
+(const std::map<std::string, HfstTransducer> & transducers)
+{
+  std::vector<HfstTransducer> retval;
+  for (std::map<std::string, HfstTransducer>::const_iterator it =
+         transducers.begin(); it != transducers.end(); ++it)
+    retval.push_back(it->second);
+  return retval;
+}
+
+static size_t state_count(const HfstTransducer & t)
+{
+  return hfst::implementations::HfstBasicTransducer(t).get_max_state() + 1;
+}
+
+/* Inserted definitions with different alphabets, which are harmonized
+   with each other, converted and minimized in several threads. pmatch
+   needs the initial input symbols of TOP, which are only implemented for
+   tropical OpenFst transducers. */
+static void test_harmonized_definitions()
+{
+  ImplementationType type = TROPICAL_OPENFST_TYPE;
+  std::string script =
+    "Define Greeting {hello} EndTag(greeting) ;\n"
+    "Define Animal [{cat} | {dog}] EndTag(animal) ;\n"
+    "Define Number [{1} | {2}]+ EndTag(number) ;\n"
+    "Define Any {x} ? EndTag(any) ;\n"
+    "regex Ins(Greeting) | Ins(Animal) | Ins(Number) | Ins(Any) ;\n";
+  std::map<std::string, HfstTransducer> compiled =
+    compile_script(script, type);
+
+  const char * names[] = { "Animal", "Any", "Greeting", "Number", "TOP" };
+  assert(compiled.size() == 5);
+  for (size_t i = 0; i < 5; ++i)
+    {
+      std::map<std::string, HfstTransducer>::iterator it =
+        compiled.find(names[i]);
+      assert(it != compiled.end());
+      assert(it->second.get_type() == type);
+      assert(it->second.get_name() == names[i]);
+      /* Already minimal */
+      HfstTransducer minimized(it->second);
+      minimized.minimize();
+      assert(state_count(minimized) == state_count(it->second));
+      StringSet alphabet = it->second.get_alphabet();
+      assert(alphabet == compiled.find("TOP")->second.get_alphabet());
+      assert(alphabet.count("h") == 1);
+      assert(alphabet.count("c") == 1);
+      assert(alphabet.count("1") == 1);
+      assert(alphabet.count("x") == 1);
+    }
+
+  hfst_ol::PmatchContainer container(archive(compiled));
+  assert(container.match("hello cat 12 xh dog 3 xq") ==
+         "<greeting>hello</greeting> <animal>cat</animal> "
+         "<number>12</number> <any>xh</any> <animal>dog</animal> 3 "
+         "<any>xq</any>");
+
+  /* The same with any number of threads */
+  const size_t thread_counts[] = { 0, 1, 4 };
+  for (size_t i = 0; i < 3; ++i)
+    {
+      PmatchCompiler compiler(type);
+      compiler.set_thread_count(thread_counts[i]);
+      std::map<std::string, HfstTransducer *> threaded =
+        compiler.compile(script);
+      assert(threaded.size() == compiled.size());
+      for (std::map<std::string, HfstTransducer *>::iterator it =
+             threaded.begin(); it != threaded.end(); ++it)
+        {
+          assert(it->second->compare(compiled.find(it->first)->second));
+          delete it->second;
+        }
+    }
+}
+
+static std::string locations_to_string
+(const hfst_ol::LocationVectorVector & locations)
+{
+  std::ostringstream retval;
+  for (size_t i = 0; i < locations.size(); ++i)
+    for (size_t j = 0; j < locations[i].size(); ++j)
+      {
+        const hfst_ol::Location & l = locations[i][j];
+        retval << l.start << "|" << l.length << "|" << l.input << "|"
+               << l.output << "|" << l.tag << "\n";
+      }
+  return retval.str();
+}
+
+/* Feed \a text to match_stream or locate_stream in pieces of random
+   lengths and collect what comes out. */
+static std::string match_in_pieces(hfst_ol::PmatchContainer & container,
+                                   const std::string & text, bool locate,
+                                   std::mt19937 & random)
+{
+  std::string retval;
+  size_t pos = 0;
+  bool end = false;
+  while (!end)
+    {
+      size_t length = random() % 7;
+      end = pos + length >= text.size();
+      std::string piece = text.substr(pos, end ? std::string::npos : length);
+      pos += length;
+      if (locate)
+        retval += locations_to_string(container.locate_stream(piece, end));
+      else
+        retval += container.match_stream(piece, end);
+    }
+  return retval;
+}
+
+/* Streamed input gives the same results as the whole input, however it
+   is split, including contexts, multicharacter symbols and matches
+   longer than the context window. */
+static void test_streamed_matching()
+{
+  std::string script =
+    "Define A [{cat} | {cats} | {dog}] EndTag(animal) RC(\" \") ;\n"
+    "Define B [\"a\"+] EndTag(as) ;\n"
+    "Define C LC(\"x\") {yz} EndTag(yz) ;\n"
+    "Define D {q} ? ? ? ? ? ? ? ? ? ? {q} EndTag(long) ;\n"
+    "regex A | B | C | D ;\n";
+  hfst_ol::PmatchContainer container(
+    archive(compile_script(script, TROPICAL_OPENFST_TYPE)));
+  container.set_max_context(3);
+
+  std::mt19937 random(1);
+  const char * pieces[] = { "cat", "cats", "dog", " ", "a", "x", "yz", "q",
+                            "\xc3\xa9", "z" };
+  for (size_t i = 0; i < 300; ++i)
+    {
+      std::string text;
+      size_t length = random() % (i % 50 == 0 ? 2000 : 30);
+      for (size_t j = 0; j < length; ++j)
+        text += pieces[random() % 10];
+      assert(match_in_pieces(container, text, false, random) ==
+             container.match(text));
+      assert(match_in_pieces(container, text, true, random) ==
+             locations_to_string(container.locate(text)));
+    }
+
+  /* Results come out before the input ends */
+  std::string streamed;
+  for (size_t i = 0; i < 20; ++i)
+    streamed += container.match_stream("cats dog ", false);
+  assert(streamed.size() > 0);
+  streamed += container.match_stream("", true);
+  std::string whole;
+  for (size_t i = 0; i < 20; ++i)
+    whole += "cats dog ";
+  assert(streamed == container.match(whole));
+}
+
+static hfst_ol::SymbolNumber symbol_number
+(hfst_ol::PmatchContainer & container, const std::string & symbol)
+{
+  hfst_ol::SymbolNumberVector symbols =
+    container.symbol_vector_from_symbols(symbol);
+  assert(symbols.size() == 1);
+  return symbols[0];
+}
+
+/* The symbols that no match can start with are passed over without
+   trying to match, with or without inserted definitions. */
+static void test_first_symbols(bool insert)
+{
+  std::string script = insert ?
+    "Define Animal [{cat} | {dog}] EndTag(animal) ;\n"
+    "regex Ins(Animal) | [{ant} EndTag(insect)] ;\n" :
+    "regex [{cat} | {dog}] EndTag(animal) | [{ant} EndTag(insect)] ;\n";
+  std::map<std::string, HfstTransducer> compiled =
+    compile_script(script, TROPICAL_OPENFST_TYPE);
+  std::map<std::string, HfstTransducer>::iterator top = compiled.find("TOP");
+  assert(top != compiled.end());
+  assert(top->second.get_name() == "TOP");
+  std::map<std::string, std::string> properties = top->second.get_properties();
+  assert(properties.count("initial-symbols") == 1);
+
+  hfst_ol::PmatchContainer container(archive(compiled));
+  assert(!container.not_possible_first_symbol(symbol_number(container, "c")));
+  assert(!container.not_possible_first_symbol(symbol_number(container, "d")));
+  assert(!container.not_possible_first_symbol(symbol_number(container, "a")));
+  assert(container.not_possible_first_symbol(symbol_number(container, "t")));
+  assert(container.not_possible_first_symbol(symbol_number(container, "x")));
+
+  /* The same without the list of initial symbols */
+  top->second.set_property("initial-symbols", "");
+  hfst_ol::PmatchContainer unskipped(archive(compiled));
+  assert(!unskipped.not_possible_first_symbol(symbol_number(unskipped, "x")));
+
+  std::string expected;
+  std::string text;
+  for (size_t i = 0; i < 50; ++i)
+    {
+      std::string filler(i * 7, 'x');
+      filler += " ";
+      text += filler + "cat " + filler + "tac ant ";
+      expected += filler + "<animal>cat</animal> " + filler
+        + "tac <insect>ant</insect> ";
+    }
+  assert(container.match(text) == expected);
+  assert(unskipped.match(text) == expected);
+  assert(locations_to_string(container.locate(text)) ==
+         locations_to_string(unskipped.locate(text)));
+
+  std::mt19937 random(2);
+  const char * pieces[] = { "cat", "dog", "ant", " ", "x", "t", "a", "c" };
+  for (size_t i = 0; i < 200; ++i)
+    {
+      std::string random_text;
+      for (size_t j = random() % 40; j > 0; --j)
+        random_text += pieces[random() % 8];
+      assert(container.match(random_text) == unskipped.match(random_text));
+      assert(locations_to_string(container.locate(random_text)) ==
+             locations_to_string(unskipped.locate(random_text)));
+      assert(match_in_pieces(container, random_text, false, random) ==
+             unskipped.match(random_text));
+    }
+}
+
+/* Copies of a container share its transducers but match on their own,
+   also in other threads and after the original is gone. */
+static void test_copied_container()
+{
+  std::string script =
+    "Define Animal [{cat} | {dog}] EndTag(animal) ;\n"
+    "Define Accented {\xc3\xa9t\xc3\xa9} EndTag(summer) ;\n"
+    "regex Ins(Animal) | Ins(Accented) | [{ant} EndTag(insect)] ;\n";
+  hfst_ol::PmatchContainer * original = new hfst_ol::PmatchContainer(
+    archive(compile_script(script, TROPICAL_OPENFST_TYPE)));
+
+  std::mt19937 random(3);
+  const char * pieces[] = { "cat", "dog", "ant", " ", "\xc3\xa9t\xc3\xa9",
+                            "\xc3\xb6", "\xe2\x82\xac", "x" };
+  std::vector<std::string> texts;
+  for (size_t i = 0; i < 100; ++i)
+    {
+      std::string text;
+      for (size_t j = random() % 40; j > 0; --j)
+        text += pieces[random() % 8];
+      texts.push_back(text);
+    }
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < texts.size(); ++i)
+    expected.push_back(original->match(texts[i]));
+
+  /* The original has added the unknown symbols to its alphabet */
+  hfst_ol::PmatchContainer * copies[] = {
+    new hfst_ol::PmatchContainer(*original),
+    new hfst_ol::PmatchContainer(*original) };
+  delete original;
+  std::vector<std::string> results[2];
+  std::thread other([&]() {
+      for (size_t i = 0; i < texts.size(); ++i)
+        results[1].push_back(copies[1]->match(texts[i]));
+    });
+  for (size_t i = 0; i < texts.size(); ++i)
+    results[0].push_back(copies[0]->match(texts[i]));
+  other.join();
+  assert(results[0] == expected);
+  assert(results[1] == expected);
+  delete copies[0];
+  delete copies[1];
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("WordVectorMatrix");
+  test_word_vector_matrix();
+
+  verbose_print("get_top_n");
+  test_exact_top_n();
+
+  verbose_print("get_top_n with a vector index");
+  test_approximate_top_n();
+
+  verbose_print("vector index files");
+  test_index_file();
+
+  verbose_print("get_top_n_transformed");
+  test_transformed_top_n();
+
+  verbose_print("harmonizing inserted definitions", TROPICAL_OPENFST_TYPE);
+  test_harmonized_definitions();
+
+  verbose_print("streamed pmatch input", TROPICAL_OPENFST_TYPE);
+  test_streamed_matching();
+
+  verbose_print("skipping impossible first symbols", TROPICAL_OPENFST_TYPE);
+  test_first_symbols(false);
+  test_first_symbols(true);
+
+  verbose_print("copied pmatch containers", TROPICAL_OPENFST_TYPE);
+  test_copied_container();
+}
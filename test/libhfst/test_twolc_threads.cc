@@ -0,0 +1,118 @@
+/*
+   Test file for compiling twolc rules in several threads.
+*/
+
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstOutputStream.h"
+#include "parsers/rule_src/TwolCGrammar.h"
+#include "parsers/alphabet_src/Alphabet.h"
+#include "auxiliary_functions.cc"
+
+#include <cstdio>
+#include <vector>
+
+using namespace hfst;
+
+#ifdef HAVE_XFSM
+  #define Alphabet TwolCAlphabet
+#endif
+
+/* A context LEFT _ RIGHT in the form the twolc parser gives it. */
+static OtherSymbolTransducer get_context(const SymbolPair &left,
+                                         const SymbolPair &right)
+{
+  OtherSymbolTransducer unknown(TWOLC_UNKNOWN,TWOLC_UNKNOWN);
+  unknown.apply(&HfstTransducer::repeat_star);
+  OtherSymbolTransducer diamond(TWOLC_DIAMOND);
+  OtherSymbolTransducer context(unknown);
+  context.
+    apply(&HfstTransducer::concatenate,
+          OtherSymbolTransducer(left.first,left.second)).
+    apply(&HfstTransducer::concatenate,diamond).
+    apply(&HfstTransducer::concatenate,unknown).
+    apply(&HfstTransducer::concatenate,diamond).
+    apply(&HfstTransducer::concatenate,
+          OtherSymbolTransducer(right.first,right.second)).
+    apply(&HfstTransducer::concatenate,unknown);
+  return context;
+}
+
+/* Compile a grammar using at most \a threads threads into \a filename. */
+static void compile_grammar(size_t threads, const std::string &filename)
+{
+  RuleContainer::set_thread_count(threads);
+
+  Alphabet alphabet;
+  alphabet.define_alphabet_pair
+    (SymbolPair("__HFST_TWOLC_.#.","__HFST_TWOLC_.#."));
+  alphabet.define_alphabet_pair(SymbolPair("a","a"));
+  alphabet.define_alphabet_pair(SymbolPair("a","b"));
+  alphabet.define_alphabet_pair(SymbolPair("a","c"));
+  alphabet.define_alphabet_pair(SymbolPair("b","b"));
+  alphabet.define_alphabet_pair(SymbolPair("c","c"));
+  alphabet.define_alphabet_pair(SymbolPair("d","d"));
+  alphabet.alphabet_done();
+
+  TwolCGrammar grammar(true,false,true,true);
+
+  // The rules share copies of the same contexts.
+  OtherSymbolTransducerVector b_context
+    (1,get_context(SymbolPair("b","b"),SymbolPair("d","d")));
+  OtherSymbolTransducerVector c_context
+    (1,get_context(SymbolPair("c","c"),SymbolPair("c","c")));
+  OtherSymbolTransducerVector both_contexts(b_context);
+  both_contexts.push_back(c_context.front());
+
+  grammar.add_rule("\"a:b\"",SymbolPair("a","b"),op::LEFT_RIGHT,b_context);
+  grammar.add_rule("\"a:c\"",SymbolPair("a","c"),op::LEFT_RIGHT,c_context);
+  grammar.add_rule("\"a:a right\"",SymbolPair("a","a"),op::RIGHT,
+                   both_contexts);
+  grammar.add_rule("\"not d\"",SymbolPair("d","d"),op::NOT_LEFT,c_context);
+  grammar.add_rule("\"a:a left\"",SymbolPair("a","a"),op::LEFT,b_context);
+
+  HfstOutputStream out(filename,OtherSymbolTransducer::get_transducer_type());
+  grammar.compile_and_store(out);
+  out.close();
+}
+
+static std::vector<HfstTransducer> read_rules(const std::string &filename)
+{
+  std::vector<HfstTransducer> rules;
+  HfstInputStream in(filename);
+  while (! in.is_eof())
+    { rules.push_back(HfstTransducer(in)); }
+  in.close();
+  return rules;
+}
+
+/* Rules compiled in several threads are those compiled in one thread. */
+static void test_twolc_threads(ImplementationType type)
+{
+  OtherSymbolTransducer::set_transducer_type(type);
+
+  compile_grammar(1,"test_twolc_threads_1.hfst");
+  compile_grammar(4,"test_twolc_threads_4.hfst");
+  RuleContainer::set_thread_count(0);
+
+  std::vector<HfstTransducer> serial = read_rules("test_twolc_threads_1.hfst");
+  std::vector<HfstTransducer> parallel =
+    read_rules("test_twolc_threads_4.hfst");
+  assert(serial.size() == 5);
+  assert(parallel.size() == serial.size());
+  for (size_t i = 0; i < serial.size(); ++i)
+    {
+      assert(parallel[i].get_name() == serial[i].get_name());
+      assert(parallel[i].compare(serial[i]));
+    }
+
+  remove("test_twolc_threads_1.hfst");
+  remove("test_twolc_threads_4.hfst");
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("twolc rules compiled in one and in four threads",
+                TROPICAL_OPENFST_TYPE);
+  test_twolc_threads(TROPICAL_OPENFST_TYPE);
+}
@@ -0,0 +1,142 @@
+/*
+   Test file for XfstCompiler.
+*/
+
+#include "HfstTransducer.h"
+#include "HfstOutputStream.h"
+#include "parsers/XfstCompiler.h"
+#include "auxiliary_functions.cc"
+
+#include <cstdio>
+#include <sstream>
+
+using namespace hfst;
+using hfst::xfst::XfstCompiler;
+using hfst::implementations::HfstBasicTransducer;
+
+/* A transducer mapping each input in \a pairs to its output. */
+static void write_transducer
+(const char * filename, const std::vector<std::pair<std::string,
+ std::string> > & pairs)
+{
+  HfstBasicTransducer fsm;
+  for (size_t i = 0; i < pairs.size(); ++i)
+    {
+      StringPairVector spv;
+      const std::string & input = pairs[i].first;
+      const std::string & output = pairs[i].second;
+      for (size_t j = 0; j < std::max(input.size(), output.size()); ++j)
+        spv.push_back(StringPair
+                      (j < input.size() ? input.substr(j, 1) : "@_EPSILON_SYMBOL_@",
+                       j < output.size() ? output.substr(j, 1) : "@_EPSILON_SYMBOL_@"));
+      fsm.disjunct(spv, 0);
+    }
+  HfstTransducer t(fsm, TROPICAL_OPENFST_TYPE);
+  t.minimize();
+  HfstOutputStream out(filename, TROPICAL_OPENFST_TYPE);
+  out << t;
+  out.close();
+}
+
+/* What the compiler wrote since the last call. */
+static std::string take(std::ostringstream & out)
+{
+  std::string retval = out.str();
+  out.str("");
+  return retval;
+}
+
+/* apply up and apply down reuse the lookup views of the top network
+   until the stack changes, including commands that change the top
+   network in place. */
+static void test_apply()
+{
+  std::vector<std::pair<std::string, std::string> > spanish;
+  spanish.push_back(std::make_pair("cat", "gato"));
+  spanish.push_back(std::make_pair("dog", "perro"));
+  write_transducer("test_xfst_compiler_es.hfst", spanish);
+  std::vector<std::pair<std::string, std::string> > french;
+  french.push_back(std::make_pair("cat", "chat"));
+  write_transducer("test_xfst_compiler_fr.hfst", french);
+
+  std::ostringstream out;
+  XfstCompiler compiler(TROPICAL_OPENFST_TYPE);
+  compiler.setVerbosity(false);
+  compiler.setPromptVerbosity(false);
+  compiler.set_output_stream(out);
+
+  compiler.load_stack("test_xfst_compiler_es.hfst");
+  take(out);
+  compiler.apply_down("cat\ndog\nbird");
+  assert(take(out) == "gato\nperro\n???\n");
+  compiler.apply_up("perro\ngato");
+  assert(take(out) == "dog\ncat\n");
+  /* Again from the views kept from the previous calls */
+  compiler.apply_down("dog");
+  assert(take(out) == "perro\n");
+  compiler.apply_up("gato");
+  assert(take(out) == "cat\n");
+
+  /* Changing the top network */
+  compiler.invert_net();
+  take(out);
+  compiler.apply_down("gato");
+  assert(take(out) == "cat\n");
+  compiler.apply_up("cat");
+  assert(take(out) == "gato\n");
+
+  /* Pushing and popping */
+  compiler.load_stack("test_xfst_compiler_fr.hfst");
+  take(out);
+  compiler.apply_down("cat");
+  assert(take(out) == "chat\n");
+  compiler.apply_up("chat");
+  assert(take(out) == "cat\n");
+  compiler.turn();
+  take(out);
+  compiler.apply_down("gato");
+  assert(take(out) == "cat\n");
+  compiler.turn();
+  take(out);
+  compiler.apply_down("cat");
+  assert(take(out) == "chat\n");
+  compiler.pop();
+  take(out);
+  compiler.apply_down("gato");
+  assert(take(out) == "cat\n");
+
+  /* From a file */
+  FILE * infile = tmpfile();
+  assert(infile != NULL);
+  fputs("cat\ndog\n", infile);
+  rewind(infile);
+  compiler.apply_up(infile);
+  assert(take(out) == "gato\nperro\n");
+  fclose(infile);
+
+  /* Optimized-lookup networks are looked up directly, apply up looks
+     down */
+  compiler.lookup_optimize();
+  take(out);
+  compiler.apply_down("perro");
+  assert(take(out) == "dog\n");
+  compiler.apply_up("dog\nbird");
+  assert(take(out) == "perro\n???\n");
+  infile = tmpfile();
+  assert(infile != NULL);
+  fputs("cat\n", infile);
+  rewind(infile);
+  compiler.apply_up(infile);
+  assert(take(out) == "gato\n");
+  fclose(infile);
+
+  remove("test_xfst_compiler_es.hfst");
+  remove("test_xfst_compiler_fr.hfst");
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("XfstCompiler apply up and apply down",
+                TROPICAL_OPENFST_TYPE);
+  test_apply();
+}
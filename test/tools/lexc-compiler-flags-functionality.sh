@@ -8,7 +8,21 @@ if [ "$1" = "--python" ]; then
 fi
 
 TOOLDIR=../../tools/src
+TOOL=$TOOLDIR/hfst-lexc
+XFST_TOOL=$TOOLDIR/parsers/hfst-xfst
 COMPARE_TOOL=$TOOLDIR/hfst-compare
+for tool in $TOOL $XFST_TOOL $COMPARE_TOOL;
+do
+    if ! test -x $tool ; then
+        echo "missing $tool, assuming configured off, skipping"
+        exit 77
+    fi
+done
+
+if test "$srcdir" = ""; then
+    srcdir="./"
+fi
+
 LEXCTESTS="basic.cat-dog-bird.lexc basic.colons.lexc basic.comments.lexc 
           basic.empty-sides.lexc basic.escapes.lexc 
           basic.infostrings.lexc basic.initial-lexicon-empty.lexc 
@@ -28,49 +42,39 @@ LEXCTESTS="basic.cat-dog-bird.lexc basic.colons.lexc basic.comments.lexc
           xre.any-variations.lexc"
           
           # basic.end.lexc  -hfst doesn't parse till end
-          # xre.any-variations.lexc -foma ?:? problem
-          # basic.multichar-symbol-with-0.lexc  - hfst works fine, foma wrong
-          # basic.multichar-flag-with-zero.lexc - foma wrong
           
           
 
- # create foma result     
- #       echo "read lexc $srcdir/$f \n
- #       save stack test.foma.gz \n
- #       quit \n" > tmp-foma-script
- #       foma -q < tmp-foma-script
- #   gunzip test.foma.gz
- #   mv test.foma $RESULT
- #   rm tmp-foma-script
- 
- 
+  # Compiling with flags and eliminating them must give the same
+  # transducer as compiling without flags.
   for f in $LEXCTESTS ; do
-  
-    ORIGINAL="$f.result"
-    FLAGGED="$f.flag.result"
-  
-           
-       hfst-fst2fst -b -f foma $FLAGGED -o $FLAGGED.foma
-       
-       echo "load $FLAGGED.foma \n
-       eliminate flags \n
-       save stack $FLAGGED.noflags.foma.gz \n
-       quit \n" > tmp-foma-script
-        foma -q < tmp-foma-script
-        gunzip $FLAGGED.noflags.foma.gz
-        
-        hfst-fst2fst $FFLAG $FLAGGED.noflags.foma -o $FLAGGED.noflags.foma.tmp
-        hfst-fst2fst $FFLAG $ORIGINAL -o $ORIGINAL.tmp
-        
-     echo "comparing eliminated file: $f"
-     if ! $COMPARE_TOOL -e -s $ORIGINAL.tmp $FLAGGED.noflags.foma.tmp ; then
-         echo "results differ: $f"
-         exit 1
-     fi
-     
-     rm $FLAGGED.foma tmp-foma-script $FLAGGED.noflags.foma $FLAGGED.noflags.foma.tmp $ORIGINAL.tmp
-     
+
+    ORIGINAL="test.result"
+    FLAGGED="test.flag.result"
+
+    if ! $TOOL $srcdir/$f -o $ORIGINAL 2> /dev/null; then
+        echo "hfst-lexc $f failed with $?"
+        exit 1
+    fi
+    if ! $TOOL -F $srcdir/$f -o $FLAGGED 2> /dev/null; then
+        echo "hfst-lexc -F $f failed with $?"
+        exit 1
+    fi
+
+    echo "load stack $FLAGGED
+eliminate flags
+save stack $FLAGGED.noflags
+quit" > tmp-xfst-script
+    if ! $XFST_TOOL -s -F tmp-xfst-script > /dev/null 2>&1; then
+        echo "eliminating flags failed: $f"
+        exit 1
+    fi
+
+    if ! $COMPARE_TOOL -q -e -s $ORIGINAL $FLAGGED.noflags ; then
+        echo "results differ: $f"
+        exit 1
+    fi
+
+    rm $ORIGINAL $FLAGGED $FLAGGED.noflags tmp-xfst-script
+
  done
- 
- #   mv test.foma $RESULT
- #   rm tmp-foma-script
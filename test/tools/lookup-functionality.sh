@@ -113,6 +113,95 @@ if ((test -z "$i") || $FORMAT_TOOL --list-formats | grep $i > /dev/null); then
 fi
 done
 
+# memory-mapped lookup-optimized transducers must look up like loaded ones
+if [ "$1" != '--python' ]; then
+    for f in cat2dog.hfstol cat_weight_ambig.hfstol; do
+	if ! $TOOL $f < $srcdir/cat.strings > test.lookups ; then
+	    exit 1
+	fi
+	if ! $TOOL --memory-map $f < $srcdir/cat.strings > test.mapped ; then
+	    exit 1
+	fi
+	if ! cmp -s test.lookups test.mapped ; then
+	    echo "FAIL: lookup in memory-mapped $f differs"
+	    exit 1
+	fi
+    done
+    rm test.mapped
+
+    # threaded lookup must print the same results in the same order,
+    # also over several blocks of input lines
+    awk 'BEGIN { for (i = 0; i < 5000; i++)
+                   print (i % 3 == 0) ? "cat" : ((i % 3 == 1) ? "ca" : "dog") }' \
+        > test.strings
+    for f in cat2dog.hfstol cat_weight_ambig.hfstol; do
+	if ! $TOOL $f < test.strings > test.lookups ; then
+	    exit 1
+	fi
+	if ! $TOOL -j 3 $f < test.strings > test.threaded ; then
+	    exit 1
+	fi
+	if ! cmp -s test.lookups test.threaded ; then
+	    echo "FAIL: threaded lookup in $f differs"
+	    exit 1
+	fi
+    done
+    rm test.strings test.threaded
+
+    # threaded lookup is only for plain lookup of one optimized-lookup
+    # transducer, anything else is an error instead of a serial lookup
+    if echo "cat" | $TOOL -s -j 3 cat.hfst > /dev/null 2>&1 ; then
+	echo "FAIL: threaded lookup in a transducer that is not optimized-lookup"
+	exit 1
+    fi
+    if echo "cat" | $TOOL -s -j 3 -X print-pairs cat2dog.hfstol \
+	> /dev/null 2>&1 ; then
+	echo "FAIL: threaded lookup with print-pairs"
+	exit 1
+    fi
+
+    # looking up in the composition of a cascade must give what looking up
+    # in the composed transducer gives, and find its epsilon cycles
+    COMPOSE_TOOL=$TOOLDIR/hfst-compose
+    FST2FST_TOOL=$TOOLDIR/hfst-fst2fst
+    if test -x $COMPOSE_TOOL -a -x $FST2FST_TOOL ; then
+	cat cascade_first.hfstol cascade_second.hfstol > test.cascade
+	if ! $COMPOSE_TOOL cascade_first.hfst cascade_second.hfst \
+	    | $FST2FST_TOOL -w -o test.composed ; then
+	    exit 1
+	fi
+	if ! $TOOL --cascade=composition test.cascade \
+	    < $srcdir/cascade.strings > test.lookups ; then
+	    exit 1
+	fi
+	if ! $TOOL test.composed < $srcdir/cascade.strings > test.composed_lookups ; then
+	    exit 1
+	fi
+	if ! cmp -s test.lookups test.composed_lookups ; then
+	    echo "FAIL: lookup in the composition of a cascade differs"
+	    exit 1
+	fi
+	cat cascade_first.hfstol cascade_cyclic.hfstol > test.cascade
+	if ! echo "a" | $TOOL --cascade=composition test.cascade \
+	    > test.lookups ; then
+	    exit 1
+	fi
+	if ! grep -q "cyclic" test.lookups ; then
+	    echo "FAIL: lookup of 'a' in a cyclic cascade should be infinite"
+	    exit 1
+	fi
+	if ! echo "d" | $TOOL --cascade=composition test.cascade \
+	    > test.lookups ; then
+	    exit 1
+	fi
+	if grep -q "cyclic" test.lookups ; then
+	    echo "FAIL: lookup of 'd' in a cyclic cascade should be finite"
+	    exit 1
+	fi
+	rm test.cascade test.composed test.composed_lookups
+    fi
+fi
+
 rm TMP
 rm test.lookups
 rm warnings
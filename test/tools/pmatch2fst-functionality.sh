@@ -28,6 +28,19 @@ fi
 if ! $PMATCH --newline test.pmatch < $srcdir/cat.strings > pmatch.out ; then
     exit 1
 fi
+# The inserted definitions are harmonized the same in any number of threads
+if [ "$1" != '--python' ] ; then
+    for threads in 1 3 ; do
+        if ! $PMATCH2FST -T $threads $srcdir/pmatch_blanks.txt > test-threads.pmatch ; then
+            exit 1
+        fi
+        if ! cmp -s test.pmatch test-threads.pmatch ; then
+            echo pmatch2fst -T $threads differs
+            exit 1
+        fi
+    done
+    rm -f test-threads.pmatch
+fi
 
 echo 'set need-separators off regex [\Whitespace]+ EndTag(Q);' | $PMATCH2FST > test.pmatch
 
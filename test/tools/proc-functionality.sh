@@ -124,6 +124,28 @@ if ! diff test.strings $srcdir/cat_weight_ambig_W1_xerox.strings ; then
     exit 1
 fi
 
+# among duplicate analyses the lightest is kept
+if ! echo "cat" | $TOOL -W proc-duplicates.hfstol | tr -d '\r' > test.strings ; then
+    echo duplicates fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-duplicates-out.strings ; then
+    echo duplicates diffs
+    exit 1
+fi
+
+# paths whose flag diacritics fail are dropped
+if ! echo "cat" | $TOOL proc-flags.hfstol | tr -d '\r' > test.strings ; then
+    echo flags fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-flags-out.strings ; then
+    echo flags diffs
+    exit 1
+fi
+
 # weight-classes checks
 if ! $TOOL --weight-classes 1 cat_weight_ambig.hfstol < $srcdir/cat.strings | tr -d '\r' > test.strings ; then
     echo cat_weight_ambig fail:
@@ -204,6 +226,82 @@ fi
 rm test.strings
 
 
+# the same in three threads; -T only parallelises analysis, generation
+# falls back to serial
+if ! echo "cat" | $TOOL -T 3 cat2dog.hfstol | tr -d '\r' > test.strings ; then
+    echo threaded cat fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-cat-out.strings ; then
+    echo threaded cat diffs
+    exit 1
+fi
+if ! $TOOL -T 3 proc-caps.hfstol < $srcdir/proc-caps-in.strings | tr -d '\r' > test.strings ; then
+    echo threaded uppercase fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-caps-out1.strings ; then
+    echo threaded uppercase diffs
+    exit 1
+fi
+if ! $TOOL -T 3 --cg --raw proc-caps.hfstol < $srcdir/proc-caps-in.strings | tr -d '\r' > test.strings ; then
+    echo threaded raw cg fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-caps-out5.strings ; then
+    echo threaded raw cg diffs
+    exit 1
+fi
+if ! $TOOL -T 3 compounds.hfstol < $srcdir/proc-compounds.strings | tr -d '\r' > test.strings ; then
+    echo threaded compound fail
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-compounds-out.strings ; then
+    echo threaded compound diffs
+    exit 1
+fi
+if ! $TOOL -T 3 escaping.hfstol < $srcdir/proc-escaping.strings | tr -d '\r' > test.strings ; then
+    echo threaded escaping fail
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-escaping-out.strings ; then
+    echo threaded escaping diffs
+    exit 1
+fi
+if ! echo "^dog$" | $TOOL -q -T 3 -g cat2dog.genhfstol | tr -d '\r' > test.strings ; then
+    echo threaded dog fail
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/cat.strings ; then
+    echo threaded dog diffs
+    exit 1
+fi
+if ! $TOOL -q -T 3 -g proc-caps.genhfstol < $srcdir/proc-caps-gen.strings | tr -d '\r' > test.strings ; then
+    echo threaded uppercase roundtrip fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-caps-out2.strings  ; then
+    echo threaded uppercase roundtrip diffs
+    exit 1
+fi
+if ! printf 'cat.[][\n]\0cat.[][\n]\0' | $TOOL -T 3 -z cat2dog.hfstol | tr -d '\r' > test.strings ; then
+    echo threaded NUL flush fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/proc-cat-NUL.strings ; then
+    echo threaded NUL flush diffs
+    exit 1
+fi
+rm test.strings
+
 ## skip new test introduced in version 3014...
 exit 0
 
@@ -80,5 +80,74 @@ if ! diff test.strings $srcdir/tokenize-dog-out-giella-cg-superblank.strings ; t
     exit 1
 fi
 
+# the same in three threads
+if ! echo "test dog be dog catdog" | $TOOLDIR/hfst-tokenize -T 3 $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out.strings
+    exit 1
+fi
+if ! echo "test dog be dog catdog" | $TOOLDIR/hfst-tokenize -T 3 -z $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 -z fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out.strings
+    exit 1
+fi
+if ! echo "test dog be dog catdog" | $TOOLDIR/hfst-tokenize -T 3 --cg $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 --cg fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out-cg.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out-cg.strings
+    exit 1
+fi
+if ! echo "test dog be dog catdog собака" | $TOOLDIR/hfst-tokenize -T 3 --giella-cg $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 --giella-cg fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out-giella-cg.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out-giella-cg.strings
+    exit 1
+fi
+if ! echo "test dog be dog catdog" | $TOOLDIR/hfst-tokenize -T 3 --xerox $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 --xerox fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out-xerox.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out-xerox.strings
+    exit 1
+fi
+if ! printf 'dog[\\\n<\\\\>]cat !and \ndogs[][\n]' | $TOOLDIR/hfst-tokenize -T 3 --giella-cg --superblanks $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 --giella-cg --superblanks superblank fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings $srcdir/tokenize-dog-out-giella-cg-superblank.strings ; then
+    echo diff test.strings $srcdir/tokenize-dog-out-giella-cg-superblank.strings
+    exit 1
+fi
+
+# NUL-separated parts in three threads, each followed by a flush
+cat $srcdir/tokenize-dog-out-giella-cg-flushing.strings $srcdir/tokenize-dog-out-giella-cg-flushing.strings $srcdir/tokenize-dog-out-giella-cg-flushing.strings > test-nul.strings
+if ! printf 'dog[\\\n<\\\\>]cat !and \ndogs[][\n]\0dog[\\\n<\\\\>]cat !and \ndogs[][\n]\0dog[\\\n<\\\\>]cat !and \ndogs[][\n]\0' | $TOOLDIR/hfst-tokenize -T 3 --giella-cg --superblanks $srcdir/tokenize-dog.pmhfst > test.strings ; then
+    echo tokenize -T 3 --giella-cg NUL fail:
+    cat test.strings
+    exit 1
+fi
+if ! diff test.strings test-nul.strings ; then
+    echo diff test.strings test-nul.strings
+    exit 1
+fi
+rm test-nul.strings
+
 rm test.strings tokenize-dog.pmhfst tokenize-dog.hfst tokenize-dog-gen.hfst
 exit 0
@@ -108,6 +108,9 @@ static bool force_ol = false; // accept also ol transducers when -R is not speci
 // symbols actually seen in (non-ol) transducers
 static std::vector<std::set<std::string> > cascade_symbols_seen;
 static std::vector<bool> cascade_unknown_or_identity_seen;
+// input epsilon cycles of the same transducers, for infinite ambiguity
+static std::vector<hfst::implementations::HfstEpsilonCycleIndex*>
+  cascade_epsilon_cycles;
 
 enum lookup_input_format
 {
@@ -1323,7 +1326,8 @@ lookup_simple(const HfstOneLevelPath& s, HfstBasicTransducer& t, bool* infinity)
     (s, cascade_symbols_seen[transducer_number],
      cascade_unknown_or_identity_seen[transducer_number]);
 
-  if (possible && t.is_lookup_infinitely_ambiguous(s))
+  if (possible && cascade_epsilon_cycles[transducer_number]->
+        is_lookup_infinitely_ambiguous(s.second))
     {
       if (!silent && infinite_cutoff > 0) {
     warning(0, 0, "Got infinite results, number of cycles limited to " SIZE_T_SPECIFIER "",
@@ -1621,6 +1625,12 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
 
     inputstream.close();
 
+    for (size_t i = 0; i < cascade_mut.size(); i++)
+      {
+        cascade_epsilon_cycles.push_back
+          (new hfst::implementations::HfstEpsilonCycleIndex(cascade_mut[i]));
+      }
+
     if (print_pairs &&
         (inputstream.get_type() == HFST_OL_TYPE ||
          inputstream.get_type() == HFST_OLW_TYPE) ) {
@@ -1753,6 +1763,11 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
         fprintf(stderr, "%ld/%ld... Done\n", filepos, filesize);
       }
     free(line);
+    for (size_t i = 0; i < cascade_epsilon_cycles.size(); i++)
+      {
+        delete cascade_epsilon_cycles[i];
+      }
+    cascade_epsilon_cycles.clear();
     if (print_statistics)
       {
         fprintf(outstream, "Strings\tFound\tMissing\tResults\n"
@@ -86,7 +86,9 @@ print_usage()
     "  -l, --openfst-log                 Write output in (HFST's) log weight (OpenFST) implementation\n"
     "  -O, --optimized-lookup-unweighted Write output in the HFST optimized-lookup implementation\n"
     "  -w, --optimized-lookup-weighted   Write output in optimized-lookup (weighted) implementation\n"
-    "  -Q  --quick                       When converting to optimized-lookup, don't try hard to compress\n");
+    "  -Q  --quick                       When converting to optimized-lookup, don't try hard to compress\n"
+    "  -C  --compact                     When converting to optimized-lookup, try harder to compress\n"
+    "  -L  --lookdown                    When converting to optimized-lookup, also index the output side for apply up\n");
     fprintf(message_out, "\n");
     print_common_unary_program_parameter_instructions(message_out);
         fprintf(message_out,
@@ -122,12 +124,14 @@ parse_options(int argc, char** argv)
           {"optimized-lookup-unweighted",   no_argument, 0, 'O'},
           {"optimized-lookup-weighted",no_argument, 0, 'w'},
       {"quick",              no_argument, 0, 'Q'},
+      {"compact",            no_argument, 0, 'C'},
+      {"lookdown",           no_argument, 0, 'L'},
           {0,0,0,0}
         };
         int option_index = 0;
         // add tool-specific options here
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "SFtlOwQf:bx",
+                             HFST_GETOPT_UNARY_SHORT "SFtlOwQCLf:bx",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -178,7 +182,13 @@ parse_options(int argc, char** argv)
           set_output_type(hfst::HFST_OLW_TYPE);
           break;
     case 'Q':
-        options = "quick";
+        options += " quick";
+        break;
+    case 'C':
+        options += " compact";
+        break;
+    case 'L':
+        options += " lookdown";
         break;
 #include "inc/getopt-cases-error.h"
         }
@@ -227,6 +237,12 @@ process_stream(HfstInputStream& instream, HfstOutputStream& outstream)
         try {
             orig.convert(output_type, options);
         } HFST_CATCH(HfstException)
+        if (output_type == hfst::HFST_OL_TYPE ||
+            output_type == hfst::HFST_OLW_TYPE)
+        {
+          verbose_printf("Index table fill ratio %.3f\n",
+                         orig.get_index_fill_ratio());
+        }
         hfst_set_name(orig, orig, "convert");
         hfst_set_formula(orig, orig, "Id");
         outstream << orig;
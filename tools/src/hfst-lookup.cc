@@ -47,6 +47,9 @@ using hfst::hfst_fprintf_console;
 
 #include <limits>
 #include <math.h>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 #include "hfst-commandline.h"
 #include "hfst-program-options.h"
@@ -56,6 +59,8 @@ using hfst::hfst_fprintf_console;
 #include "HfstInputStream.h"
 #include "HfstOutputStream.h"
 #include "implementations/HfstBasicTransducer.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "implementations/optimized-lookup/transducer.h"
 
 #include "inc/globals-common.h"
 #include "inc/globals-unary.h"
@@ -103,6 +108,9 @@ static size_t infinite_cutoff=5;
 static size_t max_number=-1;
 static size_t MAX_NUMBER=5;
 static float beam=-1;
+static size_t threads=1;
+// how many input lines each thread gets per block in threaded mode
+static const size_t THREADED_LOOKUP_BLOCK_LINES=1024;
 
 #define CASCADE_UNION 1
 #define CASCADE_PRIORITY_UNION 2
@@ -112,6 +120,12 @@ static int cascade_ = CASCADE_UNION;
 // symbols actually seen in (non-ol) transducers
 static std::vector<std::set<std::string> > cascade_symbols_seen;
 static std::vector<bool> cascade_unknown_or_identity_seen;
+// input epsilon cycles of the same transducers, for infinite ambiguity
+static std::vector<hfst::implementations::HfstEpsilonCycleIndex*>
+  cascade_epsilon_cycles;
+// for looking up in the composition of an optimized-lookup cascade
+// without computing it
+static hfst_ol::CascadeLookupSession * cascade_session = NULL;
 
 enum lookup_input_format
 {
@@ -165,6 +179,8 @@ static bool print_statistics = false;
 
 static bool show_progress_bar = false;
 
+static bool memory_map = false;
+
 // predefined formats
 // Xerox:
 // word     word N SG
@@ -266,7 +282,12 @@ print_usage()
             "  -t, --time-cutoff=S              Limit search after having used S seconds per input\n"
             "                                   (only for lookup-optimized transducers)\n"
             "  -C, --cascade=CASCADE            How multiple transducers in input are handled\n"
-            "  -P, --progress                   Show neat progress bar if possible\n");
+            "  -P, --progress                   Show neat progress bar if possible\n"
+            "  -j, --threads=N                  Look up input in N parallel threads\n"
+            "                                   (only for one lookup-optimized transducer)\n"
+            "      --memory-map                 Use the transducers in place from a memory\n"
+            "                                   map of INFILE instead of loading them\n"
+            "                                   (only for lookup-optimized transducers)\n");
     fprintf(message_out, "\n");
     print_common_unary_program_parameter_instructions(message_out);
     fprintf(message_out,
@@ -279,12 +300,21 @@ print_usage()
             "Epsilon is printed by default as an empty string.\n"
             "B must be a non-negative float.\n"
             "S must be a non-negative float. The default, 0.0, indicates no cutoff.\n"
+            "With N > 1, input lines are collected into blocks of 1024*N lines,\n"
+            "the lines of a block are looked up in parallel and the results are\n"
+            "printed in input order once the whole block is done, so N > 1 is\n"
+            "meant for batch use rather than interactive use. N > 1 is an error\n"
+            "with print-pairs, with cascades of several transducers and with\n"
+            "transducers that are not lookup-optimized.\n"
             "If the input contains several transducers, a set containing\n"
             "results from all transducers is printed for each input string.\n");
     fprintf(message_out, "\n");
 
     fprintf(message_out, "CASCADE must be one of { union, priority-union, composition }.\n"
-            "If not specified, defaults to {union}.\n");
+            "If not specified, defaults to {union}. Composition of lookup-optimized\n"
+            "transducers is looked up without building it, leaving out paths around\n"
+            "epsilon cycles, and with B given, paths heavier than B from the best\n"
+            "analysis found so far are abandoned.\n");
     fprintf(message_out, "\n");
 
     fprintf(message_out, "STREAM can be { input, output, both }. If not given, defaults to {both}.\n"
@@ -342,12 +372,14 @@ parse_options(int argc, char** argv)
             {"pipe-mode", optional_argument, 0, 'p'},
             {"progress", no_argument, 0, 'P'},
             {"cascade", required_argument, 0, 'C'},
+            {"threads", required_argument, 0, 'j'},
+            {"memory-map", no_argument, 0, '1'},
             {0,0,0,0}
         };
         int option_index = 0;
         // add tool-specific options here
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "I:O:F:xc:n:X:e:E:b:t:p::PC:",
+                             HFST_GETOPT_UNARY_SHORT "I:O:F:xc:n:X:e:E:b:t:p::PC:j:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -484,6 +516,15 @@ parse_options(int argc, char** argv)
             show_progress_bar = true;
             break;
 
+        case 'j':
+            if (atoi(optarg) < 1)
+            {
+                std::cerr << "Invalid argument for --threads\n";
+                return EXIT_FAILURE;
+            }
+            threads = (size_t)atoi(optarg);
+            break;
+
         case 'C':
             if (strcmp(optarg, "union") == 0)
               { cascade_ = CASCADE_UNION; }
@@ -495,6 +536,9 @@ parse_options(int argc, char** argv)
               { error(EXIT_FAILURE, 0, "--cascade argument %s unrecognised, possible values are\n"
                       "{ union, priority-union, composition }", optarg); }
             break;
+        case '1':
+            memory_map = true;
+            break;
 #include "inc/getopt-cases-error.h"
         }
     }
@@ -1130,6 +1174,20 @@ void lookup_fd_and_print(HfstBasicTransducer * tr, HfstTransducer * TR, HfstOneL
                          bool print_fail = false, const HfstOneLevelPath * input_to_print = NULL,
                          bool no_newline = false);
 
+static void
+warn_about_infinite_results(size_t maxnum)
+{
+  if (!silent) {
+    if (max_number == -1)
+      warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "\n"
+              "(can be controlled with --max-number=N)",
+              maxnum);
+    else
+      warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "",
+              maxnum);
+  }
+}
+
 HfstOneLevelPaths*
 lookup_simple(const HfstOneLevelPath& s, HfstTransducer& t, bool* infinity, bool print_pairs_at_this_point=false, bool print_fail=false, const HfstOneLevelPath * input_to_print = NULL, bool no_newline=false)
 {
@@ -1137,15 +1195,7 @@ lookup_simple(const HfstOneLevelPath& s, HfstTransducer& t, bool* infinity, bool
   if (time_cutoff == 0.0 && t.is_lookup_infinitely_ambiguous(s.second))
     {
       size_t maxnum = (max_number == -1)? MAX_NUMBER : max_number;
-      if (!silent) {
-        if (max_number == -1)
-          warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "\n"
-                  "(can be controlled with --max-number=N)",
-                  maxnum);
-        else
-          warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "",
-                  maxnum);
-      }
+      warn_about_infinite_results(maxnum);
       if (print_pairs)
         lookup_fd_and_print(NULL, &t, *results, s, &maxnum, print_pairs_at_this_point, print_fail, input_to_print, no_newline);
       else
@@ -1407,7 +1457,9 @@ lookup_simple(const HfstOneLevelPath& s, HfstBasicTransducer& t, bool* infinity,
     (s, cascade_symbols_seen[transducer_number],
      cascade_unknown_or_identity_seen[transducer_number]);
 
-  if (possible && time_cutoff == 0.0 && t.is_lookup_infinitely_ambiguous(s, obey_flags))
+  if (possible && time_cutoff == 0.0 &&
+      cascade_epsilon_cycles[transducer_number]->
+        is_lookup_infinitely_ambiguous(s.second, obey_flags))
     {
       if (!silent && infinite_cutoff > 0) {
     warning(0, 0, "Got infinite results, number of cycles limited to " SIZE_T_SPECIFIER "",
@@ -1688,6 +1740,25 @@ print_lookups(const HfstOneLevelPaths& kvs,
 }
 
 
+HfstOneLevelPaths*
+lookup_composed(const HfstOneLevelPath& s, bool* infinity)
+{
+  // The session leaves out paths around epsilon cycles of the cascade,
+  // so the results are finite even when the composition is infinitely
+  // ambiguous
+  HfstOneLevelPaths* results = cascade_session->lookup_fd
+    (s.second, max_number, time_cutoff, beam);
+  if (cascade_session->is_lookup_infinitely_ambiguous())
+    {
+      *infinity = true;
+    }
+  if (results->size() == 0)
+    {
+      verbose_printf("Got no results\n");
+    }
+  return results;
+}
+
 HfstOneLevelPaths*
 perform_lookups(HfstOneLevelPath& origin, std::vector<HfstTransducer>& cascade,
                 bool unknown, bool* infinite)
@@ -1699,6 +1770,10 @@ perform_lookups(HfstOneLevelPath& origin, std::vector<HfstTransducer>& cascade,
           {
             kvs = lookup_simple(origin, cascade[0], infinite, true, true);
           }
+        else if (cascade_session != NULL)
+          {
+            kvs = lookup_composed(origin, infinite);
+          }
         else
          {
            kvs = lookup_cascading(origin, cascade, infinite);
@@ -1735,6 +1810,104 @@ perform_lookups(HfstOneLevelPath& origin, std::vector<HfstBasicTransducer>& casc
     return kvs;
 }
 
+// An input line waiting to be looked up and printed in threaded mode
+struct PendingLookup
+{
+  HfstOneLevelPath* kv;
+  char* markup;
+  bool unknown;
+  bool infinite;
+  HfstOneLevelPaths* kvs;
+};
+
+// Take lines from \a block until none are left and look them up
+// with \a session. Only the results are stored, printing is left to
+// the main thread so that the output stays in input order. An exception
+// stops the worker and is stored in \a error for the main thread.
+static void
+lookup_pending(hfst_ol::LookupSession * session,
+               std::vector<PendingLookup> * block,
+               std::atomic<size_t> * next,
+               std::exception_ptr * error)
+{
+  try
+    {
+      size_t i;
+      while ((i = (*next)++) < block->size())
+        {
+          PendingLookup & p = (*block)[i];
+          if (p.unknown)
+            {
+              p.kvs = new HfstOneLevelPaths;
+            }
+          else if (time_cutoff == 0.0 &&
+                   session->is_lookup_infinitely_ambiguous(p.kv->second))
+            {
+              size_t maxnum = (max_number == -1)? MAX_NUMBER : max_number;
+              p.kvs = session->lookup_fd(p.kv->second, maxnum, time_cutoff);
+              p.infinite = true;
+            }
+          else
+            {
+              p.kvs = session->lookup_fd(p.kv->second, max_number,
+                                         time_cutoff);
+            }
+        }
+    }
+  catch (...)
+    {
+      *error = std::current_exception();
+    }
+}
+
+// Look up \a block with one thread per session, the calling thread
+// being one of them, and print the results in input order.
+static void
+lookup_and_print_block(std::vector<hfst_ol::LookupSession*> & sessions,
+                       std::vector<PendingLookup> & block, FILE* outstream)
+{
+  std::atomic<size_t> next(0);
+  std::vector<std::exception_ptr> errors(sessions.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < sessions.size(); i++)
+    {
+      workers.push_back(std::thread(lookup_pending, sessions[i],
+                                    &block, &next, &errors[i]));
+    }
+  lookup_pending(sessions[0], &block, &next, &errors[0]);
+  for (size_t i = 0; i < workers.size(); i++)
+    {
+      workers[i].join();
+    }
+  for (size_t i = 0; i < errors.size(); i++)
+    {
+      if (errors[i])
+        {
+          std::rethrow_exception(errors[i]);
+        }
+    }
+
+  for (std::vector<PendingLookup>::iterator it = block.begin();
+       it != block.end(); it++)
+    {
+      if (it->infinite)
+        {
+          warn_about_infinite_results((max_number == -1)? MAX_NUMBER : max_number);
+        }
+      if (it->kvs->size() == 0)
+        {
+          verbose_printf("Got no results\n");
+        }
+      print_lookups(*(it->kvs), *(it->kv), it->markup, it->unknown,
+                    it->infinite, outstream);
+      delete it->kv;
+      delete it->kvs;
+      free(it->markup);
+    }
+  fflush(outstream);
+  block.clear();
+}
+
 int
 process_stream(HfstInputStream& inputstream, FILE* outstream)
 {
@@ -1810,6 +1983,30 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
 
     inputstream.close();
 
+    for (size_t i = 0; i < cascade_mut.size(); i++)
+      {
+        cascade_epsilon_cycles.push_back
+          (new hfst::implementations::HfstEpsilonCycleIndex(cascade_mut[i]));
+      }
+
+    // Composition of optimized-lookup transducers is looked up level by
+    // level in one search, so that ambiguous intermediate results are
+    // never collected. Pair printing still needs the results of the last
+    // transducer one intermediate string at a time.
+    if (only_optimized_lookup && cascade_ == CASCADE_COMPOSITION &&
+        cascade.size() > 1 && !print_pairs)
+      {
+        std::vector<const hfst_ol::Transducer*> levels;
+        for (size_t i = 0; i < cascade.size(); i++)
+          {
+            levels.push_back(hfst::implementations::ConversionFunctions::
+                             hfst_transducer_to_hfst_ol(&cascade[i]));
+          }
+        cascade_session = new hfst_ol::CascadeLookupSession(levels);
+        verbose_printf("Looking up in the composition of " SIZE_T_SPECIFIER
+                       " transducers\n", cascade.size());
+      }
+
     /*
     if ((cascade_ == CASCADE_COMPOSITION || cascade_ == CASCADE_PRIORITY_UNION) &&
         (inputstream.get_type() == HFST_OL_TYPE ||
@@ -1854,6 +2051,35 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
                   hfst_strformat(cascade[0].get_type()));
         }
       }
+    // In threaded mode every thread has its own lookup session on the
+    // same transducer. Only plain lookup of a single transducer can be
+    // done this way: pair printing prints during the lookup and cascades
+    // look up in several transducers one after another.
+    //
+    // The lines are still read and tokenized one at a time by this
+    // thread: stdio buffers the reading, and tokenizing for an
+    // optimized-lookup transducer is cheap next to the lookup. The lines
+    // are collected into blocks of THREADED_LOOKUP_BLOCK_LINES lines per
+    // thread and only their lookup is spread over the threads.
+    std::vector<hfst_ol::LookupSession*> sessions;
+    std::vector<PendingLookup> pending;
+    if (threads > 1)
+      {
+        if (!only_optimized_lookup || cascade.size() != 1 || print_pairs)
+          {
+            error(EXIT_FAILURE, 0, "--threads is only supported for plain "
+                  "lookup of a single optimized-lookup transducer");
+          }
+        hfst_ol::Transducer * ol = hfst::implementations::
+          ConversionFunctions::hfst_transducer_to_hfst_ol(&cascade[0]);
+        for (size_t i = 0; i < threads; i++)
+          {
+            sessions.push_back(new hfst_ol::LookupSession(*ol));
+          }
+        verbose_printf("Looking up in " SIZE_T_SPECIFIER " threads\n",
+                       threads);
+      }
+
     long filesize = -1;
     if (show_progress_bar)
       {
@@ -1863,7 +2089,10 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
         fprintf(stderr, "%ld... rewinding\n", filesize);
         rewind(lookup_file);
       }
-    print_prompt();
+    if (sessions.empty())
+      {
+        print_prompt();
+      }
     long filepos = ftell(lookup_file);
     while (true)
       {
@@ -1933,6 +2162,16 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
               }
             verbose_printf("\n");
           }
+        if (!sessions.empty())
+          {
+            PendingLookup p = { kv, markup, unknown, false, NULL };
+            pending.push_back(p);
+            if (pending.size() >= threads * THREADED_LOOKUP_BLOCK_LINES)
+              {
+                lookup_and_print_block(sessions, pending, outstream);
+              }
+            continue;
+          }
         if (only_optimized_lookup)
           {
             kvs = perform_lookups(*kv, cascade, unknown,
@@ -1954,11 +2193,26 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
 
         print_prompt();
       } // while lines in input
+    if (!sessions.empty())
+      {
+        lookup_and_print_block(sessions, pending, outstream);
+        for (size_t i = 0; i < sessions.size(); i++)
+          {
+            delete sessions[i];
+          }
+      }
     if (show_progress_bar)
       {
         fprintf(stderr, "%ld/%ld... Done\n", filepos, filesize);
       }
     free(line);
+    for (size_t i = 0; i < cascade_epsilon_cycles.size(); i++)
+      {
+        delete cascade_epsilon_cycles[i];
+      }
+    cascade_epsilon_cycles.clear();
+    delete cascade_session;
+    cascade_session = NULL;
     if (print_statistics)
       {
         fprintf(outstream, "Strings\tFound\tMissing\tResults\n"
@@ -2031,6 +2285,15 @@ int main( int argc, char **argv ) {
               inputfilename);
         return EXIT_FAILURE;
       }
+    if (memory_map)
+      {
+        if (inputfile == stdin)
+          {
+            warning(0, 0, "--memory-map needs a transducer file, "
+                    "ignoring it for standard input");
+          }
+        instream->set_memory_mapping(true);
+      }
     process_stream(*instream, outfile);
     if (outfile != stdout)
     {
@@ -133,6 +133,33 @@ print_usage()
     fprintf(message_out, "\n");
 }
 
+bool print_locations(const hfst_ol::LocationVectorVector & locations,
+                     std::ostream & outstream)
+{
+    bool printed_something = false;
+    for(hfst_ol::LocationVectorVector::const_iterator it = locations.begin();
+        it != locations.end(); ++it) {
+        if (it->at(0).output.compare("@_NONMATCHING_@") != 0) {
+            printed_something = true;
+#ifndef _MSC_VER
+            outstream << it->at(0).start << "|" << it->at(0).length << "|"
+                      << it->at(0).output << "|" << it->at(0).tag;
+            if (print_weights) {
+                outstream << "|" << it->at(0).weight;
+            }
+            outstream << std::endl;
+#else
+            if (print_weights){
+                hfst::hfst_fprintf_console(stdout, "%i|%i|%s|%s|%f\n", it->at(0).start, it->at(0).length, it->at(0).output.c_str(), it->at(0).tag.c_str(), it->at(0).weight);
+            } else {
+                hfst::hfst_fprintf_console(stdout, "%i|%i|%s|%s\n", it->at(0).start, it->at(0).length, it->at(0).output.c_str(), it->at(0).tag.c_str());
+            }
+#endif
+        }
+    }
+    return printed_something;
+}
+
 void match_and_print(hfst_ol::PmatchContainer & container,
                 std::ostream & outstream,
                 std::string & input_text)
@@ -152,32 +179,59 @@ void match_and_print(hfst_ol::PmatchContainer & container,
             outstream << std::endl;
         }
     } else {
-        hfst_ol::LocationVectorVector locations = container.locate(input_text, time_cutoff, weight_cutoff);
-        bool printed_something = false;
-        for(hfst_ol::LocationVectorVector::const_iterator it = locations.begin();
-            it != locations.end(); ++it) {
-            if (it->at(0).output.compare("@_NONMATCHING_@") != 0) {
-                printed_something = true;
+        if (print_locations(container.locate(input_text, time_cutoff, weight_cutoff),
+                            outstream)) {
+            outstream << std::endl;
+        }
+    }
+}
+
+// A paragraph is given to the container a line at a time, so results are
+// printed as soon as they are known and the paragraph is never held in
+// memory. The last newline seen is held back, because the final one of
+// the paragraph isn't part of the input.
+static std::string held_newline;
+static bool paragraph_started = false;
+static bool paragraph_printed_something = false;
+
+void stream_and_print(hfst_ol::PmatchContainer & container,
+                      std::ostream & outstream,
+                      const std::string & line,
+                      bool end_of_paragraph)
+{
+    std::string input_text = held_newline + line;
+    held_newline.clear();
+    if (input_text.size() > 0 && input_text.at(input_text.size() - 1) == '\n') {
+        input_text.erase(input_text.size() -1, 1);
+        if (!end_of_paragraph) {
+            held_newline = "\n";
+        }
+    }
+    paragraph_started = !end_of_paragraph;
+    if (!container.is_in_locate_mode()) {
 #ifndef _MSC_VER
-                outstream << it->at(0).start << "|" << it->at(0).length << "|"
-                          << it->at(0).output << "|" << it->at(0).tag;
-                if (print_weights) {
-                    outstream << "|" << it->at(0).weight;
-                }
-                outstream << std::endl;
+        outstream << container.match_stream(input_text, end_of_paragraph,
+                                            time_cutoff, weight_cutoff);
 #else
-                if (print_weights){
-                    hfst::hfst_fprintf_console(stdout, "%i|%i|%s|%s|%f\n", it->at(0).start, it->at(0).length, it->at(0).output.c_str(), it->at(0).tag.c_str(), it->at(0).weight);
-                } else {
-                    hfst::hfst_fprintf_console(stdout, "%i|%i|%s|%s\n", it->at(0).start, it->at(0).length, it->at(0).output.c_str(), it->at(0).tag.c_str());
-                }
+        hfst::hfst_fprintf_console(stdout, "%s", container.match_stream(input_text, end_of_paragraph, time_cutoff, weight_cutoff).c_str());
 #endif
-            }
+        if (end_of_paragraph) {
+            outstream << std::endl << std::endl;
         }
-        if (printed_something) {
-            outstream << std::endl;
+    } else {
+        if (print_locations(container.locate_stream(input_text, end_of_paragraph,
+                                                    time_cutoff, weight_cutoff),
+                            outstream)) {
+            paragraph_printed_something = true;
+        }
+        if (end_of_paragraph) {
+            if (paragraph_printed_something) {
+                outstream << std::endl;
+            }
+            paragraph_printed_something = false;
         }
     }
+    outstream.flush();
 }
 
 
@@ -217,32 +271,30 @@ int process_input(hfst_ol::PmatchContainer & container,
             input_text = line;
             match_and_print(container, outstream, input_text);
         } else if (line[0] == '\0' || line[0] == '\n') {
-            match_and_print(container, outstream, input_text);
-            input_text.clear();
+            stream_and_print(container, outstream, "", true);
         } else {
-            input_text.append(line);
+            input_text = line;
             if (isatty(STDIN_FILENO)) {
                 input_text.push_back('\n');
             }
+            stream_and_print(container, outstream, input_text, false);
         }
 #else
             input_text = line;
             match_and_print(container, outstream, input_text);
         } else if (line[0] == '\n') {
-            match_and_print(container, outstream, input_text);
-            input_text.clear();
+            stream_and_print(container, outstream, "", true);
         } else {
-            input_text.append(line);
+            stream_and_print(container, outstream, line, false);
         }
 #endif
 #else
             input_text = line;
             match_and_print(container, outstream, input_text);
         } else if (line[0] == '\n') {
-            match_and_print(container, outstream, input_text);
-            input_text.clear();
+            stream_and_print(container, outstream, "", true);
         } else {
-            input_text.append(line);
+            stream_and_print(container, outstream, line, false);
         }
 #endif
 
@@ -250,8 +302,8 @@ int process_input(hfst_ol::PmatchContainer & container,
         line = NULL;
     }
 
-    if (blankline_separated && !input_text.empty()) {
-        match_and_print(container, outstream, input_text);
+    if (blankline_separated && paragraph_started) {
+        stream_and_print(container, outstream, "", true);
     }
     if (count_patterns == on) {
         outstream << "\n" << container.get_pattern_count_info() << "\n";
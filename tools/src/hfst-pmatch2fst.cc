@@ -79,6 +79,8 @@ static bool disjunct_expressions=false;
 static bool line_separated = false;
 static bool flatten = false;
 static bool include_cosine_distances = false;
+static char *cache_directory=NULL;
+static size_t threads = 0;
 static clock_t timer;
 
 #if HAVE_OPENFST
@@ -103,7 +105,10 @@ print_usage()
     fprintf(message_out, "String and format options:\n"
             "  -e, --epsilon=EPS         Map EPS as zero\n"
             "      --flatten             Compile in all RTNs\n"
-            "      --cosine-distances    When compiling Like() operations, include cosine distance info\n");
+            "      --cosine-distances    When compiling Like() operations, include cosine distance info\n"
+            "      --cache=DIR           Reuse definitions compiled earlier, stored in DIR\n"
+            "  -T, --threads=N           Harmonize the compiled transducers in N threads\n"
+            "                            (default: one per hardware thread)\n");
     fprintf(message_out, "\n");
 
     fprintf(message_out,
@@ -137,11 +142,13 @@ parse_options(int argc, char** argv)
                 {"epsilon", required_argument, 0, 'e'},
                 {"flatten", no_argument, 0, '1'},
                 {"cosine-distances", no_argument, 0, '2'},
+                {"cache", required_argument, 0, '3'},
+                {"threads", required_argument, 0, 'T'},
                 {0,0,0,0}
             };
         int option_index = 0;
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "e:",
+                             HFST_GETOPT_UNARY_SHORT "e:T:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -161,6 +168,15 @@ parse_options(int argc, char** argv)
         case '2':
             include_cosine_distances = true;
             break;
+        case '3':
+            cache_directory = hfst_strdup(optarg);
+            break;
+        case 'T':
+            if (atoi(optarg) < 1) {
+                error(EXIT_FAILURE, 0, "Invalid or no argument for thread count");
+            }
+            threads = (size_t)atoi(optarg);
+            break;
 #include "inc/getopt-cases-error.h"
         }
     }
@@ -202,6 +218,12 @@ process_stream(HfstOutputStream& outstream)
     comp.set_verbose(verbose);
     comp.set_flatten(flatten);
     comp.set_include_cosine_distances(include_cosine_distances);
+    if (cache_directory != NULL) {
+        comp.set_cache_directory(cache_directory);
+    }
+    if (threads != 0) {
+        comp.set_thread_count(threads);
+    }
     std::string file_contents;
     std::map<std::string, HfstTransducer*> definitions;
     int c;
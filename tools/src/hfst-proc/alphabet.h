@@ -233,6 +233,13 @@ class ProcTransducerAlphabet : public TransducerAlphabet
   std::string symbol_to_string(SymbolNumber symbol) const
   {return symbol_table[symbol];}
   
+  /**
+   * Whether the symbol is written as nothing, so that it is left out of the
+   * output of a lookup
+   */
+  bool is_empty_symbol(SymbolNumber symbol) const
+  {return symbol_table[symbol].empty();}
+  
   /**
    * Use the symbol table to convert the given symbols into a string, optionally
    * modifying the case of some symbols
@@ -11,6 +11,8 @@
 //       along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <sstream>
+#include <memory>
+#include <thread>
 #include "applicators.h"
 #include "lookup-state.h"
 #include "lookup-path.h"
@@ -201,7 +203,7 @@ AnalysisApplicator::apply()
     }
   }
 
-  if(verboseFlag)
+  if(verboseFlag && report_end)
     std::cout << std::endl << "Got None/EOF symbol; done." << std::endl;
 
   // print any valid transductions stored
@@ -210,6 +212,84 @@ AnalysisApplicator::apply()
 }
 
 
+//////////Function definitions for ParallelAnalysisApplicator
+
+void
+ParallelAnalysisApplicator::analyse_parts(std::vector<Part>* block,
+                                          std::atomic<size_t>* next) const
+{
+  size_t i;
+  while((i = (*next)++) < block->size())
+  {
+    Part& part = (*block)[i];
+    std::istringstream in(part.input);
+    std::ostringstream out;
+    try
+    {
+      TokenIOStream part_stream(in, out, transducer.get_alphabet(),
+                                null_flush, raw);
+      std::unique_ptr<OutputFormatter> part_formatter(formatter.clone(part_stream));
+      // the end of the whole input is reported by apply()
+      AnalysisApplicator(transducer, part_stream, *part_formatter,
+                         caps_mode, false).apply();
+    }
+    catch(...)
+    {
+      part.error = std::current_exception();
+    }
+    part.output = out.str();
+  }
+}
+
+void
+ParallelAnalysisApplicator::apply()
+{
+  InputSplitter splitter(token_stream.istream(), transducer, null_flush, raw,
+                         PART_SIZE);
+  std::vector<Part> block;
+  bool more = true;
+  while(more)
+  {
+    // read parts until there are enough for all threads or the output is
+    // to be flushed
+    block.clear();
+    bool flush = false;
+    while(block.size() < threads*PARTS_PER_THREAD && !flush)
+    {
+      block.push_back(Part());
+      if(!splitter.read_part(block.back().input))
+      {
+        block.pop_back();
+        more = false;
+        break;
+      }
+      flush = splitter.ends_with_flush();
+    }
+    
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for(size_t i=1; i<threads && i<block.size(); i++)
+      workers.push_back(std::thread(&ParallelAnalysisApplicator::analyse_parts,
+                                    this, &block, &next));
+    analyse_parts(&block, &next);
+    for(size_t i=0; i<workers.size(); i++)
+      workers[i].join();
+    
+    for(std::vector<Part>::const_iterator it=block.begin(); it!=block.end(); it++)
+    {
+      token_stream.ostream() << it->output;
+      if(it->error)
+        std::rethrow_exception(it->error);
+    }
+    if(flush)
+      token_stream.ostream().flush();
+  }
+  
+  if(verboseFlag)
+    std::cout << std::endl << "Got None/EOF symbol; done." << std::endl;
+}
+
+
 //////////Function definitions for GenerationApplicator
 
 void
@@ -319,7 +399,7 @@ GenerationApplicator::split(const TokenVector& tokens) const
 LookupPathSet
 GenerationApplicator::preprocess_finals(const LookupPathSet& finals) const
 {
-  LookupPathSet goodcmp_finals(LookupPathW::compare_weights);
+  LookupPathSet goodcmp_finals(LookupPath::compare_weights);
   // insertion sort :)
   for (LookupPathSet::const_iterator it = finals.begin(); it != finals.end(); ++it)
   {
@@ -329,12 +409,11 @@ GenerationApplicator::preprocess_finals(const LookupPathSet& finals) const
   // Keep only the N best weight classes
   int classes_found = -1;
   Weight last_weight_class = 0.0;
-  LookupPathSet goodweight_finals(LookupPathW::compare_weights); 
+  LookupPathSet goodweight_finals(LookupPath::compare_weights); 
   for(LookupPathSet::const_iterator it = goodcmp_finals.begin(); it != goodcmp_finals.end(); it++)
   {
-          LookupPathW* pw = dynamic_cast<LookupPathW*>(*it);
-    if(pw != NULL) {
-      Weight current_weight = pw->get_weight();
+    if(it->is_weighted()) {
+      Weight current_weight = it->get_weight();
       if (classes_found == -1) // we're just starting
       {
         classes_found = 1;
@@ -353,7 +432,7 @@ GenerationApplicator::preprocess_finals(const LookupPathSet& finals) const
     goodweight_finals.insert(*it);
   }
   // Keep no more than maxAnalyses
-  LookupPathSet clipped_finals(LookupPathW::compare_weights);
+  LookupPathSet clipped_finals(LookupPath::compare_weights);
   LookupPathSet::const_iterator it = goodweight_finals.begin();
   for(int i=0; i < maxAnalyses && it != goodweight_finals.end(); i++, it++)
   {
@@ -373,7 +452,7 @@ GenerationApplicator::lookup(const TokenVector& tokens, bool generate_on_fail)
     LookupPathSet finals = state.get_finals_set();
     CapitalizationState caps_change = Unknown;
     if(caps_mode!=DictionaryCase) {
-        CapitalizationState lm_caps_state = token_stream.get_capitalization_state((*finals.begin())->get_output_symbols());
+        CapitalizationState lm_caps_state = token_stream.get_capitalization_state(finals.begin()->get_output_symbols());
         CapitalizationState sf_caps_state = token_stream.get_capitalization_state(TokenVector(tokens.begin(),tokens.size()>1?tokens.begin()+2:tokens.end()));
         if(sf_caps_state != lm_caps_state) {
             // We *only* change capitalization if lm and sf caps state differs
@@ -386,7 +465,7 @@ GenerationApplicator::lookup(const TokenVector& tokens, bool generate_on_fail)
 
     LookupPathSet new_finals = preprocess_finals(finals);
 
-    token_stream.put_symbols((*new_finals.begin())->get_output_symbols(),caps_change);
+    token_stream.put_symbols(new_finals.begin()->get_output_symbols(),caps_change);
     if(new_finals.size() > 1)
     {
       LookupPathSet::const_iterator it=new_finals.begin();
@@ -394,7 +473,7 @@ GenerationApplicator::lookup(const TokenVector& tokens, bool generate_on_fail)
       for(;it!=new_finals.end();it++)
       {
         token_stream.ostream() << '/';
-        token_stream.put_symbols((*it)->get_output_symbols(),caps_change);
+        token_stream.put_symbols(it->get_output_symbols(),caps_change);
       }
     }
     return true;
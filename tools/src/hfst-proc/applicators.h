@@ -13,6 +13,8 @@
 #ifndef _HFST_PROC_APPLICATORS_H_
 #define _HFST_PROC_APPLICATORS_H_
 
+#include <atomic>
+#include <exception>
 #include "lookup-path.h"
 #include "tokenizer.h"
 #include "transducer.h"
@@ -49,10 +51,61 @@ class AnalysisApplicator: public Applicator
  private:
   OutputFormatter& formatter;
   CapitalizationMode caps_mode;
+  /**
+   * Whether to say when the end of the input is reached in verbose mode
+   */
+  bool report_end;
  public:
   AnalysisApplicator(const ProcTransducer& t, TokenIOStream& ts,
-                     OutputFormatter& o, CapitalizationMode c):
-    Applicator(t,ts), formatter(o), caps_mode(c) {}
+                     OutputFormatter& o, CapitalizationMode c,
+                     bool report=true):
+    Applicator(t,ts), formatter(o), caps_mode(c), report_end(report) {}
+  void apply();
+};
+
+/**
+ * Does the same as AnalysisApplicator in parallel threads. The input is read
+ * in parts that can be analysed independently (see InputSplitter), each part
+ * is analysed with its own token stream and formatter, and the results are
+ * written in input order
+ */
+class ParallelAnalysisApplicator: public Applicator
+{
+ private:
+  /**
+   * The size in bytes after which a part of the input ends as soon as
+   * possible, and the number of parts per thread read at a time
+   */
+  static const size_t PART_SIZE = 16384;
+  static const size_t PARTS_PER_THREAD = 4;
+  
+  /**
+   * A part of the input and the result of analysing it
+   */
+  struct Part
+  {
+    std::string input;
+    std::string output;
+    std::exception_ptr error;
+  };
+  
+  const OutputFormatter& formatter;
+  CapitalizationMode caps_mode;
+  bool null_flush;
+  bool raw;
+  size_t threads;
+  
+  /**
+   * Analyse the parts of the block until none are left
+   * @param next the index of the next part to analyse, shared by the threads
+   */
+  void analyse_parts(std::vector<Part>* block, std::atomic<size_t>* next) const;
+ public:
+  ParallelAnalysisApplicator(const ProcTransducer& t, TokenIOStream& ts,
+                             const OutputFormatter& o, CapitalizationMode c,
+                             bool flush, bool r, size_t n):
+    Applicator(t,ts), formatter(o), caps_mode(c), null_flush(flush), raw(r),
+    threads(n) {}
   void apply();
 };
 
@@ -182,12 +182,14 @@ public:
   
   /**
    * Get the given buffer element
-   * @param the given position
+   * @param the given position. Positions computed from the current one, like
+   *        getPos()-1 when it is 0, wrap around the buffer if its size is a
+   *        power of two
    * @return the buffer element at the given position
    */
   T & get(size_t pos) const
     {
-      return buf[pos];
+      return buf[pos % size];
     }
  
   /**
@@ -214,15 +216,18 @@ public:
    * @param prevpos the given position.
    * @return the range size.
    */
-  size_t diffPrevPos(size_t const prevpos) const
+  size_t diffPrevPos(size_t prevpos) const
     {
-      if(prevpos <= currentpos)
+      // currentpos may be size, which is the same place as 0
+      size_t pos = currentpos % size;
+      prevpos %= size;
+      if(prevpos <= pos)
       {
-    return currentpos - prevpos;
+    return pos - prevpos;
       }
       else
       {
-    return currentpos + size - prevpos;
+    return pos + size - prevpos;
       }
     }
 
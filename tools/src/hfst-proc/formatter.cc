@@ -39,7 +39,7 @@ OutputFormatter::filter_compound_analyses(LookupPathSet& finals) const
   // first look to find the analysis with the fewest compound boundaries
   for(LookupPathSet::const_iterator it=finals.begin(); it!=finals.end(); it++)
   {
-    int num = token_stream.get_alphabet().num_compound_boundaries((*it)->get_output_symbols());
+    int num = token_stream.get_alphabet().num_compound_boundaries(it->get_output_symbols());
     boundary_counts.push_back(num);
     if(num < fewest_boundaries)
       fewest_boundaries = num;
@@ -65,7 +65,7 @@ OutputFormatter::filter_compound_analyses(LookupPathSet& finals) const
 LookupPathSet
 OutputFormatter::preprocess_finals(const LookupPathSet& finals) const
 {
-  LookupPathSet goodcmp_finals(LookupPathW::compare_weights);
+  LookupPathSet goodcmp_finals(LookupPath::compare_weights);
   // insertion sort :)
   for (LookupPathSet::const_iterator it = finals.begin(); it != finals.end(); ++it)
   {
@@ -85,12 +85,11 @@ OutputFormatter::preprocess_finals(const LookupPathSet& finals) const
   // Keep only the N best weight classes
   int classes_found = -1;
   Weight last_weight_class = 0.0;
-  LookupPathSet goodweight_finals(LookupPathW::compare_weights);
+  LookupPathSet goodweight_finals(LookupPath::compare_weights);
   for(LookupPathSet::const_iterator it = goodcmp_finals.begin(); it != goodcmp_finals.end(); it++)
   {
-          LookupPathW* pw = dynamic_cast<LookupPathW*>(*it);
-    if(pw != NULL) {
-      Weight current_weight = pw->get_weight();
+    if(it->is_weighted()) {
+      Weight current_weight = it->get_weight();
       if (classes_found == -1) // we're just starting
       {
         classes_found = 1;
@@ -109,7 +108,7 @@ OutputFormatter::preprocess_finals(const LookupPathSet& finals) const
     goodweight_finals.insert(*it);
   }
   // Keep no more than maxAnalyses
-  LookupPathSet clipped_finals(LookupPathW::compare_weights);
+  LookupPathSet clipped_finals(LookupPath::compare_weights);
   LookupPathSet::const_iterator it = goodweight_finals.begin();
   for(int i=0; i < maxAnalyses && it != goodweight_finals.end(); i++, it++)
   {
@@ -129,9 +128,9 @@ TransliterateOutputFormatter::process_finals(const LookupPathSet& finals, Capita
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
     std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
-    if(dynamic_cast<const LookupPathW*>(*it) != NULL && displayWeightsFlag)
-      res << '~' << dynamic_cast<const LookupPathW*>(*it)->get_weight() << '~';
+    res << token_stream.get_alphabet().symbols_to_string(it->get_output_symbols(), caps);
+    if(it->is_weighted() && displayWeightsFlag)
+      res << '~' << it->get_weight() << '~';
 
     results.push_back(res.str());
   }
@@ -199,9 +198,9 @@ ApertiumOutputFormatter::process_finals(const LookupPathSet& finals, Capitalizat
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
     std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
-    if (dynamic_cast<const LookupPathW *>(*it) != NULL && displayWeightsFlag) {
-      res << '~' << dynamic_cast<const LookupPathW *>(*it)->get_weight() << '~';
+    res << token_stream.get_alphabet().symbols_to_string(it->get_output_symbols(), caps);
+    if (it->is_weighted() && displayWeightsFlag) {
+      res << '~' << it->get_weight() << '~';
     }
     results.push_back(res.str());
   }
@@ -346,7 +345,7 @@ CGOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationSta
   LookupPathSet new_finals = preprocess_finals(finals);
 
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
-    results.push_back(process_final((*it)->get_output_symbols(), caps));
+    results.push_back(process_final(it->get_output_symbols(), caps));
 
   return results;
 }
@@ -383,9 +382,9 @@ XeroxOutputFormatter::process_finals(const LookupPathSet& finals, Capitalization
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
     std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
-    if(dynamic_cast<const LookupPathW*>(*it) != NULL && displayWeightsFlag)
-      res << "\t" << dynamic_cast<const LookupPathW*>(*it)->get_weight();
+    res << token_stream.get_alphabet().symbols_to_string(it->get_output_symbols(), caps);
+    if(it->is_weighted() && displayWeightsFlag)
+      res << "\t" << it->get_weight();
 
     results.push_back(res.str());
   }
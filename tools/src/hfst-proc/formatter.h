@@ -49,6 +49,11 @@ class OutputFormatter
   OutputFormatter(TokenIOStream& s, bool f): token_stream(s), do_compound_filtering(f) {}
   virtual ~OutputFormatter() {}
   
+  /**
+   * Create a formatter of the same kind that writes to another stream
+   */
+  virtual OutputFormatter* clone(TokenIOStream& s) const = 0;
+  
   /**
    * Take a list of lookup paths that end in final states, and produce a list of
    * string representations of the paths that can be written to the output
@@ -72,6 +77,7 @@ class TransliterateOutputFormatter: public OutputFormatter
 {
  public:
   TransliterateOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
+  OutputFormatter* clone(TokenIOStream& s) const {return new TransliterateOutputFormatter(s, do_compound_filtering);}
   
   ProcResult process_finals(const LookupPathSet& finals,
                                           CapitalizationState state) const;
@@ -86,6 +92,7 @@ class ApertiumOutputFormatter: public OutputFormatter
 {
  public:
   ApertiumOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
+  OutputFormatter* clone(TokenIOStream& s) const {return new ApertiumOutputFormatter(s, do_compound_filtering);}
   
   ProcResult process_finals(const LookupPathSet& finals,
                                           CapitalizationState state) const;
@@ -101,6 +108,7 @@ class CGOutputFormatter: public OutputFormatter
   std::string process_final(const SymbolNumberVector& symbols, CapitalizationState caps) const;
  public:
   CGOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
+  OutputFormatter* clone(TokenIOStream& s) const {return new CGOutputFormatter(s, do_compound_filtering);}
   
   ProcResult process_finals(const LookupPathSet& finals,
                                           CapitalizationState caps) const;
@@ -116,6 +124,7 @@ class XeroxOutputFormatter: public OutputFormatter
   std::string process_final(const SymbolNumberVector& symbols, CapitalizationState caps) const;
  public:
   XeroxOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
+  OutputFormatter* clone(TokenIOStream& s) const {return new XeroxOutputFormatter(s, do_compound_filtering);}
   
   ProcResult process_finals(const LookupPathSet& finals,
                                           CapitalizationState state) const;
@@ -104,7 +104,7 @@ bool print_usage(void)
   std::cout <<
     "\n" <<
     "Usage: hfst-proc " <<
-    "[-a [-p|-C|-x] [-k]|-g|-n|-d|-t] [-W] [-n N] [-c|-w] [-z] [-v|-q|]\n" <<
+    "[-a [-p|-C|-x] [-k]|-g|-n|-d|-t] [-W] [-n N] [-c|-w] [-z] [-T N] [-v|-q|]\n" <<
     "    transducer_file [input_file [output_file]]\n" <<
     "Perform a transducer lookup on a text stream, tokenizing on the fly\n" <<
     "Transducer must be in HFST optimized lookup format\n" <<
@@ -131,6 +131,7 @@ bool print_usage(void)
     "  -w  --dictionary-case   Output results using dictionary case instead of\n" <<
     "                          surface case\n" <<
     "  -z  --null-flush        Flush output on the null character\n" <<
+    "  -T N, --threads=N       Analyse the input in N parallel threads\n" <<
     "  -v, --verbose           Be verbose\n" <<
     "  -q, --quiet             Don't be verbose (default)\n" <<
     "  -V, --version           Print version information\n" <<
@@ -172,6 +173,7 @@ int main(int argc, char **argv)
   int capitalization = 0;
   bool filter_compound_analyses = true;
   bool null_flush = false;
+  size_t threads = 1;
   
   while (true)
   {
@@ -204,11 +206,12 @@ int main(int argc, char **argv)
       {"dictionary-case",no_argument,       0, 'w'},
       {"null-flush",     no_argument,       0, 'z'},
       {"raw",            no_argument,       0, 'X'},
+      {"threads",        required_argument, 0, 'T'},
       {0,                0,                 0,  0 }
     };
     
     int option_index = 0;
-    int c = getopt_long(argc, argv, "hVvqjsagndtpxCkeWrN:l:cwzX", long_options, &option_index);
+    int c = getopt_long(argc, argv, "hVvqjsagndtpxCkeWrN:l:cwzXT:", long_options, &option_index);
 
     if (c == -1) // no more options to look at
       break;
@@ -322,6 +325,15 @@ int main(int argc, char **argv)
       null_flush = true;
       break;
       
+    case 'T':
+      if (atoi(optarg) < 1)
+        {
+          std::cerr << "Invalid or no argument for thread count\n";
+          return EXIT_FAILURE;
+        }
+      threads = (size_t)atoi(optarg);
+      break;
+      
     default:
       std::cerr << "Invalid option\n\n";
       print_short_help();
@@ -430,6 +442,9 @@ int main(int argc, char **argv)
     in.close();
     TokenIOStream token_stream(*input, *output, t.get_alphabet(), null_flush,
                                rawMode);
+    if(threads > 1 && cmd != 0 && cmd != 'a' && !silentFlag)
+      std::cerr << "hfst-proc: warning: --threads is only supported for analysis, "
+                << "processing serially" << std::endl;
     Applicator* applicator = NULL;
     OutputFormatter* output_formatter = NULL;
     switch(cmd)
@@ -462,7 +477,16 @@ int main(int argc, char **argv)
           default:
             output_formatter = (OutputFormatter*)new ApertiumOutputFormatter(token_stream, filter_compound_analyses);
         }
-        applicator = new AnalysisApplicator(t, token_stream, *output_formatter, capitalization_mode);
+        if(threads > 1)
+        {
+          if(verboseFlag)
+            std::cout << "Analysing in " << threads << " threads" << std::endl;
+          applicator = new ParallelAnalysisApplicator(t, token_stream, *output_formatter,
+                                                      capitalization_mode, null_flush,
+                                                      rawMode, threads);
+        }
+        else
+          applicator = new AnalysisApplicator(t, token_stream, *output_formatter, capitalization_mode);
         break;
     }
     
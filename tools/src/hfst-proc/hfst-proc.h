@@ -33,12 +33,6 @@ using namespace hfst_ol;
 
 class LookupPath;
 
-/**
- * A list of pointers to lookup paths. They are pointers for the sake of
- * polymorphism
- */
-typedef std::vector<LookupPath*> LookupPathVector;
-
 class TokenIOStream;
 class Token;
 typedef std::vector<Token> TokenVector;
@@ -18,15 +18,14 @@
 #include "HfstFlagDiacritics.h"
 
 /**
- * Represents a (possibly partial) path through a transducer. This is used
- * during lookup for storing lookup paths that are continued as input symbols
- * are provided.
+ * Represents a (possibly partial) path through a transducer while a lookup is
+ * in progress. Records are plain values kept by a LookupState: the output
+ * symbols are a link into the state's output tree and the flag diacritic
+ * values an offset into its flag value storage, so a path is extended without
+ * copying either of them.
  */
-class LookupPath
+struct LookupPathRecord
 {
- protected:
-  const ProcTransducer& transducer;
- 
   /**
    * Points to the state in the transition index table or the transition table
    * where the path ends. This follows the normal semantics whereby values less
@@ -42,140 +41,229 @@ class LookupPath
   bool final;
   
   /**
-   * The output symbols of the transitions this path has followed
+   * The summed weight of the transitions this path has followed and the extra
+   * weight that is added to the sum when the path is at a final state
    */
-  SymbolNumberVector output_symbols;
+  Weight weight;
+  Weight final_weight;
   
- public:
-  LookupPath(const ProcTransducer& t, const TransitionTableIndex initial):
-    transducer(t), index(initial), final(false), output_symbols() {}
+  /**
+   * The node of the last output symbol in the output tree
+   */
+  unsigned int output;
+  
+  /**
+   * The offset of the flag diacritic values in the flag value storage
+   */
+  unsigned int flags;
+};
+
+typedef std::vector<LookupPathRecord> LookupPathRecordVector;
+
+/**
+ * The storage shared by the paths of one lookup. It only grows while the
+ * lookup goes on and is emptied, keeping its capacity, when a new lookup
+ * starts, so following transitions normally does not allocate at all.
+ */
+class LookupPathArena
+{
+ private:
+  /**
+   * An output symbol and the node of the output symbol before it. The outputs
+   * of all the paths form a tree, so paths that share a prefix share its
+   * storage
+   */
+  struct OutputNode
+  {
+    SymbolNumber symbol;
+    unsigned int parent;
+  };
   
-  LookupPath(const LookupPath& o):
-    transducer(o.transducer), index(o.index), final(o.final), output_symbols(o.output_symbols) {}
+  std::vector<OutputNode> outputs;
   
-  virtual ~LookupPath() {}
+  /**
+   * The flag diacritic values of the paths, num_features values per path.
+   * Values are never changed once stored; a flag that changes them stores a
+   * new copy
+   */
+  std::vector<hfst::FdValue> flag_values;
+  size_t num_features;
   
-  virtual LookupPath* clone() const {return new LookupPath(*this);}
+ public:
+  static const unsigned int NO_OUTPUT = (unsigned int)-1;
+  
+  LookupPathArena(size_t features): outputs(), flag_values(), num_features(features)
+  {
+    clear();
+  }
   
   /**
-   * Follow the transition index, modifying our index
-   * @param index the index to follow
+   * Forget all paths. Offset 0 holds the initial flag values afterwards
    */
-  virtual void follow(const TransitionIndex& index);
+  void clear()
+  {
+    outputs.clear();
+    flag_values.assign(num_features, 0);
+  }
   
   /**
-   * Follow the transition, appending the output symbol
-   * @param transition the transition to follow
-   * @true if following the transition succeeded. This can fail because of
-   *       e.g. flag diacritics in some subclasses
+   * Store an output symbol following the node parent
+   * @return the node of the new symbol
    */
-  virtual bool follow(const Transition& transition);
+  unsigned int add_output(unsigned int parent, SymbolNumber symbol)
+  {
+    OutputNode node;
+    node.symbol = symbol;
+    node.parent = parent;
+    outputs.push_back(node);
+    return outputs.size()-1;
+  }
   
+  /**
+   * Get the output symbols up to the given node in order
+   */
+  void get_output_symbols(unsigned int node, SymbolNumberVector& symbols) const;
   
-  static bool compare_pointers(LookupPath* p1, LookupPath* p2) {return *p1<*p2;}
+  /**
+   * Store a copy of the flag values at the given offset
+   * @return the offset of the copy
+   */
+  unsigned int copy_flags(unsigned int offset)
+  {
+    size_t copy = flag_values.size();
+    flag_values.resize(copy+num_features);
+    std::copy(flag_values.begin()+offset, flag_values.begin()+offset+num_features,
+              flag_values.begin()+copy);
+    return copy;
+  }
   
-  virtual bool operator<(const LookupPath& o) const;
+  /**
+   * Drop the flag values stored last, which must be at the given offset
+   */
+  void drop_flags(unsigned int offset)
+  {
+    flag_values.resize(offset);
+  }
   
-  TransitionTableIndex get_index() const {return index;}
-  bool at_final() const {return final;}
-  const SymbolNumberVector& get_output_symbols() const {return output_symbols;}
+  hfst::FdValue* get_flags(unsigned int offset)
+  {
+    return &flag_values[offset];
+  }
 };
 
-typedef std::set<LookupPath*, bool (*)(LookupPath*,LookupPath*)> LookupPathSet;
-
 /**
- * A base class used by lookup path types that handle flag diacritics
+ * Weight policy for lookup in unweighted transducers
  */
-class PathFd
+struct UnweightedPaths
 {
- protected:
-  /**
-   * The values of the flag diacritic features at the end of the path
-   */
-  FdState<SymbolNumber> fd_state;
-  
-  bool evaluate_flag_diacritic(SymbolNumber s);
+  static const bool weighted = false;
   
-  PathFd(const FdTable<SymbolNumber>& table):
-    fd_state(table) {}
-  PathFd(const PathFd& o): fd_state(o.fd_state) {}
-  virtual ~PathFd() {}
+  static void add_weight(LookupPathRecord&, const Transition&) {}
+  static void set_final_weight(const ProcTransducer&, LookupPathRecord&) {}
 };
 
 /**
- * A lookup path which additionally stores the state of the flag diacritics on
- * the path and whose follow is conditional based on evaluation diacritics
+ * Weight policy for lookup in weighted transducers, which sums the weights
+ * of the transitions and keeps the final weight of the state reached
  */
-class LookupPathFd : public LookupPath, PathFd
+struct WeightedPaths
 {
- public:
-  LookupPathFd(const ProcTransducer& t, const TransitionTableIndex initial):
-    LookupPath(t, initial), PathFd(t.get_alphabet().get_fd_table()) {}
-  LookupPathFd(const LookupPathFd& o): LookupPath(o), PathFd(o) {}
+  static const bool weighted = true;
   
-  virtual LookupPath* clone() const {return new LookupPathFd(*this);}
+  static void add_weight(LookupPathRecord& path, const Transition& transition)
+  {
+    path.weight += static_cast<const TransitionW&>(transition).get_weight();
+  }
   
-  virtual bool follow(const Transition& transition);
+  static void set_final_weight(const ProcTransducer& t, LookupPathRecord& path)
+  {
+    if(indexes_transition_index_table(path.index))
+      path.final_weight = static_cast<const TransitionWIndex&>(t.get_index(path.index)).final_weight();
+    else
+      path.final_weight = static_cast<const TransitionW&>(t.get_transition(path.index)).get_weight();
+  }
+};
+
+/**
+ * Flag policy for transducers without flag diacritics
+ */
+struct NoFlagPaths
+{
+  static bool apply_flag(const ProcTransducer&, LookupPathArena&,
+                         LookupPathRecord&, SymbolNumber)
+  {
+    return true;
+  }
+};
+
+/**
+ * Flag policy for transducers with flag diacritics. A path can only follow
+ * a flag diacritic whose operation succeeds on the path's values
+ */
+struct FlagPaths
+{
+  static bool apply_flag(const ProcTransducer& t, LookupPathArena& arena,
+                         LookupPathRecord& path, SymbolNumber s)
+  {
+    const hfst::FdCode* code = t.get_alphabet().get_fd_table().get_code(s);
+    if(code == NULL)
+      return true;
+    
+    unsigned int flags = arena.copy_flags(path.flags);
+    hfst::FdValue* values = arena.get_flags(flags);
+    if(!hfst::FdState<SymbolNumber>::apply_operation(code->op, code->feature,
+                                                     code->value, values))
+    {
+      arena.drop_flags(flags);
+      return false;
+    }
+    path.flags = flags;
+    return true;
+  }
 };
 
 /**
- * A lookup path which additionally stores the summed weight of the path
+ * A complete path through a transducer, as found by a lookup
  */
-class LookupPathW : public LookupPath
+class LookupPath
 {
  protected:
   /**
-   * The summed weight of the transitions this path has followed
+   * The output symbols of the transitions this path has followed
+   */
+  SymbolNumberVector output_symbols;
+  
+  /**
+   * The weight of the path including the final weight
    */
   Weight weight;
   
   /**
-   * An extra weight that is added to the sum when the path is at a final state
+   * Whether the path is from a weighted transducer
    */
-  Weight final_weight;
+  bool weighted;
+  
  public:
-  LookupPathW(const ProcTransducer& t, const TransitionTableIndex initial):
-        LookupPath(t, initial), weight(0.0f), final_weight(0.0f) {}
-  LookupPathW(const LookupPathW& o): LookupPath(o), weight(o.weight),
-    final_weight(o.final_weight) {}
+  LookupPath(const SymbolNumberVector& symbols, Weight w, bool is_weighted):
+    output_symbols(symbols), weight(w), weighted(is_weighted) {}
   
-  virtual LookupPath* clone() const {return new LookupPathW(*this);}
-
-  virtual void follow(const TransitionIndex& index);
-  virtual bool follow(const Transition& transition);
-  
-  static bool compare_weights(LookupPath* p1, LookupPath* p2) {
-          LookupPathW* pw1 = dynamic_cast<LookupPathW*>(p1);
-          LookupPathW* pw2 = dynamic_cast<LookupPathW*>(p2);
-          if(pw1 != NULL && pw2 != NULL) {
-                  return (*pw1) < (*pw2);
-          }
-          else {
-                  return (*p1) < (*p2);
-          }
-  }
-
   /**
-   * This sorts first by weight then by the value of output_symbols
+   * This sorts by the value of output_symbols
    */
-  virtual bool operator<(const LookupPathW& o) const;
+  static bool compare_outputs(const LookupPath& p1, const LookupPath& p2) {return p1<p2;}
   
-  Weight get_weight() const {return at_final() ? weight+final_weight : weight;}
-};
-
-/**
- * A lookup path with weight and flag diacritics
- */
-class LookupPathWFd : public LookupPathW, PathFd
-{
- public:
-  LookupPathWFd(const ProcTransducer& t, const TransitionTableIndex initial):
-    LookupPathW(t, initial), PathFd(t.get_alphabet().get_fd_table()) {}
-  LookupPathWFd(const LookupPathWFd& o): LookupPathW(o), PathFd(o) {}
+  /**
+   * This sorts first by weight then by the value of output_symbols
+   */
+  static bool compare_weights(const LookupPath& p1, const LookupPath& p2);
   
-  virtual LookupPath* clone() const {return new LookupPathWFd(*this);}
+  bool operator<(const LookupPath& o) const;
   
-  virtual bool follow(const Transition& transition);
+  bool is_weighted() const {return weighted;}
+  Weight get_weight() const {return weight;}
+  const SymbolNumberVector& get_output_symbols() const {return output_symbols;}
 };
 
+typedef std::set<LookupPath, bool (*)(const LookupPath&,const LookupPath&)> LookupPathSet;
+
 #endif
@@ -12,12 +12,70 @@
 
 #include "lookup-state.h"
 
+LookupState::LookupState(const ProcTransducer& t):
+  transducer(t),
+  weighted(t.is_weighted()),
+  flags(t.get_alphabet().has_flag_diacritics()),
+  paths(), new_paths(),
+  arena(flags ? t.get_alphabet().get_fd_table().num_features() : 0),
+  output_buffer()
+{
+  init();
+}
+
 void
-LookupState::init(LookupPath* initial)
+LookupState::init()
 {
-  clear_paths();
+  paths.clear();
+  arena.clear();
+  
+  LookupPathRecord initial;
+  initial.index = 0;
+  initial.final = false;
+  initial.weight = 0.0f;
+  initial.final_weight = 0.0f;
+  initial.output = LookupPathArena::NO_OUTPUT;
+  initial.flags = 0;
   paths.push_back(initial);
-  try_epsilons();
+  dispatch_epsilons();
+}
+
+void
+LookupState::dispatch_epsilons()
+{
+  if(weighted)
+  {
+    if(flags)
+      try_epsilons<WeightedPaths,FlagPaths>();
+    else
+      try_epsilons<WeightedPaths,NoFlagPaths>();
+  }
+  else
+  {
+    if(flags)
+      try_epsilons<UnweightedPaths,FlagPaths>();
+    else
+      try_epsilons<UnweightedPaths,NoFlagPaths>();
+  }
+}
+
+void
+LookupState::dispatch_input(const SymbolNumber input, const SymbolNumber altinput)
+{
+  if(weighted)
+  {
+    if(flags)
+      apply_input<WeightedPaths,FlagPaths>(input, altinput);
+    else
+      apply_input<WeightedPaths,NoFlagPaths>(input, altinput);
+  }
+  else
+  {
+    if(flags)
+      apply_input<UnweightedPaths,FlagPaths>(input, altinput);
+    else
+      apply_input<UnweightedPaths,NoFlagPaths>(input, altinput);
+  }
 }
 
 void
@@ -32,7 +90,7 @@ LookupState::step(const SymbolNumber input, const SymbolNumber altinput)
 {
   if(input == NO_SYMBOL_NUMBER)
   {
-    clear_paths();
+    paths.clear();
     return;
   }
   
@@ -44,8 +102,8 @@ LookupState::step(const SymbolNumber input, const SymbolNumber altinput)
     std::cout << std::endl;
   }
   
-  apply_input(input, altinput);
-  try_epsilons();
+  dispatch_input(input, altinput);
+  dispatch_epsilons();
 }
 
 void
@@ -58,55 +116,56 @@ LookupState::step(const SymbolNumber input, CapitalizationMode mode)
     step(input, transducer.get_alphabet().to_lower(input));
 }
 
-  
+
+template<class W>
 void
-LookupState::clear_paths()
+LookupState::follow(LookupPathRecord& path, const TransitionIndex& index) const
 {
-  for(LookupPathVector::const_iterator it = paths.begin(); it!=paths.end(); it++)
-    delete *it;
-  paths.clear();
+  path.index = index.get_target();
+  path.final = is_final(path);
+  W::set_final_weight(transducer, path);
 }
 
+template<class W, class F>
 bool
-LookupState::is_final() const
+LookupState::follow(LookupPathRecord& path, const Transition& transition)
 {
-  for(LookupPathVector::const_iterator i=paths.begin();
-      i!=paths.end(); ++i)
-  {
-    TransitionTableIndex index = (*i)->get_index();
-    if(indexes_transition_index_table(index))
-    {
-      if(transducer.get_index(index).final())
-        return true;
-    }
-    else
-    {
-      if(transducer.get_transition(index).final())
-        return true;
-    }
-  }
-  return false;
+  if(!F::apply_flag(transducer, arena, path, transition.get_input_symbol()))
+    return false;
+  
+  W::add_weight(path, transition);
+  path.index = transition.get_target();
+  path.final = is_final(path);
+  
+  SymbolNumber output = transition.get_output_symbol();
+  if(!transducer.get_alphabet().is_empty_symbol(output))
+    path.output = arena.add_output(path.output, output);
+  
+  //**is this right? I'm not so sure about the precise semantics of weights
+  //  and finals in this system**
+  W::set_final_weight(transducer, path);
+  return true;
 }
 
-const LookupPathVector
-LookupState::get_finals() const
+bool
+LookupState::is_final(const LookupPathRecord& path) const
 {
-  LookupPathVector finals;
-  for(LookupPathVector::const_iterator i=paths.begin(); i!=paths.end(); ++i)
+  if(indexes_transition_index_table(path.index))
+    return transducer.get_index(path.index).final();
+  else
+    return transducer.get_transition(path.index).final();
+}
+
+bool
+LookupState::is_final() const
+{
+  for(LookupPathRecordVector::const_iterator i=paths.begin();
+      i!=paths.end(); ++i)
   {
-    TransitionTableIndex index = (*i)->get_index();
-    if(indexes_transition_index_table(index))
-    {
-      if(transducer.get_index(index).final())
-        finals.push_back(*i);
-    }
-    else
-    {
-      if(transducer.get_transition(index).final())
-        finals.push_back(*i);
-    }
+    if(is_final(*i))
+      return true;
   }
-  return finals;
+  return false;
 }
 
 const LookupPathSet
@@ -114,36 +173,32 @@ LookupState::get_finals_set() const
 {
   if(printDebuggingInformationFlag)
     std::cout << "Calculating final paths" << std::endl;
-  LookupPathSet finals(LookupPath::compare_pointers);
-  for(LookupPathVector::const_iterator i=paths.begin(); i!=paths.end(); ++i)
+  LookupPathSet finals(LookupPath::compare_outputs);
+  for(LookupPathRecordVector::const_iterator i=paths.begin(); i!=paths.end(); ++i)
   {
-    bool is_final;
-    TransitionTableIndex index = (*i)->get_index();
-    
-    if(indexes_transition_index_table(index))
-      is_final = transducer.get_index(index).final();
-    else
-      is_final = transducer.get_transition(index).final();
-    
-    if(is_final)
+    if(is_final(*i))
     {
+      arena.get_output_symbols(i->output, output_buffer);
+      LookupPath path(output_buffer,
+                      i->final ? i->weight+i->final_weight : i->weight,
+                      weighted);
       if(printDebuggingInformationFlag)
       {
         std::cout << "  Final path found:";
-        for(SymbolNumberVector::const_iterator itr=(*i)->get_output_symbols().begin();itr!=(*i)->get_output_symbols().end(); itr++)
+        for(SymbolNumberVector::const_iterator itr=output_buffer.begin();itr!=output_buffer.end(); itr++)
           std::cout << " " << *itr;
         std::cout << std::endl;
       }
-      std::pair<LookupPathSet::iterator,bool> loc = finals.insert(*i);
+      std::pair<LookupPathSet::iterator,bool> loc = finals.insert(path);
       
       if(loc.second == false) // if this form was already in the set
       {
         if(printDebuggingInformationFlag)
           std::cout << "  Duplicate LookupPath found" << std::endl;
-        if(*i < *(loc.first)) // if this form has a lower weight than the one there
+        if(path.get_weight() < loc.first->get_weight()) // if this form has a lower weight than the one there
         {
           finals.erase(loc.first);
-          finals.insert(*i);
+          finals.insert(path);
         }
       }
     }
@@ -151,61 +206,49 @@ LookupState::get_finals_set() const
   return finals;
 }
 
-void
-LookupState::add_path(LookupPath& path)
-{
-  paths.push_back(&path);
-}
-
-void
-LookupState::replace_paths(const LookupPathVector& new_paths)
-{
-  clear_paths();
-  paths = new_paths;
-}
-
 
 
+template<class W, class F>
 void
 LookupState::try_epsilons()
 {
   for(size_t i=0; i<paths.size(); i++)
   {
-    const LookupPath& path = *paths[i];
-    
-    if(indexes_transition_index_table(path.get_index()))
-      try_epsilon_index(path);
+    if(indexes_transition_index_table(paths[i].index))
+      try_epsilon_index<W,F>(paths[i]);
     else // indexes transition table
-      try_epsilon_transitions(path);
+      try_epsilon_transitions<W,F>(paths[i]);
   }
 }
 
+template<class W, class F>
 void
-LookupState::try_epsilon_index(const LookupPath& path)
+LookupState::try_epsilon_index(const LookupPathRecord path)
 {
   // if this path points to an entry in the transition index table
   // which indexes one or more epsilon transtions
-  const TransitionIndex& index = transducer.get_index(path.get_index()+1);
+  const TransitionIndex& index = transducer.get_index(path.index+1);
   
   if(index.matches(0))
   {
     // copy the current path, follow the index, add the new path to the list
-    LookupPath& epsilon_path = *path.clone();
-    epsilon_path.follow(index);
-    add_path(epsilon_path);
+    LookupPathRecord epsilon_path = path;
+    follow<W>(epsilon_path, index);
+    paths.push_back(epsilon_path);
   }
 }
 
+template<class W, class F>
 void
-LookupState::try_epsilon_transitions(const LookupPath& path)
+LookupState::try_epsilon_transitions(const LookupPathRecord path)
 {
   TransitionTableIndex transition_index;
   
   // if the path is pointing to the "state" entry before the transitions
-  if(transducer.get_transition(path.get_index()).get_input_symbol() == NO_SYMBOL_NUMBER)
-    transition_index = path.get_index()+1;
+  if(transducer.get_transition(path.index).get_input_symbol() == NO_SYMBOL_NUMBER)
+    transition_index = path.index+1;
   else // the path is pointing directly to a transition
-    transition_index = path.get_index();
+    transition_index = path.index;
   
   while(true)
   {
@@ -214,14 +257,9 @@ LookupState::try_epsilon_transitions(const LookupPath& path)
     if(transducer.is_epsilon(transition))
     {
       // copy the path, follow the transition, add the new path to the list
-      LookupPath& epsilon_path = *path.clone();
-      if(epsilon_path.follow(transition))
-        add_path(epsilon_path);
-      else
-      {
-        // destroy the new path instead of pushing it
-        delete &epsilon_path;
-      }
+      LookupPathRecord epsilon_path = path;
+      if(follow<W,F>(epsilon_path, transition))
+        paths.push_back(epsilon_path);
     }
     else
       return;
@@ -231,74 +269,73 @@ LookupState::try_epsilon_transitions(const LookupPath& path)
 }
 
 
+template<class W, class F>
 void
 LookupState::apply_input(const SymbolNumber input, const SymbolNumber altinput)
 {
-  LookupPathVector new_paths;
+  new_paths.clear();
   if(input == 0)
   {
-    replace_paths(new_paths);
+    paths.clear();
     return;
   }
   
   for(size_t i=0; i<paths.size(); i++)
   {
-    LookupPath& path = *paths[i];
+    const LookupPathRecord& path = paths[i];
     
-    if(indexes_transition_index_table(path.get_index()))
+    if(indexes_transition_index_table(path.index))
     {
-      try_index(new_paths, path, input);
+      try_index<W,F>(path, input);
       if(altinput != NO_SYMBOL_NUMBER)
-        try_index(new_paths, path, altinput);
-      //if(!try_index(new_paths, path, input) && altinput != NO_SYMBOL_NUMBER)
-      //  try_index(new_paths, path, altinput);
+        try_index<W,F>(path, altinput);
+      //if(!try_index(path, input) && altinput != NO_SYMBOL_NUMBER)
+      //  try_index(path, altinput);
     }
     else // indexes transition table
     {
-      try_transitions(new_paths, path, input);
+      try_transitions<W,F>(path, input);
       if(altinput != NO_SYMBOL_NUMBER)
-        try_transitions(new_paths, path, altinput);
-      //if(!try_transitions(new_paths, path, input) && altinput != NO_SYMBOL_NUMBER)
-      //  try_transitions(new_paths, path, altinput);
+        try_transitions<W,F>(path, altinput);
+      //if(!try_transitions(path, input) && altinput != NO_SYMBOL_NUMBER)
+      //  try_transitions(path, altinput);
     }
   }
   
-  replace_paths(new_paths);
+  paths.swap(new_paths);
 }
 
+template<class W, class F>
 bool
-LookupState::try_index(LookupPathVector& new_paths,
-                         const LookupPath& path,
-                         const SymbolNumber input) const
+LookupState::try_index(const LookupPathRecord& path,
+                       const SymbolNumber input)
 {
   //??? is the +1 here correct?
-  TransitionIndex index = transducer.get_index(path.get_index()+input+1);
+  const TransitionIndex& index = transducer.get_index(path.index+input+1);
   
   if(index.matches(input))
   {
     // copy the path, follow the index, and handle the new transitions
-    LookupPath& extended_path = *path.clone();
-    extended_path.follow(index);
-    bool res = try_transitions(new_paths, extended_path, input);
-    delete &extended_path;
-    return res;
+    LookupPathRecord extended_path = path;
+    follow<W>(extended_path, index);
+    return try_transitions<W,F>(extended_path, input);
   }
   return false;
 }
 
+template<class W, class F>
 bool
-LookupState::try_transitions(LookupPathVector& new_paths,
-                               const LookupPath& path,
-                               const SymbolNumber input) const
+LookupState::try_transitions(const LookupPathRecord& path,
+                             const SymbolNumber input)
 {
   bool found = false;
   TransitionTableIndex transition_index;
   
   // if the path is pointing to the "state" entry before the transitions
-  if(transducer.get_transition(path.get_index()).get_input_symbol() == NO_SYMBOL_NUMBER)
-    transition_index = path.get_index()+1;
+  if(transducer.get_transition(path.index).get_input_symbol() == NO_SYMBOL_NUMBER)
+    transition_index = path.index+1;
   else // the path is pointing directly to a transition
-    transition_index = path.get_index();
+    transition_index = path.index;
   
   while(true)
   {
@@ -307,10 +344,12 @@ LookupState::try_transitions(LookupPathVector& new_paths,
     if(transition.matches(input))
     {
       // copy the path, follow the transition, add the new path to the list
-      LookupPath& extended_path = *path.clone();
-      extended_path.follow(transition);
-      new_paths.push_back(&extended_path);
-      found = true;
+      LookupPathRecord extended_path = path;
+      if(follow<W,F>(extended_path, transition))
+      {
+        new_paths.push_back(extended_path);
+        found = true;
+      }
     }
     else
       return found;
@@ -318,4 +357,3 @@ LookupState::try_transitions(LookupPathVector& new_paths,
     transition_index++;
   }
 }
-
@@ -17,7 +17,10 @@
 #include "lookup-path.h"
 
 /**
- * Represents the current state of a lookup operation
+ * Represents the current state of a lookup operation. The paths are kept as
+ * values in vectors that are reused from one lookup to the next, and the
+ * lookup itself is instantiated for each combination of weight and flag
+ * policy, so stepping does not need the allocator or virtual calls.
  */
 class LookupState
 {
@@ -27,37 +30,66 @@ class LookupState
    */
   const ProcTransducer& transducer;
   
+  /**
+   * Whether the transducer is weighted and whether it has flag diacritics.
+   * These select the policies the lookup is done with
+   */
+  bool weighted;
+  bool flags;
+  
   /**
    * The active paths in a lookup operation. At the start of a lookup this will
    * contain one path. The lookup has failed if it is ever empty.
    */
-  LookupPathVector paths;
-  
+  LookupPathRecordVector paths;
   
   /**
-   * Delete all active paths and clear the list
+   * The paths generated by the input symbol being applied. Kept here only to
+   * reuse its storage
    */
-  void clear_paths();
+  LookupPathRecordVector new_paths;
   
   /**
-   * Add a new path to the list of active paths
-   * @param path the path to add
+   * The output symbols and flag diacritic values of the paths
    */
-  void add_path(LookupPath& path);
+  LookupPathArena arena;
   
   /**
-   * Get rid of the current paths and replace the list with a new list.
-   * @param new_paths the new list of paths to store in the lookup state
+   * The output symbols of a path, for get_finals_set
    */
-  void replace_paths(const LookupPathVector& new_paths);
+  mutable SymbolNumberVector output_buffer;
   
   
   /**
    * Setup the state with a single initial path ending at starting state and
    * try epsilons at the initial position
-   * @param initial an initial path to start the lookup
    */
-  void init(LookupPath* initial);
+  void init();
+  
+  /**
+   * Call the instance of try_epsilons or apply_input for the policies of
+   * the transducer
+   */
+  void dispatch_epsilons();
+  void dispatch_input(const SymbolNumber input, const SymbolNumber altinput);
+  
+  /**
+   * Make the given path follow the transition index
+   * @param path the path to modify
+   * @param index the index to follow
+   */
+  template<class W>
+  void follow(LookupPathRecord& path, const TransitionIndex& index) const;
+  
+  /**
+   * Make the given path follow the transition, appending the output symbol
+   * @param path the path to modify
+   * @param transition the transition to follow
+   * @true if following the transition succeeded. This can fail because of
+   *       flag diacritics, in which case the path is unchanged
+   */
+  template<class W, class F>
+  bool follow(LookupPathRecord& path, const Transition& transition);
   
   
   /**
@@ -66,14 +98,17 @@ class LookupState
    * Because the additional paths are appended as they are generated, any
    * new epsilons generated by the epsilons will be properly handled
    */
+  template<class W, class F>
   void try_epsilons();
   
   /**
    * If the given path points to a place in the index table with an epsilon
    * index, generate an additional path by following it
-   * @param path a path pointing to the transition index table
+   * @param path a path pointing to the transition index table. This is a copy
+   *             because adding paths may move the active ones
    */
-  void try_epsilon_index(const LookupPath& path);
+  template<class W, class F>
+  void try_epsilon_index(const LookupPathRecord path);
   
   /**
    * If the given path points to one or more epsilon transitions, generate
@@ -81,7 +116,8 @@ class LookupState
    * @param path a path pointing to the beginning of a state in the transition
    *             table or directly to transitions
    */
-  void try_epsilon_transitions(const LookupPath& path);
+  template<class W, class F>
+  void try_epsilon_transitions(const LookupPathRecord path);
   
   
   /**
@@ -91,31 +127,36 @@ class LookupState
    * @param input the input symbol to apply
    * @param altinput a secondary input symbol to try when input fails
    */
+  template<class W, class F>
   void apply_input(const SymbolNumber input, const SymbolNumber altinput);
   
   /**
    * If the given path points to a place in the index table with an index for
    * the given input symbol, call try_transitions after having the path follow
    * the index
-   * @param new_paths any new paths generated get appended here
    * @param path a path pointing to the transition index table
    * @param input the input symbol to look up in the transition index table
    * @return whether the path has a continuation with the given input
    */
-  bool try_index(LookupPathVector& new_paths,
-                 const LookupPath& path, const SymbolNumber input) const;
+  template<class W, class F>
+  bool try_index(const LookupPathRecord& path, const SymbolNumber input);
   
   /**
    * If the given path points to one or more transitions whose inputs match
-   * the given input symbol, generate new paths by following them
-   * @param new_paths any new paths generated get appended here
+   * the given input symbol, generate new paths by following them and append
+   * them to new_paths
    * @param path a path pointing to the beginning of a state in the transition
    *             table or directly to transitions
    * @param input the input symbol to look up in the transition table
    * @return whether the path has a continuation with the given input
    */
-  bool try_transitions(LookupPathVector& new_paths,
-                       const LookupPath& path, const SymbolNumber input) const;
+  template<class W, class F>
+  bool try_transitions(const LookupPathRecord& path, const SymbolNumber input);
+  
+  /**
+   * Whether the given path ends at a final state
+   */
+  bool is_final(const LookupPathRecord& path) const;
   
  public:
   /**
@@ -123,28 +164,14 @@ class LookupState
    * given transducer
    * @param t the transducer in which the lookup will occur
    */
-  LookupState(const ProcTransducer& t): transducer(t), paths()
-  {
-    reset();
-  }
-  
-  LookupState(const LookupState& o): transducer(o.transducer), paths()
-  {
-    for(LookupPathVector::const_iterator it=o.paths.begin(); it!=o.paths.end(); it++)
-      paths.push_back((*it)->clone());
-  }
-  
-  ~LookupState()
-  {
-    clear_paths();
-  }
+  LookupState(const ProcTransducer& t);
   
   /**
    * Clear any current lookup paths and prepare it for a new lookup
    */
   void reset()
   {
-    init(transducer.get_initial_path());
+    init();
   }
   
   /**
@@ -165,13 +192,8 @@ class LookupState
   bool is_final() const;
   
   /**
-   * Get a list of active paths that are at a final state
-   * @return the active paths that are at a final state
-   */
-  const LookupPathVector get_finals() const;
-  
-  /**
-   * Get the finals with duplicates removed
+   * Get the paths that are at a final state with duplicates removed. Of
+   * paths with the same output the one with the lowest weight is kept
    */
   const LookupPathSet get_finals_set() const;
   
@@ -419,3 +419,98 @@ TokenIOStream::tokens_to_string(const TokenVector& t, bool raw) const
     res += token_to_string(*it,raw);
   return res;
 }
+
+
+//////////Function definitions for InputSplitter
+
+InputSplitter::InputSplitter(std::istream& i, const ProcTransducer& t,
+                             bool flush, bool raw, size_t size):
+  is(i), null_flush(flush), is_raw(raw), part_size(size), splits(128, false),
+  splits_at_superblanks(!raw && t.splits_input_at_superblanks()),
+  flushed(false), at_end(false)
+{
+  const char* blanks = " \t\r\n";
+  for(const char* c=blanks; *c!='\0'; c++)
+    splits[(unsigned char)*c] = t.splits_input(*c);
+}
+
+void
+InputSplitter::read_superblank(std::string& part)
+{
+  // as in TokenIOStream::read_delimited
+  bool is_wblank = (is.peek() == '[');
+  int c;
+  while((c = is.get()) != EOF)
+  {
+    part += (char)c;
+    if(c == '\\')
+    {
+      if((c = is.get()) == EOF)
+        break;
+      part += (char)c;
+    }
+    else if(c == ']')
+      break;
+  }
+  if(is_wblank && c != EOF && (c = is.get()) != EOF)
+    part += (char)c;
+}
+
+bool
+InputSplitter::read_part(std::string& part)
+{
+  part.clear();
+  flushed = false;
+  if(at_end)
+    return false;
+  
+  // the number of bytes left of the current UTF-8 character
+  int continuation = 0;
+  int c;
+  while((c = is.get()) != EOF)
+  {
+    part += (char)c;
+    if(c == '\0')
+    {
+      // without null flushing the tokenizer stops at a null character
+      if(null_flush)
+        flushed = true;
+      else
+        at_end = true;
+      return true;
+    }
+    if(continuation > 0)
+    {
+      continuation--;
+      continue;
+    }
+    
+    if(!is_raw && c == '\\')
+    {
+      if((c = is.get()) == EOF)
+        break;
+      part += (char)c;
+      continue;
+    }
+    if(!is_raw && c == '[')
+    {
+      read_superblank(part);
+      if(splits_at_superblanks && part.size() >= part_size)
+        return true;
+      continue;
+    }
+    
+    // as in TokenIOStream::read_utf8_char
+    if((c & (128 + 64 + 32 + 16)) == (128 + 64 + 32 + 16))
+      continuation = 3;
+    else if((c & (128 + 64 + 32)) == (128 + 64 + 32))
+      continuation = 2;
+    else if((c & (128 + 64)) == (128 + 64))
+      continuation = 1;
+    else if(c < 128 && splits[c] && part.size() >= part_size)
+      return true;
+  }
+  
+  at_end = true;
+  return !part.empty();
+}
@@ -224,6 +224,7 @@ class TokenIOStream
    */
   TokenIOStream& operator<<(const Token& t) {put_token(t); return *this;}
 
+  std::istream& istream() {return is;}
   std::ostream& ostream() {return os;}
 
   void write_escaped(const std::string str) {os << escape(str);}
@@ -238,4 +239,53 @@ class TokenIOStream
   static std::string read_utf8_char(std::istream& is);
 };
 
+class ProcTransducer;
+
+/**
+ * Reads the input stream in parts that can be analysed independently of each
+ * other, e.g. in parallel. Once a part has reached the requested size it ends
+ * after the next blank character or superblank at which every lookup ends
+ * (see ProcTransducer::splits_input). When null flushing, a part also ends
+ * after each null character, so that the output can be flushed there.
+ *
+ * Only the stream syntax that decides where tokens begin is followed here:
+ * backslash escapes, superblanks and UTF-8 characters
+ */
+class InputSplitter
+{
+  std::istream& is;
+  bool null_flush;
+  bool is_raw;
+  size_t part_size;
+  
+  /**
+   * Which (ASCII) characters a part can end after
+   */
+  std::vector<bool> splits;
+  bool splits_at_superblanks;
+  
+  bool flushed;
+  bool at_end;
+  
+  /**
+   * Append the rest of a superblank, whose '[' has been read, to part
+   */
+  void read_superblank(std::string& part);
+ public:
+  InputSplitter(std::istream& i, const ProcTransducer& t, bool flush, bool raw,
+                size_t size);
+  
+  /**
+   * Read the next part of the input
+   * @param part where to store the part
+   * @return false if the input has ended and nothing was read
+   */
+  bool read_part(std::string& part);
+  
+  /**
+   * Whether the part read last ended with a null flush
+   */
+  bool ends_with_flush() const {return flushed;}
+};
+
 #endif
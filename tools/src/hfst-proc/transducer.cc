@@ -20,23 +20,22 @@
 #include "formatter.h"
 
 
-static LookupPath* create_initial_path(const ProcTransducer& t) { return new LookupPath(t, 0);}
-static LookupPath* create_initial_path_fd(const ProcTransducer& t) { return new LookupPathFd(t, 0);}
-static LookupPath* create_initial_path_weighted(const ProcTransducer& t) { return new LookupPathW(t, 0);}
-static LookupPath* create_initial_path_weighted_fd(const ProcTransducer& t) { return new LookupPathWFd(t, 0);}
-
 //////////Function definitions for ProcTransducer
 
-InitialPathCreator ProcTransducer::initial_path_creators[2][2] =
-    {{create_initial_path, create_initial_path_fd},
-     {create_initial_path_weighted, create_initial_path_weighted_fd}};
-
 ProcTransducer::ProcTransducer(std::istream& is): Transducer()
 {
   header = new TransducerHeader(is);
   alphabet = new ProcTransducerAlphabet(is, header->symbol_count());
   load_tables(is);
   
+  read_symbols.resize(header->symbol_count(), false);
+  for(TransitionTableIndex i=0; i<header->target_table_size(); i++)
+  {
+    SymbolNumber input = get_transition(i).get_input_symbol();
+    if(input < read_symbols.size())
+      read_symbols[input] = true;
+  }
+  
   if (header->probe_flag(Has_unweighted_input_epsilon_cycles) ||
       header->probe_flag(Has_input_epsilon_cycles))
   {
@@ -69,9 +68,27 @@ ProcTransducer::is_epsilon(const Transition& transition) const
   return transition.matches(0) || alphabet->is_flag_diacritic(transition.get_input_symbol());
 }
 
-LookupPath*
-ProcTransducer::get_initial_path() const
+bool
+ProcTransducer::splits_input(char c) const
 {
-  return (*initial_path_creators[header->probe_flag(Weighted)][alphabet->has_flag_diacritics()])(*this);
+  // a longer symbol could swallow the character
+  const SymbolTable& symbols = get_alphabet().get_symbol_table();
+  for(SymbolTable::const_iterator it=symbols.begin(); it!=symbols.end(); it++)
+  {
+    if(it->length() > 1 && it->find(c) != std::string::npos)
+      return false;
+  }
+  
+  std::string str(1, c);
+  SymbolNumber s = get_alphabet().get_symbolizer().find_symbol(str.c_str());
+  if(s == NO_SYMBOL_NUMBER)
+    return !get_alphabet().is_alphabetic(str.c_str());
+  return !get_alphabet().is_alphabetic(s) && !reads_symbol(s);
 }
 
+bool
+ProcTransducer::splits_input_at_superblanks() const
+{
+  SymbolNumber blank = get_alphabet().get_blank_symbol();
+  return !get_alphabet().is_alphabetic(blank) && !reads_symbol(blank);
+}
@@ -24,14 +24,14 @@
 
 using namespace hfst_ol;
 
-class ProcTransducer;
-
-typedef LookupPath* (*InitialPathCreator)(const ProcTransducer&);
-
 class ProcTransducer : public Transducer
 {
  protected:
-  static InitialPathCreator initial_path_creators[2][2];
+  /**
+   * Whether each symbol is the input of some transition
+   */
+  std::vector<bool> read_symbols;
+  
 
   /**
    * Check if the transducer accepts an input string consisting of just a blank
@@ -45,10 +45,29 @@ class ProcTransducer : public Transducer
   bool is_epsilon(const Transition& transition) const;
 
   /**
-   * Create a new lookup path appropriate for initializing a lookup operation.
-   * @return a new lookup path pointing to the beginning of the transducer
+   * Whether the transitions and final states of the transducer have weights
+   */
+  bool is_weighted() const {return header->probe_flag(Weighted);}
+  
+  /**
+   * Whether any transition reads the given input symbol
+   */
+  bool reads_symbol(SymbolNumber symbol) const
+  {
+    return symbol < read_symbols.size() && read_symbols[symbol];
+  }
+  
+  /**
+   * Whether the character is always read as a token of its own that ends
+   * every lookup path and can't be part of an unknown word. Input can be
+   * split after such a character and the parts analysed independently
+   */
+  bool splits_input(char c) const;
+  
+  /**
+   * The same for superblanks, which are read as the blank symbol
    */
-  LookupPath* get_initial_path() const;
+  bool splits_input_at_superblanks() const;
 };
 
 #endif
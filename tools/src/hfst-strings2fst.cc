@@ -52,6 +52,7 @@ using std::pair;
 #include "HfstInputStream.h"
 #include "HfstOutputStream.h"
 #include "implementations/HfstBasicTransducer.h"
+#include "implementations/HfstMinimalAcyclicBuilder.h"
 #include "hfst-commandline.h"
 #include "hfst-program-options.h"
 #include "hfst-tool-metadata.h"
@@ -64,6 +65,7 @@ using hfst::HfstOutputStream;
 using hfst::HfstTokenizer;
 using hfst::HfstTransducer;
 using hfst::implementations::HfstBasicTransducer;
+using hfst::implementations::HfstMinimalAcyclicBuilder;
 //using hfst::HfstInternalTransducer;
 //using hfst::implementations::HfstTrie;
 using hfst::StringPairVector;
@@ -266,7 +268,8 @@ process_stream(HfstOutputStream& outstream)
   char* line = 0;
   size_t len = 0;
   HfstTokenizer tok;
-  HfstBasicTransducer disjunction;
+  // strings are disjuncted into a minimal transducer as they are read
+  HfstMinimalAcyclicBuilder disjunction;
   size_t line_n = 0;
 
   hfst::HfstStrings2FstTokenizer
@@ -374,13 +377,15 @@ process_stream(HfstOutputStream& outstream)
       else // disjunct all strings into a single transducer
         {
       // do not take negative logarithm yet
-          disjunction.disjunct(spv, path_weight);
+          disjunction.add(spv, path_weight);
         }
     }
   free(line);
   if (disjunct_strings)
     {
-      HfstTransducer res(disjunction, output_format);
+      HfstBasicTransducer minimal;
+      disjunction.finish(minimal);
+      HfstTransducer res(minimal, output_format);
 
       if (normalize_weights)
         {
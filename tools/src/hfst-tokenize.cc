@@ -29,6 +29,10 @@
 #include <map>
 #include <string>
 #include <set>
+#include <sstream>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 using std::string;
 using std::vector;
@@ -66,6 +70,7 @@ static bool superblanks = false; // Input is apertium-style superblanks (overrid
 static bool blankline_separated = true; // Input is separated by blank lines (as opposed to single newlines)
 static bool keep_newlines = false;
 static int token_number = 1;
+static size_t threads = 1;
 std::string tokenizer_filename;
 static hfst::ImplementationType default_format = hfst::TROPICAL_OPENFST_TYPE;
 TokenizeSettings settings;
@@ -102,6 +107,8 @@ print_usage()
             "  -C  --conllu             CoNLL-U format\n"
             "  -f, --finnpos            FinnPos output\n"
             "  -L, --visl               VISL input and output (implies -W, handles <s> as blocks and <STYLE> inline)\n"
+            "  -T, --threads=N          Tokenize paragraphs (or lines, or NUL-separated\n"
+            "                           parts) in N parallel threads\n"
             );
     fprintf(message_out,
             "Use standard streams for input and output (for now).\n"
@@ -116,7 +123,18 @@ print_usage()
 
 
 
-hfst_ol::PmatchContainer make_naive_tokenizer(HfstTransducer * dictionary)
+// Each thread needs a container of its own, as matching adds to the
+// alphabet. The others share the tables of the first one.
+void add_thread_containers(std::vector<hfst_ol::PmatchContainer *> & containers,
+                           size_t n)
+{
+    while (containers.size() < n) {
+        containers.push_back(new hfst_ol::PmatchContainer(*containers[0]));
+    }
+}
+
+void make_naive_tokenizers(HfstTransducer * dictionary, size_t n,
+                           std::vector<hfst_ol::PmatchContainer *> & containers)
 {
     HfstTransducer * word_boundary = hfst::pmatch::PmatchUtilityTransducers::
         make_latin1_whitespace_acceptor(default_format);
@@ -185,22 +203,179 @@ hfst_ol::PmatchContainer make_naive_tokenizer(HfstTransducer * dictionary)
                                          "", // no special options
                                          dictionary); // harmonize with the dictionary
     delete tokenizer_basic;
-    hfst_ol::PmatchContainer retval(tokenizer_ol);
     hfst_ol::Transducer * dict_backend = hfst::implementations::ConversionFunctions::
         hfst_transducer_to_hfst_ol(dictionary);
-    retval.add_rtn(dict_backend, dict_name);
+    hfst_ol::PmatchContainer * container = new hfst_ol::PmatchContainer(tokenizer_ol);
+    container->add_rtn(dict_backend, dict_name);
+    containers.push_back(container);
+    add_thread_containers(containers, n);
     delete tokenizer_ol;
-    return retval;
 }
 
+/**
+ * Where the input is sent to be tokenized and printed, in input order.
+ * The serial version does everything right away with one container.
+ */
+class TokenizeSink
+{
+public:
+    virtual ~TokenizeSink() {}
+    // Tokenize text and print the result
+    virtual void match(const std::string & text) = 0;
+    // Print text that isn't to be tokenized in the output format
+    virtual void nonmatching(const std::string & text) = 0;
+    // Print text as it is
+    virtual void literal(const std::string & text) = 0;
+    // Flush the output. Unless it is required, this may be skipped.
+    virtual void flush(bool required) = 0;
+    // Print whatever is still pending
+    virtual void finish(void) {}
+};
+
+class SerialTokenizeSink: public TokenizeSink
+{
+    hfst_ol::PmatchContainer & container;
+    std::ostream & outstream;
+public:
+    SerialTokenizeSink(hfst_ol::PmatchContainer & c, std::ostream & o):
+        container(c), outstream(o) {}
+    void match(const std::string & text)
+        { match_and_print(container, outstream, text, settings); }
+    void nonmatching(const std::string & text)
+        { print_nonmatching_sequence(text, outstream, settings); }
+    void literal(const std::string & text)
+        { outstream << text; }
+    void flush(bool)
+        { outstream.flush(); }
+};
+
+/**
+ * Collects the input into parts, tokenizes the parts in parallel threads
+ * with a container each and prints the results in input order. Matching
+ * in one paragraph, line or NUL-separated part doesn't depend on the
+ * others, so the output is the same as from SerialTokenizeSink.
+ */
+class ParallelTokenizeSink: public TokenizeSink
+{
+    // The size in bytes after which a part ends, and the number of parts
+    // per thread to collect before tokenizing them
+    static const size_t PART_SIZE = 16384;
+    static const size_t PARTS_PER_THREAD = 4;
+
+    struct Job
+    {
+        enum Kind { Match, Nonmatching, Literal } kind;
+        std::string text;
+    };
+    struct Part
+    {
+        std::vector<Job> jobs;
+        size_t size;
+        std::string output;
+        std::exception_ptr error;
+    };
+
+    std::vector<hfst_ol::PmatchContainer *> & containers;
+    std::ostream & outstream;
+    std::vector<Part> parts;
+
+    void add(Job::Kind kind, const std::string & text)
+    {
+        if (parts.empty() || parts.back().size >= PART_SIZE) {
+            if (parts.size() == containers.size() * PARTS_PER_THREAD) {
+                run();
+            }
+            parts.push_back(Part());
+            parts.back().size = 0;
+        }
+        Job job;
+        job.kind = kind;
+        job.text = text;
+        parts.back().jobs.push_back(job);
+        parts.back().size += text.size();
+    }
+
+    void tokenize_parts(hfst_ol::PmatchContainer * container,
+                        std::atomic<size_t> * next)
+    {
+        size_t i;
+        while ((i = (*next)++) < parts.size()) {
+            Part & part = parts[i];
+            std::ostringstream out;
+            out.copyfmt(outstream);
+            try {
+                SerialTokenizeSink sink(*container, out);
+                for (std::vector<Job>::const_iterator it = part.jobs.begin();
+                     it != part.jobs.end(); ++it) {
+                    switch (it->kind) {
+                    case Job::Match:
+                        sink.match(it->text);
+                        break;
+                    case Job::Nonmatching:
+                        sink.nonmatching(it->text);
+                        break;
+                    case Job::Literal:
+                        sink.literal(it->text);
+                        break;
+                    }
+                }
+            } catch (...) {
+                part.error = std::current_exception();
+            }
+            part.output = out.str();
+        }
+    }
+
+    void run(void)
+    {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < containers.size() && i < parts.size(); ++i) {
+            workers.push_back(std::thread(&ParallelTokenizeSink::tokenize_parts,
+                                          this, containers[i], &next));
+        }
+        tokenize_parts(containers[0], &next);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        for (std::vector<Part>::const_iterator it = parts.begin();
+             it != parts.end(); ++it) {
+            outstream << it->output;
+            if (it->error) {
+                std::rethrow_exception(it->error);
+            }
+        }
+        parts.clear();
+    }
+
+public:
+    ParallelTokenizeSink(std::vector<hfst_ol::PmatchContainer *> & c,
+                         std::ostream & o):
+        containers(c), outstream(o) {}
+    void match(const std::string & text)
+        { add(Job::Match, text); }
+    void nonmatching(const std::string & text)
+        { add(Job::Nonmatching, text); }
+    void literal(const std::string & text)
+        { add(Job::Literal, text); }
+    void flush(bool required)
+        {
+            if (required) {
+                run();
+                outstream.flush();
+            }
+        }
+    void finish(void)
+        { run(); }
+};
+
 // TODO: lambda this when C++11 available everywhere
-inline void process_input_0delim_print(hfst_ol::PmatchContainer & container,
-                                       std::ostream & outstream,
+inline void process_input_0delim_print(TokenizeSink & sink,
                                        std::ostringstream& cur)
 {
     const std::string& input_text{cur.str()};
     if(!input_text.empty()) {
-        match_and_print(container, outstream, input_text, settings);
+        sink.match(input_text);
     }
     cur.clear();
     cur.str(string());
@@ -215,7 +390,7 @@ inline void trim(std::string& str) {
     }
 }
 
-int process_input_visl(hfst_ol::PmatchContainer& container, std::ostream& outstream) {
+int process_input_visl(TokenizeSink & sink) {
     size_t bufsize = 0;
     char *buffer = 0;
     std::string line;
@@ -226,16 +401,16 @@ int process_input_visl(hfst_ol::PmatchContainer& container, std::ostream& outstr
         trim(line);
         if (!line.empty()) {
             if (line.front() == '<' && line.back() == '>') {
-                print_nonmatching_sequence(line, outstream, settings);
+                sink.nonmatching(line);
             }
             else {
-                match_and_print(container, outstream, line, settings);
+                sink.match(line);
             }
         }
         else {
-            outstream << '\n';
+            sink.literal("\n");
         }
-        outstream.flush();
+        sink.flush(false);
 
         buffer[0] = 0;
         len = 0;
@@ -253,20 +428,20 @@ int process_input_visl(hfst_ol::PmatchContainer& container, std::ostream& outstr
     trim(line);
     if (!line.empty()) {
         if (line.front() == '<' && line.back() == '>') {
-            print_nonmatching_sequence(line, outstream, settings);
+            sink.nonmatching(line);
         }
         else {
-            match_and_print(container, outstream, line, settings);
+            sink.match(line);
         }
     }
-    outstream.flush();
+    sink.flush(false);
 
     free(buffer);
     return EXIT_SUCCESS;
 }
 
 template<bool do_superblank>
-int process_input_0delim(hfst_ol::PmatchContainer & container,
+int process_input_0delim(TokenizeSink & sink,
                          std::ostream & outstream)
 {
     char * line = NULL;
@@ -283,7 +458,7 @@ int process_input_0delim(hfst_ol::PmatchContainer & container,
                 continue;
             }
             else if(do_superblank && !in_blank && line[i] == '[') {
-                process_input_0delim_print(container, outstream, cur);
+                process_input_0delim_print(sink, cur);
                 cur << line[i];
                 in_blank = true;
             }
@@ -296,19 +471,19 @@ int process_input_0delim(hfst_ol::PmatchContainer & container,
                 }
                 else {
                     in_blank = false;
-                    print_nonmatching_sequence(cur.str(), outstream, settings);
+                    sink.nonmatching(cur.str());
                     cur.clear();
                     cur.str(string());
                 }
             }
             else if(!in_blank && line[i] == '\n') {
                 cur << line[i];
-                process_input_0delim_print(container, outstream, cur);
+                process_input_0delim_print(sink, cur);
             }
             else if(line[i] == '\0') {
-                process_input_0delim_print(container, outstream, cur);
-                outstream << "<STREAMCMD:FLUSH>" << std::endl; // CG format uses this instead of \0
-                outstream.flush();
+                process_input_0delim_print(sink, cur);
+                sink.literal("<STREAMCMD:FLUSH>\n"); // CG format uses this instead of \0
+                sink.flush(true);
                 if(outstream.bad()) {
                     std::cerr << "hfst-tokenize: Could not flush file" << std::endl;
                 }
@@ -325,10 +500,10 @@ int process_input_0delim(hfst_ol::PmatchContainer & container,
         }
     }
     if(in_blank) {
-        print_nonmatching_sequence(cur.str(), outstream, settings);
+        sink.nonmatching(cur.str());
     }
     else {
-        process_input_0delim_print(container, outstream, cur);
+        process_input_0delim_print(sink, cur);
     }
     return EXIT_SUCCESS;
 }
@@ -341,22 +516,19 @@ inline void maybe_erase_newline(string& input_text)
     }
 }
 
-int process_input(hfst_ol::PmatchContainer & container,
+int process_input(TokenizeSink & sink,
                   std::ostream & outstream)
 {
-    if(settings.output_format == cg || settings.output_format == giellacg || settings.output_format == visl) {
-        outstream << std::fixed << std::setprecision(10);
-    }
     if(settings.output_format == giellacg || superblanks) {
         if(superblanks) {
-            return process_input_0delim<true>(container, outstream);
+            return process_input_0delim<true>(sink, outstream);
         }
         else {
-            return process_input_0delim<false>(container, outstream);
+            return process_input_0delim<false>(sink, outstream);
         }
     }
     if(settings.output_format == visl) {
-        return process_input_visl(container, outstream);
+        return process_input_visl(sink);
     }
     string input_text;
     char * line = NULL;
@@ -365,7 +537,7 @@ int process_input(hfst_ol::PmatchContainer & container,
         while (hfst_getline(&line, &bufsize, inputfile) > 0) {
             if (line[0] == '\n') {
                 maybe_erase_newline(input_text);
-                match_and_print(container, outstream, input_text, settings);
+                sink.match(input_text);
                 input_text.clear();
             } else {
                 input_text.append(line);
@@ -375,7 +547,7 @@ int process_input(hfst_ol::PmatchContainer & container,
         }
         if (!input_text.empty()) {
             maybe_erase_newline(input_text);
-            match_and_print(container, outstream, input_text, settings);
+            sink.match(input_text);
         }
     }
     else {
@@ -383,7 +555,7 @@ int process_input(hfst_ol::PmatchContainer & container,
         while (hfst_getline(&line, &bufsize, inputfile) > 0) {
             input_text = line;
             maybe_erase_newline(input_text);
-            match_and_print(container, outstream, input_text, settings);
+            sink.match(input_text);
             free(line);
             line = NULL;
         }
@@ -392,6 +564,33 @@ int process_input(hfst_ol::PmatchContainer & container,
     return EXIT_SUCCESS;
 }
 
+int process_input(std::vector<hfst_ol::PmatchContainer *> & containers,
+                  std::ostream & outstream)
+{
+    if(settings.output_format == cg || settings.output_format == giellacg || settings.output_format == visl) {
+        outstream << std::fixed << std::setprecision(10);
+    }
+    for (std::vector<hfst_ol::PmatchContainer *>::iterator it = containers.begin();
+         it != containers.end(); ++it) {
+        (*it)->set_verbose(verbose);
+        (*it)->set_single_codepoint_tokenization(!settings.tokenize_multichar);
+    }
+    TokenizeSink * sink;
+    if (containers.size() == 1) {
+        sink = new SerialTokenizeSink(*containers[0], outstream);
+    } else {
+        sink = new ParallelTokenizeSink(containers, outstream);
+    }
+    int retval = process_input(*sink, outstream);
+    sink->finish();
+    delete sink;
+    for (std::vector<hfst_ol::PmatchContainer *>::iterator it = containers.begin();
+         it != containers.end(); ++it) {
+        delete *it;
+    }
+    return retval;
+}
+
 int parse_options(int argc, char** argv)
 {
     extend_options_getenv(&argc, &argv);
@@ -421,10 +620,11 @@ int parse_options(int argc, char** argv)
                 {"conllu", no_argument, 0, 'C'},
                 {"finnpos", no_argument, 0, 'f'},
                 {"visl", no_argument, 0, 'L'},
+                {"threads", required_argument, 0, 'T'},
                 {0,0,0,0}
             };
         int option_index = 0;
-        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT "nkawWmub:t:l:zixcSgCfL",
+        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT "nkawWmub:t:l:zixcSgCfLT:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -519,6 +719,14 @@ int parse_options(int argc, char** argv)
         case 'f':
             settings.output_format = finnpos;
             break;
+        case 'T':
+            if (atoi(optarg) < 1)
+            {
+                std::cerr << "Invalid or no argument for thread count\n";
+                return EXIT_FAILURE;
+            }
+            threads = (size_t)atoi(optarg);
+            break;
 #include "inc/getopt-cases-error.h"
         }
 
@@ -600,16 +808,15 @@ int main(int argc, char ** argv)
             hfst::HfstInputStream is(tokenizer_filename);
             HfstTransducer * dictionary = new HfstTransducer(is);
             instream.close();
-            hfst_ol::PmatchContainer container = make_naive_tokenizer(dictionary);
+            std::vector<hfst_ol::PmatchContainer *> containers;
+            make_naive_tokenizers(dictionary, threads, containers);
             delete dictionary;
-            container.set_verbose(verbose);
-            container.set_single_codepoint_tokenization(!settings.tokenize_multichar);
-            return process_input(container, std::cout);
+            return process_input(containers, std::cout);
         } else {
-            hfst_ol::PmatchContainer container(instream);
-            container.set_verbose(verbose);
-            container.set_single_codepoint_tokenization(!settings.tokenize_multichar);
-            return process_input(container, std::cout);
+            std::vector<hfst_ol::PmatchContainer *> containers;
+            containers.push_back(new hfst_ol::PmatchContainer(instream));
+            add_thread_containers(containers, threads);
+            return process_input(containers, std::cout);
         }
     } catch(HfstException & e) {
         std::cerr << "Exception thrown:\n" << e.what() << std::endl;
@@ -161,6 +161,7 @@ int main(int argc, char * argv[])
 	}
 
       OtherSymbolTransducer::set_transducer_type(command_line.format);
+      RuleContainer::set_thread_count(command_line.thread_count);
       hfst::twolcpre3::set_silent(silent);
       hfst::twolcpre3::set_verbose(verbose);
       
@@ -57,6 +57,7 @@ int main(int argc, char * argv[])
       hfst::twolcpre3::set_error_stream(std::cerr);
       
       OtherSymbolTransducer::set_transducer_type(command_line.format);
+      RuleContainer::set_thread_count(command_line.thread_count);
       silent = command_line.be_quiet;
       hfst::twolcpre3::set_silent(silent);
       verbose = command_line.be_verbose;
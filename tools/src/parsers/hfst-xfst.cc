@@ -52,6 +52,7 @@ static char* execute_command_and_quit = NULL;
 static bool pipe_input = false;
 static bool pipe_output = false; // this has no effect on non-windows platforms
 static bool restricted_mode = false;
+static char* cache_directory = NULL;
 
 #ifdef HAVE_READLINE
   static bool use_readline = true;
@@ -83,6 +84,7 @@ print_usage()
           "  -w, --print-weight         Print weights for each operation\n"
 	  "  -R, --restricted-mode      Allow read and write operations only in current\n"
 	  "                             directory, do not allow system calls\n"
+          "      --cache=DIR            Reuse regexes compiled earlier, stored in DIR\n"
           //          "  -k, --no-console         Do not output directly to console (Windows-specific)\n"
           "\n"
           "Option --execute can be invoked many times.\n"
@@ -128,6 +130,7 @@ parse_options(int argc, char** argv)
             {"no-readline", no_argument, 0, 'r'},
             {"print-weight", no_argument, 0, 'w'},
 	    {"restricted-mode", no_argument, 0, 'R'},
+            {"cache", required_argument, 0, 'C'},
             //            {"no-console", no_argument, 0, 'k'},
             {0,0,0,0}
           };
@@ -209,6 +212,9 @@ parse_options(int argc, char** argv)
 	  case 'R':
             restricted_mode = true;
             break;
+          case 'C':
+            cache_directory = hfst_strdup(optarg);
+            break;
 	  case 'k':
             pipe_output = true;
             break;
@@ -400,6 +406,11 @@ int main(int argc, char** argv)
     {
       comp.setRestrictedMode(true);
     }
+
+  if (cache_directory != NULL)
+    {
+      comp.setCacheDirectory(cache_directory);
+    }
   
   if (!pipe_output)
     comp.setOutputToConsole(true);